@@ -0,0 +1,291 @@
+/*
+ *  gstvaapibufferproxy.c - Shared buffer abstraction
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapibufferproxy
+ * @short_description: Shared buffer abstraction
+ */
+
+#include "sysdeps.h"
+#include <unistd.h>
+#include "gstvaapibufferproxy.h"
+#include "gstvaapibufferproxy_priv.h"
+#include "gstvaapiobject_priv.h"
+#include "gstvaapiutils.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+static void
+gst_vaapi_buffer_proxy_finalize (GstVaapiBufferProxy * proxy)
+{
+  if (proxy->parent) {
+#if USE_DMABUF
+    VAStatus status;
+
+    GST_VAAPI_OBJECT_LOCK_DISPLAY (proxy->parent);
+    status = vaReleaseBufferHandle (GST_VAAPI_OBJECT_VADISPLAY (proxy->parent),
+        proxy->va_buf);
+    GST_VAAPI_OBJECT_UNLOCK_DISPLAY (proxy->parent);
+    if (!vaapi_check_status (status, "vaReleaseBufferHandle()"))
+      GST_WARNING ("failed to release buffer handle %d", proxy->fd);
+#endif
+    gst_vaapi_object_replace (&proxy->parent, NULL);
+  }
+  else if (proxy->fd >= 0)
+    close (proxy->fd);
+  proxy->fd = -1;
+
+  /* Notify the user function that the object is now destroyed */
+  if (proxy->destroy_func)
+    proxy->destroy_func (proxy->destroy_data);
+}
+
+static inline const GstVaapiMiniObjectClass *
+gst_vaapi_buffer_proxy_class (void)
+{
+  static const GstVaapiMiniObjectClass GstVaapiBufferProxyClass = {
+    sizeof (GstVaapiBufferProxy),
+    (GDestroyNotify) gst_vaapi_buffer_proxy_finalize
+  };
+  return &GstVaapiBufferProxyClass;
+}
+
+static GstVaapiBufferProxy *
+buffer_proxy_new (void)
+{
+  GstVaapiBufferProxy *proxy;
+
+  proxy = (GstVaapiBufferProxy *)
+      gst_vaapi_mini_object_new (gst_vaapi_buffer_proxy_class ());
+  if (!proxy)
+    return NULL;
+
+  proxy->parent = NULL;
+  proxy->va_buf = VA_INVALID_ID;
+  proxy->fd = -1;
+  proxy->size = 0;
+  proxy->destroy_func = NULL;
+  proxy->destroy_data = NULL;
+  return proxy;
+}
+
+/**
+ * gst_vaapi_buffer_proxy_new:
+ * @fd: a DMA-BUF file descriptor
+ * @size: the size of the buffer, in bytes
+ *
+ * Creates a new buffer proxy wrapping the supplied DMA-BUF handle, e.g.
+ * for importing the buffer into a #GstVaapiSurface. The @fd is
+ * duplicated, so the caller keeps ownership of its own descriptor and
+ * may close it at any time. The duplicate is closed when the last
+ * reference to the proxy object is released.
+ *
+ * Return value: the newly allocated #GstVaapiBufferProxy object, or
+ *   %NULL if an error occurred
+ */
+GstVaapiBufferProxy *
+gst_vaapi_buffer_proxy_new (gint fd, gsize size)
+{
+  GstVaapiBufferProxy *proxy;
+
+  g_return_val_if_fail (fd >= 0, NULL);
+  g_return_val_if_fail (size > 0, NULL);
+
+  proxy = buffer_proxy_new ();
+  if (!proxy)
+    return NULL;
+
+  proxy->fd = dup (fd);
+  if (proxy->fd < 0)
+    goto error_dup_handle;
+  proxy->size = size;
+  return proxy;
+
+  /* ERRORS */
+error_dup_handle:
+  {
+    GST_ERROR ("failed to duplicate DMA-BUF handle %d", fd);
+    gst_vaapi_buffer_proxy_unref (proxy);
+    return NULL;
+  }
+}
+
+/**
+ * gst_vaapi_buffer_proxy_new_from_object:
+ * @object: the #GstVaapiObject owning the VA buffer
+ * @buf_id: the VA buffer to export
+ *
+ * Exports the VA buffer @buf_id as a DMA-BUF handle. The handle is owned
+ * by the VA driver: it shall not be closed by the caller, and it is
+ * only valid until the last reference to the proxy object is released.
+ * A reference to @object is held until then.
+ *
+ * Return value: the newly allocated #GstVaapiBufferProxy object, or
+ *   %NULL if the VA buffer could not be exported
+ */
+GstVaapiBufferProxy *
+gst_vaapi_buffer_proxy_new_from_object (GstVaapiObject * object,
+    VABufferID buf_id)
+{
+#if USE_DMABUF
+  GstVaapiBufferProxy *proxy;
+  VAStatus status;
+
+  g_return_val_if_fail (object != NULL, NULL);
+  g_return_val_if_fail (buf_id != VA_INVALID_ID, NULL);
+
+  proxy = buffer_proxy_new ();
+  if (!proxy)
+    return NULL;
+
+  memset (&proxy->va_info, 0, sizeof (proxy->va_info));
+  proxy->va_info.mem_type = VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME;
+
+  GST_VAAPI_OBJECT_LOCK_DISPLAY (object);
+  status = vaAcquireBufferHandle (GST_VAAPI_OBJECT_VADISPLAY (object),
+      buf_id, &proxy->va_info);
+  GST_VAAPI_OBJECT_UNLOCK_DISPLAY (object);
+  if (!vaapi_check_status (status, "vaAcquireBufferHandle()"))
+    goto error_acquire_handle;
+
+  proxy->parent = gst_vaapi_object_ref (object);
+  proxy->va_buf = buf_id;
+  proxy->fd = proxy->va_info.handle;
+  proxy->size = proxy->va_info.mem_size;
+  return proxy;
+
+  /* ERRORS */
+error_acquire_handle:
+  {
+    GST_ERROR ("failed to export VA buffer %" GST_VAAPI_ID_FORMAT,
+        GST_VAAPI_ID_ARGS (buf_id));
+    gst_vaapi_buffer_proxy_unref (proxy);
+    return NULL;
+  }
+#else
+  return NULL;
+#endif
+}
+
+/**
+ * gst_vaapi_buffer_proxy_ref:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Atomically increases the reference count of the given @proxy by one.
+ *
+ * Returns: The same @proxy argument
+ */
+GstVaapiBufferProxy *
+gst_vaapi_buffer_proxy_ref (GstVaapiBufferProxy * proxy)
+{
+  g_return_val_if_fail (proxy != NULL, NULL);
+
+  return GST_VAAPI_BUFFER_PROXY (gst_vaapi_mini_object_ref
+      (GST_VAAPI_MINI_OBJECT (proxy)));
+}
+
+/**
+ * gst_vaapi_buffer_proxy_unref:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Atomically decreases the reference count of the @proxy by one. If
+ * the reference count reaches zero, the object will be free'd.
+ */
+void
+gst_vaapi_buffer_proxy_unref (GstVaapiBufferProxy * proxy)
+{
+  g_return_if_fail (proxy != NULL);
+
+  gst_vaapi_mini_object_unref (GST_VAAPI_MINI_OBJECT (proxy));
+}
+
+/**
+ * gst_vaapi_buffer_proxy_replace:
+ * @old_proxy_ptr: a pointer to a #GstVaapiBufferProxy
+ * @new_proxy: a #GstVaapiBufferProxy
+ *
+ * Atomically replaces the proxy object held in @old_proxy_ptr with
+ * @new_proxy. This means that @old_proxy_ptr shall reference a valid
+ * object. However, @new_proxy can be NULL.
+ */
+void
+gst_vaapi_buffer_proxy_replace (GstVaapiBufferProxy ** old_proxy_ptr,
+    GstVaapiBufferProxy * new_proxy)
+{
+  g_return_if_fail (old_proxy_ptr != NULL);
+
+  gst_vaapi_mini_object_replace ((GstVaapiMiniObject **) old_proxy_ptr,
+      GST_VAAPI_MINI_OBJECT (new_proxy));
+}
+
+/**
+ * gst_vaapi_buffer_proxy_get_handle:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Returns the DMA-BUF file descriptor of the @proxy. The descriptor
+ * is owned by the @proxy and shall be duplicated if it needs to live
+ * longer than the @proxy.
+ *
+ * Return value: the DMA-BUF file descriptor, or -1 if an error occurred
+ */
+gint
+gst_vaapi_buffer_proxy_get_handle (GstVaapiBufferProxy * proxy)
+{
+  g_return_val_if_fail (proxy != NULL, -1);
+
+  return GST_VAAPI_BUFFER_PROXY_HANDLE (proxy);
+}
+
+/**
+ * gst_vaapi_buffer_proxy_get_size:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Returns the size of the underlying buffer of the @proxy.
+ *
+ * Return value: the buffer size, in bytes
+ */
+gsize
+gst_vaapi_buffer_proxy_get_size (GstVaapiBufferProxy * proxy)
+{
+  g_return_val_if_fail (proxy != NULL, 0);
+
+  return GST_VAAPI_BUFFER_PROXY_SIZE (proxy);
+}
+
+/**
+ * gst_vaapi_buffer_proxy_set_destroy_notify:
+ * @proxy: a @GstVaapiBufferProxy
+ * @destroy_func: a #GDestroyNotify function
+ * @user_data: some extra data to pass to the @destroy_func function
+ *
+ * Sets @destroy_func as the function to call when the buffer @proxy
+ * was released. At this point, the DMA-BUF handle is no longer valid.
+ */
+void
+gst_vaapi_buffer_proxy_set_destroy_notify (GstVaapiBufferProxy * proxy,
+    GDestroyNotify destroy_func, gpointer user_data)
+{
+  g_return_if_fail (proxy != NULL);
+
+  proxy->destroy_func = destroy_func;
+  proxy->destroy_data = user_data;
+}
@@ -0,0 +1,74 @@
+/*
+ *  gstvaapibufferproxy.h - Shared buffer abstraction
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_BUFFER_PROXY_H
+#define GST_VAAPI_BUFFER_PROXY_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiBufferProxy GstVaapiBufferProxy;
+
+/**
+ * GST_VAAPI_BUFFER_PROXY_HANDLE:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Macro that evaluates to the DMA-BUF file descriptor of @proxy.
+ */
+#define GST_VAAPI_BUFFER_PROXY_HANDLE(proxy) \
+  gst_vaapi_buffer_proxy_get_handle (proxy)
+
+/**
+ * GST_VAAPI_BUFFER_PROXY_SIZE:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Macro that evaluates to the size of the underlying buffer of @proxy.
+ */
+#define GST_VAAPI_BUFFER_PROXY_SIZE(proxy) \
+  gst_vaapi_buffer_proxy_get_size (proxy)
+
+GstVaapiBufferProxy *
+gst_vaapi_buffer_proxy_new (gint fd, gsize size);
+
+GstVaapiBufferProxy *
+gst_vaapi_buffer_proxy_ref (GstVaapiBufferProxy * proxy);
+
+void
+gst_vaapi_buffer_proxy_unref (GstVaapiBufferProxy * proxy);
+
+void
+gst_vaapi_buffer_proxy_replace (GstVaapiBufferProxy ** old_proxy_ptr,
+    GstVaapiBufferProxy * new_proxy);
+
+gint
+gst_vaapi_buffer_proxy_get_handle (GstVaapiBufferProxy * proxy);
+
+gsize
+gst_vaapi_buffer_proxy_get_size (GstVaapiBufferProxy * proxy);
+
+void
+gst_vaapi_buffer_proxy_set_destroy_notify (GstVaapiBufferProxy * proxy,
+    GDestroyNotify destroy_func, gpointer user_data);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_BUFFER_PROXY_H */
@@ -0,0 +1,86 @@
+/*
+ *  gstvaapibufferproxy_priv.h - Shared buffer abstraction (private)
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_BUFFER_PROXY_PRIV_H
+#define GST_VAAPI_BUFFER_PROXY_PRIV_H
+
+#include "gstvaapicompat.h"
+#include "gstvaapibufferproxy.h"
+#include "gstvaapiobject.h"
+#include "gstvaapiminiobject.h"
+
+G_BEGIN_DECLS
+
+#define GST_VAAPI_BUFFER_PROXY(proxy) \
+  ((GstVaapiBufferProxy *)(proxy))
+
+/**
+ * GstVaapiBufferProxy:
+ *
+ * A DMA-BUF handle wrapper. Imported buffers own a duplicate of the
+ * user supplied file descriptor. Exported buffers hold the handle of
+ * a VA buffer, which stays valid as long as the @parent object lives
+ * and the proxy is not released.
+ */
+struct _GstVaapiBufferProxy
+{
+  /*< private >*/
+  GstVaapiMiniObject parent_instance;
+
+  GstVaapiObject *parent;
+  VABufferID va_buf;
+#if USE_DMABUF
+  VABufferInfo va_info;
+#endif
+  gint fd;
+  gsize size;
+  GDestroyNotify destroy_func;
+  gpointer destroy_data;
+};
+
+/**
+ * GST_VAAPI_BUFFER_PROXY_HANDLE:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Macro that evaluates to the DMA-BUF file descriptor of @proxy.
+ */
+#undef  GST_VAAPI_BUFFER_PROXY_HANDLE
+#define GST_VAAPI_BUFFER_PROXY_HANDLE(proxy) \
+  GST_VAAPI_BUFFER_PROXY (proxy)->fd
+
+/**
+ * GST_VAAPI_BUFFER_PROXY_SIZE:
+ * @proxy: a #GstVaapiBufferProxy
+ *
+ * Macro that evaluates to the size of the underlying buffer of @proxy.
+ */
+#undef  GST_VAAPI_BUFFER_PROXY_SIZE
+#define GST_VAAPI_BUFFER_PROXY_SIZE(proxy) \
+  GST_VAAPI_BUFFER_PROXY (proxy)->size
+
+G_GNUC_INTERNAL
+GstVaapiBufferProxy *
+gst_vaapi_buffer_proxy_new_from_object (GstVaapiObject * object,
+    VABufferID buf_id);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_BUFFER_PROXY_PRIV_H */
@@ -109,6 +109,7 @@ gst_vaapi_coded_buffer_pool_new (GstVaapiEncoder * encoder, gsize buf_size)
       GST_VAAPI_VIDEO_POOL_OBJECT_TYPE_CODED_BUFFER);
   coded_buffer_pool_init (GST_VAAPI_CODED_BUFFER_POOL (pool),
       context, buf_size);
+  gst_vaapi_video_pool_set_object_size (pool, buf_size);
   return pool;
 }
 
@@ -54,4 +54,9 @@
 # include <va/va_compat.h>
 #endif
 
+/* DMA-BUF buffer sharing (VA-API >= 0.36) */
+#if USE_DMABUF
+# include <va/va_drmcommon.h>
+#endif
+
 #endif /* GST_VAAPI_COMPAT_H */
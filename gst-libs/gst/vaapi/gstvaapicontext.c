@@ -77,6 +77,22 @@ context_destroy_surfaces (GstVaapiContext * context)
   gst_vaapi_video_pool_replace (&context->surfaces_pool, NULL);
 }
 
+/* Checks whether the surface is one of the context surfaces */
+static gboolean
+context_has_surface (GstVaapiContext * context, GstVaapiSurface * surface)
+{
+  guint i;
+
+  if (!context->surfaces)
+    return FALSE;
+
+  for (i = 0; i < context->surfaces->len; i++) {
+    if (g_ptr_array_index (context->surfaces, i) == surface)
+      return TRUE;
+  }
+  return FALSE;
+}
+
 static void
 context_destroy (GstVaapiContext * context)
 {
@@ -95,6 +111,7 @@ context_destroy (GstVaapiContext * context)
     if (!vaapi_check_status (status, "vaDestroyContext()"))
       GST_WARNING ("failed to destroy context 0x%08x", context_id);
     GST_VAAPI_OBJECT_ID (context) = VA_INVALID_ID;
+    gst_vaapi_display_update_usage (display, -1, 0);
   }
 
   if (context->va_config != VA_INVALID_ID) {
@@ -117,7 +134,8 @@ context_ensure_surfaces (GstVaapiContext * context)
   guint i;
 
   for (i = context->surfaces->len; i < num_surfaces; i++) {
-    surface = gst_vaapi_surface_new (GST_VAAPI_OBJECT_DISPLAY (context),
+    surface =
+        gst_vaapi_surface_new_recyclable (GST_VAAPI_OBJECT_DISPLAY (context),
         cip->chroma_type, cip->width, cip->height);
     if (!surface)
       return FALSE;
@@ -190,6 +208,19 @@ context_create (GstVaapiContext * context)
   }
   g_assert (surfaces->len == context->surfaces->len);
 
+  /* Surfaces of a previous configuration that are still used as
+     reference shall remain valid render targets */
+  if (context->reference_surfaces) {
+    for (i = 0; i < context->reference_surfaces->len; i++) {
+      GstVaapiSurface *const surface =
+          g_ptr_array_index (context->reference_surfaces, i);
+      if (context_has_surface (context, surface))
+        continue;
+      surface_id = GST_VAAPI_OBJECT_ID (surface);
+      g_array_append_val (surfaces, surface_id);
+    }
+  }
+
   /* Reset profile and entrypoint */
   if (!cip->profile || !cip->entrypoint)
     goto cleanup;
@@ -219,19 +250,21 @@ context_create (GstVaapiContext * context)
       const GstVaapiConfigInfoEncoder *const config = &cip->config.encoder;
       guint va_rate_control;
 
-      /* Rate control */
-      attrib->type = VAConfigAttribRateControl;
-      if (!context_get_attribute (context, attrib->type, &value))
-        goto cleanup;
+      /* Rate control, unless the encoder has none (e.g. JPEG) */
+      if (config->rc_mode != GST_VAAPI_RATECONTROL_NONE) {
+        attrib->type = VAConfigAttribRateControl;
+        if (!context_get_attribute (context, attrib->type, &value))
+          goto cleanup;
 
-      va_rate_control = from_GstVaapiRateControl (config->rc_mode);
-      if ((value & va_rate_control) != va_rate_control) {
-        GST_ERROR ("unsupported %s rate control",
-            string_of_VARateControl (va_rate_control));
-        goto cleanup;
+        va_rate_control = from_GstVaapiRateControl (config->rc_mode);
+        if ((value & va_rate_control) != va_rate_control) {
+          GST_ERROR ("unsupported %s rate control",
+              string_of_VARateControl (va_rate_control));
+          goto cleanup;
+        }
+        attrib->value = va_rate_control;
+        attrib++;
       }
-      attrib->value = va_rate_control;
-      attrib++;
 
       /* Packed headers */
       if (config->packed_headers) {
@@ -272,6 +305,7 @@ context_create (GstVaapiContext * context)
 
   GST_DEBUG ("context 0x%08x", context_id);
   GST_VAAPI_OBJECT_ID (context) = context_id;
+  gst_vaapi_display_update_usage (display, 1, 0);
   success = TRUE;
 
 cleanup:
@@ -321,6 +355,10 @@ gst_vaapi_context_finalize (GstVaapiContext * context)
 {
   context_destroy (context);
   context_destroy_surfaces (context);
+  if (context->reference_surfaces) {
+    g_ptr_array_unref (context->reference_surfaces);
+    context->reference_surfaces = NULL;
+  }
   gst_vaapi_context_overlay_finalize (context);
 }
 
@@ -433,6 +471,31 @@ gst_vaapi_context_reset (GstVaapiContext * context,
   return TRUE;
 }
 
+/**
+ * gst_vaapi_context_set_reference_surfaces:
+ * @context: a #GstVaapiContext
+ * @surfaces: (allow-none): a #GPtrArray of #GstVaapiSurface objects
+ *
+ * Sets the surfaces that are still used as reference, but that may not
+ * belong to @context after the next gst_vaapi_context_reset(), e.g.
+ * when the frame size grows in the middle of a VP9 stream. Those are
+ * passed as render targets to any VA context created afterwards, in
+ * addition to the @context surfaces. The @context holds a reference to
+ * @surfaces until this function is called again.
+ */
+void
+gst_vaapi_context_set_reference_surfaces (GstVaapiContext * context,
+    GPtrArray * surfaces)
+{
+  g_return_if_fail (context != NULL);
+
+  if (surfaces)
+    g_ptr_array_ref (surfaces);
+  if (context->reference_surfaces)
+    g_ptr_array_unref (context->reference_surfaces);
+  context->reference_surfaces = surfaces;
+}
+
 /**
  * gst_vaapi_context_get_id:
  * @context: a #GstVaapiContext
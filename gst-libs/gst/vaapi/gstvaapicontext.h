@@ -106,6 +106,7 @@ struct _GstVaapiContext
   VAConfigID va_config;
   GPtrArray *surfaces;
   GstVaapiVideoPool *surfaces_pool;
+  GPtrArray *reference_surfaces;
   GPtrArray *overlays[2];
   guint overlay_id;
 };
@@ -131,6 +132,11 @@ gboolean
 gst_vaapi_context_reset (GstVaapiContext * context,
     const GstVaapiContextInfo * new_cip);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_context_set_reference_surfaces (GstVaapiContext * context,
+    GPtrArray * surfaces);
+
 G_GNUC_INTERNAL
 GstVaapiID
 gst_vaapi_context_get_id (GstVaapiContext * context);
@@ -27,6 +27,7 @@
 #include "gstvaapiutils.h"
 #include "gstvaapiimage.h"
 #include "gstvaapisubpicture.h"
+#include "gstvaapisubpicture_priv.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -247,17 +248,33 @@ overlay_rectangle_changed_render_rect (GstVaapiOverlayRectangle * overlay,
   return TRUE;
 }
 
-static inline gboolean
+/* The subpicture may be shared with other overlay rectangles, so it is
+   replaced with another one bound to the same image, rather than being
+   changed in place */
+static gboolean
 overlay_rectangle_update_global_alpha (GstVaapiOverlayRectangle * overlay,
-    GstVideoOverlayRectangle * rect)
+    GstVideoOverlayRectangle * rect, gboolean * reassociate_ptr)
 {
+  GstVaapiSubpicture *subpicture;
+
 #ifdef HAVE_GST_VIDEO_OVERLAY_HWCAPS
   const guint flags = gst_video_overlay_rectangle_get_flags (rect);
   if (!(flags & GST_VIDEO_OVERLAY_FORMAT_FLAG_GLOBAL_ALPHA))
     return TRUE;
 #endif
-  return gst_vaapi_subpicture_set_global_alpha (overlay->subpicture,
+  subpicture = gst_vaapi_subpicture_ensure_global_alpha (overlay->subpicture,
       gst_video_overlay_rectangle_get_global_alpha (rect));
+  if (!subpicture)
+    return FALSE;
+
+  if (subpicture != overlay->subpicture) {
+    overlay_rectangle_deassociate (overlay);
+    gst_vaapi_object_unref (overlay->subpicture);
+    overlay->subpicture = subpicture;
+    *reassociate_ptr = TRUE;
+  } else
+    gst_vaapi_object_unref (subpicture);
+  return TRUE;
 }
 
 static gboolean
@@ -268,7 +285,7 @@ overlay_rectangle_update (GstVaapiOverlayRectangle * overlay,
     return FALSE;
   if (overlay_rectangle_changed_render_rect (overlay, rect))
     *reassociate_ptr = TRUE;
-  if (!overlay_rectangle_update_global_alpha (overlay, rect))
+  if (!overlay_rectangle_update_global_alpha (overlay, rect, reassociate_ptr))
     return FALSE;
   gst_video_overlay_rectangle_replace (&overlay->rect, rect);
   return TRUE;
@@ -328,6 +345,42 @@ overlay_reassociate (GPtrArray * overlays)
   return TRUE;
 }
 
+/* Overlay rectangles with identical pixels share the same subpicture,
+   but VA associates a subpicture to a single rectangle per surface. So,
+   duplicates within the same composition get their own subpictures */
+static gboolean
+overlay_ensure_unique_subpictures (GPtrArray * overlays,
+    gboolean * reassociate_ptr)
+{
+  GstVaapiSubpicture *subpicture;
+  guint i, j;
+
+  for (i = 1; i < overlays->len; i++) {
+    GstVaapiOverlayRectangle *const overlay = g_ptr_array_index (overlays, i);
+
+    for (j = 0; j < i; j++) {
+      GstVaapiOverlayRectangle *const other = g_ptr_array_index (overlays, j);
+      if (other->subpicture == overlay->subpicture)
+        break;
+    }
+    if (j == i)
+      continue;
+
+    subpicture = gst_vaapi_subpicture_new_from_overlay_rectangle_unshared
+        (GST_VAAPI_OBJECT_DISPLAY (overlay->context), overlay->rect);
+    if (!subpicture)
+      return FALSE;
+
+    /* The other overlay rectangle is not associated yet, since any
+       previous duplicate was already made unique */
+    overlay_rectangle_deassociate (overlay);
+    gst_vaapi_object_unref (overlay->subpicture);
+    overlay->subpicture = subpicture;
+    *reassociate_ptr = TRUE;
+  }
+  return TRUE;
+}
+
 static gboolean
 overlay_ensure (GPtrArray ** overlay_ptr)
 {
@@ -438,6 +491,11 @@ gst_vaapi_context_apply_composition (GstVaapiContext * context,
     g_ptr_array_add (next_overlay, overlay);
   }
 
+  if (!overlay_ensure_unique_subpictures (next_overlay, &reassociate)) {
+    GST_WARNING ("could not create VA overlay rectangle");
+    goto error;
+  }
+
   overlay_clear (curr_overlay);
   context->overlay_id ^= 1;
 
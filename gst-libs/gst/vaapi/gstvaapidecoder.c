@@ -681,6 +681,76 @@ gst_vaapi_decoder_get_caps (GstVaapiDecoder * decoder)
   return get_caps (decoder);
 }
 
+/**
+ * gst_vaapi_decoder_set_extra_surfaces:
+ * @decoder: a #GstVaapiDecoder
+ * @num_surfaces: the number of extra surfaces to allocate
+ *
+ * Requests @num_surfaces VA surfaces to be allocated on top of the
+ * reference and scratch surfaces needed for decoding. This is useful
+ * when downstream elements hold decoded surfaces for some time,
+ * e.g. a VA encoder working directly on the decoded surfaces, so that
+ * both elements can share the same pool of surfaces without stalling.
+ *
+ * The additional surfaces are allocated before the next frame gets
+ * decoded, i.e. from the decoding thread. The VA context is then
+ * re-created so that every surface of the pool is one of its render
+ * targets. The number of surfaces in the pool never shrinks.
+ *
+ * Note: @num_surfaces is expected to cover all the downstream elements
+ * that hold decoded surfaces, e.g. all the branches of a tee.
+ */
+void
+gst_vaapi_decoder_set_extra_surfaces (GstVaapiDecoder * decoder,
+    guint num_surfaces)
+{
+  g_return_if_fail (decoder != NULL);
+
+  decoder->extra_surfaces = num_surfaces;
+}
+
+/**
+ * gst_vaapi_decoder_set_error_concealment:
+ * @decoder: a #GstVaapiDecoder
+ * @error_concealment: %TRUE to conceal bitstream errors
+ *
+ * Keeps decoding frames with missing slices, or whose reference
+ * frames are missing, e.g. after a transport stream glitch, instead
+ * of dropping them until the next intra frame. Missing reference
+ * frames are substituted with the nearest picture available in the
+ * DPB. Such frames, and the frames predicted from them, are output
+ * with the %GST_VAAPI_SURFACE_PROXY_FLAG_CORRUPTED flag set.
+ *
+ * This is only supported by the MPEG-2 and H.264 decoders so far.
+ */
+void
+gst_vaapi_decoder_set_error_concealment (GstVaapiDecoder * decoder,
+    gboolean error_concealment)
+{
+  g_return_if_fail (decoder != NULL);
+
+  decoder->error_concealment = error_concealment;
+}
+
+/**
+ * gst_vaapi_decoder_get_error_stats:
+ * @decoder: a #GstVaapiDecoder
+ * @stats: (out caller-allocates): the #GstVaapiDecoderErrorStats
+ *
+ * Retrieves how many corrupted frames were output so far, how many
+ * reference pictures had to be substituted, and how long it took to
+ * get clean frames again after errors.
+ */
+void
+gst_vaapi_decoder_get_error_stats (GstVaapiDecoder * decoder,
+    GstVaapiDecoderErrorStats * stats)
+{
+  g_return_if_fail (decoder != NULL);
+  g_return_if_fail (stats != NULL);
+
+  *stats = decoder->error_stats;
+}
+
 /**
  * gst_vaapi_decoder_put_buffer:
  * @decoder: a #GstVaapiDecoder
@@ -945,6 +1015,8 @@ gst_vaapi_decoder_ensure_context (GstVaapiDecoder * decoder,
   gst_vaapi_decoder_set_picture_size (decoder, cip->width, cip->height);
 
   cip->usage = GST_VAAPI_CONTEXT_USAGE_DECODE;
+  cip->ref_frames += decoder->extra_surfaces;
+  decoder->context_extra_surfaces = decoder->extra_surfaces;
   if (decoder->context) {
     if (!gst_vaapi_context_reset (decoder->context, cip))
       return FALSE;
@@ -964,6 +1036,56 @@ gst_vaapi_decoder_push_frame (GstVaapiDecoder * decoder,
   push_frame (decoder, frame);
 }
 
+void
+gst_vaapi_decoder_count_concealed_ref (GstVaapiDecoder * decoder)
+{
+  decoder->error_stats.num_concealed_refs++;
+}
+
+/* Updates the error statistics with the next frame in output order */
+void
+gst_vaapi_decoder_count_output_frame (GstVaapiDecoder * decoder,
+    gboolean is_corrupted)
+{
+  GstVaapiDecoderErrorStats *const stats = &decoder->error_stats;
+
+  if (is_corrupted) {
+    stats->num_corrupted_frames++;
+    decoder->num_corrupted_run++;
+    return;
+  }
+
+  if (decoder->num_corrupted_run > 0) {
+    stats->num_recoveries++;
+    stats->max_recovery_frames = MAX (stats->max_recovery_frames,
+        decoder->num_corrupted_run);
+    decoder->num_corrupted_run = 0;
+  }
+}
+
+/* Grows the surface pool, should extra surfaces be requested. This is
+   only done in between two frames, where no picture is being submitted
+   and no VA buffer is bound to the current VA context, so that the
+   latter can be re-created with all the surfaces as render targets.
+   Reference pictures keep their surfaces, which remain in the pool */
+static gboolean
+ensure_extra_surfaces (GstVaapiDecoder * decoder)
+{
+  GstVaapiContextInfo info;
+
+  if (!decoder->context ||
+      decoder->extra_surfaces <= decoder->context_extra_surfaces)
+    return TRUE;
+
+  info = decoder->context->info;
+  info.ref_frames += decoder->extra_surfaces - decoder->context_extra_surfaces;
+  if (!gst_vaapi_context_reset (decoder->context, &info))
+    return FALSE;
+  decoder->context_extra_surfaces = decoder->extra_surfaces;
+  decoder->va_context = gst_vaapi_context_get_id (decoder->context);
+  return TRUE;
+}
+
 GstVaapiDecoderStatus
 gst_vaapi_decoder_check_status (GstVaapiDecoder * decoder)
 {
@@ -1005,6 +1127,9 @@ gst_vaapi_decoder_decode (GstVaapiDecoder * decoder, GstVideoCodecFrame * frame)
   g_return_val_if_fail (frame->user_data != NULL,
       GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
 
+  if (!ensure_extra_surfaces (decoder))
+    return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+
   status = gst_vaapi_decoder_check_status (decoder);
   if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
     return status;
@@ -1020,6 +1145,32 @@ gst_vaapi_decoder_flush (GstVaapiDecoder * decoder)
   return do_flush (decoder);
 }
 
+/**
+ * gst_vaapi_decoder_prepare:
+ * @decoder: a #GstVaapiDecoder
+ *
+ * Sets up the VA decoding context and allocates the decoded surfaces
+ * ahead of the first frame, if the stream headers are already known
+ * from the caps, e.g. from "codec_data". Otherwise, this is done once
+ * the first sequence headers are decoded. This is optional and allows
+ * for reducing the time to decode the first frame.
+ *
+ * Return value: a #GstVaapiDecoderStatus
+ */
+GstVaapiDecoderStatus
+gst_vaapi_decoder_prepare (GstVaapiDecoder * decoder)
+{
+  const GstVaapiDecoderClass *klass;
+
+  g_return_val_if_fail (decoder != NULL,
+      GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
+
+  klass = GST_VAAPI_DECODER_GET_CLASS (decoder);
+  if (!klass->prepare)
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+  return klass->prepare (decoder);
+}
+
 GstVaapiDecoderStatus
 gst_vaapi_decoder_decode_codec_data (GstVaapiDecoder * decoder)
 {
@@ -36,6 +36,7 @@ G_BEGIN_DECLS
     ((GstVaapiDecoder *)(obj))
 
 typedef struct _GstVaapiDecoder GstVaapiDecoder;
+typedef struct _GstVaapiDecoderErrorStats GstVaapiDecoderErrorStats;
 typedef void (*GstVaapiDecoderStateChangedFunc) (GstVaapiDecoder * decoder,
     const GstVideoCodecState * codec_state, gpointer user_data);
 
@@ -73,6 +74,28 @@ typedef enum {
   GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN = -1
 } GstVaapiDecoderStatus;
 
+/**
+ * GstVaapiDecoderErrorStats:
+ * @num_corrupted_frames: the number of frames output with missing
+ *   slices, or predicted from missing or corrupted reference frames
+ * @num_concealed_refs: the number of missing reference pictures that
+ *   were substituted with another picture from the DPB
+ * @num_recoveries: the number of times a clean frame was output after
+ *   corrupted ones
+ * @max_recovery_frames: the largest number of consecutive corrupted
+ *   frames, i.e. the longest time it took to recover from an error
+ *
+ * Statistics about the bitstream errors concealed by the decoder, see
+ * gst_vaapi_decoder_set_error_concealment().
+ */
+struct _GstVaapiDecoderErrorStats
+{
+  guint num_corrupted_frames;
+  guint num_concealed_refs;
+  guint num_recoveries;
+  guint max_recovery_frames;
+};
+
 GstVaapiDecoder *
 gst_vaapi_decoder_ref (GstVaapiDecoder * decoder);
 
@@ -102,6 +125,18 @@ gst_vaapi_decoder_set_codec_state_changed_func (GstVaapiDecoder * decoder,
 GstCaps *
 gst_vaapi_decoder_get_caps (GstVaapiDecoder * decoder);
 
+void
+gst_vaapi_decoder_set_extra_surfaces (GstVaapiDecoder * decoder,
+    guint num_surfaces);
+
+void
+gst_vaapi_decoder_set_error_concealment (GstVaapiDecoder * decoder,
+    gboolean error_concealment);
+
+void
+gst_vaapi_decoder_get_error_stats (GstVaapiDecoder * decoder,
+    GstVaapiDecoderErrorStats * stats);
+
 gboolean
 gst_vaapi_decoder_put_buffer (GstVaapiDecoder * decoder, GstBuffer * buf);
 
@@ -129,6 +164,9 @@ gst_vaapi_decoder_decode (GstVaapiDecoder * decoder,
 GstVaapiDecoderStatus
 gst_vaapi_decoder_flush (GstVaapiDecoder * decoder);
 
+GstVaapiDecoderStatus
+gst_vaapi_decoder_prepare (GstVaapiDecoder * decoder);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DECODER_H */
@@ -94,6 +94,7 @@ struct _GstVaapiParserInfoH264 {
     guint               flags;      // Same as decoder unit flags (persistent)
     guint               view_id;    // View ID of slice
     guint               voc;        // View order index (VOIdx) of slice
+    gboolean            is_broken;  // Slice header could not be parsed
 };
 
 static void
@@ -504,6 +505,8 @@ struct _GstVaapiDecoderH264Private {
     guint                       is_avcC                 : 1;
     guint                       has_context             : 1;
     guint                       progressive_sequence    : 1;
+    guint                       got_first_slice         : 1;
+    guint                       got_broken_slice        : 1;
 };
 
 /**
@@ -1108,6 +1111,7 @@ gst_vaapi_decoder_h264_close(GstVaapiDecoderH264 *decoder)
     gst_vaapi_picture_replace(&priv->current_picture, NULL);
     gst_vaapi_parser_info_h264_replace(&priv->prev_slice_pi, NULL);
     gst_vaapi_parser_info_h264_replace(&priv->prev_pi, NULL);
+    priv->got_broken_slice = FALSE;
 
     dpb_clear(decoder, NULL);
 
@@ -1494,6 +1498,17 @@ decode_current_picture(GstVaapiDecoderH264 *decoder)
     if (!picture)
         return GST_VAAPI_DECODER_STATUS_SUCCESS;
 
+    if (GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder) &&
+        !priv->got_first_slice) {
+        GST_WARNING("missing first slice of picture");
+        GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+    }
+    if (priv->got_broken_slice) {
+        GST_WARNING("broken slice in picture");
+        GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+        priv->got_broken_slice = FALSE;
+    }
+
     if (!gst_vaapi_picture_decode(GST_VAAPI_PICTURE_CAST(picture)))
         goto error;
     if (!exec_ref_pic_marking(decoder, picture))
@@ -1653,8 +1668,16 @@ parse_slice(GstVaapiDecoderH264 *decoder, GstVaapiDecoderUnit *unit)
 
     result = gst_h264_parser_parse_slice_hdr(priv->parser, &pi->nalu,
         slice_hdr, TRUE, TRUE);
-    if (result != GST_H264_PARSER_OK)
-        return get_status(result);
+    if (result != GST_H264_PARSER_OK) {
+        if (!GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder))
+            return get_status(result);
+
+        /* Keep the broken slice so that decode_slice() records that
+           the picture it belongs to is corrupted */
+        GST_WARNING("failed to parse slice header, concealing slice");
+        pi->is_broken = TRUE;
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    }
 
     sps = slice_hdr->pps->sequence;
 
@@ -1676,6 +1699,13 @@ decode_sps(GstVaapiDecoderH264 *decoder, GstVaapiDecoderUnit *unit)
     GST_DEBUG("decode SPS");
 
     gst_vaapi_parser_info_h264_replace(&priv->sps[sps->id], pi);
+
+    /* Allocate the VA context and surfaces from the first SPS, so that
+       this is already done by the time the first slice arrives. Errors
+       are reported later on, when the SPS is actually activated */
+    if (!priv->has_context &&
+        ensure_context(decoder, sps) != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        GST_DEBUG("failed to pre-allocate VA context from SPS");
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
@@ -2788,6 +2818,69 @@ init_picture_ref_lists(GstVaapiDecoderH264 *decoder,
     priv->long_ref_count = long_ref_count;
 }
 
+/* Returns the short-term or long-term reference picture that is the
+   closest to picture in display order, or NULL if there is none */
+static GstVaapiPictureH264 *
+find_nearest_ref(GstVaapiDecoderH264 *decoder, GstVaapiPictureH264 *picture)
+{
+    GstVaapiDecoderH264Private * const priv = &decoder->priv;
+    GstVaapiPictureH264 *pic, *nearest_pic = NULL;
+    gint32 poc_diff, min_poc_diff = G_MAXINT32;
+    guint i;
+
+    for (i = 0; i < priv->short_ref_count + priv->long_ref_count; i++) {
+        if (i < priv->short_ref_count)
+            pic = priv->short_ref[i];
+        else
+            pic = priv->long_ref[i - priv->short_ref_count];
+        poc_diff = ABS(pic->base.poc - picture->base.poc);
+        if (poc_diff < min_poc_diff) {
+            min_poc_diff = poc_diff;
+            nearest_pic = pic;
+        }
+    }
+    return nearest_pic;
+}
+
+/* Substitutes the missing entries of ref_list with the nearest
+   reference picture. Trailing entries are legitimately left empty if
+   there are fewer reference pictures than active entries, so only the
+   first entry and those followed by valid entries denote references
+   that were lost. The current picture is marked as corrupted in that
+   case, or if it is predicted from corrupted pictures */
+static void
+conceal_picture_refs(GstVaapiDecoderH264 *decoder,
+    GstVaapiPictureH264 *picture, GstVaapiPictureH264 **ref_list,
+    guint ref_list_count)
+{
+    GstVaapiPictureH264 *nearest_pic = NULL;
+    guint i, num_refs = MIN(ref_list_count, 1);
+
+    for (i = 0; i < ref_list_count; i++) {
+        if (!ref_list[i])
+            continue;
+        if (GST_VAAPI_PICTURE_IS_CORRUPTED(ref_list[i]))
+            GST_VAAPI_PICTURE_FLAG_SET(picture,
+                GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+        num_refs = i + 1;
+    }
+
+    for (i = 0; i < num_refs; i++) {
+        if (ref_list[i])
+            continue;
+
+        GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+        if (!nearest_pic)
+            nearest_pic = find_nearest_ref(decoder, picture);
+        if (!nearest_pic)
+            break;
+        GST_DEBUG("substituting missing reference %u with POC %d", i,
+            nearest_pic->base.poc);
+        ref_list[i] = nearest_pic;
+        gst_vaapi_decoder_count_concealed_ref(GST_VAAPI_DECODER_CAST(decoder));
+    }
+}
+
 static void
 init_picture_refs(
     GstVaapiDecoderH264 *decoder,
@@ -2836,6 +2929,29 @@ init_picture_refs(
     default:
         break;
     }
+
+    if (GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder)) {
+        conceal_picture_refs(decoder, picture,
+            priv->RefPicList0, priv->RefPicList0_count);
+        conceal_picture_refs(decoder, picture,
+            priv->RefPicList1, priv->RefPicList1_count);
+    }
+}
+
+/* Checks whether frames were lost since the previous picture, i.e. if
+   frame_num is neither the previous value nor the next one while gaps
+   are not allowed (7.4.3) */
+static gboolean
+is_frame_num_gap(GstVaapiDecoderH264 *decoder, GstH264SliceHdr *slice_hdr)
+{
+    GstVaapiDecoderH264Private * const priv = &decoder->priv;
+    GstH264SPS * const sps = get_sps(decoder);
+    const gint32 MaxFrameNum = 1 << (sps->log2_max_frame_num_minus4 + 4);
+
+    if (sps->gaps_in_frame_num_value_allowed_flag)
+        return FALSE;
+    return slice_hdr->frame_num != priv->prev_frame_num &&
+        slice_hdr->frame_num != (priv->prev_frame_num + 1) % MaxFrameNum;
 }
 
 static gboolean
@@ -2879,6 +2995,12 @@ init_picture(
         GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_IDR);
         dpb_flush(decoder, picture);
     }
+    else if (GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder) &&
+             is_frame_num_gap(decoder, slice_hdr)) {
+        GST_WARNING("missing reference frames before frame_num %d",
+            priv->frame_num);
+        GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+    }
 
     /* Initialize picture structure */
     if (!slice_hdr->field_pic_flag)
@@ -3483,6 +3605,7 @@ decode_picture(GstVaapiDecoderH264 *decoder, GstVaapiDecoderUnit *unit)
         return status;
 
     priv->decoder_state = 0;
+    priv->got_first_slice = FALSE;
 
     first_field = find_first_field(decoder, pi);
     if (first_field) {
@@ -3696,6 +3819,13 @@ decode_slice(GstVaapiDecoderH264 *decoder, GstVaapiDecoderUnit *unit)
 
     GST_DEBUG("slice (%u bytes)", pi->nalu.size);
 
+    /* Broken slices are not slice data units, so they are decoded
+       before the picture of the frame they belong to is even started */
+    if (pi->is_broken) {
+        priv->got_broken_slice = TRUE;
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    }
+
     if (!is_valid_state(pi->state,
             GST_H264_VIDEO_STATE_VALID_PICTURE_HEADERS)) {
         GST_WARNING("failed to receive enough headers to decode slice");
@@ -3739,6 +3869,8 @@ decode_slice(GstVaapiDecoderH264 *decoder, GstVaapiDecoderUnit *unit)
 
     gst_vaapi_picture_add_slice(GST_VAAPI_PICTURE_CAST(picture), slice);
     picture->last_slice_hdr = slice_hdr;
+    if (slice_hdr->first_mb_in_slice == 0)
+        priv->got_first_slice = TRUE;
     priv->decoder_state |= GST_H264_VIDEO_STATE_GOT_SLICE;
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
@@ -3903,6 +4035,15 @@ ensure_decoder(GstVaapiDecoderH264 *decoder)
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h264_prepare(GstVaapiDecoder *base_decoder)
+{
+    GstVaapiDecoderH264 * const decoder =
+        GST_VAAPI_DECODER_H264_CAST(base_decoder);
+
+    return ensure_decoder(decoder);
+}
+
 static GstVaapiDecoderStatus
 gst_vaapi_decoder_h264_parse(GstVaapiDecoder *base_decoder,
     GstAdapter *adapter, gboolean at_eos, GstVaapiDecoderUnit *unit)
@@ -4078,6 +4219,9 @@ gst_vaapi_decoder_h264_parse(GstVaapiDecoder *base_decoder,
         /* fall-through */
     case GST_H264_NAL_SLICE_IDR:
     case GST_H264_NAL_SLICE:
+        /* Broken slices are left within the current frame */
+        if (pi->is_broken)
+            break;
         flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
         if (priv->prev_pi &&
             (priv->prev_pi->flags & GST_VAAPI_DECODER_UNIT_FLAG_AU_END)) {
@@ -4182,6 +4326,7 @@ gst_vaapi_decoder_h264_class_init(GstVaapiDecoderH264Class *klass)
 
     decoder_class->decode_codec_data =
         gst_vaapi_decoder_h264_decode_codec_data;
+    decoder_class->prepare      = gst_vaapi_decoder_h264_prepare;
 }
 
 static inline const GstVaapiDecoderClass *
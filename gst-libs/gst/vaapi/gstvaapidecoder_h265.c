@@ -0,0 +1,2476 @@
+/*
+ *  gstvaapidecoder_h265.c - H.265 decoder
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapidecoder_h265
+ * @short_description: H.265 decoder
+ */
+
+#include "sysdeps.h"
+#include <string.h>
+#include <gst/base/gstadapter.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include "gstvaapidecoder_h265.h"
+#include "gstvaapidecoder_objects.h"
+#include "gstvaapidecoder_priv.h"
+#include "gstvaapidisplay_priv.h"
+#include "gstvaapiobject_priv.h"
+#include "gstvaapiutils_h265_priv.h"
+
+#include "gstvaapicompat.h"
+#ifdef HAVE_VA_VA_DEC_HEVC_H
+#include <va/va_dec_hevc.h>
+#endif
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+typedef struct _GstVaapiDecoderH265Private      GstVaapiDecoderH265Private;
+typedef struct _GstVaapiDecoderH265Class        GstVaapiDecoderH265Class;
+typedef struct _GstVaapiParserInfoH265          GstVaapiParserInfoH265;
+typedef struct _GstVaapiPictureH265             GstVaapiPictureH265;
+
+/* Maximum number of entries in ReferenceFrames[] and RefPicList[] */
+#define MAX_REF_FRAMES  15
+
+/* ------------------------------------------------------------------------- */
+/* --- H.265 NAL unit types                                              --- */
+/* ------------------------------------------------------------------------- */
+
+/* Determines whether the NAL unit holds a slice segment (Table 7-1) */
+static inline gboolean
+nal_is_slice(guint8 nal_type)
+{
+    return nal_type <= GST_H265_NAL_SLICE_RASL_R ||
+        (nal_type >= GST_H265_NAL_SLICE_BLA_W_LP &&
+         nal_type <= GST_H265_NAL_SLICE_CRA_NUT);
+}
+
+/* Intra random access point (IRAP) picture, including reserved types */
+static inline gboolean
+nal_is_irap(guint8 nal_type)
+{
+    return nal_type >= GST_H265_NAL_SLICE_BLA_W_LP && nal_type <= 23;
+}
+
+static inline gboolean
+nal_is_idr(guint8 nal_type)
+{
+    return nal_type == GST_H265_NAL_SLICE_IDR_W_RADL ||
+        nal_type == GST_H265_NAL_SLICE_IDR_N_LP;
+}
+
+static inline gboolean
+nal_is_bla(guint8 nal_type)
+{
+    return nal_type >= GST_H265_NAL_SLICE_BLA_W_LP &&
+        nal_type <= GST_H265_NAL_SLICE_BLA_N_LP;
+}
+
+static inline gboolean
+nal_is_radl(guint8 nal_type)
+{
+    return nal_type == GST_H265_NAL_SLICE_RADL_N ||
+        nal_type == GST_H265_NAL_SLICE_RADL_R;
+}
+
+static inline gboolean
+nal_is_rasl(guint8 nal_type)
+{
+    return nal_type == GST_H265_NAL_SLICE_RASL_N ||
+        nal_type == GST_H265_NAL_SLICE_RASL_R;
+}
+
+/* Sub-layer non-reference picture, i.e. TRAIL_N, TSA_N, etc. */
+static inline gboolean
+nal_is_slnr(guint8 nal_type)
+{
+    return nal_type <= 14 && !(nal_type & 1);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- H.265 Parser Info                                                 --- */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Extended decoder unit flags:
+ *
+ * @GST_VAAPI_DECODER_UNIT_AU_START: marks the start of an access unit.
+ * @GST_VAAPI_DECODER_UNIT_AU_END: marks the end of an access unit.
+ */
+enum {
+    GST_VAAPI_DECODER_UNIT_FLAG_AU_START = (
+        GST_VAAPI_DECODER_UNIT_FLAG_LAST << 0),
+    GST_VAAPI_DECODER_UNIT_FLAG_AU_END = (
+        GST_VAAPI_DECODER_UNIT_FLAG_LAST << 1),
+
+    GST_VAAPI_DECODER_UNIT_FLAGS_AU = (
+        GST_VAAPI_DECODER_UNIT_FLAG_AU_START |
+        GST_VAAPI_DECODER_UNIT_FLAG_AU_END),
+};
+
+#define GST_VAAPI_PARSER_INFO_H265(obj) \
+    ((GstVaapiParserInfoH265 *)(obj))
+
+struct _GstVaapiParserInfoH265 {
+    GstVaapiMiniObject  parent_instance;
+    GstH265NalUnit      nalu;
+    union {
+        GstH265VPS      vps;
+        GstH265SPS      sps;
+        GstH265PPS      pps;
+        GArray         *sei;
+        GstH265SliceHdr slice_hdr;
+    }                   data;
+    guint               state;
+    guint               flags;      // Same as decoder unit flags (persistent)
+};
+
+static void
+gst_vaapi_parser_info_h265_finalize(GstVaapiParserInfoH265 *pi)
+{
+    switch (pi->nalu.type) {
+    case GST_H265_NAL_PREFIX_SEI:
+    case GST_H265_NAL_SUFFIX_SEI:
+        if (pi->data.sei) {
+            g_array_unref(pi->data.sei);
+            pi->data.sei = NULL;
+        }
+        break;
+    }
+}
+
+static inline const GstVaapiMiniObjectClass *
+gst_vaapi_parser_info_h265_class(void)
+{
+    static const GstVaapiMiniObjectClass GstVaapiParserInfoH265Class = {
+        .size = sizeof(GstVaapiParserInfoH265),
+        .finalize = (GDestroyNotify)gst_vaapi_parser_info_h265_finalize
+    };
+    return &GstVaapiParserInfoH265Class;
+}
+
+static inline GstVaapiParserInfoH265 *
+gst_vaapi_parser_info_h265_new(void)
+{
+    return (GstVaapiParserInfoH265 *)
+        gst_vaapi_mini_object_new(gst_vaapi_parser_info_h265_class());
+}
+
+#define gst_vaapi_parser_info_h265_ref(pi) \
+    gst_vaapi_mini_object_ref(GST_VAAPI_MINI_OBJECT(pi))
+
+#define gst_vaapi_parser_info_h265_unref(pi) \
+    gst_vaapi_mini_object_unref(GST_VAAPI_MINI_OBJECT(pi))
+
+#define gst_vaapi_parser_info_h265_replace(old_pi_ptr, new_pi)          \
+    gst_vaapi_mini_object_replace((GstVaapiMiniObject **)(old_pi_ptr),  \
+        (GstVaapiMiniObject *)(new_pi))
+
+/* ------------------------------------------------------------------------- */
+/* --- H.265 Pictures                                                    --- */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Extended picture flags:
+ *
+ * @GST_VAAPI_PICTURE_FLAG_IDR: flag that specifies an IDR picture
+ * @GST_VAAPI_PICTURE_FLAG_IRAP: flag that specifies an intra random
+ *   access point (IRAP) picture, i.e. an IDR, CRA or BLA picture
+ * @GST_VAAPI_PICTURE_FLAG_SHORT_TERM_REFERENCE: flag that specifies
+ *     "used for short-term reference"
+ * @GST_VAAPI_PICTURE_FLAG_LONG_TERM_REFERENCE: flag that specifies
+ *     "used for long-term reference"
+ * @GST_VAAPI_PICTURE_FLAGS_REFERENCE: mask covering any kind of
+ *     reference picture (short-term reference or long-term reference)
+ */
+enum {
+    GST_VAAPI_PICTURE_FLAG_IDR          = (GST_VAAPI_PICTURE_FLAG_LAST << 0),
+    GST_VAAPI_PICTURE_FLAG_REFERENCE2   = (GST_VAAPI_PICTURE_FLAG_LAST << 1),
+    GST_VAAPI_PICTURE_FLAG_IRAP         = (GST_VAAPI_PICTURE_FLAG_LAST << 2),
+
+    GST_VAAPI_PICTURE_FLAG_SHORT_TERM_REFERENCE = (
+        GST_VAAPI_PICTURE_FLAG_REFERENCE),
+    GST_VAAPI_PICTURE_FLAG_LONG_TERM_REFERENCE = (
+        GST_VAAPI_PICTURE_FLAG_REFERENCE | GST_VAAPI_PICTURE_FLAG_REFERENCE2),
+    GST_VAAPI_PICTURE_FLAGS_REFERENCE = (
+        GST_VAAPI_PICTURE_FLAG_SHORT_TERM_REFERENCE |
+        GST_VAAPI_PICTURE_FLAG_LONG_TERM_REFERENCE),
+};
+
+#define GST_VAAPI_PICTURE_IS_IDR(picture) \
+    (GST_VAAPI_PICTURE_FLAG_IS_SET(picture, GST_VAAPI_PICTURE_FLAG_IDR))
+
+#define GST_VAAPI_PICTURE_IS_IRAP(picture) \
+    (GST_VAAPI_PICTURE_FLAG_IS_SET(picture, GST_VAAPI_PICTURE_FLAG_IRAP))
+
+#define GST_VAAPI_PICTURE_IS_SHORT_TERM_REFERENCE(picture)      \
+    ((GST_VAAPI_PICTURE_FLAGS(picture) &                        \
+      GST_VAAPI_PICTURE_FLAGS_REFERENCE) ==                     \
+     GST_VAAPI_PICTURE_FLAG_SHORT_TERM_REFERENCE)
+
+#define GST_VAAPI_PICTURE_IS_LONG_TERM_REFERENCE(picture)       \
+    ((GST_VAAPI_PICTURE_FLAGS(picture) &                        \
+      GST_VAAPI_PICTURE_FLAGS_REFERENCE) ==                     \
+     GST_VAAPI_PICTURE_FLAG_LONG_TERM_REFERENCE)
+
+#define GST_VAAPI_PICTURE_H265(picture) \
+    ((GstVaapiPictureH265 *)(picture))
+
+struct _GstVaapiPictureH265 {
+    GstVaapiPicture             base;
+    gint32                      poc_lsb;                // slice_pic_order_cnt_lsb
+    guint                       pic_latency_cnt;        // PicLatencyCount
+    guint                       output_flag             : 1; // PicOutputFlag
+    guint                       output_needed           : 1;
+    guint                       NoRaslOutputFlag        : 1;
+};
+
+GST_VAAPI_CODEC_DEFINE_TYPE(GstVaapiPictureH265, gst_vaapi_picture_h265);
+
+void
+gst_vaapi_picture_h265_destroy(GstVaapiPictureH265 *picture)
+{
+    gst_vaapi_picture_destroy(GST_VAAPI_PICTURE(picture));
+}
+
+gboolean
+gst_vaapi_picture_h265_create(
+    GstVaapiPictureH265                      *picture,
+    const GstVaapiCodecObjectConstructorArgs *args
+)
+{
+    if (!gst_vaapi_picture_create(GST_VAAPI_PICTURE(picture), args))
+        return FALSE;
+
+    picture->pic_latency_cnt    = 0;
+    picture->output_needed      = FALSE;
+    picture->NoRaslOutputFlag   = FALSE;
+    return TRUE;
+}
+
+static inline GstVaapiPictureH265 *
+gst_vaapi_picture_h265_new(GstVaapiDecoderH265 *decoder)
+{
+    return (GstVaapiPictureH265 *)gst_vaapi_codec_object_new(
+        &GstVaapiPictureH265Class,
+        GST_VAAPI_CODEC_BASE(decoder),
+        NULL, sizeof(VAPictureParameterBufferHEVC),
+        NULL, 0,
+        0);
+}
+
+static inline void
+gst_vaapi_picture_h265_set_reference(
+    GstVaapiPictureH265 *picture,
+    guint                reference_flags
+)
+{
+    if (!picture)
+        return;
+    GST_VAAPI_PICTURE_FLAG_UNSET(picture, GST_VAAPI_PICTURE_FLAGS_REFERENCE);
+    GST_VAAPI_PICTURE_FLAG_SET(picture, reference_flags);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- H.265 Decoder                                                     --- */
+/* ------------------------------------------------------------------------- */
+
+#define GST_VAAPI_DECODER_H265_CAST(decoder) \
+    ((GstVaapiDecoderH265 *)(decoder))
+
+typedef enum {
+    GST_H265_VIDEO_STATE_GOT_SPS        = 1 << 0,
+    GST_H265_VIDEO_STATE_GOT_PPS        = 1 << 1,
+    GST_H265_VIDEO_STATE_GOT_SLICE      = 1 << 2,
+
+    GST_H265_VIDEO_STATE_VALID_PICTURE_HEADERS = (
+        GST_H265_VIDEO_STATE_GOT_SPS |
+        GST_H265_VIDEO_STATE_GOT_PPS),
+    GST_H265_VIDEO_STATE_VALID_PICTURE = (
+        GST_H265_VIDEO_STATE_VALID_PICTURE_HEADERS |
+        GST_H265_VIDEO_STATE_GOT_SLICE)
+} GstH265VideoState;
+
+struct _GstVaapiDecoderH265Private {
+    GstH265Parser              *parser;
+    guint                       parser_state;
+    guint                       decoder_state;
+    GstVaapiStreamAlignH265     stream_alignment;
+    GstVaapiPictureH265        *current_picture;
+    GstVaapiParserInfoH265     *vps[GST_H265_MAX_VPS_COUNT];
+    GstVaapiParserInfoH265     *sps[GST_H265_MAX_SPS_COUNT];
+    GstVaapiParserInfoH265     *active_sps;
+    GstVaapiParserInfoH265     *pps[GST_H265_MAX_PPS_COUNT];
+    GstVaapiParserInfoH265     *active_pps;
+    GstVaapiParserInfoH265     *prev_pi;
+    GstVaapiParserInfoH265     *prev_slice_pi;
+    GstVaapiParserInfoH265     *prev_independent_slice_pi;
+    GstVaapiPictureH265       **dpb;
+    guint                       dpb_count;
+    guint                       dpb_size;
+    guint                       dpb_size_max;
+    GstVaapiProfile             profile;
+    GstVaapiEntrypoint          entrypoint;
+    GstVaapiChromaType          chroma_type;
+    GstVaapiH265RefPicSet       rps;
+    /* Reference pictures of the current picture, NULL if missing */
+    GstVaapiPictureH265        *RefPicSetStCurrBefore[GST_VAAPI_H265_MAX_RPS_PICS];
+    GstVaapiPictureH265        *RefPicSetStCurrAfter[GST_VAAPI_H265_MAX_RPS_PICS];
+    GstVaapiPictureH265        *RefPicSetStFoll[GST_VAAPI_H265_MAX_RPS_PICS];
+    GstVaapiPictureH265        *RefPicSetLtCurr[GST_VAAPI_H265_MAX_RPS_PICS];
+    GstVaapiPictureH265        *RefPicSetLtFoll[GST_VAAPI_H265_MAX_RPS_PICS];
+    GstVaapiH265PocState        poc_state;
+    guint                       nal_length_size;
+    guint                       pic_width;
+    guint                       pic_height;
+    guint                       is_opened               : 1;
+    guint                       is_hvcC                 : 1;
+    guint                       has_context             : 1;
+    /* Set until the first picture after the start of the stream, or
+       after an end of sequence NAL unit (HandleCraAsBlaFlag) */
+    guint                       new_bitstream           : 1;
+    guint                       associated_irap_NoRaslOutputFlag : 1;
+};
+
+/**
+ * GstVaapiDecoderH265:
+ *
+ * A decoder based on H265.
+ */
+struct _GstVaapiDecoderH265 {
+    /*< private >*/
+    GstVaapiDecoder             parent_instance;
+    GstVaapiDecoderH265Private  priv;
+};
+
+/**
+ * GstVaapiDecoderH265Class:
+ *
+ * A decoder class based on H265.
+ */
+struct _GstVaapiDecoderH265Class {
+    /*< private >*/
+    GstVaapiDecoderClass parent_class;
+};
+
+/* Get number of reference frames to use */
+static guint
+get_max_dec_pic_buffering(GstH265SPS *sps)
+{
+    const guint HighestTid = sps->max_sub_layers_minus1;
+
+    return MAX(1, sps->max_dec_pic_buffering_minus1[HighestTid] + 1);
+}
+
+/* Computes PicWidthInCtbsY and PicHeightInCtbsY (7-15, 7-17) */
+static void
+get_pic_size_in_ctbs(GstH265SPS *sps, guint *width_ptr, guint *height_ptr)
+{
+    const guint CtbLog2SizeY = sps->log2_min_luma_coding_block_size_minus3 +
+        3 + sps->log2_diff_max_min_luma_coding_block_size;
+    const guint CtbSizeY = 1 << CtbLog2SizeY;
+
+    *width_ptr = (sps->pic_width_in_luma_samples + CtbSizeY - 1) >>
+        CtbLog2SizeY;
+    *height_ptr = (sps->pic_height_in_luma_samples + CtbSizeY - 1) >>
+        CtbLog2SizeY;
+}
+
+static void
+dpb_remove_index(GstVaapiDecoderH265 *decoder, guint index)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    const guint num_pictures = --priv->dpb_count;
+
+    if (index != num_pictures)
+        gst_vaapi_picture_replace(&priv->dpb[index], priv->dpb[num_pictures]);
+    gst_vaapi_picture_replace(&priv->dpb[num_pictures], NULL);
+}
+
+static gboolean
+dpb_output(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture)
+{
+    picture->output_needed = FALSE;
+    return gst_vaapi_picture_output(GST_VAAPI_PICTURE_CAST(picture));
+}
+
+static inline void
+dpb_evict(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture, guint i)
+{
+    if (!picture->output_needed && !GST_VAAPI_PICTURE_IS_REFERENCE(picture))
+        dpb_remove_index(decoder, i);
+}
+
+/* Finds the picture with the lowest POC that needs to be output */
+static gint
+dpb_find_lowest_poc(GstVaapiDecoderH265 *decoder,
+    GstVaapiPictureH265 **found_picture_ptr)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiPictureH265 *found_picture = NULL;
+    guint i, found_index;
+
+    for (i = 0; i < priv->dpb_count; i++) {
+        GstVaapiPictureH265 * const pic = priv->dpb[i];
+        if (!pic->output_needed)
+            continue;
+        if (!found_picture || found_picture->base.poc > pic->base.poc)
+            found_picture = pic, found_index = i;
+    }
+
+    if (found_picture_ptr)
+        *found_picture_ptr = found_picture;
+    return found_picture ? found_index : -1;
+}
+
+/* C.5.2.4 - "Bumping" process */
+static gboolean
+dpb_bump(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiPictureH265 *found_picture;
+    gint found_index;
+    gboolean success;
+
+    found_index = dpb_find_lowest_poc(decoder, &found_picture);
+    if (found_index < 0)
+        return FALSE;
+
+    success = dpb_output(decoder, found_picture);
+    dpb_evict(decoder, found_picture, found_index);
+    return success;
+}
+
+static void
+dpb_clear(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    guint i;
+
+    for (i = 0; i < priv->dpb_count; i++)
+        gst_vaapi_picture_replace(&priv->dpb[i], NULL);
+    priv->dpb_count = 0;
+}
+
+static void
+dpb_flush(GstVaapiDecoderH265 *decoder)
+{
+    /* Output any frame remaining in DPB */
+    while (dpb_bump(decoder))
+        ;
+    dpb_clear(decoder);
+}
+
+/* Checks whether the "bumping" process shall be invoked (C.5.2.2). The
+   DPB fullness is only checked before the current picture is decoded */
+static gboolean
+dpb_needs_bumping(GstVaapiDecoderH265 *decoder, GstH265SPS *sps,
+    gboolean check_fullness)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    const guint HighestTid = sps->max_sub_layers_minus1;
+    const guint max_num_reorder = sps->max_num_reorder_pics[HighestTid];
+    const guint max_latency_increase_plus1 =
+        sps->max_latency_increase_plus1[HighestTid];
+    guint i, num_output_needed = 0;
+
+    for (i = 0; i < priv->dpb_count; i++) {
+        GstVaapiPictureH265 * const pic = priv->dpb[i];
+        if (!pic->output_needed)
+            continue;
+        num_output_needed++;
+
+        /* PicLatencyCount >= SpsMaxLatencyPictures (7-9) */
+        if (max_latency_increase_plus1 && pic->pic_latency_cnt >=
+            max_num_reorder + max_latency_increase_plus1 - 1)
+            return TRUE;
+    }
+    if (num_output_needed > max_num_reorder)
+        return TRUE;
+    return check_fullness && priv->dpb_count >= get_max_dec_pic_buffering(sps);
+}
+
+/* C.5.2.2 - Output and removal of pictures from the DPB */
+static void
+dpb_prepare(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstH265SPS * const sps = &priv->active_sps->data.sps;
+    guint i;
+
+    /* NoOutputOfPriorPicsFlag is not honoured, i.e. prior pictures are
+       always output so that their frames are released downstream */
+    if (GST_VAAPI_PICTURE_IS_IRAP(picture) && picture->NoRaslOutputFlag) {
+        dpb_flush(decoder);
+        return;
+    }
+
+    // Remove all unused pictures
+    i = 0;
+    while (i < priv->dpb_count) {
+        GstVaapiPictureH265 * const pic = priv->dpb[i];
+        if (!pic->output_needed && !GST_VAAPI_PICTURE_IS_REFERENCE(pic))
+            dpb_remove_index(decoder, i);
+        else
+            i++;
+    }
+
+    while (dpb_needs_bumping(decoder, sps, TRUE)) {
+        if (!dpb_bump(decoder))
+            break;
+    }
+}
+
+/* C.5.2.3 - Picture decoding, marking, additional bumping and storage */
+static gboolean
+dpb_add(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstH265SPS * const sps = &priv->active_sps->data.sps;
+    guint i;
+
+    if (picture->output_flag) {
+        for (i = 0; i < priv->dpb_count; i++) {
+            if (priv->dpb[i]->output_needed)
+                priv->dpb[i]->pic_latency_cnt++;
+        }
+        picture->output_needed = TRUE;
+        picture->pic_latency_cnt = 0;
+    }
+    else {
+        /* The picture is only kept for reference, so release its frame
+           right away */
+        GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_SKIPPED);
+        if (!gst_vaapi_picture_output(GST_VAAPI_PICTURE_CAST(picture)))
+            return FALSE;
+    }
+
+    if (priv->dpb_count == priv->dpb_size_max) {
+        GST_ERROR("DPB overflow (%u pictures)", priv->dpb_count);
+        return FALSE;
+    }
+    gst_vaapi_picture_replace(&priv->dpb[priv->dpb_count++], picture);
+
+    while (dpb_needs_bumping(decoder, sps, FALSE)) {
+        if (!dpb_bump(decoder))
+            break;
+    }
+    return TRUE;
+}
+
+static gboolean
+dpb_reset(GstVaapiDecoderH265 *decoder, guint dpb_size)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+
+    if (dpb_size > priv->dpb_size_max) {
+        priv->dpb = g_try_realloc_n(priv->dpb, dpb_size, sizeof(*priv->dpb));
+        if (!priv->dpb)
+            return FALSE;
+        memset(&priv->dpb[priv->dpb_size_max], 0,
+            (dpb_size - priv->dpb_size_max) * sizeof(*priv->dpb));
+        priv->dpb_size_max = dpb_size;
+    }
+    priv->dpb_size = dpb_size;
+
+    GST_DEBUG("DPB size %u", priv->dpb_size);
+    return TRUE;
+}
+
+static GstVaapiDecoderStatus
+get_status(GstH265ParserResult result)
+{
+    GstVaapiDecoderStatus status;
+
+    switch (result) {
+    case GST_H265_PARSER_OK:
+        status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+        break;
+    case GST_H265_PARSER_NO_NAL_END:
+        status = GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+        break;
+    case GST_H265_PARSER_ERROR:
+        status = GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+        break;
+    default:
+        status = GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+        break;
+    }
+    return status;
+}
+
+static void
+gst_vaapi_decoder_h265_close(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+
+    gst_vaapi_picture_replace(&priv->current_picture, NULL);
+    gst_vaapi_parser_info_h265_replace(&priv->prev_independent_slice_pi, NULL);
+    gst_vaapi_parser_info_h265_replace(&priv->prev_slice_pi, NULL);
+    gst_vaapi_parser_info_h265_replace(&priv->prev_pi, NULL);
+
+    dpb_clear(decoder);
+
+    if (priv->parser) {
+        gst_h265_parser_free(priv->parser);
+        priv->parser = NULL;
+    }
+}
+
+static gboolean
+gst_vaapi_decoder_h265_open(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+
+    gst_vaapi_decoder_h265_close(decoder);
+
+    priv->parser = gst_h265_parser_new();
+    if (!priv->parser)
+        return FALSE;
+    return TRUE;
+}
+
+static void
+gst_vaapi_decoder_h265_destroy(GstVaapiDecoder *base_decoder)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    guint i;
+
+    gst_vaapi_decoder_h265_close(decoder);
+
+    g_free(priv->dpb);
+    priv->dpb = NULL;
+    priv->dpb_size = 0;
+    priv->dpb_size_max = 0;
+
+    for (i = 0; i < G_N_ELEMENTS(priv->pps); i++)
+        gst_vaapi_parser_info_h265_replace(&priv->pps[i], NULL);
+    gst_vaapi_parser_info_h265_replace(&priv->active_pps, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS(priv->sps); i++)
+        gst_vaapi_parser_info_h265_replace(&priv->sps[i], NULL);
+    gst_vaapi_parser_info_h265_replace(&priv->active_sps, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS(priv->vps); i++)
+        gst_vaapi_parser_info_h265_replace(&priv->vps[i], NULL);
+}
+
+static gboolean
+gst_vaapi_decoder_h265_create(GstVaapiDecoder *base_decoder)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+
+    priv->profile               = GST_VAAPI_PROFILE_UNKNOWN;
+    priv->entrypoint            = GST_VAAPI_ENTRYPOINT_VLD;
+    priv->chroma_type           = GST_VAAPI_CHROMA_TYPE_YUV420;
+    priv->new_bitstream         = TRUE;
+    gst_vaapi_utils_h265_poc_init(&priv->poc_state);
+    return TRUE;
+}
+
+/* Activates the supplied PPS */
+static GstH265PPS *
+ensure_pps(GstVaapiDecoderH265 *decoder, GstH265PPS *pps)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = priv->pps[pps->id];
+
+    gst_vaapi_parser_info_h265_replace(&priv->active_pps, pi);
+    return pi ? &pi->data.pps : NULL;
+}
+
+/* Returns the active PPS */
+static inline GstH265PPS *
+get_pps(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiParserInfoH265 * const pi = decoder->priv.active_pps;
+
+    return pi ? &pi->data.pps : NULL;
+}
+
+/* Activate the supplied SPS */
+static GstH265SPS *
+ensure_sps(GstVaapiDecoderH265 *decoder, GstH265SPS *sps)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = priv->sps[sps->id];
+
+    gst_vaapi_parser_info_h265_replace(&priv->active_sps, pi);
+    return pi ? &pi->data.sps : NULL;
+}
+
+/* Returns the active SPS */
+static inline GstH265SPS *
+get_sps(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiParserInfoH265 * const pi = decoder->priv.active_sps;
+
+    return pi ? &pi->data.sps : NULL;
+}
+
+static void
+fill_profiles(GstVaapiProfile profiles[16], guint *n_profiles_ptr,
+    GstVaapiProfile profile)
+{
+    guint n_profiles = *n_profiles_ptr;
+
+    profiles[n_profiles++] = profile;
+    *n_profiles_ptr = n_profiles;
+}
+
+static GstVaapiProfile
+get_profile(GstVaapiDecoderH265 *decoder, GstH265SPS *sps)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiDisplay * const display = GST_VAAPI_DECODER_DISPLAY(decoder);
+    GstH265ProfileTierLevel * const ptl = &sps->profile_tier_level;
+    GstVaapiProfile profile, profiles[4];
+    guint i, n_profiles = 0;
+
+    profile = gst_vaapi_utils_h265_get_profile(ptl->profile_idc);
+    if (!profile) {
+        /* general_profile_idc may be left to zero if the matching
+           general_profile_compatibility_flag[] is set (A.3) */
+        if (ptl->profile_compatibility_flag[1])
+            profile = GST_VAAPI_PROFILE_H265_MAIN;
+        else if (ptl->profile_compatibility_flag[2])
+            profile = GST_VAAPI_PROFILE_H265_MAIN10;
+        else
+            return GST_VAAPI_PROFILE_UNKNOWN;
+    }
+
+    fill_profiles(profiles, &n_profiles, profile);
+    switch (profile) {
+    case GST_VAAPI_PROFILE_H265_MAIN10:
+        /* 8-bit streams conforming to the Main 10 profile are also
+           decodable as Main profile streams (A.3.3) */
+        if (sps->bit_depth_luma_minus8 == 0 &&
+            sps->bit_depth_chroma_minus8 == 0) {
+            fill_profiles(profiles, &n_profiles,
+                GST_VAAPI_PROFILE_H265_MAIN);
+        }
+        break;
+    case GST_VAAPI_PROFILE_H265_MAIN_STILL_PICTURE:
+        /* A Main Still Picture stream is a Main stream (A.3.4) */
+        fill_profiles(profiles, &n_profiles, GST_VAAPI_PROFILE_H265_MAIN);
+        break;
+    default:
+        break;
+    }
+
+    /* If the preferred profile (profiles[0]) matches one that we already
+       found, then just return it now instead of searching for it again */
+    if (profiles[0] == priv->profile)
+        return priv->profile;
+
+    for (i = 0; i < n_profiles; i++) {
+        if (gst_vaapi_display_has_decoder(display, profiles[i], priv->entrypoint))
+            return profiles[i];
+    }
+    return GST_VAAPI_PROFILE_UNKNOWN;
+}
+
+static GstVaapiDecoderStatus
+ensure_context(GstVaapiDecoderH265 *decoder, GstH265SPS *sps)
+{
+    GstVaapiDecoder * const base_decoder = GST_VAAPI_DECODER_CAST(decoder);
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiContextInfo info;
+    GstVaapiProfile profile;
+    GstVaapiChromaType chroma_type;
+    gboolean reset_context = FALSE;
+    guint dpb_size;
+
+    dpb_size = get_max_dec_pic_buffering(sps);
+    if (priv->dpb_size < dpb_size) {
+        GST_DEBUG("DPB size increased");
+        reset_context = TRUE;
+    }
+
+    profile = get_profile(decoder, sps);
+    if (!profile) {
+        GST_ERROR("unsupported profile_idc %u",
+            sps->profile_tier_level.profile_idc);
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    }
+
+    if (!priv->profile || priv->profile != profile) {
+        GST_DEBUG("profile changed");
+        reset_context = TRUE;
+        priv->profile = profile;
+    }
+
+    chroma_type = gst_vaapi_utils_h265_get_chroma_type(sps->chroma_format_idc);
+    if (!chroma_type) {
+        GST_ERROR("unsupported chroma_format_idc %u", sps->chroma_format_idc);
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNSUPPORTED_CHROMA_FORMAT;
+    }
+
+    if (priv->chroma_type != chroma_type) {
+        GST_DEBUG("chroma format changed");
+        reset_context     = TRUE;
+        priv->chroma_type = chroma_type;
+    }
+
+    if (priv->pic_width != sps->width || priv->pic_height != sps->height) {
+        GST_DEBUG("size changed");
+        reset_context    = TRUE;
+        priv->pic_width  = sps->width;
+        priv->pic_height = sps->height;
+    }
+
+    gst_vaapi_decoder_set_pixel_aspect_ratio(
+        base_decoder,
+        sps->vui_params.par_n,
+        sps->vui_params.par_d
+    );
+
+    if (!reset_context && priv->has_context)
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+    info.profile    = priv->profile;
+    info.entrypoint = priv->entrypoint;
+    info.chroma_type = priv->chroma_type;
+    info.width      = sps->width;
+    info.height     = sps->height;
+    info.ref_frames = dpb_size;
+
+    if (!gst_vaapi_decoder_ensure_context(GST_VAAPI_DECODER(decoder), &info))
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    priv->has_context = TRUE;
+
+    /* Reset DPB */
+    if (!dpb_reset(decoder, dpb_size))
+        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+ensure_quant_matrix(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture)
+{
+    GstVaapiPicture * const base_picture = &picture->base;
+    GstH265PPS * const pps = get_pps(decoder);
+    GstH265SPS * const sps = get_sps(decoder);
+    GstH265ScalingList *scaling_list;
+    VAIQMatrixBufferHEVC *iq_matrix;
+    guint i;
+
+    /* Flat scaling lists are implied otherwise */
+    if (!sps->scaling_list_enabled_flag)
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+    base_picture->iq_matrix = GST_VAAPI_IQ_MATRIX_NEW(HEVC, decoder);
+    if (!base_picture->iq_matrix) {
+        GST_ERROR("failed to allocate IQ matrix");
+        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+    iq_matrix = base_picture->iq_matrix->param;
+
+    /* The PPS lists override the SPS ones. The parser also fills in the
+       PPS lists with the default ones (Table 7-5, 7-6) if the SPS has
+       scaling lists enabled but none is transmitted */
+    if (pps->scaling_list_data_present_flag ||
+        !sps->scaling_list_data_present_flag)
+        scaling_list = &pps->scaling_list;
+    else
+        scaling_list = &sps->scaling_list;
+
+    for (i = 0; i < G_N_ELEMENTS(iq_matrix->ScalingList4x4); i++)
+        gst_vaapi_utils_h265_scaling_list_4x4_to_raster(
+            iq_matrix->ScalingList4x4[i], scaling_list->scaling_lists_4x4[i]);
+
+    for (i = 0; i < G_N_ELEMENTS(iq_matrix->ScalingList8x8); i++)
+        gst_vaapi_utils_h265_scaling_list_8x8_to_raster(
+            iq_matrix->ScalingList8x8[i], scaling_list->scaling_lists_8x8[i]);
+
+    /* 16x16 and 32x32 lists are upsampled from 8x8 coefficients */
+    for (i = 0; i < G_N_ELEMENTS(iq_matrix->ScalingList16x16); i++) {
+        gst_vaapi_utils_h265_scaling_list_8x8_to_raster(
+            iq_matrix->ScalingList16x16[i],
+            scaling_list->scaling_lists_16x16[i]);
+        iq_matrix->ScalingListDC16x16[i] =
+            scaling_list->scaling_list_dc_coef_minus8_16x16[i] + 8;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(iq_matrix->ScalingList32x32); i++) {
+        gst_vaapi_utils_h265_scaling_list_8x8_to_raster(
+            iq_matrix->ScalingList32x32[i],
+            scaling_list->scaling_lists_32x32[i]);
+        iq_matrix->ScalingListDC32x32[i] =
+            scaling_list->scaling_list_dc_coef_minus8_32x32[i] + 8;
+    }
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static inline gboolean
+is_valid_state(guint state, guint ref_state)
+{
+    return (state & ref_state) == ref_state;
+}
+
+static GstVaapiDecoderStatus
+decode_current_picture(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiPictureH265 * const picture = priv->current_picture;
+    GPtrArray *slices;
+
+    if (!is_valid_state(priv->decoder_state, GST_H265_VIDEO_STATE_VALID_PICTURE))
+        goto drop_frame;
+    priv->decoder_state = 0;
+
+    if (!picture)
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+    /* Mark the last slice segment of the picture */
+    slices = picture->base.slices;
+    if (slices->len > 0) {
+        GstVaapiSlice * const slice =
+            g_ptr_array_index(slices, slices->len - 1);
+        VASliceParameterBufferHEVC * const slice_param = slice->param;
+        slice_param->LongSliceFlags.fields.LastSliceOfPic = 1;
+    }
+
+    if (!gst_vaapi_picture_decode(GST_VAAPI_PICTURE_CAST(picture)))
+        goto error;
+    if (!dpb_add(decoder, picture))
+        goto error;
+    gst_vaapi_picture_replace(&priv->current_picture, NULL);
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+error:
+    gst_vaapi_picture_replace(&priv->current_picture, NULL);
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+
+drop_frame:
+    priv->decoder_state = 0;
+    return GST_VAAPI_DECODER_STATUS_DROP_FRAME;
+}
+
+static GstVaapiDecoderStatus
+parse_vps(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265VPS * const vps = &pi->data.vps;
+    GstH265ParserResult result;
+
+    GST_DEBUG("parse VPS");
+
+    result = gst_h265_parser_parse_vps(priv->parser, &pi->nalu, vps);
+    if (result != GST_H265_PARSER_OK)
+        return get_status(result);
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+parse_sps(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265SPS * const sps = &pi->data.sps;
+    GstH265ParserResult result;
+
+    GST_DEBUG("parse SPS");
+
+    priv->parser_state = 0;
+
+    result = gst_h265_parser_parse_sps(priv->parser, &pi->nalu, sps, TRUE);
+    if (result != GST_H265_PARSER_OK)
+        return get_status(result);
+
+    priv->parser_state |= GST_H265_VIDEO_STATE_GOT_SPS;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+parse_pps(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265PPS * const pps = &pi->data.pps;
+    GstH265ParserResult result;
+
+    GST_DEBUG("parse PPS");
+
+    priv->parser_state &= GST_H265_VIDEO_STATE_GOT_SPS;
+
+    result = gst_h265_parser_parse_pps(priv->parser, &pi->nalu, pps);
+    if (result != GST_H265_PARSER_OK)
+        return get_status(result);
+
+    priv->parser_state |= GST_H265_VIDEO_STATE_GOT_PPS;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+parse_sei(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GArray ** const sei_ptr = &pi->data.sei;
+    GstH265ParserResult result;
+
+    GST_DEBUG("parse SEI");
+
+    result = gst_h265_parser_parse_sei(priv->parser, &pi->nalu, sei_ptr);
+    if (result != GST_H265_PARSER_OK) {
+        GST_WARNING("failed to parse SEI messages");
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    }
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+parse_slice(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265SliceHdr * const slice_hdr = &pi->data.slice_hdr;
+    GstH265ParserResult result;
+
+    GST_DEBUG("parse slice");
+
+    priv->parser_state &= (GST_H265_VIDEO_STATE_GOT_SPS|
+                           GST_H265_VIDEO_STATE_GOT_PPS);
+
+    result = gst_h265_parser_parse_slice_hdr(priv->parser, &pi->nalu,
+        slice_hdr);
+    if (result != GST_H265_PARSER_OK)
+        return get_status(result);
+
+    priv->parser_state |= GST_H265_VIDEO_STATE_GOT_SLICE;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+decode_vps(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265VPS * const vps = &pi->data.vps;
+
+    GST_DEBUG("decode VPS");
+
+    gst_vaapi_parser_info_h265_replace(&priv->vps[vps->id], pi);
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+decode_sps(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265SPS * const sps = &pi->data.sps;
+
+    GST_DEBUG("decode SPS");
+
+    gst_vaapi_parser_info_h265_replace(&priv->sps[sps->id], pi);
+
+    /* Allocate the VA context and surfaces from the first SPS, so that
+       this is already done by the time the first slice arrives. Errors
+       are reported later on, when the SPS is actually activated */
+    if (!priv->has_context &&
+        ensure_context(decoder, sps) != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        GST_DEBUG("failed to pre-allocate VA context from SPS");
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+decode_pps(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265PPS * const pps = &pi->data.pps;
+
+    GST_DEBUG("decode PPS");
+
+    gst_vaapi_parser_info_h265_replace(&priv->pps[pps->id], pi);
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+decode_sequence_end(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiDecoderStatus status;
+
+    GST_DEBUG("decode sequence-end");
+
+    status = decode_current_picture(decoder);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        return status;
+
+    dpb_flush(decoder);
+
+    /* The next picture is the first one of a new coded video sequence,
+       i.e. an IRAP picture with NoRaslOutputFlag = 1 */
+    priv->new_bitstream = TRUE;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static gboolean
+init_picture(
+    GstVaapiDecoderH265 *decoder,
+    GstVaapiPictureH265 *picture, GstVaapiParserInfoH265 *pi)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiPicture * const base_picture = &picture->base;
+    GstH265SliceHdr * const slice_hdr = &pi->data.slice_hdr;
+    GstH265PPS * const pps = get_pps(decoder);
+    GstH265SPS * const sps = get_sps(decoder);
+    const guint8 nal_type = pi->nalu.type;
+    gboolean reset_poc_msb, update_prev_poc;
+
+    base_picture->pts           = GST_VAAPI_DECODER_CODEC_FRAME(decoder)->pts;
+    base_picture->type          = GST_VAAPI_PICTURE_TYPE_NONE;
+    base_picture->structure     = GST_VAAPI_PICTURE_STRUCTURE_FRAME;
+    picture->poc_lsb            = slice_hdr->pic_order_cnt_lsb;
+
+    if (nal_is_irap(nal_type)) {
+        GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_IRAP);
+        if (nal_is_idr(nal_type)) {
+            GST_DEBUG("<IDR>");
+            GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_IDR);
+            picture->poc_lsb = 0;
+        }
+
+        /* 8.1.3 - CRA pictures at the start of the bitstream or after an
+           end of sequence are handled as BLA pictures */
+        picture->NoRaslOutputFlag = nal_is_idr(nal_type) ||
+            nal_is_bla(nal_type) || priv->new_bitstream;
+        priv->associated_irap_NoRaslOutputFlag = picture->NoRaslOutputFlag;
+        priv->new_bitstream = FALSE;
+    }
+
+    picture->output_flag = pps->output_flag_present_flag ?
+        slice_hdr->pic_output_flag : TRUE;
+
+    /* 8.3.1 - Decoding process for picture order count */
+    reset_poc_msb = GST_VAAPI_PICTURE_IS_IRAP(picture) &&
+        picture->NoRaslOutputFlag;
+    update_prev_poc = pi->nalu.temporal_id_plus1 == 1 &&
+        !nal_is_rasl(nal_type) && !nal_is_radl(nal_type) &&
+        !nal_is_slnr(nal_type);
+    base_picture->poc = gst_vaapi_utils_h265_compute_poc(&priv->poc_state,
+        sps->log2_max_pic_order_cnt_lsb_minus4 + 4, picture->poc_lsb,
+        reset_poc_msb, update_prev_poc);
+
+    /* The current picture is "used for short-term reference" once
+       decoded (8.3.2) */
+    GST_VAAPI_PICTURE_FLAG_SET(picture,
+        GST_VAAPI_PICTURE_FLAG_SHORT_TERM_REFERENCE);
+    return TRUE;
+}
+
+/* Finds the reference picture matching PocLtCurr[] or PocLtFoll[], with
+   the POC masked to its lsb bits if delta_poc_msb_present_flag is 0 */
+static GstVaapiPictureH265 *
+find_long_term_reference(GstVaapiDecoderH265 *decoder, gint32 poc,
+    gint32 poc_mask)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    guint i;
+
+    for (i = 0; i < priv->dpb_count; i++) {
+        GstVaapiPictureH265 * const pic = priv->dpb[i];
+        if (GST_VAAPI_PICTURE_IS_REFERENCE(pic) &&
+            (pic->base.poc & poc_mask) == poc)
+            return pic;
+    }
+    return NULL;
+}
+
+static GstVaapiPictureH265 *
+find_short_term_reference(GstVaapiDecoderH265 *decoder, gint32 poc)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    guint i;
+
+    for (i = 0; i < priv->dpb_count; i++) {
+        GstVaapiPictureH265 * const pic = priv->dpb[i];
+        if (GST_VAAPI_PICTURE_IS_SHORT_TERM_REFERENCE(pic) &&
+            pic->base.poc == poc)
+            return pic;
+    }
+    return NULL;
+}
+
+/* Checks whether the picture belongs to the reference picture set */
+static gboolean
+is_in_ref_pic_set(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    const GstVaapiH265RefPicSet * const rps = &priv->rps;
+    guint i;
+
+    for (i = 0; i < rps->num_st_curr_before; i++) {
+        if (priv->RefPicSetStCurrBefore[i] == picture)
+            return TRUE;
+    }
+    for (i = 0; i < rps->num_st_curr_after; i++) {
+        if (priv->RefPicSetStCurrAfter[i] == picture)
+            return TRUE;
+    }
+    for (i = 0; i < rps->num_st_foll; i++) {
+        if (priv->RefPicSetStFoll[i] == picture)
+            return TRUE;
+    }
+    for (i = 0; i < rps->num_lt_curr; i++) {
+        if (priv->RefPicSetLtCurr[i] == picture)
+            return TRUE;
+    }
+    for (i = 0; i < rps->num_lt_foll; i++) {
+        if (priv->RefPicSetLtFoll[i] == picture)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* 8.3.2 - Decoding process for reference picture set */
+static void
+init_picture_refs(
+    GstVaapiDecoderH265 *decoder,
+    GstVaapiPictureH265 *picture,
+    GstH265SliceHdr     *slice_hdr
+)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstH265SPS * const sps = get_sps(decoder);
+    GstVaapiH265RefPicSet * const rps = &priv->rps;
+    const guint log2_max_poc_lsb = sps->log2_max_pic_order_cnt_lsb_minus4 + 4;
+    const gint32 MaxPicOrderCntLsb = 1 << log2_max_poc_lsb;
+    const GstH265ShortTermRefPicSet *st;
+    GstVaapiH265ShortTermRps st_rps;
+    GstVaapiH265LongTermRef lt_refs[GST_VAAPI_H265_MAX_RPS_PICS];
+    guint i, num_long_term;
+
+    /* All reference pictures are "unused for reference" for an IRAP
+       picture with NoRaslOutputFlag = 1, whose RPS is empty anyway */
+    if (GST_VAAPI_PICTURE_IS_IRAP(picture) && picture->NoRaslOutputFlag) {
+        for (i = 0; i < priv->dpb_count; i++)
+            gst_vaapi_picture_h265_set_reference(priv->dpb[i], 0);
+        memset(rps, 0, sizeof(*rps));
+        return;
+    }
+
+    if (slice_hdr->short_term_ref_pic_set_sps_flag)
+        st = &sps->short_term_ref_pic_set[
+            slice_hdr->short_term_ref_pic_set_idx];
+    else
+        st = &slice_hdr->short_term_ref_pic_sets;
+
+    memset(&st_rps, 0, sizeof(st_rps));
+    st_rps.num_negative_pics = MIN(st->NumNegativePics,
+        GST_VAAPI_H265_MAX_RPS_PICS);
+    for (i = 0; i < st_rps.num_negative_pics; i++) {
+        st_rps.delta_poc_s0[i] = st->DeltaPocS0[i];
+        st_rps.used_by_curr_pic_s0[i] = st->UsedByCurrPicS0[i];
+    }
+    st_rps.num_positive_pics = MIN(st->NumPositivePics,
+        GST_VAAPI_H265_MAX_RPS_PICS);
+    for (i = 0; i < st_rps.num_positive_pics; i++) {
+        st_rps.delta_poc_s1[i] = st->DeltaPocS1[i];
+        st_rps.used_by_curr_pic_s1[i] = st->UsedByCurrPicS1[i];
+    }
+
+    num_long_term = MIN(slice_hdr->num_long_term_sps +
+        slice_hdr->num_long_term_pics, GST_VAAPI_H265_MAX_RPS_PICS);
+    for (i = 0; i < num_long_term; i++) {
+        GstVaapiH265LongTermRef * const lt = &lt_refs[i];
+
+        if (i < slice_hdr->num_long_term_sps) {
+            const guint idx = slice_hdr->lt_idx_sps[i];
+            lt->poc_lsb_lt = sps->lt_ref_pic_poc_lsb_sps[idx];
+            lt->used_by_curr_pic_lt = sps->used_by_curr_pic_lt_sps_flag[idx];
+        }
+        else {
+            lt->poc_lsb_lt = slice_hdr->poc_lsb_lt[i];
+            lt->used_by_curr_pic_lt = slice_hdr->used_by_curr_pic_lt_flag[i];
+        }
+        lt->delta_poc_msb_present_flag =
+            slice_hdr->delta_poc_msb_present_flag[i];
+        lt->delta_poc_msb_cycle_lt = slice_hdr->delta_poc_msb_cycle_lt[i];
+    }
+
+    gst_vaapi_utils_h265_derive_rps(rps, picture->base.poc, log2_max_poc_lsb,
+        &st_rps, lt_refs, MIN(slice_hdr->num_long_term_sps, num_long_term),
+        num_long_term - MIN(slice_hdr->num_long_term_sps, num_long_term));
+
+    /* Long-term pictures are looked up first (8-5) ... */
+    for (i = 0; i < rps->num_lt_curr; i++)
+        priv->RefPicSetLtCurr[i] = find_long_term_reference(decoder,
+            rps->poc_lt_curr[i], rps->curr_delta_poc_msb_present_flag[i] ?
+            -1 : MaxPicOrderCntLsb - 1);
+    for (i = 0; i < rps->num_lt_foll; i++)
+        priv->RefPicSetLtFoll[i] = find_long_term_reference(decoder,
+            rps->poc_lt_foll[i], rps->foll_delta_poc_msb_present_flag[i] ?
+            -1 : MaxPicOrderCntLsb - 1);
+
+    /* ... and marked as such before the short-term ones (8-6, 8-7) */
+    for (i = 0; i < rps->num_lt_curr; i++)
+        gst_vaapi_picture_h265_set_reference(priv->RefPicSetLtCurr[i],
+            GST_VAAPI_PICTURE_FLAG_LONG_TERM_REFERENCE);
+    for (i = 0; i < rps->num_lt_foll; i++)
+        gst_vaapi_picture_h265_set_reference(priv->RefPicSetLtFoll[i],
+            GST_VAAPI_PICTURE_FLAG_LONG_TERM_REFERENCE);
+
+    for (i = 0; i < rps->num_st_curr_before; i++)
+        priv->RefPicSetStCurrBefore[i] = find_short_term_reference(decoder,
+            rps->poc_st_curr_before[i]);
+    for (i = 0; i < rps->num_st_curr_after; i++)
+        priv->RefPicSetStCurrAfter[i] = find_short_term_reference(decoder,
+            rps->poc_st_curr_after[i]);
+    for (i = 0; i < rps->num_st_foll; i++)
+        priv->RefPicSetStFoll[i] = find_short_term_reference(decoder,
+            rps->poc_st_foll[i]);
+
+    for (i = 0; i < rps->num_st_curr_before; i++) {
+        if (!priv->RefPicSetStCurrBefore[i])
+            GST_WARNING("missing reference picture (POC %d)",
+                rps->poc_st_curr_before[i]);
+    }
+    for (i = 0; i < rps->num_st_curr_after; i++) {
+        if (!priv->RefPicSetStCurrAfter[i])
+            GST_WARNING("missing reference picture (POC %d)",
+                rps->poc_st_curr_after[i]);
+    }
+    for (i = 0; i < rps->num_lt_curr; i++) {
+        if (!priv->RefPicSetLtCurr[i])
+            GST_WARNING("missing long-term reference picture (POC %d)",
+                rps->poc_lt_curr[i]);
+    }
+
+    /* All pictures that are not in the RPS are "unused for reference" */
+    for (i = 0; i < priv->dpb_count; i++) {
+        GstVaapiPictureH265 * const pic = priv->dpb[i];
+        if (!is_in_ref_pic_set(decoder, pic))
+            gst_vaapi_picture_h265_set_reference(pic, 0);
+    }
+}
+
+static void
+vaapi_init_picture(VAPictureHEVC *pic)
+{
+    pic->picture_id     = VA_INVALID_ID;
+    pic->pic_order_cnt  = 0;
+    pic->flags          = VA_PICTURE_HEVC_INVALID;
+}
+
+static void
+vaapi_fill_picture(VAPictureHEVC *pic, GstVaapiPictureH265 *picture,
+    guint rps_flags)
+{
+    pic->picture_id     = picture->base.surface_id;
+    pic->pic_order_cnt  = picture->base.poc;
+    pic->flags          = rps_flags;
+
+    if (GST_VAAPI_PICTURE_IS_LONG_TERM_REFERENCE(picture))
+        pic->flags |= VA_PICTURE_HEVC_LONG_TERM_REFERENCE;
+}
+
+/* Appends the available pictures of a RPS list to ReferenceFrames[] */
+static void
+fill_reference_frames(VAPictureParameterBufferHEVC *pic_param, guint *n_ptr,
+    GstVaapiPictureH265 **pictures, guint num_pictures, guint rps_flags)
+{
+    guint i, n = *n_ptr;
+
+    for (i = 0; i < num_pictures && n < MAX_REF_FRAMES; i++) {
+        if (pictures[i])
+            vaapi_fill_picture(&pic_param->ReferenceFrames[n++], pictures[i],
+                rps_flags);
+    }
+    *n_ptr = n;
+}
+
+/* Fills in tiles columns and rows, except the last ones (6.5.1) */
+static void
+fill_tiles(VAPictureParameterBufferHEVC *pic_param, GstH265PPS *pps,
+    GstH265SPS *sps)
+{
+    guint16 col_widths[G_N_ELEMENTS(pic_param->column_width_minus1) + 1];
+    guint16 row_heights[G_N_ELEMENTS(pic_param->row_height_minus1) + 1];
+    guint i, num_cols, num_rows, width_in_ctbs, height_in_ctbs;
+
+    memset(pic_param->column_width_minus1, 0,
+        sizeof(pic_param->column_width_minus1));
+    memset(pic_param->row_height_minus1, 0,
+        sizeof(pic_param->row_height_minus1));
+    pic_param->num_tile_columns_minus1 = 0;
+    pic_param->num_tile_rows_minus1 = 0;
+
+    if (!pps->tiles_enabled_flag)
+        return;
+
+    num_cols = MIN(pps->num_tile_columns_minus1 + 1, G_N_ELEMENTS(col_widths));
+    num_rows = MIN(pps->num_tile_rows_minus1 + 1, G_N_ELEMENTS(row_heights));
+    pic_param->num_tile_columns_minus1 = num_cols - 1;
+    pic_param->num_tile_rows_minus1 = num_rows - 1;
+
+    if (pps->uniform_spacing_flag) {
+        get_pic_size_in_ctbs(sps, &width_in_ctbs, &height_in_ctbs);
+        gst_vaapi_utils_h265_get_uniform_tile_sizes(col_widths, num_cols,
+            width_in_ctbs);
+        gst_vaapi_utils_h265_get_uniform_tile_sizes(row_heights, num_rows,
+            height_in_ctbs);
+        for (i = 0; i < num_cols - 1; i++)
+            pic_param->column_width_minus1[i] = col_widths[i] - 1;
+        for (i = 0; i < num_rows - 1; i++)
+            pic_param->row_height_minus1[i] = row_heights[i] - 1;
+    }
+    else {
+        for (i = 0; i < num_cols - 1; i++)
+            pic_param->column_width_minus1[i] = pps->column_width_minus1[i];
+        for (i = 0; i < num_rows - 1; i++)
+            pic_param->row_height_minus1[i] = pps->row_height_minus1[i];
+    }
+}
+
+static gboolean
+fill_picture(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture,
+    GstVaapiParserInfoH265 *pi)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiPicture * const base_picture = &picture->base;
+    GstH265SliceHdr * const slice_hdr = &pi->data.slice_hdr;
+    GstH265PPS * const pps = get_pps(decoder);
+    GstH265SPS * const sps = get_sps(decoder);
+    const GstVaapiH265RefPicSet * const rps = &priv->rps;
+    VAPictureParameterBufferHEVC * const pic_param = base_picture->param;
+    const guint HighestTid = sps->max_sub_layers_minus1;
+    guint n;
+
+    /* Fill in VAPictureParameterBufferHEVC */
+    vaapi_fill_picture(&pic_param->CurrPic, picture, 0);
+    pic_param->CurrPic.flags = 0;
+
+    n = 0;
+    fill_reference_frames(pic_param, &n, priv->RefPicSetStCurrBefore,
+        rps->num_st_curr_before, VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE);
+    fill_reference_frames(pic_param, &n, priv->RefPicSetStCurrAfter,
+        rps->num_st_curr_after, VA_PICTURE_HEVC_RPS_ST_CURR_AFTER);
+    fill_reference_frames(pic_param, &n, priv->RefPicSetLtCurr,
+        rps->num_lt_curr, VA_PICTURE_HEVC_RPS_LT_CURR);
+    fill_reference_frames(pic_param, &n, priv->RefPicSetStFoll,
+        rps->num_st_foll, 0);
+    fill_reference_frames(pic_param, &n, priv->RefPicSetLtFoll,
+        rps->num_lt_foll, 0);
+    for (; n < MAX_REF_FRAMES; n++)
+        vaapi_init_picture(&pic_param->ReferenceFrames[n]);
+
+#define COPY_FIELD(s, f) \
+    pic_param->f = (s)->f
+
+#define COPY_BFM(a, s, f) \
+    pic_param->a.bits.f = (s)->f
+
+    COPY_FIELD(sps, pic_width_in_luma_samples);
+    COPY_FIELD(sps, pic_height_in_luma_samples);
+
+    pic_param->pic_fields.value                                         = 0; /* reset all bits */
+    pic_param->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag = pps->loop_filter_across_slices_enabled_flag;
+    pic_param->pic_fields.bits.NoPicReorderingFlag                      = !sps->max_num_reorder_pics[HighestTid];
+
+    COPY_BFM(pic_fields, sps, chroma_format_idc);
+    COPY_BFM(pic_fields, sps, separate_colour_plane_flag);
+    COPY_BFM(pic_fields, sps, pcm_enabled_flag);
+    COPY_BFM(pic_fields, sps, scaling_list_enabled_flag);
+    COPY_BFM(pic_fields, pps, transform_skip_enabled_flag);
+    COPY_BFM(pic_fields, sps, amp_enabled_flag);
+    COPY_BFM(pic_fields, sps, strong_intra_smoothing_enabled_flag);
+    COPY_BFM(pic_fields, pps, sign_data_hiding_enabled_flag);
+    COPY_BFM(pic_fields, pps, constrained_intra_pred_flag);
+    COPY_BFM(pic_fields, pps, cu_qp_delta_enabled_flag);
+    COPY_BFM(pic_fields, pps, weighted_pred_flag);
+    COPY_BFM(pic_fields, pps, weighted_bipred_flag);
+    COPY_BFM(pic_fields, pps, transquant_bypass_enabled_flag);
+    COPY_BFM(pic_fields, pps, tiles_enabled_flag);
+    COPY_BFM(pic_fields, pps, entropy_coding_sync_enabled_flag);
+    COPY_BFM(pic_fields, pps, loop_filter_across_tiles_enabled_flag);
+    COPY_BFM(pic_fields, sps, pcm_loop_filter_disabled_flag);
+
+    pic_param->sps_max_dec_pic_buffering_minus1 = sps->max_dec_pic_buffering_minus1[HighestTid];
+    pic_param->pps_cb_qp_offset                 = pps->cb_qp_offset;
+    pic_param->pps_cr_qp_offset                 = pps->cr_qp_offset;
+    pic_param->num_long_term_ref_pic_sps        = sps->num_long_term_ref_pics_sps;
+    pic_param->pps_beta_offset_div2             = pps->beta_offset_div2;
+    pic_param->pps_tc_offset_div2               = pps->tc_offset_div2;
+
+    COPY_FIELD(sps, bit_depth_luma_minus8);
+    COPY_FIELD(sps, bit_depth_chroma_minus8);
+    COPY_FIELD(sps, pcm_sample_bit_depth_luma_minus1);
+    COPY_FIELD(sps, pcm_sample_bit_depth_chroma_minus1);
+    COPY_FIELD(sps, log2_min_luma_coding_block_size_minus3);
+    COPY_FIELD(sps, log2_diff_max_min_luma_coding_block_size);
+    COPY_FIELD(sps, log2_min_transform_block_size_minus2);
+    COPY_FIELD(sps, log2_diff_max_min_transform_block_size);
+    COPY_FIELD(sps, log2_min_pcm_luma_coding_block_size_minus3);
+    COPY_FIELD(sps, log2_diff_max_min_pcm_luma_coding_block_size);
+    COPY_FIELD(sps, max_transform_hierarchy_depth_intra);
+    COPY_FIELD(sps, max_transform_hierarchy_depth_inter);
+    COPY_FIELD(sps, log2_max_pic_order_cnt_lsb_minus4);
+    COPY_FIELD(sps, num_short_term_ref_pic_sets);
+    COPY_FIELD(pps, init_qp_minus26);
+    COPY_FIELD(pps, diff_cu_qp_delta_depth);
+    COPY_FIELD(pps, log2_parallel_merge_level_minus2);
+    COPY_FIELD(pps, num_ref_idx_l0_default_active_minus1);
+    COPY_FIELD(pps, num_ref_idx_l1_default_active_minus1);
+    COPY_FIELD(pps, num_extra_slice_header_bits);
+
+    fill_tiles(pic_param, pps, sps);
+
+    pic_param->slice_parsing_fields.value                               = 0; /* reset all bits */
+    pic_param->slice_parsing_fields.bits.sps_temporal_mvp_enabled_flag  = sps->temporal_mvp_enabled_flag;
+    pic_param->slice_parsing_fields.bits.pps_slice_chroma_qp_offsets_present_flag = pps->slice_chroma_qp_offsets_present_flag;
+    pic_param->slice_parsing_fields.bits.pps_disable_deblocking_filter_flag = pps->deblocking_filter_disabled_flag;
+    pic_param->slice_parsing_fields.bits.RapPicFlag                     = GST_VAAPI_PICTURE_IS_IRAP(picture);
+    pic_param->slice_parsing_fields.bits.IdrPicFlag                     = GST_VAAPI_PICTURE_IS_IDR(picture);
+    pic_param->slice_parsing_fields.bits.IntraPicFlag                   = GST_VAAPI_PICTURE_IS_IRAP(picture);
+
+    COPY_BFM(slice_parsing_fields, pps, lists_modification_present_flag);
+    COPY_BFM(slice_parsing_fields, sps, long_term_ref_pics_present_flag);
+    COPY_BFM(slice_parsing_fields, pps, cabac_init_present_flag);
+    COPY_BFM(slice_parsing_fields, pps, output_flag_present_flag);
+    COPY_BFM(slice_parsing_fields, pps, dependent_slice_segments_enabled_flag);
+    COPY_BFM(slice_parsing_fields, sps, sample_adaptive_offset_enabled_flag);
+    COPY_BFM(slice_parsing_fields, pps, deblocking_filter_override_enabled_flag);
+    COPY_BFM(slice_parsing_fields, pps, slice_segment_header_extension_present_flag);
+
+    /* Number of bits of st_ref_pic_set() in the slice header */
+    if (GST_VAAPI_PICTURE_IS_IDR(picture) ||
+        slice_hdr->short_term_ref_pic_set_sps_flag)
+        pic_param->st_rps_bits = 0;
+    else
+        pic_param->st_rps_bits = slice_hdr->short_term_ref_pic_set_size;
+    return TRUE;
+}
+
+/* Detection of the first VCL NAL unit of a coded picture (7.4.2.4.5) */
+static gboolean
+is_new_picture(GstVaapiParserInfoH265 *pi, GstVaapiParserInfoH265 *prev_pi)
+{
+    GstH265SliceHdr * const slice_hdr = &pi->data.slice_hdr;
+
+    if (!prev_pi)
+        return TRUE;
+    return slice_hdr->first_slice_segment_in_pic_flag;
+}
+
+static GstVaapiDecoderStatus
+decode_picture(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstH265SliceHdr * const slice_hdr = &pi->data.slice_hdr;
+    GstH265PPS * const pps = ensure_pps(decoder, slice_hdr->pps);
+    GstH265SPS * const sps = ensure_sps(decoder, slice_hdr->pps->sps);
+    GstVaapiPictureH265 *picture;
+    GstVaapiDecoderStatus status;
+
+    g_return_val_if_fail(pps != NULL, GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN);
+    g_return_val_if_fail(sps != NULL, GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN);
+
+    /* Leading pictures cannot be decoded before the first IRAP picture,
+       nor RASL pictures after an IRAP with NoRaslOutputFlag = 1 (8.1.3) */
+    if (priv->new_bitstream && !nal_is_irap(pi->nalu.type)) {
+        GST_DEBUG("drop picture before the first IRAP picture");
+        return GST_VAAPI_DECODER_STATUS_DROP_FRAME;
+    }
+    if (nal_is_rasl(pi->nalu.type) && priv->associated_irap_NoRaslOutputFlag) {
+        GST_DEBUG("drop RASL picture");
+        return GST_VAAPI_DECODER_STATUS_DROP_FRAME;
+    }
+
+    status = ensure_context(decoder, sps);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        return status;
+
+    priv->decoder_state = 0;
+
+    /* Create new picture */
+    picture = gst_vaapi_picture_h265_new(decoder);
+    if (!picture) {
+        GST_ERROR("failed to allocate picture");
+        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+    gst_vaapi_picture_replace(&priv->current_picture, picture);
+    gst_vaapi_picture_unref(picture);
+
+    /* Update cropping rectangle */
+    if (sps->conformance_window_flag) {
+        GstVaapiRectangle crop_rect;
+        crop_rect.x = sps->crop_rect_x;
+        crop_rect.y = sps->crop_rect_y;
+        crop_rect.width = sps->crop_rect_width;
+        crop_rect.height = sps->crop_rect_height;
+        gst_vaapi_picture_set_crop_rect(&picture->base, &crop_rect);
+    }
+
+    status = ensure_quant_matrix(decoder, picture);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
+        GST_ERROR("failed to reset quantizer matrix");
+        return status;
+    }
+
+    if (!init_picture(decoder, picture, pi))
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    init_picture_refs(decoder, picture, slice_hdr);
+    dpb_prepare(decoder, picture);
+    if (!fill_picture(decoder, picture, pi))
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+
+    priv->decoder_state = pi->state;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static inline guint
+get_slice_data_byte_offset(GstH265SliceHdr *slice_hdr, guint nal_header_bytes)
+{
+    guint epb_count;
+
+    epb_count = slice_hdr->n_emulation_prevention_bytes;
+    return nal_header_bytes + (slice_hdr->header_size + 7) / 8 - epb_count;
+}
+
+/* Finds the ReferenceFrames[] entry of the supplied picture */
+static guint8
+get_ref_frame_index(VAPictureParameterBufferHEVC *pic_param,
+    GstVaapiPictureH265 *picture)
+{
+    guint i;
+
+    if (!picture)
+        return 0xFF;
+
+    for (i = 0; i < MAX_REF_FRAMES; i++) {
+        const VAPictureHEVC * const pic = &pic_param->ReferenceFrames[i];
+        if (!(pic->flags & VA_PICTURE_HEVC_INVALID) &&
+            pic->picture_id == picture->base.surface_id)
+            return i;
+    }
+    return 0xFF;
+}
+
+/* 8.3.4 - Decoding process for reference picture lists construction */
+static void
+fill_RefPicListX(GstVaapiDecoderH265 *decoder,
+    VAPictureParameterBufferHEVC *pic_param, guint8 *RefPicList,
+    guint num_active, gboolean is_list1, guint8 modification_flag,
+    const guint32 *list_entry_lX)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    const GstVaapiH265RefPicSet * const rps = &priv->rps;
+    GstVaapiPictureH265 *RefPicSetCurr[3 * GST_VAAPI_H265_MAX_RPS_PICS];
+    guint8 ref_list[GST_VAAPI_H265_MAX_RPS_PICS];
+    guint8 list_entry[GST_VAAPI_H265_MAX_RPS_PICS];
+    guint i, n;
+
+    /* Concatenation of RefPicSetStCurrBefore, RefPicSetStCurrAfter and
+       RefPicSetLtCurr, as indexed by the utility function */
+    n = 0;
+    for (i = 0; i < rps->num_st_curr_before; i++)
+        RefPicSetCurr[n++] = priv->RefPicSetStCurrBefore[i];
+    for (i = 0; i < rps->num_st_curr_after; i++)
+        RefPicSetCurr[n++] = priv->RefPicSetStCurrAfter[i];
+    for (i = 0; i < rps->num_lt_curr; i++)
+        RefPicSetCurr[n++] = priv->RefPicSetLtCurr[i];
+
+    num_active = MIN(num_active, MAX_REF_FRAMES);
+    if (modification_flag) {
+        for (i = 0; i < num_active; i++)
+            list_entry[i] = list_entry_lX[i];
+    }
+
+    n = gst_vaapi_utils_h265_init_ref_pic_list(ref_list, num_active, rps,
+        is_list1, modification_flag ? list_entry : NULL);
+    for (i = 0; i < n; i++)
+        RefPicList[i] = get_ref_frame_index(pic_param,
+            RefPicSetCurr[ref_list[i]]);
+}
+
+static gboolean
+fill_RefPicList(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture,
+    GstVaapiSlice *slice, GstH265SliceHdr *slice_hdr)
+{
+    VASliceParameterBufferHEVC * const slice_param = slice->param;
+    VAPictureParameterBufferHEVC * const pic_param = picture->base.param;
+    GstH265RefPicListModification * const mod =
+        &slice_hdr->ref_pic_list_modification;
+
+    slice_param->num_ref_idx_l0_active_minus1 = 0;
+    slice_param->num_ref_idx_l1_active_minus1 = 0;
+    memset(slice_param->RefPicList, 0xFF, sizeof(slice_param->RefPicList));
+
+    if (GST_H265_IS_I_SLICE(slice_hdr))
+        return TRUE;
+
+    slice_param->num_ref_idx_l0_active_minus1 =
+        slice_hdr->num_ref_idx_l0_active_minus1;
+    fill_RefPicListX(decoder, pic_param, slice_param->RefPicList[0],
+        slice_hdr->num_ref_idx_l0_active_minus1 + 1, FALSE,
+        mod->ref_pic_list_modification_flag_l0, mod->list_entry_l0);
+
+    if (!GST_H265_IS_B_SLICE(slice_hdr))
+        return TRUE;
+
+    slice_param->num_ref_idx_l1_active_minus1 =
+        slice_hdr->num_ref_idx_l1_active_minus1;
+    fill_RefPicListX(decoder, pic_param, slice_param->RefPicList[1],
+        slice_hdr->num_ref_idx_l1_active_minus1 + 1, TRUE,
+        mod->ref_pic_list_modification_flag_l1, mod->list_entry_l1);
+    return TRUE;
+}
+
+/* Derives ChromaOffsetLX[][] from delta_chroma_offset_lX[][] (7-56) */
+static inline gint
+get_chroma_offset(gint delta_chroma_offset, gint delta_chroma_weight,
+    guint ChromaLog2WeightDenom, gint wpOffsetHalfRangeC)
+{
+    const gint ChromaWeight = (1 << ChromaLog2WeightDenom) +
+        delta_chroma_weight;
+
+    return CLAMP(wpOffsetHalfRangeC + delta_chroma_offset -
+        ((wpOffsetHalfRangeC * ChromaWeight) >> ChromaLog2WeightDenom),
+        -wpOffsetHalfRangeC, wpOffsetHalfRangeC - 1);
+}
+
+static gboolean
+fill_pred_weight_table(GstVaapiDecoderH265 *decoder,
+    GstVaapiSlice *slice, GstH265SliceHdr *slice_hdr)
+{
+    VASliceParameterBufferHEVC * const slice_param = slice->param;
+    GstH265PPS * const pps = get_pps(decoder);
+    GstH265SPS * const sps = get_sps(decoder);
+    GstH265PredWeightTable * const w = &slice_hdr->pred_weight_table;
+    const gint wpOffsetHalfRangeC = 1 << (sps->bit_depth_chroma_minus8 + 7);
+    guint num_weight_tables = 0, ChromaLog2WeightDenom;
+    gint i, j;
+
+    if (pps->weighted_pred_flag && GST_H265_IS_P_SLICE(slice_hdr))
+        num_weight_tables = 1;
+    else if (pps->weighted_bipred_flag && GST_H265_IS_B_SLICE(slice_hdr))
+        num_weight_tables = 2;
+    else
+        num_weight_tables = 0;
+
+    slice_param->luma_log2_weight_denom         = 0;
+    slice_param->delta_chroma_log2_weight_denom = 0;
+    memset(slice_param->delta_luma_weight_l0, 0,
+        sizeof(slice_param->delta_luma_weight_l0));
+    memset(slice_param->luma_offset_l0, 0,
+        sizeof(slice_param->luma_offset_l0));
+    memset(slice_param->delta_chroma_weight_l0, 0,
+        sizeof(slice_param->delta_chroma_weight_l0));
+    memset(slice_param->ChromaOffsetL0, 0,
+        sizeof(slice_param->ChromaOffsetL0));
+    memset(slice_param->delta_luma_weight_l1, 0,
+        sizeof(slice_param->delta_luma_weight_l1));
+    memset(slice_param->luma_offset_l1, 0,
+        sizeof(slice_param->luma_offset_l1));
+    memset(slice_param->delta_chroma_weight_l1, 0,
+        sizeof(slice_param->delta_chroma_weight_l1));
+    memset(slice_param->ChromaOffsetL1, 0,
+        sizeof(slice_param->ChromaOffsetL1));
+
+    if (num_weight_tables < 1)
+        return TRUE;
+
+    slice_param->luma_log2_weight_denom = w->luma_log2_weight_denom;
+    if (sps->chroma_array_type != 0)
+        slice_param->delta_chroma_log2_weight_denom =
+            w->delta_chroma_log2_weight_denom;
+    ChromaLog2WeightDenom = w->luma_log2_weight_denom +
+        slice_param->delta_chroma_log2_weight_denom;
+
+    for (i = 0; i <= slice_param->num_ref_idx_l0_active_minus1; i++) {
+        if (w->luma_weight_l0_flag[i]) {
+            slice_param->delta_luma_weight_l0[i] = w->delta_luma_weight_l0[i];
+            slice_param->luma_offset_l0[i] = w->luma_offset_l0[i];
+        }
+        if (sps->chroma_array_type == 0 || !w->chroma_weight_l0_flag[i])
+            continue;
+        for (j = 0; j < 2; j++) {
+            slice_param->delta_chroma_weight_l0[i][j] =
+                w->delta_chroma_weight_l0[i][j];
+            slice_param->ChromaOffsetL0[i][j] = get_chroma_offset(
+                w->delta_chroma_offset_l0[i][j],
+                w->delta_chroma_weight_l0[i][j], ChromaLog2WeightDenom,
+                wpOffsetHalfRangeC);
+        }
+    }
+
+    if (num_weight_tables < 2)
+        return TRUE;
+
+    for (i = 0; i <= slice_param->num_ref_idx_l1_active_minus1; i++) {
+        if (w->luma_weight_l1_flag[i]) {
+            slice_param->delta_luma_weight_l1[i] = w->delta_luma_weight_l1[i];
+            slice_param->luma_offset_l1[i] = w->luma_offset_l1[i];
+        }
+        if (sps->chroma_array_type == 0 || !w->chroma_weight_l1_flag[i])
+            continue;
+        for (j = 0; j < 2; j++) {
+            slice_param->delta_chroma_weight_l1[i][j] =
+                w->delta_chroma_weight_l1[i][j];
+            slice_param->ChromaOffsetL1[i][j] = get_chroma_offset(
+                w->delta_chroma_offset_l1[i][j],
+                w->delta_chroma_weight_l1[i][j], ChromaLog2WeightDenom,
+                wpOffsetHalfRangeC);
+        }
+    }
+    return TRUE;
+}
+
+/* Fills in the slice parameters. Most of them come from the header of
+   the independent slice segment, i.e. slice_hdr, whereas pi holds the
+   current slice segment, which may be a dependent one */
+static gboolean
+fill_slice(GstVaapiDecoderH265 *decoder, GstVaapiPictureH265 *picture,
+    GstVaapiSlice *slice, GstVaapiParserInfoH265 *pi,
+    GstH265SliceHdr *slice_hdr)
+{
+    VASliceParameterBufferHEVC * const slice_param = slice->param;
+    GstH265SliceHdr * const segment_hdr = &pi->data.slice_hdr;
+    GstH265PPS * const pps = get_pps(decoder);
+    GstH265SPS * const sps = get_sps(decoder);
+    gboolean deblocking_filter_disabled_flag;
+
+    /* Fill in VASliceParameterBufferHEVC */
+    slice_param->slice_data_byte_offset =
+        get_slice_data_byte_offset(segment_hdr, pi->nalu.header_bytes);
+    slice_param->slice_segment_address  = segment_hdr->segment_address;
+    slice_param->slice_qp_delta         = slice_hdr->qp_delta;
+    slice_param->slice_cb_qp_offset     = slice_hdr->cb_qp_offset;
+    slice_param->slice_cr_qp_offset     = slice_hdr->cr_qp_offset;
+    slice_param->five_minus_max_num_merge_cand =
+        slice_hdr->five_minus_max_num_merge_cand;
+
+    /* Deblocking parameters are inherited from the PPS, unless they are
+       overridden in the slice header (7.4.7.1) */
+    if (slice_hdr->deblocking_filter_override_flag) {
+        deblocking_filter_disabled_flag =
+            slice_hdr->deblocking_filter_disabled_flag;
+        slice_param->slice_beta_offset_div2 = slice_hdr->beta_offset_div2;
+        slice_param->slice_tc_offset_div2   = slice_hdr->tc_offset_div2;
+    }
+    else {
+        deblocking_filter_disabled_flag = pps->deblocking_filter_disabled_flag;
+        slice_param->slice_beta_offset_div2 = pps->beta_offset_div2;
+        slice_param->slice_tc_offset_div2   = pps->tc_offset_div2;
+    }
+
+    slice_param->LongSliceFlags.value = 0; /* reset all bits */
+    slice_param->LongSliceFlags.fields.dependent_slice_segment_flag =
+        segment_hdr->dependent_slice_segment_flag;
+    slice_param->LongSliceFlags.fields.slice_type = slice_hdr->type;
+    slice_param->LongSliceFlags.fields.color_plane_id =
+        slice_hdr->colour_plane_id;
+    slice_param->LongSliceFlags.fields.slice_sao_luma_flag =
+        sps->sample_adaptive_offset_enabled_flag && slice_hdr->sao_luma_flag;
+    slice_param->LongSliceFlags.fields.slice_sao_chroma_flag =
+        sps->sample_adaptive_offset_enabled_flag && slice_hdr->sao_chroma_flag;
+    slice_param->LongSliceFlags.fields.mvd_l1_zero_flag =
+        slice_hdr->mvd_l1_zero_flag;
+    slice_param->LongSliceFlags.fields.cabac_init_flag =
+        slice_hdr->cabac_init_flag;
+    slice_param->LongSliceFlags.fields.slice_temporal_mvp_enabled_flag =
+        slice_hdr->temporal_mvp_enabled_flag;
+    slice_param->LongSliceFlags.fields.slice_deblocking_filter_disabled_flag =
+        deblocking_filter_disabled_flag;
+
+    /* collocated_from_l0_flag is inferred to be 1 if not present */
+    slice_param->LongSliceFlags.fields.collocated_from_l0_flag =
+        GST_H265_IS_B_SLICE(slice_hdr) ? slice_hdr->collocated_from_l0_flag : 1;
+
+    /* slice_loop_filter_across_slices_enabled_flag is only present if
+       in-loop filtering is enabled, and inferred from the PPS otherwise */
+    if (pps->loop_filter_across_slices_enabled_flag &&
+        (slice_param->LongSliceFlags.fields.slice_sao_luma_flag ||
+         slice_param->LongSliceFlags.fields.slice_sao_chroma_flag ||
+         !deblocking_filter_disabled_flag))
+        slice_param->LongSliceFlags.fields.
+            slice_loop_filter_across_slices_enabled_flag =
+            slice_hdr->loop_filter_across_slices_enabled_flag;
+    else
+        slice_param->LongSliceFlags.fields.
+            slice_loop_filter_across_slices_enabled_flag =
+            pps->loop_filter_across_slices_enabled_flag;
+
+    slice_param->collocated_ref_idx = slice_hdr->temporal_mvp_enabled_flag ?
+        slice_hdr->collocated_ref_idx : 0xFF;
+
+    if (!fill_RefPicList(decoder, picture, slice, slice_hdr))
+        return FALSE;
+    if (!fill_pred_weight_table(decoder, slice, slice_hdr))
+        return FALSE;
+    return TRUE;
+}
+
+static GstVaapiDecoderStatus
+decode_slice(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstVaapiPictureH265 * const picture = priv->current_picture;
+    GstH265SliceHdr * const slice_hdr = &pi->data.slice_hdr;
+    GstH265PPS *pps;
+    GstH265SPS *sps;
+    GstVaapiSlice *slice;
+    GstBuffer * const buffer =
+        GST_VAAPI_DECODER_CODEC_FRAME(decoder)->input_buffer;
+    GstMapInfo map_info;
+    guint width_in_ctbs, height_in_ctbs, max_entry_points;
+
+    GST_DEBUG("slice (%u bytes)", pi->nalu.size);
+
+    if (!is_valid_state(pi->state,
+            GST_H265_VIDEO_STATE_VALID_PICTURE_HEADERS)) {
+        GST_WARNING("failed to receive enough headers to decode slice");
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    }
+
+    pps = ensure_pps(decoder, slice_hdr->pps);
+    if (!pps) {
+        GST_ERROR("failed to activate PPS");
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    }
+
+    sps = ensure_sps(decoder, slice_hdr->pps->sps);
+    if (!sps) {
+        GST_ERROR("failed to activate SPS");
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    }
+
+    /* Dependent slice segments take most of their slice header values
+       from the preceding independent slice segment (7.4.7.1) */
+    if (!slice_hdr->dependent_slice_segment_flag)
+        gst_vaapi_parser_info_h265_replace(&priv->prev_independent_slice_pi,
+            pi);
+    else if (!priv->prev_independent_slice_pi) {
+        GST_WARNING("failed to find independent slice segment");
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    }
+
+    /* Tiles and WPP substreams are located by the driver, from the
+       slice data. Only make sure the entry points are sane */
+    get_pic_size_in_ctbs(sps, &width_in_ctbs, &height_in_ctbs);
+    max_entry_points = gst_vaapi_utils_h265_get_max_entry_points(
+        pps->tiles_enabled_flag, pps->entropy_coding_sync_enabled_flag,
+        pps->num_tile_columns_minus1 + 1, pps->num_tile_rows_minus1 + 1,
+        height_in_ctbs);
+    if (slice_hdr->num_entry_point_offsets > max_entry_points)
+        GST_WARNING("invalid number of entry points (%u, max %u)",
+            slice_hdr->num_entry_point_offsets, max_entry_points);
+
+    if (!gst_buffer_map(buffer, &map_info, GST_MAP_READ)) {
+        GST_ERROR("failed to map buffer");
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    }
+
+    slice = GST_VAAPI_SLICE_NEW(HEVC, decoder,
+        (map_info.data + unit->offset + pi->nalu.offset), pi->nalu.size);
+    gst_buffer_unmap(buffer, &map_info);
+    if (!slice) {
+        GST_ERROR("failed to allocate slice");
+        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    if (!fill_slice(decoder, picture, slice, pi,
+            &priv->prev_independent_slice_pi->data.slice_hdr)) {
+        gst_vaapi_mini_object_unref(GST_VAAPI_MINI_OBJECT(slice));
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    }
+
+    gst_vaapi_picture_add_slice(GST_VAAPI_PICTURE_CAST(picture), slice);
+    priv->decoder_state |= GST_H265_VIDEO_STATE_GOT_SLICE;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static inline gint
+scan_for_start_code(GstAdapter *adapter, guint ofs, guint size, guint32 *scp)
+{
+    return (gint)gst_adapter_masked_scan_uint32_peek(adapter,
+                                                     0xffffff00, 0x00000100,
+                                                     ofs, size,
+                                                     scp);
+}
+
+static GstVaapiDecoderStatus
+decode_unit(GstVaapiDecoderH265 *decoder, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserInfoH265 * const pi = unit->parsed_info;
+    GstVaapiDecoderStatus status;
+
+    priv->decoder_state |= pi->state;
+    switch (pi->nalu.type) {
+    case GST_H265_NAL_VPS:
+        status = decode_vps(decoder, unit);
+        break;
+    case GST_H265_NAL_SPS:
+        status = decode_sps(decoder, unit);
+        break;
+    case GST_H265_NAL_PPS:
+        status = decode_pps(decoder, unit);
+        break;
+    case GST_H265_NAL_EOS:
+    case GST_H265_NAL_EOB:
+        status = decode_sequence_end(decoder);
+        break;
+    case GST_H265_NAL_PREFIX_SEI:
+    case GST_H265_NAL_SUFFIX_SEI:
+        status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+        break;
+    default:
+        if (nal_is_slice(pi->nalu.type)) {
+            /* IRAP specifics are handled in init_picture() */
+            status = decode_slice(decoder, unit);
+            break;
+        }
+        GST_WARNING("unsupported NAL unit type %d", pi->nalu.type);
+        status = GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+        break;
+    }
+    return status;
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h265_decode_codec_data(GstVaapiDecoder *base_decoder,
+    const guchar *buf, guint buf_size)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiDecoderStatus status;
+    GstVaapiDecoderUnit unit;
+    GstVaapiParserInfoH265 *pi = NULL;
+    GstH265ParserResult result;
+    guint i, j, ofs, num_arrays, num_nals;
+
+    unit.parsed_info = NULL;
+
+    if (buf_size < 23)
+        return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+
+    if (buf[0] != 1) {
+        GST_ERROR("failed to decode codec-data, not in hvcC format");
+        return GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+    }
+
+    priv->nal_length_size = (buf[21] & 0x03) + 1;
+
+    num_arrays = buf[22];
+    ofs = 23;
+
+    for (i = 0; i < num_arrays; i++) {
+        if (ofs + 3 > buf_size) {
+            status = GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+            goto cleanup;
+        }
+        num_nals = GST_READ_UINT16_BE(buf + ofs + 1);
+        ofs += 3;
+
+        for (j = 0; j < num_nals; j++) {
+            pi = gst_vaapi_parser_info_h265_new();
+            if (!pi)
+                return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+            unit.parsed_info = pi;
+
+            result = gst_h265_parser_identify_nalu_hevc(
+                priv->parser,
+                buf, ofs, buf_size, 2,
+                &pi->nalu
+            );
+            if (result != GST_H265_PARSER_OK) {
+                status = get_status(result);
+                goto cleanup;
+            }
+
+            switch (pi->nalu.type) {
+            case GST_H265_NAL_VPS:
+                status = parse_vps(decoder, &unit);
+                if (status == GST_VAAPI_DECODER_STATUS_SUCCESS)
+                    status = decode_vps(decoder, &unit);
+                break;
+            case GST_H265_NAL_SPS:
+                status = parse_sps(decoder, &unit);
+                if (status == GST_VAAPI_DECODER_STATUS_SUCCESS)
+                    status = decode_sps(decoder, &unit);
+                break;
+            case GST_H265_NAL_PPS:
+                status = parse_pps(decoder, &unit);
+                if (status == GST_VAAPI_DECODER_STATUS_SUCCESS)
+                    status = decode_pps(decoder, &unit);
+                break;
+            default:
+                /* SEI messages are not needed for decoding */
+                status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+                break;
+            }
+            if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+                goto cleanup;
+            ofs = pi->nalu.offset + pi->nalu.size;
+            gst_vaapi_parser_info_h265_replace(&pi, NULL);
+        }
+    }
+
+    priv->is_hvcC = TRUE;
+    status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+cleanup:
+    gst_vaapi_parser_info_h265_replace(&pi, NULL);
+    return status;
+}
+
+static GstVaapiDecoderStatus
+ensure_decoder(GstVaapiDecoderH265 *decoder)
+{
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiDecoderStatus status;
+
+    if (!priv->is_opened) {
+        priv->is_opened = gst_vaapi_decoder_h265_open(decoder);
+        if (!priv->is_opened)
+            return GST_VAAPI_DECODER_STATUS_ERROR_UNSUPPORTED_CODEC;
+
+        status = gst_vaapi_decoder_decode_codec_data(
+            GST_VAAPI_DECODER_CAST(decoder));
+        if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+            return status;
+    }
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h265_prepare(GstVaapiDecoder *base_decoder)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+
+    return ensure_decoder(decoder);
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h265_parse(GstVaapiDecoder *base_decoder,
+    GstAdapter *adapter, gboolean at_eos, GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+    GstVaapiDecoderH265Private * const priv = &decoder->priv;
+    GstVaapiParserState * const ps = GST_VAAPI_PARSER_STATE(base_decoder);
+    GstVaapiParserInfoH265 *pi;
+    GstVaapiDecoderStatus status;
+    GstH265ParserResult result;
+    guchar *buf;
+    guint i, size, buf_size, nalu_size, flags;
+    guint32 start_code;
+    gint ofs, ofs2;
+    gboolean at_au_end = FALSE;
+
+    status = ensure_decoder(decoder);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        return status;
+
+    switch (priv->stream_alignment) {
+    case GST_VAAPI_STREAM_ALIGN_H265_NALU:
+    case GST_VAAPI_STREAM_ALIGN_H265_AU:
+        size = gst_adapter_available_fast(adapter);
+        break;
+    default:
+        size = gst_adapter_available(adapter);
+        break;
+    }
+
+    if (priv->is_hvcC) {
+        if (size < priv->nal_length_size)
+            return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+
+        buf = (guchar *)&start_code;
+        g_assert(priv->nal_length_size <= sizeof(start_code));
+        gst_adapter_copy(adapter, buf, 0, priv->nal_length_size);
+
+        nalu_size = 0;
+        for (i = 0; i < priv->nal_length_size; i++)
+            nalu_size = (nalu_size << 8) | buf[i];
+
+        buf_size = priv->nal_length_size + nalu_size;
+        if (size < buf_size)
+            return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+        else if (priv->stream_alignment == GST_VAAPI_STREAM_ALIGN_H265_AU)
+            at_au_end = (buf_size == size);
+    }
+    else {
+        if (size < 4)
+            return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+
+        if (priv->stream_alignment == GST_VAAPI_STREAM_ALIGN_H265_NALU)
+            buf_size = size;
+        else {
+            ofs = scan_for_start_code(adapter, 0, size, NULL);
+            if (ofs < 0)
+                return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+
+            if (ofs > 0) {
+                gst_adapter_flush(adapter, ofs);
+                size -= ofs;
+            }
+
+            ofs2 = ps->input_offset2 - ofs - 4;
+            if (ofs2 < 4)
+                ofs2 = 4;
+
+            ofs = G_UNLIKELY(size < ofs2 + 4) ? -1 :
+                scan_for_start_code(adapter, ofs2, size - ofs2, NULL);
+            if (ofs < 0) {
+                // Assume the whole NAL unit is present if end-of-stream
+                // or stream buffers aligned on access unit boundaries
+                if (priv->stream_alignment == GST_VAAPI_STREAM_ALIGN_H265_AU)
+                    at_au_end = TRUE;
+                else if (!at_eos) {
+                    ps->input_offset2 = size;
+                    return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+                }
+                ofs = size;
+            }
+            buf_size = ofs;
+        }
+    }
+    ps->input_offset2 = 0;
+
+    buf = (guchar *)gst_adapter_map(adapter, buf_size);
+    if (!buf)
+        return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+
+    unit->size = buf_size;
+
+    pi = gst_vaapi_parser_info_h265_new();
+    if (!pi)
+        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+
+    gst_vaapi_decoder_unit_set_parsed_info(unit,
+        pi, (GDestroyNotify)gst_vaapi_mini_object_unref);
+
+    if (priv->is_hvcC)
+        result = gst_h265_parser_identify_nalu_hevc(priv->parser,
+            buf, 0, buf_size, priv->nal_length_size, &pi->nalu);
+    else
+        result = gst_h265_parser_identify_nalu_unchecked(priv->parser,
+            buf, 0, buf_size, &pi->nalu);
+    status = get_status(result);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        return status;
+
+    switch (pi->nalu.type) {
+    case GST_H265_NAL_VPS:
+        status = parse_vps(decoder, unit);
+        break;
+    case GST_H265_NAL_SPS:
+        status = parse_sps(decoder, unit);
+        break;
+    case GST_H265_NAL_PPS:
+        status = parse_pps(decoder, unit);
+        break;
+    case GST_H265_NAL_PREFIX_SEI:
+        status = parse_sei(decoder, unit);
+        break;
+    default:
+        if (nal_is_slice(pi->nalu.type))
+            status = parse_slice(decoder, unit);
+        else
+            status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+        break;
+    }
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        return status;
+
+    flags = 0;
+    if (at_au_end) {
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_END |
+            GST_VAAPI_DECODER_UNIT_FLAG_AU_END;
+    }
+    switch (pi->nalu.type) {
+    case GST_H265_NAL_AUD:
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_START;
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
+        /* fall-through */
+    case GST_H265_NAL_FD:
+    case GST_H265_NAL_SUFFIX_SEI:
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_SKIP;
+        break;
+    case GST_H265_NAL_EOB:
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_STREAM_END;
+        /* fall-through */
+    case GST_H265_NAL_EOS:
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_END;
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_END;
+        break;
+    case GST_H265_NAL_VPS:
+    case GST_H265_NAL_SPS:
+    case GST_H265_NAL_PPS:
+    case GST_H265_NAL_PREFIX_SEI:
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_START;
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
+        break;
+    default:
+        if (!nal_is_slice(pi->nalu.type))
+            break;
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
+        if (priv->prev_pi &&
+            (priv->prev_pi->flags & GST_VAAPI_DECODER_UNIT_FLAG_AU_END)) {
+            flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_START |
+                GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
+        }
+        else if (is_new_picture(pi, priv->prev_slice_pi)) {
+            /* An access unit holds a single picture */
+            flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_START |
+                GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
+        }
+        gst_vaapi_parser_info_h265_replace(&priv->prev_slice_pi, pi);
+        break;
+    }
+    if ((flags & GST_VAAPI_DECODER_UNIT_FLAGS_AU) && priv->prev_slice_pi)
+        priv->prev_slice_pi->flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_END;
+    GST_VAAPI_DECODER_UNIT_FLAG_SET(unit, flags);
+
+    pi->nalu.data = NULL;
+    pi->state = priv->parser_state;
+    pi->flags = flags;
+    gst_vaapi_parser_info_h265_replace(&priv->prev_pi, pi);
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h265_decode(GstVaapiDecoder *base_decoder,
+    GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+    GstVaapiDecoderStatus status;
+
+    status = ensure_decoder(decoder);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        return status;
+    return decode_unit(decoder, unit);
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h265_start_frame(GstVaapiDecoder *base_decoder,
+    GstVaapiDecoderUnit *unit)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+
+    return decode_picture(decoder, unit);
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h265_end_frame(GstVaapiDecoder *base_decoder)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+
+    return decode_current_picture(decoder);
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_h265_flush(GstVaapiDecoder *base_decoder)
+{
+    GstVaapiDecoderH265 * const decoder =
+        GST_VAAPI_DECODER_H265_CAST(base_decoder);
+
+    dpb_flush(decoder);
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static void
+gst_vaapi_decoder_h265_class_init(GstVaapiDecoderH265Class *klass)
+{
+    GstVaapiMiniObjectClass * const object_class =
+        GST_VAAPI_MINI_OBJECT_CLASS(klass);
+    GstVaapiDecoderClass * const decoder_class = GST_VAAPI_DECODER_CLASS(klass);
+
+    object_class->size          = sizeof(GstVaapiDecoderH265);
+    object_class->finalize      = (GDestroyNotify)gst_vaapi_decoder_finalize;
+
+    decoder_class->create       = gst_vaapi_decoder_h265_create;
+    decoder_class->destroy      = gst_vaapi_decoder_h265_destroy;
+    decoder_class->parse        = gst_vaapi_decoder_h265_parse;
+    decoder_class->decode       = gst_vaapi_decoder_h265_decode;
+    decoder_class->start_frame  = gst_vaapi_decoder_h265_start_frame;
+    decoder_class->end_frame    = gst_vaapi_decoder_h265_end_frame;
+    decoder_class->flush        = gst_vaapi_decoder_h265_flush;
+
+    decoder_class->decode_codec_data =
+        gst_vaapi_decoder_h265_decode_codec_data;
+    decoder_class->prepare      = gst_vaapi_decoder_h265_prepare;
+}
+
+static inline const GstVaapiDecoderClass *
+gst_vaapi_decoder_h265_class(void)
+{
+    static GstVaapiDecoderH265Class g_class;
+    static gsize g_class_init = FALSE;
+
+    if (g_once_init_enter(&g_class_init)) {
+        gst_vaapi_decoder_h265_class_init(&g_class);
+        g_once_init_leave(&g_class_init, TRUE);
+    }
+    return GST_VAAPI_DECODER_CLASS(&g_class);
+}
+
+/**
+ * gst_vaapi_decoder_h265_set_alignment:
+ * @decoder: a #GstVaapiDecoderH265
+ * @alignment: the #GstVaapiStreamAlignH265
+ *
+ * Specifies how stream buffers are aligned / fed, i.e. the boundaries
+ * of each buffer that is supplied to the decoder. This could be no
+ * specific alignment, NAL unit boundaries, or access unit boundaries.
+ */
+void
+gst_vaapi_decoder_h265_set_alignment(GstVaapiDecoderH265 *decoder,
+    GstVaapiStreamAlignH265 alignment)
+{
+    g_return_if_fail(decoder != NULL);
+
+    decoder->priv.stream_alignment = alignment;
+}
+
+/**
+ * gst_vaapi_decoder_h265_new:
+ * @display: a #GstVaapiDisplay
+ * @caps: a #GstCaps holding codec information
+ *
+ * Creates a new #GstVaapiDecoder for H.265 decoding.  The @caps can
+ * hold extra information like codec-data and pictured coded size.
+ *
+ * Return value: the newly allocated #GstVaapiDecoder object
+ */
+GstVaapiDecoder *
+gst_vaapi_decoder_h265_new(GstVaapiDisplay *display, GstCaps *caps)
+{
+    return gst_vaapi_decoder_new(gst_vaapi_decoder_h265_class(), display, caps);
+}
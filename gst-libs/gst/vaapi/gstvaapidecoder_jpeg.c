@@ -31,6 +31,7 @@
 #include <gst/codecparsers/gstjpegparser.h>
 #include "gstvaapicompat.h"
 #include "gstvaapidecoder_jpeg.h"
+#include "gstvaapidecoder_jpeg_priv.h"
 #include "gstvaapidecoder_objects.h"
 #include "gstvaapidecoder_priv.h"
 #include "gstvaapidisplay_priv.h"
@@ -66,15 +67,27 @@ struct _GstVaapiDecoderJpegPrivate {
     GstVaapiProfile             profile;
     guint                       width;
     guint                       height;
+    guint                       context_width;
+    guint                       context_height;
+    guint                       min_context_width;
+    guint                       min_context_height;
     GstVaapiPicture            *current_picture;
     GstJpegFrameHdr             frame_hdr;
     GstJpegHuffmanTables        huf_tables;
     GstJpegQuantTables          quant_tables;
+    GstJpegHuffmanTables        last_huf_tables;
+    GstJpegQuantTables          last_quant_tables;
+    VAHuffmanTableBufferJPEGBaseline huf_param;
+    VAIQMatrixBufferJPEGBaseline iq_param;
+    GstVaapiDecoderJpegTableStats table_stats;
     guint                       mcu_restart;
     guint                       parser_state;
     guint                       decoder_state;
     guint                       is_opened       : 1;
     guint                       profile_changed : 1;
+    guint                       is_frame_aligned : 1;
+    guint                       has_huf_param   : 1;
+    guint                       has_iq_param    : 1;
 };
 
 /**
@@ -121,6 +134,8 @@ gst_vaapi_decoder_jpeg_close(GstVaapiDecoderJpeg *decoder)
     priv->profile               = GST_VAAPI_PROFILE_JPEG_BASELINE;
     priv->width                 = 0;
     priv->height                = 0;
+    priv->context_width         = 0;
+    priv->context_height        = 0;
     priv->is_opened             = FALSE;
     priv->profile_changed       = TRUE;
 }
@@ -165,6 +180,7 @@ ensure_context(GstVaapiDecoderJpeg *decoder)
     GstVaapiProfile profiles[2];
     GstVaapiEntrypoint entrypoint = GST_VAAPI_ENTRYPOINT_VLD;
     guint i, n_profiles = 0;
+    guint width, height;
     gboolean reset_context = FALSE;
 
     if (priv->profile_changed) {
@@ -186,14 +202,21 @@ ensure_context(GstVaapiDecoderJpeg *decoder)
         priv->profile = profiles[i];
     }
 
+    width  = MAX(priv->width, priv->min_context_width);
+    height = MAX(priv->height, priv->min_context_height);
+    if (width > priv->context_width || height > priv->context_height) {
+        GST_DEBUG("size changed");
+        reset_context = TRUE;
+    }
+
     if (reset_context) {
         GstVaapiContextInfo info;
 
         info.profile    = priv->profile;
         info.entrypoint = entrypoint;
         info.chroma_type = GST_VAAPI_CHROMA_TYPE_YUV420;
-        info.width      = priv->width;
-        info.height     = priv->height;
+        info.width      = width;
+        info.height     = height;
         info.ref_frames = 2;
         reset_context   = gst_vaapi_decoder_ensure_context(
             GST_VAAPI_DECODER(decoder),
@@ -201,6 +224,8 @@ ensure_context(GstVaapiDecoderJpeg *decoder)
         );
         if (!reset_context)
             return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+        priv->context_width  = info.width;
+        priv->context_height = info.height;
     }
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
@@ -283,7 +308,28 @@ fill_quantization_table(GstVaapiDecoderJpeg *decoder, GstVaapiPicture *picture)
 
     if (!VALID_STATE(decoder, GOT_IQ_TABLE))
         gst_jpeg_get_default_quantization_tables(&priv->quant_tables);
-    
+
+    num_tables = MIN(G_N_ELEMENTS(iq_matrix->quantiser_table),
+                     GST_JPEG_MAX_QUANT_ELEMENTS);
+
+    // Reuse the last VA quantiser table if the parsed tables are the same
+    if (priv->has_iq_param && memcmp(&priv->quant_tables,
+            &priv->last_quant_tables, sizeof(priv->quant_tables)) == 0) {
+        picture->iq_matrix = gst_vaapi_iq_matrix_new(
+            GST_VAAPI_DECODER_CAST(decoder), &priv->iq_param,
+            sizeof(priv->iq_param));
+        if (!picture->iq_matrix) {
+            GST_ERROR("failed to allocate quantiser table");
+            return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+        }
+        for (i = 0; i < num_tables; i++)
+            priv->quant_tables.quant_tables[i].valid = FALSE;
+        priv->table_stats.num_quant_hits++;
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    }
+    priv->last_quant_tables = priv->quant_tables;
+    priv->has_iq_param = FALSE;
+
     picture->iq_matrix = GST_VAAPI_IQ_MATRIX_NEW(JPEGBaseline, decoder);
     if (!picture->iq_matrix) {
         GST_ERROR("failed to allocate quantiser table");
@@ -291,9 +337,6 @@ fill_quantization_table(GstVaapiDecoderJpeg *decoder, GstVaapiPicture *picture)
     }
     iq_matrix = picture->iq_matrix->param;
 
-    num_tables = MIN(G_N_ELEMENTS(iq_matrix->quantiser_table),
-                     GST_JPEG_MAX_QUANT_ELEMENTS);
-
     for (i = 0; i < num_tables; i++) {
         GstJpegQuantTable * const quant_table =
             &priv->quant_tables.quant_tables[i];
@@ -313,6 +356,9 @@ fill_quantization_table(GstVaapiDecoderJpeg *decoder, GstVaapiPicture *picture)
         iq_matrix->load_quantiser_table[i] = 1;
         quant_table->valid = FALSE;
     }
+    priv->iq_param = *iq_matrix;
+    priv->has_iq_param = TRUE;
+    priv->table_stats.num_quant_misses++;
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
@@ -375,6 +421,35 @@ fill_huffman_table(GstVaapiHuffmanTable *huf_table,
     }
 }
 
+static GstVaapiHuffmanTable *
+huffman_table_new(GstVaapiDecoderJpeg *decoder)
+{
+    GstVaapiDecoderJpegPrivate * const priv = &decoder->priv;
+    GstVaapiHuffmanTable *huf_table;
+
+    // Reuse the last VA Huffman table if the parsed tables are the same
+    if (priv->has_huf_param && memcmp(&priv->huf_tables,
+            &priv->last_huf_tables, sizeof(priv->huf_tables)) == 0) {
+        huf_table = gst_vaapi_huffman_table_new(
+            GST_VAAPI_DECODER_CAST(decoder), (guint8 *)&priv->huf_param,
+            sizeof(priv->huf_param));
+        if (huf_table)
+            priv->table_stats.num_huffman_hits++;
+        return huf_table;
+    }
+
+    huf_table = GST_VAAPI_HUFFMAN_TABLE_NEW(JPEGBaseline, decoder);
+    if (!huf_table)
+        return NULL;
+    fill_huffman_table(huf_table, &priv->huf_tables);
+
+    priv->last_huf_tables = priv->huf_tables;
+    priv->huf_param = *(VAHuffmanTableBufferJPEGBaseline *)huf_table->param;
+    priv->has_huf_param = TRUE;
+    priv->table_stats.num_huffman_misses++;
+    return huf_table;
+}
+
 static void
 get_max_sampling_factors(const GstJpegFrameHdr *frame_hdr,
     guint *h_max_ptr, guint *v_max_ptr)
@@ -539,13 +614,12 @@ decode_scan(GstVaapiDecoderJpeg *decoder, GstJpegMarkerSegment *seg,
 
     // Update VA Huffman table if it changed for this scan
     if (huffman_tables_updated(&priv->huf_tables)) {
-        slice->huf_table = GST_VAAPI_HUFFMAN_TABLE_NEW(JPEGBaseline, decoder);
+        slice->huf_table = huffman_table_new(decoder);
         if (!slice->huf_table) {
             GST_ERROR("failed to allocate Huffman tables");
             huffman_tables_reset(&priv->huf_tables);
             return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
         }
-        fill_huffman_table(slice->huf_table, &priv->huf_tables);
         huffman_tables_reset(&priv->huf_tables);
     }
 
@@ -650,6 +724,148 @@ is_scan_complete(GstJpegMarkerCode marker)
     return marker < GST_JPEG_MARKER_RST_MIN || marker > GST_JPEG_MARKER_RST_MAX;
 }
 
+/* Extends the SOS segment to the entropy-coded data of the scan,
+   including any RSTi marker. A truncated scan extends to the end of
+   the frame */
+static void
+get_scan_size(GstJpegMarkerSegment *seg, const guchar *buf, guint buf_size)
+{
+    GstJpegMarkerSegment next_seg;
+    guint ofs = seg->offset + seg->size;
+
+    for (;;) {
+        if (!gst_jpeg_parse(&next_seg, buf, buf_size, ofs)) {
+            seg->size = buf_size - seg->offset;
+            return;
+        }
+        if (is_scan_complete(next_seg.marker))
+            break;
+        ofs = next_seg.offset + next_seg.size;
+    }
+    seg->size = next_seg.offset - 2 - seg->offset;
+}
+
+static GstVaapiDecoderStatus
+start_picture(GstVaapiDecoderJpeg *decoder)
+{
+    GstVaapiDecoderJpegPrivate * const priv = &decoder->priv;
+    GstVaapiPicture *picture;
+    GstVaapiDecoderStatus status;
+
+    if (!VALID_STATE(decoder, GOT_SOF))
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+    status = ensure_context(decoder);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
+        GST_ERROR("failed to reset context");
+        return status;
+    }
+
+    picture = GST_VAAPI_PICTURE_NEW(JPEGBaseline, decoder);
+    if (!picture) {
+        GST_ERROR("failed to allocate picture");
+        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+    gst_vaapi_picture_replace(&priv->current_picture, picture);
+    gst_vaapi_picture_unref(picture);
+
+    /* Pictures smaller than the context only cover the top-left area */
+    if (priv->width < priv->context_width ||
+        priv->height < priv->context_height) {
+        GstVaapiRectangle crop_rect;
+
+        crop_rect.x = 0;
+        crop_rect.y = 0;
+        crop_rect.width = priv->width;
+        crop_rect.height = priv->height;
+        gst_vaapi_picture_set_crop_rect(picture, &crop_rect);
+    }
+
+    if (!fill_picture(decoder, picture, &priv->frame_hdr))
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+
+    status = fill_quantization_table(decoder, picture);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+        return status;
+
+    /* Update presentation time */
+    picture->pts = GST_VAAPI_DECODER_CODEC_FRAME(decoder)->pts;
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+/* Decodes a whole frame-aligned JPEG image in a single pass, i.e. all
+   segments up to EOI, which is left to the end_frame() hook */
+static GstVaapiDecoderStatus
+decode_frame(GstVaapiDecoderJpeg *decoder, const guchar *buf, guint buf_size)
+{
+    GstVaapiDecoderJpegPrivate * const priv = &decoder->priv;
+    GstVaapiDecoderStatus status;
+    GstJpegMarkerSegment seg;
+    guint ofs = 0;
+
+    /* Discard any leftover from a previous frame that failed to decode */
+    gst_vaapi_picture_replace(&priv->current_picture, NULL);
+    priv->decoder_state = 0;
+
+    while (gst_jpeg_parse(&seg, buf, buf_size, ofs)) {
+        if (seg.marker == GST_JPEG_MARKER_EOI)
+            break;
+        if (seg.offset + seg.size > buf_size) {
+            GST_ERROR("truncated segment %d", seg.marker);
+            return GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+        }
+
+        if (seg.marker == GST_JPEG_MARKER_SOS) {
+            get_scan_size(&seg, buf, buf_size);
+            if (!priv->current_picture) {
+                status = start_picture(decoder);
+                if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+                    return status;
+            }
+            if (!priv->current_picture)
+                break;
+        }
+
+        status = decode_segment(decoder, &seg, buf);
+        if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+            return status;
+        ofs = seg.offset + seg.size;
+    }
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+/* Submits the first buffer in the adapter as a whole frame, without
+   looking for any segment boundary. Returns FALSE if that buffer does
+   not start with SOI, i.e. if the input is not frame-aligned */
+static gboolean
+parse_frame(GstVaapiDecoderJpeg *decoder, GstAdapter *adapter,
+    GstVaapiDecoderUnit *unit)
+{
+    guint buf_size;
+
+    buf_size = gst_adapter_available_fast(adapter);
+    if (buf_size < 4)
+        return FALSE;
+    if (gst_adapter_masked_scan_uint32(adapter, 0xffff0000,
+            0xff000000 | (GST_JPEG_MARKER_SOI << 16), 0, 4) != 0)
+        return FALSE;
+
+    unit->size = buf_size;
+    unit_set_marker_code(unit, GST_JPEG_MARKER_SOI);
+    GST_VAAPI_DECODER_UNIT_FLAG_SET(unit,
+        GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START |
+        GST_VAAPI_DECODER_UNIT_FLAG_FRAME_END |
+        GST_VAAPI_DECODER_UNIT_FLAG_SLICE);
+    return TRUE;
+}
+
+static inline gboolean
+unit_is_frame(GstVaapiDecoderUnit *unit)
+{
+    return GST_VAAPI_DECODER_UNIT_IS_FRAME_START(unit) &&
+        GST_VAAPI_DECODER_UNIT_IS_FRAME_END(unit);
+}
+
 static GstVaapiDecoderStatus
 gst_vaapi_decoder_jpeg_parse(GstVaapiDecoder *base_decoder,
     GstAdapter *adapter, gboolean at_eos, GstVaapiDecoderUnit *unit)
@@ -669,6 +885,10 @@ gst_vaapi_decoder_jpeg_parse(GstVaapiDecoder *base_decoder,
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
         return status;
 
+    if (priv->is_frame_aligned && priv->parser_state == 0 &&
+        parse_frame(decoder, adapter, unit))
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
     /* Expect at least 2 bytes for the marker */
     buf_size = gst_adapter_available(adapter);
     if (buf_size < 2)
@@ -804,11 +1024,15 @@ gst_vaapi_decoder_jpeg_decode(GstVaapiDecoder *base_decoder,
         return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
     }
 
-    seg.marker = unit_get_marker_code(unit);
-    seg.offset = unit->offset;
-    seg.size = unit->size;
-
-    status = decode_segment(decoder, &seg, map_info.data);
+    if (unit_is_frame(unit))
+        status = decode_frame(decoder, map_info.data + unit->offset,
+            unit->size);
+    else {
+        seg.marker = unit_get_marker_code(unit);
+        seg.offset = unit->offset;
+        seg.size = unit->size;
+        status = decode_segment(decoder, &seg, map_info.data);
+    }
     gst_buffer_unmap(buffer, &map_info);
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
         return status;
@@ -821,37 +1045,11 @@ gst_vaapi_decoder_jpeg_start_frame(GstVaapiDecoder *base_decoder,
 {
     GstVaapiDecoderJpeg * const decoder =
         GST_VAAPI_DECODER_JPEG_CAST(base_decoder);
-    GstVaapiDecoderJpegPrivate * const priv = &decoder->priv;
-    GstVaapiPicture *picture;
-    GstVaapiDecoderStatus status;
 
-    if (!VALID_STATE(decoder, GOT_SOF))
+    /* Frame headers are not decoded yet, see decode_frame() */
+    if (unit_is_frame(base_unit))
         return GST_VAAPI_DECODER_STATUS_SUCCESS;
-
-    status = ensure_context(decoder);
-    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
-        GST_ERROR("failed to reset context");
-        return status;
-    }
-
-    picture = GST_VAAPI_PICTURE_NEW(JPEGBaseline, decoder);
-    if (!picture) {
-        GST_ERROR("failed to allocate picture");
-        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
-    }
-    gst_vaapi_picture_replace(&priv->current_picture, picture);
-    gst_vaapi_picture_unref(picture);
-
-    if (!fill_picture(decoder, picture, &priv->frame_hdr))
-        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
-
-    status = fill_quantization_table(decoder, picture);
-    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
-        return status;
-
-    /* Update presentation time */
-    picture->pts = GST_VAAPI_DECODER_CODEC_FRAME(decoder)->pts;
-    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    return start_picture(decoder);
 }
 
 static GstVaapiDecoderStatus
@@ -894,6 +1092,62 @@ gst_vaapi_decoder_jpeg_class(void)
     return GST_VAAPI_DECODER_CLASS(&g_class);
 }
 
+/**
+ * gst_vaapi_decoder_jpeg_set_frame_aligned:
+ * @decoder: a #GstVaapiDecoderJpeg
+ * @frame_aligned: %TRUE if each buffer holds exactly one JPEG image
+ *
+ * Specifies whether stream buffers are aligned on image boundaries,
+ * e.g. for MJPEG streams from jpegparse or from cameras. In that case,
+ * each buffer is submitted as a single unit and all segments of the
+ * image are decoded in one pass. Buffers that do not start with an
+ * SOI marker are still parsed segment by segment.
+ */
+void
+gst_vaapi_decoder_jpeg_set_frame_aligned(GstVaapiDecoderJpeg *decoder,
+    gboolean frame_aligned)
+{
+    g_return_if_fail(decoder != NULL);
+
+    decoder->priv.is_frame_aligned = frame_aligned;
+}
+
+/* Creates the VA context for pictures up to @width x @height right away,
+   and keeps it for all smaller pictures. Larger pictures still cause
+   the context to be reset */
+gboolean
+gst_vaapi_decoder_jpeg_set_context_size(GstVaapiDecoderJpeg *decoder,
+    guint width, guint height)
+{
+    GstVaapiDecoderJpegPrivate * const priv = &decoder->priv;
+
+    g_return_val_if_fail(decoder != NULL, FALSE);
+
+    priv->min_context_width = width;
+    priv->min_context_height = height;
+    return ensure_context(decoder) == GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_get_table_stats:
+ * @decoder: a #GstVaapiDecoderJpeg
+ * @stats: (out caller-allocates): the #GstVaapiDecoderJpegTableStats
+ *
+ * Retrieves how many VA Huffman and quantization tables were built
+ * from the parsed DHT and DQT segments, and how many were reused from
+ * the previous scan or picture because they did not change. Most MJPEG
+ * cameras repeat the same tables in every frame.
+ */
+void
+gst_vaapi_decoder_jpeg_get_table_stats(GstVaapiDecoderJpeg *decoder,
+    GstVaapiDecoderJpegTableStats *stats)
+{
+    g_return_if_fail(decoder != NULL);
+    g_return_if_fail(stats != NULL);
+
+    *stats = decoder->priv.table_stats;
+}
+
 /**
  * gst_vaapi_decoder_jpeg_new:
  * @display: a #GstVaapiDisplay
@@ -28,11 +28,40 @@
 
 G_BEGIN_DECLS
 
+#define GST_VAAPI_DECODER_JPEG(decoder) \
+    ((GstVaapiDecoderJpeg *)(decoder))
+
 typedef struct _GstVaapiDecoderJpeg             GstVaapiDecoderJpeg;
+typedef struct _GstVaapiDecoderJpegTableStats   GstVaapiDecoderJpegTableStats;
+
+/**
+ * GstVaapiDecoderJpegTableStats:
+ * @num_huffman_hits: the number of VA Huffman tables reused as is
+ * @num_huffman_misses: the number of VA Huffman tables built
+ * @num_quant_hits: the number of VA quantization tables reused as is
+ * @num_quant_misses: the number of VA quantization tables built
+ *
+ * Statistics about the reuse of unchanged JPEG tables across scans
+ * and pictures.
+ */
+struct _GstVaapiDecoderJpegTableStats {
+    guint num_huffman_hits;
+    guint num_huffman_misses;
+    guint num_quant_hits;
+    guint num_quant_misses;
+};
 
 GstVaapiDecoder *
 gst_vaapi_decoder_jpeg_new(GstVaapiDisplay *display, GstCaps *caps);
 
+void
+gst_vaapi_decoder_jpeg_set_frame_aligned(GstVaapiDecoderJpeg *decoder,
+    gboolean frame_aligned);
+
+void
+gst_vaapi_decoder_jpeg_get_table_stats(GstVaapiDecoderJpeg *decoder,
+    GstVaapiDecoderJpegTableStats *stats);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DECODER_JPEG_H */
@@ -0,0 +1,564 @@
+/*
+ *  gstvaapidecoder_jpeg_batch.c - Batched JPEG still images decoder
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapidecoder_jpeg_batch
+ * @short_description: Batched JPEG still images decoder
+ *
+ * A #GstVaapiDecoderJpegBatch decodes many independent JPEG images of
+ * various sizes, e.g. for thumbnailing. Images are grouped by size
+ * class, each size class being decoded with its own VA context and
+ * surfaces that are kept from one batch to the next, so that images
+ * of different sizes do not cause VA contexts to be re-created. All
+ * images of a batch are submitted to the hardware before any of them
+ * needs to be waited for.
+ *
+ * A #GstVaapiDecoderJpegBatch shall only be used from a single thread.
+ */
+
+#include "sysdeps.h"
+#include <string.h>
+#include <gst/codecparsers/gstjpegparser.h>
+#include "gstvaapidecoder_jpeg_batch.h"
+#include "gstvaapidecoder_jpeg_priv.h"
+#include "gstvaapiminiobject.h"
+#include "gstvaapisurface.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/* Maximum number of size classes, i.e. of VA contexts, kept around */
+#define MAX_SIZE_CLASSES 4
+
+typedef struct _SizeClass                       SizeClass;
+typedef struct _BatchImage                      BatchImage;
+
+struct _SizeClass {
+    guint                       width;
+    guint                       height;
+    GstVaapiDecoder            *decoder;
+    guint                       last_used;
+};
+
+struct _BatchImage {
+    guint                       index;
+    SizeClass                  *size_class;
+    GstVaapiSurfaceProxy       *proxy;
+    GstVaapiDecoderStatus       status;
+};
+
+/**
+ * GstVaapiDecoderJpegBatch:
+ *
+ * A batched JPEG still images decoder.
+ */
+struct _GstVaapiDecoderJpegBatch {
+    /*< private >*/
+    GstVaapiMiniObject          parent_instance;
+
+    GstVaapiDisplay            *display;
+    guint                       capacity;
+    SizeClass                   size_classes[MAX_SIZE_CLASSES];
+    guint                       num_size_classes;
+    guint                       num_submitted;
+    guint                       serial;
+    GQueue                      pending;
+};
+
+/* Rounds @size up to the next multiple of an eighth of the enclosing
+   power of two, e.g. 600 -> 640, 1000 -> 1024, 1100 -> 1280. This
+   bounds the amount of wasted surface memory to 25% per dimension */
+static guint
+get_size_class(guint size)
+{
+    guint step;
+
+    if (size <= 128)
+        return GST_ROUND_UP_16(size);
+    step = (1U << g_bit_storage(size - 1)) / 8;
+    return GST_ROUND_UP_N(size, step);
+}
+
+static gboolean
+parse_image_size(GstBuffer *buffer, guint *width_ptr, guint *height_ptr)
+{
+    GstMapInfo map_info;
+    GstJpegMarkerSegment seg;
+    GstJpegFrameHdr frame_hdr;
+    gboolean found = FALSE;
+    guint ofs = 0;
+
+    if (!gst_buffer_map(buffer, &map_info, GST_MAP_READ))
+        return FALSE;
+
+    memset(&frame_hdr, 0, sizeof(frame_hdr));
+    while (gst_jpeg_parse(&seg, map_info.data, map_info.size, ofs)) {
+        if (seg.marker == GST_JPEG_MARKER_SOS ||
+            seg.marker == GST_JPEG_MARKER_EOI)
+            break;
+        if (seg.size < 0 || seg.offset + seg.size > map_info.size)
+            break;
+        if (seg.marker >= GST_JPEG_MARKER_SOF_MIN &&
+            seg.marker <= GST_JPEG_MARKER_SOF_MAX &&
+            seg.marker != GST_JPEG_MARKER_DHT &&
+            seg.marker != GST_JPEG_MARKER_DAC) {
+            found = gst_jpeg_parse_frame_hdr(&frame_hdr,
+                map_info.data + seg.offset, seg.size, 0);
+            break;
+        }
+        ofs = seg.offset + seg.size;
+    }
+    gst_buffer_unmap(buffer, &map_info);
+
+    if (!found || !frame_hdr.width || !frame_hdr.height)
+        return FALSE;
+    *width_ptr = frame_hdr.width;
+    *height_ptr = frame_hdr.height;
+    return TRUE;
+}
+
+static gboolean
+size_class_configure(SizeClass *size_class, GstVaapiDecoderJpegBatch *batch,
+    guint width, guint height)
+{
+    GstVaapiDecoder *decoder;
+    GstCaps *caps;
+
+    size_class->width = width;
+    size_class->height = height;
+
+    if (!size_class->decoder) {
+        caps = gst_caps_new_simple("image/jpeg",
+            "width", G_TYPE_INT, width,
+            "height", G_TYPE_INT, height, NULL);
+        if (!caps)
+            return FALSE;
+        decoder = gst_vaapi_decoder_jpeg_new(batch->display, caps);
+        gst_caps_unref(caps);
+        if (!decoder)
+            return FALSE;
+
+        /* Each image is submitted as a whole, and up to capacity decoded
+           surfaces are held until the caller collects them */
+        gst_vaapi_decoder_jpeg_set_frame_aligned(
+            GST_VAAPI_DECODER_JPEG(decoder), TRUE);
+        gst_vaapi_decoder_set_extra_surfaces(decoder, batch->capacity);
+        size_class->decoder = decoder;
+    }
+
+    if (!gst_vaapi_decoder_jpeg_set_context_size(
+            GST_VAAPI_DECODER_JPEG(size_class->decoder), width, height))
+        goto error_create_context;
+    return TRUE;
+
+    /* ERRORS */
+error_create_context:
+    {
+        GST_ERROR("failed to create VA context for %ux%u images",
+                  width, height);
+        gst_vaapi_decoder_replace(&size_class->decoder, NULL);
+        return FALSE;
+    }
+}
+
+static SizeClass *
+ensure_size_class(GstVaapiDecoderJpegBatch *batch, guint width, guint height)
+{
+    const guint class_width = get_size_class(width);
+    const guint class_height = get_size_class(height);
+    SizeClass *size_class, *best_class = NULL, *lru_class = NULL;
+    guint i;
+
+    for (i = 0; i < batch->num_size_classes; i++) {
+        size_class = &batch->size_classes[i];
+        if (size_class->width == class_width &&
+            size_class->height == class_height)
+            goto found;
+
+        if (!lru_class || size_class->last_used < lru_class->last_used)
+            lru_class = size_class;
+        if (size_class->width < width || size_class->height < height)
+            continue;
+        if (!best_class || size_class->width * size_class->height <
+            best_class->width * best_class->height)
+            best_class = size_class;
+    }
+
+    if (batch->num_size_classes < MAX_SIZE_CLASSES) {
+        size_class = &batch->size_classes[batch->num_size_classes];
+        memset(size_class, 0, sizeof(*size_class));
+        if (!size_class_configure(size_class, batch, class_width, class_height))
+            return NULL;
+        batch->num_size_classes++;
+    }
+    else if (best_class)
+        size_class = best_class;
+    else {
+        /* Grow the least recently used VA context so that it covers
+           both its former images and the new ones */
+        size_class = lru_class;
+        if (!size_class_configure(size_class, batch,
+                MAX(size_class->width, class_width),
+                MAX(size_class->height, class_height)))
+            return NULL;
+    }
+
+found:
+    size_class->last_used = batch->serial;
+    return size_class;
+}
+
+static void
+batch_image_free(BatchImage *image)
+{
+    if (image->proxy)
+        gst_vaapi_surface_proxy_unref(image->proxy);
+    g_slice_free(BatchImage, image);
+}
+
+static gint
+compare_images(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const BatchImage * const image_a = *(const BatchImage **)a;
+    const BatchImage * const image_b = *(const BatchImage **)b;
+
+    if (image_a->size_class != image_b->size_class)
+        return image_a->size_class < image_b->size_class ? -1 : 1;
+    return (gint)image_a->index - (gint)image_b->index;
+}
+
+static void
+decode_image(GstVaapiDecoderJpegBatch *batch, BatchImage *image,
+    GstBuffer *buffer)
+{
+    SizeClass * const size_class = image->size_class;
+
+    if (!size_class->decoder && !size_class_configure(size_class, batch,
+            size_class->width, size_class->height)) {
+        image->status = GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+        return;
+    }
+
+    if (!gst_vaapi_decoder_put_buffer(size_class->decoder, buffer))
+        image->status = GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    else
+        image->status = gst_vaapi_decoder_get_surface(size_class->decoder,
+            &image->proxy);
+
+    /* Drop the decoder along with any leftover of the failed image,
+       it is re-created for the next image of that size class */
+    if (image->status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
+        GST_WARNING("failed to decode image %u (status %d)", image->index,
+                    image->status);
+        if (image->proxy) {
+            gst_vaapi_surface_proxy_unref(image->proxy);
+            image->proxy = NULL;
+        }
+        if (image->status == GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA)
+            image->status = GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+        gst_vaapi_decoder_replace(&size_class->decoder, NULL);
+    }
+}
+
+static void
+gst_vaapi_decoder_jpeg_batch_finalize(GstVaapiDecoderJpegBatch *batch)
+{
+    guint i;
+
+    g_queue_foreach(&batch->pending, (GFunc)batch_image_free, NULL);
+    g_queue_clear(&batch->pending);
+
+    for (i = 0; i < batch->num_size_classes; i++)
+        gst_vaapi_decoder_replace(&batch->size_classes[i].decoder, NULL);
+    gst_vaapi_display_replace(&batch->display, NULL);
+}
+
+static inline const GstVaapiMiniObjectClass *
+gst_vaapi_decoder_jpeg_batch_class(void)
+{
+    static const GstVaapiMiniObjectClass GstVaapiDecoderJpegBatchClass = {
+        sizeof(GstVaapiDecoderJpegBatch),
+        (GDestroyNotify)gst_vaapi_decoder_jpeg_batch_finalize
+    };
+    return &GstVaapiDecoderJpegBatchClass;
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_new:
+ * @display: a #GstVaapiDisplay
+ * @capacity: the maximum number of images in flight
+ *
+ * Creates a new #GstVaapiDecoderJpegBatch. At most @capacity images
+ * can be submitted and not yet collected with
+ * gst_vaapi_decoder_jpeg_batch_get_surface() at any time. Each size
+ * class allocates enough VA surfaces for that many images.
+ *
+ * Return value: the newly allocated #GstVaapiDecoderJpegBatch object
+ */
+GstVaapiDecoderJpegBatch *
+gst_vaapi_decoder_jpeg_batch_new(GstVaapiDisplay *display, guint capacity)
+{
+    GstVaapiDecoderJpegBatch *batch;
+
+    g_return_val_if_fail(display != NULL, NULL);
+    g_return_val_if_fail(capacity > 0, NULL);
+
+    batch = (GstVaapiDecoderJpegBatch *)
+        gst_vaapi_mini_object_new0(gst_vaapi_decoder_jpeg_batch_class());
+    if (!batch)
+        return NULL;
+
+    batch->display = gst_vaapi_display_ref(display);
+    batch->capacity = capacity;
+    g_queue_init(&batch->pending);
+    return batch;
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_ref:
+ * @batch: a #GstVaapiDecoderJpegBatch
+ *
+ * Atomically increases the reference count of the given @batch by one.
+ *
+ * Returns: The same @batch argument
+ */
+GstVaapiDecoderJpegBatch *
+gst_vaapi_decoder_jpeg_batch_ref(GstVaapiDecoderJpegBatch *batch)
+{
+    g_return_val_if_fail(batch != NULL, NULL);
+
+    return (GstVaapiDecoderJpegBatch *)
+        gst_vaapi_mini_object_ref(GST_VAAPI_MINI_OBJECT(batch));
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_unref:
+ * @batch: a #GstVaapiDecoderJpegBatch
+ *
+ * Atomically decreases the reference count of the @batch by one. If
+ * the reference count reaches zero, the @batch will be free'd, along
+ * with the surfaces that were not collected yet.
+ */
+void
+gst_vaapi_decoder_jpeg_batch_unref(GstVaapiDecoderJpegBatch *batch)
+{
+    g_return_if_fail(batch != NULL);
+
+    gst_vaapi_mini_object_unref(GST_VAAPI_MINI_OBJECT(batch));
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_replace:
+ * @old_batch_ptr: a pointer to a #GstVaapiDecoderJpegBatch
+ * @new_batch: a #GstVaapiDecoderJpegBatch
+ *
+ * Atomically replaces the batch held in @old_batch_ptr with
+ * @new_batch. This means that @old_batch_ptr shall reference a valid
+ * batch. However, @new_batch can be NULL.
+ */
+void
+gst_vaapi_decoder_jpeg_batch_replace(GstVaapiDecoderJpegBatch **old_batch_ptr,
+    GstVaapiDecoderJpegBatch *new_batch)
+{
+    g_return_if_fail(old_batch_ptr != NULL);
+
+    gst_vaapi_mini_object_replace((GstVaapiMiniObject **)old_batch_ptr,
+        GST_VAAPI_MINI_OBJECT(new_batch));
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_add_size:
+ * @batch: a #GstVaapiDecoderJpegBatch
+ * @width: the image width, in pixels
+ * @height: the image height, in pixels
+ *
+ * Creates the VA context and surfaces for the size class of @width x
+ * @height images right away, instead of on the first submission of
+ * such an image.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_decoder_jpeg_batch_add_size(GstVaapiDecoderJpegBatch *batch,
+    guint width, guint height)
+{
+    g_return_val_if_fail(batch != NULL, FALSE);
+    g_return_val_if_fail(width > 0 && height > 0, FALSE);
+
+    return ensure_size_class(batch, width, height) != NULL;
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_submit:
+ * @batch: a #GstVaapiDecoderJpegBatch
+ * @buffers: (array length=num_buffers): the JPEG images to decode
+ * @num_buffers: the number of @buffers
+ *
+ * Submits the JPEG images held in @buffers for decoding, one complete
+ * image per buffer. Images are grouped by size class and all of them
+ * are submitted to the hardware without waiting for any of them to
+ * complete. No more images than the free room in the @batch are
+ * submitted, i.e. the capacity minus the number of pending images.
+ *
+ * Images that could not be submitted, e.g. because of an invalid
+ * header, are still reported by gst_vaapi_decoder_jpeg_batch_get_surface()
+ * with an error status.
+ *
+ * Return value: the number of images taken from the start of @buffers
+ */
+guint
+gst_vaapi_decoder_jpeg_batch_submit(GstVaapiDecoderJpegBatch *batch,
+    GstBuffer **buffers, guint num_buffers)
+{
+    BatchImage **images;
+    BatchImage *image;
+    guint i, width, height, num_images;
+
+    g_return_val_if_fail(batch != NULL, 0);
+    g_return_val_if_fail(buffers != NULL || num_buffers == 0, 0);
+
+    num_images = MIN(num_buffers,
+        batch->capacity - g_queue_get_length(&batch->pending));
+    if (!num_images)
+        return 0;
+
+    batch->serial++;
+    images = g_new(BatchImage *, num_images);
+    for (i = 0; i < num_images; i++) {
+        image = g_slice_new0(BatchImage);
+        image->index = batch->num_submitted + i;
+        images[i] = image;
+
+        if (!parse_image_size(buffers[i], &width, &height)) {
+            GST_WARNING("failed to parse image %u header", image->index);
+            image->status = GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+            continue;
+        }
+        image->size_class = ensure_size_class(batch, width, height);
+        if (!image->size_class)
+            image->status = GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    /* Submit all images of a size class in a row */
+    g_qsort_with_data(images, num_images, sizeof(*images), compare_images,
+        NULL);
+    for (i = 0; i < num_images; i++) {
+        image = images[i];
+        if (image->size_class)
+            decode_image(batch, image,
+                buffers[image->index - batch->num_submitted]);
+        g_queue_push_tail(&batch->pending, image);
+    }
+    g_free(images);
+
+    batch->num_submitted += num_images;
+    return num_images;
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_get_surface:
+ * @batch: a #GstVaapiDecoderJpegBatch
+ * @out_proxy_ptr: the decoded surface as a #GstVaapiSurfaceProxy
+ * @out_index_ptr: (allow-none): the sequence number of the image, i.e.
+ *   its position among all the images submitted to the @batch
+ *
+ * Returns the next decoded image. Images that completed decoding are
+ * returned first, regardless of the submission order. If none has
+ * completed yet, this function waits for the first submitted one.
+ *
+ * On successful return, *@out_proxy_ptr contains the decoded surface.
+ * The caller owns this object, so gst_vaapi_surface_proxy_unref()
+ * shall be called after usage. Images smaller than their size class
+ * are described by the crop rectangle of the proxy. If the image
+ * failed to decode, the error status is returned along with the
+ * image index and a %NULL surface. Finally,
+ * %GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA is returned if there is no
+ * pending image.
+ *
+ * Return value: a #GstVaapiDecoderStatus
+ */
+GstVaapiDecoderStatus
+gst_vaapi_decoder_jpeg_batch_get_surface(GstVaapiDecoderJpegBatch *batch,
+    GstVaapiSurfaceProxy **out_proxy_ptr, guint *out_index_ptr)
+{
+    GstVaapiDecoderStatus status;
+    GstVaapiSurfaceStatus surface_status;
+    GstVaapiSurface *surface;
+    BatchImage *image = NULL;
+    GList *l;
+
+    g_return_val_if_fail(batch != NULL,
+        GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail(out_proxy_ptr != NULL,
+        GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
+
+    *out_proxy_ptr = NULL;
+    if (g_queue_is_empty(&batch->pending))
+        return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+
+    for (l = batch->pending.head; l != NULL; l = l->next) {
+        image = l->data;
+        if (!image->proxy)
+            break;
+        surface = gst_vaapi_surface_proxy_get_surface(image->proxy);
+        if (gst_vaapi_surface_query_status(surface, &surface_status) &&
+            !(surface_status & GST_VAAPI_SURFACE_STATUS_RENDERING))
+            break;
+    }
+
+    if (l)
+        g_queue_delete_link(&batch->pending, l);
+    else {
+        image = g_queue_pop_head(&batch->pending);
+        surface = gst_vaapi_surface_proxy_get_surface(image->proxy);
+        if (!gst_vaapi_surface_sync(surface)) {
+            GST_WARNING("failed to sync image %u", image->index);
+            gst_vaapi_surface_proxy_unref(image->proxy);
+            image->proxy = NULL;
+            image->status = GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+        }
+    }
+
+    status = image->status;
+    *out_proxy_ptr = image->proxy;
+    if (out_index_ptr)
+        *out_index_ptr = image->index;
+    image->proxy = NULL;
+    batch_image_free(image);
+    return status;
+}
+
+/**
+ * gst_vaapi_decoder_jpeg_batch_get_pending:
+ * @batch: a #GstVaapiDecoderJpegBatch
+ *
+ * Returns the number of images that were submitted but not collected
+ * yet with gst_vaapi_decoder_jpeg_batch_get_surface().
+ *
+ * Return value: the number of pending images
+ */
+guint
+gst_vaapi_decoder_jpeg_batch_get_pending(GstVaapiDecoderJpegBatch *batch)
+{
+    g_return_val_if_fail(batch != NULL, 0);
+
+    return g_queue_get_length(&batch->pending);
+}
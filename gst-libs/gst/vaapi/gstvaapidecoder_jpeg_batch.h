@@ -0,0 +1,62 @@
+/*
+ *  gstvaapidecoder_jpeg_batch.h - Batched JPEG still images decoder
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_DECODER_JPEG_BATCH_H
+#define GST_VAAPI_DECODER_JPEG_BATCH_H
+
+#include <gst/vaapi/gstvaapidecoder.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiDecoderJpegBatch        GstVaapiDecoderJpegBatch;
+
+GstVaapiDecoderJpegBatch *
+gst_vaapi_decoder_jpeg_batch_new(GstVaapiDisplay *display, guint capacity);
+
+GstVaapiDecoderJpegBatch *
+gst_vaapi_decoder_jpeg_batch_ref(GstVaapiDecoderJpegBatch *batch);
+
+void
+gst_vaapi_decoder_jpeg_batch_unref(GstVaapiDecoderJpegBatch *batch);
+
+void
+gst_vaapi_decoder_jpeg_batch_replace(GstVaapiDecoderJpegBatch **old_batch_ptr,
+    GstVaapiDecoderJpegBatch *new_batch);
+
+gboolean
+gst_vaapi_decoder_jpeg_batch_add_size(GstVaapiDecoderJpegBatch *batch,
+    guint width, guint height);
+
+guint
+gst_vaapi_decoder_jpeg_batch_submit(GstVaapiDecoderJpegBatch *batch,
+    GstBuffer **buffers, guint num_buffers);
+
+GstVaapiDecoderStatus
+gst_vaapi_decoder_jpeg_batch_get_surface(GstVaapiDecoderJpegBatch *batch,
+    GstVaapiSurfaceProxy **out_proxy_ptr, guint *out_index_ptr);
+
+guint
+gst_vaapi_decoder_jpeg_batch_get_pending(GstVaapiDecoderJpegBatch *batch);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_DECODER_JPEG_BATCH_H */
@@ -260,6 +260,10 @@ struct _GstVaapiDecoderMpeg2Private {
     GstVaapiPicture            *current_picture;
     GstVaapiDpb                *dpb;
     PTSGenerator                tsg;
+    GArray                     *slice_params;
+    guint                       slice_data_start;
+    guint                       slice_data_end;
+    guint                       next_mb_row;
     guint                       is_opened               : 1;
     guint                       size_changed            : 1;
     guint                       profile_changed         : 1;
@@ -309,6 +313,11 @@ gst_vaapi_decoder_mpeg2_close(GstVaapiDecoderMpeg2 *decoder)
     gst_vaapi_parser_info_mpeg2_replace(&priv->slice_hdr, NULL);
 
     gst_vaapi_dpb_replace(&priv->dpb, NULL);
+
+    if (priv->slice_params) {
+        g_array_unref(priv->slice_params);
+        priv->slice_params = NULL;
+    }
 }
 
 static gboolean
@@ -322,6 +331,12 @@ gst_vaapi_decoder_mpeg2_open(GstVaapiDecoderMpeg2 *decoder)
     if (!priv->dpb)
         return FALSE;
 
+    /* A 1080 lines picture has 68 slices, one per macroblock row */
+    priv->slice_params = g_array_sized_new(FALSE, FALSE,
+        sizeof(VASliceParameterBufferMPEG2), 68);
+    if (!priv->slice_params)
+        return FALSE;
+
     pts_init(&priv->tsg);
     return TRUE;
 }
@@ -521,11 +536,73 @@ is_valid_state(GstVaapiDecoderMpeg2 *decoder, guint state)
     return (priv->state & state) == state;
 }
 
+/* Submits all the slices of the current picture as a single slice
+   parameter buffer holding one element per slice, and a single slice
+   data buffer spanning from the first to the last slice */
+static gboolean
+add_slices(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
+{
+    GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
+    GArray * const slice_params = priv->slice_params;
+    GstBuffer * const buffer =
+        GST_VAAPI_DECODER_CODEC_FRAME(decoder)->input_buffer;
+    GstVaapiSlice *slice;
+    GstMapInfo map_info;
+
+    if (!gst_buffer_map(buffer, &map_info, GST_MAP_READ)) {
+        GST_ERROR("failed to map buffer");
+        return FALSE;
+    }
+
+    slice = GST_VAAPI_SLICE_NEW_N(MPEG2, decoder,
+        (map_info.data + priv->slice_data_start),
+        priv->slice_data_end - priv->slice_data_start, slice_params->len);
+    gst_buffer_unmap(buffer, &map_info);
+    if (!slice) {
+        GST_ERROR("failed to allocate slice");
+        return FALSE;
+    }
+    memcpy(slice->param, slice_params->data,
+        slice_params->len * sizeof(VASliceParameterBufferMPEG2));
+    gst_vaapi_picture_add_slice(picture, slice);
+    return TRUE;
+}
+
+/* Returns the number of macroblock rows in the current picture, or in
+   either field of the current frame for field pictures */
+static guint
+get_mb_height(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
+{
+    GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
+
+    if (!GST_VAAPI_PICTURE_IS_FRAME(picture))
+        return (priv->height + 31) / 32;
+    if (!priv->progressive_sequence)
+        return 2 * ((priv->height + 31) / 32);
+    return (priv->height + 15) / 16;
+}
+
+/* Marks the current picture as corrupted if any of its trailing slices
+   are missing. Gaps between slices are detected by decode_slice() */
+static void
+check_missing_slices(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
+{
+    GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
+    const guint mb_height = get_mb_height(decoder, picture);
+
+    if (priv->next_mb_row < mb_height) {
+        GST_WARNING("missing slices for macroblock rows %u to %u",
+            priv->next_mb_row, mb_height - 1);
+        GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+    }
+}
+
 static GstVaapiDecoderStatus
 decode_current_picture(GstVaapiDecoderMpeg2 *decoder)
 {
     GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
     GstVaapiPicture * const picture = priv->current_picture;
+    gboolean success;
 
     if (!is_valid_state(decoder, GST_MPEG_VIDEO_STATE_VALID_PICTURE))
         goto drop_frame;
@@ -534,6 +611,21 @@ decode_current_picture(GstVaapiDecoderMpeg2 *decoder)
     if (!picture)
         return GST_VAAPI_DECODER_STATUS_SUCCESS;
 
+    /* All slices could have been skipped, e.g. if they were broken */
+    if (priv->slice_params->len == 0) {
+        GST_WARNING("no slice to decode, dropping picture");
+        gst_vaapi_picture_replace(&priv->current_picture, NULL);
+        goto drop_frame;
+    }
+
+    if (GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder))
+        check_missing_slices(decoder, picture);
+
+    success = add_slices(decoder, picture);
+    g_array_set_size(priv->slice_params, 0);
+    if (!success)
+        goto error;
+
     if (!gst_vaapi_picture_decode(picture))
         goto error;
     if (GST_VAAPI_PICTURE_IS_COMPLETE(picture)) {
@@ -550,6 +642,7 @@ error:
 
 drop_frame:
     priv->state &= GST_MPEG_VIDEO_STATE_VALID_SEQ_HEADERS;
+    g_array_set_size(priv->slice_params, 0);
     return GST_VAAPI_DECODER_STATUS_DROP_FRAME;
 }
 
@@ -954,12 +1047,83 @@ pack_f_code(guint8 f_code[2][2])
             (         f_code[1][1]      ));
 }
 
+/* Fills the surface with mid-grey, i.e. all YUV components set to 128 */
+static gboolean
+fill_grey_surface(GstVaapiDecoderMpeg2 *decoder, GstVaapiSurface *surface)
+{
+    GstVaapiImage *image;
+    guint i, width, height;
+    gboolean success;
+
+    gst_vaapi_surface_get_size(surface, &width, &height);
+    image = gst_vaapi_image_new(GST_VAAPI_DECODER_DISPLAY(decoder),
+        GST_VIDEO_FORMAT_NV12, width, height);
+    if (!image)
+        return FALSE;
+
+    success = gst_vaapi_image_map(image);
+    if (success) {
+        for (i = 0; i < gst_vaapi_image_get_plane_count(image); i++)
+            memset(gst_vaapi_image_get_plane(image, i), 0x80,
+                gst_vaapi_image_get_pitch(image, i) *
+                (i > 0 ? (height + 1) / 2 : height));
+        gst_vaapi_image_unmap(image);
+        success = gst_vaapi_surface_put_image(surface, image);
+    }
+    gst_vaapi_object_unref(image);
+    return success;
+}
+
+/* Adds a reference picture that is never decoded into the DPB. It is
+   filled with grey if it is meant to conceal a lost reference */
+static GstVaapiDecoderStatus
+add_dummy_picture(GstVaapiDecoderMpeg2 *decoder, gboolean is_grey)
+{
+    GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
+    GstVaapiPicture *dummy_picture;
+    gboolean success;
+
+    dummy_picture = GST_VAAPI_PICTURE_NEW(MPEG2, decoder);
+    if (!dummy_picture) {
+        GST_ERROR("failed to allocate dummy picture");
+        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    dummy_picture->type      = GST_VAAPI_PICTURE_TYPE_I;
+    dummy_picture->pts       = GST_CLOCK_TIME_NONE;
+    dummy_picture->poc       = -1;
+    dummy_picture->structure = GST_VAAPI_PICTURE_STRUCTURE_FRAME;
+
+    GST_VAAPI_PICTURE_FLAG_SET(
+        dummy_picture,
+        (GST_VAAPI_PICTURE_FLAG_SKIPPED |
+         GST_VAAPI_PICTURE_FLAG_OUTPUT  |
+         GST_VAAPI_PICTURE_FLAG_REFERENCE)
+    );
+
+    if (is_grey) {
+        GST_VAAPI_PICTURE_FLAG_SET(dummy_picture,
+            GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+        if (!fill_grey_surface(decoder, dummy_picture->surface))
+            GST_WARNING("failed to fill dummy picture with grey");
+    }
+
+    success = gst_vaapi_dpb_add(priv->dpb, dummy_picture);
+    gst_vaapi_picture_unref(dummy_picture);
+    if (!success) {
+        GST_ERROR("failed to add dummy picture into DPB");
+        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    }
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
 static GstVaapiDecoderStatus
 init_picture(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
 {
     GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
     GstMpegVideoPictureHdr * const pic_hdr = &priv->pic_hdr->data.pic_hdr;
     GstMpegVideoPictureExt * const pic_ext = &priv->pic_ext->data.pic_ext;
+    GstVaapiDecoderStatus status;
 
     switch (pic_hdr->pic_type) {
     case GST_MPEG_VIDEO_PICTURE_TYPE_I:
@@ -1000,36 +1164,24 @@ init_picture(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
     if (picture->type == GST_VAAPI_PICTURE_TYPE_I &&
         !GST_VAAPI_PICTURE_IS_FRAME(picture) &&
         gst_vaapi_dpb_size(priv->dpb) == 0) {
-        GstVaapiPicture *dummy_picture;
-        gboolean success;
-
-        dummy_picture = GST_VAAPI_PICTURE_NEW(MPEG2, decoder);
-        if (!dummy_picture) {
-            GST_ERROR("failed to allocate dummy picture");
-            return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
-        }
-
-        dummy_picture->type      = GST_VAAPI_PICTURE_TYPE_I;
-        dummy_picture->pts       = GST_CLOCK_TIME_NONE;
-        dummy_picture->poc       = -1;
-        dummy_picture->structure = GST_VAAPI_PICTURE_STRUCTURE_FRAME;
-
-        GST_VAAPI_PICTURE_FLAG_SET(
-            dummy_picture,
-            (GST_VAAPI_PICTURE_FLAG_SKIPPED |
-             GST_VAAPI_PICTURE_FLAG_OUTPUT  |
-             GST_VAAPI_PICTURE_FLAG_REFERENCE)
-        );
-
-        success = gst_vaapi_dpb_add(priv->dpb, dummy_picture);
-        gst_vaapi_picture_unref(dummy_picture);
-        if (!success) {
-            GST_ERROR("failed to add dummy picture into DPB");
-            return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
-        }
+        status = add_dummy_picture(decoder, FALSE);
+        if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+            return status;
         GST_INFO("allocated dummy picture for first field based I-frame");
     }
 
+    /* Allocate grey reference picture for P or B-frames decoded without
+       any prior reference picture in error concealment mode */
+    if (picture->type != GST_VAAPI_PICTURE_TYPE_I &&
+        GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder) &&
+        gst_vaapi_dpb_size(priv->dpb) == 0) {
+        status = add_dummy_picture(decoder, TRUE);
+        if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+            return status;
+        gst_vaapi_decoder_count_concealed_ref(GST_VAAPI_DECODER_CAST(decoder));
+        GST_INFO("allocated grey reference picture for concealment");
+    }
+
     /* Update presentation time */
     picture->pts = pts_eval(&priv->tsg,
         GST_VAAPI_DECODER_CODEC_FRAME(decoder)->pts, pic_hdr->tsn);
@@ -1037,6 +1189,65 @@ init_picture(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
+/* Substitutes a missing reference picture with the other neighbour.
+   There is usually one since init_picture() adds a grey reference
+   picture into an empty DPB in error concealment mode. Otherwise, the
+   picture is decoded without any reference, and nothing was concealed */
+static GstVaapiPicture *
+conceal_reference(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture,
+    GstVaapiPicture *ref_picture, GstVaapiPicture *other_picture)
+{
+    if (ref_picture)
+        return ref_picture;
+
+    GST_VAAPI_PICTURE_FLAG_SET(picture, GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+    if (other_picture)
+        gst_vaapi_decoder_count_concealed_ref(GST_VAAPI_DECODER_CAST(decoder));
+    return other_picture;
+}
+
+/* Fills in the reference pictures in error concealment mode, i.e. P and
+   B pictures are decoded even though their reference pictures were lost.
+   They are marked as corrupted in that case, or if they are predicted
+   from corrupted pictures */
+static void
+conceal_references(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture,
+    GstVaapiPicture *prev_picture, GstVaapiPicture *next_picture)
+{
+    GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
+    VAPictureParameterBufferMPEG2 * const pic_param = picture->param;
+    GstVaapiPicture *forward_picture = NULL, *backward_picture = NULL;
+
+    switch (picture->type) {
+    case GST_VAAPI_PICTURE_TYPE_B:
+        backward_picture = conceal_reference(decoder, picture,
+            next_picture, prev_picture);
+        if (prev_picture || !priv->closed_gop)
+            forward_picture = conceal_reference(decoder, picture,
+                prev_picture, next_picture);
+        break;
+    case GST_VAAPI_PICTURE_TYPE_P:
+        forward_picture = conceal_reference(decoder, picture,
+            prev_picture, next_picture);
+        break;
+    default:
+        break;
+    }
+
+    if (forward_picture) {
+        pic_param->forward_reference_picture = forward_picture->surface_id;
+        if (GST_VAAPI_PICTURE_IS_CORRUPTED(forward_picture))
+            GST_VAAPI_PICTURE_FLAG_SET(picture,
+                GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+    }
+    if (backward_picture) {
+        pic_param->backward_reference_picture = backward_picture->surface_id;
+        if (GST_VAAPI_PICTURE_IS_CORRUPTED(backward_picture))
+            GST_VAAPI_PICTURE_FLAG_SET(picture,
+                GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+    }
+}
+
 static void
 fill_picture(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
 {
@@ -1073,6 +1284,11 @@ fill_picture(GstVaapiDecoderMpeg2 *decoder, GstVaapiPicture *picture)
     gst_vaapi_dpb_get_neighbours(priv->dpb, picture,
         &prev_picture, &next_picture);
 
+    if (GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder)) {
+        conceal_references(decoder, picture, prev_picture, next_picture);
+        return;
+    }
+
     switch (pic_hdr->pic_type) {
     case GST_MPEG_VIDEO_PICTURE_TYPE_B:
         if (next_picture)
@@ -1127,35 +1343,40 @@ static GstVaapiDecoderStatus
 decode_slice(GstVaapiDecoderMpeg2 *decoder, GstVaapiDecoderUnit *unit)
 {
     GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
-    GstVaapiPicture * const picture = priv->current_picture;
-    GstVaapiSlice *slice;
     VASliceParameterBufferMPEG2 *slice_param;
     GstMpegVideoSliceHdr * const slice_hdr = unit->parsed_info;
-    GstBuffer * const buffer =
-        GST_VAAPI_DECODER_CODEC_FRAME(decoder)->input_buffer;
-    GstMapInfo map_info;
 
     GST_DEBUG("slice %d (%u bytes)", slice_hdr->mb_row, unit->size);
 
     if (!is_valid_state(decoder, GST_MPEG_VIDEO_STATE_VALID_PIC_HEADERS))
         return GST_VAAPI_DECODER_STATUS_SUCCESS;
 
-    if (!gst_buffer_map(buffer, &map_info, GST_MAP_READ)) {
-        GST_ERROR("failed to map buffer");
-        return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+    if (GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder)) {
+        if (slice_hdr->mb_row > priv->next_mb_row) {
+            GST_WARNING("missing slices for macroblock rows %u to %u",
+                priv->next_mb_row, slice_hdr->mb_row - 1);
+            GST_VAAPI_PICTURE_FLAG_SET(priv->current_picture,
+                GST_VAAPI_PICTURE_FLAG_CORRUPTED);
+        }
+        priv->next_mb_row = MAX(priv->next_mb_row, slice_hdr->mb_row + 1);
     }
 
-    slice = GST_VAAPI_SLICE_NEW(MPEG2, decoder,
-        (map_info.data + unit->offset), unit->size);
-    gst_buffer_unmap(buffer, &map_info);
-    if (!slice) {
-        GST_ERROR("failed to allocate slice");
-        return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
-    }
-    gst_vaapi_picture_add_slice(picture, slice);
+    /* Slices are only recorded here, and submitted all at once by
+       decode_current_picture(). Their data is laid out in the order
+       of the input buffer, starting from the first slice */
+    if (priv->slice_params->len == 0)
+        priv->slice_data_start = unit->offset;
+    g_array_set_size(priv->slice_params, priv->slice_params->len + 1);
+    priv->slice_data_end = unit->offset + unit->size;
 
     /* Fill in VASliceParameterBufferMPEG2 */
-    slice_param                            = slice->param;
+    slice_param = &g_array_index(priv->slice_params,
+        VASliceParameterBufferMPEG2, priv->slice_params->len - 1);
+    memset(slice_param, 0, sizeof(*slice_param));
+    slice_param->slice_data_size           = unit->size;
+    slice_param->slice_data_offset         = unit->offset -
+        priv->slice_data_start;
+    slice_param->slice_data_flag           = VA_SLICE_DATA_FLAG_ALL;
     slice_param->macroblock_offset         = slice_hdr->header_size + 32;
     slice_param->slice_horizontal_position = slice_hdr->mb_column;
     slice_param->slice_vertical_position   = slice_hdr->mb_row;
@@ -1418,11 +1639,13 @@ gst_vaapi_decoder_mpeg2_decode(GstVaapiDecoder *base_decoder,
 {
     GstVaapiDecoderMpeg2 * const decoder =
         GST_VAAPI_DECODER_MPEG2_CAST(base_decoder);
+    GstVaapiDecoderMpeg2Private * const priv = &decoder->priv;
     GstVaapiDecoderStatus status;
     GstMpegVideoPacket packet;
     GstBuffer * const buffer =
         GST_VAAPI_DECODER_CODEC_FRAME(decoder)->input_buffer;
     GstMapInfo map_info;
+    guint state;
 
     status = ensure_decoder(decoder);
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
@@ -1438,8 +1661,21 @@ gst_vaapi_decoder_mpeg2_decode(GstVaapiDecoder *base_decoder,
     packet.type = packet.data[3];
     packet.offset = 4;
 
+    state = priv->state;
     status = parse_unit(decoder, unit, &packet);
     gst_buffer_unmap(buffer, &map_info);
+
+    /* Skip broken slices in error concealment mode. The picture is then
+       marked as corrupted since the next slice, or the end of the picture,
+       will not start at the expected macroblock row */
+    if (status == GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER &&
+        GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder) &&
+        packet.type >= GST_MPEG_VIDEO_PACKET_SLICE_MIN &&
+        packet.type <= GST_MPEG_VIDEO_PACKET_SLICE_MAX) {
+        GST_WARNING("skipping broken slice");
+        priv->state = state;
+        return GST_VAAPI_DECODER_STATUS_SUCCESS;
+    }
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
         return status;
     return decode_unit(decoder, unit, &packet);
@@ -1495,6 +1731,8 @@ gst_vaapi_decoder_mpeg2_start_frame(GstVaapiDecoder *base_decoder,
     }
     gst_vaapi_picture_replace(&priv->current_picture, picture);
     gst_vaapi_picture_unref(picture);
+    g_array_set_size(priv->slice_params, 0);
+    priv->next_mb_row = 0;
 
     /* Update cropping rectangle */
     /* XXX: handle picture_display_extension() */
@@ -114,7 +114,7 @@ gst_vaapi_picture_create (GstVaapiPicture * picture,
             GST_VAAPI_PICTURE_FLAG_REFERENCE |
             GST_VAAPI_PICTURE_FLAG_INTERLACED |
             GST_VAAPI_PICTURE_FLAG_FF | GST_VAAPI_PICTURE_FLAG_TFF |
-            GST_VAAPI_PICTURE_FLAG_MVC));
+            GST_VAAPI_PICTURE_FLAG_MVC | GST_VAAPI_PICTURE_FLAG_CORRUPTED));
 
     picture->structure = parent_picture->structure;
     if ((args->flags & GST_VAAPI_CREATE_PICTURE_FLAG_FIELD) &&
@@ -310,6 +310,7 @@ do_output (GstVaapiPicture * picture)
 {
   GstVideoCodecFrame *const out_frame = picture->frame;
   GstVaapiSurfaceProxy *proxy;
+  gboolean is_corrupted;
   guint flags = 0;
 
   if (GST_VAAPI_PICTURE_IS_OUTPUT (picture))
@@ -345,6 +346,15 @@ do_output (GstVaapiPicture * picture)
     if (GST_VAAPI_PICTURE_IS_ONEFIELD (picture))
       flags |= GST_VAAPI_SURFACE_PROXY_FLAG_ONEFIELD;
   }
+
+  /* A frame is corrupted as soon as either of its fields is */
+  is_corrupted = GST_VAAPI_PICTURE_IS_CORRUPTED (picture) ||
+      (picture->parent_picture &&
+      GST_VAAPI_PICTURE_IS_CORRUPTED (picture->parent_picture));
+  if (is_corrupted)
+    flags |= GST_VAAPI_SURFACE_PROXY_FLAG_CORRUPTED;
+  if (!GST_VAAPI_PICTURE_IS_SKIPPED (picture))
+    gst_vaapi_decoder_count_output_frame (GET_DECODER (picture), is_corrupted);
   GST_VAAPI_SURFACE_PROXY_FLAG_SET (proxy, flags);
 
   gst_vaapi_decoder_push_frame (GET_DECODER (picture), out_frame);
@@ -417,6 +427,7 @@ gst_vaapi_slice_create (GstVaapiSlice * slice,
 {
   VASliceParameterBufferBase *slice_param;
   gboolean success;
+  guint i;
 
   slice->param_id = VA_INVALID_ID;
   slice->data_id = VA_INVALID_ID;
@@ -427,16 +438,21 @@ gst_vaapi_slice_create (GstVaapiSlice * slice,
   if (!success)
     return FALSE;
 
-  success = vaapi_create_buffer (GET_VA_DISPLAY (slice), GET_VA_CONTEXT (slice),
-      VASliceParameterBufferType, args->param_size, args->param,
-      &slice->param_id, &slice->param);
+  success = vaapi_create_n_elements_buffer (GET_VA_DISPLAY (slice),
+      GET_VA_CONTEXT (slice), VASliceParameterBufferType, args->param_size,
+      args->param, &slice->param_id, &slice->param, args->param_num);
   if (!success)
     return FALSE;
 
-  slice_param = slice->param;
-  slice_param->slice_data_size = args->data_size;
-  slice_param->slice_data_offset = 0;
-  slice_param->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+  /* Defaults to every element covering the whole slice data buffer, the
+     caller is expected to fix up the data layout of multi-element slices */
+  for (i = 0; i < args->param_num; i++) {
+    slice_param = (VASliceParameterBufferBase *)
+        ((guint8 *) slice->param + i * args->param_size);
+    slice_param->slice_data_size = args->data_size;
+    slice_param->slice_data_offset = 0;
+    slice_param->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+  }
   return TRUE;
 }
 
@@ -450,3 +466,18 @@ gst_vaapi_slice_new (GstVaapiDecoder * decoder,
       GST_VAAPI_CODEC_BASE (decoder), param, param_size, data, data_size, 0);
   return GST_VAAPI_SLICE_CAST (object);
 }
+
+GstVaapiSlice *
+gst_vaapi_slice_new_n (GstVaapiDecoder * decoder,
+    gconstpointer param, guint param_size, guint param_num,
+    const guchar * data, guint data_size)
+{
+  GstVaapiCodecObject *object;
+
+  g_return_val_if_fail (param_num > 0, NULL);
+
+  object = gst_vaapi_codec_object_new_with_param_num (&GstVaapiSliceClass,
+      GST_VAAPI_CODEC_BASE (decoder), param, param_size, param_num, data,
+      data_size, 0);
+  return GST_VAAPI_SLICE_CAST (object);
+}
@@ -67,6 +67,8 @@ typedef enum
  * @GST_VAAPI_PICTURE_FLAG_TFF: top-field-first
  * @GST_VAAPI_PICTURE_FLAG_ONEFIELD: only one field is valid
  * @GST_VAAPI_PICTURE_FLAG_MVC: multiview component
+ * @GST_VAAPI_PICTURE_FLAG_CORRUPTED: picture with missing slices, or
+ *   predicted from missing or corrupted reference pictures
  * @GST_VAAPI_PICTURE_FLAG_LAST: first flag that can be used by subclasses
  *
  * Enum values used for #GstVaapiPicture flags.
@@ -81,7 +83,8 @@ typedef enum
   GST_VAAPI_PICTURE_FLAG_TFF        = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 5),
   GST_VAAPI_PICTURE_FLAG_ONEFIELD   = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 6),
   GST_VAAPI_PICTURE_FLAG_MVC        = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 7),
-  GST_VAAPI_PICTURE_FLAG_LAST       = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 8),
+  GST_VAAPI_PICTURE_FLAG_CORRUPTED  = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 8),
+  GST_VAAPI_PICTURE_FLAG_LAST       = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 9),
 } GstVaapiPictureFlags;
 
 #define GST_VAAPI_PICTURE_FLAGS         GST_VAAPI_MINI_OBJECT_FLAGS
@@ -121,6 +124,9 @@ typedef enum
 #define GST_VAAPI_PICTURE_IS_MVC(picture) \
   (GST_VAAPI_PICTURE_FLAG_IS_SET (picture, GST_VAAPI_PICTURE_FLAG_MVC))
 
+#define GST_VAAPI_PICTURE_IS_CORRUPTED(picture) \
+  (GST_VAAPI_PICTURE_FLAG_IS_SET (picture, GST_VAAPI_PICTURE_FLAG_CORRUPTED))
+
 /**
  * GstVaapiPicture:
  *
@@ -215,7 +221,8 @@ gst_vaapi_picture_set_crop_rect (GstVaapiPicture * picture,
 /**
  * GstVaapiSlice:
  *
- * A #GstVaapiCodecObject holding a slice parameter.
+ * A #GstVaapiCodecObject holding a slice parameter, or an array of slice
+ * parameters sharing the same slice data buffer.
  */
 struct _GstVaapiSlice
 {
@@ -245,6 +252,11 @@ GstVaapiSlice *
 gst_vaapi_slice_new (GstVaapiDecoder * decoder, gconstpointer param,
     guint param_size, const guchar * data, guint data_size);
 
+G_GNUC_INTERNAL
+GstVaapiSlice *
+gst_vaapi_slice_new_n (GstVaapiDecoder * decoder, gconstpointer param,
+    guint param_size, guint param_num, const guchar * data, guint data_size);
+
 /* ------------------------------------------------------------------------- */
 /* --- Helpers to create codec-dependent objects                         --- */
 /* ------------------------------------------------------------------------- */
@@ -258,6 +270,11 @@ gst_vaapi_slice_new (GstVaapiDecoder * decoder, gconstpointer param,
       NULL, sizeof (G_PASTE (VASliceParameterBuffer, codec)),   \
       buf, buf_size)
 
+#define GST_VAAPI_SLICE_NEW_N(codec, decoder, buf, buf_size, n) \
+  gst_vaapi_slice_new_n (GST_VAAPI_DECODER_CAST (decoder),      \
+      NULL, sizeof (G_PASTE (VASliceParameterBuffer, codec)),   \
+      n, buf, buf_size)
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DECODER_OBJECTS_H */
@@ -150,6 +150,18 @@ struct _GstVaapiDecoderUnit;
 #define GST_VAAPI_DECODER_HEIGHT(decoder) \
     GST_VAAPI_DECODER_CODEC_STATE(decoder)->info.height
 
+/**
+ * GST_VAAPI_DECODER_ERROR_CONCEALMENT:
+ * @decoder: a #GstVaapiDecoder
+ *
+ * Macro that evaluates to %TRUE if frames with missing slices or
+ * references shall be decoded anyway, and marked as corrupted.
+ * This is an internal macro that does not do any run-time type check.
+ */
+#undef  GST_VAAPI_DECODER_ERROR_CONCEALMENT
+#define GST_VAAPI_DECODER_ERROR_CONCEALMENT(decoder) \
+    GST_VAAPI_DECODER_CAST(decoder)->error_concealment
+
 /* End-of-Stream buffer */
 #define GST_BUFFER_FLAG_EOS (GST_BUFFER_FLAG_LAST + 0)
 
@@ -202,6 +214,11 @@ struct _GstVaapiDecoder
   GstVaapiParserState parser_state;
   GstVaapiDecoderStateChangedFunc codec_state_changed_func;
   gpointer codec_state_changed_data;
+  guint extra_surfaces;
+  guint context_extra_surfaces;
+  gboolean error_concealment;
+  GstVaapiDecoderErrorStats error_stats;
+  guint num_corrupted_run;
 };
 
 /**
@@ -227,6 +244,7 @@ struct _GstVaapiDecoderClass
   GstVaapiDecoderStatus (*flush) (GstVaapiDecoder * decoder);
   GstVaapiDecoderStatus (*decode_codec_data) (GstVaapiDecoder * decoder,
       const guchar * buf, guint buf_size);
+  GstVaapiDecoderStatus (*prepare) (GstVaapiDecoder * decoder);
 };
 
 G_GNUC_INTERNAL
@@ -277,6 +295,15 @@ G_GNUC_INTERNAL
 GstVaapiDecoderStatus
 gst_vaapi_decoder_check_status (GstVaapiDecoder * decoder);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_count_concealed_ref (GstVaapiDecoder * decoder);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_count_output_frame (GstVaapiDecoder * decoder,
+    gboolean is_corrupted);
+
 G_GNUC_INTERNAL
 GstVaapiDecoderStatus
 gst_vaapi_decoder_decode_codec_data (GstVaapiDecoder * decoder);
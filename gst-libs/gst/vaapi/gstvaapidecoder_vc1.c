@@ -32,6 +32,7 @@
 #include "gstvaapidecoder_objects.h"
 #include "gstvaapidecoder_dpb.h"
 #include "gstvaapidecoder_unit.h"
+#include "gstvaapiutils_vc1_priv.h"
 #include "gstvaapidecoder_priv.h"
 #include "gstvaapidisplay_priv.h"
 #include "gstvaapiobject_priv.h"
@@ -630,22 +631,6 @@ has_OVERFLAGS_bitplane(GstVaapiDecoderVC1 *decoder)
             pic->condover == GST_VC1_CONDOVER_SELECT);
 }
 
-static inline void
-pack_bitplanes(GstVaapiBitPlane *bitplane, guint n, const guint8 *bitplanes[3], guint x, guint y, guint stride)
-{
-    const guint dst_index = n / 2;
-    const guint src_index = y * stride + x;
-    guint8 v = 0;
-
-    if (bitplanes[0])
-        v |= bitplanes[0][src_index];
-    if (bitplanes[1])
-        v |= bitplanes[1][src_index] << 1;
-    if (bitplanes[2])
-        v |= bitplanes[2][src_index] << 2;
-    bitplane->data[dst_index] = (bitplane->data[dst_index] << 4) | v;
-}
-
 static gboolean
 fill_picture_structc(GstVaapiDecoderVC1 *decoder, GstVaapiPicture *picture)
 {
@@ -831,7 +816,6 @@ fill_picture(GstVaapiDecoderVC1 *decoder, GstVaapiPicture *picture)
 
     if (pic_param->bitplane_present.value) {
         const guint8 *bitplanes[3];
-        guint x, y, n;
 
         switch (picture->type) {
         case GST_VAAPI_PICTURE_TYPE_P:
@@ -864,12 +848,8 @@ fill_picture(GstVaapiDecoderVC1 *decoder, GstVaapiPicture *picture)
         if (!picture->bitplane)
             return FALSE;
 
-        n = 0;
-        for (y = 0; y < seq_hdr->mb_height; y++)
-            for (x = 0; x < seq_hdr->mb_width; x++, n++)
-                pack_bitplanes(picture->bitplane, n, bitplanes, x, y, seq_hdr->mb_stride);
-        if (n & 1) /* move last nibble to the high order */
-            picture->bitplane->data[n/2] <<= 4;
+        gst_vaapi_utils_vc1_pack_bitplanes(picture->bitplane->data, bitplanes,
+            seq_hdr->mb_width, seq_hdr->mb_height, seq_hdr->mb_stride);
     }
     return TRUE;
 }
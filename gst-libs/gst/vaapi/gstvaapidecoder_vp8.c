@@ -59,7 +59,9 @@ struct _GstVaapiDecoderVp8Private
   GstVaapiPicture *golden_ref_picture;
   GstVaapiPicture *alt_ref_picture;
   GstVaapiPicture *current_picture;
+  VAProbabilityDataBufferVP8 prob_param;
   guint size_changed:1;
+  guint has_prob_param:1;
 };
 
 /**
@@ -123,6 +125,7 @@ gst_vaapi_decoder_vp8_open (GstVaapiDecoderVp8 * decoder)
 
   gst_vaapi_decoder_vp8_close (decoder);
   gst_vp8_parser_init (&priv->parser);
+  priv->has_prob_param = FALSE;
   return TRUE;
 }
 
@@ -237,19 +240,26 @@ ensure_probability_table (GstVaapiDecoderVp8 * decoder,
 {
   GstVaapiDecoderVp8Private *const priv = &decoder->priv;
   GstVp8FrameHdr *const frame_hdr = &priv->frame_hdr;
-  VAProbabilityDataBufferVP8 *prob_table;
+  VAProbabilityDataBufferVP8 *const prob_param = &priv->prob_param;
+
+  /* The coefficient probabilities persist across frames, and most
+     inter frames carry no update for them. So, keep the last submitted
+     VAProbabilityDataBufferVP8 around and only refill it when the
+     parsed probabilities changed. The VA buffer itself is destroyed
+     once rendered, so a new one is created from that copy */
+  if (!priv->has_prob_param || memcmp (prob_param->dct_coeff_probs,
+          frame_hdr->token_probs.prob, sizeof (frame_hdr->token_probs.prob))) {
+    memcpy (prob_param->dct_coeff_probs, frame_hdr->token_probs.prob,
+        sizeof (frame_hdr->token_probs.prob));
+    priv->has_prob_param = TRUE;
+  }
 
-  picture->prob_table = GST_VAAPI_PROBABILITY_TABLE_NEW (VP8, decoder);
+  picture->prob_table = gst_vaapi_probability_table_new (GST_VAAPI_DECODER
+      (decoder), prob_param, sizeof (*prob_param));
   if (!picture->prob_table) {
     GST_ERROR ("failed to allocate probality table");
     return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
   }
-  prob_table = picture->prob_table->param;
-
-  /* Fill in VAProbabilityDataBufferVP8 */
-  memcpy (prob_table->dct_coeff_probs, frame_hdr->token_probs.prob,
-      sizeof (frame_hdr->token_probs.prob));
-
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
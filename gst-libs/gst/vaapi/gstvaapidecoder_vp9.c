@@ -0,0 +1,715 @@
+/*
+ *  gstvaapidecoder_vp9.c - VP9 decoder
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapidecoder_vp9
+ * @short_description: VP9 decoder
+ */
+
+#include "sysdeps.h"
+#include "gstvaapidecoder_vp9.h"
+#include "gstvaapidecoder_objects.h"
+#include "gstvaapidecoder_priv.h"
+#include "gstvaapidisplay_priv.h"
+#include "gstvaapiobject_priv.h"
+#include "gstvaapiutils_vp9_priv.h"
+
+#include "gstvaapicompat.h"
+#ifdef HAVE_VA_VA_DEC_VP9_H
+#include <va/va_dec_vp9.h>
+#endif
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+#define GST_VAAPI_DECODER_VP9_CAST(decoder) \
+  ((GstVaapiDecoderVp9 *)(decoder))
+
+typedef struct _GstVaapiDecoderVp9Private GstVaapiDecoderVp9Private;
+typedef struct _GstVaapiDecoderVp9Class GstVaapiDecoderVp9Class;
+
+struct _GstVaapiDecoderVp9Private
+{
+  GstVaapiProfile profile;
+  /* Size of the surfaces, i.e. the largest frame size so far */
+  guint width;
+  guint height;
+  GstVaapiVp9Parser parser;
+  GstVaapiVp9FrameHdr frame_hdr;
+  GstVaapiPicture *ref_frames[GST_VAAPI_VP9_REF_FRAMES];
+  GstVaapiPicture *current_picture;
+  /* Decoder units of the current input buffer, i.e. the frames of a
+     superframe and its index */
+  guint unit_sizes[GST_VAAPI_VP9_MAX_SUPERFRAME_FRAMES + 1];
+  guint num_units;
+  guint unit_index;
+  guint size_changed:1;
+  guint frame_output:1;
+};
+
+/**
+ * GstVaapiDecoderVp9:
+ *
+ * A decoder based on Vp9.
+ */
+struct _GstVaapiDecoderVp9
+{
+  /*< private >*/
+  GstVaapiDecoder parent_instance;
+
+  GstVaapiDecoderVp9Private priv;
+};
+
+/**
+ * GstVaapiDecoderVp9Class:
+ *
+ * A decoder class based on Vp9.
+ */
+struct _GstVaapiDecoderVp9Class
+{
+  /*< private >*/
+  GstVaapiDecoderClass parent_class;
+};
+
+static void
+gst_vaapi_decoder_vp9_close (GstVaapiDecoderVp9 * decoder)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  guint i;
+
+  for (i = 0; i < GST_VAAPI_VP9_REF_FRAMES; i++)
+    gst_vaapi_picture_replace (&priv->ref_frames[i], NULL);
+  gst_vaapi_picture_replace (&priv->current_picture, NULL);
+}
+
+static gboolean
+gst_vaapi_decoder_vp9_open (GstVaapiDecoderVp9 * decoder)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+
+  gst_vaapi_decoder_vp9_close (decoder);
+  gst_vaapi_utils_vp9_parser_init (&priv->parser);
+  priv->num_units = 0;
+  priv->unit_index = 0;
+  return TRUE;
+}
+
+static void
+gst_vaapi_decoder_vp9_destroy (GstVaapiDecoder * base_decoder)
+{
+  GstVaapiDecoderVp9 *const decoder = GST_VAAPI_DECODER_VP9_CAST (base_decoder);
+
+  gst_vaapi_decoder_vp9_close (decoder);
+}
+
+static gboolean
+gst_vaapi_decoder_vp9_create (GstVaapiDecoder * base_decoder)
+{
+  GstVaapiDecoderVp9 *const decoder = GST_VAAPI_DECODER_VP9_CAST (base_decoder);
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+
+  if (!gst_vaapi_decoder_vp9_open (decoder))
+    return FALSE;
+
+  priv->profile = GST_VAAPI_PROFILE_UNKNOWN;
+  return TRUE;
+}
+
+/* Keeps the current references as render targets of the VA context,
+   since inter frames could still use them once the surfaces grew */
+static void
+keep_reference_surfaces (GstVaapiDecoderVp9 * decoder)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  GstVaapiContext *const context = GST_VAAPI_DECODER_CONTEXT (decoder);
+  GPtrArray *surfaces;
+  guint i, j;
+
+  if (!context)
+    return;
+
+  surfaces = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_vaapi_object_unref);
+  for (i = 0; i < GST_VAAPI_VP9_REF_FRAMES; i++) {
+    GstVaapiPicture *const ref_picture = priv->ref_frames[i];
+    if (!ref_picture)
+      continue;
+    for (j = 0; j < i; j++) {
+      if (priv->ref_frames[j] &&
+          priv->ref_frames[j]->surface == ref_picture->surface)
+        break;
+    }
+    if (j == i)
+      g_ptr_array_add (surfaces, gst_vaapi_object_ref (ref_picture->surface));
+  }
+  gst_vaapi_context_set_reference_surfaces (context,
+      surfaces->len > 0 ? surfaces : NULL);
+  g_ptr_array_unref (surfaces);
+}
+
+static GstVaapiDecoderStatus
+ensure_context (GstVaapiDecoderVp9 * decoder)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  const GstVaapiProfile profile = GST_VAAPI_PROFILE_VP9;
+  const GstVaapiEntrypoint entrypoint = GST_VAAPI_ENTRYPOINT_VLD;
+  gboolean reset_context = FALSE;
+
+  if (priv->profile != profile) {
+    if (!gst_vaapi_display_has_decoder (GST_VAAPI_DECODER_DISPLAY (decoder),
+            profile, entrypoint))
+      return GST_VAAPI_DECODER_STATUS_ERROR_UNSUPPORTED_PROFILE;
+
+    priv->profile = profile;
+    reset_context = TRUE;
+  }
+
+  if (priv->size_changed) {
+    GST_DEBUG ("size changed");
+    priv->size_changed = FALSE;
+    keep_reference_surfaces (decoder);
+    reset_context = TRUE;
+  }
+
+  if (reset_context) {
+    GstVaapiContextInfo info;
+
+    info.profile = priv->profile;
+    info.entrypoint = entrypoint;
+    info.chroma_type = GST_VAAPI_CHROMA_TYPE_YUV420;
+    info.width = priv->width;
+    info.height = priv->height;
+    info.ref_frames = GST_VAAPI_VP9_REF_FRAMES;
+    reset_context =
+        gst_vaapi_decoder_ensure_context (GST_VAAPI_DECODER (decoder), &info);
+
+    if (!reset_context)
+      return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+  }
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static void
+init_picture (GstVaapiDecoderVp9 * decoder, GstVaapiPicture * picture)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  GstVaapiVp9FrameHdr *const frame_hdr = &priv->frame_hdr;
+
+  picture->structure = GST_VAAPI_PICTURE_STRUCTURE_FRAME;
+  picture->type = (frame_hdr->frame_type == GST_VAAPI_VP9_KEY_FRAME ||
+      frame_hdr->intra_only) ? GST_VAAPI_PICTURE_TYPE_I :
+      GST_VAAPI_PICTURE_TYPE_P;
+  picture->pts = GST_VAAPI_DECODER_CODEC_FRAME (decoder)->pts;
+
+  /* Frames smaller than the surfaces are cropped on output */
+  if (frame_hdr->width != priv->width || frame_hdr->height != priv->height) {
+    GstVaapiRectangle crop_rect;
+
+    crop_rect.x = 0;
+    crop_rect.y = 0;
+    crop_rect.width = frame_hdr->width;
+    crop_rect.height = frame_hdr->height;
+    gst_vaapi_picture_set_crop_rect (picture, &crop_rect);
+  }
+}
+
+static gboolean
+fill_picture (GstVaapiDecoderVp9 * decoder, GstVaapiPicture * picture)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  VADecPictureParameterBufferVP9 *const pic_param = picture->param;
+  GstVaapiVp9FrameHdr *const frame_hdr = &priv->frame_hdr;
+  GstVaapiVp9Segmentation *const seg = &frame_hdr->segmentation;
+  guint i;
+
+  /* Fill in VADecPictureParameterBufferVP9 */
+  pic_param->frame_width = frame_hdr->width;
+  pic_param->frame_height = frame_hdr->height;
+
+  /* References of another size than the current frame are scaled by
+     the hardware, so all the slots are passed as is */
+  for (i = 0; i < GST_VAAPI_VP9_REF_FRAMES; i++) {
+    GstVaapiPicture *const ref_picture = priv->ref_frames[i];
+    pic_param->reference_frames[i] = ref_picture ? ref_picture->surface_id :
+        VA_INVALID_SURFACE;
+  }
+
+  pic_param->pic_fields.value = 0;
+  pic_param->pic_fields.bits.subsampling_x = frame_hdr->subsampling_x;
+  pic_param->pic_fields.bits.subsampling_y = frame_hdr->subsampling_y;
+  pic_param->pic_fields.bits.frame_type = frame_hdr->frame_type;
+  pic_param->pic_fields.bits.show_frame = frame_hdr->show_frame;
+  pic_param->pic_fields.bits.error_resilient_mode =
+      frame_hdr->error_resilient_mode;
+  pic_param->pic_fields.bits.intra_only = frame_hdr->intra_only;
+  pic_param->pic_fields.bits.allow_high_precision_mv =
+      frame_hdr->allow_high_precision_mv;
+  pic_param->pic_fields.bits.mcomp_filter_type = frame_hdr->interp_filter;
+  pic_param->pic_fields.bits.frame_parallel_decoding_mode =
+      frame_hdr->frame_parallel_decoding_mode;
+  pic_param->pic_fields.bits.reset_frame_context =
+      frame_hdr->reset_frame_context;
+  pic_param->pic_fields.bits.refresh_frame_context =
+      frame_hdr->refresh_frame_context;
+  pic_param->pic_fields.bits.frame_context_idx = frame_hdr->frame_context_idx;
+  pic_param->pic_fields.bits.segmentation_enabled = seg->enabled;
+  pic_param->pic_fields.bits.segmentation_temporal_update =
+      seg->temporal_update;
+  pic_param->pic_fields.bits.segmentation_update_map = seg->update_map;
+  pic_param->pic_fields.bits.last_ref_frame =
+      frame_hdr->ref_frame_idx[GST_VAAPI_VP9_LAST_FRAME - 1];
+  pic_param->pic_fields.bits.last_ref_frame_sign_bias =
+      frame_hdr->ref_frame_sign_bias[GST_VAAPI_VP9_LAST_FRAME - 1];
+  pic_param->pic_fields.bits.golden_ref_frame =
+      frame_hdr->ref_frame_idx[GST_VAAPI_VP9_GOLDEN_FRAME - 1];
+  pic_param->pic_fields.bits.golden_ref_frame_sign_bias =
+      frame_hdr->ref_frame_sign_bias[GST_VAAPI_VP9_GOLDEN_FRAME - 1];
+  pic_param->pic_fields.bits.alt_ref_frame =
+      frame_hdr->ref_frame_idx[GST_VAAPI_VP9_ALTREF_FRAME - 1];
+  pic_param->pic_fields.bits.alt_ref_frame_sign_bias =
+      frame_hdr->ref_frame_sign_bias[GST_VAAPI_VP9_ALTREF_FRAME - 1];
+  pic_param->pic_fields.bits.lossless_flag = frame_hdr->lossless;
+
+  pic_param->filter_level = frame_hdr->loop_filter.filter_level;
+  pic_param->sharpness_level = frame_hdr->loop_filter.sharpness_level;
+  pic_param->log2_tile_rows = frame_hdr->tile_rows_log2;
+  pic_param->log2_tile_columns = frame_hdr->tile_cols_log2;
+
+  /* The compressed header, i.e. the first partition, is parsed by the
+     hardware along with the probability updates it carries */
+  pic_param->frame_header_length_in_bytes = frame_hdr->uncompressed_header_size;
+  pic_param->first_partition_size = frame_hdr->compressed_header_size;
+
+  memcpy (pic_param->mb_segment_tree_probs, seg->tree_probs,
+      sizeof (seg->tree_probs));
+  memcpy (pic_param->segment_pred_probs, seg->pred_probs,
+      sizeof (seg->pred_probs));
+  pic_param->profile = frame_hdr->profile;
+  return TRUE;
+}
+
+static gboolean
+fill_slice (GstVaapiDecoderVp9 * decoder, GstVaapiSlice * slice)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  VASliceParameterBufferVP9 *const slice_param = slice->param;
+  GstVaapiVp9FrameHdr *const frame_hdr = &priv->frame_hdr;
+  GstVaapiVp9Segmentation *const seg = &frame_hdr->segmentation;
+  guint i;
+
+  /* Fill in VASliceParameterBufferVP9. Segments inherit the frame
+     parameters when segmentation is disabled */
+  for (i = 0; i < GST_VAAPI_VP9_MAX_SEGMENTS; i++) {
+    VASegmentParameterVP9 *const seg_param = &slice_param->seg_param[i];
+    const gint qindex = gst_vaapi_utils_vp9_get_qindex (frame_hdr, i);
+
+    seg_param->segment_flags.value = 0;
+    if (seg->enabled) {
+      seg_param->segment_flags.fields.segment_reference_enabled =
+          seg->feature_enabled[i][GST_VAAPI_VP9_SEG_LVL_REF_FRAME];
+      seg_param->segment_flags.fields.segment_reference =
+          seg->feature_data[i][GST_VAAPI_VP9_SEG_LVL_REF_FRAME];
+      seg_param->segment_flags.fields.segment_reference_skipped =
+          seg->feature_enabled[i][GST_VAAPI_VP9_SEG_LVL_SKIP];
+    }
+
+    gst_vaapi_utils_vp9_get_filter_levels (frame_hdr, i,
+        seg_param->filter_level);
+
+    seg_param->luma_ac_quant_scale = gst_vaapi_utils_vp9_get_ac_quant (qindex);
+    seg_param->luma_dc_quant_scale =
+        gst_vaapi_utils_vp9_get_dc_quant (qindex + frame_hdr->delta_q_y_dc);
+    seg_param->chroma_ac_quant_scale =
+        gst_vaapi_utils_vp9_get_ac_quant (qindex + frame_hdr->delta_q_uv_ac);
+    seg_param->chroma_dc_quant_scale =
+        gst_vaapi_utils_vp9_get_dc_quant (qindex + frame_hdr->delta_q_uv_dc);
+  }
+  return TRUE;
+}
+
+static GstVaapiDecoderStatus
+decode_slice (GstVaapiDecoderVp9 * decoder, GstVaapiPicture * picture,
+    const guchar * buf, guint buf_size)
+{
+  GstVaapiSlice *slice;
+
+  slice = GST_VAAPI_SLICE_NEW (VP9, decoder, buf, buf_size);
+  if (!slice) {
+    GST_ERROR ("failed to allocate slice");
+    return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+  }
+
+  if (!fill_slice (decoder, slice)) {
+    gst_vaapi_mini_object_unref (GST_VAAPI_MINI_OBJECT (slice));
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+  }
+
+  gst_vaapi_picture_add_slice (GST_VAAPI_PICTURE_CAST (picture), slice);
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+decode_picture (GstVaapiDecoderVp9 * decoder, const guchar * buf,
+    guint buf_size)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  GstVaapiVp9FrameHdr *const frame_hdr = &priv->frame_hdr;
+  GstVaapiPicture *picture;
+  GstVaapiDecoderStatus status;
+  guint i;
+
+  /* Inter frames need all their references, e.g. when the stream
+     does not start with a key frame */
+  if (frame_hdr->frame_type != GST_VAAPI_VP9_KEY_FRAME &&
+      !frame_hdr->intra_only) {
+    for (i = 0; i < GST_VAAPI_VP9_REFS_PER_FRAME; i++) {
+      if (!priv->ref_frames[frame_hdr->ref_frame_idx[i]])
+        goto error_missing_reference;
+    }
+  }
+
+  status = ensure_context (decoder);
+  if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+    return status;
+
+  /* Create new picture */
+  picture = gst_vaapi_picture_new (GST_VAAPI_DECODER (decoder), NULL,
+      sizeof (VADecPictureParameterBufferVP9));
+  if (!picture) {
+    GST_ERROR ("failed to allocate picture");
+    return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+  }
+  gst_vaapi_picture_replace (&priv->current_picture, picture);
+  gst_vaapi_picture_unref (picture);
+
+  init_picture (decoder, picture);
+  if (!fill_picture (decoder, picture))
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+
+  return decode_slice (decoder, picture, buf, buf_size);
+
+  /* ERRORS */
+error_missing_reference:
+  {
+    GST_WARNING ("missing reference frame %u, dropping frame",
+        frame_hdr->ref_frame_idx[i]);
+    return GST_VAAPI_DECODER_STATUS_DROP_FRAME;
+  }
+}
+
+/* Outputs the frame held by one of the reference slots again, without
+   decoding anything */
+static GstVaapiDecoderStatus
+decode_show_existing_frame (GstVaapiDecoderVp9 * decoder)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  GstVaapiVp9FrameHdr *const frame_hdr = &priv->frame_hdr;
+  GstVaapiPicture *const ref_picture =
+      priv->ref_frames[frame_hdr->frame_to_show];
+  GstVaapiPicture *picture;
+  gboolean success;
+
+  if (!ref_picture)
+    goto error_missing_reference;
+
+  picture = gst_vaapi_picture_new_field (ref_picture);
+  if (!picture) {
+    GST_ERROR ("failed to allocate picture");
+    return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
+  }
+  GST_VAAPI_PICTURE_FLAG_UNSET (picture, GST_VAAPI_PICTURE_FLAG_SKIPPED);
+  picture->pts = GST_VAAPI_DECODER_CODEC_FRAME (decoder)->pts;
+
+  success = gst_vaapi_picture_output (picture);
+  gst_vaapi_picture_unref (picture);
+  if (!success)
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+
+  priv->frame_output = TRUE;
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+  /* ERRORS */
+error_missing_reference:
+  {
+    GST_WARNING ("missing frame to show %u, dropping frame",
+        frame_hdr->frame_to_show);
+    return GST_VAAPI_DECODER_STATUS_DROP_FRAME;
+  }
+}
+
+static void
+update_ref_frames (GstVaapiDecoderVp9 * decoder)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  GstVaapiPicture *const picture = priv->current_picture;
+  GstVaapiVp9FrameHdr *const frame_hdr = &priv->frame_hdr;
+  guint i;
+
+  for (i = 0; i < GST_VAAPI_VP9_REF_FRAMES; i++) {
+    if (frame_hdr->refresh_frame_flags & (1 << i))
+      gst_vaapi_picture_replace (&priv->ref_frames[i], picture);
+  }
+}
+
+static GstVaapiDecoderStatus
+decode_current_picture (GstVaapiDecoderVp9 * decoder)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  GstVaapiPicture *const picture = priv->current_picture;
+
+  if (!picture)
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+  if (!gst_vaapi_picture_decode (picture))
+    goto error;
+  update_ref_frames (decoder);
+
+  /* Hidden frames, e.g. alternate reference frames, are only used as
+     references or shown later with show_existing_frame */
+  if (priv->frame_hdr.show_frame) {
+    if (!gst_vaapi_picture_output (picture))
+      goto error;
+    priv->frame_output = TRUE;
+  }
+  gst_vaapi_picture_replace (&priv->current_picture, NULL);
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+error:
+  gst_vaapi_picture_replace (&priv->current_picture, NULL);
+  return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+}
+
+static GstVaapiDecoderStatus
+parse_frame_header (GstVaapiDecoderVp9 * decoder, const guchar * buf,
+    guint buf_size, GstVaapiVp9FrameHdr * frame_hdr)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+
+  if (!gst_vaapi_utils_vp9_parse_frame_header (&priv->parser, frame_hdr,
+          buf, buf_size))
+    return GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+
+  if (frame_hdr->show_existing_frame)
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+  if (frame_hdr->profile != 0) {
+    GST_ERROR ("unsupported profile %u", frame_hdr->profile);
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNSUPPORTED_PROFILE;
+  }
+
+  /* The frame size may change on any frame, not only key frames. The
+     surfaces are only reallocated when they get too small, so that the
+     references of another size remain valid. Those references are kept
+     as render targets of the new VA context */
+  if (frame_hdr->width > priv->width || frame_hdr->height > priv->height) {
+    priv->width = MAX (priv->width, frame_hdr->width);
+    priv->height = MAX (priv->height, frame_hdr->height);
+    priv->size_changed = TRUE;
+  }
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+/* Splits superframes into one decoder unit per frame. The superframe
+   index is appended to the last frame, and is skipped */
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_vp9_parse (GstVaapiDecoder * base_decoder,
+    GstAdapter * adapter, gboolean at_eos, GstVaapiDecoderUnit * unit)
+{
+  GstVaapiDecoderVp9 *const decoder = GST_VAAPI_DECODER_VP9_CAST (base_decoder);
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  guint frame_sizes[GST_VAAPI_VP9_MAX_SUPERFRAME_FRAMES];
+  guint i, buf_size, num_frames, index_size = 0, flags = 0;
+  const guchar *buf;
+
+  buf_size = gst_adapter_available (adapter);
+  if (!buf_size)
+    return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+
+  /* The whole buffer is available */
+  if (priv->unit_index >= priv->num_units) {
+    buf = gst_adapter_map (adapter, buf_size);
+    if (!buf)
+      return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+    num_frames = gst_vaapi_utils_vp9_parse_superframe_index (buf, buf_size,
+        frame_sizes, &index_size);
+    gst_adapter_unmap (adapter);
+
+    if (num_frames > 0) {
+      for (i = 0; i < num_frames; i++)
+        priv->unit_sizes[i] = frame_sizes[i];
+      priv->unit_sizes[i] = index_size;
+      priv->num_units = num_frames + 1;
+    } else {
+      priv->unit_sizes[0] = buf_size;
+      priv->num_units = 1;
+    }
+    priv->unit_index = 0;
+  }
+
+  unit->size = priv->unit_sizes[priv->unit_index];
+  if (unit->size > buf_size)
+    goto error_truncated;
+
+  if (priv->unit_index == 0)
+    flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
+  if (priv->unit_index == priv->num_units - 1) {
+    flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_END;
+    if (priv->num_units > 1)
+      flags |= GST_VAAPI_DECODER_UNIT_FLAG_SKIP;
+    else
+      flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
+  } else
+    flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
+  GST_VAAPI_DECODER_UNIT_FLAG_SET (unit, flags);
+  priv->unit_index++;
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated superframe (%u bytes left, %u expected)",
+        buf_size, unit->size);
+    priv->num_units = 0;
+    priv->unit_index = 0;
+    return GST_VAAPI_DECODER_STATUS_ERROR_BITSTREAM_PARSER;
+  }
+}
+
+static GstVaapiDecoderStatus
+decode_buffer (GstVaapiDecoderVp9 * decoder, const guchar * buf, guint buf_size)
+{
+  GstVaapiDecoderVp9Private *const priv = &decoder->priv;
+  GstVaapiDecoderStatus status;
+
+  /* Finish the previous frame of the superframe, if any, as the frame
+     header updates the reference slots it refreshes */
+  status = decode_current_picture (decoder);
+  if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+    return status;
+
+  status = parse_frame_header (decoder, buf, buf_size, &priv->frame_hdr);
+  if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+    return status;
+
+  if (priv->frame_hdr.show_existing_frame)
+    return decode_show_existing_frame (decoder);
+  return decode_picture (decoder, buf, buf_size);
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_vp9_decode (GstVaapiDecoder * base_decoder,
+    GstVaapiDecoderUnit * unit)
+{
+  GstVaapiDecoderVp9 *const decoder = GST_VAAPI_DECODER_VP9_CAST (base_decoder);
+  GstVaapiDecoderStatus status;
+  GstBuffer *const buffer =
+      GST_VAAPI_DECODER_CODEC_FRAME (decoder)->input_buffer;
+  GstMapInfo map_info;
+
+  if (!gst_buffer_map (buffer, &map_info, GST_MAP_READ)) {
+    GST_ERROR ("failed to map buffer");
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
+  }
+
+  status = decode_buffer (decoder, map_info.data + unit->offset, unit->size);
+  gst_buffer_unmap (buffer, &map_info);
+  return status;
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_vp9_start_frame (GstVaapiDecoder * base_decoder,
+    GstVaapiDecoderUnit * base_unit)
+{
+  GstVaapiDecoderVp9 *const decoder = GST_VAAPI_DECODER_VP9_CAST (base_decoder);
+
+  decoder->priv.frame_output = FALSE;
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_vp9_end_frame (GstVaapiDecoder * base_decoder)
+{
+  GstVaapiDecoderVp9 *const decoder = GST_VAAPI_DECODER_VP9_CAST (base_decoder);
+  GstVaapiDecoderStatus status;
+
+  status = decode_current_picture (decoder);
+  if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+    return status;
+
+  /* Nothing was shown, e.g. a lone hidden frame */
+  if (!decoder->priv.frame_output)
+    return GST_VAAPI_DECODER_STATUS_DROP_FRAME;
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static GstVaapiDecoderStatus
+gst_vaapi_decoder_vp9_flush (GstVaapiDecoder * base_decoder)
+{
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+static void
+gst_vaapi_decoder_vp9_class_init (GstVaapiDecoderVp9Class * klass)
+{
+  GstVaapiMiniObjectClass *const object_class =
+      GST_VAAPI_MINI_OBJECT_CLASS (klass);
+  GstVaapiDecoderClass *const decoder_class = GST_VAAPI_DECODER_CLASS (klass);
+
+  object_class->size = sizeof (GstVaapiDecoderVp9);
+  object_class->finalize = (GDestroyNotify) gst_vaapi_decoder_finalize;
+
+  decoder_class->create = gst_vaapi_decoder_vp9_create;
+  decoder_class->destroy = gst_vaapi_decoder_vp9_destroy;
+  decoder_class->parse = gst_vaapi_decoder_vp9_parse;
+  decoder_class->decode = gst_vaapi_decoder_vp9_decode;
+  decoder_class->start_frame = gst_vaapi_decoder_vp9_start_frame;
+  decoder_class->end_frame = gst_vaapi_decoder_vp9_end_frame;
+  decoder_class->flush = gst_vaapi_decoder_vp9_flush;
+}
+
+static inline const GstVaapiDecoderClass *
+gst_vaapi_decoder_vp9_class (void)
+{
+  static GstVaapiDecoderVp9Class g_class;
+  static gsize g_class_init = FALSE;
+
+  if (g_once_init_enter (&g_class_init)) {
+    gst_vaapi_decoder_vp9_class_init (&g_class);
+    g_once_init_leave (&g_class_init, TRUE);
+  }
+  return GST_VAAPI_DECODER_CLASS (&g_class);
+}
+
+/**
+ * gst_vaapi_decoder_vp9_new:
+ * @display: a #GstVaapiDisplay
+ * @caps: a #GstCaps holding codec information
+ *
+ * Creates a new #GstVaapiDecoder for VP9 decoding.  The @caps can
+ * hold extra information like codec-data and pictured coded size.
+ *
+ * Return value: the newly allocated #GstVaapiDecoder object
+ */
+GstVaapiDecoder *
+gst_vaapi_decoder_vp9_new (GstVaapiDisplay * display, GstCaps * caps)
+{
+  return gst_vaapi_decoder_new (gst_vaapi_decoder_vp9_class (), display, caps);
+}
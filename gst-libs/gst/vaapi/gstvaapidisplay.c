@@ -33,6 +33,8 @@
 #include "gstvaapivalue.h"
 #include "gstvaapidisplay.h"
 #include "gstvaapidisplay_priv.h"
+#include "gstvaapiobject.h"
+#include "gstvaapivideopool_priv.h"
 #include "gstvaapiworkarounds.h"
 #include "gstvaapiversion.h"
 
@@ -71,6 +73,10 @@ struct _GstVaapiFormatInfo
 #define DEFAULT_RENDER_MODE     GST_VAAPI_RENDER_MODE_TEXTURE
 #define DEFAULT_ROTATION        GST_VAAPI_ROTATION_0
 
+/* Default amount of free VA surfaces kept around for reuse, in MiB,
+   i.e. about a full 1080p decoder pool */
+#define DEFAULT_SURFACE_CACHE_SIZE 64
+
 enum
 {
   PROP_0,
@@ -88,6 +94,11 @@ enum
 static GstVaapiDisplayCache *g_display_cache;
 static GMutex g_display_cache_lock;
 
+/* Serializes the creation and destruction of displays, so that the
+   display cache lookups and additions performed there remain atomic.
+   Plain lookups only rely on the display cache own reader lock */
+static GMutex g_display_create_lock;
+
 static GParamSpec *g_properties[N_PROPERTIES] = { NULL, };
 
 static void gst_vaapi_display_properties_init (void);
@@ -105,6 +116,12 @@ get_color_balance (GstVaapiDisplay * display, guint prop_id, gfloat * v);
 static gboolean
 set_color_balance (GstVaapiDisplay * display, guint prop_id, gfloat v);
 
+static gboolean
+ensure_vendor_string (GstVaapiDisplay * display);
+
+static void
+ensure_caps_cache (GstVaapiDisplay * display);
+
 static void
 libgstvaapi_init_once (void)
 {
@@ -502,6 +519,7 @@ ensure_profiles (GstVaapiDisplay * display)
   VAStatus status;
   gboolean success = FALSE;
 
+  ensure_caps_cache (display);
   if (priv->has_profiles)
     return TRUE;
 
@@ -557,6 +575,7 @@ ensure_profiles (GstVaapiDisplay * display)
           g_array_append_val (priv->decoders, config);
           break;
         case GST_VAAPI_ENTRYPOINT_SLICE_ENCODE:
+        case GST_VAAPI_ENTRYPOINT_PICTURE_ENCODE:
           g_array_append_val (priv->encoders, config);
           break;
       }
@@ -684,6 +703,7 @@ ensure_image_formats (GstVaapiDisplay * display)
   gint i, n;
   gboolean success = FALSE;
 
+  ensure_caps_cache (display);
   if (priv->image_formats)
     return TRUE;
 
@@ -725,6 +745,7 @@ ensure_subpicture_formats (GstVaapiDisplay * display)
   guint i, n;
   gboolean success = FALSE;
 
+  ensure_caps_cache (display);
   if (priv->subpicture_formats)
     return TRUE;
 
@@ -763,6 +784,355 @@ cleanup:
   return success;
 }
 
+/* ------------------------------------------------------------------------- */
+/* --- Capabilities cache                                                --- */
+/* ------------------------------------------------------------------------- */
+
+/* The decoders, encoders, image and subpicture formats, and the VPP
+ * capability, only depend on the VA driver and the device. So, they
+ * are stored on disk the first time they are probed, and re-used by
+ * the next processes. Display properties are always queried since
+ * they depend on the current attribute values */
+
+#define CAPS_CACHE_VERSION      1
+#define CAPS_CACHE_GROUP_HEADER "cache"
+#define CAPS_CACHE_GROUP_CAPS   "capabilities"
+
+static gboolean
+caps_cache_is_enabled (void)
+{
+  return g_getenv ("GST_VAAPI_DISABLE_CAPS_CACHE") == NULL;
+}
+
+/* Determines the cache file name from the VA driver vendor string and
+   the device name */
+static gchar *
+caps_cache_get_filename (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  gchar *key, *checksum, *basename, *filename;
+
+  key = g_strdup_printf ("%s\n%s", priv->vendor_string,
+      priv->display_name ? priv->display_name : "");
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+  g_free (key);
+  if (!checksum)
+    return NULL;
+
+  basename = g_strdup_printf ("%s.caps", checksum);
+  filename = g_build_filename (g_get_user_cache_dir (), "gstreamer-vaapi",
+      basename, NULL);
+  g_free (basename);
+  g_free (checksum);
+  return filename;
+}
+
+/* Checks whether the cache header matches the running configuration */
+static gboolean
+caps_cache_check_header (GstVaapiDisplay * display, GKeyFile * key_file)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  const struct
+  {
+    const gchar *key;
+    const gchar *value;
+  } *entry, entries[] = {
+    {"gstreamer-vaapi", GST_VAAPI_VERSION_ID},
+    {"libva", VA_VERSION_S},
+    {"vendor", priv->vendor_string},
+    {"device", priv->display_name ? priv->display_name : ""},
+    {NULL,}
+  };
+  gchar *value;
+  gboolean success;
+
+  if (g_key_file_get_integer (key_file, CAPS_CACHE_GROUP_HEADER, "version",
+          NULL) != CAPS_CACHE_VERSION)
+    return FALSE;
+
+  for (entry = entries; entry->key != NULL; entry++) {
+    value = g_key_file_get_string (key_file, CAPS_CACHE_GROUP_HEADER,
+        entry->key, NULL);
+    success = value && strcmp (value, entry->value) == 0;
+    g_free (value);
+    if (!success)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Reads an array of GstVaapiConfig elements, stored as a list of
+   (profile, entrypoint) pairs */
+static GArray *
+caps_cache_get_configs (GKeyFile * key_file, const gchar * key)
+{
+  GArray *configs;
+  GError *error = NULL;
+  gint *values;
+  gsize i, num_values;
+
+  values = g_key_file_get_integer_list (key_file, CAPS_CACHE_GROUP_CAPS, key,
+      &num_values, &error);
+  if (error || num_values % 2 != 0)
+    goto error_invalid_list;
+
+  configs = g_array_sized_new (FALSE, FALSE, sizeof (GstVaapiConfig),
+      num_values / 2);
+  for (i = 0; i < num_values; i += 2) {
+    GstVaapiConfig config;
+
+    config.profile = values[i];
+    config.entrypoint = values[i + 1];
+    g_array_append_val (configs, config);
+  }
+  g_free (values);
+  return configs;
+
+  /* ERRORS */
+error_invalid_list:
+  {
+    GST_DEBUG ("invalid cached list of %s", key);
+    g_clear_error (&error);
+    g_free (values);
+    return NULL;
+  }
+}
+
+static void
+caps_cache_set_configs (GKeyFile * key_file, const gchar * key,
+    GArray * configs)
+{
+  gint *values;
+  guint i;
+
+  values = g_new (gint, 2 * configs->len + 1);
+  for (i = 0; i < configs->len; i++) {
+    const GstVaapiConfig *const config =
+        &g_array_index (configs, GstVaapiConfig, i);
+
+    values[2 * i] = config->profile;
+    values[2 * i + 1] = config->entrypoint;
+  }
+  g_key_file_set_integer_list (key_file, CAPS_CACHE_GROUP_CAPS, key, values,
+      2 * configs->len);
+  g_free (values);
+}
+
+/* Reads an array of GstVaapiFormatInfo elements, stored as a list of
+   (format, flags) pairs */
+static GArray *
+caps_cache_get_formats (GKeyFile * key_file, const gchar * key)
+{
+  GArray *formats;
+  GError *error = NULL;
+  gint *values;
+  gsize i, num_values;
+
+  values = g_key_file_get_integer_list (key_file, CAPS_CACHE_GROUP_CAPS, key,
+      &num_values, &error);
+  if (error || num_values % 2 != 0)
+    goto error_invalid_list;
+
+  formats = g_array_sized_new (FALSE, FALSE, sizeof (GstVaapiFormatInfo),
+      num_values / 2);
+  for (i = 0; i < num_values; i += 2) {
+    GstVaapiFormatInfo fi;
+
+    fi.format = values[i];
+    fi.flags = values[i + 1];
+    if (!gst_vaapi_video_format_to_va_format (fi.format))
+      goto error_invalid_format;
+    g_array_append_val (formats, fi);
+  }
+  g_free (values);
+  return formats;
+
+  /* ERRORS */
+error_invalid_list:
+  {
+    GST_DEBUG ("invalid cached list of %s", key);
+    g_clear_error (&error);
+    g_free (values);
+    return NULL;
+  }
+error_invalid_format:
+  {
+    GST_DEBUG ("unsupported cached format %d in %s", values[i], key);
+    g_array_unref (formats);
+    g_free (values);
+    return NULL;
+  }
+}
+
+static void
+caps_cache_set_formats (GKeyFile * key_file, const gchar * key,
+    GArray * formats)
+{
+  gint *values;
+  guint i;
+
+  values = g_new (gint, 2 * formats->len + 1);
+  for (i = 0; i < formats->len; i++) {
+    const GstVaapiFormatInfo *const fip =
+        &g_array_index (formats, GstVaapiFormatInfo, i);
+
+    values[2 * i] = fip->format;
+    values[2 * i + 1] = fip->flags;
+  }
+  g_key_file_set_integer_list (key_file, CAPS_CACHE_GROUP_CAPS, key, values,
+      2 * formats->len);
+  g_free (values);
+}
+
+/* Fills in the display capabilities from the cache file, if valid */
+static gboolean
+caps_cache_load (GstVaapiDisplay * display, const gchar * filename)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  GArray *decoders = NULL, *encoders = NULL;
+  GArray *image_formats = NULL, *subpicture_formats = NULL;
+  GKeyFile *key_file;
+  GError *error = NULL;
+  gboolean has_vpp, success = FALSE;
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, NULL))
+    goto cleanup;
+  if (!caps_cache_check_header (display, key_file)) {
+    GST_DEBUG ("ignoring stale capabilities cache %s", filename);
+    goto cleanup;
+  }
+
+  decoders = caps_cache_get_configs (key_file, "decoders");
+  if (!decoders)
+    goto cleanup;
+  encoders = caps_cache_get_configs (key_file, "encoders");
+  if (!encoders)
+    goto cleanup;
+  image_formats = caps_cache_get_formats (key_file, "image-formats");
+  if (!image_formats)
+    goto cleanup;
+  subpicture_formats = caps_cache_get_formats (key_file, "subpicture-formats");
+  if (!subpicture_formats)
+    goto cleanup;
+  has_vpp = g_key_file_get_boolean (key_file, CAPS_CACHE_GROUP_CAPS,
+      "video-processing", &error);
+  if (error)
+    goto cleanup;
+
+  priv->decoders = g_array_ref (decoders);
+  priv->encoders = g_array_ref (encoders);
+  priv->image_formats = g_array_ref (image_formats);
+  priv->subpicture_formats = g_array_ref (subpicture_formats);
+  priv->has_vpp = has_vpp;
+  priv->has_profiles = TRUE;
+  GST_DEBUG ("loaded capabilities from %s", filename);
+  success = TRUE;
+
+cleanup:
+  g_clear_error (&error);
+  if (decoders)
+    g_array_unref (decoders);
+  if (encoders)
+    g_array_unref (encoders);
+  if (image_formats)
+    g_array_unref (image_formats);
+  if (subpicture_formats)
+    g_array_unref (subpicture_formats);
+  g_key_file_free (key_file);
+  return success;
+}
+
+/* Stores the probed display capabilities into the cache file */
+static gboolean
+caps_cache_save (GstVaapiDisplay * display, const gchar * filename)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  GKeyFile *key_file;
+  GError *error = NULL;
+  gchar *dirname, *data = NULL;
+  gsize data_size;
+  gboolean success = FALSE;
+
+  dirname = g_path_get_dirname (filename);
+  if (g_mkdir_with_parents (dirname, 0755) < 0)
+    goto error_create_directory;
+
+  key_file = g_key_file_new ();
+  g_key_file_set_integer (key_file, CAPS_CACHE_GROUP_HEADER, "version",
+      CAPS_CACHE_VERSION);
+  g_key_file_set_string (key_file, CAPS_CACHE_GROUP_HEADER, "gstreamer-vaapi",
+      GST_VAAPI_VERSION_ID);
+  g_key_file_set_string (key_file, CAPS_CACHE_GROUP_HEADER, "libva",
+      VA_VERSION_S);
+  g_key_file_set_string (key_file, CAPS_CACHE_GROUP_HEADER, "vendor",
+      priv->vendor_string);
+  g_key_file_set_string (key_file, CAPS_CACHE_GROUP_HEADER, "device",
+      priv->display_name ? priv->display_name : "");
+
+  caps_cache_set_configs (key_file, "decoders", priv->decoders);
+  caps_cache_set_configs (key_file, "encoders", priv->encoders);
+  caps_cache_set_formats (key_file, "image-formats", priv->image_formats);
+  caps_cache_set_formats (key_file, "subpicture-formats",
+      priv->subpicture_formats);
+  g_key_file_set_boolean (key_file, CAPS_CACHE_GROUP_CAPS, "video-processing",
+      priv->has_vpp);
+
+  /* g_file_set_contents() writes to a temporary file first, so
+     concurrent processes never see a partially written cache */
+  data = g_key_file_to_data (key_file, &data_size, NULL);
+  g_key_file_free (key_file);
+  if (!data || !g_file_set_contents (filename, data, data_size, &error))
+    goto error_write_file;
+  GST_DEBUG ("saved capabilities to %s", filename);
+  success = TRUE;
+
+cleanup:
+  g_free (data);
+  g_free (dirname);
+  return success;
+
+  /* ERRORS */
+error_create_directory:
+  {
+    GST_DEBUG ("failed to create capabilities cache directory %s", dirname);
+    goto cleanup;
+  }
+error_write_file:
+  {
+    GST_DEBUG ("failed to write capabilities cache %s: %s", filename,
+        error ? error->message : "no data");
+    g_clear_error (&error);
+    goto cleanup;
+  }
+}
+
+/* Loads the display capabilities from the cache, or probes them all
+   at once so that the next processes could avoid that */
+static void
+ensure_caps_cache (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  gchar *filename;
+
+  if (priv->has_caps_cache)
+    return;
+  priv->has_caps_cache = TRUE;
+
+  if (!caps_cache_is_enabled () || !ensure_vendor_string (display))
+    return;
+
+  filename = caps_cache_get_filename (display);
+  if (!filename)
+    return;
+
+  if (!caps_cache_load (display, filename) &&
+      ensure_profiles (display) &&
+      ensure_image_formats (display) && ensure_subpicture_formats (display))
+    caps_cache_save (display, filename);
+  g_free (filename);
+}
+
 static void
 gst_vaapi_display_calculate_pixel_aspect_ratio (GstVaapiDisplay * display)
 {
@@ -842,6 +1212,12 @@ gst_vaapi_display_destroy (GstVaapiDisplay * display)
     priv->properties = NULL;
   }
 
+  if (priv->surface_cache) {
+    gst_vaapi_surface_cache_clear (priv->surface_cache);
+    gst_vaapi_surface_cache_replace (&priv->surface_cache, NULL);
+  }
+  gst_vaapi_subpicture_cache_replace (&priv->subpicture_cache, NULL);
+
   if (priv->display) {
     if (!priv->parent)
       vaTerminate (priv->display);
@@ -862,10 +1238,10 @@ gst_vaapi_display_destroy (GstVaapiDisplay * display)
 
   gst_vaapi_display_replace_internal (&priv->parent, NULL);
 
-  g_mutex_lock (&g_display_cache_lock);
+  g_mutex_lock (&g_display_create_lock);
   if (priv->cache)
     gst_vaapi_display_cache_remove (priv->cache, display);
-  g_mutex_unlock (&g_display_cache_lock);
+  g_mutex_unlock (&g_display_create_lock);
   gst_vaapi_display_cache_replace (&priv->cache, NULL);
   free_display_cache ();
 }
@@ -953,9 +1329,9 @@ gst_vaapi_display_create (GstVaapiDisplay * display,
   gst_vaapi_display_cache_replace (&priv->cache, cache);
   gst_vaapi_display_cache_unref (cache);
 
-  g_mutex_lock (&g_display_cache_lock);
+  g_mutex_lock (&g_display_create_lock);
   success = gst_vaapi_display_create_unlocked (display, init_type, init_value);
-  g_mutex_unlock (&g_display_cache_lock);
+  g_mutex_unlock (&g_display_create_lock);
   return success;
 }
 
@@ -979,6 +1355,18 @@ gst_vaapi_display_unlock_default (GstVaapiDisplay * display)
   g_rec_mutex_unlock (&priv->mutex);
 }
 
+/* Reads the default video memory budget, in MiB */
+static guint64
+get_memory_budget_from_env (void)
+{
+  const gchar *str;
+
+  str = g_getenv ("GST_VAAPI_MEMORY_BUDGET");
+  if (!str)
+    return 0;
+  return g_ascii_strtoull (str, NULL, 10) << 20;
+}
+
 static void
 gst_vaapi_display_init (GstVaapiDisplay * display)
 {
@@ -991,6 +1379,8 @@ gst_vaapi_display_init (GstVaapiDisplay * display)
   priv->par_d = 1;
 
   g_rec_mutex_init (&priv->mutex);
+  g_mutex_init (&priv->memory_lock);
+  priv->memory_budget = get_memory_budget_from_env ();
 
   if (dpy_class->init)
     dpy_class->init (display);
@@ -1002,6 +1392,8 @@ gst_vaapi_display_finalize (GstVaapiDisplay * display)
   GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
 
   gst_vaapi_display_destroy (display);
+  g_list_free (priv->video_pools);
+  g_mutex_clear (&priv->memory_lock);
   g_rec_mutex_clear (&priv->mutex);
 }
 
@@ -2094,3 +2486,553 @@ gst_vaapi_display_get_vendor_string (GstVaapiDisplay * display)
     return NULL;
   return display->priv.vendor_string;
 }
+
+/* Returns the display that owns the VA display, i.e. the one that
+   actually accounts for the allocated VA resources */
+static inline GstVaapiDisplayPrivate *
+get_usage_display_private (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+
+  if (priv->parent)
+    priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+  return priv;
+}
+
+/**
+ * gst_vaapi_display_update_usage:
+ * @display: a #GstVaapiDisplay
+ * @num_contexts: the number of VA contexts created (> 0) or destroyed (< 0)
+ * @num_surfaces: the number of VA surfaces created (> 0) or destroyed (< 0)
+ *
+ * Accounts for VA resources allocated or released on the supplied
+ * @display. This is an internal function.
+ *
+ * This function is thread safe.
+ */
+void
+gst_vaapi_display_update_usage (GstVaapiDisplay * display, gint num_contexts,
+    gint num_surfaces)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = get_usage_display_private (display);
+  if (num_contexts)
+    g_atomic_int_add (&priv->num_contexts, num_contexts);
+  if (num_surfaces)
+    g_atomic_int_add (&priv->num_surfaces, num_surfaces);
+}
+
+/**
+ * gst_vaapi_display_get_usage:
+ * @display: a #GstVaapiDisplay
+ * @num_contexts: (out) (allow-none): return location for the number of
+ *   active VA contexts
+ * @num_surfaces: (out) (allow-none): return location for the number of
+ *   active VA surfaces
+ *
+ * Retrieves the number of VA contexts and VA surfaces currently
+ * allocated on the underlying VA display. Displays sharing the same
+ * VA display report the same usage.
+ *
+ * This function is thread safe.
+ */
+void
+gst_vaapi_display_get_usage (GstVaapiDisplay * display, guint * num_contexts,
+    guint * num_surfaces)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = get_usage_display_private (display);
+  if (num_contexts)
+    *num_contexts = MAX (g_atomic_int_get (&priv->num_contexts), 0);
+  if (num_surfaces)
+    *num_surfaces = MAX (g_atomic_int_get (&priv->num_surfaces), 0);
+}
+
+static void
+destroy_cached_surface (GstVaapiID surface_id, gpointer user_data)
+{
+  GstVaapiDisplay *const display = user_data;
+  VASurfaceID va_surface = surface_id;
+  VAStatus status;
+
+  GST_VAAPI_DISPLAY_LOCK (display);
+  status = vaDestroySurfaces (GST_VAAPI_DISPLAY_VADISPLAY (display),
+      &va_surface, 1);
+  GST_VAAPI_DISPLAY_UNLOCK (display);
+  if (!vaapi_check_status (status, "vaDestroySurfaces()"))
+    GST_WARNING ("failed to destroy surface %" GST_VAAPI_ID_FORMAT,
+        GST_VAAPI_ID_ARGS (surface_id));
+  gst_vaapi_display_update_usage (display, 0, -1);
+}
+
+/* Returns the maximum size of the surface cache, in bytes */
+static gsize
+get_surface_cache_size (void)
+{
+  const gchar *str;
+
+  str = g_getenv ("GST_VAAPI_SURFACE_CACHE_SIZE");
+  if (!str)
+    return (gsize) DEFAULT_SURFACE_CACHE_SIZE << 20;
+  return (gsize) g_ascii_strtoull (str, NULL, 10) << 20;
+}
+
+/* Returns the surface cache of the display that owns the VA display,
+   creating it on first use */
+static GstVaapiSurfaceCache *
+ensure_surface_cache (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  if (display->priv.parent)
+    display = display->priv.parent;
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+
+  GST_VAAPI_DISPLAY_LOCK (display);
+  if (!priv->surface_cache)
+    priv->surface_cache = gst_vaapi_surface_cache_new
+        (get_surface_cache_size (), destroy_cached_surface, display);
+  GST_VAAPI_DISPLAY_UNLOCK (display);
+  return priv->surface_cache;
+}
+
+/**
+ * gst_vaapi_display_get_cached_surface:
+ * @display: a #GstVaapiDisplay
+ * @chroma_type: the requested chroma type
+ * @width: the requested width, in pixels
+ * @height: the requested height, in pixels
+ *
+ * Reclaims a free VA surface of the specified chroma type and size, as
+ * previously released with gst_vaapi_display_put_cached_surface(). The
+ * caller takes ownership of the returned VA surface. This is an
+ * internal function.
+ *
+ * Return value: the VA surface, or %VA_INVALID_SURFACE if none matches
+ */
+GstVaapiID
+gst_vaapi_display_get_cached_surface (GstVaapiDisplay * display,
+    GstVaapiChromaType chroma_type, guint width, guint height)
+{
+  GstVaapiSurfaceCache *cache;
+
+  g_return_val_if_fail (display != NULL, VA_INVALID_SURFACE);
+
+  cache = ensure_surface_cache (display);
+  if (!cache)
+    return VA_INVALID_SURFACE;
+  return gst_vaapi_surface_cache_get (cache, chroma_type, width, height);
+}
+
+/**
+ * gst_vaapi_display_put_cached_surface:
+ * @display: a #GstVaapiDisplay
+ * @surface_id: a free VA surface
+ * @chroma_type: the chroma type of the surface
+ * @width: the surface width, in pixels
+ * @height: the surface height, in pixels
+ *
+ * Hands the VA surface @surface_id over to the @display so that it
+ * could be reused later on by a decoder at the same resolution, e.g.
+ * after an adaptive streaming switch. The surface is still accounted
+ * for in gst_vaapi_display_get_usage(). The cache holds at most 64 MiB
+ * of surfaces, or the number of MiB set with the
+ * GST_VAAPI_SURFACE_CACHE_SIZE environment variable, and is trimmed
+ * first whenever the memory budget is exceeded. This is an internal
+ * function.
+ *
+ * Return value: %TRUE if the @display took ownership of the surface,
+ *   %FALSE if the caller has to destroy it
+ */
+gboolean
+gst_vaapi_display_put_cached_surface (GstVaapiDisplay * display,
+    GstVaapiID surface_id, GstVaapiChromaType chroma_type, guint width,
+    guint height)
+{
+  GstVaapiSurfaceCache *cache;
+
+  g_return_val_if_fail (display != NULL, FALSE);
+
+  cache = ensure_surface_cache (display);
+  if (!cache)
+    return FALSE;
+  if (!gst_vaapi_surface_cache_put (cache, surface_id, chroma_type,
+          width, height))
+    return FALSE;
+  gst_vaapi_display_check_memory_budget (display);
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_display_get_subpicture_cache:
+ * @display: a #GstVaapiDisplay
+ *
+ * Returns the cache of subpictures shared by all contexts and surfaces
+ * of the underlying VA display, creating it on first use. Subpictures
+ * do not outlive the @display, so the returned cache remains valid for
+ * as long as any of them. This is an internal function.
+ *
+ * Return value: the #GstVaapiSubpictureCache, or %NULL on error
+ */
+GstVaapiSubpictureCache *
+gst_vaapi_display_get_subpicture_cache (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_val_if_fail (display != NULL, NULL);
+
+  if (display->priv.parent)
+    display = display->priv.parent;
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+
+  GST_VAAPI_DISPLAY_LOCK (display);
+  if (!priv->subpicture_cache)
+    priv->subpicture_cache = gst_vaapi_subpicture_cache_new ();
+  GST_VAAPI_DISPLAY_UNLOCK (display);
+  return priv->subpicture_cache;
+}
+
+/**
+ * gst_vaapi_display_add_video_pool:
+ * @display: a #GstVaapiDisplay
+ * @pool: a #GstVaapiVideoPool
+ *
+ * Registers @pool for memory accounting on the underlying VA display.
+ * This is an internal function.
+ */
+void
+gst_vaapi_display_add_video_pool (GstVaapiDisplay * display,
+    GstVaapiVideoPool * pool)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+  g_return_if_fail (pool != NULL);
+
+  priv = get_usage_display_private (display);
+  g_mutex_lock (&priv->memory_lock);
+  priv->video_pools = g_list_prepend (priv->video_pools, pool);
+  g_mutex_unlock (&priv->memory_lock);
+}
+
+/**
+ * gst_vaapi_display_remove_video_pool:
+ * @display: a #GstVaapiDisplay
+ * @pool: a #GstVaapiVideoPool
+ *
+ * Unregisters @pool from memory accounting. This shall be called
+ * before any object of the @pool is released. This is an internal
+ * function.
+ */
+void
+gst_vaapi_display_remove_video_pool (GstVaapiDisplay * display,
+    GstVaapiVideoPool * pool)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+  g_return_if_fail (pool != NULL);
+
+  priv = get_usage_display_private (display);
+  g_mutex_lock (&priv->memory_lock);
+  priv->video_pools = g_list_remove (priv->video_pools, pool);
+  g_mutex_unlock (&priv->memory_lock);
+}
+
+typedef struct
+{
+  GstVaapiVideoPool *pool;
+  gint64 last_used_time;
+} PoolUsage;
+
+static gint
+compare_pool_usage (gconstpointer a, gconstpointer b)
+{
+  const PoolUsage *const usage_a = a;
+  const PoolUsage *const usage_b = b;
+
+  if (usage_a->last_used_time < usage_b->last_used_time)
+    return -1;
+  return usage_a->last_used_time > usage_b->last_used_time;
+}
+
+/* Returns a new reference to the surface cache of the display that
+   owns the VA display, or NULL if it was not created yet */
+static GstVaapiSurfaceCache *
+get_surface_cache (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv;
+  GstVaapiSurfaceCache *cache = NULL;
+
+  if (display->priv.parent)
+    display = display->priv.parent;
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+
+  GST_VAAPI_DISPLAY_LOCK (display);
+  if (priv->surface_cache)
+    cache = gst_vaapi_surface_cache_ref (priv->surface_cache);
+  GST_VAAPI_DISPLAY_UNLOCK (display);
+  return cache;
+}
+
+/* Fills in the memory statistics. Called with the memory lock held */
+static void
+get_memory_stats_unlocked (GstVaapiDisplayPrivate * priv,
+    GstVaapiSurfaceCache * cache, GstVaapiDisplayMemoryStats * stats,
+    GArray * pools)
+{
+  PoolUsage usage;
+  gsize used_bytes, free_bytes;
+  GList *l;
+
+  memset (stats, 0, sizeof (*stats));
+  stats->budget = priv->memory_budget;
+  stats->trimmed_bytes = priv->trimmed_bytes;
+  stats->num_trims = priv->num_trims;
+  if (cache)
+    stats->cached_bytes = gst_vaapi_surface_cache_get_bytes (cache);
+
+  for (l = priv->video_pools; l != NULL; l = l->next) {
+    usage.pool = l->data;
+    gst_vaapi_video_pool_get_memory_usage (usage.pool, &used_bytes,
+        &free_bytes, &usage.last_used_time);
+    stats->used_bytes += used_bytes;
+    stats->idle_bytes += free_bytes;
+    stats->num_pools++;
+    if (pools && free_bytes > 0)
+      g_array_append_val (pools, usage);
+  }
+}
+
+static inline guint64
+get_total_bytes (const GstVaapiDisplayMemoryStats * stats)
+{
+  return stats->used_bytes + stats->idle_bytes + stats->cached_bytes;
+}
+
+/* Releases idle memory until the total usage is at most max_bytes.
+   Cached surfaces are released first, then the free objects of the
+   least recently used pools */
+static guint64
+trim_memory (GstVaapiDisplay * display, guint64 max_bytes)
+{
+  GstVaapiDisplayPrivate *const priv = get_usage_display_private (display);
+  GstVaapiDisplayMemoryStats stats;
+  GstVaapiSurfaceCache *cache;
+  GQueue objects = G_QUEUE_INIT;
+  GArray *pools;
+  guint64 total_bytes, bytes = 0;
+  gpointer object;
+  guint i;
+
+  cache = get_surface_cache (display);
+
+  g_mutex_lock (&priv->memory_lock);
+  get_memory_stats_unlocked (priv, cache, &stats, NULL);
+  g_mutex_unlock (&priv->memory_lock);
+
+  total_bytes = get_total_bytes (&stats);
+  if (total_bytes <= max_bytes) {
+    if (cache)
+      gst_vaapi_surface_cache_unref (cache);
+    return 0;
+  }
+
+  /* Cached surfaces are destroyed without the memory lock held, since
+     this requires the display lock */
+  if (cache)
+    bytes += gst_vaapi_surface_cache_trim (cache, total_bytes - max_bytes);
+
+  pools = g_array_new (FALSE, FALSE, sizeof (PoolUsage));
+
+  g_mutex_lock (&priv->memory_lock);
+  get_memory_stats_unlocked (priv, cache, &stats, pools);
+  total_bytes = get_total_bytes (&stats) + bytes;
+  if (total_bytes - bytes > max_bytes) {
+    g_array_sort (pools, compare_pool_usage);
+    for (i = 0; i < pools->len && total_bytes - bytes > max_bytes; i++) {
+      PoolUsage *const usage = &g_array_index (pools, PoolUsage, i);
+      bytes += gst_vaapi_video_pool_trim (usage->pool,
+          total_bytes - bytes - max_bytes, &objects);
+    }
+  }
+  if (bytes > 0) {
+    GST_DEBUG ("released %" G_GUINT64_FORMAT " bytes of idle video memory",
+        bytes);
+    priv->trimmed_bytes += bytes;
+    priv->num_trims++;
+  }
+  g_mutex_unlock (&priv->memory_lock);
+  g_array_free (pools, TRUE);
+  if (cache)
+    gst_vaapi_surface_cache_unref (cache);
+
+  /* Objects are destroyed without any lock held, since this could
+     require the display lock */
+  while ((object = g_queue_pop_head (&objects)) != NULL)
+    gst_vaapi_object_unref (object);
+  return bytes;
+}
+
+/**
+ * gst_vaapi_display_check_memory_budget:
+ * @display: a #GstVaapiDisplay
+ *
+ * Releases idle video memory if the memory budget of the @display is
+ * exceeded. This is an internal function, to be called after new
+ * video objects are allocated.
+ */
+void
+gst_vaapi_display_check_memory_budget (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = get_usage_display_private (display);
+  if (priv->memory_budget > 0)
+    trim_memory (display, priv->memory_budget);
+}
+
+/**
+ * gst_vaapi_display_set_memory_budget:
+ * @display: a #GstVaapiDisplay
+ * @max_bytes: the maximum amount of video memory, in bytes, or 0
+ *
+ * Sets the amount of video memory that the video pools of @display,
+ * and of any display sharing the same VA display, are expected to
+ * hold. Whenever the budget is exceeded, idle video objects are
+ * released, starting with the least recently used pools. Objects in
+ * use are never released, so the budget is a soft limit. A zero
+ * @max_bytes value means that the video memory is not bounded.
+ *
+ * The default budget can be set, in MiB, with the
+ * GST_VAAPI_MEMORY_BUDGET environment variable.
+ */
+void
+gst_vaapi_display_set_memory_budget (GstVaapiDisplay * display,
+    guint64 max_bytes)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = get_usage_display_private (display);
+  g_mutex_lock (&priv->memory_lock);
+  priv->memory_budget = max_bytes;
+  g_mutex_unlock (&priv->memory_lock);
+
+  if (max_bytes > 0)
+    trim_memory (display, max_bytes);
+}
+
+/**
+ * gst_vaapi_display_get_memory_budget:
+ * @display: a #GstVaapiDisplay
+ *
+ * Retrieves the video memory budget set with
+ * gst_vaapi_display_set_memory_budget().
+ *
+ * Return value: the maximum amount of video memory, in bytes, or 0 if
+ *   the video memory is not bounded
+ */
+guint64
+gst_vaapi_display_get_memory_budget (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv;
+  guint64 max_bytes;
+
+  g_return_val_if_fail (display != NULL, 0);
+
+  priv = get_usage_display_private (display);
+  g_mutex_lock (&priv->memory_lock);
+  max_bytes = priv->memory_budget;
+  g_mutex_unlock (&priv->memory_lock);
+  return max_bytes;
+}
+
+/**
+ * gst_vaapi_display_trim_memory:
+ * @display: a #GstVaapiDisplay
+ * @max_bytes: the target amount of video memory, in bytes
+ *
+ * Releases idle video memory until the video pools of @display hold
+ * at most @max_bytes, or until no idle objects are left. e.g. a
+ * @max_bytes value of 0 releases all idle video memory.
+ *
+ * Return value: the amount of video memory released, in bytes
+ */
+guint64
+gst_vaapi_display_trim_memory (GstVaapiDisplay * display, guint64 max_bytes)
+{
+  g_return_val_if_fail (display != NULL, 0);
+
+  return trim_memory (display, max_bytes);
+}
+
+/**
+ * gst_vaapi_display_get_memory_stats:
+ * @display: a #GstVaapiDisplay
+ * @stats: (out): return location for the #GstVaapiDisplayMemoryStats
+ *
+ * Retrieves statistics about the video memory held by the video pools
+ * of @display. Displays sharing the same VA display report the same
+ * statistics.
+ *
+ * This function is thread safe.
+ */
+void
+gst_vaapi_display_get_memory_stats (GstVaapiDisplay * display,
+    GstVaapiDisplayMemoryStats * stats)
+{
+  GstVaapiDisplayPrivate *priv;
+  GstVaapiSurfaceCache *cache;
+
+  g_return_if_fail (display != NULL);
+  g_return_if_fail (stats != NULL);
+
+  priv = get_usage_display_private (display);
+  cache = get_surface_cache (display);
+  g_mutex_lock (&priv->memory_lock);
+  get_memory_stats_unlocked (priv, cache, stats, NULL);
+  g_mutex_unlock (&priv->memory_lock);
+  if (cache)
+    gst_vaapi_surface_cache_unref (cache);
+}
+
+/**
+ * gst_vaapi_display_get_subpicture_stats:
+ * @display: a #GstVaapiDisplay
+ * @stats: (out): return location for the #GstVaapiDisplaySubpictureStats
+ *
+ * Retrieves statistics about the subpictures created from overlay
+ * rectangles on @display. Overlay rectangles with identical pixels
+ * share the same subpicture across all contexts and surfaces of the
+ * underlying VA display, so that only the first one is uploaded.
+ *
+ * This function is thread safe.
+ */
+void
+gst_vaapi_display_get_subpicture_stats (GstVaapiDisplay * display,
+    GstVaapiDisplaySubpictureStats * stats)
+{
+  GstVaapiSubpictureCache *cache;
+
+  g_return_if_fail (display != NULL);
+  g_return_if_fail (stats != NULL);
+
+  memset (stats, 0, sizeof (*stats));
+  cache = gst_vaapi_display_get_subpicture_cache (display);
+  if (!cache)
+    return;
+
+  stats->num_subpictures = gst_vaapi_subpicture_cache_get_size (cache);
+  gst_vaapi_subpicture_cache_get_stats (cache, &stats->num_hits,
+      &stats->num_misses, &stats->uploaded_bytes, &stats->saved_bytes);
+}
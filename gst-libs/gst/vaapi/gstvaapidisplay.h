@@ -37,6 +37,8 @@ G_BEGIN_DECLS
     ((GstVaapiDisplay *)(obj))
 
 typedef struct _GstVaapiDisplayInfo             GstVaapiDisplayInfo;
+typedef struct _GstVaapiDisplayMemoryStats      GstVaapiDisplayMemoryStats;
+typedef struct _GstVaapiDisplaySubpictureStats  GstVaapiDisplaySubpictureStats;
 typedef struct _GstVaapiDisplay                 GstVaapiDisplay;
 
 /**
@@ -80,6 +82,51 @@ struct _GstVaapiDisplayInfo
   gpointer native_display;
 };
 
+/**
+ * GstVaapiDisplayMemoryStats:
+ * @budget: the maximum amount of video memory, in bytes, or 0 if unlimited
+ * @used_bytes: the memory held by video pool objects currently in use
+ * @idle_bytes: the memory held by free objects of video pools
+ * @cached_bytes: the memory held by the decoded surfaces cache
+ * @trimmed_bytes: the total memory released to meet the budget
+ * @num_pools: the number of live video pools
+ * @num_trims: the number of times idle memory was released
+ *
+ * Statistics about the video memory allocated through the video pools
+ * of a VA display. Sizes are estimates of the pixels storage and do
+ * not account for driver specific padding.
+ */
+struct _GstVaapiDisplayMemoryStats
+{
+  guint64 budget;
+  guint64 used_bytes;
+  guint64 idle_bytes;
+  guint64 cached_bytes;
+  guint64 trimmed_bytes;
+  guint num_pools;
+  guint num_trims;
+};
+
+/**
+ * GstVaapiDisplaySubpictureStats:
+ * @num_subpictures: the number of live subpictures that could be shared
+ * @num_hits: the number of overlay rectangles that reused a subpicture
+ * @num_misses: the number of overlay rectangles that needed an upload
+ * @uploaded_bytes: the amount of pixels uploaded to new subpictures
+ * @saved_bytes: the amount of pixels that did not need to be uploaded
+ *
+ * Statistics about the sharing of subpictures created from overlay
+ * rectangles with identical pixels on a VA display.
+ */
+struct _GstVaapiDisplaySubpictureStats
+{
+  guint num_subpictures;
+  guint num_hits;
+  guint num_misses;
+  guint64 uploaded_bytes;
+  guint64 saved_bytes;
+};
+
 /**
  * GstVaapiDisplayProperties:
  * @GST_VAAPI_DISPLAY_PROP_RENDER_MODE: rendering mode (#GstVaapiRenderMode).
@@ -204,6 +251,28 @@ gst_vaapi_display_set_rotation (GstVaapiDisplay * display,
 const gchar *
 gst_vaapi_display_get_vendor_string (GstVaapiDisplay * display);
 
+void
+gst_vaapi_display_get_usage (GstVaapiDisplay * display, guint * num_contexts,
+    guint * num_surfaces);
+
+void
+gst_vaapi_display_set_memory_budget (GstVaapiDisplay * display,
+    guint64 max_bytes);
+
+guint64
+gst_vaapi_display_get_memory_budget (GstVaapiDisplay * display);
+
+guint64
+gst_vaapi_display_trim_memory (GstVaapiDisplay * display, guint64 max_bytes);
+
+void
+gst_vaapi_display_get_memory_stats (GstVaapiDisplay * display,
+    GstVaapiDisplayMemoryStats * stats);
+
+void
+gst_vaapi_display_get_subpicture_stats (GstVaapiDisplay * display,
+    GstVaapiDisplaySubpictureStats * stats);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DISPLAY_H */
@@ -27,6 +27,9 @@
 
 #include <gst/vaapi/gstvaapidisplay.h>
 #include <gst/vaapi/gstvaapidisplaycache.h>
+#include <gst/vaapi/gstvaapivideopool.h>
+#include "gstvaapisurfacecache.h"
+#include "gstvaapisubpicturecache.h"
 #include "gstvaapiminiobject.h"
 
 G_BEGIN_DECLS
@@ -142,6 +145,8 @@ struct _GstVaapiDisplayPrivate
 {
   GstVaapiDisplay *parent;
   GstVaapiDisplayCache *cache;
+  GstVaapiSurfaceCache *surface_cache;
+  GstVaapiSubpictureCache *subpicture_cache;
   GRecMutex mutex;
   GstVaapiDisplayType display_type;
   gchar *display_name;
@@ -161,6 +166,14 @@ struct _GstVaapiDisplayPrivate
   guint use_foreign_display:1;
   guint has_vpp:1;
   guint has_profiles:1;
+  guint has_caps_cache:1;
+  volatile gint num_contexts;
+  volatile gint num_surfaces;
+  GMutex memory_lock;
+  GList *video_pools;
+  guint64 memory_budget;
+  guint64 trimmed_bytes;
+  guint num_trims;
 };
 
 /**
@@ -227,6 +240,40 @@ GstVaapiDisplay *
 gst_vaapi_display_new (const GstVaapiDisplayClass * klass,
     GstVaapiDisplayInitType init_type, gpointer init_value);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_update_usage (GstVaapiDisplay * display, gint num_contexts,
+    gint num_surfaces);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_add_video_pool (GstVaapiDisplay * display,
+    GstVaapiVideoPool * pool);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_remove_video_pool (GstVaapiDisplay * display,
+    GstVaapiVideoPool * pool);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_check_memory_budget (GstVaapiDisplay * display);
+
+G_GNUC_INTERNAL
+GstVaapiID
+gst_vaapi_display_get_cached_surface (GstVaapiDisplay * display,
+    GstVaapiChromaType chroma_type, guint width, guint height);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_display_put_cached_surface (GstVaapiDisplay * display,
+    GstVaapiID surface_id, GstVaapiChromaType chroma_type, guint width,
+    guint height);
+
+G_GNUC_INTERNAL
+GstVaapiSubpictureCache *
+gst_vaapi_display_get_subpicture_cache (GstVaapiDisplay * display);
+
 static inline guint
 gst_vaapi_display_get_display_types (GstVaapiDisplay * display)
 {
@@ -32,12 +32,22 @@ typedef struct _CacheEntry CacheEntry;
 struct _CacheEntry
 {
   GstVaapiDisplayInfo info;
+  GList link;
 };
 
+/* Entries are indexed by GstVaapiDisplay, VA display, native display
+ * and display name. Since several entries could share the same VA
+ * display, native display or name, e.g. with different display types,
+ * the latter maps hold a GQueue of entries, most recent first */
 struct _GstVaapiDisplayCache
 {
   GstVaapiMiniObject parent_instance;
-  GList *list;
+  GRWLock lock;
+  GQueue entries;
+  GHashTable *display_map;
+  GHashTable *va_display_map;
+  GHashTable *native_display_map;
+  GHashTable *name_map;
 };
 
 static void
@@ -63,10 +73,12 @@ cache_entry_new (const GstVaapiDisplayInfo * di)
   GstVaapiDisplayInfo *info;
   CacheEntry *entry;
 
-  entry = g_slice_new (CacheEntry);
+  entry = g_slice_new0 (CacheEntry);
   if (!entry)
     return NULL;
 
+  entry->link.data = entry;
+
   info = &entry->info;
   info->display = di->display;
   info->va_display = di->va_display;
@@ -97,80 +109,121 @@ is_compatible_display_type (const GstVaapiDisplayType display_type,
   return ((1U << display_type) & display_types) != 0;
 }
 
-static GList *
-cache_lookup_1 (GstVaapiDisplayCache * cache, GCompareFunc func,
-    gconstpointer data, guint display_types)
+/* Display names can be NULL, so they need dedicated hash functions */
+static guint
+display_name_hash (gconstpointer key)
 {
-  GList *l;
-
-  for (l = cache->list; l != NULL; l = l->next) {
-    GstVaapiDisplayInfo *const info = &((CacheEntry *) l->data)->info;
-    if (!is_compatible_display_type (info->display_type, display_types))
-      continue;
-    if (func (info, data))
-      break;
-  }
-  return l;
+  return key ? g_str_hash (key) : 0;
 }
 
-static inline const GstVaapiDisplayInfo *
-cache_lookup (GstVaapiDisplayCache * cache, GCompareFunc func,
-    gconstpointer data, guint display_types)
+static gboolean
+display_name_equal (gconstpointer a, gconstpointer b)
 {
-  GList *const m = cache_lookup_1 (cache, func, data, display_types);
-
-  return m ? &((CacheEntry *) m->data)->info : NULL;
+  if (!a || !b)
+    return a == b;
+  return strcmp (a, b) == 0;
 }
 
-static gint
-compare_display (gconstpointer a, gconstpointer display)
+static void
+cache_map_add (GHashTable * map, gpointer key, GBoxedCopyFunc copy_key,
+    CacheEntry * entry)
 {
-  const GstVaapiDisplayInfo *const info = a;
+  GQueue *entries;
 
-  return info->display == display;
+  entries = g_hash_table_lookup (map, key);
+  if (!entries) {
+    entries = g_queue_new ();
+    g_hash_table_insert (map, copy_key ? copy_key (key) : key, entries);
+  }
+  g_queue_push_head (entries, entry);
 }
 
-static gint
-compare_va_display (gconstpointer a, gconstpointer va_display)
+static void
+cache_map_remove (GHashTable * map, gconstpointer key, CacheEntry * entry)
 {
-  const GstVaapiDisplayInfo *const info = a;
+  GQueue *const entries = g_hash_table_lookup (map, key);
+
+  if (!entries)
+    return;
 
-  return info->va_display == va_display;
+  g_queue_remove (entries, entry);
+  if (g_queue_is_empty (entries))
+    g_hash_table_remove (map, key);
 }
 
-static gint
-compare_native_display (gconstpointer a, gconstpointer native_display)
+static const GstVaapiDisplayInfo *
+cache_map_lookup (GstVaapiDisplayCache * cache, GHashTable * map,
+    gconstpointer key, guint display_types)
 {
-  const GstVaapiDisplayInfo *const info = a;
+  const GstVaapiDisplayInfo *info = NULL;
+  GQueue *entries;
+  GList *l;
 
-  return info->native_display == native_display;
+  g_rw_lock_reader_lock (&cache->lock);
+  entries = g_hash_table_lookup (map, key);
+  if (entries) {
+    for (l = entries->head; l != NULL; l = l->next) {
+      CacheEntry *const entry = l->data;
+      if (is_compatible_display_type (entry->info.display_type,
+              display_types)) {
+        info = &entry->info;
+        break;
+      }
+    }
+  }
+  g_rw_lock_reader_unlock (&cache->lock);
+  return info;
 }
 
-static gint
-compare_display_name (gconstpointer a, gconstpointer b)
+static const GstVaapiDisplayInfo *
+cache_lookup (GstVaapiDisplayCache * cache, GCompareFunc func,
+    gconstpointer data, guint display_types)
 {
-  const GstVaapiDisplayInfo *const info = a;
-  const gchar *const display_name = b;
+  const GstVaapiDisplayInfo *info = NULL;
+  GList *l;
 
-  if (info->display_name == NULL && display_name == NULL)
-    return TRUE;
-  if (!info->display_name || !display_name)
-    return FALSE;
-  return strcmp (info->display_name, display_name) == 0;
+  g_rw_lock_reader_lock (&cache->lock);
+  for (l = cache->entries.head; l != NULL; l = l->next) {
+    CacheEntry *const entry = l->data;
+    if (!is_compatible_display_type (entry->info.display_type, display_types))
+      continue;
+    if (func (&entry->info, data)) {
+      info = &entry->info;
+      break;
+    }
+  }
+  g_rw_lock_reader_unlock (&cache->lock);
+  return info;
 }
 
 static void
 gst_vaapi_display_cache_finalize (GstVaapiDisplayCache * cache)
 {
-  GList *l;
-
-  if (!cache->list)
-    return;
+  GList *l, *next;
 
-  for (l = cache->list; l != NULL; l = l->next)
+  for (l = cache->entries.head; l != NULL; l = next) {
+    next = l->next;
     cache_entry_free (l->data);
-  g_list_free (cache->list);
-  cache->list = NULL;
+  }
+  g_queue_init (&cache->entries);
+
+  if (cache->display_map) {
+    g_hash_table_destroy (cache->display_map);
+    cache->display_map = NULL;
+  }
+  if (cache->va_display_map) {
+    g_hash_table_destroy (cache->va_display_map);
+    cache->va_display_map = NULL;
+  }
+  if (cache->native_display_map) {
+    g_hash_table_destroy (cache->native_display_map);
+    cache->native_display_map = NULL;
+  }
+  if (cache->name_map) {
+    g_hash_table_destroy (cache->name_map);
+    cache->name_map = NULL;
+  }
+  g_rw_lock_clear (&cache->lock);
 }
 
 static const GstVaapiMiniObjectClass *
@@ -193,8 +246,23 @@ gst_vaapi_display_cache_class (void)
 GstVaapiDisplayCache *
 gst_vaapi_display_cache_new (void)
 {
-  return (GstVaapiDisplayCache *)
+  GstVaapiDisplayCache *cache;
+
+  cache = (GstVaapiDisplayCache *)
       gst_vaapi_mini_object_new0 (gst_vaapi_display_cache_class ());
+  if (!cache)
+    return NULL;
+
+  g_rw_lock_init (&cache->lock);
+  g_queue_init (&cache->entries);
+  cache->display_map = g_hash_table_new (g_direct_hash, g_direct_equal);
+  cache->va_display_map = g_hash_table_new_full (g_direct_hash,
+      g_direct_equal, NULL, (GDestroyNotify) g_queue_free);
+  cache->native_display_map = g_hash_table_new_full (g_direct_hash,
+      g_direct_equal, NULL, (GDestroyNotify) g_queue_free);
+  cache->name_map = g_hash_table_new_full (display_name_hash,
+      display_name_equal, g_free, (GDestroyNotify) g_queue_free);
+  return cache;
 }
 
 /**
@@ -208,9 +276,14 @@ gst_vaapi_display_cache_new (void)
 gboolean
 gst_vaapi_display_cache_is_empty (GstVaapiDisplayCache * cache)
 {
+  gboolean is_empty;
+
   g_return_val_if_fail (cache != NULL, 0);
 
-  return cache->list == NULL;
+  g_rw_lock_reader_lock (&cache->lock);
+  is_empty = g_queue_is_empty (&cache->entries);
+  g_rw_lock_reader_unlock (&cache->lock);
+  return is_empty;
 }
 
 /**
@@ -236,7 +309,15 @@ gst_vaapi_display_cache_add (GstVaapiDisplayCache * cache,
   if (!entry)
     return FALSE;
 
-  cache->list = g_list_prepend (cache->list, entry);
+  g_rw_lock_writer_lock (&cache->lock);
+  g_queue_push_head_link (&cache->entries, &entry->link);
+  g_hash_table_insert (cache->display_map, info->display, entry);
+  cache_map_add (cache->va_display_map, entry->info.va_display, NULL, entry);
+  cache_map_add (cache->native_display_map, entry->info.native_display, NULL,
+      entry);
+  cache_map_add (cache->name_map, entry->info.display_name,
+      (GBoxedCopyFunc) g_strdup, entry);
+  g_rw_lock_writer_unlock (&cache->lock);
   return TRUE;
 }
 
@@ -251,15 +332,20 @@ void
 gst_vaapi_display_cache_remove (GstVaapiDisplayCache * cache,
     GstVaapiDisplay * display)
 {
-  GList *m;
-
-  m = cache_lookup_1 (cache, compare_display, display,
-      GST_VAAPI_DISPLAY_TYPE_ANY);
-  if (!m)
-    return;
+  CacheEntry *entry;
 
-  cache_entry_free (m->data);
-  cache->list = g_list_delete_link (cache->list, m);
+  g_rw_lock_writer_lock (&cache->lock);
+  entry = g_hash_table_lookup (cache->display_map, display);
+  if (entry) {
+    g_hash_table_remove (cache->display_map, display);
+    cache_map_remove (cache->va_display_map, entry->info.va_display, entry);
+    cache_map_remove (cache->native_display_map, entry->info.native_display,
+        entry);
+    cache_map_remove (cache->name_map, entry->info.display_name, entry);
+    g_queue_unlink (&cache->entries, &entry->link);
+  }
+  g_rw_lock_writer_unlock (&cache->lock);
+  cache_entry_free (entry);
 }
 
 /**
@@ -276,11 +362,15 @@ const GstVaapiDisplayInfo *
 gst_vaapi_display_cache_lookup (GstVaapiDisplayCache * cache,
     GstVaapiDisplay * display)
 {
+  CacheEntry *entry;
+
   g_return_val_if_fail (cache != NULL, NULL);
   g_return_val_if_fail (display != NULL, NULL);
 
-  return cache_lookup (cache, compare_display, display,
-      GST_VAAPI_DISPLAY_TYPE_ANY);
+  g_rw_lock_reader_lock (&cache->lock);
+  entry = g_hash_table_lookup (cache->display_map, display);
+  g_rw_lock_reader_unlock (&cache->lock);
+  return entry ? &entry->info : NULL;
 }
 
 /**
@@ -329,7 +419,7 @@ gst_vaapi_display_cache_lookup_by_va_display (GstVaapiDisplayCache * cache,
   g_return_val_if_fail (cache != NULL, NULL);
   g_return_val_if_fail (va_display != NULL, NULL);
 
-  return cache_lookup (cache, compare_va_display, va_display,
+  return cache_map_lookup (cache, cache->va_display_map, va_display,
       GST_VAAPI_DISPLAY_TYPE_ANY);
 }
 
@@ -350,7 +440,7 @@ gst_vaapi_display_cache_lookup_by_native_display (GstVaapiDisplayCache * cache,
   g_return_val_if_fail (cache != NULL, NULL);
   g_return_val_if_fail (native_display != NULL, NULL);
 
-  return cache_lookup (cache, compare_native_display, native_display,
+  return cache_map_lookup (cache, cache->native_display_map, native_display,
       display_types);
 }
 
@@ -370,6 +460,6 @@ gst_vaapi_display_cache_lookup_by_name (GstVaapiDisplayCache * cache,
 {
   g_return_val_if_fail (cache != NULL, NULL);
 
-  return cache_lookup (cache, compare_display_name, display_name,
+  return cache_map_lookup (cache, cache->name_map, display_name,
       display_types);
 }
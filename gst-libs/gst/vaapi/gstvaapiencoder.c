@@ -34,6 +34,9 @@
 #define DEBUG 1
 #include "gstvaapidebug.h"
 
+/* Number of coded buffers that can be in flight */
+#define CODEDBUF_POOL_CAPACITY 5
+
 /* Helper function to create a new encoder property object */
 static GstVaapiEncoderPropData *
 prop_new (gint id, GParamSpec * pspec)
@@ -142,7 +145,9 @@ gst_vaapi_encoder_properties_get_default (const GstVaapiEncoderClass * klass)
       g_param_spec_uint ("bitrate",
           "Bitrate (kbps)",
           "The desired bitrate expressed in kbps (0: auto-calculate)",
-          0, 100 * 1024, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          0, 100 * 1024, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   /**
    * GstVaapiEncoder:keyframe-period:
@@ -154,7 +159,8 @@ gst_vaapi_encoder_properties_get_default (const GstVaapiEncoderClass * klass)
       g_param_spec_uint ("keyframe-period",
           "Keyframe Period",
           "Maximal distance between two keyframes (0: auto-calculate)", 1, 300,
-          30, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          30, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   /**
    * GstVaapiEncoder:tune:
@@ -285,6 +291,17 @@ gst_vaapi_encoder_create_surface (GstVaapiEncoder * encoder)
   return proxy;
 }
 
+/* Determines the default keyframe period, if none was supplied */
+static void
+ensure_keyframe_period (GstVaapiEncoder * encoder)
+{
+  GstVideoInfo *const vip = GST_VAAPI_ENCODER_VIDEO_INFO (encoder);
+
+  /* Generate a keyframe every second */
+  if (!encoder->keyframe_period)
+    encoder->keyframe_period = (vip->fps_n + vip->fps_d - 1) / vip->fps_d;
+}
+
 /**
  * gst_vaapi_encoder_put_frame:
  * @encoder: a #GstVaapiEncoder
@@ -304,6 +321,16 @@ gst_vaapi_encoder_put_frame (GstVaapiEncoder * encoder,
   GstVaapiEncPicture *picture;
   GstVaapiCodedBufferProxy *codedbuf_proxy;
 
+  /* Apply the parameters changed while encoding, e.g. the bitrate, to
+     the next frames. This neither resets the VA context nor the pools */
+  if (encoder->params_changed && klass->update_parameters) {
+    encoder->params_changed = FALSE;
+    ensure_keyframe_period (encoder);
+    status = klass->update_parameters (encoder);
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      goto error_update_parameters;
+  }
+
   for (;;) {
     picture = NULL;
     status = klass->reordering (encoder, frame, &picture);
@@ -331,6 +358,11 @@ gst_vaapi_encoder_put_frame (GstVaapiEncoder * encoder,
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
 
   /* ERRORS */
+error_update_parameters:
+  {
+    GST_ERROR ("failed to update encoding parameters");
+    return status;
+  }
 error_reorder_frame:
   {
     GST_ERROR ("failed to process reordered frames");
@@ -446,6 +478,29 @@ gst_vaapi_encoder_get_codec_data (GstVaapiEncoder * encoder,
   return ret;
 }
 
+/**
+ * gst_vaapi_encoder_get_max_input_frames:
+ * @encoder: a #GstVaapiEncoder
+ *
+ * Returns the maximum number of input frames that @encoder could hold
+ * at any time, i.e. the frames waiting to be reordered and the frames
+ * submitted for encoding that were not output yet. An upstream
+ * element providing VA surfaces shall have at least that many of them
+ * available so that encoding is never stalled.
+ *
+ * Note: this function shall only be called after the codec state was
+ * submitted through gst_vaapi_encoder_set_codec_state().
+ *
+ * Return value: the maximum number of input frames
+ */
+guint
+gst_vaapi_encoder_get_max_input_frames (GstVaapiEncoder * encoder)
+{
+  g_return_val_if_fail (encoder != NULL, 0);
+
+  return encoder->num_reorder_frames + CODEDBUF_POOL_CAPACITY + 1;
+}
+
 /* Checks video info */
 static GstVaapiEncoderStatus
 check_video_info (GstVaapiEncoder * encoder, const GstVideoInfo * vip)
@@ -505,6 +560,16 @@ get_profile (GstVaapiEncoder * encoder)
   return encoder->profile;
 }
 
+/* Gets the entrypoint for the supplied profile: still image codecs
+   are encoded one picture at a time, other codecs slice by slice */
+static GstVaapiEntrypoint
+get_entrypoint (GstVaapiProfile profile)
+{
+  if (gst_vaapi_profile_get_codec (profile) == GST_VAAPI_CODEC_JPEG)
+    return GST_VAAPI_ENTRYPOINT_PICTURE_ENCODE;
+  return GST_VAAPI_ENTRYPOINT_SLICE_ENCODE;
+}
+
 /* Gets config attribute for the supplied profile */
 static gboolean
 get_config_attribute (GstVaapiEncoder * encoder, VAConfigAttribType type,
@@ -512,14 +577,17 @@ get_config_attribute (GstVaapiEncoder * encoder, VAConfigAttribType type,
 {
   GstVaapiProfile profile;
   VAProfile va_profile;
+  VAEntrypoint va_entrypoint;
 
   profile = get_profile (encoder);
   if (!profile)
     return FALSE;
 
   va_profile = gst_vaapi_profile_get_va_profile (profile);
+  va_entrypoint =
+      gst_vaapi_entrypoint_get_va_entrypoint (get_entrypoint (profile));
   return gst_vaapi_get_config_attribute (encoder->display, va_profile,
-      VAEntrypointEncSlice, type, out_value_ptr);
+      va_entrypoint, type, out_value_ptr);
 }
 
 /* Determines the set of supported packed headers */
@@ -553,7 +621,7 @@ set_context_info (GstVaapiEncoder * encoder)
 
   cip->usage = GST_VAAPI_CONTEXT_USAGE_ENCODE;
   cip->profile = encoder->profile;
-  cip->entrypoint = GST_VAAPI_ENTRYPOINT_SLICE_ENCODE;
+  cip->entrypoint = get_entrypoint (encoder->profile);
   cip->chroma_type = gst_vaapi_video_format_get_chroma_type (format);
   cip->width = GST_VAAPI_ENCODER_WIDTH (encoder);
   cip->height = GST_VAAPI_ENCODER_HEIGHT (encoder);
@@ -602,18 +670,16 @@ static GstVaapiEncoderStatus
 gst_vaapi_encoder_reconfigure_internal (GstVaapiEncoder * encoder)
 {
   GstVaapiEncoderClass *const klass = GST_VAAPI_ENCODER_GET_CLASS (encoder);
-  GstVideoInfo *const vip = GST_VAAPI_ENCODER_VIDEO_INFO (encoder);
   GstVaapiEncoderStatus status;
   GstVaapiVideoPool *pool;
   guint codedbuf_size;
 
-  /* Generate a keyframe every second */
-  if (!encoder->keyframe_period)
-    encoder->keyframe_period = (vip->fps_n + vip->fps_d - 1) / vip->fps_d;
+  ensure_keyframe_period (encoder);
 
   status = klass->reconfigure (encoder);
   if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
     return status;
+  encoder->params_changed = FALSE;
 
   if (!gst_vaapi_encoder_ensure_context (encoder))
     goto error_reset_context;
@@ -625,7 +691,7 @@ gst_vaapi_encoder_reconfigure_internal (GstVaapiEncoder * encoder)
     pool = gst_vaapi_coded_buffer_pool_new (encoder, encoder->codedbuf_size);
     if (!pool)
       goto error_alloc_codedbuf_pool;
-    gst_vaapi_video_pool_set_capacity (pool, 5);
+    gst_vaapi_video_pool_set_capacity (pool, CODEDBUF_POOL_CAPACITY);
     gst_vaapi_video_pool_replace (&encoder->codedbuf_pool, pool);
     gst_vaapi_video_pool_unref (pool);
   }
@@ -644,6 +710,46 @@ error_reset_context:
   }
 }
 
+/* Checks whether parameters can be changed while encoding */
+static inline gboolean
+can_update_parameters (GstVaapiEncoder * encoder)
+{
+  return GST_VAAPI_ENCODER_GET_CLASS (encoder)->update_parameters != NULL;
+}
+
+/* Updates the framerate while encoding, other changes are not allowed */
+static GstVaapiEncoderStatus
+set_framerate (GstVaapiEncoder * encoder, const GstVideoInfo * vip)
+{
+  GstVideoInfo info = *vip;
+
+  GST_VIDEO_INFO_FPS_N (&info) = GST_VAAPI_ENCODER_FPS_N (encoder);
+  GST_VIDEO_INFO_FPS_D (&info) = GST_VAAPI_ENCODER_FPS_D (encoder);
+  if (!gst_video_info_is_equal (&info, &encoder->video_info))
+    goto error_operation_failed;
+
+  if (GST_VIDEO_INFO_FPS_N (vip) == GST_VAAPI_ENCODER_FPS_N (encoder) &&
+      GST_VIDEO_INFO_FPS_D (vip) == GST_VAAPI_ENCODER_FPS_D (encoder))
+    return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+  if (!can_update_parameters (encoder))
+    goto error_operation_failed;
+  if (!vip->fps_n || !vip->fps_d)
+    return check_video_info (encoder, vip);
+
+  GST_VAAPI_ENCODER_FPS_N (encoder) = GST_VIDEO_INFO_FPS_N (vip);
+  GST_VAAPI_ENCODER_FPS_D (encoder) = GST_VIDEO_INFO_FPS_D (vip);
+  encoder->params_changed = TRUE;
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+  /* ERRORS */
+error_operation_failed:
+  {
+    GST_ERROR ("could not change codec state after encoding started");
+    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  }
+}
+
 /**
  * gst_vaapi_encoder_set_codec_state:
  * @encoder: a #GstVaapiEncoder
@@ -658,6 +764,10 @@ error_reset_context:
  * match the new properties and any other change beyond this point has
  * zero effect.
  *
+ * Once encoding started, only the framerate can be changed, provided
+ * the encoder supports parameter updates. The new framerate then
+ * applies to the next frames, without resetting the encoder.
+ *
  * Return value: a #GstVaapiEncoderStatus
  */
 GstVaapiEncoderStatus
@@ -672,7 +782,7 @@ gst_vaapi_encoder_set_codec_state (GstVaapiEncoder * encoder,
       GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER);
 
   if (encoder->num_codedbuf_queued > 0)
-    goto error_operation_failed;
+    return set_framerate (encoder, &state->info);
 
   if (!gst_video_info_is_equal (&state->info, &encoder->video_info)) {
     status = check_video_info (encoder, &state->info);
@@ -681,13 +791,6 @@ gst_vaapi_encoder_set_codec_state (GstVaapiEncoder * encoder,
     encoder->video_info = state->info;
   }
   return gst_vaapi_encoder_reconfigure_internal (encoder);
-
-  /* ERRORS */
-error_operation_failed:
-  {
-    GST_ERROR ("could not change codec state after encoding started");
-    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
-  }
 }
 
 /**
@@ -715,9 +818,15 @@ set_property (GstVaapiEncoder * encoder, gint prop_id, const GValue * value)
     GstVaapiEncoderClass *const klass = GST_VAAPI_ENCODER_GET_CLASS (encoder);
 
     if (klass->set_property) {
-      if (encoder->num_codedbuf_queued > 0)
-        goto error_operation_failed;
+      if (encoder->num_codedbuf_queued > 0) {
+        GParamSpec *const pspec = prop_find_pspec (encoder, prop_id);
+        if (!pspec || !(pspec->flags & GST_PARAM_MUTABLE_PLAYING) ||
+            !can_update_parameters (encoder))
+          goto error_operation_failed;
+      }
       status = klass->set_property (encoder, prop_id, value);
+      if (status == GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        encoder->params_changed = TRUE;
     }
     return status;
   }
@@ -801,6 +910,9 @@ get_rate_control_mask (GstVaapiEncoder * encoder)
         continue;
       rate_control_mask |= 1 << to_GstVaapiRateControl (1 << i);
     }
+  } else {
+    /* No rate control attribute, e.g. JPEG: quality is set per picture */
+    rate_control_mask = 1 << GST_VAAPI_RATECONTROL_NONE;
   }
   GST_INFO ("supported rate controls: 0x%08x", rate_control_mask);
 
@@ -866,10 +978,12 @@ error_unsupported_rate_control:
  *
  * Notifies the @encoder to use the supplied @bitrate value.
  *
- * Note: currently, the bitrate can only be specified before the first
- * frame is encoded. Afterwards, any change to this parameter is
- * invalid and @GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED is
- * returned.
+ * The bitrate can be changed while encoding, if the encoder supports
+ * parameter updates. The new value then applies to the next frame
+ * submitted through gst_vaapi_encoder_put_frame(), without resetting
+ * the encoder. Otherwise, any change to this parameter after the first
+ * frame is encoded is invalid and
+ * @GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED is returned.
  *
  * Return value: a #GstVaapiEncoderStatus
  */
@@ -878,8 +992,11 @@ gst_vaapi_encoder_set_bitrate (GstVaapiEncoder * encoder, guint bitrate)
 {
   g_return_val_if_fail (encoder != NULL, 0);
 
-  if (encoder->bitrate != bitrate && encoder->num_codedbuf_queued > 0)
-    goto error_operation_failed;
+  if (encoder->bitrate != bitrate) {
+    if (encoder->num_codedbuf_queued > 0 && !can_update_parameters (encoder))
+      goto error_operation_failed;
+    encoder->params_changed = TRUE;
+  }
 
   encoder->bitrate = bitrate;
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
@@ -899,11 +1016,14 @@ error_operation_failed:
  *
  * Notifies the @encoder to use the supplied @keyframe_period value.
  *
- * Note: currently, the keyframe period can only be specified before
- * the last call to gst_vaapi_encoder_set_codec_state(), which shall
- * occur before the first frame is encoded. Afterwards, any change to
- * this parameter causes gst_vaapi_encoder_set_keyframe_period() to
- * return @GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED.
+ * The keyframe period can be changed while encoding, if the encoder
+ * supports parameter updates. The new value then applies to the next
+ * frame submitted through gst_vaapi_encoder_put_frame(). Otherwise,
+ * the keyframe period can only be specified before the last call to
+ * gst_vaapi_encoder_set_codec_state(), which shall occur before the
+ * first frame is encoded. Afterwards, any change to this parameter
+ * causes gst_vaapi_encoder_set_keyframe_period() to return
+ * @GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED.
  *
  * Return value: a #GstVaapiEncoderStatus
  */
@@ -913,9 +1033,11 @@ gst_vaapi_encoder_set_keyframe_period (GstVaapiEncoder * encoder,
 {
   g_return_val_if_fail (encoder != NULL, 0);
 
-  if (encoder->keyframe_period != keyframe_period
-      && encoder->num_codedbuf_queued > 0)
-    goto error_operation_failed;
+  if (encoder->keyframe_period != keyframe_period) {
+    if (encoder->num_codedbuf_queued > 0 && !can_update_parameters (encoder))
+      goto error_operation_failed;
+    encoder->params_changed = TRUE;
+  }
 
   encoder->keyframe_period = keyframe_period;
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
@@ -143,6 +143,9 @@ GstVaapiEncoderStatus
 gst_vaapi_encoder_set_codec_state (GstVaapiEncoder * encoder,
     GstVideoCodecState * state);
 
+guint
+gst_vaapi_encoder_get_max_input_frames (GstVaapiEncoder * encoder);
+
 GstVaapiEncoderStatus
 gst_vaapi_encoder_set_property (GstVaapiEncoder * encoder, gint prop_id,
     const GValue * value);
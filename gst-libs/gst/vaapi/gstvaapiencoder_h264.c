@@ -191,55 +191,20 @@ h264_get_cpb_nal_factor (GstVaapiProfile profile)
     }                                                           \
   } while (0)
 
-#define WRITE_UE(bs, val) do {                  \
-    if (!bs_write_ue (bs, val)) {               \
-      GST_WARNING ("failed to write ue(v)");    \
-      goto bs_error;                            \
-    }                                           \
+#define WRITE_UE(bs, val) do {                          \
+    if (!gst_vaapi_utils_h264_write_ue (bs, val)) {     \
+      GST_WARNING ("failed to write ue(v)");            \
+      goto bs_error;                                    \
+    }                                                   \
   } while (0)
 
-#define WRITE_SE(bs, val) do {                  \
-    if (!bs_write_se (bs, val)) {               \
-      GST_WARNING ("failed to write se(v)");    \
-      goto bs_error;                            \
-    }                                           \
+#define WRITE_SE(bs, val) do {                          \
+    if (!gst_vaapi_utils_h264_write_se (bs, val)) {     \
+      GST_WARNING ("failed to write se(v)");            \
+      goto bs_error;                                    \
+    }                                                   \
   } while (0)
 
-/* Write an unsigned integer Exp-Golomb-coded syntax element. i.e. ue(v) */
-static gboolean
-bs_write_ue (GstBitWriter * bs, guint32 value)
-{
-  guint32 size_in_bits = 0;
-  guint32 tmp_value = ++value;
-
-  while (tmp_value) {
-    ++size_in_bits;
-    tmp_value >>= 1;
-  }
-  if (size_in_bits > 1
-      && !gst_bit_writer_put_bits_uint32 (bs, 0, size_in_bits - 1))
-    return FALSE;
-  if (!gst_bit_writer_put_bits_uint32 (bs, value, size_in_bits))
-    return FALSE;
-  return TRUE;
-}
-
-/* Write a signed integer Exp-Golomb-coded syntax element. i.e. se(v) */
-static gboolean
-bs_write_se (GstBitWriter * bs, gint32 value)
-{
-  guint32 new_val;
-
-  if (value <= 0)
-    new_val = -(value << 1);
-  else
-    new_val = (value << 1) - 1;
-
-  if (!bs_write_ue (bs, new_val))
-    return FALSE;
-  return TRUE;
-}
-
 /* Write the NAL unit header */
 static gboolean
 bs_write_nal_header (GstBitWriter * bs, guint32 nal_ref_idc,
@@ -738,6 +703,7 @@ struct _GstVaapiEncoderH264
   gboolean use_cabac;
   gboolean use_dct8x8;
   GstClockTime cts_offset;
+  GstClockTime next_cts_offset;
   gboolean config_changed;
 
   /* frame, poc */
@@ -753,6 +719,10 @@ struct _GstVaapiEncoderH264
   GstBuffer *subset_sps_data;
   GstBuffer *pps_data;
 
+  /* serialized packed headers (SPS or subset SPS, PPS), per view */
+  GstBuffer *packed_seq_hdr[MAX_NUM_VIEWS];
+  GstBuffer *packed_pic_hdr[MAX_NUM_VIEWS];
+
   guint bitrate_bits;           // bitrate (bits)
   guint cpb_length;             // length of CPB buffer (ms)
   guint cpb_length_bits;        // length of CPB buffer (bits)
@@ -1231,21 +1201,70 @@ fill_hrd_params (GstVaapiEncoderH264 * encoder, VAEncMiscParameterHRD * hrd)
   }
 }
 
-/* Adds the supplied sequence header (SPS) to the list of packed
-   headers to pass down as-is to the encoder */
+/* Returns a new buffer holding the byte-aligned bitstream */
+static GstBuffer *
+bs_to_buffer (GstBitWriter * bs)
+{
+  const guint size = GST_BIT_WRITER_BIT_SIZE (bs) / 8;
+  GstBuffer *buf;
+
+  g_assert (GST_BIT_WRITER_BIT_SIZE (bs) % 8 == 0);
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  if (buf && gst_buffer_fill (buf, 0, GST_BIT_WRITER_DATA (bs), size) != size)
+    gst_buffer_replace (&buf, NULL);
+  return buf;
+}
+
+/* Adds the supplied serialized packed header to the picture */
 static gboolean
-add_packed_sequence_header (GstVaapiEncoderH264 * encoder,
-    GstVaapiEncPicture * picture, GstVaapiEncSequence * sequence)
+add_packed_header_from_buffer (GstVaapiEncoderH264 * encoder,
+    GstVaapiEncPicture * picture, VAEncPackedHeaderType type, GstBuffer * buf)
+{
+  GstVaapiEncPackedHeader *packed_hdr;
+  VAEncPackedHeaderParameterBuffer packed_hdr_param = { 0 };
+  GstMapInfo info;
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_READ))
+    return FALSE;
+
+  packed_hdr_param.type = type;
+  packed_hdr_param.bit_length = info.size * 8;
+  packed_hdr_param.has_emulation_bytes = 0;
+
+  packed_hdr = gst_vaapi_enc_packed_header_new (GST_VAAPI_ENCODER (encoder),
+      &packed_hdr_param, sizeof (packed_hdr_param), info.data, info.size);
+  gst_buffer_unmap (buf, &info);
+  if (!packed_hdr)
+    return FALSE;
+
+  gst_vaapi_enc_picture_add_packed_header (picture, packed_hdr);
+  gst_vaapi_codec_object_replace (&packed_hdr, NULL);
+  return TRUE;
+}
+
+/* Drops the serialized SPS/PPS headers, they need to be regenerated */
+static void
+reset_packed_headers (GstVaapiEncoderH264 * encoder)
+{
+  guint i;
+
+  for (i = 0; i < MAX_NUM_VIEWS; i++) {
+    gst_buffer_replace (&encoder->packed_seq_hdr[i], NULL);
+    gst_buffer_replace (&encoder->packed_pic_hdr[i], NULL);
+  }
+}
+
+/* Generates the sequence header (SPS) bitstream */
+static GstBuffer *
+create_packed_sequence_header (GstVaapiEncoderH264 * encoder,
+    GstVaapiEncSequence * sequence)
 {
-  GstVaapiEncPackedHeader *packed_seq;
   GstBitWriter bs;
-  VAEncPackedHeaderParameterBuffer packed_seq_param = { 0 };
   const VAEncSequenceParameterBufferH264 *const seq_param = sequence->param;
   GstVaapiProfile profile = encoder->profile;
-
   VAEncMiscParameterHRD hrd_params;
-  guint32 data_bit_size;
-  guint8 *data;
+  GstBuffer *buf;
 
   fill_hrd_params (encoder, &hrd_params);
 
@@ -1262,47 +1281,28 @@ add_packed_sequence_header (GstVaapiEncoderH264 * encoder,
 
   bs_write_sps (&bs, seq_param, profile, &hrd_params);
 
-  g_assert (GST_BIT_WRITER_BIT_SIZE (&bs) % 8 == 0);
-  data_bit_size = GST_BIT_WRITER_BIT_SIZE (&bs);
-  data = GST_BIT_WRITER_DATA (&bs);
-
-  packed_seq_param.type = VAEncPackedHeaderSequence;
-  packed_seq_param.bit_length = data_bit_size;
-  packed_seq_param.has_emulation_bytes = 0;
-
-  packed_seq = gst_vaapi_enc_packed_header_new (GST_VAAPI_ENCODER (encoder),
-      &packed_seq_param, sizeof (packed_seq_param),
-      data, (data_bit_size + 7) / 8);
-  g_assert (packed_seq);
-
-  gst_vaapi_enc_picture_add_packed_header (picture, packed_seq);
-  gst_vaapi_codec_object_replace (&packed_seq, NULL);
-
-  /* store sps data */
-  _check_sps_pps_status (encoder, data + 4, data_bit_size / 8 - 4);
+  buf = bs_to_buffer (&bs);
   gst_bit_writer_clear (&bs, TRUE);
-  return TRUE;
+  return buf;
 
   /* ERRORS */
 bs_error:
   {
     GST_WARNING ("failed to write SPS NAL unit");
     gst_bit_writer_clear (&bs, TRUE);
-    return FALSE;
+    return NULL;
   }
 }
 
-static gboolean
-add_packed_sequence_header_mvc (GstVaapiEncoderH264 * encoder,
-    GstVaapiEncPicture * picture, GstVaapiEncSequence * sequence)
+/* Generates the subset sequence header (subset SPS) bitstream */
+static GstBuffer *
+create_packed_sequence_header_mvc (GstVaapiEncoderH264 * encoder,
+    GstVaapiEncSequence * sequence)
 {
-  GstVaapiEncPackedHeader *packed_seq;
   GstBitWriter bs;
-  VAEncPackedHeaderParameterBuffer packed_header_param_buffer = { 0 };
   const VAEncSequenceParameterBufferH264 *const seq_param = sequence->param;
   VAEncMiscParameterHRD hrd_params;
-  guint32 data_bit_size;
-  guint8 *data;
+  GstBuffer *buf;
 
   fill_hrd_params (encoder, &hrd_params);
 
@@ -1314,83 +1314,108 @@ add_packed_sequence_header_mvc (GstVaapiEncoderH264 * encoder,
   bs_write_subset_sps (&bs, seq_param, encoder->profile, encoder->num_views,
       &hrd_params);
 
-  g_assert (GST_BIT_WRITER_BIT_SIZE (&bs) % 8 == 0);
-  data_bit_size = GST_BIT_WRITER_BIT_SIZE (&bs);
-  data = GST_BIT_WRITER_DATA (&bs);
-
-  packed_header_param_buffer.type = VAEncPackedHeaderSequence;
-  packed_header_param_buffer.bit_length = data_bit_size;
-  packed_header_param_buffer.has_emulation_bytes = 0;
-
-  packed_seq = gst_vaapi_enc_packed_header_new (GST_VAAPI_ENCODER (encoder),
-      &packed_header_param_buffer, sizeof (packed_header_param_buffer),
-      data, (data_bit_size + 7) / 8);
-  g_assert (packed_seq);
-
-  gst_vaapi_enc_picture_add_packed_header (picture, packed_seq);
-  gst_vaapi_mini_object_replace ((GstVaapiMiniObject **) & packed_seq, NULL);
-
-  /* store subset sps data */
-  _check_sps_pps_status (encoder, data + 4, data_bit_size / 8 - 4);
+  buf = bs_to_buffer (&bs);
   gst_bit_writer_clear (&bs, TRUE);
-  return TRUE;
+  return buf;
 
   /* ERRORS */
 bs_error:
   {
     GST_WARNING ("failed to write SPS NAL unit");
     gst_bit_writer_clear (&bs, TRUE);
-    return FALSE;
+    return NULL;
   }
 }
 
-/* Adds the supplied picture header (PPS) to the list of packed
-   headers to pass down as-is to the encoder */
-static gboolean
-add_packed_picture_header (GstVaapiEncoderH264 * encoder,
+/* Generates the picture header (PPS) bitstream */
+static GstBuffer *
+create_packed_picture_header (GstVaapiEncoderH264 * encoder,
     GstVaapiEncPicture * picture)
 {
-  GstVaapiEncPackedHeader *packed_pic;
   GstBitWriter bs;
-  VAEncPackedHeaderParameterBuffer packed_pic_param = { 0 };
   const VAEncPictureParameterBufferH264 *const pic_param = picture->param;
-  guint32 data_bit_size;
-  guint8 *data;
+  GstBuffer *buf;
 
   gst_bit_writer_init (&bs, 128 * 8);
   WRITE_UINT32 (&bs, 0x00000001, 32);   /* start code */
   bs_write_nal_header (&bs, GST_H264_NAL_REF_IDC_HIGH, GST_H264_NAL_PPS);
   bs_write_pps (&bs, pic_param, encoder->profile);
-  g_assert (GST_BIT_WRITER_BIT_SIZE (&bs) % 8 == 0);
-  data_bit_size = GST_BIT_WRITER_BIT_SIZE (&bs);
-  data = GST_BIT_WRITER_DATA (&bs);
-
-  packed_pic_param.type = VAEncPackedHeaderPicture;
-  packed_pic_param.bit_length = data_bit_size;
-  packed_pic_param.has_emulation_bytes = 0;
-
-  packed_pic = gst_vaapi_enc_packed_header_new (GST_VAAPI_ENCODER (encoder),
-      &packed_pic_param, sizeof (packed_pic_param),
-      data, (data_bit_size + 7) / 8);
-  g_assert (packed_pic);
 
-  gst_vaapi_enc_picture_add_packed_header (picture, packed_pic);
-  gst_vaapi_codec_object_replace (&packed_pic, NULL);
-
-  /* store pps data */
-  _check_sps_pps_status (encoder, data + 4, data_bit_size / 8 - 4);
+  buf = bs_to_buffer (&bs);
   gst_bit_writer_clear (&bs, TRUE);
-  return TRUE;
+  return buf;
 
   /* ERRORS */
 bs_error:
   {
     GST_WARNING ("failed to write PPS NAL unit");
     gst_bit_writer_clear (&bs, TRUE);
-    return FALSE;
+    return NULL;
   }
 }
 
+/* Stores the SPS/PPS NAL unit (without start code) for codec_data */
+static void
+check_sps_pps_status_from_buffer (GstVaapiEncoderH264 * encoder,
+    GstBuffer * buf)
+{
+  GstMapInfo info;
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_READ))
+    return;
+  if (info.size > 4)
+    _check_sps_pps_status (encoder, info.data + 4, info.size - 4);
+  gst_buffer_unmap (buf, &info);
+}
+
+/* Adds the supplied sequence header (SPS or subset SPS) to the list of
+   packed headers to pass down as-is to the encoder. The bitstream is
+   generated once, and then reused until the configuration changes */
+static gboolean
+add_packed_sequence_header (GstVaapiEncoderH264 * encoder,
+    GstVaapiEncPicture * picture, GstVaapiEncSequence * sequence)
+{
+  GstBuffer **const packed_seq_hdr_ptr =
+      &encoder->packed_seq_hdr[encoder->view_idx];
+
+  if (!*packed_seq_hdr_ptr) {
+    if (encoder->is_mvc && encoder->view_idx)
+      *packed_seq_hdr_ptr =
+          create_packed_sequence_header_mvc (encoder, sequence);
+    else
+      *packed_seq_hdr_ptr = create_packed_sequence_header (encoder, sequence);
+    if (!*packed_seq_hdr_ptr)
+      return FALSE;
+
+    /* store sps data */
+    check_sps_pps_status_from_buffer (encoder, *packed_seq_hdr_ptr);
+  }
+  return add_packed_header_from_buffer (encoder, picture,
+      VAEncPackedHeaderSequence, *packed_seq_hdr_ptr);
+}
+
+/* Adds the supplied picture header (PPS) to the list of packed
+   headers to pass down as-is to the encoder. The bitstream is
+   generated once, and then reused until the configuration changes */
+static gboolean
+add_packed_picture_header (GstVaapiEncoderH264 * encoder,
+    GstVaapiEncPicture * picture)
+{
+  GstBuffer **const packed_pic_hdr_ptr =
+      &encoder->packed_pic_hdr[encoder->view_idx];
+
+  if (!*packed_pic_hdr_ptr) {
+    *packed_pic_hdr_ptr = create_packed_picture_header (encoder, picture);
+    if (!*packed_pic_hdr_ptr)
+      return FALSE;
+
+    /* store pps data */
+    check_sps_pps_status_from_buffer (encoder, *packed_pic_hdr_ptr);
+  }
+  return add_packed_header_from_buffer (encoder, picture,
+      VAEncPackedHeaderPicture, *packed_pic_hdr_ptr);
+}
+
 static gboolean
 get_nal_hdr_attributes (GstVaapiEncPicture * picture,
     guint8 * nal_ref_idc, guint8 * nal_unit_type)
@@ -1946,8 +1971,9 @@ ensure_sequence (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture)
 {
   GstVaapiEncSequence *sequence = NULL;
 
-  /* submit an SPS header before every new I-frame, if codec config changed */
-  if (!encoder->config_changed || picture->type != GST_VAAPI_PICTURE_TYPE_I)
+  /* submit an SPS header before every new IDR frame, if codec config
+     changed. The active SPS cannot change at any other picture */
+  if (!encoder->config_changed || !GST_VAAPI_ENC_PICTURE_IS_IDR (picture))
     return TRUE;
 
   sequence = GST_VAAPI_ENC_SEQUENCE_NEW (H264, encoder);
@@ -1955,15 +1981,9 @@ ensure_sequence (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture)
     goto error_create_seq_param;
 
   /* add subset sps for non-base view and sps for base view */
-  if (encoder->is_mvc && encoder->view_idx) {
-    if ((GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) & VAEncPackedHeaderH264_SPS)
-        && !add_packed_sequence_header_mvc (encoder, picture, sequence))
-      goto error_create_packed_seq_hdr;
-  } else {
-    if ((GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) & VAEncPackedHeaderH264_SPS)
-        && !add_packed_sequence_header (encoder, picture, sequence))
-      goto error_create_packed_seq_hdr;
-  }
+  if ((GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) & VAEncPackedHeaderH264_SPS)
+      && !add_packed_sequence_header (encoder, picture, sequence))
+    goto error_create_packed_seq_hdr;
 
   if (sequence) {
     gst_vaapi_enc_picture_set_sequence (picture, sequence);
@@ -2181,6 +2201,39 @@ ensure_profile_and_level (GstVaapiEncoderH264 * encoder)
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
 }
 
+/* Limits the number of B-frames to what fits in a keyframe period */
+static void
+ensure_num_bframes (GstVaapiEncoderH264 * encoder)
+{
+  GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
+
+  if (encoder->num_bframes > (base_encoder->keyframe_period + 1) / 2)
+    encoder->num_bframes = (base_encoder->keyframe_period + 1) / 2;
+}
+
+/* Derives the PTS shift applied to reordered frames from the framerate */
+static GstClockTime
+get_cts_offset (GstVaapiEncoderH264 * encoder)
+{
+  if (!encoder->num_bframes)
+    return 0;
+  return GST_SECOND * GST_VAAPI_ENCODER_FPS_D (encoder) /
+      GST_VAAPI_ENCODER_FPS_N (encoder);
+}
+
+/* Checks whether all reordered frames were output, in every view */
+static gboolean
+is_reorder_queue_empty (GstVaapiEncoderH264 * encoder)
+{
+  guint i;
+
+  for (i = 0; i < encoder->num_views; i++) {
+    if (!g_queue_is_empty (&encoder->reorder_pools[i].reorder_frame_list))
+      return FALSE;
+  }
+  return TRUE;
+}
+
 static void
 reset_properties (GstVaapiEncoderH264 * encoder)
 {
@@ -2202,14 +2255,8 @@ reset_properties (GstVaapiEncoderH264 * encoder)
     encoder->num_slices = (mb_size + 1) / 2;
   g_assert (encoder->num_slices);
 
-  if (encoder->num_bframes > (base_encoder->keyframe_period + 1) / 2)
-    encoder->num_bframes = (base_encoder->keyframe_period + 1) / 2;
-
-  if (encoder->num_bframes)
-    encoder->cts_offset = GST_SECOND * GST_VAAPI_ENCODER_FPS_D (encoder) /
-        GST_VAAPI_ENCODER_FPS_N (encoder);
-  else
-    encoder->cts_offset = 0;
+  ensure_num_bframes (encoder);
+  encoder->cts_offset = encoder->next_cts_offset = get_cts_offset (encoder);
 
   /* init max_frame_num, max_poc */
   encoder->log2_max_frame_num =
@@ -2435,11 +2482,19 @@ gst_vaapi_encoder_h264_reordering (GstVaapiEncoder * base_encoder,
   picture->poc = ((reorder_pool->cur_present_index * 2) %
       encoder->max_pic_order_cnt);
 
+  /* Forced key frames start a new GOP, in every view */
+  if (GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME (frame)) {
+    guint i;
+
+    for (i = 0; i < encoder->num_views; i++)
+      encoder->reorder_pools[i].frame_index = 0;
+  }
+
   is_idr = (reorder_pool->frame_index == 0 ||
       reorder_pool->frame_index >= encoder->idr_period);
 
   /* check key frames */
-  if (is_idr || GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME (frame) ||
+  if (is_idr ||
       (reorder_pool->frame_index %
           GST_VAAPI_ENCODER_KEYFRAME_PERIOD (encoder)) == 0) {
     ++reorder_pool->cur_frame_num;
@@ -2489,6 +2544,13 @@ gst_vaapi_encoder_h264_reordering (GstVaapiEncoder * base_encoder,
 
 end:
   g_assert (picture);
+
+  /* A new PTS shift only applies from an IDR frame on, once all the
+     frames shifted by the previous one were output */
+  if (GST_VAAPI_ENC_PICTURE_IS_IDR (picture) &&
+      is_reorder_queue_empty (encoder))
+    encoder->cts_offset = encoder->next_cts_offset;
+
   frame = picture->frame;
   if (GST_CLOCK_TIME_IS_VALID (frame->pts))
     frame->pts += encoder->cts_offset;
@@ -2521,6 +2583,7 @@ set_context_info (GstVaapiEncoder * base_encoder)
   base_encoder->num_ref_frames =
       ((encoder->num_bframes ? 2 : 1) + DEFAULT_SURFACES_COUNT)
       * encoder->num_views;
+  base_encoder->num_reorder_frames = encoder->num_bframes * encoder->num_views;
 
   /* Only YUV 4:2:0 formats are supported for now. This means that we
      have a limit of 3200 bits per macroblock. */
@@ -2567,9 +2630,64 @@ gst_vaapi_encoder_h264_reconfigure (GstVaapiEncoder * base_encoder)
     return status;
 
   reset_properties (encoder);
+  reset_packed_headers (encoder);
   return set_context_info (base_encoder);
 }
 
+/* Applies the bitrate, framerate, QP or keyframe period changes made
+   while encoding. The rate control parameters apply to the next frame,
+   but the SPS, and thus the level and the HRD parameters, only change
+   at the next IDR frame. The VA context and the reordering state are
+   retained, so the number of B-frames cannot change */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_h264_update_parameters (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderH264 *const encoder =
+      GST_VAAPI_ENCODER_H264_CAST (base_encoder);
+  const GstVaapiLevelH264 level = encoder->level;
+
+  /* The IDR period is bounded by the range of frame_num values */
+  if (base_encoder->keyframe_period != encoder->idr_period) {
+    if (h264_get_log2_max_frame_num (base_encoder->keyframe_period) >
+        encoder->log2_max_frame_num)
+      goto error_invalid_keyframe_period;
+    if (encoder->num_bframes > (base_encoder->keyframe_period + 1) / 2)
+      goto error_invalid_num_bframes;
+    encoder->idr_period = base_encoder->keyframe_period;
+  }
+  encoder->next_cts_offset = get_cts_offset (encoder);
+
+  if (encoder->min_qp > encoder->init_qp ||
+      (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP &&
+          encoder->min_qp < encoder->init_qp))
+    encoder->min_qp = encoder->init_qp;
+
+  ensure_bitrate (encoder);
+  if (!ensure_level (encoder))
+    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  if (encoder->level != level)
+    GST_DEBUG ("switched to level %s",
+        gst_vaapi_utils_h264_get_level_string (encoder->level));
+
+  encoder->config_changed = TRUE;
+  reset_packed_headers (encoder);
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+  /* ERRORS */
+error_invalid_keyframe_period:
+  {
+    GST_ERROR ("keyframe period %u exceeds the initial IDR period (%u)",
+        base_encoder->keyframe_period, encoder->idr_period);
+    return GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER;
+  }
+error_invalid_num_bframes:
+  {
+    GST_ERROR ("keyframe period %u is too short for %u B-frames",
+        base_encoder->keyframe_period, encoder->num_bframes);
+    return GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER;
+  }
+}
+
 static gboolean
 gst_vaapi_encoder_h264_init (GstVaapiEncoder * base_encoder)
 {
@@ -2618,6 +2736,7 @@ gst_vaapi_encoder_h264_finalize (GstVaapiEncoder * base_encoder)
   gst_buffer_replace (&encoder->sps_data, NULL);
   gst_buffer_replace (&encoder->subset_sps_data, NULL);
   gst_buffer_replace (&encoder->pps_data, NULL);
+  reset_packed_headers (encoder);
 
   /* reference list info de-init */
   for (i = 0; i < MAX_NUM_VIEWS; i++) {
@@ -2687,6 +2806,7 @@ gst_vaapi_encoder_h264_class (void)
 {
   static const GstVaapiEncoderClass GstVaapiEncoderH264Class = {
     GST_VAAPI_ENCODER_CLASS_INIT (H264, h264),
+    .update_parameters = gst_vaapi_encoder_h264_update_parameters,
     .set_property = gst_vaapi_encoder_h264_set_property,
     .get_codec_data = gst_vaapi_encoder_h264_get_codec_data
   };
@@ -2749,7 +2869,8 @@ gst_vaapi_encoder_h264_get_default_properties (void)
       GST_VAAPI_ENCODER_H264_PROP_INIT_QP,
       g_param_spec_uint ("init-qp",
           "Initial QP", "Initial quantizer value", 1, 51, 26,
-          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   /**
    * GstVaapiEncoderH264:min-qp:
@@ -2760,7 +2881,8 @@ gst_vaapi_encoder_h264_get_default_properties (void)
       GST_VAAPI_ENCODER_H264_PROP_MIN_QP,
       g_param_spec_uint ("min-qp",
           "Minimum QP", "Minimum quantizer value", 1, 51, 1,
-          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   /**
    * GstVaapiEncoderH264:num-slices:
@@ -0,0 +1,556 @@
+/*
+ *  gstvaapiencoder_jpeg.c - JPEG encoder
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include <va/va.h>
+#include <va/va_enc_jpeg.h>
+#include <va/va_dec_jpeg.h>
+#include <gst/base/gstbitwriter.h>
+#include "gstvaapicompat.h"
+#include "gstvaapiencoder_priv.h"
+#include "gstvaapiencoder_jpeg.h"
+#include "gstvaapiutils_jpeg_priv.h"
+#include "gstvaapicodedbufferproxy_priv.h"
+#include "gstvaapisurface.h"
+#include "gstvaapiutils_core.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/* Define default quality factor */
+#define DEFAULT_QUALITY 50
+
+/* Define default rate control mode ("none") */
+#define DEFAULT_RATECONTROL GST_VAAPI_RATECONTROL_NONE
+
+/* Supported set of VA rate controls, within this implementation */
+#define SUPPORTED_RATECONTROLS \
+  (GST_VAAPI_RATECONTROL_MASK (NONE))
+
+/* Supported set of tuning options, within this implementation */
+#define SUPPORTED_TUNE_OPTIONS \
+  (GST_VAAPI_ENCODER_TUNE_MASK (NONE))
+
+/* Supported set of VA packed headers, within this implementation */
+#define SUPPORTED_PACKED_HEADERS \
+  (VA_ENC_PACKED_HEADER_RAW_DATA)
+
+#define GST_VAAPI_ENCODER_JPEG_CAST(encoder) \
+  ((GstVaapiEncoderJpeg *) (encoder))
+
+/* ------------------------------------------------------------------------- */
+/* --- JPEG Encoder                                                      --- */
+/* ------------------------------------------------------------------------- */
+
+struct _GstVaapiEncoderJpeg
+{
+  GstVaapiEncoder parent_instance;
+
+  GstVaapiProfile profile;
+  guint quality;
+  GstVaapiJpegFrameInfo frame_info;
+};
+
+/* Derives the profile supported by the underlying hardware */
+static gboolean
+ensure_hw_profile (GstVaapiEncoderJpeg * encoder)
+{
+  GstVaapiDisplay *const display = GST_VAAPI_ENCODER_DISPLAY (encoder);
+
+  if (!gst_vaapi_display_has_encoder (display, encoder->profile,
+          GST_VAAPI_ENTRYPOINT_PICTURE_ENCODE))
+    goto error_unsupported_profile;
+
+  GST_VAAPI_ENCODER_CAST (encoder)->profile = encoder->profile;
+  return TRUE;
+
+  /* ERRORS */
+error_unsupported_profile:
+  {
+    GST_ERROR ("unsupported HW profile (0x%08x)", encoder->profile);
+    return FALSE;
+  }
+}
+
+/* Checks the hardware can output the JPEG headers, which are only
+   submitted as raw data packed headers. Without them, the coded
+   buffers would only hold the entropy coded data */
+static gboolean
+ensure_packed_headers (GstVaapiEncoderJpeg * encoder)
+{
+  GstVaapiDisplay *const display = GST_VAAPI_ENCODER_DISPLAY (encoder);
+  guint value;
+
+  if (!gst_vaapi_get_config_attribute (display,
+          gst_vaapi_profile_get_va_profile (encoder->profile),
+          gst_vaapi_entrypoint_get_va_entrypoint
+          (GST_VAAPI_ENTRYPOINT_PICTURE_ENCODE),
+          VAConfigAttribEncPackedHeaders, &value))
+    value = 0;
+  if (!(value & VA_ENC_PACKED_HEADER_RAW_DATA))
+    goto error_unsupported_packed_headers;
+  return TRUE;
+
+  /* ERRORS */
+error_unsupported_packed_headers:
+  {
+    GST_ERROR ("unsupported raw data packed headers (0x%08x)", value);
+    return FALSE;
+  }
+}
+
+/* Returns the number of samples of the image, chroma included */
+static guint
+get_num_samples (GstVaapiEncoderJpeg * encoder)
+{
+  GstVideoInfo *const vip = GST_VAAPI_ENCODER_VIDEO_INFO (encoder);
+  const guint num_pixels = GST_ROUND_UP_16 (vip->width) *
+      GST_ROUND_UP_16 (vip->height);
+
+  switch (gst_vaapi_video_format_get_chroma_type (GST_VIDEO_INFO_FORMAT
+          (vip))) {
+    case GST_VAAPI_CHROMA_TYPE_YUV400:
+      return num_pixels;
+    case GST_VAAPI_CHROMA_TYPE_YUV422:
+      return num_pixels * 2;
+    case GST_VAAPI_CHROMA_TYPE_YUV444:
+      return num_pixels * 3;
+    default:
+      return num_pixels * 3 / 2;
+  }
+}
+
+/* Derives the image components and quantization tables from the
+   current configuration */
+static gboolean
+ensure_frame_info (GstVaapiEncoderJpeg * encoder)
+{
+  GstVideoInfo *const vip = GST_VAAPI_ENCODER_VIDEO_INFO (encoder);
+  const GstVaapiChromaType chroma_type =
+      gst_vaapi_video_format_get_chroma_type (GST_VIDEO_INFO_FORMAT (vip));
+
+  if (!gst_vaapi_utils_jpeg_frame_info_init (&encoder->frame_info,
+          GST_VIDEO_INFO_WIDTH (vip), GST_VIDEO_INFO_HEIGHT (vip),
+          chroma_type, encoder->quality))
+    goto error_unsupported_format;
+  return TRUE;
+
+  /* ERRORS */
+error_unsupported_format:
+  {
+    GST_ERROR ("unsupported format %s (%ux%u)",
+        gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (vip)),
+        GST_VIDEO_INFO_WIDTH (vip), GST_VIDEO_INFO_HEIGHT (vip));
+    return FALSE;
+  }
+}
+
+static gboolean
+fill_picture (GstVaapiEncoderJpeg * encoder, GstVaapiEncPicture * picture,
+    GstVaapiCodedBuffer * codedbuf, GstVaapiSurfaceProxy * surface)
+{
+  const GstVaapiJpegFrameInfo *const info = &encoder->frame_info;
+  VAEncPictureParameterBufferJPEG *const pic_param = picture->param;
+  guint i;
+
+  memset (pic_param, 0, sizeof (VAEncPictureParameterBufferJPEG));
+
+  pic_param->reconstructed_picture =
+      GST_VAAPI_SURFACE_PROXY_SURFACE_ID (surface);
+  pic_param->coded_buf = GST_VAAPI_OBJECT_ID (codedbuf);
+  pic_param->picture_width = info->width;
+  pic_param->picture_height = info->height;
+
+  pic_param->pic_flags.bits.profile = 0;        /* baseline */
+  pic_param->pic_flags.bits.progressive = 0;
+  pic_param->pic_flags.bits.huffman = 1;
+  pic_param->pic_flags.bits.interleaved = info->num_components > 1;
+  pic_param->pic_flags.bits.differential = 0;
+
+  pic_param->sample_bit_depth = 8;
+  pic_param->num_scan = 1;
+  pic_param->num_components = info->num_components;
+  for (i = 0; i < info->num_components; i++) {
+    pic_param->component_id[i] = info->components[i].id;
+    pic_param->quantiser_table_selector[i] = info->components[i].quant_table;
+  }
+
+  /* The driver scales the quantization matrices by this factor */
+  pic_param->quality = info->quality;
+  return TRUE;
+}
+
+/* The quantization matrices are submitted unscaled, i.e. for quality
+   50, since the driver applies the quality factor itself. The tables
+   written to the DQT segment are the scaled ones */
+static gboolean
+ensure_q_matrix (GstVaapiEncoderJpeg * encoder, GstVaapiEncPicture * picture)
+{
+  const GstVaapiJpegFrameInfo *const info = &encoder->frame_info;
+  GstVaapiEncQMatrix *q_matrix;
+  VAQMatrixBufferJPEG *iq_matrix;
+
+  q_matrix = GST_VAAPI_ENC_Q_MATRIX_NEW (JPEG, encoder);
+  if (!q_matrix)
+    return FALSE;
+  iq_matrix = q_matrix->param;
+
+  memset (iq_matrix, 0, sizeof (VAQMatrixBufferJPEG));
+  iq_matrix->load_lum_quantiser_matrix = 1;
+  gst_vaapi_utils_jpeg_get_quant_table (0, 50,
+      iq_matrix->lum_quantiser_matrix);
+
+  iq_matrix->load_chroma_quantiser_matrix = info->num_components > 1;
+  if (iq_matrix->load_chroma_quantiser_matrix)
+    gst_vaapi_utils_jpeg_get_quant_table (1, 50,
+        iq_matrix->chroma_quantiser_matrix);
+
+  gst_vaapi_enc_picture_set_q_matrix (picture, q_matrix);
+  gst_vaapi_codec_object_replace (&q_matrix, NULL);
+  return TRUE;
+}
+
+static gboolean
+ensure_huffman_table (GstVaapiEncoderJpeg * encoder,
+    GstVaapiEncPicture * picture)
+{
+  const GstVaapiJpegFrameInfo *const info = &encoder->frame_info;
+  const GstVaapiJpegHuffmanTable *dc_table, *ac_table;
+  GstVaapiEncHuffmanTable *huf_table;
+  VAHuffmanTableBufferJPEGBaseline *huffman_table;
+  guint i, num_tables;
+
+  huf_table = GST_VAAPI_ENC_HUFFMAN_TABLE_NEW (JPEGBaseline, encoder);
+  if (!huf_table)
+    return FALSE;
+  huffman_table = huf_table->param;
+
+  memset (huffman_table, 0, sizeof (VAHuffmanTableBufferJPEGBaseline));
+  num_tables = info->num_components > 1 ? 2 : 1;
+  for (i = 0; i < num_tables; i++) {
+    dc_table = gst_vaapi_utils_jpeg_get_huffman_table (0, i);
+    ac_table = gst_vaapi_utils_jpeg_get_huffman_table (1, i);
+
+    huffman_table->load_huffman_table[i] = 1;
+    memcpy (huffman_table->huffman_table[i].num_dc_codes, dc_table->huf_bits,
+        sizeof (huffman_table->huffman_table[i].num_dc_codes));
+    memcpy (huffman_table->huffman_table[i].dc_values, dc_table->huf_values,
+        sizeof (huffman_table->huffman_table[i].dc_values));
+    memcpy (huffman_table->huffman_table[i].num_ac_codes, ac_table->huf_bits,
+        sizeof (huffman_table->huffman_table[i].num_ac_codes));
+    memcpy (huffman_table->huffman_table[i].ac_values, ac_table->huf_values,
+        sizeof (huffman_table->huffman_table[i].ac_values));
+  }
+
+  gst_vaapi_enc_picture_set_huffman_table (picture, huf_table);
+  gst_vaapi_codec_object_replace (&huf_table, NULL);
+  return TRUE;
+}
+
+static gboolean
+ensure_slices (GstVaapiEncoderJpeg * encoder, GstVaapiEncPicture * picture)
+{
+  const GstVaapiJpegFrameInfo *const info = &encoder->frame_info;
+  VAEncSliceParameterBufferJPEG *slice_param;
+  GstVaapiEncSlice *slice;
+  guint i;
+
+  slice = GST_VAAPI_ENC_SLICE_NEW (JPEG, encoder);
+  if (!slice)
+    return FALSE;
+  slice_param = slice->param;
+
+  memset (slice_param, 0, sizeof (VAEncSliceParameterBufferJPEG));
+  slice_param->restart_interval = 0;
+  slice_param->num_components = info->num_components;
+  for (i = 0; i < info->num_components; i++) {
+    slice_param->components[i].component_selector = info->components[i].id;
+    slice_param->components[i].dc_table_selector =
+        info->components[i].dc_table;
+    slice_param->components[i].ac_table_selector =
+        info->components[i].ac_table;
+  }
+
+  gst_vaapi_enc_picture_add_slice (picture, slice);
+  gst_vaapi_codec_object_replace (&slice, NULL);
+  return TRUE;
+}
+
+/* Submits all headers from SOI up to the SOS segment. The driver then
+   appends the entropy coded data and the EOI marker */
+static gboolean
+set_packed_headers (GstVaapiEncoderJpeg * encoder,
+    GstVaapiEncPicture * picture)
+{
+  GstVaapiEncPackedHeader *packed_raw_data;
+  GstBitWriter writer;
+  VAEncPackedHeaderParameterBuffer packed_header_param_buffer = { 0 };
+  guint32 data_bit_size;
+  guint8 *data;
+
+  gst_bit_writer_init (&writer, 1024 * 8);
+  if (!gst_vaapi_utils_jpeg_write_headers (&writer, &encoder->frame_info))
+    goto error_write_headers;
+  g_assert (GST_BIT_WRITER_BIT_SIZE (&writer) % 8 == 0);
+  data_bit_size = GST_BIT_WRITER_BIT_SIZE (&writer);
+  data = GST_BIT_WRITER_DATA (&writer);
+
+  packed_header_param_buffer.type = VAEncPackedHeaderRawData;
+  packed_header_param_buffer.bit_length = data_bit_size;
+  packed_header_param_buffer.has_emulation_bytes = 0;
+
+  packed_raw_data = gst_vaapi_enc_packed_header_new (GST_VAAPI_ENCODER
+      (encoder), &packed_header_param_buffer,
+      sizeof (packed_header_param_buffer), data, (data_bit_size + 7) / 8);
+  g_assert (packed_raw_data);
+
+  gst_vaapi_enc_picture_add_packed_header (picture, packed_raw_data);
+  gst_vaapi_codec_object_replace (&packed_raw_data, NULL);
+  gst_bit_writer_clear (&writer, TRUE);
+  return TRUE;
+
+  /* ERRORS */
+error_write_headers:
+  {
+    GST_ERROR ("failed to write JPEG headers");
+    gst_bit_writer_clear (&writer, TRUE);
+    return FALSE;
+  }
+}
+
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_jpeg_encode (GstVaapiEncoder * base_encoder,
+    GstVaapiEncPicture * picture, GstVaapiCodedBufferProxy * codedbuf)
+{
+  GstVaapiEncoderJpeg *const encoder =
+      GST_VAAPI_ENCODER_JPEG_CAST (base_encoder);
+  GstVaapiEncoderStatus ret = GST_VAAPI_ENCODER_STATUS_ERROR_UNKNOWN;
+  GstVaapiSurfaceProxy *reconstruct = NULL;
+
+  reconstruct = gst_vaapi_encoder_create_surface (base_encoder);
+
+  g_assert (GST_VAAPI_SURFACE_PROXY_SURFACE (reconstruct));
+
+  if (!fill_picture (encoder, picture,
+          GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (codedbuf), reconstruct))
+    goto error;
+  if (!ensure_q_matrix (encoder, picture))
+    goto error;
+  if (!ensure_huffman_table (encoder, picture))
+    goto error;
+  if (!ensure_slices (encoder, picture))
+    goto error;
+  if ((GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) &
+          VA_ENC_PACKED_HEADER_RAW_DATA)
+      && !set_packed_headers (encoder, picture))
+    goto error;
+  if (!gst_vaapi_enc_picture_encode (picture))
+    goto error;
+
+  /* There are no reference pictures in JPEG, but the hardware may still
+     write to the reconstructed surface until the coded buffer is ready */
+  gst_vaapi_enc_picture_set_reconstructed_surface (picture, reconstruct);
+  gst_vaapi_encoder_release_surface (base_encoder, reconstruct);
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+error:
+  if (reconstruct)
+    gst_vaapi_encoder_release_surface (base_encoder, reconstruct);
+  return ret;
+}
+
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_jpeg_flush (GstVaapiEncoder * base_encoder)
+{
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
+/* Every image is independently coded, so frames are output as they
+   come, as I-frames */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_jpeg_reordering (GstVaapiEncoder * base_encoder,
+    GstVideoCodecFrame * frame, GstVaapiEncPicture ** output)
+{
+  GstVaapiEncPicture *picture;
+
+  if (!frame)
+    return GST_VAAPI_ENCODER_STATUS_NO_SURFACE;
+
+  picture = GST_VAAPI_ENC_PICTURE_NEW (JPEG, base_encoder, frame);
+  if (!picture) {
+    GST_WARNING ("create JPEG picture failed, frame timestamp:%"
+        GST_TIME_FORMAT, GST_TIME_ARGS (frame->pts));
+    return GST_VAAPI_ENCODER_STATUS_ERROR_ALLOCATION_FAILED;
+  }
+  picture->type = GST_VAAPI_PICTURE_TYPE_I;
+  GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
+
+  *output = picture;
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
+static GstVaapiEncoderStatus
+set_context_info (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderJpeg *const encoder =
+      GST_VAAPI_ENCODER_JPEG_CAST (base_encoder);
+
+  /* Maximum size for the headers from SOI up to SOS (in bytes), with
+     two quantization tables and four Huffman tables */
+  enum
+  {
+    MAX_HEADERS_SIZE = 640,
+  };
+
+  if (!ensure_hw_profile (encoder))
+    return GST_VAAPI_ENCODER_STATUS_ERROR_UNSUPPORTED_PROFILE;
+  if (!ensure_packed_headers (encoder))
+    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+
+  base_encoder->num_ref_frames = 0;
+  base_encoder->num_reorder_frames = 0;
+
+  /* At the highest qualities, the entropy coded data can exceed the
+     size of the raw image. Allow for 2 bytes per sample of the actual
+     chroma format, the bound libjpeg-turbo uses for its buffers */
+  base_encoder->codedbuf_size = get_num_samples (encoder) * 2;
+
+  base_encoder->codedbuf_size += MAX_HEADERS_SIZE;
+
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_jpeg_reconfigure (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderJpeg *const encoder =
+      GST_VAAPI_ENCODER_JPEG_CAST (base_encoder);
+
+  if (!ensure_frame_info (encoder))
+    return GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER;
+  return set_context_info (base_encoder);
+}
+
+/* Applies the quality changes made while encoding. Only the
+   quantization tables depend on it */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_jpeg_update_parameters (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderJpeg *const encoder =
+      GST_VAAPI_ENCODER_JPEG_CAST (base_encoder);
+
+  if (!ensure_frame_info (encoder))
+    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
+static gboolean
+gst_vaapi_encoder_jpeg_init (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderJpeg *const encoder =
+      GST_VAAPI_ENCODER_JPEG_CAST (base_encoder);
+
+  encoder->profile = GST_VAAPI_PROFILE_JPEG_BASELINE;
+  encoder->quality = DEFAULT_QUALITY;
+  return TRUE;
+}
+
+static void
+gst_vaapi_encoder_jpeg_finalize (GstVaapiEncoder * base_encoder)
+{
+}
+
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_jpeg_set_property (GstVaapiEncoder * base_encoder,
+    gint prop_id, const GValue * value)
+{
+  GstVaapiEncoderJpeg *const encoder =
+      GST_VAAPI_ENCODER_JPEG_CAST (base_encoder);
+
+  switch (prop_id) {
+    case GST_VAAPI_ENCODER_JPEG_PROP_QUALITY:
+      encoder->quality = g_value_get_uint (value);
+      break;
+    default:
+      return GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER;
+  }
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
+GST_VAAPI_ENCODER_DEFINE_CLASS_DATA (JPEG);
+
+static inline const GstVaapiEncoderClass *
+gst_vaapi_encoder_jpeg_class (void)
+{
+  static const GstVaapiEncoderClass GstVaapiEncoderJpegClass = {
+    GST_VAAPI_ENCODER_CLASS_INIT (Jpeg, jpeg),
+    .update_parameters = gst_vaapi_encoder_jpeg_update_parameters,
+    .set_property = gst_vaapi_encoder_jpeg_set_property,
+  };
+  return &GstVaapiEncoderJpegClass;
+}
+
+/**
+ * gst_vaapi_encoder_jpeg_new:
+ * @display: a #GstVaapiDisplay
+ *
+ * Creates a new #GstVaapiEncoder for JPEG encoding.
+ *
+ * Return value: the newly allocated #GstVaapiEncoder object
+ */
+GstVaapiEncoder *
+gst_vaapi_encoder_jpeg_new (GstVaapiDisplay * display)
+{
+  return gst_vaapi_encoder_new (gst_vaapi_encoder_jpeg_class (), display);
+}
+
+/**
+ * gst_vaapi_encoder_jpeg_get_default_properties:
+ *
+ * Determines the set of common and JPEG specific encoder properties.
+ * The caller owns an extra reference to the resulting array of
+ * #GstVaapiEncoderPropInfo elements, so it shall be released with
+ * g_ptr_array_unref() after usage.
+ *
+ * Return value: the set of encoder properties for #GstVaapiEncoderJpeg,
+ *   or %NULL if an error occurred.
+ */
+GPtrArray *
+gst_vaapi_encoder_jpeg_get_default_properties (void)
+{
+  const GstVaapiEncoderClass *const klass = gst_vaapi_encoder_jpeg_class ();
+  GPtrArray *props;
+
+  props = gst_vaapi_encoder_properties_get_default (klass);
+  if (!props)
+    return NULL;
+
+  GST_VAAPI_ENCODER_PROPERTIES_APPEND (props,
+      GST_VAAPI_ENCODER_JPEG_PROP_QUALITY,
+      g_param_spec_uint ("quality",
+          "Quality factor",
+          "Quality factor for the quantization tables",
+          1, GST_VAAPI_JPEG_MAX_QUALITY, DEFAULT_QUALITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  return props;
+}
@@ -235,7 +235,7 @@ fill_sequence (GstVaapiEncoderMpeg2 * encoder, GstVaapiEncSequence * sequence)
   seq_param->sequence_extension.bits.frame_rate_extension_d = 0;
 
   seq_param->gop_header.bits.time_code = (1 << 12);     /* bit12: marker_bit */
-  seq_param->gop_header.bits.closed_gop = 0;
+  seq_param->gop_header.bits.closed_gop = encoder->new_gop_closed;
   seq_param->gop_header.bits.broken_link = 0;
 
   return TRUE;
@@ -306,7 +306,8 @@ fill_picture (GstVaapiEncoderMpeg2 * encoder,
     pic_param->f_code[1][0] = 0xf;
     pic_param->f_code[1][1] = 0xf;
     pic_param->forward_reference_picture =
-        GST_VAAPI_SURFACE_PROXY_SURFACE_ID (encoder->forward);
+        GST_VAAPI_SURFACE_PROXY_SURFACE_ID (encoder->backward ?
+        encoder->backward : encoder->forward);
     pic_param->backward_reference_picture = VA_INVALID_SURFACE;
   } else if (pic_param->picture_type == VAEncPictureTypeBidirectional) {
     pic_param->f_code[0][0] = f_code_x;
@@ -560,7 +561,8 @@ gst_vaapi_encoder_mpeg2_encode (GstVaapiEncoder * base_encoder,
   if (!gst_vaapi_enc_picture_encode (picture))
     goto error;
   if (picture->type != GST_VAAPI_PICTURE_TYPE_B) {
-    if (encoder->new_gop)
+    /* Leading B-frames of an open GOP still refer to the previous GOP */
+    if (encoder->new_gop && encoder->new_gop_closed)
       clear_references (encoder);
     push_reference (encoder, reconstruct);
   } else if (reconstruct)
@@ -580,15 +582,33 @@ gst_vaapi_encoder_mpeg2_flush (GstVaapiEncoder * base_encoder)
 {
   GstVaapiEncoderMpeg2 *const encoder =
       GST_VAAPI_ENCODER_MPEG2_CAST (base_encoder);
-  GstVaapiEncPicture *pic;
+  GstVaapiEncoderStatus status;
 
-  while (!g_queue_is_empty (&encoder->b_frames)) {
-    pic = g_queue_pop_head (&encoder->b_frames);
-    gst_vaapi_enc_picture_unref (pic);
-  }
-  g_queue_clear (&encoder->b_frames);
+  /* Encode the trailing B-frames, the last one becoming a P-frame */
+  gst_vaapi_utils_mpeg2_gop_drain (&encoder->gop);
+  status = gst_vaapi_encoder_put_frame (base_encoder, NULL);
 
-  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+  /* Start with a new GOP next time */
+  gst_vaapi_utils_mpeg2_gop_clear (&encoder->gop,
+      (GDestroyNotify) gst_vaapi_mini_object_unref);
+  return status;
+}
+
+/* Returns the GstVaapiPictureType from the MPEG-2 picture_coding_type */
+static GstVaapiPictureType
+get_picture_type (GstMpegVideoPictureType coding_type)
+{
+  switch (coding_type) {
+    case GST_MPEG_VIDEO_PICTURE_TYPE_I:
+      return GST_VAAPI_PICTURE_TYPE_I;
+    case GST_MPEG_VIDEO_PICTURE_TYPE_P:
+      return GST_VAAPI_PICTURE_TYPE_P;
+    case GST_MPEG_VIDEO_PICTURE_TYPE_B:
+      return GST_VAAPI_PICTURE_TYPE_B;
+    default:
+      break;
+  }
+  return GST_VAAPI_PICTURE_TYPE_NONE;
 }
 
 static GstVaapiEncoderStatus
@@ -597,58 +617,35 @@ gst_vaapi_encoder_mpeg2_reordering (GstVaapiEncoder * base_encoder,
 {
   GstVaapiEncoderMpeg2 *const encoder =
       GST_VAAPI_ENCODER_MPEG2_CAST (base_encoder);
-  GstVaapiEncPicture *picture = NULL;
-  GstVaapiEncoderStatus status = GST_VAAPI_ENCODER_STATUS_SUCCESS;
-
-  if (!frame) {
-    if (g_queue_is_empty (&encoder->b_frames) && encoder->dump_frames) {
-      push_reference (encoder, NULL);
-      encoder->dump_frames = FALSE;
+  GstVaapiEncPicture *picture;
+  GstVaapiMPEG2GopFrame gop_frame;
+
+  if (frame) {
+    picture = GST_VAAPI_ENC_PICTURE_NEW (MPEG2, encoder, frame);
+    if (!picture) {
+      GST_WARNING ("create MPEG2 picture failed, frame timestamp:%"
+          GST_TIME_FORMAT, GST_TIME_ARGS (frame->pts));
+      return GST_VAAPI_ENCODER_STATUS_ERROR_ALLOCATION_FAILED;
     }
-    if (!encoder->dump_frames) {
-      return GST_VAAPI_ENCODER_STATUS_NO_SURFACE;
-    }
-    picture = g_queue_pop_head (&encoder->b_frames);
-    g_assert (picture);
-    goto end;
+    gst_vaapi_utils_mpeg2_gop_push (&encoder->gop, picture,
+        GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME (frame));
   }
 
-  picture = GST_VAAPI_ENC_PICTURE_NEW (MPEG2, encoder, frame);
-  if (!picture) {
-    GST_WARNING ("create MPEG2 picture failed, frame timestamp:%"
-        GST_TIME_FORMAT, GST_TIME_ARGS (frame->pts));
-    return GST_VAAPI_ENCODER_STATUS_ERROR_ALLOCATION_FAILED;
-  }
+  if (!gst_vaapi_utils_mpeg2_gop_pop (&encoder->gop, &gop_frame))
+    return GST_VAAPI_ENCODER_STATUS_NO_SURFACE;
 
-  if (encoder->frame_num >= base_encoder->keyframe_period) {
-    encoder->frame_num = 0;
-    clear_references (encoder);
-  }
-  if (encoder->frame_num == 0) {
-    picture->type = GST_VAAPI_PICTURE_TYPE_I;
-    GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
-    encoder->new_gop = TRUE;
-  } else {
-    encoder->new_gop = FALSE;
-    if ((encoder->frame_num % (encoder->ip_period + 1)) == 0 ||
-        encoder->frame_num == base_encoder->keyframe_period - 1) {
-      picture->type = GST_VAAPI_PICTURE_TYPE_P;
-      encoder->dump_frames = TRUE;
-    } else {
-      picture->type = GST_VAAPI_PICTURE_TYPE_B;
-      status = GST_VAAPI_ENCODER_STATUS_NO_SURFACE;
-    }
-  }
-  picture->frame_num = encoder->frame_num++;
+  picture = gop_frame.data;
+  picture->type = get_picture_type (gop_frame.type);
+  picture->frame_num = gop_frame.temporal_reference;
 
-  if (picture->type == GST_VAAPI_PICTURE_TYPE_B) {
-    g_queue_push_tail (&encoder->b_frames, picture);
-    picture = NULL;
+  encoder->new_gop = picture->type == GST_VAAPI_PICTURE_TYPE_I;
+  if (encoder->new_gop) {
+    encoder->new_gop_closed = gop_frame.closed_gop;
+    GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (picture->frame);
   }
 
-end:
   *output = picture;
-  return status;
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
 }
 
 static GstVaapiEncoderStatus
@@ -673,6 +670,7 @@ set_context_info (GstVaapiEncoder * base_encoder)
     return GST_VAAPI_ENCODER_STATUS_ERROR_UNSUPPORTED_PROFILE;
 
   base_encoder->num_ref_frames = 2;
+  base_encoder->num_reorder_frames = encoder->ip_period;
 
   /* Only YUV 4:2:0 formats are supported for now. This means that we
      have a limit of 4608 bits per macroblock. */
@@ -705,6 +703,10 @@ gst_vaapi_encoder_mpeg2_reconfigure (GstVaapiEncoder * base_encoder)
     encoder->ip_period = base_encoder->keyframe_period - 1;
   }
 
+  encoder->gop.gop_size = base_encoder->keyframe_period;
+  encoder->gop.num_bframes = encoder->ip_period;
+  encoder->gop.closed_gop = encoder->closed_gop;
+
   status = ensure_profile_and_level (encoder);
   if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
     return status;
@@ -717,14 +719,32 @@ error:
   return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
 }
 
+/* Applies the bitrate, framerate, quantizer or keyframe period changes
+   made while encoding. The sequence header is regenerated for the next
+   GOP, but the VA context and the reordering state are retained */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_mpeg2_update_parameters (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderMpeg2 *const encoder =
+      GST_VAAPI_ENCODER_MPEG2_CAST (base_encoder);
+
+  encoder->gop.gop_size = base_encoder->keyframe_period;
+
+  if (!ensure_bitrate (encoder) || !ensure_level (encoder))
+    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
 static gboolean
 gst_vaapi_encoder_mpeg2_init (GstVaapiEncoder * base_encoder)
 {
   GstVaapiEncoderMpeg2 *const encoder =
       GST_VAAPI_ENCODER_MPEG2_CAST (base_encoder);
 
+  encoder->closed_gop = TRUE;
+
   /* re-ordering */
-  g_queue_init (&encoder->b_frames);
+  gst_vaapi_utils_mpeg2_gop_init (&encoder->gop);
 
   return TRUE;
 }
@@ -765,15 +785,11 @@ gst_vaapi_encoder_mpeg2_finalize (GstVaapiEncoder * base_encoder)
   /* free private buffers */
   GstVaapiEncoderMpeg2 *const encoder =
       GST_VAAPI_ENCODER_MPEG2_CAST (base_encoder);
-  GstVaapiEncPicture *pic;
 
   clear_references (encoder);
 
-  while (!g_queue_is_empty (&encoder->b_frames)) {
-    pic = g_queue_pop_head (&encoder->b_frames);
-    gst_vaapi_enc_picture_unref (pic);
-  }
-  g_queue_clear (&encoder->b_frames);
+  gst_vaapi_utils_mpeg2_gop_clear (&encoder->gop,
+      (GDestroyNotify) gst_vaapi_mini_object_unref);
 }
 
 static GstVaapiEncoderStatus
@@ -790,6 +806,9 @@ gst_vaapi_encoder_mpeg2_set_property (GstVaapiEncoder * base_encoder,
     case GST_VAAPI_ENCODER_MPEG2_PROP_MAX_BFRAMES:
       encoder->ip_period = g_value_get_uint (value);
       break;
+    case GST_VAAPI_ENCODER_MPEG2_PROP_CLOSED_GOP:
+      encoder->closed_gop = g_value_get_boolean (value);
+      break;
     default:
       return GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER;
   }
@@ -803,6 +822,7 @@ gst_vaapi_encoder_mpeg2_class (void)
 {
   static const GstVaapiEncoderClass GstVaapiEncoderMpeg2Class = {
     GST_VAAPI_ENCODER_CLASS_INIT (Mpeg2, mpeg2),
+    .update_parameters = gst_vaapi_encoder_mpeg2_update_parameters,
     .set_property = gst_vaapi_encoder_mpeg2_set_property,
   };
   return &GstVaapiEncoderMpeg2Class;
@@ -848,7 +868,8 @@ gst_vaapi_encoder_mpeg2_get_default_properties (void)
       g_param_spec_uint ("quantizer",
           "Constant Quantizer",
           "Constant quantizer (if rate-control mode is CQP)",
-          2, 62, 8, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          2, 62, 8, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   GST_VAAPI_ENCODER_PROPERTIES_APPEND (props,
       GST_VAAPI_ENCODER_MPEG2_PROP_MAX_BFRAMES,
@@ -856,6 +877,12 @@ gst_vaapi_encoder_mpeg2_get_default_properties (void)
           "Number of B-frames between I and P",
           0, 16, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  GST_VAAPI_ENCODER_PROPERTIES_APPEND (props,
+      GST_VAAPI_ENCODER_MPEG2_PROP_CLOSED_GOP,
+      g_param_spec_boolean ("closed-gop", "Closed GOP",
+          "Disallow B-frames predicted from the previous GOP",
+          TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   return props;
 }
 
@@ -25,7 +25,7 @@
 #define GST_VAAPI_ENCODER_MPEG2_PRIV_H
 
 #include "gstvaapiencoder_priv.h"
-#include "gstvaapiutils_mpeg2.h"
+#include "gstvaapiutils_mpeg2_priv.h"
 
 G_BEGIN_DECLS
 
@@ -50,15 +50,16 @@ struct _GstVaapiEncoderMpeg2
   guint32 cqp; /* quantizer value for CQP mode */
   guint32 ip_period;
 
+  gboolean closed_gop;
+
   /* re-ordering */
-  GQueue b_frames;
-  gboolean dump_frames;
+  GstVaapiMPEG2Gop gop;
   gboolean new_gop;
+  gboolean new_gop_closed;
 
   /* reference list */
-  GstVaapiSurfaceProxy *forward;
-  GstVaapiSurfaceProxy *backward;
-  guint32 frame_num;            /* same value picture header, but it's not mod by 1024 */
+  GstVaapiSurfaceProxy *forward;        /* previous reference, in display order */
+  GstVaapiSurfaceProxy *backward;       /* most recent reference */
 };
 
 G_END_DECLS
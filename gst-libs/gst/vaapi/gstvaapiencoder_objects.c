@@ -107,6 +107,85 @@ gst_vaapi_enc_packed_header_set_data (GstVaapiEncPackedHeader * header,
   return TRUE;
 }
 
+/* ------------------------------------------------------------------------- */
+/* --- Encoder Quantization Matrix                                       --- */
+/* ------------------------------------------------------------------------- */
+
+GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiEncQMatrix, gst_vaapi_enc_q_matrix);
+
+void
+gst_vaapi_enc_q_matrix_destroy (GstVaapiEncQMatrix * q_matrix)
+{
+  vaapi_destroy_buffer (GET_VA_DISPLAY (q_matrix), &q_matrix->param_id);
+  q_matrix->param = NULL;
+}
+
+gboolean
+gst_vaapi_enc_q_matrix_create (GstVaapiEncQMatrix * q_matrix,
+    const GstVaapiCodecObjectConstructorArgs * args)
+{
+  gboolean success;
+
+  q_matrix->param_id = VA_INVALID_ID;
+  success = vaapi_create_buffer (GET_VA_DISPLAY (q_matrix),
+      GET_VA_CONTEXT (q_matrix), VAQMatrixBufferType,
+      args->param_size, args->param, &q_matrix->param_id, &q_matrix->param);
+  if (!success)
+    return FALSE;
+  return TRUE;
+}
+
+GstVaapiEncQMatrix *
+gst_vaapi_enc_q_matrix_new (GstVaapiEncoder * encoder,
+    gconstpointer param, guint param_size)
+{
+  GstVaapiCodecObject *object;
+
+  object = gst_vaapi_codec_object_new (&GstVaapiEncQMatrixClass,
+      GST_VAAPI_CODEC_BASE (encoder), param, param_size, NULL, 0, 0);
+  return GST_VAAPI_ENC_Q_MATRIX (object);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Encoder Huffman Table                                             --- */
+/* ------------------------------------------------------------------------- */
+
+GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiEncHuffmanTable,
+    gst_vaapi_enc_huffman_table);
+
+void
+gst_vaapi_enc_huffman_table_destroy (GstVaapiEncHuffmanTable * huf_table)
+{
+  vaapi_destroy_buffer (GET_VA_DISPLAY (huf_table), &huf_table->param_id);
+  huf_table->param = NULL;
+}
+
+gboolean
+gst_vaapi_enc_huffman_table_create (GstVaapiEncHuffmanTable * huf_table,
+    const GstVaapiCodecObjectConstructorArgs * args)
+{
+  gboolean success;
+
+  huf_table->param_id = VA_INVALID_ID;
+  success = vaapi_create_buffer (GET_VA_DISPLAY (huf_table),
+      GET_VA_CONTEXT (huf_table), VAHuffmanTableBufferType,
+      args->param_size, args->param, &huf_table->param_id, &huf_table->param);
+  if (!success)
+    return FALSE;
+  return TRUE;
+}
+
+GstVaapiEncHuffmanTable *
+gst_vaapi_enc_huffman_table_new (GstVaapiEncoder * encoder,
+    gconstpointer param, guint param_size)
+{
+  GstVaapiCodecObject *object;
+
+  object = gst_vaapi_codec_object_new (&GstVaapiEncHuffmanTableClass,
+      GST_VAAPI_CODEC_BASE (encoder), param, param_size, NULL, 0, 0);
+  return GST_VAAPI_ENC_HUFFMAN_TABLE (object);
+}
+
 /* ------------------------------------------------------------------------- */
 /* --- Encoder Sequence                                                  --- */
 /* ------------------------------------------------------------------------- */
@@ -271,6 +350,9 @@ gst_vaapi_enc_picture_destroy (GstVaapiEncPicture * picture)
     picture->slices = NULL;
   }
   gst_vaapi_codec_object_replace (&picture->sequence, NULL);
+  gst_vaapi_codec_object_replace (&picture->q_matrix, NULL);
+  gst_vaapi_codec_object_replace (&picture->huf_table, NULL);
+  gst_vaapi_surface_proxy_replace (&picture->reconstructed_proxy, NULL);
 
   gst_vaapi_surface_proxy_replace (&picture->proxy, NULL);
   picture->surface_id = VA_INVALID_ID;
@@ -361,6 +443,39 @@ gst_vaapi_enc_picture_set_sequence (GstVaapiEncPicture * picture,
   gst_vaapi_codec_object_replace (&picture->sequence, sequence);
 }
 
+void
+gst_vaapi_enc_picture_set_q_matrix (GstVaapiEncPicture * picture,
+    GstVaapiEncQMatrix * q_matrix)
+{
+  g_return_if_fail (picture != NULL);
+  g_return_if_fail (q_matrix != NULL);
+
+  gst_vaapi_codec_object_replace (&picture->q_matrix, q_matrix);
+}
+
+void
+gst_vaapi_enc_picture_set_huffman_table (GstVaapiEncPicture * picture,
+    GstVaapiEncHuffmanTable * huf_table)
+{
+  g_return_if_fail (picture != NULL);
+  g_return_if_fail (huf_table != NULL);
+
+  gst_vaapi_codec_object_replace (&picture->huf_table, huf_table);
+}
+
+/* Holds the reconstructed surface until the picture is released, i.e.
+   once the coded buffer was synced, for codecs that do not keep it as
+   a reference picture */
+void
+gst_vaapi_enc_picture_set_reconstructed_surface (GstVaapiEncPicture * picture,
+    GstVaapiSurfaceProxy * proxy)
+{
+  g_return_if_fail (picture != NULL);
+  g_return_if_fail (proxy != NULL);
+
+  gst_vaapi_surface_proxy_replace (&picture->reconstructed_proxy, proxy);
+}
+
 void
 gst_vaapi_enc_picture_add_packed_header (GstVaapiEncPicture * picture,
     GstVaapiEncPackedHeader * header)
@@ -422,6 +537,8 @@ gboolean
 gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture)
 {
   GstVaapiEncSequence *sequence;
+  GstVaapiEncQMatrix *q_matrix;
+  GstVaapiEncHuffmanTable *huf_table;
   VADisplay va_display;
   VAContextID va_context;
   VAStatus status;
@@ -467,6 +584,18 @@ gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture)
   if (!do_encode (va_display, va_context, &picture->param_id, &picture->param))
     return FALSE;
 
+  /* Submit Quantization matrix */
+  q_matrix = picture->q_matrix;
+  if (q_matrix && !do_encode (va_display, va_context,
+          &q_matrix->param_id, &q_matrix->param))
+    return FALSE;
+
+  /* Submit Huffman table */
+  huf_table = picture->huf_table;
+  if (huf_table && !do_encode (va_display, va_context,
+          &huf_table->param_id, &huf_table->param))
+    return FALSE;
+
   /* Submit Slice parameters */
   for (i = 0; i < picture->slices->len; i++) {
     GstVaapiEncSlice *const slice = g_ptr_array_index (picture->slices, i);
@@ -35,6 +35,8 @@ typedef struct _GstVaapiEncMiscParam GstVaapiEncMiscParam;
 typedef struct _GstVaapiEncSlice GstVaapiEncSlice;
 typedef struct _GstVaapiCodedBuffer GstVaapiCodedBuffer;
 typedef struct _GstVaapiEncPackedHeader GstVaapiEncPackedHeader;
+typedef struct _GstVaapiEncQMatrix GstVaapiEncQMatrix;
+typedef struct _GstVaapiEncHuffmanTable GstVaapiEncHuffmanTable;
 
 /* ------------------------------------------------------------------------- */
 /* --- Encoder Packed Header                                             --- */
@@ -71,6 +73,62 @@ gboolean
 gst_vaapi_enc_packed_header_set_data (GstVaapiEncPackedHeader * header,
     gconstpointer data, guint data_size);
 
+/* ------------------------------------------------------------------------- */
+/* --- Encoder Quantization Matrix                                       --- */
+/* ------------------------------------------------------------------------- */
+
+#define GST_VAAPI_ENC_Q_MATRIX(obj) \
+  ((GstVaapiEncQMatrix *) (obj))
+
+/**
+ * GstVaapiEncQMatrix:
+ *
+ * A #GstVaapiCodecObject holding a quantization matrix parameter for
+ * the encoder.
+ */
+struct _GstVaapiEncQMatrix
+{
+  /*< private >*/
+  GstVaapiCodecObject parent_instance;
+
+  /*< public >*/
+  VABufferID param_id;
+  gpointer param;
+};
+
+G_GNUC_INTERNAL
+GstVaapiEncQMatrix *
+gst_vaapi_enc_q_matrix_new (GstVaapiEncoder * encoder,
+    gconstpointer param, guint param_size);
+
+/* ------------------------------------------------------------------------- */
+/* --- Encoder Huffman Table                                             --- */
+/* ------------------------------------------------------------------------- */
+
+#define GST_VAAPI_ENC_HUFFMAN_TABLE(obj) \
+  ((GstVaapiEncHuffmanTable *) (obj))
+
+/**
+ * GstVaapiEncHuffmanTable:
+ *
+ * A #GstVaapiCodecObject holding a huffman table parameter for the
+ * encoder.
+ */
+struct _GstVaapiEncHuffmanTable
+{
+  /*< private >*/
+  GstVaapiCodecObject parent_instance;
+
+  /*< public >*/
+  VABufferID param_id;
+  gpointer param;
+};
+
+G_GNUC_INTERNAL
+GstVaapiEncHuffmanTable *
+gst_vaapi_enc_huffman_table_new (GstVaapiEncoder * encoder,
+    gconstpointer param, guint param_size);
+
 /* ------------------------------------------------------------------------- */
 /* --- Encoder Sequence                                                  --- */
 /* ------------------------------------------------------------------------- */
@@ -193,6 +251,9 @@ struct _GstVaapiEncPicture
 
   /* Additional data to pass down */
   GstVaapiEncSequence *sequence;
+  GstVaapiEncQMatrix *q_matrix;
+  GstVaapiEncHuffmanTable *huf_table;
+  GstVaapiSurfaceProxy *reconstructed_proxy;
   GPtrArray *packed_headers;
   GPtrArray *misc_params;
 
@@ -216,6 +277,21 @@ void
 gst_vaapi_enc_picture_set_sequence (GstVaapiEncPicture * picture,
     GstVaapiEncSequence * sequence);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_enc_picture_set_q_matrix (GstVaapiEncPicture * picture,
+    GstVaapiEncQMatrix * q_matrix);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_enc_picture_set_huffman_table (GstVaapiEncPicture * picture,
+    GstVaapiEncHuffmanTable * huf_table);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_enc_picture_set_reconstructed_surface (GstVaapiEncPicture * picture,
+    GstVaapiSurfaceProxy * proxy);
+
 G_GNUC_INTERNAL
 void
 gst_vaapi_enc_picture_add_packed_header (GstVaapiEncPicture * picture,
@@ -256,6 +332,16 @@ gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture);
   gst_vaapi_enc_sequence_new (GST_VAAPI_ENCODER_CAST (encoder),         \
       NULL, sizeof (G_PASTE (VAEncSequenceParameterBuffer, codec)))
 
+/* GstVaapiEncQMatrix */
+#define GST_VAAPI_ENC_Q_MATRIX_NEW(codec, encoder)                      \
+  gst_vaapi_enc_q_matrix_new (GST_VAAPI_ENCODER_CAST (encoder),         \
+      NULL, sizeof (G_PASTE (VAQMatrixBuffer, codec)))
+
+/* GstVaapiEncHuffmanTable */
+#define GST_VAAPI_ENC_HUFFMAN_TABLE_NEW(codec, encoder)                 \
+  gst_vaapi_enc_huffman_table_new (GST_VAAPI_ENCODER_CAST (encoder),    \
+      NULL, sizeof (G_PASTE (VAHuffmanTableBuffer, codec)))
+
 /* GstVaapiEncMiscParam */
 #define GST_VAAPI_ENC_MISC_PARAM_NEW(type, encoder)                     \
   gst_vaapi_enc_misc_param_new (GST_VAAPI_ENCODER_CAST (encoder),       \
@@ -212,6 +212,7 @@ struct _GstVaapiEncoder
   GstVideoInfo video_info;
   GstVaapiProfile profile;
   guint num_ref_frames;
+  guint num_reorder_frames;
   GstVaapiRateControl rate_control;
   guint32 rate_control_mask;
   guint bitrate; /* kbps */
@@ -224,6 +225,7 @@ struct _GstVaapiEncoder
   GstVaapiVideoPool *codedbuf_pool;
   GAsyncQueue *codedbuf_queue;
   guint32 num_codedbuf_queued;
+  gboolean params_changed;
 
   guint got_packed_headers:1;
   guint got_rate_control_mask:1;
@@ -280,6 +282,9 @@ struct _GstVaapiEncoderClass
 
   GstVaapiEncoderStatus (*reconfigure)  (GstVaapiEncoder * encoder);
 
+  /* update_parameters can be NULL, i.e. no change allowed while encoding */
+  GstVaapiEncoderStatus (*update_parameters) (GstVaapiEncoder * encoder);
+
   GPtrArray *           (*get_default_properties) (void);
   GstVaapiEncoderStatus (*set_property) (GstVaapiEncoder * encoder,
                                          gint prop_id,
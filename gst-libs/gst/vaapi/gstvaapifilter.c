@@ -1004,6 +1004,7 @@ gst_vaapi_filter_init(GstVaapiFilter *filter, GstVaapiDisplay *display)
         NULL, 0, &filter->va_context);
     if (!vaapi_check_status(va_status, "vaCreateContext() [VPP]"))
         return FALSE;
+    gst_vaapi_display_update_usage(display, 1, 0);
     return TRUE;
 }
 
@@ -1026,6 +1027,7 @@ gst_vaapi_filter_finalize(GstVaapiFilter *filter)
     if (filter->va_context != VA_INVALID_ID) {
         vaDestroyContext(filter->va_display, filter->va_context);
         filter->va_context = VA_INVALID_ID;
+        gst_vaapi_display_update_usage(filter->display, -1, 0);
     }
 
     if (filter->va_config != VA_INVALID_ID) {
@@ -1430,12 +1432,10 @@ gst_vaapi_filter_process_unlocked(GstVaapiFilter *filter,
     if (!vaapi_check_status(va_status, "vaEndPicture()"))
         goto error;
 
-    deint_refs_clear_all(filter);
     vaapi_destroy_buffer(filter->va_display, &pipeline_param_buf_id);
     return GST_VAAPI_FILTER_STATUS_SUCCESS;
 
 error:
-    deint_refs_clear_all(filter);
     vaapi_destroy_buffer(filter->va_display, &pipeline_param_buf_id);
     return GST_VAAPI_FILTER_STATUS_ERROR_OPERATION_FAILED;
 #endif
@@ -1459,6 +1459,59 @@ gst_vaapi_filter_process(GstVaapiFilter *filter, GstVaapiSurface *src_surface,
     status = gst_vaapi_filter_process_unlocked(filter,
         src_surface, dst_surface, flags);
     GST_VAAPI_DISPLAY_UNLOCK(filter->display);
+    deint_refs_clear_all(filter);
+    return status;
+}
+
+/**
+ * gst_vaapi_filter_process_multi:
+ * @filter: a #GstVaapiFilter
+ * @src_surface: the source @GstVaapiSurface
+ * @dst_surfaces: the array of destination #GstVaapiSurface objects
+ * @num_dst_surfaces: the number of elements in @dst_surfaces
+ * @flags: #GstVaapiSurfaceRenderFlags that apply to @src_surface
+ *
+ * Applies the operations currently defined in the @filter to
+ * @src_surface once for each surface in @dst_surfaces. This is
+ * typically used to generate several scaled versions of the same
+ * source surface, since the output size and format are determined by
+ * each destination surface. The processing jobs are submitted
+ * back-to-back, under a single display lock.
+ *
+ * All destination surfaces are produced with the same @filter state,
+ * i.e. with the same cropping and target rectangles, deinterlacing
+ * method and flags, and deinterlacing references. In particular, the
+ * target rectangle, if any, shall fit in every destination surface.
+ * Callers that need per-surface settings shall issue separate calls.
+ * As with gst_vaapi_filter_process(), the deinterlacing references
+ * are only valid for this call.
+ *
+ * Return value: a #GstVaapiFilterStatus
+ */
+GstVaapiFilterStatus
+gst_vaapi_filter_process_multi(GstVaapiFilter *filter,
+    GstVaapiSurface *src_surface, GstVaapiSurface **dst_surfaces,
+    guint num_dst_surfaces, guint flags)
+{
+    GstVaapiFilterStatus status = GST_VAAPI_FILTER_STATUS_SUCCESS;
+    guint i;
+
+    g_return_val_if_fail(filter != NULL,
+        GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail(src_surface != NULL,
+        GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail(dst_surfaces != NULL || num_dst_surfaces == 0,
+        GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+
+    GST_VAAPI_DISPLAY_LOCK(filter->display);
+    for (i = 0; i < num_dst_surfaces; i++) {
+        status = gst_vaapi_filter_process_unlocked(filter,
+            src_surface, dst_surfaces[i], flags);
+        if (status != GST_VAAPI_FILTER_STATUS_SUCCESS)
+            break;
+    }
+    GST_VAAPI_DISPLAY_UNLOCK(filter->display);
+    deint_refs_clear_all(filter);
     return status;
 }
 
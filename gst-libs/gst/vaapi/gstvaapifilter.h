@@ -171,6 +171,11 @@ GstVaapiFilterStatus
 gst_vaapi_filter_process(GstVaapiFilter *filter, GstVaapiSurface *src_surface,
     GstVaapiSurface *dst_surface, guint flags);
 
+GstVaapiFilterStatus
+gst_vaapi_filter_process_multi(GstVaapiFilter *filter,
+    GstVaapiSurface *src_surface, GstVaapiSurface **dst_surfaces,
+    guint num_dst_surfaces, guint flags);
+
 GArray *
 gst_vaapi_filter_get_formats(GstVaapiFilter *filter);
 
@@ -66,6 +66,8 @@ static const GstVaapiCodecMap gst_vaapi_codecs[] = {
     { GST_VAAPI_CODEC_VC1,      "vc1"   },
     { GST_VAAPI_CODEC_JPEG,     "jpeg"  },
     { GST_VAAPI_CODEC_VP8,      "vp8"   },
+    { GST_VAAPI_CODEC_VP9,      "vp9"   },
+    { GST_VAAPI_CODEC_H265,     "h265"  },
     { 0, }
 };
 
@@ -137,6 +139,20 @@ static const GstVaapiProfileMap gst_vaapi_profiles[] = {
 #if VA_CHECK_VERSION(0,35,0)
     {GST_VAAPI_PROFILE_VP8, VAProfileVP8Version0_3,
       "video/x-vp8", "Version0_3"},
+#endif
+#if VA_CHECK_VERSION(0,37,0)
+    { GST_VAAPI_PROFILE_H265_MAIN, VAProfileHEVCMain,
+      "video/x-h265", "main"
+    },
+    /* VA has no dedicated profile, Main Still Picture streams are
+       Main profile streams (A.3.4) */
+    { GST_VAAPI_PROFILE_H265_MAIN_STILL_PICTURE, VAProfileHEVCMain,
+      "video/x-h265", "main-still-picture"
+    },
+#endif
+#if VA_CHECK_VERSION(0,38,0)
+    {GST_VAAPI_PROFILE_VP9, VAProfileVP9Profile0,
+      "video/x-vp9", "profile0"},
 #endif
     { 0, }
 };
@@ -148,6 +164,9 @@ static const GstVaapiEntrypointMap gst_vaapi_entrypoints[] = {
     { GST_VAAPI_ENTRYPOINT_MOCO,         VAEntrypointMoComp     },
 #if VA_CHECK_VERSION(0,30,0)
     { GST_VAAPI_ENTRYPOINT_SLICE_ENCODE, VAEntrypointEncSlice   },
+#endif
+#if VA_CHECK_VERSION(0,35,0)
+    { GST_VAAPI_ENTRYPOINT_PICTURE_ENCODE, VAEntrypointEncPicture },
 #endif
     { 0, }
 };
@@ -290,6 +309,26 @@ gst_vaapi_profile_from_codec_data_h264(GstBuffer *buffer)
     return 0;
 }
 
+static GstVaapiProfile
+gst_vaapi_profile_from_codec_data_h265(GstBuffer *buffer)
+{
+    /* ISO/IEC 14496-15:  HEVC file format */
+    guchar buf[3];
+
+    if (gst_buffer_extract(buffer, 0, buf, sizeof(buf)) != sizeof(buf))
+        return 0;
+
+    if (buf[0] != 1)    /* configurationVersion = 1 */
+        return 0;
+
+    switch (buf[1] & 0x1f) {    /* HEVCProfileIndication */
+    case 1:     return GST_VAAPI_PROFILE_H265_MAIN;
+    case 2:     return GST_VAAPI_PROFILE_H265_MAIN10;
+    case 3:     return GST_VAAPI_PROFILE_H265_MAIN_STILL_PICTURE;
+    }
+    return 0;
+}
+
 static GstVaapiProfile
 gst_vaapi_profile_from_codec_data(GstVaapiCodec codec, GstBuffer *buffer)
 {
@@ -302,6 +341,9 @@ gst_vaapi_profile_from_codec_data(GstVaapiCodec codec, GstBuffer *buffer)
     case GST_VAAPI_CODEC_H264:
         profile = gst_vaapi_profile_from_codec_data_h264(buffer);
         break;
+    case GST_VAAPI_CODEC_H265:
+        profile = gst_vaapi_profile_from_codec_data_h265(buffer);
+        break;
     default:
         profile = 0;
         break;
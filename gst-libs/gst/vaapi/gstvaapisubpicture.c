@@ -32,8 +32,11 @@
 #include "gstvaapicompat.h"
 #include "gstvaapiutils.h"
 #include "gstvaapisubpicture.h"
+#include "gstvaapisubpicture_priv.h"
 #include "gstvaapiobject_priv.h"
 #include "gstvaapiimage_priv.h"
+#include "gstvaapidisplay_priv.h"
+#include "gstvaapisubpicturecache.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -52,6 +55,7 @@ struct _GstVaapiSubpicture {
     GstVaapiImage      *image;
     guint               flags;
     gfloat              global_alpha;
+    GstVaapiSubpictureCache *cache;
 };
 
 /**
@@ -75,6 +79,13 @@ gst_vaapi_subpicture_destroy(GstVaapiSubpicture *subpicture)
     GST_DEBUG("subpicture %" GST_VAAPI_ID_FORMAT,
               GST_VAAPI_ID_ARGS(subpicture_id));
 
+    /* The pixels no longer match once the subpicture is released or
+       bound to another image */
+    if (subpicture->cache) {
+        gst_vaapi_subpicture_cache_remove(subpicture->cache, subpicture);
+        subpicture->cache = NULL;
+    }
+
     if (subpicture_id != VA_INVALID_ID) {
         if (display) {
             GST_VAAPI_DISPLAY_LOCK(display);
@@ -164,40 +175,69 @@ error:
     return NULL;
 }
 
-/**
- * gst_vaapi_subpicture_new_from_overlay_rectangle:
- * @display: a #GstVaapiDisplay
- * @rect: a #GstVideoOverlayRectangle
- *
- * Helper function that creates a new #GstVaapiSubpicture from a
- * #GstVideoOverlayRectangle. A new #GstVaapiImage is also created
- * along the way and attached to the resulting subpicture. The
- * subpicture holds a unique reference to the underlying image.
- *
- * Return value: the newly allocated #GstVaapiSubpicture object
- */
-GstVaapiSubpicture *
-gst_vaapi_subpicture_new_from_overlay_rectangle(
-    GstVaapiDisplay          *display,
-    GstVideoOverlayRectangle *rect
-)
+/* Uploads the overlay pixels to a new subpicture, and makes it available
+   to further overlay rectangles with the same pixels. The global alpha
+   value is set beforehand, since shared subpictures are never changed */
+static GstVaapiSubpicture *
+subpicture_new_from_pixels(GstVaapiDisplay *display, GstVideoFormat format,
+    guint flags, guint8 *data, guint width, guint height, guint stride,
+    gfloat global_alpha, GstVaapiSubpictureCache *cache, guint32 hash)
 {
     GstVaapiSubpicture *subpicture;
-    GstVideoFormat format;
     GstVaapiImage *image;
     GstVaapiImageRaw raw_image;
+
+    image = gst_vaapi_image_new(display, format, width, height);
+    if (!image)
+        return NULL;
+
+    raw_image.format     = format;
+    raw_image.width      = width;
+    raw_image.height     = height;
+    raw_image.num_planes = 1;
+    raw_image.pixels[0]  = data;
+    raw_image.stride[0]  = stride;
+    if (!gst_vaapi_image_update_from_raw(image, &raw_image, NULL)) {
+        GST_WARNING("could not update VA image with subtitle data");
+        gst_vaapi_object_unref(image);
+        return NULL;
+    }
+
+    subpicture = gst_vaapi_subpicture_new(image, flags);
+    gst_vaapi_object_unref(image);
+    if (!subpicture)
+        return NULL;
+
+    if ((flags & GST_VAAPI_SUBPICTURE_FLAG_GLOBAL_ALPHA) &&
+        !gst_vaapi_subpicture_set_global_alpha(subpicture, global_alpha)) {
+        gst_vaapi_object_unref(subpicture);
+        return NULL;
+    }
+
+    if (cache && gst_vaapi_subpicture_cache_add(cache, subpicture, hash,
+            data, width, height, stride, flags))
+        subpicture->cache = cache;
+    return subpicture;
+}
+
+static GstVaapiSubpicture *
+subpicture_new_from_overlay_rectangle(GstVaapiDisplay *display,
+    GstVideoOverlayRectangle *rect, gboolean shared)
+{
+    GstVaapiSubpicture *subpicture = NULL, *new_subpicture;
+    GstVaapiSubpictureCache *cache;
+    GstVideoFormat format;
     GstBuffer *buffer;
     guint8 *data;
     gfloat global_alpha;
     guint width, height, stride;
     guint hw_flags, flags;
+    guint32 hash = 0;
 #if GST_CHECK_VERSION(1,0,0)
     GstVideoMeta *vmeta;
     GstMapInfo map_info;
 #endif
 
-    g_return_val_if_fail(GST_IS_VIDEO_OVERLAY_RECTANGLE(rect), NULL);
-
     /* XXX: use gst_vaapi_image_format_from_video() */
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
     format = GST_VIDEO_FORMAT_BGRA;
@@ -209,6 +249,8 @@ gst_vaapi_subpicture_new_from_overlay_rectangle(
     
     flags = hw_flags & from_GstVideoOverlayFormatFlags(
         gst_video_overlay_rectangle_get_flags(rect));
+    global_alpha = (flags & GST_VAAPI_SUBPICTURE_FLAG_GLOBAL_ALPHA) ?
+        gst_video_overlay_rectangle_get_global_alpha(rect) : 1.0f;
 
 #if GST_CHECK_VERSION(1,0,0)
     buffer = gst_video_overlay_rectangle_get_pixels_unscaled_argb(rect,
@@ -233,36 +275,81 @@ gst_vaapi_subpicture_new_from_overlay_rectangle(
     data = GST_BUFFER_DATA(buffer);
 #endif
 
-    image = gst_vaapi_image_new(display, format, width, height);
-    if (!image)
-        return NULL;
-
-    raw_image.format     = format;
-    raw_image.width      = width;
-    raw_image.height     = height;
-    raw_image.num_planes = 1;
-    raw_image.pixels[0]  = data;
-    raw_image.stride[0]  = stride;
-    if (!gst_vaapi_image_update_from_raw(image, &raw_image, NULL)) {
-        GST_WARNING("could not update VA image with subtitle data");
-        gst_vaapi_object_unref(image);
-        return NULL;
-    }
-
-    subpicture = gst_vaapi_subpicture_new(image, flags);
-    gst_vaapi_object_unref(image);
+    cache = shared ? gst_vaapi_display_get_subpicture_cache(display) : NULL;
+    if (cache)
+        subpicture = gst_vaapi_subpicture_cache_lookup(cache, data,
+            width, height, stride, flags, &hash);
+    if (subpicture)
+        GST_DEBUG("reuse subpicture %" GST_VAAPI_ID_FORMAT,
+                  GST_VAAPI_ID_ARGS(GST_VAAPI_OBJECT_ID(subpicture)));
+    else
+        subpicture = subpicture_new_from_pixels(display, format, flags,
+            data, width, height, stride, global_alpha, cache, hash);
 #if GST_CHECK_VERSION(1,0,0)
     gst_video_meta_unmap(vmeta, 0, &map_info);
 #endif
-    if (!subpicture)
-        return NULL;
+    if (!subpicture || !(flags & GST_VAAPI_SUBPICTURE_FLAG_GLOBAL_ALPHA))
+        return subpicture;
 
-    if (flags & GST_VAAPI_SUBPICTURE_FLAG_GLOBAL_ALPHA) {
-        global_alpha = gst_video_overlay_rectangle_get_global_alpha(rect);
-        if (!gst_vaapi_subpicture_set_global_alpha(subpicture, global_alpha))
-            return NULL;
-    }
-    return subpicture;
+    new_subpicture = gst_vaapi_subpicture_ensure_global_alpha(subpicture,
+        global_alpha);
+    gst_vaapi_object_unref(subpicture);
+    return new_subpicture;
+}
+
+/**
+ * gst_vaapi_subpicture_new_from_overlay_rectangle:
+ * @display: a #GstVaapiDisplay
+ * @rect: a #GstVideoOverlayRectangle
+ *
+ * Helper function that creates a new #GstVaapiSubpicture from a
+ * #GstVideoOverlayRectangle. A new #GstVaapiImage is also created
+ * along the way and attached to the resulting subpicture. The
+ * subpicture holds a unique reference to the underlying image.
+ *
+ * Overlay rectangles with the same pixels share the same subpicture
+ * across all contexts and surfaces of the underlying VA display, as
+ * long as it is alive. In that case, the pixels are not uploaded again.
+ * Should the global alpha value of @rect differ, the resulting
+ * subpicture is another one bound to the same image. Since the
+ * subpicture may be shared, its global alpha value shall not be changed.
+ *
+ * Return value: the newly allocated #GstVaapiSubpicture object
+ */
+GstVaapiSubpicture *
+gst_vaapi_subpicture_new_from_overlay_rectangle(
+    GstVaapiDisplay          *display,
+    GstVideoOverlayRectangle *rect
+)
+{
+    g_return_val_if_fail(GST_IS_VIDEO_OVERLAY_RECTANGLE(rect), NULL);
+
+    return subpicture_new_from_overlay_rectangle(display, rect, TRUE);
+}
+
+/**
+ * gst_vaapi_subpicture_new_from_overlay_rectangle_unshared:
+ * @display: a #GstVaapiDisplay
+ * @rect: a #GstVideoOverlayRectangle
+ *
+ * Creates a new #GstVaapiSubpicture from a #GstVideoOverlayRectangle,
+ * like gst_vaapi_subpicture_new_from_overlay_rectangle() does, but the
+ * resulting subpicture is never shared with other overlay rectangles.
+ * This is needed for overlay rectangles with identical pixels within
+ * the same composition, since a subpicture is associated to a single
+ * rectangle per surface. This is an internal function.
+ *
+ * Return value: the newly allocated #GstVaapiSubpicture object
+ */
+GstVaapiSubpicture *
+gst_vaapi_subpicture_new_from_overlay_rectangle_unshared(
+    GstVaapiDisplay          *display,
+    GstVideoOverlayRectangle *rect
+)
+{
+    g_return_val_if_fail(GST_IS_VIDEO_OVERLAY_RECTANGLE(rect), NULL);
+
+    return subpicture_new_from_overlay_rectangle(display, rect, FALSE);
 }
 
 /**
@@ -391,3 +478,45 @@ gst_vaapi_subpicture_set_global_alpha(GstVaapiSubpicture *subpicture,
     subpicture->global_alpha = global_alpha;
     return TRUE;
 }
+
+/**
+ * gst_vaapi_subpicture_ensure_global_alpha:
+ * @subpicture: a #GstVaapiSubpicture
+ * @global_alpha: value for global-alpha (range: 0.0 to 1.0, inclusive)
+ *
+ * Returns a subpicture with the same pixels as @subpicture, and
+ * @global_alpha as global alpha value. Subpictures that may be shared
+ * with other overlay rectangles are never changed: another subpicture
+ * bound to the same image is created instead, so that the pixels are
+ * not uploaded again. This is an internal function.
+ *
+ * Return value: a new reference to @subpicture, or to the newly
+ *   allocated #GstVaapiSubpicture object, or %NULL on error
+ */
+GstVaapiSubpicture *
+gst_vaapi_subpicture_ensure_global_alpha(GstVaapiSubpicture *subpicture,
+    gfloat global_alpha)
+{
+    GstVaapiSubpicture *new_subpicture;
+
+    g_return_val_if_fail(subpicture != NULL, NULL);
+
+    if (subpicture->global_alpha == global_alpha)
+        return gst_vaapi_object_ref(subpicture);
+
+    if (!subpicture->cache) {
+        if (!gst_vaapi_subpicture_set_global_alpha(subpicture, global_alpha))
+            return NULL;
+        return gst_vaapi_object_ref(subpicture);
+    }
+
+    new_subpicture = gst_vaapi_subpicture_new(subpicture->image,
+        subpicture->flags);
+    if (!new_subpicture)
+        return NULL;
+    if (!gst_vaapi_subpicture_set_global_alpha(new_subpicture, global_alpha)) {
+        gst_vaapi_object_unref(new_subpicture);
+        return NULL;
+    }
+    return new_subpicture;
+}
@@ -0,0 +1,405 @@
+/*
+ *  gstvaapisubpicturecache.c - VA subpicture cache
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include <string.h>
+#include "gstvaapisubpicturecache.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/* Subpicture pixels are always 32-bit ARGB or BGRA */
+#define PIXEL_SIZE 4
+
+typedef struct _CacheEntry CacheEntry;
+struct _CacheEntry
+{
+  GstVaapiSubpicture *subpicture;
+  guint32 hash;
+  guint width;
+  guint height;
+  guint flags;
+  guint8 *pixels;
+};
+
+/* Subpictures are looked up by a hash of their source pixels. Entries
+ * with the same hash are chained, and the pixels are compared in full
+ * before a subpicture is handed out. The cache does not hold any
+ * reference to the subpictures, since they hold a reference to the
+ * display owning the cache: a subpicture removes itself from the cache
+ * when it is destroyed */
+struct _GstVaapiSubpictureCache
+{
+  GstVaapiMiniObject parent_instance;
+  GMutex mutex;
+  GHashTable *entries;
+  GHashTable *subpictures;
+  guint num_hits;
+  guint num_misses;
+  guint64 uploaded_bytes;
+  guint64 saved_bytes;
+};
+
+static guint32
+hash_pixels (const guint8 * pixels, guint width, guint height, guint stride,
+    guint flags)
+{
+  guint32 hash = 2166136261U, value;
+  guint x, y;
+
+  hash = (hash ^ width) * 16777619U;
+  hash = (hash ^ height) * 16777619U;
+  hash = (hash ^ flags) * 16777619U;
+  for (y = 0; y < height; y++) {
+    const guint8 *const row = pixels + y * stride;
+    for (x = 0; x < width; x++) {
+      memcpy (&value, row + x * PIXEL_SIZE, PIXEL_SIZE);
+      hash = (hash ^ value) * 16777619U;
+    }
+  }
+  return hash;
+}
+
+static gboolean
+cache_entry_match (const CacheEntry * entry, const guint8 * pixels,
+    guint width, guint height, guint stride, guint flags)
+{
+  const guint row_size = width * PIXEL_SIZE;
+  guint y;
+
+  if (entry->width != width || entry->height != height ||
+      entry->flags != flags)
+    return FALSE;
+
+  for (y = 0; y < height; y++) {
+    if (memcmp (entry->pixels + y * row_size, pixels + y * stride,
+            row_size) != 0)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static CacheEntry *
+cache_entry_new (GstVaapiSubpicture * subpicture, guint32 hash,
+    const guint8 * pixels, guint width, guint height, guint stride,
+    guint flags)
+{
+  const guint row_size = width * PIXEL_SIZE;
+  CacheEntry *entry;
+  guint y;
+
+  entry = g_slice_new (CacheEntry);
+  if (!entry)
+    return NULL;
+
+  entry->pixels = g_try_malloc (row_size * height);
+  if (!entry->pixels) {
+    g_slice_free (CacheEntry, entry);
+    return NULL;
+  }
+  for (y = 0; y < height; y++)
+    memcpy (entry->pixels + y * row_size, pixels + y * stride, row_size);
+
+  entry->subpicture = subpicture;
+  entry->hash = hash;
+  entry->width = width;
+  entry->height = height;
+  entry->flags = flags;
+  return entry;
+}
+
+static void
+cache_entry_free (CacheEntry * entry)
+{
+  g_free (entry->pixels);
+  g_slice_free (CacheEntry, entry);
+}
+
+/* Acquires a reference to the subpicture, unless it is being destroyed
+   concurrently, i.e. it is waiting for the cache lock to be removed */
+static gboolean
+subpicture_try_ref (GstVaapiSubpicture * subpicture)
+{
+  GstVaapiMiniObject *const object = GST_VAAPI_MINI_OBJECT (subpicture);
+  gint ref_count;
+
+  do {
+    ref_count = g_atomic_int_get (&object->ref_count);
+    if (ref_count == 0)
+      return FALSE;
+  } while (!g_atomic_int_compare_and_exchange (&object->ref_count,
+          ref_count, ref_count + 1));
+  return TRUE;
+}
+
+static void
+gst_vaapi_subpicture_cache_finalize (GstVaapiSubpictureCache * cache)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_hash_table_iter_init (&iter, cache->subpictures);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    cache_entry_free (value);
+  g_hash_table_unref (cache->subpictures);
+  g_hash_table_unref (cache->entries);
+  g_mutex_clear (&cache->mutex);
+}
+
+static const GstVaapiMiniObjectClass *
+gst_vaapi_subpicture_cache_class (void)
+{
+  static const GstVaapiMiniObjectClass GstVaapiSubpictureCacheClass = {
+    .size = sizeof (GstVaapiSubpictureCache),
+    .finalize = (GDestroyNotify) gst_vaapi_subpicture_cache_finalize
+  };
+  return &GstVaapiSubpictureCacheClass;
+}
+
+/**
+ * gst_vaapi_subpicture_cache_new:
+ *
+ * Creates a new cache of live subpictures, indexed by the contents of
+ * their source pixels.
+ *
+ * Return value: the newly created #GstVaapiSubpictureCache object
+ */
+GstVaapiSubpictureCache *
+gst_vaapi_subpicture_cache_new (void)
+{
+  GstVaapiSubpictureCache *cache;
+
+  cache = (GstVaapiSubpictureCache *)
+      gst_vaapi_mini_object_new0 (gst_vaapi_subpicture_cache_class ());
+  if (!cache)
+    return NULL;
+
+  g_mutex_init (&cache->mutex);
+  cache->entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) g_list_free);
+  cache->subpictures = g_hash_table_new (g_direct_hash, g_direct_equal);
+  return cache;
+}
+
+/**
+ * gst_vaapi_subpicture_cache_lookup:
+ * @cache: the #GstVaapiSubpictureCache
+ * @pixels: the source pixels, in ARGB or BGRA format
+ * @width: the width of the source pixels
+ * @height: the height of the source pixels
+ * @stride: the number of bytes between two rows of @pixels
+ * @flags: the #GstVaapiSubpictureFlags of the subpicture
+ * @hash_ptr: return location for the hash of @pixels
+ *
+ * Looks up a live subpicture with the same @flags and the same source
+ * pixels as @pixels. The global alpha value is not considered, and
+ * shall be set by the caller. The hash of @pixels is returned in
+ * @hash_ptr, so that it could be used for gst_vaapi_subpicture_cache_add()
+ * on a cache miss.
+ *
+ * Return value: a new reference to the matching subpicture, or %NULL
+ */
+GstVaapiSubpicture *
+gst_vaapi_subpicture_cache_lookup (GstVaapiSubpictureCache * cache,
+    const guint8 * pixels, guint width, guint height, guint stride,
+    guint flags, guint32 * hash_ptr)
+{
+  GstVaapiSubpicture *subpicture = NULL;
+  guint32 hash;
+  GList *l;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (pixels != NULL, NULL);
+
+  hash = hash_pixels (pixels, width, height, stride, flags);
+  if (hash_ptr)
+    *hash_ptr = hash;
+
+  g_mutex_lock (&cache->mutex);
+  l = g_hash_table_lookup (cache->entries, GUINT_TO_POINTER (hash));
+  for (; l != NULL; l = l->next) {
+    CacheEntry *const entry = l->data;
+    if (cache_entry_match (entry, pixels, width, height, stride, flags) &&
+        subpicture_try_ref (entry->subpicture)) {
+      subpicture = entry->subpicture;
+      break;
+    }
+  }
+  if (subpicture) {
+    cache->num_hits++;
+    cache->saved_bytes += (guint64) width * height * PIXEL_SIZE;
+  } else
+    cache->num_misses++;
+  g_mutex_unlock (&cache->mutex);
+  return subpicture;
+}
+
+/**
+ * gst_vaapi_subpicture_cache_add:
+ * @cache: the #GstVaapiSubpictureCache
+ * @subpicture: the newly uploaded #GstVaapiSubpicture
+ * @hash: the hash of @pixels, as returned by the previous lookup
+ * @pixels: the source pixels of @subpicture
+ * @width: the width of the source pixels
+ * @height: the height of the source pixels
+ * @stride: the number of bytes between two rows of @pixels
+ * @flags: the #GstVaapiSubpictureFlags of @subpicture
+ *
+ * Makes @subpicture available to gst_vaapi_subpicture_cache_lookup()
+ * until gst_vaapi_subpicture_cache_remove() is called, which shall
+ * happen before @subpicture is destroyed. A copy of @pixels is kept to
+ * resolve hash collisions.
+ *
+ * Return value: %TRUE if @subpicture was added to the @cache
+ */
+gboolean
+gst_vaapi_subpicture_cache_add (GstVaapiSubpictureCache * cache,
+    GstVaapiSubpicture * subpicture, guint32 hash, const guint8 * pixels,
+    guint width, guint height, guint stride, guint flags)
+{
+  CacheEntry *entry;
+  GList *entries;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+  g_return_val_if_fail (subpicture != NULL, FALSE);
+  g_return_val_if_fail (pixels != NULL, FALSE);
+
+  entry = cache_entry_new (subpicture, hash, pixels, width, height, stride,
+      flags);
+  if (!entry)
+    goto error_allocate_entry;
+
+  g_mutex_lock (&cache->mutex);
+  if (g_hash_table_lookup (cache->subpictures, subpicture))
+    goto error_duplicate_entry;
+  g_hash_table_insert (cache->subpictures, subpicture, entry);
+
+  entries = g_hash_table_lookup (cache->entries, GUINT_TO_POINTER (hash));
+  g_hash_table_steal (cache->entries, GUINT_TO_POINTER (hash));
+  g_hash_table_insert (cache->entries, GUINT_TO_POINTER (hash),
+      g_list_prepend (entries, entry));
+  cache->uploaded_bytes += (guint64) width * height * PIXEL_SIZE;
+  g_mutex_unlock (&cache->mutex);
+  return TRUE;
+
+  /* ERRORS */
+error_allocate_entry:
+  {
+    GST_ERROR ("failed to allocate subpicture cache entry");
+    return FALSE;
+  }
+error_duplicate_entry:
+  {
+    GST_ERROR ("subpicture %p is already in the cache", subpicture);
+    g_mutex_unlock (&cache->mutex);
+    cache_entry_free (entry);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_vaapi_subpicture_cache_remove:
+ * @cache: the #GstVaapiSubpictureCache
+ * @subpicture: a #GstVaapiSubpicture
+ *
+ * Removes @subpicture from the @cache, if it was added to it.
+ */
+void
+gst_vaapi_subpicture_cache_remove (GstVaapiSubpictureCache * cache,
+    GstVaapiSubpicture * subpicture)
+{
+  CacheEntry *entry;
+  GList *entries;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (subpicture != NULL);
+
+  g_mutex_lock (&cache->mutex);
+  entry = g_hash_table_lookup (cache->subpictures, subpicture);
+  if (entry) {
+    g_hash_table_remove (cache->subpictures, subpicture);
+
+    entries = g_hash_table_lookup (cache->entries,
+        GUINT_TO_POINTER (entry->hash));
+    g_hash_table_steal (cache->entries, GUINT_TO_POINTER (entry->hash));
+    entries = g_list_remove (entries, entry);
+    if (entries)
+      g_hash_table_insert (cache->entries, GUINT_TO_POINTER (entry->hash),
+          entries);
+  }
+  g_mutex_unlock (&cache->mutex);
+
+  if (entry)
+    cache_entry_free (entry);
+}
+
+/**
+ * gst_vaapi_subpicture_cache_get_size:
+ * @cache: the #GstVaapiSubpictureCache
+ *
+ * Returns the number of subpictures currently available in the @cache.
+ *
+ * Return value: the number of cached subpictures
+ */
+guint
+gst_vaapi_subpicture_cache_get_size (GstVaapiSubpictureCache * cache)
+{
+  guint size;
+
+  g_return_val_if_fail (cache != NULL, 0);
+
+  g_mutex_lock (&cache->mutex);
+  size = g_hash_table_size (cache->subpictures);
+  g_mutex_unlock (&cache->mutex);
+  return size;
+}
+
+/**
+ * gst_vaapi_subpicture_cache_get_stats:
+ * @cache: the #GstVaapiSubpictureCache
+ * @num_hits_ptr: return location for the number of reused subpictures
+ * @num_misses_ptr: return location for the number of failed lookups
+ * @uploaded_bytes_ptr: return location for the number of bytes uploaded
+ *   to subpictures added to the @cache
+ * @saved_bytes_ptr: return location for the number of bytes that did
+ *   not need to be uploaded thanks to the @cache
+ *
+ * Retrieves the @cache statistics. Any of the return locations may be
+ * %NULL.
+ */
+void
+gst_vaapi_subpicture_cache_get_stats (GstVaapiSubpictureCache * cache,
+    guint * num_hits_ptr, guint * num_misses_ptr, guint64 * uploaded_bytes_ptr,
+    guint64 * saved_bytes_ptr)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->mutex);
+  if (num_hits_ptr)
+    *num_hits_ptr = cache->num_hits;
+  if (num_misses_ptr)
+    *num_misses_ptr = cache->num_misses;
+  if (uploaded_bytes_ptr)
+    *uploaded_bytes_ptr = cache->uploaded_bytes;
+  if (saved_bytes_ptr)
+    *saved_bytes_ptr = cache->saved_bytes;
+  g_mutex_unlock (&cache->mutex);
+}
@@ -0,0 +1,72 @@
+/*
+ *  gstvaapisubpicturecache.h - VA subpicture cache
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GSTVAAPISUBPICTURECACHE_H
+#define GSTVAAPISUBPICTURECACHE_H
+
+#include "libgstvaapi_priv_check.h"
+#include <gst/vaapi/gstvaapitypes.h>
+#include <gst/vaapi/gstvaapisubpicture.h>
+#include "gstvaapiminiobject.h"
+
+typedef struct _GstVaapiSubpictureCache         GstVaapiSubpictureCache;
+
+G_GNUC_INTERNAL
+GstVaapiSubpictureCache *
+gst_vaapi_subpicture_cache_new (void);
+
+#define gst_vaapi_subpicture_cache_ref(cache) \
+    ((GstVaapiSubpictureCache *) gst_vaapi_mini_object_ref ( \
+        GST_VAAPI_MINI_OBJECT (cache)))
+#define gst_vaapi_subpicture_cache_unref(cache) \
+    gst_vaapi_mini_object_unref (GST_VAAPI_MINI_OBJECT (cache))
+#define gst_vaapi_subpicture_cache_replace(old_cache_ptr, new_cache) \
+    gst_vaapi_mini_object_replace ((GstVaapiMiniObject **) (old_cache_ptr), \
+        GST_VAAPI_MINI_OBJECT (new_cache))
+
+G_GNUC_INTERNAL
+GstVaapiSubpicture *
+gst_vaapi_subpicture_cache_lookup (GstVaapiSubpictureCache * cache,
+    const guint8 * pixels, guint width, guint height, guint stride,
+    guint flags, guint32 * hash_ptr);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_subpicture_cache_add (GstVaapiSubpictureCache * cache,
+    GstVaapiSubpicture * subpicture, guint32 hash, const guint8 * pixels,
+    guint width, guint height, guint stride, guint flags);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_subpicture_cache_remove (GstVaapiSubpictureCache * cache,
+    GstVaapiSubpicture * subpicture);
+
+G_GNUC_INTERNAL
+guint
+gst_vaapi_subpicture_cache_get_size (GstVaapiSubpictureCache * cache);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_subpicture_cache_get_stats (GstVaapiSubpictureCache * cache,
+    guint * num_hits_ptr, guint * num_misses_ptr, guint64 * uploaded_bytes_ptr,
+    guint64 * saved_bytes_ptr);
+
+#endif /* GSTVAAPISUBPICTURECACHE_H */
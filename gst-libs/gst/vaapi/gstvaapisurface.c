@@ -35,6 +35,8 @@
 #include "gstvaapicontext.h"
 #include "gstvaapiimage.h"
 #include "gstvaapiimage_priv.h"
+#include "gstvaapisubpicture_priv.h"
+#include "gstvaapibufferproxy_priv.h"
 #include "gstvaapicontext_overlay.h"
 
 #define DEBUG 1
@@ -84,8 +86,13 @@ gst_vaapi_surface_destroy(GstVaapiSurface *surface)
 
     gst_vaapi_surface_destroy_subpictures(surface);
     gst_vaapi_surface_set_parent_context(surface, NULL);
+    gst_vaapi_buffer_proxy_replace(&surface->extbuf_proxy, NULL);
   
-    if (surface_id != VA_INVALID_SURFACE) {
+    if (surface_id != VA_INVALID_SURFACE && surface->recyclable &&
+        gst_vaapi_display_put_cached_surface(display, surface_id,
+            surface->chroma_type, surface->width, surface->height))
+        GST_VAAPI_OBJECT_ID(surface) = VA_INVALID_SURFACE;
+    else if (surface_id != VA_INVALID_SURFACE) {
         GST_VAAPI_DISPLAY_LOCK(display);
         status = vaDestroySurfaces(
             GST_VAAPI_DISPLAY_VADISPLAY(display),
@@ -96,6 +103,7 @@ gst_vaapi_surface_destroy(GstVaapiSurface *surface)
             g_warning("failed to destroy surface %" GST_VAAPI_ID_FORMAT,
                       GST_VAAPI_ID_ARGS(surface_id));
         GST_VAAPI_OBJECT_ID(surface) = VA_INVALID_SURFACE;
+        gst_vaapi_display_update_usage(display, 0, -1);
     }
 }
 
@@ -129,6 +137,7 @@ gst_vaapi_surface_create(GstVaapiSurface *surface,
 
     GST_DEBUG("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS(surface_id));
     GST_VAAPI_OBJECT_ID(surface) = surface_id;
+    gst_vaapi_display_update_usage(display, 0, 1);
     return TRUE;
 
     /* ERRORS */
@@ -184,6 +193,90 @@ gst_vaapi_surface_create_with_format(GstVaapiSurface *surface,
 
     GST_DEBUG("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS(surface_id));
     GST_VAAPI_OBJECT_ID(surface) = surface_id;
+    gst_vaapi_display_update_usage(display, 0, 1);
+    return TRUE;
+
+    /* ERRORS */
+error_unsupported_format:
+    GST_ERROR("unsupported format %s", gst_vaapi_video_format_to_string(format));
+    return FALSE;
+#else
+    return FALSE;
+#endif
+}
+
+static gboolean
+gst_vaapi_surface_create_from_buffer(GstVaapiSurface *surface,
+    guint mem_type, guintptr handle, gsize size, const GstVideoInfo *vip)
+{
+#if USE_DMABUF || USE_VA_USERPTR
+    GstVaapiDisplay * const display = GST_VAAPI_OBJECT_DISPLAY(surface);
+    const GstVideoFormat format = GST_VIDEO_INFO_FORMAT(vip);
+    VASurfaceID surface_id;
+    VAStatus status;
+    guint i, chroma_type, va_chroma_format;
+    const VAImageFormat *va_format;
+    VASurfaceAttribExternalBuffers extbuf;
+    VASurfaceAttrib attribs[2], *attrib;
+    unsigned long extbuf_handle;
+
+    va_format = gst_vaapi_video_format_to_va_format(format);
+    if (!va_format)
+        goto error_unsupported_format;
+
+    chroma_type = gst_vaapi_video_format_get_chroma_type(format);
+    if (!chroma_type)
+        goto error_unsupported_format;
+
+    va_chroma_format = from_GstVaapiChromaType(chroma_type);
+    if (!va_chroma_format)
+        goto error_unsupported_format;
+
+    extbuf_handle = handle;
+    memset(&extbuf, 0, sizeof(extbuf));
+    extbuf.pixel_format = va_format->fourcc;
+    extbuf.width = GST_VIDEO_INFO_WIDTH(vip);
+    extbuf.height = GST_VIDEO_INFO_HEIGHT(vip);
+    extbuf.data_size = size;
+    extbuf.num_planes = GST_VIDEO_INFO_N_PLANES(vip);
+    for (i = 0; i < extbuf.num_planes; i++) {
+        extbuf.pitches[i] = GST_VIDEO_INFO_PLANE_STRIDE(vip, i);
+        extbuf.offsets[i] = GST_VIDEO_INFO_PLANE_OFFSET(vip, i);
+    }
+    extbuf.buffers = &extbuf_handle;
+    extbuf.num_buffers = 1;
+
+    attrib = attribs;
+    attrib->flags = VA_SURFACE_ATTRIB_SETTABLE;
+    attrib->type = VASurfaceAttribMemoryType;
+    attrib->value.type = VAGenericValueTypeInteger;
+    attrib->value.value.i = mem_type;
+    attrib++;
+    attrib->flags = VA_SURFACE_ATTRIB_SETTABLE;
+    attrib->type = VASurfaceAttribExternalBufferDescriptor;
+    attrib->value.type = VAGenericValueTypePointer;
+    attrib->value.value.p = &extbuf;
+    attrib++;
+
+    GST_VAAPI_DISPLAY_LOCK(display);
+    status = vaCreateSurfaces(
+        GST_VAAPI_DISPLAY_VADISPLAY(display),
+        va_chroma_format, extbuf.width, extbuf.height,
+        &surface_id, 1,
+        attribs, attrib - attribs
+    );
+    GST_VAAPI_DISPLAY_UNLOCK(display);
+    if (!vaapi_check_status(status, "vaCreateSurfaces()"))
+        return FALSE;
+
+    surface->format = format;
+    surface->chroma_type = chroma_type;
+    surface->width = extbuf.width;
+    surface->height = extbuf.height;
+
+    GST_DEBUG("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS(surface_id));
+    GST_VAAPI_OBJECT_ID(surface) = surface_id;
+    gst_vaapi_display_update_usage(display, 0, 1);
     return TRUE;
 
     /* ERRORS */
@@ -195,6 +288,51 @@ error_unsupported_format:
 #endif
 }
 
+static gboolean
+gst_vaapi_surface_create_from_dma_buf(GstVaapiSurface *surface,
+    GstVaapiBufferProxy *proxy, const GstVideoInfo *vip)
+{
+#if USE_DMABUF
+    if (!gst_vaapi_surface_create_from_buffer(surface,
+            VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME,
+            GST_VAAPI_BUFFER_PROXY_HANDLE(proxy),
+            GST_VAAPI_BUFFER_PROXY_SIZE(proxy), vip))
+        return FALSE;
+    gst_vaapi_buffer_proxy_replace(&surface->extbuf_proxy, proxy);
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+static gboolean
+gst_vaapi_surface_create_from_user_ptr(GstVaapiSurface *surface,
+    gpointer data, const GstVideoInfo *vip)
+{
+#if USE_VA_USERPTR
+    guint i;
+
+    if (GPOINTER_TO_SIZE(data) % GST_VAAPI_SURFACE_USER_PTR_ALIGNMENT)
+        goto error_unaligned_data;
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES(vip); i++) {
+        if (GST_VIDEO_INFO_PLANE_STRIDE(vip, i) %
+            GST_VAAPI_SURFACE_USER_PTR_STRIDE_ALIGNMENT)
+            goto error_unaligned_data;
+    }
+    return gst_vaapi_surface_create_from_buffer(surface,
+        VA_SURFACE_ATTRIB_MEM_TYPE_USER_PTR, (guintptr)data,
+        GST_VIDEO_INFO_SIZE(vip), vip);
+
+    /* ERRORS */
+error_unaligned_data:
+    GST_DEBUG("user pointer %p does not meet the alignment constraints",
+              data);
+    return FALSE;
+#else
+    return FALSE;
+#endif
+}
+
 #define gst_vaapi_surface_finalize gst_vaapi_surface_destroy
 GST_VAAPI_OBJECT_DEFINE_CLASS(GstVaapiSurface, gst_vaapi_surface)
 
@@ -235,6 +373,57 @@ error:
     return NULL;
 }
 
+/**
+ * gst_vaapi_surface_new_recyclable:
+ * @display: a #GstVaapiDisplay
+ * @chroma_type: the surface chroma format
+ * @width: the requested surface width
+ * @height: the requested surface height
+ *
+ * Creates a new #GstVaapiSurface with the specified chroma format and
+ * dimensions, reusing a VA surface from the @display cache if one is
+ * available. The VA surface is returned to that cache, instead of
+ * being destroyed, once the last reference to the object is released.
+ * This is an internal function.
+ *
+ * Return value: the newly allocated #GstVaapiSurface object
+ */
+GstVaapiSurface *
+gst_vaapi_surface_new_recyclable(
+    GstVaapiDisplay    *display,
+    GstVaapiChromaType  chroma_type,
+    guint               width,
+    guint               height
+)
+{
+    GstVaapiSurface *surface;
+    GstVaapiID surface_id;
+
+    surface_id = gst_vaapi_display_get_cached_surface(display, chroma_type,
+        width, height);
+    if (surface_id == VA_INVALID_SURFACE)
+        surface = gst_vaapi_surface_new(display, chroma_type, width, height);
+    else {
+        GST_DEBUG("reuse surface %" GST_VAAPI_ID_FORMAT " (%ux%u)",
+                  GST_VAAPI_ID_ARGS(surface_id), width, height);
+
+        surface = gst_vaapi_object_new(gst_vaapi_surface_class(), display);
+        if (!surface) {
+            gst_vaapi_display_put_cached_surface(display, surface_id,
+                chroma_type, width, height);
+            return NULL;
+        }
+        surface->format = GST_VIDEO_FORMAT_UNKNOWN;
+        surface->chroma_type = chroma_type;
+        surface->width = width;
+        surface->height = height;
+        GST_VAAPI_OBJECT_ID(surface) = surface_id;
+    }
+    if (surface)
+        surface->recyclable = TRUE;
+    return surface;
+}
+
 /**
  * gst_vaapi_surface_new_with_format:
  * @display: a #GstVaapiDisplay
@@ -275,6 +464,108 @@ error:
     return NULL;
 }
 
+/**
+ * gst_vaapi_surface_new_with_dma_buf_handle:
+ * @display: a #GstVaapiDisplay
+ * @fd: the DMA-BUF file descriptor holding the pixels
+ * @vip: the #GstVideoInfo describing the format, size and plane layout
+ *   of the pixels within @fd, with GST_VIDEO_INFO_SIZE() being the
+ *   whole buffer size
+ *
+ * Creates a new #GstVaapiSurface that uses the supplied DMA-BUF buffer
+ * as its storage, e.g. a frame captured by a V4L2 device. No copy is
+ * involved. The @fd is duplicated: the caller keeps ownership of its
+ * descriptor, and the buffer stays referenced as long as the surface
+ * lives.
+ *
+ * Return value: the newly allocated #GstVaapiSurface object, or %NULL
+ *   if DMA-BUF import is not supported or failed
+ */
+GstVaapiSurface *
+gst_vaapi_surface_new_with_dma_buf_handle(
+    GstVaapiDisplay    *display,
+    gint                fd,
+    const GstVideoInfo *vip
+)
+{
+    GstVaapiBufferProxy *proxy;
+    GstVaapiSurface *surface;
+
+    g_return_val_if_fail(vip != NULL, NULL);
+
+    GST_DEBUG("size %ux%u, format %s, fd %d", GST_VIDEO_INFO_WIDTH(vip),
+              GST_VIDEO_INFO_HEIGHT(vip),
+              gst_vaapi_video_format_to_string(GST_VIDEO_INFO_FORMAT(vip)), fd);
+
+    proxy = gst_vaapi_buffer_proxy_new(fd, GST_VIDEO_INFO_SIZE(vip));
+    if (!proxy)
+        return NULL;
+
+    surface = gst_vaapi_object_new(gst_vaapi_surface_class(), display);
+    if (!surface)
+        goto error;
+
+    if (!gst_vaapi_surface_create_from_dma_buf(surface, proxy, vip))
+        goto error;
+    gst_vaapi_buffer_proxy_unref(proxy);
+    return surface;
+
+error:
+    gst_vaapi_object_replace(&surface, NULL);
+    gst_vaapi_buffer_proxy_unref(proxy);
+    return NULL;
+}
+
+/**
+ * gst_vaapi_surface_new_with_user_ptr:
+ * @display: a #GstVaapiDisplay
+ * @data: the system memory holding the pixels
+ * @vip: the #GstVideoInfo describing the format, size and plane layout
+ *   of the pixels within @data, with GST_VIDEO_INFO_SIZE() being the
+ *   whole buffer size
+ *
+ * Creates a new #GstVaapiSurface that uses the supplied system memory
+ * as its storage, so that the pixels are read by the hardware without
+ * any copy. @data shall be aligned on
+ * %GST_VAAPI_SURFACE_USER_PTR_ALIGNMENT bytes, and each plane stride
+ * shall be a multiple of %GST_VAAPI_SURFACE_USER_PTR_STRIDE_ALIGNMENT
+ * bytes. The caller keeps ownership of @data, which shall outlive the
+ * surface.
+ *
+ * Return value: the newly allocated #GstVaapiSurface object, or %NULL
+ *   if user pointers are not supported, or if @data is not suitably
+ *   aligned
+ */
+GstVaapiSurface *
+gst_vaapi_surface_new_with_user_ptr(
+    GstVaapiDisplay    *display,
+    gpointer            data,
+    const GstVideoInfo *vip
+)
+{
+    GstVaapiSurface *surface;
+
+    g_return_val_if_fail(data != NULL, NULL);
+    g_return_val_if_fail(vip != NULL, NULL);
+
+    GST_DEBUG("size %ux%u, format %s, data %p", GST_VIDEO_INFO_WIDTH(vip),
+              GST_VIDEO_INFO_HEIGHT(vip),
+              gst_vaapi_video_format_to_string(GST_VIDEO_INFO_FORMAT(vip)),
+              data);
+
+    surface = gst_vaapi_object_new(gst_vaapi_surface_class(), display);
+    if (!surface)
+        return NULL;
+
+    if (!gst_vaapi_surface_create_from_user_ptr(surface, data, vip))
+        goto error;
+    return surface;
+
+error:
+    gst_vaapi_object_unref(surface);
+    return NULL;
+}
+
 /**
  * gst_vaapi_surface_get_id:
  * @surface: a #GstVaapiSurface
@@ -481,6 +772,48 @@ gst_vaapi_surface_derive_image(GstVaapiSurface *surface)
     return gst_vaapi_image_new_with_image(display, &va_image);
 }
 
+/**
+ * gst_vaapi_surface_get_dma_buf_handle:
+ * @surface: a #GstVaapiSurface
+ *
+ * Exports the @surface storage as a DMA-BUF buffer, e.g. to hand it
+ * over to another DRM device or API without any copy. The pixels
+ * layout is the one of the image returned by
+ * gst_vaapi_surface_derive_image(). The export is cached, so that
+ * surfaces recycled through a pool are only exported once.
+ *
+ * Return value: (transfer full): a #GstVaapiBufferProxy holding the
+ *   DMA-BUF handle, or %NULL if DMA-BUF export is not supported or
+ *   failed
+ */
+GstVaapiBufferProxy *
+gst_vaapi_surface_get_dma_buf_handle(GstVaapiSurface *surface)
+{
+    GstVaapiBufferProxy *proxy;
+    GstVaapiImage *image;
+
+    g_return_val_if_fail(surface != NULL, NULL);
+
+    if (!surface->extbuf_proxy) {
+        image = gst_vaapi_surface_derive_image(surface);
+        if (!image)
+            goto error_derive_image;
+
+        proxy = gst_vaapi_buffer_proxy_new_from_object(GST_VAAPI_OBJECT(image),
+            image->internal_image.buf);
+        gst_vaapi_object_unref(image);
+        if (!proxy)
+            return NULL;
+        surface->extbuf_proxy = proxy;
+    }
+    return gst_vaapi_buffer_proxy_ref(surface->extbuf_proxy);
+
+    /* ERRORS */
+error_derive_image:
+    GST_ERROR("failed to extract image handle from surface");
+    return NULL;
+}
+
 /**
  * gst_vaapi_surface_get_image
  * @surface: a #GstVaapiSurface
@@ -830,6 +1163,18 @@ gst_vaapi_surface_query_status(
     return TRUE;
 }
 
+static gboolean
+has_subpicture(GPtrArray *subpictures, GstVaapiSubpicture *subpicture)
+{
+    guint i;
+
+    for (i = 0; i < subpictures->len; i++) {
+        if (g_ptr_array_index(subpictures, i) == subpicture)
+            return TRUE;
+    }
+    return FALSE;
+}
+
 /**
  * gst_vaapi_surface_set_subpictures_from_composition:
  * @surface: a #GstVaapiSurface
@@ -851,6 +1196,7 @@ gst_vaapi_surface_set_subpictures_from_composition(
 )
 {
     GstVaapiDisplay *display;
+    GPtrArray *subpictures;
     guint n, nb_rectangles;
 
     g_return_val_if_fail(surface != NULL, FALSE);
@@ -863,35 +1209,60 @@ gst_vaapi_surface_set_subpictures_from_composition(
     if (!display)
         return FALSE;
 
-    /* Clear current subpictures */
-    gst_vaapi_surface_destroy_subpictures(surface);
-
-    if (!composition)
+    if (!composition) {
+        gst_vaapi_surface_destroy_subpictures(surface);
         return TRUE;
+    }
 
     nb_rectangles = gst_video_overlay_composition_n_rectangles (composition);
 
-    /* Overlay all the rectangles cantained in the overlay composition */
+    /* Create the new subpictures before the current ones are released,
+       so that unchanged overlay rectangles reuse the same subpictures */
+    subpictures = g_ptr_array_new_with_free_func(
+        (GDestroyNotify)gst_vaapi_object_unref);
     for (n = 0; n < nb_rectangles; ++n) {
         GstVideoOverlayRectangle *rect;
-        GstVaapiRectangle sub_rect;
         GstVaapiSubpicture *subpicture;
 
         rect = gst_video_overlay_composition_get_rectangle (composition, n);
         subpicture = gst_vaapi_subpicture_new_from_overlay_rectangle (display,
                 rect);
 
+        /* A subpicture is associated to a single rectangle per surface */
+        if (subpicture && has_subpicture (subpictures, subpicture)) {
+            gst_vaapi_object_unref (subpicture);
+            subpicture =
+                gst_vaapi_subpicture_new_from_overlay_rectangle_unshared(
+                    display, rect);
+        }
+        if (!subpicture) {
+            GST_WARNING ("could not create subpicture for rectangle %p", rect);
+            g_ptr_array_unref (subpictures);
+            return FALSE;
+        }
+        g_ptr_array_add (subpictures, subpicture);
+    }
+
+    /* Clear current subpictures */
+    gst_vaapi_surface_destroy_subpictures(surface);
+
+    /* Overlay all the rectangles cantained in the overlay composition */
+    for (n = 0; n < nb_rectangles; ++n) {
+        GstVideoOverlayRectangle *rect;
+        GstVaapiRectangle sub_rect;
+
+        rect = gst_video_overlay_composition_get_rectangle (composition, n);
         gst_video_overlay_rectangle_get_render_rectangle (rect,
                 (gint *)&sub_rect.x, (gint *)&sub_rect.y,
                 &sub_rect.width, &sub_rect.height);
 
-        if (!gst_vaapi_surface_associate_subpicture (surface, subpicture,
-                    NULL, &sub_rect)) {
+        if (!gst_vaapi_surface_associate_subpicture (surface,
+                    g_ptr_array_index (subpictures, n), NULL, &sub_rect)) {
             GST_WARNING ("could not render overlay rectangle %p", rect);
-            gst_vaapi_object_unref (subpicture);
+            g_ptr_array_unref (subpictures);
             return FALSE;
         }
-        gst_vaapi_object_unref (subpicture);
     }
+    g_ptr_array_unref (subpictures);
     return TRUE;
 }
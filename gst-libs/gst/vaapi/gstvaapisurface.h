@@ -29,6 +29,7 @@
 #include <gst/vaapi/gstvaapidisplay.h>
 #include <gst/vaapi/gstvaapiimage.h>
 #include <gst/vaapi/gstvaapisubpicture.h>
+#include <gst/vaapi/gstvaapibufferproxy.h>
 #include <gst/video/video.h>
 #include <gst/video/video-overlay-composition.h>
 
@@ -54,6 +55,25 @@ G_BEGIN_DECLS
     "height = (int) [ 1, MAX ], "               \
     "framerate = (fraction) [ 0, MAX ]"
 
+/**
+ * GST_VAAPI_SURFACE_USER_PTR_ALIGNMENT:
+ *
+ * The alignment, in bytes, of system memory that is wrapped into a
+ * #GstVaapiSurface with gst_vaapi_surface_new_with_user_ptr(). This
+ * is the page size, as the memory is mapped into the GPU address
+ * space.
+ */
+#define GST_VAAPI_SURFACE_USER_PTR_ALIGNMENT            4096
+
+/**
+ * GST_VAAPI_SURFACE_USER_PTR_STRIDE_ALIGNMENT:
+ *
+ * The alignment, in bytes, of the plane strides of system memory that
+ * is wrapped into a #GstVaapiSurface with
+ * gst_vaapi_surface_new_with_user_ptr().
+ */
+#define GST_VAAPI_SURFACE_USER_PTR_STRIDE_ALIGNMENT     128
+
 /**
  * GstVaapiChromaType:
  * @GST_VAAPI_CHROMA_TYPE_YUV420: YUV 4:2:0 chroma format
@@ -160,6 +180,20 @@ gst_vaapi_surface_new_with_format(
     guint               height
 );
 
+GstVaapiSurface *
+gst_vaapi_surface_new_with_dma_buf_handle(
+    GstVaapiDisplay    *display,
+    gint                fd,
+    const GstVideoInfo *vip
+);
+
+GstVaapiSurface *
+gst_vaapi_surface_new_with_user_ptr(
+    GstVaapiDisplay    *display,
+    gpointer            data,
+    const GstVideoInfo *vip
+);
+
 GstVaapiID
 gst_vaapi_surface_get_id(GstVaapiSurface *surface);
 
@@ -191,6 +225,9 @@ gst_vaapi_surface_get_image(GstVaapiSurface *surface, GstVaapiImage *image);
 gboolean
 gst_vaapi_surface_put_image(GstVaapiSurface *surface, GstVaapiImage *image);
 
+GstVaapiBufferProxy *
+gst_vaapi_surface_get_dma_buf_handle(GstVaapiSurface *surface);
+
 gboolean
 gst_vaapi_surface_associate_subpicture(
     GstVaapiSurface         *surface,
@@ -44,6 +44,8 @@ struct _GstVaapiSurface {
     GstVaapiChromaType  chroma_type;
     GPtrArray          *subpictures;
     GstVaapiContext    *parent_context;
+    GstVaapiBufferProxy *extbuf_proxy;
+    guint               recyclable      : 1;
 };
 
 /**
@@ -104,6 +106,34 @@ struct _GstVaapiSurfaceClass {
 #define GST_VAAPI_SURFACE_HEIGHT(surface) \
     GST_VAAPI_SURFACE(surface)->height
 
+/* Returns the approximate amount of video memory used by a surface */
+static inline gsize
+gst_vaapi_surface_estimate_size(GstVaapiChromaType chroma_type,
+    guint width, guint height)
+{
+    guint bits_per_pixel;
+
+    switch (chroma_type) {
+    case GST_VAAPI_CHROMA_TYPE_YUV400:  bits_per_pixel =  8; break;
+    case GST_VAAPI_CHROMA_TYPE_YUV410:  bits_per_pixel =  9; break;
+    case GST_VAAPI_CHROMA_TYPE_YUV422:  bits_per_pixel = 16; break;
+    case GST_VAAPI_CHROMA_TYPE_YUV444:  bits_per_pixel = 24; break;
+    case GST_VAAPI_CHROMA_TYPE_RGB16:   bits_per_pixel = 16; break;
+    case GST_VAAPI_CHROMA_TYPE_RGB32:   bits_per_pixel = 32; break;
+    default:                            bits_per_pixel = 12; break;
+    }
+    return (gsize)width * height * bits_per_pixel / 8;
+}
+
+G_GNUC_INTERNAL
+GstVaapiSurface *
+gst_vaapi_surface_new_recyclable(
+    GstVaapiDisplay    *display,
+    GstVaapiChromaType  chroma_type,
+    guint               width,
+    guint               height
+);
+
 G_GNUC_INTERNAL
 void
 gst_vaapi_surface_set_parent_context(
@@ -0,0 +1,410 @@
+/*
+ *  gstvaapisurfacecache.c - VA surface cache
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapicompat.h"
+#include "gstvaapisurfacecache.h"
+#include "gstvaapisurface_priv.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+typedef struct _CacheBucket CacheBucket;
+struct _CacheBucket
+{
+  GstVaapiChromaType chroma_type;
+  guint width;
+  guint height;
+  gsize surface_size;
+  GQueue surfaces;
+  GList link;
+};
+
+/* Free VA surfaces are grouped into buckets of the same chroma type and
+ * resolution. Buckets are kept in least recently used order, most
+ * recent first, so that evictions hit the resolutions that were not
+ * used for the longest time. Only VA surface ids are stored: surface
+ * objects would hold a reference to the display owning the cache */
+struct _GstVaapiSurfaceCache
+{
+  GstVaapiMiniObject parent_instance;
+  GMutex mutex;
+  GQueue buckets;
+  GHashTable *bucket_map;
+  guint size;
+  gsize bytes;
+  gsize max_bytes;
+  GstVaapiSurfaceCacheDestroyFunc destroy_func;
+  gpointer destroy_data;
+};
+
+static guint
+cache_bucket_hash (gconstpointer key)
+{
+  const CacheBucket *const bucket = key;
+
+  return (bucket->width << 16) ^ bucket->height ^ (bucket->chroma_type << 28);
+}
+
+static gboolean
+cache_bucket_equal (gconstpointer a, gconstpointer b)
+{
+  const CacheBucket *const bucket_a = a;
+  const CacheBucket *const bucket_b = b;
+
+  return bucket_a->chroma_type == bucket_b->chroma_type &&
+      bucket_a->width == bucket_b->width &&
+      bucket_a->height == bucket_b->height;
+}
+
+static CacheBucket *
+cache_bucket_new (GstVaapiChromaType chroma_type, guint width, guint height)
+{
+  CacheBucket *bucket;
+
+  bucket = g_slice_new (CacheBucket);
+  if (!bucket)
+    return NULL;
+
+  bucket->chroma_type = chroma_type;
+  bucket->width = width;
+  bucket->height = height;
+  bucket->surface_size =
+      gst_vaapi_surface_estimate_size (chroma_type, width, height);
+  g_queue_init (&bucket->surfaces);
+  bucket->link.data = bucket;
+  bucket->link.prev = NULL;
+  bucket->link.next = NULL;
+  return bucket;
+}
+
+static void
+cache_bucket_free (CacheBucket * bucket)
+{
+  g_queue_clear (&bucket->surfaces);
+  g_slice_free (CacheBucket, bucket);
+}
+
+static void
+cache_remove_bucket (GstVaapiSurfaceCache * cache, CacheBucket * bucket)
+{
+  g_queue_unlink (&cache->buckets, &bucket->link);
+  g_hash_table_remove (cache->bucket_map, bucket);
+  cache_bucket_free (bucket);
+}
+
+static inline void
+cache_touch_bucket (GstVaapiSurfaceCache * cache, CacheBucket * bucket)
+{
+  g_queue_unlink (&cache->buckets, &bucket->link);
+  g_queue_push_head_link (&cache->buckets, &bucket->link);
+}
+
+static inline CacheBucket *
+cache_lookup_bucket (GstVaapiSurfaceCache * cache,
+    GstVaapiChromaType chroma_type, guint width, guint height)
+{
+  CacheBucket key;
+
+  key.chroma_type = chroma_type;
+  key.width = width;
+  key.height = height;
+  return g_hash_table_lookup (cache->bucket_map, &key);
+}
+
+/* Drops the oldest surface of the least recently used resolution.
+   Called with the cache mutex held */
+static GstVaapiID
+cache_evict_surface (GstVaapiSurfaceCache * cache)
+{
+  CacheBucket *bucket;
+  GstVaapiID surface_id;
+
+  bucket = g_queue_peek_tail (&cache->buckets);
+  if (!bucket)
+    return VA_INVALID_SURFACE;
+
+  surface_id = GPOINTER_TO_UINT (g_queue_pop_tail (&bucket->surfaces));
+  cache->size--;
+  cache->bytes -= bucket->surface_size;
+  if (g_queue_is_empty (&bucket->surfaces))
+    cache_remove_bucket (cache, bucket);
+  return surface_id;
+}
+
+static void
+cache_destroy_surfaces (GstVaapiSurfaceCache * cache, GQueue * surfaces)
+{
+  GstVaapiID surface_id;
+
+  while (!g_queue_is_empty (surfaces)) {
+    surface_id = GPOINTER_TO_UINT (g_queue_pop_head (surfaces));
+    GST_DEBUG ("destroy cached surface %" GST_VAAPI_ID_FORMAT,
+        GST_VAAPI_ID_ARGS (surface_id));
+    if (cache->destroy_func)
+      cache->destroy_func (surface_id, cache->destroy_data);
+  }
+}
+
+static void
+gst_vaapi_surface_cache_finalize (GstVaapiSurfaceCache * cache)
+{
+  gst_vaapi_surface_cache_clear (cache);
+  g_hash_table_unref (cache->bucket_map);
+  g_mutex_clear (&cache->mutex);
+}
+
+static const GstVaapiMiniObjectClass *
+gst_vaapi_surface_cache_class (void)
+{
+  static const GstVaapiMiniObjectClass GstVaapiSurfaceCacheClass = {
+    .size = sizeof (GstVaapiSurfaceCache),
+    .finalize = (GDestroyNotify) gst_vaapi_surface_cache_finalize
+  };
+  return &GstVaapiSurfaceCacheClass;
+}
+
+/**
+ * gst_vaapi_surface_cache_new:
+ * @max_bytes: the maximum amount of video memory to keep, in bytes
+ * @destroy_func: the function to call to destroy evicted surfaces
+ * @user_data: the user data to pass to @destroy_func
+ *
+ * Creates a new cache of free VA surfaces of any resolution, holding
+ * up to @max_bytes of video memory, as estimated from the surface
+ * sizes. If @max_bytes is zero, then surfaces are never cached.
+ *
+ * Return value: the newly created #GstVaapiSurfaceCache object
+ */
+GstVaapiSurfaceCache *
+gst_vaapi_surface_cache_new (gsize max_bytes,
+    GstVaapiSurfaceCacheDestroyFunc destroy_func, gpointer user_data)
+{
+  GstVaapiSurfaceCache *cache;
+
+  cache = (GstVaapiSurfaceCache *)
+      gst_vaapi_mini_object_new0 (gst_vaapi_surface_cache_class ());
+  if (!cache)
+    return NULL;
+
+  g_mutex_init (&cache->mutex);
+  g_queue_init (&cache->buckets);
+  cache->bucket_map = g_hash_table_new (cache_bucket_hash, cache_bucket_equal);
+  cache->max_bytes = max_bytes;
+  cache->destroy_func = destroy_func;
+  cache->destroy_data = user_data;
+  return cache;
+}
+
+/**
+ * gst_vaapi_surface_cache_put:
+ * @cache: the #GstVaapiSurfaceCache
+ * @surface_id: the free VA surface
+ * @chroma_type: the chroma type of the surface
+ * @width: the surface width, in pixels
+ * @height: the surface height, in pixels
+ *
+ * Moves the ownership of the VA surface @surface_id to the @cache. If
+ * the @cache is full, the oldest surfaces of the least recently used
+ * resolutions are destroyed to make room for it. Surfaces larger than
+ * the whole @cache are never cached.
+ *
+ * Return value: %TRUE if the @cache took ownership of the surface,
+ *   %FALSE if the caller has to destroy it
+ */
+gboolean
+gst_vaapi_surface_cache_put (GstVaapiSurfaceCache * cache,
+    GstVaapiID surface_id, GstVaapiChromaType chroma_type, guint width,
+    guint height)
+{
+  CacheBucket *bucket;
+  GQueue evicted = G_QUEUE_INIT;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+  g_return_val_if_fail (surface_id != VA_INVALID_SURFACE, FALSE);
+
+  if (gst_vaapi_surface_estimate_size (chroma_type, width, height) >
+      cache->max_bytes)
+    return FALSE;
+
+  g_mutex_lock (&cache->mutex);
+  bucket = cache_lookup_bucket (cache, chroma_type, width, height);
+  if (!bucket) {
+    bucket = cache_bucket_new (chroma_type, width, height);
+    if (!bucket)
+      goto error_allocate_bucket;
+    g_hash_table_insert (cache->bucket_map, bucket, bucket);
+    g_queue_push_head_link (&cache->buckets, &bucket->link);
+  }
+  else
+    cache_touch_bucket (cache, bucket);
+
+  /* Most recently released surfaces are handed out first, since they
+     are more likely to still be warm in the driver caches */
+  g_queue_push_head (&bucket->surfaces, GUINT_TO_POINTER (surface_id));
+  cache->size++;
+  cache->bytes += bucket->surface_size;
+
+  while (cache->bytes > cache->max_bytes)
+    g_queue_push_tail (&evicted, GUINT_TO_POINTER (cache_evict_surface (cache)));
+  g_mutex_unlock (&cache->mutex);
+
+  cache_destroy_surfaces (cache, &evicted);
+  return TRUE;
+
+  /* ERRORS */
+error_allocate_bucket:
+  {
+    GST_ERROR ("failed to allocate surface cache entry");
+    g_mutex_unlock (&cache->mutex);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_vaapi_surface_cache_get:
+ * @cache: the #GstVaapiSurfaceCache
+ * @chroma_type: the requested chroma type
+ * @width: the requested width, in pixels
+ * @height: the requested height, in pixels
+ *
+ * Removes a free VA surface matching @chroma_type, @width and @height
+ * from the @cache. The caller takes ownership of the returned surface.
+ *
+ * Return value: the VA surface, or %VA_INVALID_SURFACE if the @cache
+ *   holds no such surface
+ */
+GstVaapiID
+gst_vaapi_surface_cache_get (GstVaapiSurfaceCache * cache,
+    GstVaapiChromaType chroma_type, guint width, guint height)
+{
+  CacheBucket *bucket;
+  GstVaapiID surface_id = VA_INVALID_SURFACE;
+
+  g_return_val_if_fail (cache != NULL, VA_INVALID_SURFACE);
+
+  g_mutex_lock (&cache->mutex);
+  bucket = cache_lookup_bucket (cache, chroma_type, width, height);
+  if (bucket) {
+    surface_id = GPOINTER_TO_UINT (g_queue_pop_head (&bucket->surfaces));
+    cache->size--;
+    cache->bytes -= bucket->surface_size;
+    if (g_queue_is_empty (&bucket->surfaces))
+      cache_remove_bucket (cache, bucket);
+    else
+      cache_touch_bucket (cache, bucket);
+  }
+  g_mutex_unlock (&cache->mutex);
+  return surface_id;
+}
+
+/**
+ * gst_vaapi_surface_cache_get_size:
+ * @cache: the #GstVaapiSurfaceCache
+ *
+ * Returns the number of surfaces currently held in the @cache.
+ *
+ * Return value: the number of cached surfaces
+ */
+guint
+gst_vaapi_surface_cache_get_size (GstVaapiSurfaceCache * cache)
+{
+  guint size;
+
+  g_return_val_if_fail (cache != NULL, 0);
+
+  g_mutex_lock (&cache->mutex);
+  size = cache->size;
+  g_mutex_unlock (&cache->mutex);
+  return size;
+}
+
+/**
+ * gst_vaapi_surface_cache_clear:
+ * @cache: the #GstVaapiSurfaceCache
+ *
+ * Destroys all surfaces held in the @cache.
+ */
+void
+gst_vaapi_surface_cache_clear (GstVaapiSurfaceCache * cache)
+{
+  GQueue evicted = G_QUEUE_INIT;
+
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->mutex);
+  while (cache->size > 0)
+    g_queue_push_tail (&evicted, GUINT_TO_POINTER (cache_evict_surface (cache)));
+  g_mutex_unlock (&cache->mutex);
+
+  cache_destroy_surfaces (cache, &evicted);
+}
+
+/**
+ * gst_vaapi_surface_cache_get_bytes:
+ * @cache: the #GstVaapiSurfaceCache
+ *
+ * Returns the approximate amount of video memory held by the surfaces
+ * in the @cache.
+ *
+ * Return value: the size of cached surfaces, in bytes
+ */
+gsize
+gst_vaapi_surface_cache_get_bytes (GstVaapiSurfaceCache * cache)
+{
+  gsize bytes;
+
+  g_return_val_if_fail (cache != NULL, 0);
+
+  g_mutex_lock (&cache->mutex);
+  bytes = cache->bytes;
+  g_mutex_unlock (&cache->mutex);
+  return bytes;
+}
+
+/**
+ * gst_vaapi_surface_cache_trim:
+ * @cache: the #GstVaapiSurfaceCache
+ * @max_bytes: the number of bytes to release
+ *
+ * Destroys surfaces from the least recently used resolutions until at
+ * least @max_bytes are released, or the @cache is empty.
+ *
+ * Return value: the number of bytes actually released
+ */
+gsize
+gst_vaapi_surface_cache_trim (GstVaapiSurfaceCache * cache, gsize max_bytes)
+{
+  GQueue evicted = G_QUEUE_INIT;
+  gsize bytes;
+
+  g_return_val_if_fail (cache != NULL, 0);
+
+  g_mutex_lock (&cache->mutex);
+  bytes = cache->bytes;
+  while (cache->size > 0 && bytes - cache->bytes < max_bytes)
+    g_queue_push_tail (&evicted, GUINT_TO_POINTER (cache_evict_surface (cache)));
+  bytes -= cache->bytes;
+  g_mutex_unlock (&cache->mutex);
+
+  cache_destroy_surfaces (cache, &evicted);
+  return bytes;
+}
@@ -0,0 +1,83 @@
+/*
+ *  gstvaapisurfacecache.h - VA surface cache
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GSTVAAPISURFACECACHE_H
+#define GSTVAAPISURFACECACHE_H
+
+#include "libgstvaapi_priv_check.h"
+#include <gst/vaapi/gstvaapitypes.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include "gstvaapiminiobject.h"
+
+typedef struct _GstVaapiSurfaceCache            GstVaapiSurfaceCache;
+
+/**
+ * GstVaapiSurfaceCacheDestroyFunc:
+ * @surface_id: the VA surface to destroy
+ * @user_data: the user data passed to gst_vaapi_surface_cache_new()
+ *
+ * Destroys a VA surface that is evicted from the cache.
+ */
+typedef void (*GstVaapiSurfaceCacheDestroyFunc) (GstVaapiID surface_id,
+    gpointer user_data);
+
+G_GNUC_INTERNAL
+GstVaapiSurfaceCache *
+gst_vaapi_surface_cache_new (gsize max_bytes,
+    GstVaapiSurfaceCacheDestroyFunc destroy_func, gpointer user_data);
+
+#define gst_vaapi_surface_cache_ref(cache) \
+    ((GstVaapiSurfaceCache *) gst_vaapi_mini_object_ref ( \
+        GST_VAAPI_MINI_OBJECT (cache)))
+#define gst_vaapi_surface_cache_unref(cache) \
+    gst_vaapi_mini_object_unref (GST_VAAPI_MINI_OBJECT (cache))
+#define gst_vaapi_surface_cache_replace(old_cache_ptr, new_cache) \
+    gst_vaapi_mini_object_replace ((GstVaapiMiniObject **) (old_cache_ptr), \
+        GST_VAAPI_MINI_OBJECT (new_cache))
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_surface_cache_put (GstVaapiSurfaceCache * cache,
+    GstVaapiID surface_id, GstVaapiChromaType chroma_type, guint width,
+    guint height);
+
+G_GNUC_INTERNAL
+GstVaapiID
+gst_vaapi_surface_cache_get (GstVaapiSurfaceCache * cache,
+    GstVaapiChromaType chroma_type, guint width, guint height);
+
+G_GNUC_INTERNAL
+guint
+gst_vaapi_surface_cache_get_size (GstVaapiSurfaceCache * cache);
+
+G_GNUC_INTERNAL
+gsize
+gst_vaapi_surface_cache_get_bytes (GstVaapiSurfaceCache * cache);
+
+G_GNUC_INTERNAL
+gsize
+gst_vaapi_surface_cache_trim (GstVaapiSurfaceCache * cache, gsize max_bytes);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_surface_cache_clear (GstVaapiSurfaceCache * cache);
+
+#endif /* GSTVAAPISURFACECACHE_H */
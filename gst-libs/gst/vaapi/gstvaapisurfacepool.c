@@ -30,6 +30,7 @@
 #include "sysdeps.h"
 #include "gstvaapisurfacepool.h"
 #include "gstvaapivideopool_priv.h"
+#include "gstvaapisurface_priv.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -65,6 +66,10 @@ surface_pool_init(GstVaapiSurfacePool *pool, const GstVideoInfo *vip)
         pool->chroma_type = gst_vaapi_video_format_get_chroma_type(pool->format);
     if (!pool->chroma_type)
         return FALSE;
+
+    gst_vaapi_video_pool_set_object_size(GST_VAAPI_VIDEO_POOL(pool),
+        gst_vaapi_surface_estimate_size(pool->chroma_type,
+            pool->width, pool->height));
     return TRUE;
 }
 
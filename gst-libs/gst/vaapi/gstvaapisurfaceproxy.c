@@ -62,6 +62,40 @@ gst_vaapi_surface_proxy_class(void)
     return &GstVaapiSurfaceProxyClass;
 }
 
+/**
+ * gst_vaapi_surface_proxy_new:
+ * @surface: a #GstVaapiSurface
+ *
+ * Creates a new surface proxy object wrapping the supplied @surface,
+ * e.g. a surface that was not allocated from a pool. A reference to
+ * the @surface is held until the last reference to the proxy object
+ * is released.
+ *
+ * Returns: The same newly allocated @proxy object, or %NULL on error
+ */
+GstVaapiSurfaceProxy *
+gst_vaapi_surface_proxy_new(GstVaapiSurface *surface)
+{
+    GstVaapiSurfaceProxy *proxy;
+
+    g_return_val_if_fail(surface != NULL, NULL);
+
+    proxy = (GstVaapiSurfaceProxy *)
+        gst_vaapi_mini_object_new(gst_vaapi_surface_proxy_class());
+    if (!proxy)
+        return NULL;
+
+    proxy->parent = NULL;
+    proxy->destroy_func = NULL;
+    proxy->pool = NULL;
+    proxy->surface = gst_vaapi_object_ref(surface);
+    proxy->view_id = 0;
+    proxy->timestamp = GST_CLOCK_TIME_NONE;
+    proxy->duration = GST_CLOCK_TIME_NONE;
+    proxy->has_crop_rect = FALSE;
+    return proxy;
+}
+
 /**
  * gst_vaapi_surface_proxy_new_from_pool:
  * @pool: a #GstVaapiSurfacePool
@@ -87,12 +87,22 @@ vaapi_unmap_buffer (VADisplay dpy, VABufferID buf_id, gpointer * pbuf)
 gboolean
 vaapi_create_buffer (VADisplay dpy, VAContextID ctx, int type, guint size,
     gconstpointer buf, VABufferID * buf_id_ptr, gpointer * mapped_data)
+{
+  return vaapi_create_n_elements_buffer (dpy, ctx, type, size, buf,
+      buf_id_ptr, mapped_data, 1);
+}
+
+/* Creates and maps VA buffer holding num_elements elements of size bytes */
+gboolean
+vaapi_create_n_elements_buffer (VADisplay dpy, VAContextID ctx, int type,
+    guint size, gconstpointer buf, VABufferID * buf_id_ptr,
+    gpointer * mapped_data, guint num_elements)
 {
   VABufferID buf_id;
   VAStatus status;
   gpointer data = (gpointer) buf;
 
-  status = vaCreateBuffer (dpy, ctx, type, size, 1, data, &buf_id);
+  status = vaCreateBuffer (dpy, ctx, type, size, num_elements, data, &buf_id);
   if (!vaapi_check_status (status, "vaCreateBuffer()"))
     return FALSE;
 
@@ -152,6 +162,13 @@ string_of_VAProfile (VAProfile profile)
 #if VA_CHECK_VERSION(0,35,0)
       MAP (VP8Version0_3);
 #endif
+#if VA_CHECK_VERSION(0,37,0)
+      MAP (HEVCMain);
+      MAP (HEVCMain10);
+#endif
+#if VA_CHECK_VERSION(0,38,0)
+      MAP (VP9Profile0);
+#endif
 #undef MAP
     default:
       break;
@@ -51,6 +51,13 @@ gboolean
 vaapi_create_buffer (VADisplay dpy, VAContextID ctx, int type, guint size,
     gconstpointer data, VABufferID * buf_id, gpointer * mapped_data);
 
+/** Creates and maps VA buffer with num_elements elements of size bytes */
+G_GNUC_INTERNAL
+gboolean
+vaapi_create_n_elements_buffer (VADisplay dpy, VAContextID ctx, int type,
+    guint size, gconstpointer data, VABufferID * buf_id,
+    gpointer * mapped_data, guint num_elements);
+
 /** Destroy VA buffer */
 G_GNUC_INTERNAL
 void
@@ -98,6 +98,28 @@ static const GstVaapiH264LevelLimits gst_vaapi_h264_level_limits[] = {
 };
 /* *INDENT-ON* */
 
+/* Number of significant bits of each byte value, i.e. floor(log2(v)) + 1 */
+static const guint8 gst_vaapi_h264_bit_length_table[256] = {
+/* *INDENT-OFF* */
+  0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+/* *INDENT-ON* */
+};
+
 /* Lookup value in map */
 static const struct map *
 map_lookup_value (const struct map *m, guint value)
@@ -397,3 +419,51 @@ gst_vaapi_utils_h264_get_chroma_format_idc (GstVaapiChromaType chroma_type)
   }
   return chroma_format_idc;
 }
+
+/* Returns the number of significant bits in value */
+static inline guint
+bit_length (guint32 value)
+{
+  if (value < (1U << 8))
+    return gst_vaapi_h264_bit_length_table[value];
+  if (value < (1U << 16))
+    return 8 + gst_vaapi_h264_bit_length_table[value >> 8];
+  if (value < (1U << 24))
+    return 16 + gst_vaapi_h264_bit_length_table[value >> 16];
+  return 24 + gst_vaapi_h264_bit_length_table[value >> 24];
+}
+
+/** Writes an unsigned integer Exp-Golomb-coded syntax element, i.e. ue(v) */
+gboolean
+gst_vaapi_utils_h264_write_ue (GstBitWriter * bs, guint32 value)
+{
+  const guint32 code_num = value + 1;
+  guint nbits;
+
+  /* ue(v) values are limited to 2^32 - 2 in the H.264 syntax */
+  if (G_UNLIKELY (code_num == 0))
+    return FALSE;
+
+  /* The leading zero bits are implicit when the whole codeword fits
+     into 32 bits, i.e. prefix and suffix are written in one go */
+  nbits = bit_length (code_num);
+  if (nbits <= 16)
+    return gst_bit_writer_put_bits_uint32 (bs, code_num, 2 * nbits - 1);
+
+  if (!gst_bit_writer_put_bits_uint32 (bs, 0, nbits - 1))
+    return FALSE;
+  return gst_bit_writer_put_bits_uint32 (bs, code_num, nbits);
+}
+
+/** Writes a signed integer Exp-Golomb-coded syntax element, i.e. se(v) */
+gboolean
+gst_vaapi_utils_h264_write_se (GstBitWriter * bs, gint32 value)
+{
+  guint32 code_num;
+
+  if (value <= 0)
+    code_num = -(value << 1);
+  else
+    code_num = (value << 1) - 1;
+  return gst_vaapi_utils_h264_write_ue (bs, code_num);
+}
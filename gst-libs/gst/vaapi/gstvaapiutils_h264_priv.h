@@ -23,6 +23,7 @@
 #ifndef GST_VAAPI_UTILS_H264_PRIV_H
 #define GST_VAAPI_UTILS_H264_PRIV_H
 
+#include <gst/base/gstbitwriter.h>
 #include "gstvaapiutils_h264.h"
 #include "libgstvaapi_priv_check.h"
 
@@ -90,6 +91,16 @@ G_GNUC_INTERNAL
 guint
 gst_vaapi_utils_h264_get_chroma_format_idc (GstVaapiChromaType chroma_type);
 
+/* Writes an unsigned integer Exp-Golomb-coded syntax element, i.e. ue(v) */
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_utils_h264_write_ue (GstBitWriter * bs, guint32 value);
+
+/* Writes a signed integer Exp-Golomb-coded syntax element, i.e. se(v) */
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_utils_h264_write_se (GstBitWriter * bs, gint32 value);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_UTILS_H264_PRIV_H */
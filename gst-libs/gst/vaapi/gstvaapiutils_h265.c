@@ -0,0 +1,310 @@
+/*
+ *  gstvaapiutils_h265.c - H.265 related utilities
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiutils_h265_priv.h"
+
+/** Returns GstVaapiProfile from H.265 general_profile_idc value */
+GstVaapiProfile
+gst_vaapi_utils_h265_get_profile (guint8 profile_idc)
+{
+  GstVaapiProfile profile;
+
+  switch (profile_idc) {
+    case 1:
+      profile = GST_VAAPI_PROFILE_H265_MAIN;
+      break;
+    case 2:
+      profile = GST_VAAPI_PROFILE_H265_MAIN10;
+      break;
+    case 3:
+      profile = GST_VAAPI_PROFILE_H265_MAIN_STILL_PICTURE;
+      break;
+    default:
+      g_debug ("unsupported profile_idc value");
+      profile = GST_VAAPI_PROFILE_UNKNOWN;
+      break;
+  }
+  return profile;
+}
+
+/** Returns GstVaapiChromaType from H.265 chroma_format_idc value */
+GstVaapiChromaType
+gst_vaapi_utils_h265_get_chroma_type (guint chroma_format_idc)
+{
+  GstVaapiChromaType chroma_type;
+
+  switch (chroma_format_idc) {
+    case 0:
+      chroma_type = GST_VAAPI_CHROMA_TYPE_YUV400;
+      break;
+    case 1:
+      chroma_type = GST_VAAPI_CHROMA_TYPE_YUV420;
+      break;
+    case 2:
+      chroma_type = GST_VAAPI_CHROMA_TYPE_YUV422;
+      break;
+    case 3:
+      chroma_type = GST_VAAPI_CHROMA_TYPE_YUV444;
+      break;
+    default:
+      g_debug ("unsupported chroma_format_idc value");
+      chroma_type = (GstVaapiChromaType) 0;
+      break;
+  }
+  return chroma_type;
+}
+
+/** Resets the picture order count state */
+void
+gst_vaapi_utils_h265_poc_init (GstVaapiH265PocState * state)
+{
+  g_return_if_fail (state != NULL);
+
+  state->prev_poc_lsb = 0;
+  state->prev_poc_msb = 0;
+}
+
+/** Computes PicOrderCntVal (8.3.1) */
+gint32
+gst_vaapi_utils_h265_compute_poc (GstVaapiH265PocState * state,
+    guint log2_max_poc_lsb, guint poc_lsb, gboolean reset_msb,
+    gboolean update_prev)
+{
+  const gint32 MaxPicOrderCntLsb = 1 << log2_max_poc_lsb;
+  const gint32 lsb = poc_lsb;
+  gint32 msb;
+
+  g_return_val_if_fail (state != NULL, 0);
+
+  if (reset_msb)
+    msb = 0;
+  else if (lsb < state->prev_poc_lsb &&
+      (state->prev_poc_lsb - lsb) >= (MaxPicOrderCntLsb / 2))
+    msb = state->prev_poc_msb + MaxPicOrderCntLsb;
+  else if (lsb > state->prev_poc_lsb &&
+      (lsb - state->prev_poc_lsb) > (MaxPicOrderCntLsb / 2))
+    msb = state->prev_poc_msb - MaxPicOrderCntLsb;
+  else
+    msb = state->prev_poc_msb;
+
+  if (update_prev) {
+    state->prev_poc_lsb = lsb;
+    state->prev_poc_msb = msb;
+  }
+  return msb + lsb;
+}
+
+/** Derives the POC values of the reference picture set (8.3.2) */
+void
+gst_vaapi_utils_h265_derive_rps (GstVaapiH265RefPicSet * rps, gint32 poc,
+    guint log2_max_poc_lsb, const GstVaapiH265ShortTermRps * st_rps,
+    const GstVaapiH265LongTermRef * lt_refs, guint num_long_term_sps,
+    guint num_long_term_pics)
+{
+  const gint32 MaxPicOrderCntLsb = 1 << log2_max_poc_lsb;
+  const guint num_long_term = num_long_term_sps + num_long_term_pics;
+  guint i, DeltaPocMsbCycleLt = 0;
+
+  g_return_if_fail (rps != NULL);
+  g_return_if_fail (st_rps != NULL);
+  g_return_if_fail (num_long_term == 0 || lt_refs != NULL);
+
+  rps->num_st_curr_before = 0;
+  rps->num_st_curr_after = 0;
+  rps->num_st_foll = 0;
+  rps->num_lt_curr = 0;
+  rps->num_lt_foll = 0;
+
+  for (i = 0; i < st_rps->num_negative_pics &&
+      i < GST_VAAPI_H265_MAX_RPS_PICS; i++) {
+    const gint32 poc_st = poc + st_rps->delta_poc_s0[i];
+    if (st_rps->used_by_curr_pic_s0[i])
+      rps->poc_st_curr_before[rps->num_st_curr_before++] = poc_st;
+    else
+      rps->poc_st_foll[rps->num_st_foll++] = poc_st;
+  }
+
+  for (i = 0; i < st_rps->num_positive_pics &&
+      i + st_rps->num_negative_pics < GST_VAAPI_H265_MAX_RPS_PICS; i++) {
+    const gint32 poc_st = poc + st_rps->delta_poc_s1[i];
+    if (st_rps->used_by_curr_pic_s1[i])
+      rps->poc_st_curr_after[rps->num_st_curr_after++] = poc_st;
+    else
+      rps->poc_st_foll[rps->num_st_foll++] = poc_st;
+  }
+
+  for (i = 0; i < num_long_term && i < GST_VAAPI_H265_MAX_RPS_PICS; i++) {
+    const GstVaapiH265LongTermRef *const lt = &lt_refs[i];
+    gint32 poc_lt = lt->poc_lsb_lt;
+
+    /* DeltaPocMsbCycleLt accumulates within each of the SPS candidates
+       and the slice header entries (7-52) */
+    if (i == 0 || i == num_long_term_sps)
+      DeltaPocMsbCycleLt = lt->delta_poc_msb_cycle_lt;
+    else
+      DeltaPocMsbCycleLt += lt->delta_poc_msb_cycle_lt;
+
+    if (lt->delta_poc_msb_present_flag)
+      poc_lt += poc - DeltaPocMsbCycleLt * MaxPicOrderCntLsb -
+          (poc & (MaxPicOrderCntLsb - 1));
+
+    if (lt->used_by_curr_pic_lt) {
+      rps->curr_delta_poc_msb_present_flag[rps->num_lt_curr] =
+          lt->delta_poc_msb_present_flag;
+      rps->poc_lt_curr[rps->num_lt_curr++] = poc_lt;
+    } else {
+      rps->foll_delta_poc_msb_present_flag[rps->num_lt_foll] =
+          lt->delta_poc_msb_present_flag;
+      rps->poc_lt_foll[rps->num_lt_foll++] = poc_lt;
+    }
+  }
+}
+
+/** Builds RefPicList0 or RefPicList1 (8.3.4) */
+guint
+gst_vaapi_utils_h265_init_ref_pic_list (guint8 * ref_list, guint num_active,
+    const GstVaapiH265RefPicSet * rps, gboolean is_list1,
+    const guint8 * list_entry)
+{
+  guint8 temp_list[GST_VAAPI_H265_MAX_RPS_PICS];
+  guint i, n, num_rps_curr_temp_list, num_pic_total_curr;
+  guint first_count, second_count, first_base, second_base, lt_base;
+
+  g_return_val_if_fail (ref_list != NULL, 0);
+  g_return_val_if_fail (rps != NULL, 0);
+
+  num_pic_total_curr = rps->num_st_curr_before + rps->num_st_curr_after +
+      rps->num_lt_curr;
+  if (num_pic_total_curr == 0 || num_active == 0)
+    return 0;
+  num_active = MIN (num_active, GST_VAAPI_H265_MAX_RPS_PICS);
+
+  /* RefPicListTemp1 starts with RefPicSetStCurrAfter */
+  if (!is_list1) {
+    first_count = rps->num_st_curr_before;
+    first_base = 0;
+    second_count = rps->num_st_curr_after;
+    second_base = rps->num_st_curr_before;
+  } else {
+    first_count = rps->num_st_curr_after;
+    first_base = rps->num_st_curr_before;
+    second_count = rps->num_st_curr_before;
+    second_base = 0;
+  }
+  lt_base = rps->num_st_curr_before + rps->num_st_curr_after;
+
+  num_rps_curr_temp_list = MAX (num_active, num_pic_total_curr);
+  num_rps_curr_temp_list = MIN (num_rps_curr_temp_list,
+      GST_VAAPI_H265_MAX_RPS_PICS);
+
+  n = 0;
+  while (n < num_rps_curr_temp_list) {
+    for (i = 0; i < first_count && n < num_rps_curr_temp_list; i++)
+      temp_list[n++] = first_base + i;
+    for (i = 0; i < second_count && n < num_rps_curr_temp_list; i++)
+      temp_list[n++] = second_base + i;
+    for (i = 0; i < rps->num_lt_curr && n < num_rps_curr_temp_list; i++)
+      temp_list[n++] = lt_base + i;
+  }
+
+  for (i = 0; i < num_active; i++) {
+    guint idx = i;
+    if (list_entry) {
+      idx = list_entry[i];
+      if (idx >= num_rps_curr_temp_list)
+        idx = 0;
+    }
+    ref_list[i] = temp_list[idx];
+  }
+  return num_active;
+}
+
+/** Computes the sizes of uniformly spaced tiles (6-3, 6-4) */
+void
+gst_vaapi_utils_h265_get_uniform_tile_sizes (guint16 * sizes,
+    guint num_tiles, guint pic_size_in_ctbs)
+{
+  guint i;
+
+  g_return_if_fail (sizes != NULL);
+  g_return_if_fail (num_tiles > 0);
+
+  for (i = 0; i < num_tiles; i++)
+    sizes[i] = ((i + 1) * pic_size_in_ctbs) / num_tiles -
+        (i * pic_size_in_ctbs) / num_tiles;
+}
+
+/** Returns the maximum value of num_entry_point_offsets (7.4.7.1) */
+guint
+gst_vaapi_utils_h265_get_max_entry_points (gboolean tiles_enabled,
+    gboolean entropy_coding_sync_enabled, guint num_tile_columns,
+    guint num_tile_rows, guint pic_height_in_ctbs)
+{
+  if (!tiles_enabled)
+    return entropy_coding_sync_enabled ? pic_height_in_ctbs - 1 : 0;
+  if (!entropy_coding_sync_enabled)
+    return num_tile_columns * num_tile_rows - 1;
+  return num_tile_columns * pic_height_in_ctbs - 1;
+}
+
+/* Converts a blk_size x blk_size scaling list from up-right diagonal
+   scan order (6.5.3) to raster scan order */
+static void
+scaling_list_to_raster (guint8 * out, const guint8 * in, guint blk_size)
+{
+  const guint num_coeffs = blk_size * blk_size;
+  guint i = 0;
+  gint x = 0, y = 0;
+
+  while (i < num_coeffs) {
+    while (y >= 0) {
+      if (x < (gint) blk_size && y < (gint) blk_size)
+        out[y * blk_size + x] = in[i++];
+      y--;
+      x++;
+    }
+    y = x;
+    x = 0;
+  }
+}
+
+/** Converts a 4x4 scaling list from up-right diagonal to raster order */
+void
+gst_vaapi_utils_h265_scaling_list_4x4_to_raster (guint8 out[16],
+    const guint8 in[16])
+{
+  g_return_if_fail (out != NULL);
+  g_return_if_fail (in != NULL);
+
+  scaling_list_to_raster (out, in, 4);
+}
+
+/** Converts an 8x8 scaling list from up-right diagonal to raster order */
+void
+gst_vaapi_utils_h265_scaling_list_8x8_to_raster (guint8 out[64],
+    const guint8 in[64])
+{
+  g_return_if_fail (out != NULL);
+  g_return_if_fail (in != NULL);
+
+  scaling_list_to_raster (out, in, 8);
+}
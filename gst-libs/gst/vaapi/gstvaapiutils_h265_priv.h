@@ -0,0 +1,162 @@
+/*
+ *  gstvaapiutils_h265_priv.h - H.265 related utilities
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_UTILS_H265_PRIV_H
+#define GST_VAAPI_UTILS_H265_PRIV_H
+
+#include <glib.h>
+#include <gst/vaapi/gstvaapiprofile.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include "libgstvaapi_priv_check.h"
+
+G_BEGIN_DECLS
+
+/* Maximum number of pictures in a reference picture set */
+#define GST_VAAPI_H265_MAX_RPS_PICS     16
+
+typedef struct _GstVaapiH265PocState            GstVaapiH265PocState;
+typedef struct _GstVaapiH265ShortTermRps        GstVaapiH265ShortTermRps;
+typedef struct _GstVaapiH265LongTermRef         GstVaapiH265LongTermRef;
+typedef struct _GstVaapiH265RefPicSet           GstVaapiH265RefPicSet;
+
+/* Picture order count state carried over from the previous TemporalId
+   = 0 picture (prevTid0Pic) */
+struct _GstVaapiH265PocState
+{
+  gint32 prev_poc_lsb;          /* prevPicOrderCntLsb */
+  gint32 prev_poc_msb;          /* prevPicOrderCntMsb */
+};
+
+/* A short-term reference picture set, st_ref_pic_set() */
+struct _GstVaapiH265ShortTermRps
+{
+  guint num_negative_pics;      /* NumNegativePics */
+  guint num_positive_pics;      /* NumPositivePics */
+  gint32 delta_poc_s0[GST_VAAPI_H265_MAX_RPS_PICS];
+  gint32 delta_poc_s1[GST_VAAPI_H265_MAX_RPS_PICS];
+  guint8 used_by_curr_pic_s0[GST_VAAPI_H265_MAX_RPS_PICS];
+  guint8 used_by_curr_pic_s1[GST_VAAPI_H265_MAX_RPS_PICS];
+};
+
+/* A long-term reference picture, as signalled in the slice header. The
+   PocLsbLt and UsedByCurrPicLt values are already resolved from the SPS
+   candidates, if lt_idx_sps[] was used */
+struct _GstVaapiH265LongTermRef
+{
+  guint poc_lsb_lt;             /* PocLsbLt */
+  guint8 used_by_curr_pic_lt;   /* UsedByCurrPicLt */
+  guint8 delta_poc_msb_present_flag;
+  guint delta_poc_msb_cycle_lt;
+};
+
+/* The POC values of the five lists of the reference picture set */
+struct _GstVaapiH265RefPicSet
+{
+  gint32 poc_st_curr_before[GST_VAAPI_H265_MAX_RPS_PICS];
+  gint32 poc_st_curr_after[GST_VAAPI_H265_MAX_RPS_PICS];
+  gint32 poc_st_foll[GST_VAAPI_H265_MAX_RPS_PICS];
+  gint32 poc_lt_curr[GST_VAAPI_H265_MAX_RPS_PICS];
+  gint32 poc_lt_foll[GST_VAAPI_H265_MAX_RPS_PICS];
+  guint8 curr_delta_poc_msb_present_flag[GST_VAAPI_H265_MAX_RPS_PICS];
+  guint8 foll_delta_poc_msb_present_flag[GST_VAAPI_H265_MAX_RPS_PICS];
+  guint num_st_curr_before;
+  guint num_st_curr_after;
+  guint num_st_foll;
+  guint num_lt_curr;
+  guint num_lt_foll;
+};
+
+/* Returns GstVaapiProfile from H.265 general_profile_idc value */
+G_GNUC_INTERNAL
+GstVaapiProfile
+gst_vaapi_utils_h265_get_profile (guint8 profile_idc);
+
+/* Returns GstVaapiChromaType from H.265 chroma_format_idc value */
+G_GNUC_INTERNAL
+GstVaapiChromaType
+gst_vaapi_utils_h265_get_chroma_type (guint chroma_format_idc);
+
+/* Resets the picture order count state, e.g. at the start of a stream */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_h265_poc_init (GstVaapiH265PocState * state);
+
+/* Computes PicOrderCntVal (8.3.1). reset_msb is set for IRAP pictures
+   with NoRaslOutputFlag = 1, and update_prev for pictures that can be
+   prevTid0Pic for the next ones, i.e. TemporalId = 0 pictures that are
+   not RASL, RADL or sub-layer non-reference pictures */
+G_GNUC_INTERNAL
+gint32
+gst_vaapi_utils_h265_compute_poc (GstVaapiH265PocState * state,
+    guint log2_max_poc_lsb, guint poc_lsb, gboolean reset_msb,
+    gboolean update_prev);
+
+/* Derives the POC values of the reference picture set of the picture
+   whose PicOrderCntVal is poc (8.3.2) */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_h265_derive_rps (GstVaapiH265RefPicSet * rps, gint32 poc,
+    guint log2_max_poc_lsb, const GstVaapiH265ShortTermRps * st_rps,
+    const GstVaapiH265LongTermRef * lt_refs, guint num_long_term_sps,
+    guint num_long_term_pics);
+
+/* Builds RefPicList0, or RefPicList1 if is_list1 is set (8.3.4). The
+   entries are indices into the concatenation of RefPicSetStCurrBefore,
+   RefPicSetStCurrAfter and RefPicSetLtCurr. list_entry holds the
+   list_entry_lX[] values, or NULL if the list is not modified. Returns
+   the number of entries, i.e. num_active or zero if the RPS is empty */
+G_GNUC_INTERNAL
+guint
+gst_vaapi_utils_h265_init_ref_pic_list (guint8 * ref_list, guint num_active,
+    const GstVaapiH265RefPicSet * rps, gboolean is_list1,
+    const guint8 * list_entry);
+
+/* Computes the column widths (or row heights) of uniformly spaced
+   tiles, in CTBs (6-3, 6-4) */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_h265_get_uniform_tile_sizes (guint16 * sizes,
+    guint num_tiles, guint pic_size_in_ctbs);
+
+/* Returns the maximum value of num_entry_point_offsets (7.4.7.1) */
+G_GNUC_INTERNAL
+guint
+gst_vaapi_utils_h265_get_max_entry_points (gboolean tiles_enabled,
+    gboolean entropy_coding_sync_enabled, guint num_tile_columns,
+    guint num_tile_rows, guint pic_height_in_ctbs);
+
+/* Converts a 4x4 scaling list from up-right diagonal scan order to
+   raster scan order */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_h265_scaling_list_4x4_to_raster (guint8 out[16],
+    const guint8 in[16]);
+
+/* Converts an 8x8 scaling list from up-right diagonal scan order to
+   raster scan order */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_h265_scaling_list_8x8_to_raster (guint8 out[64],
+    const guint8 in[64]);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_UTILS_H265_PRIV_H */
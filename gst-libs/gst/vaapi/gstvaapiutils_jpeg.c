@@ -0,0 +1,355 @@
+/*
+ *  gstvaapiutils_jpeg.c - JPEG related utilities
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiutils_jpeg_priv.h"
+
+/* JPEG markers */
+enum
+{
+  MARKER_SOF0 = 0xc0,
+  MARKER_DHT = 0xc4,
+  MARKER_SOI = 0xd8,
+  MARKER_SOS = 0xda,
+  MARKER_DQT = 0xdb,
+  MARKER_APP0 = 0xe0,
+};
+
+/* Zig-zag scan order to natural (raster) order */
+/* *INDENT-OFF* */
+static const guint8 zigzag_to_natural[64] = {
+   0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+/* *INDENT-ON* */
+
+/* Table K.1 and K.2 quantization tables, in natural order */
+/* *INDENT-OFF* */
+static const guint8 default_quant_tables[2][64] = {
+  { 16,  11,  10,  16,  24,  40,  51,  61,
+    12,  12,  14,  19,  26,  58,  60,  55,
+    14,  13,  16,  24,  40,  57,  69,  56,
+    14,  17,  22,  29,  51,  87,  80,  62,
+    18,  22,  37,  56,  68, 109, 103,  77,
+    24,  35,  55,  64,  81, 104, 113,  92,
+    49,  64,  78,  87, 103, 121, 120, 101,
+    72,  92,  95,  98, 112, 100, 103,  99 },
+  { 17,  18,  24,  47,  99,  99,  99,  99,
+    18,  21,  26,  66,  99,  99,  99,  99,
+    24,  26,  56,  99,  99,  99,  99,  99,
+    47,  66,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99 }
+};
+/* *INDENT-ON* */
+
+/* Table K.3 to K.6 Huffman tables, indexed by class then by id */
+/* *INDENT-OFF* */
+static const GstVaapiJpegHuffmanTable default_huffman_tables[2][2] = {
+  { /* DC tables */
+    { { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 },
+      { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 },
+      12 },
+    { { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 },
+      { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 },
+      12 },
+  },
+  { /* AC tables */
+    { { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d },
+      { 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12,
+        0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+        0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16,
+        0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+        0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+        0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+        0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98,
+        0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+        0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4,
+        0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+        0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa },
+      162 },
+    { { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 },
+      { 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21,
+        0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+        0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34,
+        0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38,
+        0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+        0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+        0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96,
+        0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
+        0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
+        0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
+        0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa },
+      162 },
+  }
+};
+/* *INDENT-ON* */
+
+/* Fills in the quantization table scaled for the quality factor, in
+   zig-zag scan order. This uses the IJG scaling, i.e. quality 50 maps
+   to the Annex K tables and quality 100 to a table of ones */
+void
+gst_vaapi_utils_jpeg_get_quant_table (guint table_id, guint quality,
+    guint8 out_table[64])
+{
+  const guint8 *const table = default_quant_tables[table_id ? 1 : 0];
+  guint i, scale, value;
+
+  quality = CLAMP (quality, 1, GST_VAAPI_JPEG_MAX_QUALITY);
+  scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+
+  for (i = 0; i < 64; i++) {
+    value = (table[zigzag_to_natural[i]] * scale + 50) / 100;
+    out_table[i] = CLAMP (value, 1, 255);
+  }
+}
+
+const GstVaapiJpegHuffmanTable *
+gst_vaapi_utils_jpeg_get_huffman_table (guint table_class, guint table_id)
+{
+  g_return_val_if_fail (table_class < 2, NULL);
+  g_return_val_if_fail (table_id < 2, NULL);
+
+  return &default_huffman_tables[table_class][table_id];
+}
+
+/* Initializes frame info for the supplied image size and format. The
+   Y component uses table 0 for quantization and entropy coding, and
+   the chroma components use table 1 */
+gboolean
+gst_vaapi_utils_jpeg_frame_info_init (GstVaapiJpegFrameInfo * info,
+    guint width, guint height, GstVaapiChromaType chroma_type, guint quality)
+{
+  guint i, h_sampling, v_sampling;
+
+  g_return_val_if_fail (info != NULL, FALSE);
+
+  if (!width || !height || width > G_MAXUINT16 || height > G_MAXUINT16)
+    return FALSE;
+
+  switch (chroma_type) {
+    case GST_VAAPI_CHROMA_TYPE_YUV400:
+      info->num_components = 1;
+      h_sampling = v_sampling = 1;
+      break;
+    case GST_VAAPI_CHROMA_TYPE_YUV420:
+      info->num_components = 3;
+      h_sampling = v_sampling = 2;
+      break;
+    case GST_VAAPI_CHROMA_TYPE_YUV422:
+      info->num_components = 3;
+      h_sampling = 2, v_sampling = 1;
+      break;
+    case GST_VAAPI_CHROMA_TYPE_YUV444:
+      info->num_components = 3;
+      h_sampling = v_sampling = 1;
+      break;
+    default:
+      return FALSE;
+  }
+
+  info->width = width;
+  info->height = height;
+  info->quality = CLAMP (quality, 1, GST_VAAPI_JPEG_MAX_QUALITY);
+
+  for (i = 0; i < info->num_components; i++) {
+    GstVaapiJpegComponent *const comp = &info->components[i];
+
+    comp->id = i + 1;
+    comp->h_sampling = i == 0 ? h_sampling : 1;
+    comp->v_sampling = i == 0 ? v_sampling : 1;
+    comp->quant_table = i == 0 ? 0 : 1;
+    comp->dc_table = comp->quant_table;
+    comp->ac_table = comp->quant_table;
+  }
+
+  gst_vaapi_utils_jpeg_get_quant_table (0, info->quality,
+      info->quant_tables[0]);
+  gst_vaapi_utils_jpeg_get_quant_table (1, info->quality,
+      info->quant_tables[1]);
+  return TRUE;
+}
+
+static inline guint
+get_num_tables (const GstVaapiJpegFrameInfo * info)
+{
+  return info->num_components > 1 ? 2 : 1;
+}
+
+static gboolean
+write_marker (GstBitWriter * bs, guint8 marker, guint length)
+{
+  return gst_bit_writer_put_bits_uint8 (bs, 0xff, 8) &&
+      gst_bit_writer_put_bits_uint8 (bs, marker, 8) &&
+      (!length || gst_bit_writer_put_bits_uint16 (bs, length, 16));
+}
+
+/* B.2.4.1 - Quantization table-specification syntax */
+static gboolean
+write_dqt (GstBitWriter * bs, const GstVaapiJpegFrameInfo * info)
+{
+  const guint num_tables = get_num_tables (info);
+  guint i;
+
+  if (!write_marker (bs, MARKER_DQT, 2 + num_tables * 65))
+    return FALSE;
+
+  for (i = 0; i < num_tables; i++) {
+    /* Pq = 0 (8-bit precision), Tq = i */
+    if (!gst_bit_writer_put_bits_uint8 (bs, i, 8) ||
+        !gst_bit_writer_put_bytes (bs, info->quant_tables[i], 64))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* B.2.2 - Frame header syntax */
+static gboolean
+write_sof (GstBitWriter * bs, const GstVaapiJpegFrameInfo * info)
+{
+  guint i;
+
+  if (!write_marker (bs, MARKER_SOF0, 8 + 3 * info->num_components) ||
+      !gst_bit_writer_put_bits_uint8 (bs, 8, 8) ||
+      !gst_bit_writer_put_bits_uint16 (bs, info->height, 16) ||
+      !gst_bit_writer_put_bits_uint16 (bs, info->width, 16) ||
+      !gst_bit_writer_put_bits_uint8 (bs, info->num_components, 8))
+    return FALSE;
+
+  for (i = 0; i < info->num_components; i++) {
+    const GstVaapiJpegComponent *const comp = &info->components[i];
+
+    if (!gst_bit_writer_put_bits_uint8 (bs, comp->id, 8) ||
+        !gst_bit_writer_put_bits_uint8 (bs, comp->h_sampling, 4) ||
+        !gst_bit_writer_put_bits_uint8 (bs, comp->v_sampling, 4) ||
+        !gst_bit_writer_put_bits_uint8 (bs, comp->quant_table, 8))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* B.2.4.2 - Huffman table-specification syntax */
+static gboolean
+write_dht (GstBitWriter * bs, const GstVaapiJpegFrameInfo * info)
+{
+  const guint num_tables = get_num_tables (info);
+  const GstVaapiJpegHuffmanTable *table;
+  guint i, table_class, length = 2;
+
+  for (i = 0; i < num_tables; i++) {
+    for (table_class = 0; table_class < 2; table_class++) {
+      table = &default_huffman_tables[table_class][i];
+      length += 17 + table->num_values;
+    }
+  }
+  if (!write_marker (bs, MARKER_DHT, length))
+    return FALSE;
+
+  for (i = 0; i < num_tables; i++) {
+    for (table_class = 0; table_class < 2; table_class++) {
+      table = &default_huffman_tables[table_class][i];
+      if (!gst_bit_writer_put_bits_uint8 (bs, table_class, 4) ||
+          !gst_bit_writer_put_bits_uint8 (bs, i, 4) ||
+          !gst_bit_writer_put_bytes (bs, table->huf_bits, 16) ||
+          !gst_bit_writer_put_bytes (bs, table->huf_values, table->num_values))
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/* B.2.3 - Scan header syntax */
+static gboolean
+write_sos (GstBitWriter * bs, const GstVaapiJpegFrameInfo * info)
+{
+  guint i;
+
+  if (!write_marker (bs, MARKER_SOS, 6 + 2 * info->num_components) ||
+      !gst_bit_writer_put_bits_uint8 (bs, info->num_components, 8))
+    return FALSE;
+
+  for (i = 0; i < info->num_components; i++) {
+    const GstVaapiJpegComponent *const comp = &info->components[i];
+
+    if (!gst_bit_writer_put_bits_uint8 (bs, comp->id, 8) ||
+        !gst_bit_writer_put_bits_uint8 (bs, comp->dc_table, 4) ||
+        !gst_bit_writer_put_bits_uint8 (bs, comp->ac_table, 4))
+      return FALSE;
+  }
+
+  /* Ss = 0, Se = 63, Ah = Al = 0 */
+  return gst_bit_writer_put_bits_uint8 (bs, 0, 8) &&
+      gst_bit_writer_put_bits_uint8 (bs, 63, 8) &&
+      gst_bit_writer_put_bits_uint8 (bs, 0, 8);
+}
+
+/* JFIF APP0 segment, version 1.01, no density nor thumbnail */
+static gboolean
+write_app0 (GstBitWriter * bs)
+{
+  static const guint8 jfif_data[] = {
+    'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0
+  };
+
+  return write_marker (bs, MARKER_APP0, 2 + sizeof (jfif_data)) &&
+      gst_bit_writer_put_bytes (bs, jfif_data, sizeof (jfif_data));
+}
+
+/* Writes all headers from SOI up to the SOS segment. The entropy-coded
+   data and the EOI marker are generated by the hardware encoder */
+gboolean
+gst_vaapi_utils_jpeg_write_headers (GstBitWriter * bs,
+    const GstVaapiJpegFrameInfo * info)
+{
+  g_return_val_if_fail (bs != NULL, FALSE);
+  g_return_val_if_fail (info != NULL, FALSE);
+
+  return write_marker (bs, MARKER_SOI, 0) &&
+      write_app0 (bs) &&
+      write_dqt (bs, info) &&
+      write_sof (bs, info) &&
+      write_dht (bs, info) &&
+      write_sos (bs, info);
+}
@@ -0,0 +1,115 @@
+/*
+ *  gstvaapiutils_jpeg_priv.h - JPEG related utilities
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_UTILS_JPEG_PRIV_H
+#define GST_VAAPI_UTILS_JPEG_PRIV_H
+
+#include <gst/base/gstbitwriter.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include "libgstvaapi_priv_check.h"
+
+G_BEGIN_DECLS
+
+#define GST_VAAPI_JPEG_MAX_COMPONENTS   3
+#define GST_VAAPI_JPEG_MAX_QUALITY      100
+
+/**
+ * GstVaapiJpegHuffmanTable:
+ * @huf_bits: the number of Huffman codes of length 1 to 16 bits
+ * @huf_values: the symbols, in increasing code length order
+ * @num_values: the number of symbols
+ *
+ * A Huffman table, as stored in a DHT segment.
+ */
+typedef struct {
+  guint8 huf_bits[16];
+  guint8 huf_values[162];
+  guint num_values;
+} GstVaapiJpegHuffmanTable;
+
+/**
+ * GstVaapiJpegComponent:
+ * @id: the component identifier
+ * @h_sampling: the horizontal sampling factor
+ * @v_sampling: the vertical sampling factor
+ * @quant_table: the quantization table selector
+ * @dc_table: the DC Huffman table selector
+ * @ac_table: the AC Huffman table selector
+ *
+ * The coding parameters of an image component.
+ */
+typedef struct {
+  guint8 id;
+  guint8 h_sampling;
+  guint8 v_sampling;
+  guint8 quant_table;
+  guint8 dc_table;
+  guint8 ac_table;
+} GstVaapiJpegComponent;
+
+/**
+ * GstVaapiJpegFrameInfo:
+ * @width: the image width
+ * @height: the image height
+ * @quality: the quality factor the quantization tables derive from
+ * @num_components: the number of image components, 1 or 3
+ * @components: the image components
+ * @quant_tables: the luma and chroma quantization tables, in zig-zag
+ *   scan order
+ *
+ * The parameters of a baseline JPEG image, with a single interleaved
+ * scan and the standard Huffman tables (ITU-T T.81, Annex K.3).
+ */
+typedef struct {
+  guint16 width;
+  guint16 height;
+  guint quality;
+  guint num_components;
+  GstVaapiJpegComponent components[GST_VAAPI_JPEG_MAX_COMPONENTS];
+  guint8 quant_tables[2][64];
+} GstVaapiJpegFrameInfo;
+
+/* Fills in the quantization table scaled for the quality factor */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_jpeg_get_quant_table (guint table_id, guint quality,
+    guint8 out_table[64]);
+
+/* Returns the standard DC (class 0) or AC (class 1) Huffman table */
+G_GNUC_INTERNAL
+const GstVaapiJpegHuffmanTable *
+gst_vaapi_utils_jpeg_get_huffman_table (guint table_class, guint table_id);
+
+/* Initializes frame info for the supplied image size and format */
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_utils_jpeg_frame_info_init (GstVaapiJpegFrameInfo * info,
+    guint width, guint height, GstVaapiChromaType chroma_type, guint quality);
+
+/* Writes all headers from SOI up to the SOS segment */
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_utils_jpeg_write_headers (GstBitWriter * bs,
+    const GstVaapiJpegFrameInfo * info);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_UTILS_JPEG_PRIV_H */
@@ -21,7 +21,6 @@
  */
 
 #include "sysdeps.h"
-#include <gst/codecparsers/gstmpegvideoparser.h>
 #include "gstvaapiutils_mpeg2_priv.h"
 
 struct map
@@ -282,3 +281,161 @@ gst_vaapi_utils_mpeg2_get_chroma_format_idc (GstVaapiChromaType chroma_type)
   }
   return chroma_format_idc;
 }
+
+/* ------------------------------------------------------------------------- */
+/* --- GOP structure                                                     --- */
+/* ------------------------------------------------------------------------- */
+
+static GstVaapiMPEG2GopFrame *
+gop_frame_new (gpointer data, guint32 display_index)
+{
+  GstVaapiMPEG2GopFrame *frame;
+
+  frame = g_slice_new0 (GstVaapiMPEG2GopFrame);
+  frame->data = data;
+  frame->display_index = display_index;
+  return frame;
+}
+
+static void
+gop_frame_free (GstVaapiMPEG2GopFrame * frame, GDestroyNotify destroy_func)
+{
+  if (destroy_func && frame->data)
+    destroy_func (frame->data);
+  g_slice_free (GstVaapiMPEG2GopFrame, frame);
+}
+
+/* Submits the frame for encoding, i.e. in coding order */
+static void
+gop_output_frame (GstVaapiMPEG2Gop * gop, GstVaapiMPEG2GopFrame * frame,
+    GstMpegVideoPictureType type)
+{
+  frame->type = type;
+  frame->temporal_reference = (frame->display_index - gop->tr_base) & 1023;
+  g_queue_push_tail (&gop->ready_frames, frame);
+}
+
+/* Submits the pending frames as B-frames, after their backward reference */
+static void
+gop_output_bframes (GstVaapiMPEG2Gop * gop)
+{
+  GstVaapiMPEG2GopFrame *frame;
+
+  while ((frame = g_queue_pop_head (&gop->pending_frames)))
+    gop_output_frame (gop, frame, GST_MPEG_VIDEO_PICTURE_TYPE_B);
+}
+
+/* Submits the last pending frame as a P-frame, and the others as B-frames */
+static void
+gop_output_pframe_and_bframes (GstVaapiMPEG2Gop * gop)
+{
+  GstVaapiMPEG2GopFrame *frame;
+
+  frame = g_queue_pop_tail (&gop->pending_frames);
+  if (!frame)
+    return;
+  gop_output_frame (gop, frame, GST_MPEG_VIDEO_PICTURE_TYPE_P);
+  gop_output_bframes (gop);
+}
+
+static void
+gop_start (GstVaapiMPEG2Gop * gop, GstVaapiMPEG2GopFrame * frame)
+{
+  GstVaapiMPEG2GopFrame *leading_frame;
+
+  gop->gop_frame_index = 1;
+
+  if (gop->closed_gop)
+    gop_output_pframe_and_bframes (gop);
+
+  /* Any remaining B-frame is predicted from the new I-frame, and
+     displayed before it, so it becomes part of the new GOP */
+  leading_frame = g_queue_peek_head (&gop->pending_frames);
+  gop->tr_base = leading_frame ? leading_frame->display_index :
+      frame->display_index;
+  frame->closed_gop = !leading_frame;
+  gop_output_frame (gop, frame, GST_MPEG_VIDEO_PICTURE_TYPE_I);
+  gop_output_bframes (gop);
+}
+
+/** Initializes the GOP structure helper, with no frame submitted yet */
+void
+gst_vaapi_utils_mpeg2_gop_init (GstVaapiMPEG2Gop * gop)
+{
+  g_return_if_fail (gop != NULL);
+
+  memset (gop, 0, sizeof (*gop));
+  gop->closed_gop = TRUE;
+  g_queue_init (&gop->pending_frames);
+  g_queue_init (&gop->ready_frames);
+}
+
+/** Drops all frames not output yet, so that the next one starts a new GOP */
+void
+gst_vaapi_utils_mpeg2_gop_clear (GstVaapiMPEG2Gop * gop,
+    GDestroyNotify destroy_func)
+{
+  GstVaapiMPEG2GopFrame *frame;
+
+  g_return_if_fail (gop != NULL);
+
+  while ((frame = g_queue_pop_head (&gop->pending_frames)))
+    gop_frame_free (frame, destroy_func);
+  while ((frame = g_queue_pop_head (&gop->ready_frames)))
+    gop_frame_free (frame, destroy_func);
+  gop->gop_frame_index = 0;
+}
+
+/** Submits a new frame in display order */
+void
+gst_vaapi_utils_mpeg2_gop_push (GstVaapiMPEG2Gop * gop, gpointer data,
+    gboolean force_keyframe)
+{
+  GstVaapiMPEG2GopFrame *frame;
+
+  g_return_if_fail (gop != NULL);
+
+  frame = gop_frame_new (data, gop->num_frames++);
+
+  if (gop->gop_frame_index == 0 || force_keyframe ||
+      (gop->gop_size > 0 && gop->gop_frame_index >= gop->gop_size)) {
+    gop_start (gop, frame);
+    return;
+  }
+  gop->gop_frame_index++;
+
+  if (g_queue_get_length (&gop->pending_frames) < gop->num_bframes) {
+    g_queue_push_tail (&gop->pending_frames, frame);
+    return;
+  }
+  gop_output_frame (gop, frame, GST_MPEG_VIDEO_PICTURE_TYPE_P);
+  gop_output_bframes (gop);
+}
+
+/** Makes all pending frames available for encoding, e.g. at end-of-stream */
+void
+gst_vaapi_utils_mpeg2_gop_drain (GstVaapiMPEG2Gop * gop)
+{
+  g_return_if_fail (gop != NULL);
+
+  gop_output_pframe_and_bframes (gop);
+}
+
+/** Retrieves the next frame to encode, in coding order */
+gboolean
+gst_vaapi_utils_mpeg2_gop_pop (GstVaapiMPEG2Gop * gop,
+    GstVaapiMPEG2GopFrame * out_frame)
+{
+  GstVaapiMPEG2GopFrame *frame;
+
+  g_return_val_if_fail (gop != NULL, FALSE);
+  g_return_val_if_fail (out_frame != NULL, FALSE);
+
+  frame = g_queue_pop_head (&gop->ready_frames);
+  if (!frame)
+    return FALSE;
+
+  *out_frame = *frame;
+  gop_frame_free (frame, NULL);
+  return TRUE;
+}
@@ -23,6 +23,7 @@
 #ifndef GST_VAAPI_UTILS_MPEG2_PRIV_H
 #define GST_VAAPI_UTILS_MPEG2_PRIV_H
 
+#include <gst/codecparsers/gstmpegvideoparser.h>
 #include "gstvaapiutils_mpeg2.h"
 #include "libgstvaapi_priv_check.h"
 
@@ -52,6 +53,76 @@ typedef struct {
   guint32 vbv_buffer_size;
 } GstVaapiMPEG2LevelLimits;
 
+/**
+ * GstVaapiMPEG2GopFrame:
+ * @data: the user data attached to the frame, e.g. a #GstVaapiEncPicture
+ * @display_index: the frame number in display order
+ * @type: the picture_coding_type to encode the frame with
+ * @temporal_reference: the temporal_reference value, relative to the GOP
+ * @closed_gop: the closed_gop flag of the GOP starting with that I-frame
+ *
+ * A frame, as output in coding order by the GOP structure helpers.
+ */
+typedef struct {
+  gpointer data;
+  guint32 display_index;
+  GstMpegVideoPictureType type;
+  guint16 temporal_reference;
+  guint closed_gop:1;
+} GstVaapiMPEG2GopFrame;
+
+/**
+ * GstVaapiMPEG2Gop:
+ * @gop_size: the maximum number of frames in a GOP, or zero if unlimited
+ * @num_bframes: the maximum number of consecutive B-frames
+ * @closed_gop: flag: generate closed GOPs, i.e. without leading B-frames
+ *
+ * Helper to determine the picture types and the coding order of
+ * frames submitted in display order. Any number of consecutive
+ * B-frames is supported. A new GOP is started every @gop_size frames
+ * or whenever a key frame is requested.
+ *
+ * With closed GOPs, the last frame of a GOP is always encoded as a
+ * P-frame. Otherwise, the trailing B-frames are encoded right after
+ * the next I-frame and predicted from it, i.e. they become the
+ * leading B-frames of the next GOP.
+ */
+typedef struct {
+  guint gop_size;
+  guint num_bframes;
+  gboolean closed_gop;
+
+  /*< private >*/
+  guint32 num_frames;
+  guint32 gop_frame_index;
+  guint32 tr_base;
+  GQueue pending_frames;
+  GQueue ready_frames;
+} GstVaapiMPEG2Gop;
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_mpeg2_gop_init (GstVaapiMPEG2Gop * gop);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_mpeg2_gop_clear (GstVaapiMPEG2Gop * gop,
+    GDestroyNotify destroy_func);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_mpeg2_gop_push (GstVaapiMPEG2Gop * gop, gpointer data,
+    gboolean force_keyframe);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_mpeg2_gop_drain (GstVaapiMPEG2Gop * gop);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_utils_mpeg2_gop_pop (GstVaapiMPEG2Gop * gop,
+    GstVaapiMPEG2GopFrame * out_frame);
+
 /* Returns GstVaapiProfile from MPEG-2 profile_idc value */
 G_GNUC_INTERNAL
 GstVaapiProfile
@@ -0,0 +1,129 @@
+/*
+ *  gstvaapiutils_vc1.c - VC-1 related utilities
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiutils_vc1_priv.h"
+
+/* Loads the bits of 8 consecutive macroblocks, the first one in the
+   low order byte */
+static inline guint64
+load_bitplane8 (const guint8 * bitplane)
+{
+  guint64 v;
+
+  memcpy (&v, bitplane, sizeof (v));
+  return GUINT64_FROM_LE (v);
+}
+
+/* Combines the bitplanes bits of one macroblock into a nibble */
+static inline guint
+get_nibble (const guint8 * bitplanes[3], guint i)
+{
+  guint v = 0;
+
+  if (bitplanes[0])
+    v |= bitplanes[0][i];
+  if (bitplanes[1])
+    v |= bitplanes[1][i] << 1;
+  if (bitplanes[2])
+    v |= bitplanes[2][i] << 2;
+  return v;
+}
+
+/* Combines the bitplanes bits of 8 macroblocks at once, one nibble per
+   byte. Bitplane bits are 0 or 1, so the shifts never carry over to
+   the next byte */
+static inline guint64
+get_nibbles8 (const guint8 * bitplanes[3], guint i)
+{
+  guint64 v = 0;
+
+  if (bitplanes[0])
+    v |= load_bitplane8 (bitplanes[0] + i);
+  if (bitplanes[1])
+    v |= load_bitplane8 (bitplanes[1] + i) << 1;
+  if (bitplanes[2])
+    v |= load_bitplane8 (bitplanes[2] + i) << 2;
+  return v;
+}
+
+/* Packs 8 nibbles, stored one per byte, into 4 bytes. The first nibble
+   of each pair goes to the high order bits */
+static inline guint32
+pack_nibbles8 (guint64 v)
+{
+  v = ((v << 4) | (v >> 8)) & G_GUINT64_CONSTANT (0x00ff00ff00ff00ff);
+  v = (v | (v >> 8)) & G_GUINT64_CONSTANT (0x0000ffff0000ffff);
+  v = (v | (v >> 16)) & G_GUINT64_CONSTANT (0x00000000ffffffff);
+  return v;
+}
+
+/* Packs the bitplanes into the VA format, i.e. one nibble per macroblock
+   in raster scan order, the first macroblock of each pair in the high
+   order bits. Bit 0 of the nibble comes from bitplanes[0], bit 1 from
+   bitplanes[1] and bit 2 from bitplanes[2], absent bitplanes being NULL.
+   Rows are processed 8 macroblocks at a time. When mb_width is odd, a
+   byte is shared by the last macroblock of a row and the first one of
+   the next row */
+void
+gst_vaapi_utils_vc1_pack_bitplanes (guint8 * dst,
+    const guint8 * bitplanes[3], guint mb_width, guint mb_height,
+    guint mb_stride)
+{
+  guint x, y, row, pending = 0;
+  gboolean has_pending = FALSE;
+  guint32 v;
+
+  if (!mb_width)
+    return;
+
+  for (y = 0; y < mb_height; y++) {
+    row = y * mb_stride;
+    x = 0;
+
+    /* Complete the byte started with the last macroblock of the
+       previous row */
+    if (has_pending) {
+      *dst++ = (pending << 4) | get_nibble (bitplanes, row);
+      has_pending = FALSE;
+      x = 1;
+    }
+
+    for (; x + 8 <= mb_width; x += 8) {
+      v = GUINT32_TO_LE (pack_nibbles8 (get_nibbles8 (bitplanes, row + x)));
+      memcpy (dst, &v, sizeof (v));
+      dst += sizeof (v);
+    }
+
+    for (; x + 2 <= mb_width; x += 2)
+      *dst++ = (get_nibble (bitplanes, row + x) << 4) |
+          get_nibble (bitplanes, row + x + 1);
+
+    if (x < mb_width) {
+      pending = get_nibble (bitplanes, row + x);
+      has_pending = TRUE;
+    }
+  }
+
+  /* The last nibble goes to the high order bits */
+  if (has_pending)
+    *dst = pending << 4;
+}
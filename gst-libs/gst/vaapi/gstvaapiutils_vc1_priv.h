@@ -0,0 +1,39 @@
+/*
+ *  gstvaapiutils_vc1_priv.h - VC-1 related utilities
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_UTILS_VC1_PRIV_H
+#define GST_VAAPI_UTILS_VC1_PRIV_H
+
+#include <glib.h>
+#include "libgstvaapi_priv_check.h"
+
+G_BEGIN_DECLS
+
+/* Packs up to three bitplanes into the VA bitplane buffer format */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_vc1_pack_bitplanes (guint8 * dst,
+    const guint8 * bitplanes[3], guint mb_width, guint mb_height,
+    guint mb_stride);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_UTILS_VC1_PRIV_H */
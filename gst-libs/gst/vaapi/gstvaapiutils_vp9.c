@@ -0,0 +1,780 @@
+/*
+ *  gstvaapiutils_vp9.c - VP9 related utilities
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include <gst/base/gstbitreader.h>
+#include "gstvaapiutils_vp9_priv.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+#define VP9_FRAME_MARKER        2
+#define VP9_SYNC_CODE_0         0x49
+#define VP9_SYNC_CODE_1         0x83
+#define VP9_SYNC_CODE_2         0x42
+#define VP9_CS_RGB              7
+#define VP9_MIN_TILE_WIDTH_B64  4
+#define VP9_MAX_TILE_WIDTH_B64  64
+
+/* Quantizer lookup tables for 8-bit samples (VP9 bitstream spec,
+   section 8.6.1) */
+static const gint16 dc_qlookup[256] = {
+  4, 8, 8, 9, 10, 11, 12, 12, 13, 14, 15, 16, 17, 18,
+  19, 19, 20, 21, 22, 23, 24, 25, 26, 26, 27, 28, 29, 30,
+  31, 32, 32, 33, 34, 35, 36, 37, 38, 38, 39, 40, 41, 42,
+  43, 43, 44, 45, 46, 47, 48, 48, 49, 50, 51, 52, 53, 53,
+  54, 55, 56, 57, 57, 58, 59, 60, 61, 62, 62, 63, 64, 65,
+  66, 66, 67, 68, 69, 70, 70, 71, 72, 73, 74, 74, 75, 76,
+  77, 78, 78, 79, 80, 81, 81, 82, 83, 84, 85, 85, 87, 88,
+  90, 92, 93, 95, 96, 98, 99, 101, 102, 104, 105, 107, 108, 110,
+  111, 113, 114, 116, 117, 118, 120, 121, 123, 125, 127, 129, 131, 134,
+  136, 138, 140, 142, 144, 146, 148, 150, 152, 154, 156, 158, 161, 164,
+  166, 169, 172, 174, 177, 180, 182, 185, 187, 190, 192, 195, 199, 202,
+  205, 208, 211, 214, 217, 220, 223, 226, 230, 233, 237, 240, 243, 247,
+  250, 253, 257, 261, 265, 269, 272, 276, 280, 284, 288, 292, 296, 300,
+  304, 309, 313, 317, 322, 326, 330, 335, 340, 344, 349, 354, 359, 364,
+  369, 374, 379, 384, 389, 395, 400, 406, 411, 417, 423, 429, 435, 441,
+  447, 454, 461, 467, 475, 482, 489, 497, 505, 513, 522, 530, 539, 549,
+  559, 569, 579, 590, 602, 614, 626, 640, 654, 668, 684, 700, 717, 736,
+  755, 775, 796, 819, 843, 869, 896, 925, 955, 988, 1022, 1058, 1098, 1139,
+  1184, 1232, 1282, 1336,
+};
+
+static const gint16 ac_qlookup[256] = {
+  4, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+  20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,
+  33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45,
+  46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58,
+  59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+  72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84,
+  85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97,
+  98, 99, 100, 101, 102, 104, 106, 108, 110, 112, 114, 116, 118,
+  120, 122, 124, 126, 128, 130, 132, 134, 136, 138, 140, 142, 144,
+  146, 148, 150, 152, 155, 158, 161, 164, 167, 170, 173, 176, 179,
+  182, 185, 188, 191, 194, 197, 200, 203, 207, 211, 215, 219, 223,
+  227, 231, 235, 239, 243, 247, 251, 255, 260, 265, 270, 275, 280,
+  285, 290, 295, 300, 305, 311, 317, 323, 329, 335, 341, 347, 353,
+  359, 366, 373, 380, 387, 394, 401, 408, 416, 424, 432, 440, 448,
+  456, 465, 474, 483, 492, 501, 510, 520, 530, 540, 550, 560, 571,
+  582, 593, 604, 615, 627, 639, 651, 663, 676, 689, 702, 715, 729,
+  743, 757, 771, 786, 801, 816, 832, 848, 864, 881, 898, 915, 933,
+  951, 969, 988, 1007, 1026, 1046, 1066, 1087, 1108, 1129, 1151, 1173, 1196,
+  1219, 1243, 1267, 1292, 1317, 1343, 1369, 1396, 1423, 1451, 1479, 1508, 1537,
+  1567, 1597, 1628, 1660, 1692, 1725, 1759, 1793, 1828,
+};
+
+static const guint8 seg_feature_bits[GST_VAAPI_VP9_SEG_LVL_MAX] =
+    { 8, 6, 2, 0 };
+static const guint8 seg_feature_signed[GST_VAAPI_VP9_SEG_LVL_MAX] =
+    { 1, 1, 0, 0 };
+
+#define READ_BITS(br, val, nbits) G_STMT_START {               \
+    guint32 v_;                                               \
+    if (!gst_bit_reader_get_bits_uint32 (br, &v_, nbits))     \
+      goto error_truncated;                                   \
+    val = v_;                                                 \
+  } G_STMT_END
+
+/* su(n), i.e. n bits of magnitude followed by a sign bit */
+#define READ_SIGNED_BITS(br, val, nbits) G_STMT_START {        \
+    guint32 m_, s_;                                           \
+    READ_BITS (br, m_, nbits);                                \
+    READ_BITS (br, s_, 1);                                    \
+    val = s_ ? -(gint) m_ : (gint) m_;                        \
+  } G_STMT_END
+
+static void
+loop_filter_reset_deltas (GstVaapiVp9LoopFilter * lf)
+{
+  lf->delta_enabled = 1;
+  lf->ref_deltas[GST_VAAPI_VP9_INTRA_FRAME] = 1;
+  lf->ref_deltas[GST_VAAPI_VP9_LAST_FRAME] = 0;
+  lf->ref_deltas[GST_VAAPI_VP9_GOLDEN_FRAME] = -1;
+  lf->ref_deltas[GST_VAAPI_VP9_ALTREF_FRAME] = -1;
+  lf->mode_deltas[0] = 0;
+  lf->mode_deltas[1] = 0;
+}
+
+/* Resets the state that does not survive intra-only, key or error
+   resilient frames (setup_past_independence) */
+static void
+setup_past_independence (GstVaapiVp9Parser * parser)
+{
+  GstVaapiVp9Segmentation *const seg = &parser->segmentation;
+
+  memset (seg->feature_enabled, 0, sizeof (seg->feature_enabled));
+  memset (seg->feature_data, 0, sizeof (seg->feature_data));
+  seg->abs_delta = 0;
+  loop_filter_reset_deltas (&parser->loop_filter);
+}
+
+void
+gst_vaapi_utils_vp9_parser_init (GstVaapiVp9Parser * parser)
+{
+  memset (parser, 0, sizeof (*parser));
+  memset (parser->segmentation.tree_probs, 255,
+      sizeof (parser->segmentation.tree_probs));
+  memset (parser->segmentation.pred_probs, 255,
+      sizeof (parser->segmentation.pred_probs));
+  parser->bit_depth = 8;
+  parser->subsampling_x = 1;
+  parser->subsampling_y = 1;
+  setup_past_independence (parser);
+}
+
+static gboolean
+parse_frame_sync_code (GstBitReader * br)
+{
+  guint sync_code[3];
+
+  READ_BITS (br, sync_code[0], 8);
+  READ_BITS (br, sync_code[1], 8);
+  READ_BITS (br, sync_code[2], 8);
+  if (sync_code[0] != VP9_SYNC_CODE_0 || sync_code[1] != VP9_SYNC_CODE_1 ||
+      sync_code[2] != VP9_SYNC_CODE_2)
+    goto error_invalid_sync_code;
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated frame sync code");
+    return FALSE;
+  }
+error_invalid_sync_code:
+  {
+    GST_ERROR ("invalid frame sync code");
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_color_config (GstBitReader * br, GstVaapiVp9Parser * parser,
+    guint profile)
+{
+  guint bit, ten_or_twelve_bit;
+
+  if (profile >= 2) {
+    READ_BITS (br, ten_or_twelve_bit, 1);
+    parser->bit_depth = ten_or_twelve_bit ? 12 : 10;
+  } else
+    parser->bit_depth = 8;
+
+  READ_BITS (br, parser->color_space, 3);
+  if (parser->color_space != VP9_CS_RGB) {
+    READ_BITS (br, parser->color_range, 1);
+    if (profile == 1 || profile == 3) {
+      READ_BITS (br, parser->subsampling_x, 1);
+      READ_BITS (br, parser->subsampling_y, 1);
+      READ_BITS (br, bit, 1);
+      if (bit)
+        goto error_reserved;
+    } else {
+      parser->subsampling_x = 1;
+      parser->subsampling_y = 1;
+    }
+  } else {
+    parser->color_range = 1;
+    if (profile == 1 || profile == 3) {
+      parser->subsampling_x = 0;
+      parser->subsampling_y = 0;
+      READ_BITS (br, bit, 1);
+      if (bit)
+        goto error_reserved;
+    } else
+      goto error_rgb_profile;
+  }
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated color config");
+    return FALSE;
+  }
+error_reserved:
+  {
+    GST_ERROR ("invalid reserved bit in color config");
+    return FALSE;
+  }
+error_rgb_profile:
+  {
+    GST_ERROR ("RGB is not supported in profile %u", profile);
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_frame_size (GstBitReader * br, GstVaapiVp9FrameHdr * frame_hdr)
+{
+  READ_BITS (br, frame_hdr->width, 16);
+  READ_BITS (br, frame_hdr->height, 16);
+  frame_hdr->width++;
+  frame_hdr->height++;
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated frame size");
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_render_size (GstBitReader * br, GstVaapiVp9FrameHdr * frame_hdr)
+{
+  guint render_and_frame_size_different;
+
+  READ_BITS (br, render_and_frame_size_different, 1);
+  if (render_and_frame_size_different) {
+    READ_BITS (br, frame_hdr->render_width, 16);
+    READ_BITS (br, frame_hdr->render_height, 16);
+    frame_hdr->render_width++;
+    frame_hdr->render_height++;
+  } else {
+    frame_hdr->render_width = frame_hdr->width;
+    frame_hdr->render_height = frame_hdr->height;
+  }
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated render size");
+    return FALSE;
+  }
+}
+
+/* The frame size may be copied from one of the reference frames, the
+   references of another size being scaled by the decoder */
+static gboolean
+parse_frame_size_with_refs (GstBitReader * br, GstVaapiVp9Parser * parser,
+    GstVaapiVp9FrameHdr * frame_hdr)
+{
+  guint i, found_ref = 0;
+
+  for (i = 0; i < GST_VAAPI_VP9_REFS_PER_FRAME; i++) {
+    READ_BITS (br, found_ref, 1);
+    if (found_ref) {
+      const guint ref_idx = frame_hdr->ref_frame_idx[i];
+
+      frame_hdr->width = parser->ref_width[ref_idx];
+      frame_hdr->height = parser->ref_height[ref_idx];
+      if (!frame_hdr->width || !frame_hdr->height)
+        goto error_missing_ref;
+      break;
+    }
+  }
+
+  if (!found_ref && !parse_frame_size (br, frame_hdr))
+    return FALSE;
+  return parse_render_size (br, frame_hdr);
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated frame size with refs");
+    return FALSE;
+  }
+error_missing_ref:
+  {
+    GST_ERROR ("frame size copied from missing reference frame %u",
+        frame_hdr->ref_frame_idx[i]);
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_loop_filter_params (GstBitReader * br, GstVaapiVp9LoopFilter * lf)
+{
+  guint i, update;
+
+  READ_BITS (br, lf->filter_level, 6);
+  READ_BITS (br, lf->sharpness_level, 3);
+  READ_BITS (br, lf->delta_enabled, 1);
+  lf->delta_update = 0;
+  if (lf->delta_enabled) {
+    READ_BITS (br, lf->delta_update, 1);
+    if (lf->delta_update) {
+      for (i = 0; i < G_N_ELEMENTS (lf->ref_deltas); i++) {
+        READ_BITS (br, update, 1);
+        if (update)
+          READ_SIGNED_BITS (br, lf->ref_deltas[i], 6);
+      }
+      for (i = 0; i < G_N_ELEMENTS (lf->mode_deltas); i++) {
+        READ_BITS (br, update, 1);
+        if (update)
+          READ_SIGNED_BITS (br, lf->mode_deltas[i], 6);
+      }
+    }
+  }
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated loop filter params");
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_delta_q (GstBitReader * br, gint * delta_q_ptr)
+{
+  guint delta_coded;
+
+  *delta_q_ptr = 0;
+  READ_BITS (br, delta_coded, 1);
+  if (delta_coded)
+    READ_SIGNED_BITS (br, *delta_q_ptr, 4);
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated delta_q");
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_quantization_params (GstBitReader * br, GstVaapiVp9FrameHdr * frame_hdr)
+{
+  READ_BITS (br, frame_hdr->base_q_idx, 8);
+  if (!parse_delta_q (br, &frame_hdr->delta_q_y_dc) ||
+      !parse_delta_q (br, &frame_hdr->delta_q_uv_dc) ||
+      !parse_delta_q (br, &frame_hdr->delta_q_uv_ac))
+    return FALSE;
+
+  frame_hdr->lossless = frame_hdr->base_q_idx == 0 &&
+      frame_hdr->delta_q_y_dc == 0 && frame_hdr->delta_q_uv_dc == 0 &&
+      frame_hdr->delta_q_uv_ac == 0;
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated quantization params");
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_prob (GstBitReader * br, guint8 * prob_ptr)
+{
+  guint prob_coded;
+
+  READ_BITS (br, prob_coded, 1);
+  if (prob_coded)
+    READ_BITS (br, *prob_ptr, 8);
+  else
+    *prob_ptr = 255;
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated probability");
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_segmentation_params (GstBitReader * br, GstVaapiVp9Segmentation * seg)
+{
+  guint i, j, value;
+
+  seg->update_map = 0;
+  seg->temporal_update = 0;
+  seg->update_data = 0;
+
+  READ_BITS (br, seg->enabled, 1);
+  if (!seg->enabled)
+    return TRUE;
+
+  READ_BITS (br, seg->update_map, 1);
+  if (seg->update_map) {
+    for (i = 0; i < G_N_ELEMENTS (seg->tree_probs); i++) {
+      if (!parse_prob (br, &seg->tree_probs[i]))
+        return FALSE;
+    }
+    READ_BITS (br, seg->temporal_update, 1);
+    for (i = 0; i < G_N_ELEMENTS (seg->pred_probs); i++) {
+      if (!seg->temporal_update)
+        seg->pred_probs[i] = 255;
+      else if (!parse_prob (br, &seg->pred_probs[i]))
+        return FALSE;
+    }
+  }
+
+  READ_BITS (br, seg->update_data, 1);
+  if (seg->update_data) {
+    READ_BITS (br, seg->abs_delta, 1);
+    for (i = 0; i < GST_VAAPI_VP9_MAX_SEGMENTS; i++) {
+      for (j = 0; j < GST_VAAPI_VP9_SEG_LVL_MAX; j++) {
+        gint data = 0;
+
+        READ_BITS (br, seg->feature_enabled[i][j], 1);
+        if (seg->feature_enabled[i][j]) {
+          if (seg_feature_signed[j])
+            READ_SIGNED_BITS (br, data, seg_feature_bits[j]);
+          else if (seg_feature_bits[j] > 0) {
+            READ_BITS (br, value, seg_feature_bits[j]);
+            data = value;
+          }
+        }
+        seg->feature_data[i][j] = data;
+      }
+    }
+  }
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated segmentation params");
+    return FALSE;
+  }
+}
+
+static gboolean
+parse_tile_info (GstBitReader * br, GstVaapiVp9FrameHdr * frame_hdr)
+{
+  const guint sb64_cols = (((frame_hdr->width + 7) >> 3) + 7) >> 3;
+  guint min_log2 = 0, max_log2 = 1, increment;
+
+  while ((VP9_MAX_TILE_WIDTH_B64 << min_log2) < sb64_cols)
+    min_log2++;
+  while ((sb64_cols >> max_log2) >= VP9_MIN_TILE_WIDTH_B64)
+    max_log2++;
+  max_log2--;
+
+  frame_hdr->tile_cols_log2 = min_log2;
+  while (frame_hdr->tile_cols_log2 < max_log2) {
+    READ_BITS (br, increment, 1);
+    if (!increment)
+      break;
+    frame_hdr->tile_cols_log2++;
+  }
+
+  READ_BITS (br, frame_hdr->tile_rows_log2, 1);
+  if (frame_hdr->tile_rows_log2) {
+    READ_BITS (br, increment, 1);
+    frame_hdr->tile_rows_log2 += increment;
+  }
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated tile info");
+    return FALSE;
+  }
+}
+
+gboolean
+gst_vaapi_utils_vp9_parse_frame_header (GstVaapiVp9Parser * parser,
+    GstVaapiVp9FrameHdr * frame_hdr, const guint8 * data, guint size)
+{
+  GstBitReader br;
+  guint i, frame_marker, profile_low_bit, profile_high_bit, bit;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+  g_return_val_if_fail (frame_hdr != NULL, FALSE);
+
+  memset (frame_hdr, 0, sizeof (*frame_hdr));
+  gst_bit_reader_init (&br, data, size);
+
+  READ_BITS (&br, frame_marker, 2);
+  if (frame_marker != VP9_FRAME_MARKER)
+    goto error_invalid_frame_marker;
+
+  READ_BITS (&br, profile_low_bit, 1);
+  READ_BITS (&br, profile_high_bit, 1);
+  frame_hdr->profile = (profile_high_bit << 1) | profile_low_bit;
+  if (frame_hdr->profile == 3) {
+    READ_BITS (&br, bit, 1);
+    if (bit)
+      goto error_unsupported_profile;
+  }
+
+  READ_BITS (&br, frame_hdr->show_existing_frame, 1);
+  if (frame_hdr->show_existing_frame) {
+    READ_BITS (&br, frame_hdr->frame_to_show, 3);
+    frame_hdr->uncompressed_header_size =
+        (gst_bit_reader_get_pos (&br) + 7) / 8;
+    return TRUE;
+  }
+
+  READ_BITS (&br, frame_hdr->frame_type, 1);
+  READ_BITS (&br, frame_hdr->show_frame, 1);
+  READ_BITS (&br, frame_hdr->error_resilient_mode, 1);
+
+  if (frame_hdr->frame_type == GST_VAAPI_VP9_KEY_FRAME) {
+    if (!parse_frame_sync_code (&br))
+      return FALSE;
+    if (!parse_color_config (&br, parser, frame_hdr->profile))
+      return FALSE;
+    if (!parse_frame_size (&br, frame_hdr))
+      return FALSE;
+    if (!parse_render_size (&br, frame_hdr))
+      return FALSE;
+    frame_hdr->refresh_frame_flags = (1 << GST_VAAPI_VP9_REF_FRAMES) - 1;
+  } else {
+    if (!frame_hdr->show_frame)
+      READ_BITS (&br, frame_hdr->intra_only, 1);
+    if (!frame_hdr->error_resilient_mode)
+      READ_BITS (&br, frame_hdr->reset_frame_context, 2);
+
+    if (frame_hdr->intra_only) {
+      if (!parse_frame_sync_code (&br))
+        return FALSE;
+      if (frame_hdr->profile > 0) {
+        if (!parse_color_config (&br, parser, frame_hdr->profile))
+          return FALSE;
+      } else {
+        parser->bit_depth = 8;
+        parser->color_space = 0;        /* BT.601 */
+        parser->subsampling_x = 1;
+        parser->subsampling_y = 1;
+      }
+      READ_BITS (&br, frame_hdr->refresh_frame_flags, 8);
+      if (!parse_frame_size (&br, frame_hdr))
+        return FALSE;
+      if (!parse_render_size (&br, frame_hdr))
+        return FALSE;
+    } else {
+      static const GstVaapiVp9InterpFilter literal_to_type[4] = {
+        GST_VAAPI_VP9_INTERP_EIGHTTAP_SMOOTH,
+        GST_VAAPI_VP9_INTERP_EIGHTTAP,
+        GST_VAAPI_VP9_INTERP_EIGHTTAP_SHARP,
+        GST_VAAPI_VP9_INTERP_BILINEAR,
+      };
+      guint is_filter_switchable, raw_interp_filter;
+
+      READ_BITS (&br, frame_hdr->refresh_frame_flags, 8);
+      for (i = 0; i < GST_VAAPI_VP9_REFS_PER_FRAME; i++) {
+        READ_BITS (&br, frame_hdr->ref_frame_idx[i], 3);
+        READ_BITS (&br, frame_hdr->ref_frame_sign_bias[i], 1);
+      }
+      if (!parse_frame_size_with_refs (&br, parser, frame_hdr))
+        return FALSE;
+      READ_BITS (&br, frame_hdr->allow_high_precision_mv, 1);
+
+      READ_BITS (&br, is_filter_switchable, 1);
+      if (is_filter_switchable)
+        frame_hdr->interp_filter = GST_VAAPI_VP9_INTERP_SWITCHABLE;
+      else {
+        READ_BITS (&br, raw_interp_filter, 2);
+        frame_hdr->interp_filter = literal_to_type[raw_interp_filter];
+      }
+    }
+  }
+
+  frame_hdr->bit_depth = parser->bit_depth;
+  frame_hdr->color_space = parser->color_space;
+  frame_hdr->color_range = parser->color_range;
+  frame_hdr->subsampling_x = parser->subsampling_x;
+  frame_hdr->subsampling_y = parser->subsampling_y;
+
+  if (!frame_hdr->error_resilient_mode) {
+    READ_BITS (&br, frame_hdr->refresh_frame_context, 1);
+    READ_BITS (&br, frame_hdr->frame_parallel_decoding_mode, 1);
+  } else
+    frame_hdr->frame_parallel_decoding_mode = 1;
+  READ_BITS (&br, frame_hdr->frame_context_idx, 2);
+
+  if (frame_hdr->frame_type == GST_VAAPI_VP9_KEY_FRAME ||
+      frame_hdr->intra_only || frame_hdr->error_resilient_mode)
+    setup_past_independence (parser);
+
+  if (!parse_loop_filter_params (&br, &parser->loop_filter))
+    return FALSE;
+  if (!parse_quantization_params (&br, frame_hdr))
+    return FALSE;
+  if (!parse_segmentation_params (&br, &parser->segmentation))
+    return FALSE;
+  if (!parse_tile_info (&br, frame_hdr))
+    return FALSE;
+
+  READ_BITS (&br, frame_hdr->compressed_header_size, 16);
+  if (!frame_hdr->compressed_header_size)
+    goto error_invalid_compressed_header_size;
+
+  frame_hdr->uncompressed_header_size = (gst_bit_reader_get_pos (&br) + 7) / 8;
+  if (frame_hdr->uncompressed_header_size +
+      frame_hdr->compressed_header_size > size)
+    goto error_truncated;
+
+  frame_hdr->loop_filter = parser->loop_filter;
+  frame_hdr->segmentation = parser->segmentation;
+
+  /* Track the size of the reference frames for the next frames */
+  for (i = 0; i < GST_VAAPI_VP9_REF_FRAMES; i++) {
+    if (frame_hdr->refresh_frame_flags & (1 << i)) {
+      parser->ref_width[i] = frame_hdr->width;
+      parser->ref_height[i] = frame_hdr->height;
+    }
+  }
+  return TRUE;
+
+  /* ERRORS */
+error_truncated:
+  {
+    GST_ERROR ("truncated frame header");
+    return FALSE;
+  }
+error_invalid_frame_marker:
+  {
+    GST_ERROR ("invalid frame marker %u", frame_marker);
+    return FALSE;
+  }
+error_unsupported_profile:
+  {
+    GST_ERROR ("unsupported profile (reserved bit set)");
+    return FALSE;
+  }
+error_invalid_compressed_header_size:
+  {
+    GST_ERROR ("invalid compressed header size");
+    return FALSE;
+  }
+}
+
+/* The superframe index is appended to the last frame: a marker byte
+   110mmnnn (mm + 1 bytes per frame size, nnn + 1 frames), the frame
+   sizes in little-endian byte order, then the marker byte again */
+guint
+gst_vaapi_utils_vp9_parse_superframe_index (const guint8 * data, guint size,
+    guint frame_sizes[GST_VAAPI_VP9_MAX_SUPERFRAME_FRAMES],
+    guint * index_size_ptr)
+{
+  guint marker, num_frames, bytes_per_size, index_size, total_size;
+  const guint8 *p;
+  guint i, j;
+
+  if (size < 1)
+    return 0;
+
+  marker = data[size - 1];
+  if ((marker & 0xe0) != 0xc0)
+    return 0;
+
+  num_frames = (marker & 0x07) + 1;
+  bytes_per_size = ((marker >> 3) & 0x03) + 1;
+  index_size = 2 + bytes_per_size * num_frames;
+  if (size < index_size || data[size - index_size] != marker)
+    return 0;
+
+  p = data + size - index_size + 1;
+  total_size = 0;
+  for (i = 0; i < num_frames; i++) {
+    guint frame_size = 0;
+
+    for (j = 0; j < bytes_per_size; j++)
+      frame_size |= (guint) * p++ << (j * 8);
+    if (!frame_size)
+      return 0;
+    frame_sizes[i] = frame_size;
+    total_size += frame_size;
+  }
+
+  /* The frames, then the index, make up the whole data */
+  if (total_size != size - index_size)
+    return 0;
+
+  if (index_size_ptr)
+    *index_size_ptr = index_size;
+  return num_frames;
+}
+
+static inline gboolean
+seg_feature_active (const GstVaapiVp9Segmentation * seg, guint segment_id,
+    GstVaapiVp9SegLevel feature)
+{
+  return seg->enabled && seg->feature_enabled[segment_id][feature];
+}
+
+guint
+gst_vaapi_utils_vp9_get_qindex (const GstVaapiVp9FrameHdr * frame_hdr,
+    guint segment_id)
+{
+  const GstVaapiVp9Segmentation *const seg = &frame_hdr->segmentation;
+  gint qindex;
+
+  if (!seg_feature_active (seg, segment_id, GST_VAAPI_VP9_SEG_LVL_ALT_Q))
+    return frame_hdr->base_q_idx;
+
+  qindex = seg->feature_data[segment_id][GST_VAAPI_VP9_SEG_LVL_ALT_Q];
+  if (!seg->abs_delta)
+    qindex += frame_hdr->base_q_idx;
+  return CLAMP (qindex, 0, 255);
+}
+
+gint
+gst_vaapi_utils_vp9_get_dc_quant (gint qindex)
+{
+  return dc_qlookup[CLAMP (qindex, 0, 255)];
+}
+
+gint
+gst_vaapi_utils_vp9_get_ac_quant (gint qindex)
+{
+  return ac_qlookup[CLAMP (qindex, 0, 255)];
+}
+
+void
+gst_vaapi_utils_vp9_get_filter_levels (const GstVaapiVp9FrameHdr * frame_hdr,
+    guint segment_id, guint8 levels[4][2])
+{
+  const GstVaapiVp9Segmentation *const seg = &frame_hdr->segmentation;
+  const GstVaapiVp9LoopFilter *const lf = &frame_hdr->loop_filter;
+  gint level, base_level, scale;
+  guint ref, mode;
+
+  base_level = lf->filter_level;
+  if (seg_feature_active (seg, segment_id, GST_VAAPI_VP9_SEG_LVL_ALT_L)) {
+    level = seg->feature_data[segment_id][GST_VAAPI_VP9_SEG_LVL_ALT_L];
+    if (!seg->abs_delta)
+      level += base_level;
+    base_level = CLAMP (level, 0, GST_VAAPI_VP9_MAX_LOOP_FILTER);
+  }
+
+  if (!lf->delta_enabled) {
+    memset (levels, base_level, 4 * 2);
+    return;
+  }
+
+  /* Deltas are scaled up for high filter levels. Intra blocks only
+     use the reference frame delta */
+  scale = 1 << (base_level >> 5);
+  level = base_level + lf->ref_deltas[GST_VAAPI_VP9_INTRA_FRAME] * scale;
+  levels[0][0] = levels[0][1] = CLAMP (level, 0, GST_VAAPI_VP9_MAX_LOOP_FILTER);
+  for (ref = GST_VAAPI_VP9_LAST_FRAME; ref <= GST_VAAPI_VP9_ALTREF_FRAME;
+      ref++) {
+    for (mode = 0; mode < 2; mode++) {
+      level = base_level + lf->ref_deltas[ref] * scale +
+          lf->mode_deltas[mode] * scale;
+      levels[ref][mode] = CLAMP (level, 0, GST_VAAPI_VP9_MAX_LOOP_FILTER);
+    }
+  }
+}
@@ -0,0 +1,205 @@
+/*
+ *  gstvaapiutils_vp9_priv.h - VP9 related utilities
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_UTILS_VP9_PRIV_H
+#define GST_VAAPI_UTILS_VP9_PRIV_H
+
+#include <glib.h>
+#include "libgstvaapi_priv_check.h"
+
+G_BEGIN_DECLS
+
+#define GST_VAAPI_VP9_REF_FRAMES                8
+#define GST_VAAPI_VP9_REFS_PER_FRAME            3
+#define GST_VAAPI_VP9_MAX_SEGMENTS              8
+#define GST_VAAPI_VP9_SEG_TREE_PROBS            7
+#define GST_VAAPI_VP9_PREDICTION_PROBS          3
+#define GST_VAAPI_VP9_MAX_LOOP_FILTER           63
+#define GST_VAAPI_VP9_MAX_SUPERFRAME_FRAMES     8
+
+typedef struct _GstVaapiVp9LoopFilter           GstVaapiVp9LoopFilter;
+typedef struct _GstVaapiVp9Segmentation         GstVaapiVp9Segmentation;
+typedef struct _GstVaapiVp9FrameHdr             GstVaapiVp9FrameHdr;
+typedef struct _GstVaapiVp9Parser               GstVaapiVp9Parser;
+
+typedef enum
+{
+  GST_VAAPI_VP9_KEY_FRAME = 0,
+  GST_VAAPI_VP9_NON_KEY_FRAME = 1,
+} GstVaapiVp9FrameType;
+
+/* Reference frame types, as used by the loop filter deltas */
+typedef enum
+{
+  GST_VAAPI_VP9_INTRA_FRAME = 0,
+  GST_VAAPI_VP9_LAST_FRAME = 1,
+  GST_VAAPI_VP9_GOLDEN_FRAME = 2,
+  GST_VAAPI_VP9_ALTREF_FRAME = 3,
+} GstVaapiVp9RefFrameType;
+
+/* Interpolation filters, in the order the VA API expects them */
+typedef enum
+{
+  GST_VAAPI_VP9_INTERP_EIGHTTAP = 0,
+  GST_VAAPI_VP9_INTERP_EIGHTTAP_SMOOTH = 1,
+  GST_VAAPI_VP9_INTERP_EIGHTTAP_SHARP = 2,
+  GST_VAAPI_VP9_INTERP_BILINEAR = 3,
+  GST_VAAPI_VP9_INTERP_SWITCHABLE = 4,
+} GstVaapiVp9InterpFilter;
+
+typedef enum
+{
+  GST_VAAPI_VP9_SEG_LVL_ALT_Q = 0,
+  GST_VAAPI_VP9_SEG_LVL_ALT_L = 1,
+  GST_VAAPI_VP9_SEG_LVL_REF_FRAME = 2,
+  GST_VAAPI_VP9_SEG_LVL_SKIP = 3,
+  GST_VAAPI_VP9_SEG_LVL_MAX = 4,
+} GstVaapiVp9SegLevel;
+
+struct _GstVaapiVp9LoopFilter
+{
+  guint8 filter_level;
+  guint8 sharpness_level;
+  guint8 delta_enabled;
+  guint8 delta_update;
+  gint8 ref_deltas[4];
+  gint8 mode_deltas[2];
+};
+
+struct _GstVaapiVp9Segmentation
+{
+  guint8 enabled;
+  guint8 update_map;
+  guint8 temporal_update;
+  guint8 update_data;
+  guint8 abs_delta;
+  guint8 tree_probs[GST_VAAPI_VP9_SEG_TREE_PROBS];
+  guint8 pred_probs[GST_VAAPI_VP9_PREDICTION_PROBS];
+  guint8 feature_enabled[GST_VAAPI_VP9_MAX_SEGMENTS][GST_VAAPI_VP9_SEG_LVL_MAX];
+  gint16 feature_data[GST_VAAPI_VP9_MAX_SEGMENTS][GST_VAAPI_VP9_SEG_LVL_MAX];
+};
+
+/* The uncompressed header of a frame. The loop filter and segmentation
+   parameters are those in effect for the frame, i.e. the persistent
+   parser state updated with the frame header */
+struct _GstVaapiVp9FrameHdr
+{
+  guint profile;
+  guint show_existing_frame;
+  guint frame_to_show;
+  GstVaapiVp9FrameType frame_type;
+  guint show_frame;
+  guint error_resilient_mode;
+  guint intra_only;
+  guint reset_frame_context;
+  guint bit_depth;
+  guint color_space;
+  guint color_range;
+  guint subsampling_x;
+  guint subsampling_y;
+  guint width;
+  guint height;
+  guint render_width;
+  guint render_height;
+  guint refresh_frame_flags;
+  guint ref_frame_idx[GST_VAAPI_VP9_REFS_PER_FRAME];
+  guint ref_frame_sign_bias[GST_VAAPI_VP9_REFS_PER_FRAME];
+  guint allow_high_precision_mv;
+  GstVaapiVp9InterpFilter interp_filter;
+  guint refresh_frame_context;
+  guint frame_parallel_decoding_mode;
+  guint frame_context_idx;
+  guint base_q_idx;
+  gint delta_q_y_dc;
+  gint delta_q_uv_dc;
+  gint delta_q_uv_ac;
+  guint lossless;
+  guint tile_cols_log2;
+  guint tile_rows_log2;
+  GstVaapiVp9LoopFilter loop_filter;
+  GstVaapiVp9Segmentation segmentation;
+
+  /* Size of the uncompressed header, in bytes */
+  guint uncompressed_header_size;
+  /* Size of the compressed header that follows, in bytes */
+  guint compressed_header_size;
+};
+
+/* State carried over from one frame to the next */
+struct _GstVaapiVp9Parser
+{
+  GstVaapiVp9LoopFilter loop_filter;
+  GstVaapiVp9Segmentation segmentation;
+  guint bit_depth;
+  guint color_space;
+  guint color_range;
+  guint subsampling_x;
+  guint subsampling_y;
+  guint ref_width[GST_VAAPI_VP9_REF_FRAMES];
+  guint ref_height[GST_VAAPI_VP9_REF_FRAMES];
+};
+
+/* Resets the parser state, e.g. before the first frame */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_vp9_parser_init (GstVaapiVp9Parser * parser);
+
+/* Parses the uncompressed header of one frame, and updates the parser
+   state, including the sizes of the refreshed reference frames */
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_utils_vp9_parse_frame_header (GstVaapiVp9Parser * parser,
+    GstVaapiVp9FrameHdr * frame_hdr, const guint8 * data, guint size);
+
+/* Parses the superframe index at the end of data, if any. Returns the
+   number of frames, or zero if data is a single frame */
+G_GNUC_INTERNAL
+guint
+gst_vaapi_utils_vp9_parse_superframe_index (const guint8 * data, guint size,
+    guint frame_sizes[GST_VAAPI_VP9_MAX_SUPERFRAME_FRAMES],
+    guint * index_size_ptr);
+
+/* Returns the quantizer index of the segment */
+G_GNUC_INTERNAL
+guint
+gst_vaapi_utils_vp9_get_qindex (const GstVaapiVp9FrameHdr * frame_hdr,
+    guint segment_id);
+
+/* Returns the DC quantizer for qindex (8-bit samples) */
+G_GNUC_INTERNAL
+gint
+gst_vaapi_utils_vp9_get_dc_quant (gint qindex);
+
+/* Returns the AC quantizer for qindex (8-bit samples) */
+G_GNUC_INTERNAL
+gint
+gst_vaapi_utils_vp9_get_ac_quant (gint qindex);
+
+/* Computes the loop filter levels of the segment, per reference frame
+   type and per mode (ZEROMV, other modes) */
+G_GNUC_INTERNAL
+void
+gst_vaapi_utils_vp9_get_filter_levels (const GstVaapiVp9FrameHdr * frame_hdr,
+    guint segment_id, guint8 levels[4][2]);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_UTILS_VP9_PRIV_H */
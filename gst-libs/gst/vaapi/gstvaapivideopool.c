@@ -31,6 +31,7 @@
 #include "gstvaapivideopool.h"
 #include "gstvaapivideopool_priv.h"
 #include "gstvaapiobject.h"
+#include "gstvaapidisplay_priv.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -64,14 +65,21 @@ gst_vaapi_video_pool_init(GstVaapiVideoPool *pool, GstVaapiDisplay *display,
     pool->used_objects  = NULL;
     pool->used_count    = 0;
     pool->capacity      = 0;
+    pool->object_size   = 0;
+    pool->last_used_time = g_get_monotonic_time();
+    pool->has_foreign_objects = FALSE;
 
     g_queue_init(&pool->free_objects);
     g_mutex_init(&pool->mutex);
+
+    gst_vaapi_display_add_video_pool(display, pool);
 }
 
 void
 gst_vaapi_video_pool_finalize(GstVaapiVideoPool *pool)
 {
+    gst_vaapi_display_remove_video_pool(pool->display, pool);
+
     g_list_free_full(pool->used_objects, gst_vaapi_object_unref);
     g_queue_foreach(&pool->free_objects, (GFunc)gst_vaapi_object_unref, NULL);
     g_queue_clear(&pool->free_objects);
@@ -79,6 +87,65 @@ gst_vaapi_video_pool_finalize(GstVaapiVideoPool *pool)
     g_mutex_clear(&pool->mutex);
 }
 
+/* Sets the approximate amount of video memory used by each object of
+   the pool, for the purpose of display-wide memory accounting */
+void
+gst_vaapi_video_pool_set_object_size(GstVaapiVideoPool *pool, gsize size)
+{
+    g_mutex_lock(&pool->mutex);
+    pool->object_size = size;
+    g_mutex_unlock(&pool->mutex);
+}
+
+/* Retrieves the amount of memory held by objects in use and by free
+   objects that could be trimmed, and the last time an object was
+   acquired or released */
+void
+gst_vaapi_video_pool_get_memory_usage(GstVaapiVideoPool *pool,
+    gsize *used_bytes_ptr, gsize *free_bytes_ptr, gint64 *last_used_time_ptr)
+{
+    guint num_used, num_free;
+
+    g_mutex_lock(&pool->mutex);
+    num_used = pool->used_count;
+    num_free = g_queue_get_length(&pool->free_objects);
+    if (pool->has_foreign_objects) {
+        num_used += num_free;
+        num_free = 0;
+    }
+    if (used_bytes_ptr)
+        *used_bytes_ptr = num_used * pool->object_size;
+    if (free_bytes_ptr)
+        *free_bytes_ptr = num_free * pool->object_size;
+    if (last_used_time_ptr)
+        *last_used_time_ptr = pool->last_used_time;
+    g_mutex_unlock(&pool->mutex);
+}
+
+/* Removes the least recently released free objects from the pool, up
+   to at least max_bytes, and moves them to the objects queue. Those
+   are to be released by the caller, without the pool lock held.
+   Pools holding objects owned by someone else, e.g. the surfaces of a
+   VA context, are never trimmed */
+gsize
+gst_vaapi_video_pool_trim(GstVaapiVideoPool *pool, gsize max_bytes,
+    GQueue *objects)
+{
+    gsize bytes = 0;
+    gpointer object;
+
+    g_mutex_lock(&pool->mutex);
+    if (!pool->has_foreign_objects && pool->object_size > 0) {
+        while (bytes < max_bytes &&
+               (object = g_queue_pop_head(&pool->free_objects)) != NULL) {
+            g_queue_push_tail(objects, object);
+            bytes += pool->object_size;
+        }
+    }
+    g_mutex_unlock(&pool->mutex);
+    return bytes;
+}
+
 /**
  * gst_vaapi_video_pool_ref:
  * @pool: a #GstVaapiVideoPool
@@ -182,6 +249,7 @@ gst_vaapi_video_pool_get_object_unlocked(GstVaapiVideoPool *pool)
             return NULL;
     }
 
+    pool->last_used_time = g_get_monotonic_time();
     ++pool->used_count;
     pool->used_objects = g_list_prepend(pool->used_objects, object);
     return gst_vaapi_object_ref(object);
@@ -197,6 +265,11 @@ gst_vaapi_video_pool_get_object(GstVaapiVideoPool *pool)
     g_mutex_lock(&pool->mutex);
     object = gst_vaapi_video_pool_get_object_unlocked(pool);
     g_mutex_unlock(&pool->mutex);
+
+    /* The pool lock shall not be held here since this could trim
+       any pool, including this one */
+    if (object)
+        gst_vaapi_display_check_memory_budget(pool->display);
     return object;
 }
 
@@ -224,6 +297,7 @@ gst_vaapi_video_pool_put_object_unlocked(GstVaapiVideoPool *pool,
     --pool->used_count;
     pool->used_objects = g_list_delete_link(pool->used_objects, elem);
     g_queue_push_tail(&pool->free_objects, object);
+    pool->last_used_time = g_get_monotonic_time();
 }
 
 void
@@ -253,6 +327,7 @@ gst_vaapi_video_pool_add_object_unlocked(GstVaapiVideoPool *pool,
     gpointer object)
 {
     g_queue_push_tail(&pool->free_objects, gst_vaapi_object_ref(object));
+    pool->has_foreign_objects = TRUE;
     return TRUE;
 }
 
@@ -53,6 +53,9 @@ struct _GstVaapiVideoPool {
     guint               used_count;
     guint               capacity;
     GMutex              mutex;
+    gsize               object_size;
+    gint64              last_used_time;
+    guint               has_foreign_objects     : 1;
 };
 
 /**
@@ -78,6 +81,20 @@ G_GNUC_INTERNAL
 void
 gst_vaapi_video_pool_finalize(GstVaapiVideoPool *pool);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_video_pool_set_object_size(GstVaapiVideoPool *pool, gsize size);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_video_pool_get_memory_usage(GstVaapiVideoPool *pool,
+    gsize *used_bytes_ptr, gsize *free_bytes_ptr, gint64 *last_used_time_ptr);
+
+G_GNUC_INTERNAL
+gsize
+gst_vaapi_video_pool_trim(GstVaapiVideoPool *pool, gsize max_bytes,
+    GQueue *objects);
+
 /* Internal aliases */
 
 #define gst_vaapi_video_pool_ref_internal(pool) \
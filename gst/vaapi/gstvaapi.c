@@ -33,6 +33,9 @@
 #if USE_ENCODERS
 #include "gstvaapiencode_h264.h"
 #include "gstvaapiencode_mpeg2.h"
+#if USE_JPEG_ENCODER
+#include "gstvaapiencode_jpeg.h"
+#endif
 #endif
 
 #define PLUGIN_NAME     "vaapi"
@@ -66,6 +69,11 @@ plugin_init (GstPlugin *plugin)
     gst_element_register(plugin, "vaapiencode_mpeg2",
                          GST_RANK_PRIMARY,
                          GST_TYPE_VAAPIENCODE_MPEG2);
+#if USE_JPEG_ENCODER
+    gst_element_register(plugin, "vaapiencode_jpeg",
+                         GST_RANK_PRIMARY,
+                         GST_TYPE_VAAPIENCODE_JPEG);
+#endif
 #endif
 
     return TRUE;
@@ -43,13 +43,18 @@
 #include "gstvaapivideobufferpool.h"
 #include "gstvaapivideomemory.h"
 #endif
+#if USE_DMABUF
+#include "gstvaapidmabuf.h"
+#endif
 
 #include <gst/vaapi/gstvaapidecoder_h264.h>
+#include <gst/vaapi/gstvaapidecoder_h265.h>
 #include <gst/vaapi/gstvaapidecoder_jpeg.h>
 #include <gst/vaapi/gstvaapidecoder_mpeg2.h>
 #include <gst/vaapi/gstvaapidecoder_mpeg4.h>
 #include <gst/vaapi/gstvaapidecoder_vc1.h>
 #include <gst/vaapi/gstvaapidecoder_vp8.h>
+#include <gst/vaapi/gstvaapidecoder_vp9.h>
 
 #define GST_PLUGIN_NAME "vaapidecode"
 #define GST_PLUGIN_DESC "A VA-API based video decoder"
@@ -69,8 +74,10 @@ static const char gst_vaapidecode_sink_caps_str[] =
     GST_CAPS_CODEC("video/x-xvid")
     GST_CAPS_CODEC("video/x-h263")
     GST_CAPS_CODEC("video/x-h264")
+    GST_CAPS_CODEC("video/x-h265")
     GST_CAPS_CODEC("video/x-wmv")
     GST_CAPS_CODEC("video/x-vp8")
+    GST_CAPS_CODEC("video/x-vp9")
     GST_CAPS_CODEC("image/jpeg")
     ;
 
@@ -99,6 +106,13 @@ static GstStaticPadTemplate gst_vaapidecode_src_factory =
         GST_PAD_ALWAYS,
         GST_STATIC_CAPS(gst_vaapidecode_src_caps_str));
 
+enum {
+    PROP_0,
+
+    PROP_ERROR_CONCEALMENT,
+    PROP_ERROR_STATS,
+};
+
 G_DEFINE_TYPE_WITH_CODE(
     GstVaapiDecode,
     gst_vaapidecode,
@@ -325,6 +339,11 @@ gst_vaapidecode_push_decoded_frame(GstVideoDecoder *vdec,
         if (!meta)
             goto error_get_meta;
         gst_vaapi_video_meta_set_surface_proxy(meta, proxy);
+#if USE_DMABUF
+        if (!gst_vaapi_dmabuf_buffer_set_surface_proxy(
+                out_frame->output_buffer, proxy))
+            goto error_export_surface;
+#endif
 
         flags = gst_vaapi_surface_proxy_get_flags(proxy);
         if (flags & GST_VAAPI_SURFACE_PROXY_FLAG_INTERLACED) {
@@ -337,6 +356,9 @@ gst_vaapidecode_push_decoded_frame(GstVideoDecoder *vdec,
                 out_flags |= GST_VIDEO_BUFFER_FLAG_ONEFIELD;
             GST_BUFFER_FLAG_SET(out_frame->output_buffer, out_flags);
         }
+        if (flags & GST_VAAPI_SURFACE_PROXY_FLAG_CORRUPTED)
+            GST_BUFFER_FLAG_SET(out_frame->output_buffer,
+                GST_BUFFER_FLAG_CORRUPTED);
 
         crop_rect = gst_vaapi_surface_proxy_get_crop_rect(proxy);
         if (crop_rect) {
@@ -391,6 +413,15 @@ error_get_meta:
         return GST_FLOW_ERROR;
     }
 #endif
+#if USE_DMABUF
+error_export_surface:
+    {
+        GST_ERROR("failed to export decoded surface as DMA-BUF memory");
+        gst_video_decoder_drop_frame(vdec, out_frame);
+        gst_video_codec_frame_unref(out_frame);
+        return GST_FLOW_ERROR;
+    }
+#endif
 error_commit_buffer:
     {
         if (ret != GST_FLOW_FLUSHING)
@@ -509,6 +540,36 @@ gst_vaapidecode_finish(GstVideoDecoder *vdec)
 }
 
 #if GST_CHECK_VERSION(1,0,0)
+/* Returns the number of decoded surfaces downstream may hold, e.g.
+   vaapiencode while reordering frames. Should the decoded stream be
+   split, e.g. with a tee, each branch answers an allocation query of
+   its own, with its own pool, so the needs of all branches are added
+   up for as long as the caps do not change */
+static guint
+gst_vaapidecode_update_downstream_surfaces(GstVaapiDecode *decode,
+    GstCaps *caps, GstBufferPool *pool, guint min)
+{
+    GHashTableIter iter;
+    gpointer value;
+    guint num_surfaces = 0;
+
+    if (!decode->allocation_caps ||
+        !gst_caps_is_equal(caps, decode->allocation_caps)) {
+        gst_caps_replace(&decode->allocation_caps, caps);
+        g_hash_table_remove_all(decode->allocation_pools);
+    }
+
+    /* A branch that answers again replaces its previous needs */
+    if (pool)
+        g_hash_table_insert(decode->allocation_pools, gst_object_ref(pool),
+            GUINT_TO_POINTER(min));
+
+    g_hash_table_iter_init(&iter, decode->allocation_pools);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        num_surfaces += GPOINTER_TO_UINT(value);
+    return num_surfaces;
+}
+
 static gboolean
 gst_vaapidecode_decide_allocation(GstVideoDecoder *vdec, GstQuery *query)
 {
@@ -517,7 +578,7 @@ gst_vaapidecode_decide_allocation(GstVideoDecoder *vdec, GstQuery *query)
     GstBufferPool *pool;
     GstStructure *config;
     GstVideoInfo vi;
-    guint size, min, max;
+    guint size, min, max, num_surfaces;
     gboolean need_pool, update_pool;
     gboolean has_video_meta = FALSE;
     gboolean has_video_alignment = FALSE;
@@ -569,6 +630,8 @@ gst_vaapidecode_decide_allocation(GstVideoDecoder *vdec, GstQuery *query)
         gst_query_parse_nth_allocation_pool(query, 0, &pool, &size, &min, &max);
         size = MAX(size, vi.size);
         update_pool = TRUE;
+        num_surfaces = gst_vaapidecode_update_downstream_surfaces(decode,
+            caps, pool, min);
 
         /* Check whether downstream element proposed a bufferpool but did
            not provide a correct propose_allocation() implementation */
@@ -580,6 +643,8 @@ gst_vaapidecode_decide_allocation(GstVideoDecoder *vdec, GstQuery *query)
         size = vi.size;
         min = max = 0;
         update_pool = FALSE;
+        num_surfaces = gst_vaapidecode_update_downstream_surfaces(decode,
+            caps, NULL, 0);
     }
 
     if (!pool || !gst_buffer_pool_has_option(pool,
@@ -608,6 +673,11 @@ gst_vaapidecode_decide_allocation(GstVideoDecoder *vdec, GstQuery *query)
         if (has_texture_upload_meta)
             gst_buffer_pool_config_add_option(config,
                 GST_BUFFER_POOL_OPTION_VIDEO_GL_TEXTURE_UPLOAD_META);
+#endif
+#if USE_DMABUF
+        if (gst_vaapi_dmabuf_query_has_allocator(query))
+            gst_buffer_pool_config_add_option(config,
+                GST_BUFFER_POOL_OPTION_DMABUF_MEMORY);
 #endif
         gst_buffer_pool_set_config(pool, config);
     }
@@ -627,6 +697,13 @@ gst_vaapidecode_decide_allocation(GstVideoDecoder *vdec, GstQuery *query)
     }
 #endif
 
+    /* Allocate the surfaces held downstream on top of the decoder needs,
+       and wake up the decoder if it was waiting for a free one */
+    if (decode->decoder && num_surfaces > 0) {
+        gst_vaapi_decoder_set_extra_surfaces(decode->decoder, num_surfaces);
+        gst_vaapidecode_release(decode);
+    }
+
     if (update_pool)
         gst_query_set_nth_allocation_pool(query, 0, pool, size, min, max);
     else
@@ -699,6 +776,29 @@ gst_vaapidecode_create(GstVaapiDecode *decode, GstCaps *caps)
             }
         }
         break;
+#if USE_H265_DECODER
+    case GST_VAAPI_CODEC_H265:
+        decode->decoder = gst_vaapi_decoder_h265_new(dpy, caps);
+
+        /* Set the stream buffer alignment for better optimizations */
+        if (decode->decoder && caps) {
+            GstStructure * const structure = gst_caps_get_structure(caps, 0);
+            const gchar *str = NULL;
+
+            if ((str = gst_structure_get_string(structure, "alignment"))) {
+                GstVaapiStreamAlignH265 alignment;
+                if (g_strcmp0(str, "au") == 0)
+                    alignment = GST_VAAPI_STREAM_ALIGN_H265_AU;
+                else if (g_strcmp0(str, "nal") == 0)
+                    alignment = GST_VAAPI_STREAM_ALIGN_H265_NALU;
+                else
+                    alignment = GST_VAAPI_STREAM_ALIGN_H265_NONE;
+                gst_vaapi_decoder_h265_set_alignment(
+                    GST_VAAPI_DECODER_H265(decode->decoder), alignment);
+            }
+        }
+        break;
+#endif
     case GST_VAAPI_CODEC_WMV3:
     case GST_VAAPI_CODEC_VC1:
         decode->decoder = gst_vaapi_decoder_vc1_new(dpy, caps);
@@ -706,12 +806,28 @@ gst_vaapidecode_create(GstVaapiDecode *decode, GstCaps *caps)
 #if USE_JPEG_DECODER
     case GST_VAAPI_CODEC_JPEG:
         decode->decoder = gst_vaapi_decoder_jpeg_new(dpy, caps);
+
+        /* Decode each image in one pass if buffers are frame-aligned */
+        if (decode->decoder && caps) {
+            GstStructure * const structure = gst_caps_get_structure(caps, 0);
+            gboolean parsed = FALSE;
+
+            if (gst_structure_get_boolean(structure, "parsed", &parsed) &&
+                parsed)
+                gst_vaapi_decoder_jpeg_set_frame_aligned(
+                    GST_VAAPI_DECODER_JPEG(decode->decoder), TRUE);
+        }
         break;
 #endif
 #if USE_VP8_DECODER
     case GST_VAAPI_CODEC_VP8:
         decode->decoder = gst_vaapi_decoder_vp8_new(dpy, caps);
         break;
+#endif
+#if USE_VP9_DECODER
+    case GST_VAAPI_CODEC_VP9:
+        decode->decoder = gst_vaapi_decoder_vp9_new(dpy, caps);
+        break;
 #endif
     default:
         decode->decoder = NULL;
@@ -722,6 +838,13 @@ gst_vaapidecode_create(GstVaapiDecode *decode, GstCaps *caps)
 
     gst_vaapi_decoder_set_codec_state_changed_func(decode->decoder,
         gst_vaapi_decoder_state_changed, decode);
+    gst_vaapi_decoder_set_error_concealment(decode->decoder,
+        decode->error_concealment);
+
+    /* Allocate VA resources from the stream headers in caps, if any */
+    if (gst_vaapi_decoder_prepare(decode->decoder) !=
+        GST_VAAPI_DECODER_STATUS_SUCCESS)
+        GST_DEBUG_OBJECT(decode, "failed to prepare decoder from caps");
 
     decode->decoder_caps = gst_caps_ref(caps);
     return gst_pad_start_task(GST_VAAPI_PLUGIN_BASE_SRC_PAD(decode),
@@ -779,6 +902,74 @@ gst_vaapidecode_reset_full(GstVaapiDecode *decode, GstCaps *caps, gboolean hard)
     return gst_vaapidecode_create(decode, caps);
 }
 
+/* Returns the error concealment statistics of the current decoder */
+static GstStructure *
+gst_vaapidecode_get_error_stats(GstVaapiDecode *decode)
+{
+    GstVaapiDecoderErrorStats stats;
+
+    memset(&stats, 0, sizeof(stats));
+    GST_VIDEO_DECODER_STREAM_LOCK(decode);
+    if (decode->decoder)
+        gst_vaapi_decoder_get_error_stats(decode->decoder, &stats);
+    GST_VIDEO_DECODER_STREAM_UNLOCK(decode);
+
+    return gst_structure_new("GstVaapiDecodeErrorStats",
+        "corrupted-frames", G_TYPE_UINT, stats.num_corrupted_frames,
+        "concealed-references", G_TYPE_UINT, stats.num_concealed_refs,
+        "recoveries", G_TYPE_UINT, stats.num_recoveries,
+        "max-recovery-frames", G_TYPE_UINT, stats.max_recovery_frames,
+        NULL);
+}
+
+static void
+gst_vaapidecode_set_property(
+    GObject      *object,
+    guint         prop_id,
+    const GValue *value,
+    GParamSpec   *pspec
+)
+{
+    GstVaapiDecode * const decode = GST_VAAPIDECODE(object);
+
+    switch (prop_id) {
+    case PROP_ERROR_CONCEALMENT:
+        GST_VIDEO_DECODER_STREAM_LOCK(decode);
+        decode->error_concealment = g_value_get_boolean(value);
+        if (decode->decoder)
+            gst_vaapi_decoder_set_error_concealment(decode->decoder,
+                decode->error_concealment);
+        GST_VIDEO_DECODER_STREAM_UNLOCK(decode);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+gst_vaapidecode_get_property(
+    GObject    *object,
+    guint       prop_id,
+    GValue     *value,
+    GParamSpec *pspec
+)
+{
+    GstVaapiDecode * const decode = GST_VAAPIDECODE(object);
+
+    switch (prop_id) {
+    case PROP_ERROR_CONCEALMENT:
+        g_value_set_boolean(value, decode->error_concealment);
+        break;
+    case PROP_ERROR_STATS:
+        g_value_take_boxed(value, gst_vaapidecode_get_error_stats(decode));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
 static void
 gst_vaapidecode_finalize(GObject *object)
 {
@@ -787,6 +978,8 @@ gst_vaapidecode_finalize(GObject *object)
     gst_caps_replace(&decode->sinkpad_caps, NULL);
     gst_caps_replace(&decode->srcpad_caps,  NULL);
     gst_caps_replace(&decode->allowed_caps, NULL);
+    gst_caps_replace(&decode->allocation_caps, NULL);
+    g_hash_table_unref(decode->allocation_pools);
 
     g_cond_clear(&decode->decoder_finish_done);
     g_cond_clear(&decode->decoder_ready);
@@ -824,6 +1017,8 @@ gst_vaapidecode_close(GstVideoDecoder *vdec)
     GstVaapiDecode * const decode = GST_VAAPIDECODE(vdec);
 
     gst_vaapidecode_destroy(decode);
+    gst_caps_replace(&decode->allocation_caps, NULL);
+    g_hash_table_remove_all(decode->allocation_pools);
     gst_vaapi_plugin_base_close(GST_VAAPI_PLUGIN_BASE(decode));
     return TRUE;
 }
@@ -945,7 +1140,9 @@ gst_vaapidecode_class_init(GstVaapiDecodeClass *klass)
 
     gst_vaapi_plugin_base_class_init(GST_VAAPI_PLUGIN_BASE_CLASS(klass));
 
-    object_class->finalize   = gst_vaapidecode_finalize;
+    object_class->finalize     = gst_vaapidecode_finalize;
+    object_class->set_property = gst_vaapidecode_set_property;
+    object_class->get_property = gst_vaapidecode_get_property;
 
     element_class->change_state =
         GST_DEBUG_FUNCPTR(gst_vaapidecode_change_state);
@@ -976,6 +1173,43 @@ gst_vaapidecode_class_init(GstVaapiDecodeClass *klass)
     /* src pad */
     pad_template = gst_static_pad_template_get(&gst_vaapidecode_src_factory);
     gst_element_class_add_pad_template(element_class, pad_template);
+
+    /**
+     * GstVaapiDecode:error-concealment:
+     *
+     * When enabled, MPEG-2 and H.264 frames with missing slices or
+     * reference frames are decoded anyway, instead of being dropped
+     * until the next intra frame. Such frames are marked with the
+     * GST_BUFFER_FLAG_CORRUPTED flag.
+     */
+    g_object_class_install_property
+        (object_class,
+         PROP_ERROR_CONCEALMENT,
+         g_param_spec_boolean("error-concealment",
+                              "Error concealment",
+                              "Keeps decoding frames with missing data",
+                              FALSE,
+                              G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    /**
+     * GstVaapiDecode:error-stats:
+     *
+     * The error concealment statistics since the last decoder reset,
+     * as a #GstStructure with the following unsigned integer fields:
+     * "corrupted-frames", the number of frames output as corrupted;
+     * "concealed-references", the number of substituted reference
+     * frames; "recoveries", the number of times clean frames were
+     * output again after corrupted ones; and "max-recovery-frames",
+     * the longest run of corrupted frames.
+     */
+    g_object_class_install_property
+        (object_class,
+         PROP_ERROR_STATS,
+         g_param_spec_boxed("error-stats",
+                            "Error statistics",
+                            "Error concealment statistics",
+                            GST_TYPE_STRUCTURE,
+                            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static gboolean
@@ -1099,6 +1333,9 @@ gst_vaapidecode_init(GstVaapiDecode *decode)
     decode->decoder             = NULL;
     decode->decoder_caps        = NULL;
     decode->allowed_caps        = NULL;
+    decode->allocation_caps     = NULL;
+    decode->allocation_pools    = g_hash_table_new_full(NULL, NULL,
+        gst_object_unref, NULL);
     decode->decoder_loop_status = GST_FLOW_OK;
 
     g_mutex_init(&decode->decoder_mutex);
@@ -71,8 +71,11 @@ struct _GstVaapiDecode {
     GCond               decoder_finish_done;
     GstCaps            *decoder_caps;
     GstCaps            *allowed_caps;
+    GstCaps            *allocation_caps;
+    GHashTable         *allocation_pools;
     guint               current_frame_size;
     guint               has_texture_upload_meta : 1;
+    guint               error_concealment       : 1;
 };
 
 struct _GstVaapiDecodeClass {
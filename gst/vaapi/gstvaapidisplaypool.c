@@ -0,0 +1,571 @@
+/*
+ *  gstvaapidisplaypool.c - Pool of VA displays for multiple render nodes
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapidisplaypool
+ * @short_description: Pool of VA displays for multiple render nodes
+ *
+ * The display pool keeps track of all DRM render nodes available on
+ * the system, and hands out the #GstVaapiDisplay of the device that
+ * is selected by the current load-balancing policy. The default
+ * policy picks the device with the fewest active VA contexts and VA
+ * surfaces. The policy of the default pool can be changed through
+ * the GST_VAAPI_DISPLAY_POOL_POLICY environment variable, which can
+ * be one of "least-loaded", "round-robin" or "first".
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#if USE_DRM
+# include <gst/vaapi/gstvaapidisplay_drm.h>
+#endif
+#include "gstvaapidisplaypool.h"
+
+#define DEFAULT_DEVICE_DIR      "/dev/dri"
+#define RENDER_NODE_PREFIX      "renderD"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapi_display_pool);
+#define GST_CAT_DEFAULT gst_debug_vaapi_display_pool
+
+struct _GstVaapiDisplayPool
+{
+  GMutex mutex;
+  GPtrArray *devices;
+  GstVaapiDisplayPoolPolicyFunc policy;
+  gpointer policy_data;
+};
+
+typedef struct
+{
+  const gchar *name;
+  GstVaapiDisplayPoolPolicyFunc func;
+} PolicyMap;
+
+static const PolicyMap g_policy_map[] = {
+  {"least-loaded", gst_vaapi_display_pool_policy_least_loaded},
+  {"round-robin", gst_vaapi_display_pool_policy_round_robin},
+  {"first", gst_vaapi_display_pool_policy_first},
+  {NULL,}
+};
+
+static void
+device_free (GstVaapiDisplayPoolDevice * device)
+{
+  if (!device)
+    return;
+
+  gst_vaapi_display_replace (&device->display, NULL);
+  g_free (device->path);
+  g_slice_free (GstVaapiDisplayPoolDevice, device);
+}
+
+static GstVaapiDisplayPoolDevice *
+device_new (const gchar * path)
+{
+  GstVaapiDisplayPoolDevice *device;
+
+  device = g_slice_new0 (GstVaapiDisplayPoolDevice);
+  if (!device)
+    return NULL;
+
+  device->path = g_strdup (path);
+  if (!device->path)
+    goto error;
+  return device;
+
+error:
+  device_free (device);
+  return NULL;
+}
+
+static gint
+compare_device_paths (gconstpointer a, gconstpointer b)
+{
+  const GstVaapiDisplayPoolDevice *const device_a =
+      *(GstVaapiDisplayPoolDevice **) a;
+  const GstVaapiDisplayPoolDevice *const device_b =
+      *(GstVaapiDisplayPoolDevice **) b;
+
+  return strcmp (device_a->path, device_b->path);
+}
+
+/* Updates the device usage counters from the opened display, if any */
+static void
+device_update_usage (GstVaapiDisplayPoolDevice * device)
+{
+  if (device->display)
+    gst_vaapi_display_get_usage (device->display, &device->num_contexts,
+        &device->num_surfaces);
+}
+
+/* Opens a new display for the device. This is called without the pool
+   mutex held, since this could take a while */
+static GstVaapiDisplay *
+device_open_display (GstVaapiDisplayPoolDevice * device)
+{
+#if USE_DRM
+  return gst_vaapi_display_drm_new (device->path);
+#else
+  return NULL;
+#endif
+}
+
+/* Selects a device among the working ones, with the pool mutex held */
+static GstVaapiDisplayPoolDevice *
+select_device_unlocked (GstVaapiDisplayPool * pool)
+{
+  GstVaapiDisplayPoolDevice *device = NULL;
+  GPtrArray *candidates;
+  guint i;
+
+  candidates = g_ptr_array_sized_new (pool->devices->len);
+  for (i = 0; i < pool->devices->len; i++) {
+    GstVaapiDisplayPoolDevice *const d = g_ptr_array_index (pool->devices, i);
+    if (d->is_broken)
+      continue;
+    device_update_usage (d);
+    g_ptr_array_add (candidates, d);
+  }
+
+  if (candidates->len > 0) {
+    i = pool->policy (candidates, pool->policy_data);
+    if (i < candidates->len)
+      device = g_ptr_array_index (candidates, i);
+  }
+  g_ptr_array_free (candidates, TRUE);
+  return device;
+}
+
+/* Detaches the displays that no longer hold any VA context or VA
+   surface, but the one of the selected device, so that devices no
+   longer in use do not keep a VA display open. Usage counters shall be
+   up-to-date, and the detached displays are released by the caller,
+   without the pool mutex held */
+static void
+detach_idle_displays_unlocked (GstVaapiDisplayPool * pool,
+    GstVaapiDisplayPoolDevice * selected, GPtrArray * displays)
+{
+  guint i;
+
+  for (i = 0; i < pool->devices->len; i++) {
+    GstVaapiDisplayPoolDevice *const device =
+        g_ptr_array_index (pool->devices, i);
+
+    if (device == selected || !device->display)
+      continue;
+    if (device->num_contexts > 0 || device->num_surfaces > 0)
+      continue;
+    GST_DEBUG ("release idle display of %s", device->path);
+    g_ptr_array_add (displays, device->display);
+    device->display = NULL;
+  }
+}
+
+/**
+ * gst_vaapi_display_pool_new:
+ *
+ * Creates a new empty display pool, with the least-loaded policy.
+ *
+ * Return value: the newly allocated #GstVaapiDisplayPool
+ */
+GstVaapiDisplayPool *
+gst_vaapi_display_pool_new (void)
+{
+  GstVaapiDisplayPool *pool;
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_vaapi_display_pool,
+      "vaapidisplaypool", 0, "VA display pool");
+
+  pool = g_slice_new0 (GstVaapiDisplayPool);
+  if (!pool)
+    return NULL;
+
+  g_mutex_init (&pool->mutex);
+  pool->devices = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      device_free);
+  pool->policy = gst_vaapi_display_pool_policy_least_loaded;
+  return pool;
+}
+
+/**
+ * gst_vaapi_display_pool_free:
+ * @pool: a #GstVaapiDisplayPool
+ *
+ * Releases all devices of @pool, along with the displays it holds.
+ */
+void
+gst_vaapi_display_pool_free (GstVaapiDisplayPool * pool)
+{
+  if (!pool)
+    return;
+
+  g_ptr_array_unref (pool->devices);
+  g_mutex_clear (&pool->mutex);
+  g_slice_free (GstVaapiDisplayPool, pool);
+}
+
+/**
+ * gst_vaapi_display_pool_get_default:
+ *
+ * Returns the process-wide display pool, filled in with the DRM render
+ * nodes from /dev/dri. The pool keeps a reference to the displays it
+ * opened, so that their usage could be tracked, until they no longer
+ * hold any VA context or VA surface.
+ *
+ * Return value: the default #GstVaapiDisplayPool, owned by the plugin
+ */
+GstVaapiDisplayPool *
+gst_vaapi_display_pool_get_default (void)
+{
+  static gsize g_default_pool = 0;
+
+  if (g_once_init_enter (&g_default_pool)) {
+    GstVaapiDisplayPool *const pool = gst_vaapi_display_pool_new ();
+    const gchar *policy_name;
+
+    if (pool) {
+      gst_vaapi_display_pool_scan (pool, DEFAULT_DEVICE_DIR);
+      policy_name = g_getenv ("GST_VAAPI_DISPLAY_POOL_POLICY");
+      if (policy_name &&
+          !gst_vaapi_display_pool_set_policy_by_name (pool, policy_name))
+        GST_WARNING ("unknown display pool policy '%s'", policy_name);
+    }
+    g_once_init_leave (&g_default_pool, GPOINTER_TO_SIZE (pool));
+  }
+  return GSIZE_TO_POINTER (g_default_pool);
+}
+
+/**
+ * gst_vaapi_display_pool_add_device:
+ * @pool: a #GstVaapiDisplayPool
+ * @path: the DRM device path
+ *
+ * Appends a device to @pool. The display is only opened when the
+ * device is selected for the first time.
+ *
+ * Return value: the newly added #GstVaapiDisplayPoolDevice, owned by
+ *   @pool, or %NULL on error
+ */
+GstVaapiDisplayPoolDevice *
+gst_vaapi_display_pool_add_device (GstVaapiDisplayPool * pool,
+    const gchar * path)
+{
+  GstVaapiDisplayPoolDevice *device;
+
+  g_return_val_if_fail (pool != NULL, NULL);
+  g_return_val_if_fail (path != NULL, NULL);
+
+  device = device_new (path);
+  if (!device)
+    return NULL;
+
+  g_mutex_lock (&pool->mutex);
+  g_ptr_array_add (pool->devices, device);
+  g_mutex_unlock (&pool->mutex);
+  GST_DEBUG ("added device %s", path);
+  return device;
+}
+
+/**
+ * gst_vaapi_display_pool_scan:
+ * @pool: a #GstVaapiDisplayPool
+ * @dirname: the directory holding the DRM device nodes
+ *
+ * Adds all DRM render nodes (renderD*) found in @dirname to @pool,
+ * sorted by name.
+ *
+ * Return value: the number of added devices
+ */
+guint
+gst_vaapi_display_pool_scan (GstVaapiDisplayPool * pool, const gchar * dirname)
+{
+  GPtrArray *devices;
+  const gchar *name;
+  GDir *dir;
+  guint i;
+
+  g_return_val_if_fail (pool != NULL, 0);
+  g_return_val_if_fail (dirname != NULL, 0);
+
+  dir = g_dir_open (dirname, 0, NULL);
+  if (!dir)
+    return 0;
+
+  devices = g_ptr_array_new ();
+  while ((name = g_dir_read_name (dir)) != NULL) {
+    GstVaapiDisplayPoolDevice *device;
+    gchar *path;
+
+    if (!g_str_has_prefix (name, RENDER_NODE_PREFIX))
+      continue;
+
+    path = g_build_filename (dirname, name, NULL);
+    device = device_new (path);
+    g_free (path);
+    if (device)
+      g_ptr_array_add (devices, device);
+  }
+  g_dir_close (dir);
+
+  g_ptr_array_sort (devices, compare_device_paths);
+  g_mutex_lock (&pool->mutex);
+  for (i = 0; i < devices->len; i++) {
+    GstVaapiDisplayPoolDevice *const device = g_ptr_array_index (devices, i);
+    GST_DEBUG ("found render node %s", device->path);
+    g_ptr_array_add (pool->devices, device);
+  }
+  g_mutex_unlock (&pool->mutex);
+
+  i = devices->len;
+  g_ptr_array_free (devices, TRUE);
+  return i;
+}
+
+/**
+ * gst_vaapi_display_pool_get_devices:
+ * @pool: a #GstVaapiDisplayPool
+ *
+ * Returns the devices of @pool. This is mostly useful for testing
+ * policies with fake devices, for which usage counters can be set
+ * directly since they never get a display.
+ *
+ * Return value: the #GPtrArray of #GstVaapiDisplayPoolDevice objects,
+ *   owned by @pool
+ */
+GPtrArray *
+gst_vaapi_display_pool_get_devices (GstVaapiDisplayPool * pool)
+{
+  g_return_val_if_fail (pool != NULL, NULL);
+
+  return pool->devices;
+}
+
+/**
+ * gst_vaapi_display_pool_set_policy:
+ * @pool: a #GstVaapiDisplayPool
+ * @func: the #GstVaapiDisplayPoolPolicyFunc, or %NULL for the default
+ * @user_data: user data passed to @func
+ *
+ * Sets the load-balancing policy used to select the next device.
+ */
+void
+gst_vaapi_display_pool_set_policy (GstVaapiDisplayPool * pool,
+    GstVaapiDisplayPoolPolicyFunc func, gpointer user_data)
+{
+  g_return_if_fail (pool != NULL);
+
+  g_mutex_lock (&pool->mutex);
+  pool->policy = func ? func : gst_vaapi_display_pool_policy_least_loaded;
+  pool->policy_data = user_data;
+  g_mutex_unlock (&pool->mutex);
+}
+
+/**
+ * gst_vaapi_display_pool_set_policy_by_name:
+ * @pool: a #GstVaapiDisplayPool
+ * @name: the name of a built-in policy
+ *
+ * Sets one of the "least-loaded", "round-robin" or "first" built-in
+ * load-balancing policies.
+ *
+ * Return value: %TRUE if @name is a known policy
+ */
+gboolean
+gst_vaapi_display_pool_set_policy_by_name (GstVaapiDisplayPool * pool,
+    const gchar * name)
+{
+  const PolicyMap *m;
+
+  g_return_val_if_fail (pool != NULL, FALSE);
+  g_return_val_if_fail (name != NULL, FALSE);
+
+  for (m = g_policy_map; m->name != NULL; m++) {
+    if (strcmp (m->name, name) == 0) {
+      gst_vaapi_display_pool_set_policy (pool, m->func, NULL);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+ * gst_vaapi_display_pool_select_device:
+ * @pool: a #GstVaapiDisplayPool
+ *
+ * Refreshes the usage counters of all devices, and selects the next
+ * device according to the current policy. Devices that failed to open
+ * are not considered.
+ *
+ * Return value: the selected #GstVaapiDisplayPoolDevice, owned by
+ *   @pool, or %NULL if there is none
+ */
+GstVaapiDisplayPoolDevice *
+gst_vaapi_display_pool_select_device (GstVaapiDisplayPool * pool)
+{
+  GstVaapiDisplayPoolDevice *device;
+
+  g_return_val_if_fail (pool != NULL, NULL);
+
+  g_mutex_lock (&pool->mutex);
+  device = select_device_unlocked (pool);
+  g_mutex_unlock (&pool->mutex);
+  return device;
+}
+
+/**
+ * gst_vaapi_display_pool_acquire:
+ * @pool: a #GstVaapiDisplayPool
+ *
+ * Selects the next device according to the current policy, and
+ * returns its display, opening it if needed. If the device cannot be
+ * opened, it is no longer considered and the next device is tried.
+ * The displays of the other devices are released if they no longer
+ * hold any VA context or VA surface.
+ *
+ * Return value: a new reference to a #GstVaapiDisplay, or %NULL if
+ *   no device could be opened
+ */
+GstVaapiDisplay *
+gst_vaapi_display_pool_acquire (GstVaapiDisplayPool * pool)
+{
+  GstVaapiDisplayPoolDevice *device;
+  GstVaapiDisplay *display = NULL, *new_display;
+  GPtrArray *idle_displays;
+
+  g_return_val_if_fail (pool != NULL, NULL);
+
+  idle_displays = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_vaapi_display_unref);
+
+  g_mutex_lock (&pool->mutex);
+  while ((device = select_device_unlocked (pool)) != NULL) {
+    /* The device is accounted for before its display is opened, so
+       that concurrent requests get spread over the other devices */
+    device->num_acquired++;
+    if (!device->display) {
+      g_mutex_unlock (&pool->mutex);
+      new_display = device_open_display (device);
+      g_mutex_lock (&pool->mutex);
+      if (!new_display) {
+        GST_WARNING ("failed to open %s", device->path);
+        device->is_broken = TRUE;
+        continue;
+      }
+
+      /* Another request could have opened the device meanwhile */
+      if (!device->display)
+        device->display = new_display;
+      else
+        g_ptr_array_add (idle_displays, new_display);
+    }
+    display = gst_vaapi_display_ref (device->display);
+    GST_DEBUG ("selected %s (%u contexts, %u surfaces)", device->path,
+        device->num_contexts, device->num_surfaces);
+    detach_idle_displays_unlocked (pool, device, idle_displays);
+    break;
+  }
+  g_mutex_unlock (&pool->mutex);
+
+  g_ptr_array_free (idle_displays, TRUE);
+  return display;
+}
+
+/**
+ * gst_vaapi_display_pool_policy_least_loaded:
+ * @devices: the candidate devices
+ * @user_data: unused
+ *
+ * Selects the device with the fewest active VA contexts, then the
+ * fewest active VA surfaces. Ties are broken by the number of times
+ * the devices were handed out, so that pipelines starting at the same
+ * time, i.e. without any VA context yet, are spread over all devices.
+ *
+ * Return value: the index of the least loaded device
+ */
+guint
+gst_vaapi_display_pool_policy_least_loaded (GPtrArray * devices,
+    gpointer user_data)
+{
+  const GstVaapiDisplayPoolDevice *best = NULL;
+  guint i, best_index = 0;
+
+  for (i = 0; i < devices->len; i++) {
+    const GstVaapiDisplayPoolDevice *const device =
+        g_ptr_array_index (devices, i);
+
+    if (best) {
+      if (device->num_contexts != best->num_contexts) {
+        if (device->num_contexts > best->num_contexts)
+          continue;
+      } else if (device->num_surfaces != best->num_surfaces) {
+        if (device->num_surfaces > best->num_surfaces)
+          continue;
+      } else if (device->num_acquired >= best->num_acquired)
+        continue;
+    }
+    best = device;
+    best_index = i;
+  }
+  return best_index;
+}
+
+/**
+ * gst_vaapi_display_pool_policy_round_robin:
+ * @devices: the candidate devices
+ * @user_data: unused
+ *
+ * Selects the device that was handed out the fewest times, regardless
+ * of its actual usage.
+ *
+ * Return value: the index of the next device in turn
+ */
+guint
+gst_vaapi_display_pool_policy_round_robin (GPtrArray * devices,
+    gpointer user_data)
+{
+  guint i, best_index = 0;
+
+  for (i = 1; i < devices->len; i++) {
+    const GstVaapiDisplayPoolDevice *const device =
+        g_ptr_array_index (devices, i);
+    const GstVaapiDisplayPoolDevice *const best =
+        g_ptr_array_index (devices, best_index);
+
+    if (device->num_acquired < best->num_acquired)
+      best_index = i;
+  }
+  return best_index;
+}
+
+/**
+ * gst_vaapi_display_pool_policy_first:
+ * @devices: the candidate devices
+ * @user_data: unused
+ *
+ * Always selects the first working device, i.e. the legacy behaviour.
+ *
+ * Return value: 0
+ */
+guint
+gst_vaapi_display_pool_policy_first (GPtrArray * devices, gpointer user_data)
+{
+  return 0;
+}
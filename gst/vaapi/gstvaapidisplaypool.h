@@ -0,0 +1,128 @@
+/*
+ *  gstvaapidisplaypool.h - Pool of VA displays for multiple render nodes
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_DISPLAY_POOL_H
+#define GST_VAAPI_DISPLAY_POOL_H
+
+#include <gst/vaapi/gstvaapidisplay.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiDisplayPool GstVaapiDisplayPool;
+typedef struct _GstVaapiDisplayPoolDevice GstVaapiDisplayPoolDevice;
+
+/**
+ * GstVaapiDisplayPoolDevice:
+ * @path: the DRM device path
+ * @display: the #GstVaapiDisplay opened for @path, or %NULL if none
+ *   was needed yet, or if it was released while idle
+ * @num_contexts: the number of active VA contexts on @display
+ * @num_surfaces: the number of active VA surfaces on @display
+ * @num_acquired: the number of times @display was handed out
+ *
+ * A device known to a #GstVaapiDisplayPool. The usage counters are
+ * refreshed from @display prior to any device selection.
+ */
+struct _GstVaapiDisplayPoolDevice
+{
+  gchar *path;
+  GstVaapiDisplay *display;
+  guint num_contexts;
+  guint num_surfaces;
+  guint num_acquired;
+
+  /*< private >*/
+  guint is_broken:1;
+};
+
+/**
+ * GstVaapiDisplayPoolPolicyFunc:
+ * @devices: the candidate #GstVaapiDisplayPoolDevice objects
+ * @user_data: the user data passed to gst_vaapi_display_pool_set_policy()
+ *
+ * Selects a device among @devices, which is never empty.
+ *
+ * Return value: the index of the selected device in @devices
+ */
+typedef guint (*GstVaapiDisplayPoolPolicyFunc) (GPtrArray * devices,
+    gpointer user_data);
+
+G_GNUC_INTERNAL
+GstVaapiDisplayPool *
+gst_vaapi_display_pool_new (void);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_pool_free (GstVaapiDisplayPool * pool);
+
+G_GNUC_INTERNAL
+GstVaapiDisplayPool *
+gst_vaapi_display_pool_get_default (void);
+
+G_GNUC_INTERNAL
+GstVaapiDisplayPoolDevice *
+gst_vaapi_display_pool_add_device (GstVaapiDisplayPool * pool,
+    const gchar * path);
+
+G_GNUC_INTERNAL
+guint
+gst_vaapi_display_pool_scan (GstVaapiDisplayPool * pool, const gchar * dirname);
+
+G_GNUC_INTERNAL
+GPtrArray *
+gst_vaapi_display_pool_get_devices (GstVaapiDisplayPool * pool);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_pool_set_policy (GstVaapiDisplayPool * pool,
+    GstVaapiDisplayPoolPolicyFunc func, gpointer user_data);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_display_pool_set_policy_by_name (GstVaapiDisplayPool * pool,
+    const gchar * name);
+
+G_GNUC_INTERNAL
+GstVaapiDisplayPoolDevice *
+gst_vaapi_display_pool_select_device (GstVaapiDisplayPool * pool);
+
+G_GNUC_INTERNAL
+GstVaapiDisplay *
+gst_vaapi_display_pool_acquire (GstVaapiDisplayPool * pool);
+
+/* Built-in policies */
+G_GNUC_INTERNAL
+guint
+gst_vaapi_display_pool_policy_least_loaded (GPtrArray * devices,
+    gpointer user_data);
+
+G_GNUC_INTERNAL
+guint
+gst_vaapi_display_pool_policy_round_robin (GPtrArray * devices,
+    gpointer user_data);
+
+G_GNUC_INTERNAL
+guint
+gst_vaapi_display_pool_policy_first (GPtrArray * devices, gpointer user_data);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_DISPLAY_POOL_H */
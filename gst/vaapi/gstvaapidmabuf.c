@@ -0,0 +1,416 @@
+/*
+ *  gstvaapidmabuf.c - DMA-BUF import/export of VA surfaces
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapidmabuf
+ * @short_description: DMA-BUF import/export of VA surfaces
+ *
+ * Buffers made of a single DMA-BUF memory, e.g. from V4L2 capture
+ * devices, are imported into VA surfaces without any copy. The
+ * surface is cached on the memory, so that buffers recycled by the
+ * producer are only imported once.
+ *
+ * Conversely, VA surfaces are exported as #GstDmaBufAllocator memory
+ * for downstream DRM consumers. The exported memory owns its own
+ * file descriptor, and holds a reference to the surface as long as
+ * it lives.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <unistd.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include <gst/vaapi/video-format.h>
+#include "gstvaapidmabuf.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapi_dmabuf);
+#define GST_CAT_DEFAULT gst_debug_vaapi_dmabuf
+
+static void
+ensure_debug_category (void)
+{
+  static gsize init = 0;
+
+  if (g_once_init_enter (&init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_debug_vaapi_dmabuf, "vaapidmabuf", 0,
+        "VA-API DMA-BUF helpers");
+    g_once_init_leave (&init, 1);
+  }
+}
+
+/* The VA surface imported from a DMA-BUF memory, along with the plane
+   layout it was imported with */
+typedef struct
+{
+  GstVaapiSurface *surface;
+  GstVideoInfo info;
+} ImportedSurface;
+
+static void
+imported_surface_free (ImportedSurface * imported)
+{
+  gst_vaapi_object_unref (imported->surface);
+  g_slice_free (ImportedSurface, imported);
+}
+
+static GQuark
+imported_surface_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (!quark)
+    quark = g_quark_from_static_string ("GstVaapiDmaBufImportedSurface");
+  return quark;
+}
+
+/* The VA surface proxy exported as a DMA-BUF memory */
+static GQuark
+exported_proxy_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (!quark)
+    quark = g_quark_from_static_string ("GstVaapiDmaBufExportedProxy");
+  return quark;
+}
+
+/**
+ * gst_vaapi_dmabuf_query_has_allocator:
+ * @query: an allocation #GstQuery
+ *
+ * Checks whether the downstream element proposed a DMA-BUF allocator,
+ * i.e. that it can consume DMA-BUF memory without mapping it.
+ *
+ * Return value: %TRUE if a DMA-BUF allocator was proposed
+ */
+gboolean
+gst_vaapi_dmabuf_query_has_allocator (GstQuery * query)
+{
+  GstAllocator *allocator;
+  gboolean found = FALSE;
+  guint i, n;
+
+  g_return_val_if_fail (query != NULL, FALSE);
+
+  n = gst_query_get_n_allocation_params (query);
+  for (i = 0; i < n && !found; i++) {
+    gst_query_parse_nth_allocation_param (query, i, &allocator, NULL);
+    if (!allocator)
+      continue;
+    found = g_strcmp0 (allocator->mem_type, GST_ALLOCATOR_DMABUF) == 0;
+    gst_object_unref (allocator);
+  }
+  return found;
+}
+
+/* Returns the number of lines of the supplied plane */
+static guint
+get_plane_height (const GstVideoInfo * vip, guint plane)
+{
+  const GstVideoFormatInfo *const finfo = vip->finfo;
+  guint i;
+
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, i) == plane)
+      return GST_VIDEO_INFO_COMP_HEIGHT (vip, i);
+  }
+  return 0;
+}
+
+/**
+ * gst_vaapi_dmabuf_get_layout:
+ * @buffer: a #GstBuffer
+ * @vip: the negotiated #GstVideoInfo
+ * @out_vip: the location where to store the pixels layout
+ *
+ * Checks whether @buffer can be imported into a VA surface, i.e. that
+ * it is made of a single DMA-BUF memory holding all the planes, and
+ * determines the plane offsets and strides within the DMA-BUF. Those
+ * come from the #GstVideoMeta, if any, or from @vip otherwise. The
+ * size of @out_vip is the size of the whole DMA-BUF.
+ *
+ * Return value: %TRUE if @buffer can be imported
+ */
+gboolean
+gst_vaapi_dmabuf_get_layout (GstBuffer * buffer, const GstVideoInfo * vip,
+    GstVideoInfo * out_vip)
+{
+  GstVideoMeta *vmeta;
+  GstMemory *mem;
+  gsize offset, maxsize, plane_end;
+  guint i, height;
+
+  g_return_val_if_fail (buffer != NULL, FALSE);
+  g_return_val_if_fail (vip != NULL, FALSE);
+  g_return_val_if_fail (out_vip != NULL, FALSE);
+
+  if (gst_buffer_n_memory (buffer) != 1)
+    return FALSE;
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (!gst_is_dmabuf_memory (mem))
+    return FALSE;
+  if (!gst_vaapi_video_format_to_va_format (GST_VIDEO_INFO_FORMAT (vip)))
+    return FALSE;
+
+  *out_vip = *vip;
+  vmeta = gst_buffer_get_video_meta (buffer);
+  if (vmeta) {
+    if (vmeta->format != GST_VIDEO_INFO_FORMAT (vip) ||
+        vmeta->width != GST_VIDEO_INFO_WIDTH (vip) ||
+        vmeta->height != GST_VIDEO_INFO_HEIGHT (vip) ||
+        vmeta->n_planes != GST_VIDEO_INFO_N_PLANES (vip))
+      return FALSE;
+    for (i = 0; i < vmeta->n_planes; i++) {
+      GST_VIDEO_INFO_PLANE_OFFSET (out_vip, i) = vmeta->offset[i];
+      GST_VIDEO_INFO_PLANE_STRIDE (out_vip, i) = vmeta->stride[i];
+    }
+  }
+
+  /* Offsets are relative to the start of the DMA-BUF */
+  gst_memory_get_sizes (mem, &offset, &maxsize);
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (out_vip); i++) {
+    if (GST_VIDEO_INFO_PLANE_STRIDE (out_vip, i) <= 0)
+      return FALSE;
+    GST_VIDEO_INFO_PLANE_OFFSET (out_vip, i) += offset;
+
+    height = get_plane_height (out_vip, i);
+    plane_end = GST_VIDEO_INFO_PLANE_OFFSET (out_vip, i) +
+        (gsize) GST_VIDEO_INFO_PLANE_STRIDE (out_vip, i) * height;
+    if (plane_end > maxsize)
+      return FALSE;
+  }
+  GST_VIDEO_INFO_SIZE (out_vip) = maxsize;
+  return TRUE;
+}
+
+/* Producers could recycle the same DMA-BUF with another plane layout,
+   e.g. after a renegotiation, so offsets and strides have to match too */
+static gboolean
+is_compatible_surface (ImportedSurface * imported, GstVaapiDisplay * display,
+    const GstVideoInfo * vip)
+{
+  const GstVideoInfo *const surface_vip = &imported->info;
+  guint i;
+
+  if (gst_vaapi_object_get_display (GST_VAAPI_OBJECT (imported->surface)) !=
+      display)
+    return FALSE;
+
+  if (GST_VIDEO_INFO_FORMAT (surface_vip) != GST_VIDEO_INFO_FORMAT (vip) ||
+      GST_VIDEO_INFO_WIDTH (surface_vip) != GST_VIDEO_INFO_WIDTH (vip) ||
+      GST_VIDEO_INFO_HEIGHT (surface_vip) != GST_VIDEO_INFO_HEIGHT (vip) ||
+      GST_VIDEO_INFO_SIZE (surface_vip) != GST_VIDEO_INFO_SIZE (vip))
+    return FALSE;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (vip); i++) {
+    if (GST_VIDEO_INFO_PLANE_OFFSET (surface_vip, i) !=
+        GST_VIDEO_INFO_PLANE_OFFSET (vip, i) ||
+        GST_VIDEO_INFO_PLANE_STRIDE (surface_vip, i) !=
+        GST_VIDEO_INFO_PLANE_STRIDE (vip, i))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_dmabuf_import:
+ * @display: a #GstVaapiDisplay
+ * @buffer: a #GstBuffer made of DMA-BUF memory
+ * @vip: the negotiated #GstVideoInfo
+ *
+ * Wraps the DMA-BUF memory of @buffer into a VA surface. A reference
+ * to @buffer is held until the returned proxy is released, so that
+ * the producer does not reuse the buffer while the surface is in use.
+ *
+ * Return value: a new #GstVaapiSurfaceProxy, or %NULL if @buffer could
+ *   not be imported
+ */
+GstVaapiSurfaceProxy *
+gst_vaapi_dmabuf_import (GstVaapiDisplay * display, GstBuffer * buffer,
+    const GstVideoInfo * vip)
+{
+  GstVaapiSurfaceProxy *proxy;
+  GstVaapiSurface *surface;
+  ImportedSurface *imported;
+  GstVideoInfo vi;
+  GstMemory *mem;
+
+  g_return_val_if_fail (display != NULL, NULL);
+
+  ensure_debug_category ();
+
+  if (!gst_vaapi_dmabuf_get_layout (buffer, vip, &vi))
+    return NULL;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  imported = gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (mem),
+      imported_surface_quark ());
+  if (imported && is_compatible_surface (imported, display, &vi))
+    surface = imported->surface;
+  else {
+    surface = gst_vaapi_surface_new_with_dma_buf_handle (display,
+        gst_dmabuf_memory_get_fd (mem), &vi);
+    if (!surface)
+      goto error_import_surface;
+    imported = g_slice_new (ImportedSurface);
+    imported->surface = surface;
+    imported->info = vi;
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
+        imported_surface_quark (), imported,
+        (GDestroyNotify) imported_surface_free);
+    GST_DEBUG ("imported DMA-BUF %d into surface %" GST_VAAPI_ID_FORMAT,
+        gst_dmabuf_memory_get_fd (mem),
+        GST_VAAPI_ID_ARGS (gst_vaapi_surface_get_id (surface)));
+  }
+
+  proxy = gst_vaapi_surface_proxy_new (surface);
+  if (!proxy)
+    return NULL;
+  gst_vaapi_surface_proxy_set_destroy_notify (proxy,
+      (GDestroyNotify) gst_buffer_unref, gst_buffer_ref (buffer));
+  return proxy;
+
+  /* ERRORS */
+error_import_surface:
+  {
+    GST_WARNING ("failed to import DMA-BUF %d",
+        gst_dmabuf_memory_get_fd (mem));
+    return NULL;
+  }
+}
+
+/**
+ * gst_vaapi_dmabuf_memory_new:
+ * @allocator: a #GstDmaBufAllocator
+ * @proxy: the #GstVaapiSurfaceProxy to export
+ *
+ * Exports the surface of @proxy as a new DMA-BUF memory. The memory
+ * holds a reference to @proxy until it is freed.
+ *
+ * Return value: a new #GstMemory, or %NULL if the surface could not be
+ *   exported
+ */
+GstMemory *
+gst_vaapi_dmabuf_memory_new (GstAllocator * allocator,
+    GstVaapiSurfaceProxy * proxy)
+{
+  GstVaapiBufferProxy *buf_proxy;
+  GstMemory *mem;
+  gsize size;
+  gint fd;
+
+  g_return_val_if_fail (allocator != NULL, NULL);
+  g_return_val_if_fail (proxy != NULL, NULL);
+
+  ensure_debug_category ();
+
+  buf_proxy =
+      gst_vaapi_surface_get_dma_buf_handle (GST_VAAPI_SURFACE_PROXY_SURFACE
+      (proxy));
+  if (!buf_proxy)
+    return NULL;
+
+  /* The VA buffer handle is owned by the surface, while the memory
+     closes its own file descriptor when it is freed */
+  fd = dup (GST_VAAPI_BUFFER_PROXY_HANDLE (buf_proxy));
+  size = GST_VAAPI_BUFFER_PROXY_SIZE (buf_proxy);
+  gst_vaapi_buffer_proxy_unref (buf_proxy);
+  if (fd < 0)
+    goto error_dup_handle;
+
+  mem = gst_dmabuf_allocator_alloc (allocator, fd, size);
+  if (!mem)
+    goto error_alloc_memory;
+
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
+      exported_proxy_quark (), gst_vaapi_surface_proxy_ref (proxy),
+      (GDestroyNotify) gst_vaapi_surface_proxy_unref);
+  return mem;
+
+  /* ERRORS */
+error_dup_handle:
+  {
+    GST_ERROR ("failed to duplicate DMA-BUF handle");
+    return NULL;
+  }
+error_alloc_memory:
+  {
+    GST_ERROR ("failed to allocate DMA-BUF memory");
+    close (fd);
+    return NULL;
+  }
+}
+
+/**
+ * gst_vaapi_dmabuf_memory_get_surface_proxy:
+ * @mem: a #GstMemory
+ *
+ * Returns the #GstVaapiSurfaceProxy that was exported as @mem.
+ *
+ * Return value: (transfer none): the #GstVaapiSurfaceProxy, or %NULL if
+ *   @mem was not created by gst_vaapi_dmabuf_memory_new()
+ */
+GstVaapiSurfaceProxy *
+gst_vaapi_dmabuf_memory_get_surface_proxy (GstMemory * mem)
+{
+  g_return_val_if_fail (mem != NULL, NULL);
+
+  return gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (mem),
+      exported_proxy_quark ());
+}
+
+/**
+ * gst_vaapi_dmabuf_buffer_set_surface_proxy:
+ * @buffer: a #GstBuffer
+ * @proxy: a #GstVaapiSurfaceProxy
+ *
+ * Makes sure the DMA-BUF memory of @buffer, if any, exports the surface
+ * of @proxy. This is needed when the surface of a buffer is replaced,
+ * e.g. by a decoder that renders into its own surfaces.
+ *
+ * Return value: %TRUE if successful, or if @buffer does not hold any
+ *   exported DMA-BUF memory
+ */
+gboolean
+gst_vaapi_dmabuf_buffer_set_surface_proxy (GstBuffer * buffer,
+    GstVaapiSurfaceProxy * proxy)
+{
+  GstVaapiSurfaceProxy *old_proxy;
+  GstMemory *mem;
+
+  g_return_val_if_fail (buffer != NULL, FALSE);
+  g_return_val_if_fail (proxy != NULL, FALSE);
+
+  if (gst_buffer_n_memory (buffer) != 1)
+    return TRUE;
+  mem = gst_buffer_peek_memory (buffer, 0);
+  old_proxy = gst_vaapi_dmabuf_memory_get_surface_proxy (mem);
+  if (!old_proxy)
+    return TRUE;
+  if (GST_VAAPI_SURFACE_PROXY_SURFACE (old_proxy) ==
+      GST_VAAPI_SURFACE_PROXY_SURFACE (proxy))
+    return TRUE;
+
+  mem = gst_vaapi_dmabuf_memory_new (mem->allocator, proxy);
+  if (!mem)
+    return FALSE;
+  gst_buffer_replace_memory (buffer, 0, mem);
+  return TRUE;
+}
@@ -0,0 +1,62 @@
+/*
+ *  gstvaapidmabuf.h - DMA-BUF import/export of VA surfaces
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_DMABUF_H
+#define GST_VAAPI_DMABUF_H
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/allocators/gstdmabuf.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_dmabuf_query_has_allocator (GstQuery * query);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_dmabuf_get_layout (GstBuffer * buffer, const GstVideoInfo * vip,
+    GstVideoInfo * out_vip);
+
+G_GNUC_INTERNAL
+GstVaapiSurfaceProxy *
+gst_vaapi_dmabuf_import (GstVaapiDisplay * display, GstBuffer * buffer,
+    const GstVideoInfo * vip);
+
+G_GNUC_INTERNAL
+GstMemory *
+gst_vaapi_dmabuf_memory_new (GstAllocator * allocator,
+    GstVaapiSurfaceProxy * proxy);
+
+G_GNUC_INTERNAL
+GstVaapiSurfaceProxy *
+gst_vaapi_dmabuf_memory_get_surface_proxy (GstMemory * mem);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_dmabuf_buffer_set_surface_proxy (GstBuffer * buffer,
+    GstVaapiSurfaceProxy * proxy);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_DMABUF_H */
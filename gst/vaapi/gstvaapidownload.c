@@ -83,6 +83,7 @@ struct _GstVaapiDownload {
     guint               image_width;
     guint               image_height;
     unsigned int        images_reset    : 1;
+    unsigned int        use_derived_images : 1;
 };
 
 struct _GstVaapiDownloadClass {
@@ -224,6 +225,7 @@ gst_vaapidownload_init(GstVaapiDownload *download)
     download->image_format      = GST_VIDEO_FORMAT_UNKNOWN;
     download->image_width       = 0;
     download->image_height      = 0;
+    download->use_derived_images = FALSE;
 
     /* Override buffer allocator on sink pad */
     sinkpad = gst_element_get_static_pad(GST_ELEMENT(download), "sink");
@@ -336,6 +338,25 @@ gst_vaapidownload_before_transform(GstBaseTransform *trans, GstBuffer *buffer)
     gst_vaapidownload_update_src_caps(download, buffer);
 }
 
+/* Copies the surface pixels straight from a derived image, i.e. without
+   any intermediate VA image. Returns FALSE if that is not possible */
+static gboolean
+download_derived_image(GstVaapiDownload *download, GstVaapiSurface *surface,
+    GstBuffer *outbuf)
+{
+    GstVaapiImage *image;
+    gboolean success;
+
+    image = gst_vaapi_surface_derive_image(surface);
+    if (!image)
+        return FALSE;
+
+    success = gst_vaapi_image_get_format(image) == download->image_format &&
+        gst_vaapi_image_get_buffer(image, outbuf, NULL);
+    gst_vaapi_object_unref(image);
+    return success;
+}
+
 static GstFlowReturn
 gst_vaapidownload_transform(
     GstBaseTransform *trans,
@@ -354,6 +375,13 @@ gst_vaapidownload_transform(
     if (!surface)
         return GST_FLOW_UNEXPECTED;
 
+    if (download->use_derived_images) {
+        if (download_derived_image(download, surface, outbuf))
+            return GST_FLOW_OK;
+        GST_INFO("failed to use derived image, fallbacking to copy");
+        download->use_derived_images = FALSE;
+    }
+
     image = gst_vaapi_video_pool_get_object(download->images);
     if (!image)
         return GST_FLOW_UNEXPECTED;
@@ -461,6 +489,34 @@ gst_vaapidownload_transform_caps(
     return out_caps;
 }
 
+/* Checks whether surfaces of the negotiated size could be read through
+   derived images, i.e. in a single copy. The driver needs to expose the
+   surface as an image of the output format */
+static gboolean
+gst_vaapidownload_check_derived_images(GstVaapiDownload *download)
+{
+    GstVaapiSurface *surface;
+    GstVaapiImage *image;
+    gboolean success = FALSE;
+
+    surface = gst_vaapi_surface_new(GST_VAAPI_PLUGIN_BASE_DISPLAY(download),
+        GST_VAAPI_CHROMA_TYPE_YUV420, download->image_width,
+        download->image_height);
+    if (!surface)
+        return FALSE;
+
+    image = gst_vaapi_surface_derive_image(surface);
+    if (image) {
+        success = gst_vaapi_image_get_format(image) == download->image_format &&
+            gst_vaapi_image_map(image);
+        if (success)
+            gst_vaapi_image_unmap(image);
+        gst_vaapi_object_unref(image);
+    }
+    gst_vaapi_object_unref(surface);
+    return success;
+}
+
 static gboolean
 gst_vaapidownload_ensure_image_pool(GstVaapiDownload *download, GstCaps *caps)
 {
@@ -487,6 +543,13 @@ gst_vaapidownload_ensure_image_pool(GstVaapiDownload *download, GstCaps *caps)
         if (!download->images)
             return FALSE;
         download->images_reset = TRUE;
+
+        download->use_derived_images =
+            gst_vaapidownload_check_derived_images(download);
+        GST_INFO("download %s images with %s",
+                 gst_video_format_to_string(format),
+                 download->use_derived_images ? "derived images" :
+                 "vaGetImage()");
     }
     return TRUE;
 }
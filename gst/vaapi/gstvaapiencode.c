@@ -165,12 +165,25 @@ gst_vaapiencode_default_set_property (GstVaapiEncode * encode, guint prop_id,
     const GValue * value)
 {
   PropValue *const prop_value = prop_value_lookup (encode, prop_id);
+  GstVaapiEncoderStatus status;
 
-  if (prop_value) {
-    g_value_copy (value, &prop_value->value);
-    return TRUE;
+  if (!prop_value)
+    return FALSE;
+
+  g_value_copy (value, &prop_value->value);
+
+  /* Propagate the change to the active encoder, it is applied to
+     the next frame if the property is mutable in PLAYING state */
+  if (encode->encoder) {
+    GST_VIDEO_ENCODER_STREAM_LOCK (encode);
+    status = gst_vaapi_encoder_set_property (encode->encoder, prop_value->id,
+        value);
+    GST_VIDEO_ENCODER_STREAM_UNLOCK (encode);
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      GST_WARNING_OBJECT (encode, "failed to update property %s while "
+          "encoding", g_param_spec_get_name (prop_value->pspec));
   }
-  return FALSE;
+  return TRUE;
 }
 
 static GstFlowReturn
@@ -474,6 +487,21 @@ set_codec_state (GstVaapiEncode * encode, GstVideoCodecState * state)
   return TRUE;
 }
 
+/* Checks whether the new input state only differs by the framerate */
+static gboolean
+is_framerate_change (GstVaapiEncode * encode, GstVideoCodecState * state)
+{
+  GstVideoInfo info;
+
+  if (!encode->encoder || !encode->input_state)
+    return FALSE;
+
+  info = encode->input_state->info;
+  GST_VIDEO_INFO_FPS_N (&info) = GST_VIDEO_INFO_FPS_N (&state->info);
+  GST_VIDEO_INFO_FPS_D (&info) = GST_VIDEO_INFO_FPS_D (&state->info);
+  return gst_video_info_is_equal (&info, &state->info);
+}
+
 static gboolean
 gst_vaapiencode_set_format (GstVideoEncoder * venc, GstVideoCodecState * state)
 {
@@ -481,10 +509,18 @@ gst_vaapiencode_set_format (GstVideoEncoder * venc, GstVideoCodecState * state)
 
   g_return_val_if_fail (state->caps != NULL, FALSE);
 
-  if (!ensure_encoder (encode))
-    return FALSE;
-  if (!set_codec_state (encode, state))
-    return FALSE;
+  /* Keep the active encoder on framerate changes, the new framerate
+     applies to the next frames */
+  if (is_framerate_change (encode, state)) {
+    if (gst_vaapi_encoder_set_codec_state (encode->encoder, state) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      return FALSE;
+  } else {
+    if (!ensure_encoder (encode))
+      return FALSE;
+    if (!set_codec_state (encode, state))
+      return FALSE;
+  }
 
   if (!gst_vaapi_plugin_base_set_caps (GST_VAAPI_PLUGIN_BASE (encode),
           state->caps, NULL))
@@ -618,9 +654,24 @@ static gboolean
 gst_vaapiencode_propose_allocation (GstVideoEncoder * venc, GstQuery * query)
 {
   GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (venc);
+  GstVaapiEncode *const encode = GST_VAAPIENCODE_CAST (venc);
+  GstBufferPool *pool;
+  guint size, min, max;
 
   if (!gst_vaapi_plugin_base_propose_allocation (plugin, query))
     return FALSE;
+
+  /* Make sure upstream has enough VA surfaces for the frames we could
+     hold, so that decoded surfaces can be encoded without any copy */
+  if (encode->encoder && gst_query_get_n_allocation_pools (query) > 0) {
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+    min = MAX (min, gst_vaapi_encoder_get_max_input_frames (encode->encoder));
+    if (max && max < min)
+      max = min;
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+    if (pool)
+      gst_object_unref (pool);
+  }
   return TRUE;
 }
 #endif
@@ -27,9 +27,13 @@
 #include "gstvaapipluginutil.h"
 #include "gstvaapivideocontext.h"
 #include "gstvaapivideometa.h"
+#include "gstvaapivideobuffer.h"
 #if GST_CHECK_VERSION(1,0,0)
 #include "gstvaapivideobufferpool.h"
 #endif
+#if USE_DMABUF
+#include "gstvaapidmabuf.h"
+#endif
 
 /* Default debug category is from the subclass */
 #define GST_CAT_DEFAULT (plugin->debug_category)
@@ -441,6 +445,18 @@ gst_vaapi_plugin_base_propose_allocation (GstVaapiPluginBase * plugin,
 
   gst_query_add_allocation_meta (query, GST_VAAPI_VIDEO_META_API_TYPE, NULL);
   gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  /* Buffers that upstream allocates on its own can be wrapped into VA
+     surfaces without any copy, provided they are page aligned. Strides
+     cannot be negotiated through the allocation query, so only those
+     that are already suitably aligned avoid the copy */
+  if (plugin->uploader && USE_VA_USERPTR) {
+    GstAllocationParams params;
+
+    gst_allocation_params_init (&params);
+    params.align = GST_VAAPI_SURFACE_USER_PTR_ALIGNMENT - 1;
+    gst_query_add_allocation_param (query, NULL, &params);
+  }
   return TRUE;
 
   /* ERRORS */
@@ -495,6 +511,48 @@ gst_vaapi_plugin_base_allocate_input_buffer (GstVaapiPluginBase * plugin,
   return GST_FLOW_OK;
 }
 
+/* Checks whether the VA surface held in @meta can be used as is with
+   the plugin display, i.e. it lives in the same VA display */
+static gboolean
+is_native_video_meta (GstVaapiPluginBase * plugin, GstVaapiVideoMeta * meta)
+{
+  GstVaapiDisplay *const display = gst_vaapi_video_meta_get_display (meta);
+
+  if (!display || !plugin->display)
+    return FALSE;
+  if (display == plugin->display)
+    return TRUE;
+  return gst_vaapi_display_get_display (display) ==
+      gst_vaapi_display_get_display (plugin->display);
+}
+
+#if USE_DMABUF
+/* Imports the DMA-BUF memory of @inbuf as a VA surface, without any
+   copy. Returns NULL if @inbuf is not made of suitable DMA-BUF memory */
+static GstBuffer *
+get_dmabuf_input_buffer (GstVaapiPluginBase * plugin, GstBuffer * inbuf)
+{
+  GstVaapiSurfaceProxy *proxy;
+  GstBuffer *outbuf;
+
+  if (!plugin->display)
+    return NULL;
+
+  proxy = gst_vaapi_dmabuf_import (plugin->display, inbuf,
+      &plugin->sinkpad_info);
+  if (!proxy)
+    return NULL;
+
+  outbuf = gst_vaapi_video_buffer_new_with_surface_proxy (proxy);
+  gst_vaapi_surface_proxy_unref (proxy);
+  if (!outbuf)
+    return NULL;
+
+  gst_buffer_copy_into (outbuf, inbuf, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+  return outbuf;
+}
+#endif
+
 /**
  * gst_vaapi_plugin_base_get_input_buffer:
  * @plugin: a #GstVaapiPluginBase
@@ -503,8 +561,8 @@ gst_vaapi_plugin_base_allocate_input_buffer (GstVaapiPluginBase * plugin,
  *
  * Acquires the sink pad (input) buffer as a VA surface backed
  * buffer. This is mostly useful for raw YUV buffers, as source
- * buffers that are already backed as a VA surface are passed
- * verbatim.
+ * buffers that are already backed as a VA surface from the same VA
+ * display are passed verbatim, e.g. from vaapidecode to vaapiencode.
  *
  * Returns: #GST_FLOW_OK if the buffer could be acquired
  */
@@ -524,7 +582,7 @@ gst_vaapi_plugin_base_get_input_buffer (GstVaapiPluginBase * plugin,
 
   meta = gst_buffer_get_vaapi_video_meta (inbuf);
 #if GST_CHECK_VERSION(1,0,0)
-  if (meta) {
+  if (meta && is_native_video_meta (plugin, meta)) {
     *outbuf_ptr = gst_buffer_ref (inbuf);
     return GST_FLOW_OK;
   }
@@ -532,6 +590,24 @@ gst_vaapi_plugin_base_get_input_buffer (GstVaapiPluginBase * plugin,
   if (!GST_VIDEO_INFO_IS_YUV (&plugin->sinkpad_info))
     goto error_invalid_buffer;
 
+#if USE_DMABUF
+  outbuf = get_dmabuf_input_buffer (plugin, inbuf);
+  if (outbuf) {
+    *outbuf_ptr = outbuf;
+    return GST_FLOW_OK;
+  }
+#endif
+
+  /* Wrap suitably aligned system memory without any copy */
+  if (plugin->uploader) {
+    outbuf = gst_vaapi_uploader_import_buffer (plugin->uploader, inbuf);
+    if (outbuf) {
+      gst_buffer_copy_into (outbuf, inbuf, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+      *outbuf_ptr = outbuf;
+      return GST_FLOW_OK;
+    }
+  }
+
   if (!plugin->sinkpad_buffer_pool)
     goto error_no_pool;
 
@@ -587,6 +663,15 @@ error_map_src_buffer:
   if (meta)
     outbuf = gst_buffer_ref (inbuf);
   else if (GST_VIDEO_INFO_IS_YUV (&plugin->sinkpad_info)) {
+    /* Wrap suitably aligned system memory without any copy */
+    outbuf = gst_vaapi_uploader_import_buffer (plugin->uploader, inbuf);
+    if (outbuf) {
+      gst_buffer_copy_metadata (outbuf, inbuf,
+          GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS);
+      *outbuf_ptr = outbuf;
+      return GST_FLOW_OK;
+    }
+
     outbuf = gst_vaapi_uploader_get_buffer (plugin->uploader);
     if (!outbuf)
       goto error_create_buffer;
@@ -26,6 +26,7 @@
 #include "gstvaapivideocontext.h"
 #if USE_DRM
 # include <gst/vaapi/gstvaapidisplay_drm.h>
+# include "gstvaapidisplaypool.h"
 #endif
 #if USE_X11
 # include <gst/vaapi/gstvaapidisplay_x11.h>
@@ -58,6 +59,25 @@ static const char *display_types[] = {
   NULL
 };
 
+#if USE_DRM
+/* Picks the least loaded render node, unless a device was requested */
+static GstVaapiDisplay *
+gst_vaapi_create_display_drm (const gchar * display_name)
+{
+  GstVaapiDisplayPool *pool;
+  GstVaapiDisplay *display = NULL;
+
+  if (!display_name) {
+    pool = gst_vaapi_display_pool_get_default ();
+    if (pool)
+      display = gst_vaapi_display_pool_acquire (pool);
+  }
+  if (!display)
+    display = gst_vaapi_display_drm_new (display_name);
+  return display;
+}
+#endif
+
 typedef struct
 {
   const gchar *type_str;
@@ -84,7 +104,7 @@ static const DisplayMap g_display_map[] = {
 #if USE_DRM
   {"drm",
         GST_VAAPI_DISPLAY_TYPE_DRM,
-      gst_vaapi_display_drm_new},
+      gst_vaapi_create_display_drm},
 #endif
   {NULL,}
 };
@@ -27,6 +27,18 @@
  * vaapipostproc consists in various postprocessing algorithms to be
  * applied to VA surfaces. So far, only basic bob deinterlacing is
  * implemented.
+ *
+ * Additional "src_%u" pads can be requested to produce several
+ * renditions of the same input frames, e.g. for adaptive streaming.
+ * The size and format of each rendition are negotiated with the
+ * downstream elements, and all of them are processed back-to-back by
+ * the same VA/VPP filter, e.g.
+ *
+ * |[
+ * vaapidecode ! vaapipostproc name=pp
+ *   pp.src_0 ! video/x-raw(memory:VASurface),width=1280,height=720 ! ...
+ *   pp.src_1 ! video/x-raw(memory:VASurface),width=640,height=360 ! ...
+ * ]|
  */
 
 #include "gst/vaapi/sysdeps.h"
@@ -88,6 +100,15 @@ static GstStaticPadTemplate gst_vaapipostproc_src_factory =
         GST_PAD_ALWAYS,
         GST_STATIC_CAPS(gst_vaapipostproc_src_caps_str));
 
+#if GST_CHECK_VERSION(1,0,0)
+static GstStaticPadTemplate gst_vaapipostproc_ladder_src_factory =
+    GST_STATIC_PAD_TEMPLATE(
+        "src_%u",
+        GST_PAD_SRC,
+        GST_PAD_REQUEST,
+        GST_STATIC_CAPS(gst_vaapipostproc_src_caps_str));
+#endif
+
 G_DEFINE_TYPE_WITH_CODE(
     GstVaapiPostproc,
     gst_vaapipostproc,
@@ -205,6 +226,120 @@ find_filter_op(GPtrArray *filter_ops, GstVaapiFilterOp op)
     return NULL;
 }
 
+#if GST_CHECK_VERSION(1,0,0)
+static GQuark
+ladder_output_quark(void)
+{
+    static gsize g_quark;
+
+    if (g_once_init_enter(&g_quark)) {
+        gsize quark = (gsize)g_quark_from_static_string("GstVaapiLadderOutput");
+        g_once_init_leave(&g_quark, quark);
+    }
+    return g_quark;
+}
+
+static void
+ladder_output_free(GstVaapiLadderOutput *output)
+{
+    gst_vaapi_video_pool_replace(&output->pool, NULL);
+    g_slice_free(GstVaapiLadderOutput, output);
+}
+
+static inline GstVaapiLadderOutput *
+ladder_output_get(GstPad *pad)
+{
+    return g_object_get_qdata(G_OBJECT(pad), ladder_output_quark());
+}
+
+/* Returns a snapshot of the current set of request src pads */
+static GPtrArray *
+ladder_get_pads(GstVaapiPostproc *postproc)
+{
+    GPtrArray *pads;
+    GList *l;
+
+    pads = g_ptr_array_new_with_free_func(gst_object_unref);
+    GST_OBJECT_LOCK(postproc);
+    for (l = postproc->ladder_pads; l != NULL; l = l->next)
+        g_ptr_array_add(pads, gst_object_ref(l->data));
+    GST_OBJECT_UNLOCK(postproc);
+    return pads;
+}
+
+/* Marks the request src pad for renegotiation on the next buffer */
+static void
+ladder_output_mark_negotiate(GstVaapiPostproc *postproc,
+    GstVaapiLadderOutput *output)
+{
+    GST_OBJECT_LOCK(postproc);
+    output->need_negotiate = TRUE;
+    GST_OBJECT_UNLOCK(postproc);
+}
+
+/* Marks all request src pads for renegotiation, and optionally
+   releases the underlying surface pools */
+static void
+ladder_reset_outputs(GstVaapiPostproc *postproc, gboolean release_pools)
+{
+    GList *l;
+
+    GST_OBJECT_LOCK(postproc);
+    for (l = postproc->ladder_pads; l != NULL; l = l->next) {
+        GstVaapiLadderOutput * const output = ladder_output_get(l->data);
+        output->need_negotiate = TRUE;
+        if (release_pools)
+            gst_vaapi_video_pool_replace(&output->pool, NULL);
+    }
+    GST_OBJECT_UNLOCK(postproc);
+}
+
+/* Forgets the results of the last pushes, e.g. after a flush */
+static void
+ladder_reset_flows(GstVaapiPostproc *postproc)
+{
+    GList *l;
+
+    GST_OBJECT_LOCK(postproc);
+    for (l = postproc->ladder_pads; l != NULL; l = l->next)
+        ladder_output_get(l->data)->last_ret = GST_FLOW_OK;
+    GST_OBJECT_UNLOCK(postproc);
+}
+
+/* Combines the results of the last pushes to the request src pads, as
+   GstFlowCombiner does: fatal errors are reported right away, while
+   unlinked or EOS pads only matter once all pads are */
+static GstFlowReturn
+ladder_combine_flows(GstVaapiPostproc *postproc, GPtrArray *pads)
+{
+    gboolean all_eos = TRUE, all_not_linked = TRUE;
+    GstFlowReturn ret;
+    guint i;
+
+    GST_OBJECT_LOCK(postproc);
+    for (i = 0; i < pads->len; i++) {
+        ret = ladder_output_get(g_ptr_array_index(pads, i))->last_ret;
+        if (ret <= GST_FLOW_NOT_NEGOTIATED || ret == GST_FLOW_FLUSHING)
+            goto done;
+        if (ret != GST_FLOW_NOT_LINKED) {
+            all_not_linked = FALSE;
+            if (ret != GST_FLOW_EOS)
+                all_eos = FALSE;
+        }
+    }
+    if (all_not_linked)
+        ret = GST_FLOW_NOT_LINKED;
+    else if (all_eos)
+        ret = GST_FLOW_EOS;
+    else
+        ret = GST_FLOW_OK;
+
+done:
+    GST_OBJECT_UNLOCK(postproc);
+    return ret;
+}
+#endif
+
 static inline gboolean
 gst_vaapipostproc_ensure_display(GstVaapiPostproc *postproc)
 {
@@ -287,6 +422,7 @@ static void
 gst_vaapipostproc_destroy(GstVaapiPostproc *postproc)
 {
     ds_reset(&postproc->deinterlace_state);
+    ds_reset(&postproc->ladder_deinterlace_state);
     gst_vaapipostproc_destroy_filter(postproc);
 
     gst_caps_replace(&postproc->allowed_sinkpad_caps, NULL);
@@ -300,6 +436,7 @@ gst_vaapipostproc_start(GstBaseTransform *trans)
     GstVaapiPostproc * const postproc = GST_VAAPIPOSTPROC(trans);
 
     ds_reset(&postproc->deinterlace_state);
+    ds_reset(&postproc->ladder_deinterlace_state);
     if (!gst_vaapi_plugin_base_open(GST_VAAPI_PLUGIN_BASE(postproc)))
         return FALSE;
     if (!gst_vaapipostproc_ensure_display(postproc))
@@ -313,6 +450,11 @@ gst_vaapipostproc_stop(GstBaseTransform *trans)
     GstVaapiPostproc * const postproc = GST_VAAPIPOSTPROC(trans);
 
     ds_reset(&postproc->deinterlace_state);
+    ds_reset(&postproc->ladder_deinterlace_state);
+#if GST_CHECK_VERSION(1,0,0)
+    ladder_reset_outputs(postproc, TRUE);
+    ladder_reset_flows(postproc);
+#endif
     gst_vaapi_plugin_base_close(GST_VAAPI_PLUGIN_BASE(postproc));
     return TRUE;
 }
@@ -432,6 +574,50 @@ set_best_deint_method(GstVaapiPostproc *postproc, guint flags,
     return success;
 }
 
+/* Drops the deinterlacing references if the deinterlacing conditions
+   changed, or if there is a discontinuity */
+static void
+ds_update(GstVaapiPostproc *postproc, GstVaapiDeinterlaceState *ds,
+    GstBuffer *inbuf, gboolean deint, gboolean tff)
+{
+    if (deint != ds->deint || (ds->num_surfaces > 0 && tff != ds->tff))
+        ds_reset(ds);
+
+    if (deint_method_is_advanced(postproc->deinterlace_method)) {
+        GstBuffer * const prev_buf = ds_get_buffer(ds, 0);
+        GstClockTime prev_pts, pts = GST_BUFFER_TIMESTAMP(inbuf);
+        if (prev_buf && (prev_pts = GST_BUFFER_TIMESTAMP(prev_buf)) != pts) {
+            const GstClockTimeDiff pts_diff = GST_CLOCK_DIFF(prev_pts, pts);
+            if (pts_diff < 0 || (postproc->field_duration > 0 &&
+                    pts_diff > postproc->field_duration * 2))
+                ds_reset(ds);
+        }
+    }
+
+    ds->deint = deint;
+    ds->tff = tff;
+}
+
+/* Determines the source region to process, from the crop meta if any */
+static GstVaapiRectangle *
+get_cropping_rectangle(GstBuffer *inbuf, GstVaapiVideoMeta *inbuf_meta,
+    GstVaapiRectangle *tmp_rect)
+{
+#if GST_CHECK_VERSION(1,0,0)
+    GstVideoCropMeta * const crop_meta =
+        gst_buffer_get_video_crop_meta(inbuf);
+    if (crop_meta) {
+        tmp_rect->x = crop_meta->x;
+        tmp_rect->y = crop_meta->y;
+        tmp_rect->width = crop_meta->width;
+        tmp_rect->height = crop_meta->height;
+        return tmp_rect;
+    }
+#endif
+    return (GstVaapiRectangle *)
+        gst_vaapi_video_meta_get_render_rect(inbuf_meta);
+}
+
 static GstFlowReturn
 gst_vaapipostproc_process_vpp(GstBaseTransform *trans, GstBuffer *inbuf,
     GstBuffer *outbuf)
@@ -447,10 +633,7 @@ gst_vaapipostproc_process_vpp(GstBaseTransform *trans, GstBuffer *inbuf,
     GstVaapiDeinterlaceMethod deint_method;
     guint flags, deint_flags;
     gboolean tff, deint, deint_refs, deint_changed;
-    GstVaapiRectangle *crop_rect = NULL;
-#if GST_CHECK_VERSION(1,0,0)
-    GstVaapiRectangle tmp_rect;
-#endif
+    GstVaapiRectangle *crop_rect, tmp_rect;
 
     /* Validate filters */
     if ((postproc->flags & GST_VAAPI_POSTPROC_FLAG_FORMAT) &&
@@ -491,47 +674,17 @@ gst_vaapipostproc_process_vpp(GstBaseTransform *trans, GstBuffer *inbuf,
     if (!inbuf_meta)
         goto error_invalid_buffer;
     inbuf_surface = gst_vaapi_video_meta_get_surface(inbuf_meta);
-
-#if GST_CHECK_VERSION(1,0,0)
-    GstVideoCropMeta * const crop_meta =
-        gst_buffer_get_video_crop_meta(inbuf);
-    if (crop_meta) {
-        crop_rect = &tmp_rect;
-        crop_rect->x = crop_meta->x;
-        crop_rect->y = crop_meta->y;
-        crop_rect->width = crop_meta->width;
-        crop_rect->height = crop_meta->height;
-    }
-#endif
-    if (!crop_rect)
-        crop_rect = (GstVaapiRectangle *)
-            gst_vaapi_video_meta_get_render_rect(inbuf_meta);
+    crop_rect = get_cropping_rectangle(inbuf, inbuf_meta, &tmp_rect);
 
     timestamp  = GST_BUFFER_TIMESTAMP(inbuf);
     tff        = GST_BUFFER_FLAG_IS_SET(inbuf, GST_VIDEO_BUFFER_FLAG_TFF);
     deint      = should_deinterlace_buffer(postproc, inbuf);
 
-    /* Drop references if deinterlacing conditions changed */
     deint_changed = deint != ds->deint;
-    if (deint_changed || (ds->num_surfaces > 0 && tff != ds->tff))
-        ds_reset(ds);
+    ds_update(postproc, ds, inbuf, deint, tff);
 
     deint_method = postproc->deinterlace_method;
     deint_refs = deint_method_is_advanced(deint_method);
-    if (deint_refs) {
-        GstBuffer * const prev_buf = ds_get_buffer(ds, 0);
-        GstClockTime prev_pts, pts = GST_BUFFER_TIMESTAMP(inbuf);
-        /* Reset deinterlacing state when there is a discontinuity */
-        if (prev_buf && (prev_pts = GST_BUFFER_TIMESTAMP(prev_buf)) != pts) {
-            const GstClockTimeDiff pts_diff = GST_CLOCK_DIFF(prev_pts, pts);
-            if (pts_diff < 0 || (postproc->field_duration > 0 &&
-                    pts_diff > postproc->field_duration * 2))
-                ds_reset(ds);
-        }
-    }
-
-    ds->deint = deint;
-    ds->tff = tff;
 
     flags = gst_vaapi_video_meta_get_render_flags(inbuf_meta) &
         ~GST_VAAPI_PICTURE_STRUCTURE_MASK;
@@ -1105,6 +1258,395 @@ gst_vaapipostproc_transform_size(GstBaseTransform *trans,
     return TRUE;
 }
 
+#if GST_CHECK_VERSION(1,0,0)
+/* Shares a surface pool with any other output of the same size and
+   format, including the main src pad, or creates a new one */
+static gboolean
+ladder_ensure_pool(GstVaapiPostproc *postproc, GstPad *pad,
+    GstVaapiLadderOutput *output, GstVideoInfo *vip)
+{
+    GstVaapiVideoPool *pool = NULL;
+    GList *l;
+
+    GST_OBJECT_LOCK(postproc);
+    if (postproc->filter_pool &&
+        !video_info_changed(vip, &postproc->filter_pool_info))
+        pool = gst_vaapi_video_pool_ref(postproc->filter_pool);
+    for (l = postproc->ladder_pads; !pool && l != NULL; l = l->next) {
+        GstVaapiLadderOutput * const other = ladder_output_get(l->data);
+        if (l->data != pad && other->pool && !other->need_negotiate &&
+            !video_info_changed(vip, &other->info))
+            pool = gst_vaapi_video_pool_ref(other->pool);
+    }
+    GST_OBJECT_UNLOCK(postproc);
+
+    if (!pool) {
+        pool = gst_vaapi_surface_pool_new(
+            GST_VAAPI_PLUGIN_BASE_DISPLAY(postproc), vip);
+        if (!pool)
+            return FALSE;
+    }
+
+    GST_OBJECT_LOCK(postproc);
+    output->info = *vip;
+    gst_vaapi_video_pool_replace(&output->pool, pool);
+    GST_OBJECT_UNLOCK(postproc);
+    gst_vaapi_video_pool_unref(pool);
+    return TRUE;
+}
+
+static gboolean
+collect_sticky_event(GstPad *pad, GstEvent **event_ptr, gpointer user_data)
+{
+    GPtrArray * const events = user_data;
+
+    g_ptr_array_add(events, gst_event_ref(*event_ptr));
+    return TRUE;
+}
+
+/* Negotiates the request src pad caps, if needed, and replays the
+   sticky events from the sink pad with those caps */
+static gboolean
+ladder_ensure_output(GstVaapiPostproc *postproc, GstPad *pad,
+    GstVaapiLadderOutput *output)
+{
+    GstVaapiPluginBase * const plugin = GST_VAAPI_PLUGIN_BASE(postproc);
+    GstVideoInfo * const sink_vip = &postproc->sinkpad_info;
+    GstStructure *structure;
+    GstCaps *caps, *peer_caps;
+    GPtrArray *events;
+    GstVideoFormat format;
+    GstVideoInfo vi;
+    gboolean need_negotiate;
+    guint i;
+
+    /* Clear the flag now, so that a concurrent reset is not lost */
+    GST_OBJECT_LOCK(postproc);
+    need_negotiate = output->need_negotiate;
+    output->need_negotiate = FALSE;
+    GST_OBJECT_UNLOCK(postproc);
+
+    if (!gst_pad_check_reconfigure(pad) && !need_negotiate)
+        return TRUE;
+    if (!gst_pad_is_linked(pad))
+        goto error_not_linked;
+
+    caps = gst_pad_query_caps(pad, NULL);
+    peer_caps = gst_pad_peer_query_caps(pad, caps);
+    gst_caps_unref(caps);
+    if (gst_caps_is_empty(peer_caps))
+        goto error_no_caps;
+
+    /* Prefer the input size and rate, and the main output format */
+    caps = gst_caps_truncate(peer_caps);
+    structure = gst_caps_get_structure(caps, 0);
+    gst_structure_fixate_field_nearest_int(structure, "width",
+        GST_VIDEO_INFO_WIDTH(sink_vip));
+    gst_structure_fixate_field_nearest_int(structure, "height",
+        GST_VIDEO_INFO_HEIGHT(sink_vip));
+    if (GST_VIDEO_INFO_FPS_N(sink_vip) > 0)
+        gst_structure_fixate_field_nearest_fraction(structure, "framerate",
+            GST_VIDEO_INFO_FPS_N(sink_vip), GST_VIDEO_INFO_FPS_D(sink_vip));
+    format = GST_VIDEO_INFO_FORMAT(&postproc->srcpad_info);
+    if (format != GST_VIDEO_FORMAT_UNKNOWN)
+        gst_structure_fixate_field_string(structure, "format",
+            gst_video_format_to_string(format));
+    caps = gst_caps_fixate(caps);
+
+    if (!gst_video_info_from_caps(&vi, caps))
+        goto error_invalid_caps;
+    if (!ladder_ensure_pool(postproc, pad, output, &vi))
+        goto error_create_pool;
+
+    events = g_ptr_array_new_with_free_func((GDestroyNotify)gst_event_unref);
+    gst_pad_sticky_events_foreach(GST_VAAPI_PLUGIN_BASE_SINK_PAD(plugin),
+        collect_sticky_event, events);
+    for (i = 0; i < events->len; i++) {
+        GstEvent * const event = g_ptr_array_index(events, i);
+        if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS)
+            gst_pad_push_event(pad, gst_event_new_caps(caps));
+        else
+            gst_pad_push_event(pad, gst_event_ref(event));
+    }
+    g_ptr_array_unref(events);
+
+    GST_DEBUG_OBJECT(pad, "negotiated caps %" GST_PTR_FORMAT, caps);
+    gst_caps_unref(caps);
+    return TRUE;
+
+    /* ERRORS */
+error_not_linked:
+    {
+        ladder_output_mark_negotiate(postproc, output);
+        return FALSE;
+    }
+error_no_caps:
+    {
+        GST_WARNING_OBJECT(pad, "no compatible caps downstream");
+        gst_caps_unref(peer_caps);
+        ladder_output_mark_negotiate(postproc, output);
+        return FALSE;
+    }
+error_invalid_caps:
+    {
+        GST_ERROR_OBJECT(pad, "invalid caps %" GST_PTR_FORMAT, caps);
+        gst_caps_unref(caps);
+        ladder_output_mark_negotiate(postproc, output);
+        return FALSE;
+    }
+error_create_pool:
+    {
+        GST_ERROR_OBJECT(pad, "failed to create surface pool");
+        gst_caps_unref(caps);
+        ladder_output_mark_negotiate(postproc, output);
+        return FALSE;
+    }
+}
+
+/* Generates one rendition of the input buffer, or of one of its fields,
+   for each of the negotiated request src pads, and combines the flow
+   returns of all request src pads */
+static GstFlowReturn
+ladder_process(GstVaapiPostproc *postproc, GstBuffer *inbuf,
+    GstVaapiSurface *inbuf_surface, GPtrArray *pads, GPtrArray *all_pads,
+    guint flags, GstClockTime timestamp, GstClockTime duration)
+{
+    GstVaapiVideoMeta *meta;
+    GstVaapiVideoPool *pool;
+    GstVaapiSurface **surfaces;
+    GstVaapiFilterStatus status;
+    GPtrArray *metas;
+    GstFlowReturn ret = GST_FLOW_OK;
+    guint i;
+
+    metas = g_ptr_array_new_with_free_func(
+        (GDestroyNotify)gst_vaapi_video_meta_unref);
+    surfaces = g_new(GstVaapiSurface *, pads->len);
+    for (i = 0; i < pads->len; i++) {
+        GstVaapiLadderOutput * const output =
+            ladder_output_get(g_ptr_array_index(pads, i));
+
+        /* The output size and format are those of the target surface */
+        GST_OBJECT_LOCK(postproc);
+        pool = output->pool ? gst_vaapi_video_pool_ref(output->pool) : NULL;
+        GST_OBJECT_UNLOCK(postproc);
+        if (!pool)
+            goto error_create_meta;
+        meta = gst_vaapi_video_meta_new_from_pool(pool);
+        gst_vaapi_video_pool_unref(pool);
+        if (!meta)
+            goto error_create_meta;
+        surfaces[i] = gst_vaapi_video_meta_get_surface(meta);
+        g_ptr_array_add(metas, meta);
+    }
+
+    status = gst_vaapi_filter_process_multi(postproc->filter, inbuf_surface,
+        surfaces, metas->len, flags);
+    if (status != GST_VAAPI_FILTER_STATUS_SUCCESS)
+        goto error_process_vpp;
+
+    for (i = 0; i < pads->len; i++) {
+        GstPad * const pad = g_ptr_array_index(pads, i);
+        GstBuffer *outbuf;
+        GstFlowReturn pad_ret;
+
+        outbuf = create_output_buffer(postproc);
+        if (!outbuf)
+            goto error_create_buffer;
+        gst_buffer_copy_into(outbuf, inbuf,
+            GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_FLAGS, 0, -1);
+        if (GST_CLOCK_TIME_IS_VALID(timestamp)) {
+            GST_BUFFER_TIMESTAMP(outbuf) = timestamp;
+            GST_BUFFER_DURATION(outbuf)  = duration;
+        }
+        gst_buffer_set_vaapi_video_meta(outbuf, g_ptr_array_index(metas, i));
+
+        pad_ret = gst_pad_push(pad, outbuf);
+        GST_OBJECT_LOCK(postproc);
+        ladder_output_get(pad)->last_ret = pad_ret;
+        GST_OBJECT_UNLOCK(postproc);
+    }
+    ret = ladder_combine_flows(postproc, all_pads);
+
+done:
+    g_ptr_array_unref(metas);
+    g_free(surfaces);
+    return ret;
+
+    /* ERRORS */
+error_create_meta:
+    {
+        GST_ERROR("failed to create new output buffer meta");
+        ret = GST_FLOW_ERROR;
+        goto done;
+    }
+error_process_vpp:
+    {
+        GST_ERROR("failed to apply VPP filters to additional outputs");
+        ret = GST_FLOW_ERROR;
+        goto done;
+    }
+error_create_buffer:
+    {
+        GST_ERROR("failed to create output buffer");
+        ret = GST_FLOW_ERROR;
+        goto done;
+    }
+}
+
+/* Generates all renditions of the input buffer for the request src pads.
+   The filter is shared with the main src pad, so the state that applies
+   to the renditions is explicitly set here: the output format and size
+   are those of the target surfaces, and they are deinterlaced with their
+   own history of reference frames. Both fields are output as separate
+   frames when deinterlacing, as on the main src pad */
+static GstFlowReturn
+gst_vaapipostproc_process_ladder(GstVaapiPostproc *postproc, GstBuffer *inbuf)
+{
+    GstVaapiDeinterlaceState * const ds = &postproc->ladder_deinterlace_state;
+    GstVaapiVideoMeta *inbuf_meta;
+    GstVaapiSurface *inbuf_surface;
+    GstVaapiDeinterlaceMethod deint_method;
+    GstVaapiRectangle *crop_rect, tmp_rect;
+    GPtrArray *pads, *active_pads = NULL;
+    GstClockTime timestamp;
+    GstFlowReturn ret = GST_FLOW_OK;
+    guint i, flags, deint_flags;
+    gboolean tff, deint, deint_refs;
+
+    pads = ladder_get_pads(postproc);
+    if (pads->len == 0)
+        goto done;
+
+    if (!postproc->use_vpp)
+        goto error_no_vpp;
+
+    inbuf_meta = gst_buffer_get_vaapi_video_meta(inbuf);
+    if (!inbuf_meta)
+        goto error_invalid_buffer;
+    inbuf_surface = gst_vaapi_video_meta_get_surface(inbuf_meta);
+
+    /* Skip pads that are EOS, not linked or could not be negotiated */
+    active_pads = g_ptr_array_new();
+    for (i = 0; i < pads->len; i++) {
+        GstPad * const pad = g_ptr_array_index(pads, i);
+        GstVaapiLadderOutput * const output = ladder_output_get(pad);
+        gboolean is_eos;
+
+        GST_OBJECT_LOCK(postproc);
+        is_eos = output->last_ret == GST_FLOW_EOS;
+        GST_OBJECT_UNLOCK(postproc);
+        if (!is_eos && ladder_ensure_output(postproc, pad, output))
+            g_ptr_array_add(active_pads, pad);
+    }
+    if (active_pads->len == 0)
+        goto done;
+
+    if (!gst_vaapi_filter_set_format(postproc->filter,
+            GST_VIDEO_FORMAT_ENCODED))
+        goto error_op_format;
+    gst_vaapi_filter_set_target_rectangle(postproc->filter, NULL);
+    crop_rect = get_cropping_rectangle(inbuf, inbuf_meta, &tmp_rect);
+    gst_vaapi_filter_set_cropping_rectangle(postproc->filter, crop_rect);
+
+    flags = gst_vaapi_video_meta_get_render_flags(inbuf_meta) &
+        ~GST_VAAPI_PICTURE_STRUCTURE_MASK;
+
+    timestamp = GST_BUFFER_TIMESTAMP(inbuf);
+    tff       = GST_BUFFER_FLAG_IS_SET(inbuf, GST_VIDEO_BUFFER_FLAG_TFF);
+    deint     = should_deinterlace_buffer(postproc, inbuf);
+    ds_update(postproc, ds, inbuf, deint, tff);
+
+    if (!deint) {
+        if (!gst_vaapi_filter_set_deinterlacing(postproc->filter,
+                GST_VAAPI_DEINTERLACE_METHOD_NONE, 0))
+            goto error_op_deinterlace;
+        ret = ladder_process(postproc, inbuf, inbuf_surface, active_pads, pads,
+            flags, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE);
+        goto restore;
+    }
+
+    /* First field */
+    deint_flags = (tff ? GST_VAAPI_DEINTERLACE_FLAG_TOPFIELD : 0);
+    if (tff)
+        deint_flags |= GST_VAAPI_DEINTERLACE_FLAG_TFF;
+    if (!set_best_deint_method(postproc, deint_flags, &deint_method))
+        goto error_op_deinterlace;
+    deint_refs = deint_method_is_advanced(deint_method);
+    if (deint_refs) {
+        ds_set_surfaces(ds);
+        if (!gst_vaapi_filter_set_deinterlacing_references(postproc->filter,
+                ds->surfaces, ds->num_surfaces, NULL, 0))
+            goto error_op_deinterlace;
+    }
+    ret = ladder_process(postproc, inbuf, inbuf_surface, active_pads, pads,
+        flags, timestamp, postproc->field_duration);
+    if (ret != GST_FLOW_OK)
+        goto restore;
+
+    /* Second field */
+    deint_flags = (tff ? 0 : GST_VAAPI_DEINTERLACE_FLAG_TOPFIELD);
+    if (tff)
+        deint_flags |= GST_VAAPI_DEINTERLACE_FLAG_TFF;
+    if (!gst_vaapi_filter_set_deinterlacing(postproc->filter,
+            deint_method, deint_flags))
+        goto error_op_deinterlace;
+    if (deint_refs && !gst_vaapi_filter_set_deinterlacing_references(
+            postproc->filter, ds->surfaces, ds->num_surfaces, NULL, 0))
+        goto error_op_deinterlace;
+    ret = ladder_process(postproc, inbuf, inbuf_surface, active_pads, pads,
+        flags, GST_CLOCK_TIME_IS_VALID(timestamp) ?
+        timestamp + postproc->field_duration : GST_CLOCK_TIME_NONE,
+        postproc->field_duration);
+
+    if (deint_refs)
+        ds_add_buffer(ds, inbuf);
+
+restore:
+    /* Restore the output format of the main src pad */
+    gst_vaapi_filter_set_format(postproc->filter,
+        (postproc->flags & GST_VAAPI_POSTPROC_FLAG_FORMAT) ?
+        postproc->format : GST_VIDEO_FORMAT_UNKNOWN);
+
+done:
+    if (active_pads)
+        g_ptr_array_unref(active_pads);
+    g_ptr_array_unref(pads);
+
+    /* The main src pad keeps streaming once all renditions are unlinked
+       or EOS */
+    if (ret == GST_FLOW_NOT_LINKED || ret == GST_FLOW_EOS)
+        ret = GST_FLOW_OK;
+    return ret;
+
+    /* ERRORS */
+error_no_vpp:
+    {
+        GST_ERROR("VA/VPP is required for additional outputs");
+        ret = GST_FLOW_NOT_SUPPORTED;
+        goto done;
+    }
+error_invalid_buffer:
+    {
+        GST_ERROR("failed to validate source buffer");
+        ret = GST_FLOW_ERROR;
+        goto done;
+    }
+error_op_format:
+    {
+        GST_ERROR("failed to reset output format for additional outputs");
+        ret = GST_FLOW_NOT_SUPPORTED;
+        goto done;
+    }
+error_op_deinterlace:
+    {
+        GST_ERROR("failed to apply deinterlacing filter to additional outputs");
+        ret = GST_FLOW_NOT_SUPPORTED;
+        goto restore;
+    }
+}
+#endif
+
 static GstFlowReturn
 gst_vaapipostproc_transform(GstBaseTransform *trans, GstBuffer *inbuf,
     GstBuffer *outbuf)
@@ -1142,6 +1684,10 @@ gst_vaapipostproc_transform(GstBaseTransform *trans, GstBuffer *inbuf,
     ret = gst_vaapipostproc_passthrough(trans, buf, outbuf);
 
 done:
+#if GST_CHECK_VERSION(1,0,0)
+    if (ret == GST_FLOW_OK)
+        ret = gst_vaapipostproc_process_ladder(postproc, buf);
+#endif
     gst_buffer_unref(buf);
     return ret;
 }
@@ -1245,12 +1791,145 @@ gst_vaapipostproc_propose_allocation(GstBaseTransform *trans,
 }
 #endif
 
+#if GST_CHECK_VERSION(1,0,0)
+static gboolean
+gst_vaapipostproc_ladder_query(GstPad *pad, GstObject *parent, GstQuery *query)
+{
+    GstVaapiPostproc * const postproc = GST_VAAPIPOSTPROC(parent);
+    GstCaps *caps, *filter;
+
+    if (gst_vaapi_reply_to_query(query, GST_VAAPI_PLUGIN_BASE_DISPLAY(postproc))) {
+        GST_DEBUG("sharing display %p", GST_VAAPI_PLUGIN_BASE_DISPLAY(postproc));
+        return TRUE;
+    }
+
+    switch (GST_QUERY_TYPE(query)) {
+    case GST_QUERY_CAPS:
+        if (!ensure_allowed_srcpad_caps(postproc))
+            return FALSE;
+        gst_query_parse_caps(query, &filter);
+        caps = filter ?
+            gst_caps_intersect_full(filter, postproc->allowed_srcpad_caps,
+                GST_CAPS_INTERSECT_FIRST) :
+            gst_caps_ref(postproc->allowed_srcpad_caps);
+        gst_query_set_caps_result(query, caps);
+        gst_caps_unref(caps);
+        return TRUE;
+    default:
+        break;
+    }
+    return gst_pad_query_default(pad, parent, query);
+}
+
+static GstPad *
+gst_vaapipostproc_request_new_pad(GstElement *element, GstPadTemplate *templ,
+    const gchar *name, const GstCaps *caps)
+{
+    GstVaapiPostproc * const postproc = GST_VAAPIPOSTPROC(element);
+    GstVaapiLadderOutput *output;
+    GstPad *pad;
+    gchar *pad_name;
+
+    GST_OBJECT_LOCK(postproc);
+    pad_name = name ? g_strdup(name) :
+        g_strdup_printf("src_%u", postproc->ladder_pad_id);
+    postproc->ladder_pad_id++;
+    GST_OBJECT_UNLOCK(postproc);
+
+    pad = gst_pad_new_from_template(templ, pad_name);
+    g_free(pad_name);
+    if (!pad)
+        return NULL;
+
+    output = g_slice_new0(GstVaapiLadderOutput);
+    gst_video_info_init(&output->info);
+    output->need_negotiate = TRUE;
+    g_object_set_qdata_full(G_OBJECT(pad), ladder_output_quark(), output,
+        (GDestroyNotify)ladder_output_free);
+    gst_pad_set_query_function(pad, gst_vaapipostproc_ladder_query);
+
+    if (!gst_element_add_pad(element, pad))
+        goto error_add_pad;
+
+    GST_OBJECT_LOCK(postproc);
+    postproc->ladder_pads = g_list_append(postproc->ladder_pads,
+        gst_object_ref(pad));
+    GST_OBJECT_UNLOCK(postproc);
+    return pad;
+
+    /* ERRORS */
+error_add_pad:
+    {
+        GST_ERROR_OBJECT(postproc, "failed to add pad %s",
+            GST_PAD_NAME(pad));
+        gst_object_unref(pad);
+        return NULL;
+    }
+}
+
+static void
+gst_vaapipostproc_release_pad(GstElement *element, GstPad *pad)
+{
+    GstVaapiPostproc * const postproc = GST_VAAPIPOSTPROC(element);
+    GList *l;
+
+    GST_OBJECT_LOCK(postproc);
+    l = g_list_find(postproc->ladder_pads, pad);
+    if (l)
+        postproc->ladder_pads = g_list_delete_link(postproc->ladder_pads, l);
+    GST_OBJECT_UNLOCK(postproc);
+
+    if (!l)
+        return;
+    gst_pad_set_active(pad, FALSE);
+    gst_element_remove_pad(element, pad);
+    gst_object_unref(pad);
+}
+
+static gboolean
+gst_vaapipostproc_sink_event(GstBaseTransform *trans, GstEvent *event)
+{
+    GstVaapiPostproc * const postproc = GST_VAAPIPOSTPROC(trans);
+    GPtrArray *pads;
+    guint i;
+
+    /* Additional outputs get their own caps, along with the sticky
+       events, once they are negotiated on the next buffer */
+    if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS)
+        ladder_reset_outputs(postproc, FALSE);
+    else {
+        if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
+            ladder_reset_flows(postproc);
+
+        pads = ladder_get_pads(postproc);
+        for (i = 0; i < pads->len; i++) {
+            GstPad * const pad = g_ptr_array_index(pads, i);
+            GstVaapiLadderOutput * const output = ladder_output_get(pad);
+            gboolean need_negotiate;
+
+            GST_OBJECT_LOCK(postproc);
+            need_negotiate = output->need_negotiate;
+            GST_OBJECT_UNLOCK(postproc);
+            if (need_negotiate && GST_EVENT_IS_STICKY(event) &&
+                GST_EVENT_TYPE(event) != GST_EVENT_EOS)
+                continue;
+            gst_pad_push_event(pad, gst_event_ref(event));
+        }
+        g_ptr_array_unref(pads);
+    }
+
+    return GST_BASE_TRANSFORM_CLASS(gst_vaapipostproc_parent_class)->
+        sink_event(trans, event);
+}
+#endif
+
 static void
 gst_vaapipostproc_finalize(GObject *object)
 {
     GstVaapiPostproc * const postproc = GST_VAAPIPOSTPROC(object);
 
     gst_vaapipostproc_destroy(postproc);
+    g_list_free_full(postproc->ladder_pads, gst_object_unref);
 
     gst_vaapi_plugin_base_finalize(GST_VAAPI_PLUGIN_BASE(postproc));
     G_OBJECT_CLASS(gst_vaapipostproc_parent_class)->finalize(object);
@@ -1396,6 +2075,9 @@ gst_vaapipostproc_class_init(GstVaapiPostprocClass *klass)
 
 #if GST_CHECK_VERSION(1,0,0)
     trans_class->propose_allocation = gst_vaapipostproc_propose_allocation;
+    trans_class->sink_event     = gst_vaapipostproc_sink_event;
+    element_class->request_new_pad = gst_vaapipostproc_request_new_pad;
+    element_class->release_pad  = gst_vaapipostproc_release_pad;
 #endif
 
     trans_class->prepare_output_buffer =
@@ -1415,6 +2097,13 @@ gst_vaapipostproc_class_init(GstVaapiPostprocClass *klass)
     pad_template = gst_static_pad_template_get(&gst_vaapipostproc_src_factory);
     gst_element_class_add_pad_template(element_class, pad_template);
 
+#if GST_CHECK_VERSION(1,0,0)
+    /* additional src pads */
+    pad_template = gst_static_pad_template_get(
+        &gst_vaapipostproc_ladder_src_factory);
+    gst_element_class_add_pad_template(element_class, pad_template);
+#endif
+
     /**
      * GstVaapiPostproc:deinterlace-mode:
      *
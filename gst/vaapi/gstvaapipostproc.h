@@ -57,6 +57,7 @@ G_BEGIN_DECLS
 typedef struct _GstVaapiPostproc                GstVaapiPostproc;
 typedef struct _GstVaapiPostprocClass           GstVaapiPostprocClass;
 typedef struct _GstVaapiDeinterlaceState        GstVaapiDeinterlaceState;
+typedef struct _GstVaapiLadderOutput            GstVaapiLadderOutput;
 
 /**
  * GstVaapiDeinterlaceMode:
@@ -131,6 +132,25 @@ struct _GstVaapiDeinterlaceState {
     guint                       tff             : 1;
 };
 
+/*
+ * GstVaapiLadderOutput:
+ * @info: the negotiated output video info
+ * @pool: the VA surface pool, shared with outputs of the same size and format
+ * @last_ret: the result of the last push, until the next flush
+ * @need_negotiate: flag: output caps need to be (re)negotiated?
+ *
+ * Context attached to each additional "src_%u" request pad. Those
+ * produce scaled versions of the input frames, with size and format
+ * negotiated with the downstream elements. The fields are protected
+ * by the element object lock.
+ */
+struct _GstVaapiLadderOutput {
+    GstVideoInfo                info;
+    GstVaapiVideoPool          *pool;
+    GstFlowReturn               last_ret;
+    guint                       need_negotiate  : 1;
+};
+
 struct _GstVaapiPostproc {
     /*< private >*/
     GstVaapiPluginBase          parent_instance;
@@ -166,6 +186,11 @@ struct _GstVaapiPostproc {
     gfloat                      brightness;
     gfloat                      contrast;
 
+    /* Additional outputs (request pads) */
+    GList                      *ladder_pads;
+    guint                       ladder_pad_id;
+    GstVaapiDeinterlaceState    ladder_deinterlace_state;
+
     guint                       is_raw_yuv      : 1;
     guint                       use_vpp         : 1;
     guint                       keep_aspect     : 1;
@@ -30,6 +30,7 @@
 #include <gst/vaapi/gstvaapisurfacepool.h>
 
 #include "gstvaapiuploader.h"
+#include "gstvaapiuserptr.h"
 #include "gstvaapipluginutil.h"
 #include "gstvaapivideobuffer.h"
 
@@ -41,6 +42,10 @@ GST_DEBUG_CATEGORY_STATIC(gst_debug_vaapi_uploader);
 
 G_DEFINE_TYPE(GstVaapiUploader, gst_vaapi_uploader, G_TYPE_OBJECT)
 
+/* Maximum number of buffers to copy after user pointer surfaces could
+   not be created, before trying them again */
+#define USER_PTR_MAX_BACKOFF 64
+
 #define GST_VAAPI_UPLOADER_CAST(obj) \
     ((GstVaapiUploader *)(obj))
 
@@ -57,6 +62,8 @@ struct _GstVaapiUploaderPrivate {
     GstVaapiVideoPool  *surfaces;
     GstVideoInfo        surface_info;
     guint               direct_rendering;
+    guint               user_ptr_backoff;
+    guint               user_ptr_skip;
 };
 
 enum {
@@ -387,6 +394,10 @@ gst_vaapi_uploader_ensure_caps(
     }
 
     GST_INFO("direct-rendering: level %u", priv->direct_rendering);
+
+    /* Probe user pointer surfaces again for the new format */
+    priv->user_ptr_backoff = 0;
+    priv->user_ptr_skip = 0;
     return TRUE;
 }
 
@@ -501,6 +512,190 @@ error:
     return buffer;
 }
 
+#if USE_VA_USERPTR
+/* The VA surface wrapping the system memory of a source buffer */
+typedef struct {
+    GstVaapiSurface    *surface;
+    gpointer            data;
+    GstVideoInfo        info;
+} UserPtrSurface;
+
+/* The source buffer held while its VA surface is in use */
+typedef struct {
+    GstBuffer          *buffer;
+#if GST_CHECK_VERSION(1,0,0)
+    GstMapInfo          map_info;
+#endif
+} UserPtrBuffer;
+
+static void
+user_ptr_surface_free(UserPtrSurface *ups)
+{
+    gst_vaapi_object_unref(ups->surface);
+    g_slice_free(UserPtrSurface, ups);
+}
+
+static void
+user_ptr_buffer_free(UserPtrBuffer *upb)
+{
+#if GST_CHECK_VERSION(1,0,0)
+    gst_buffer_unmap(upb->buffer, &upb->map_info);
+#endif
+    gst_buffer_unref(upb->buffer);
+    g_slice_free(UserPtrBuffer, upb);
+}
+
+#if GST_CHECK_VERSION(1,0,0)
+static GQuark
+user_ptr_surface_quark(void)
+{
+    static GQuark quark = 0;
+
+    if (!quark)
+        quark = g_quark_from_static_string("GstVaapiUploaderUserPtrSurface");
+    return quark;
+}
+#endif
+
+static gboolean
+is_same_layout(const GstVideoInfo *a, const GstVideoInfo *b)
+{
+    guint i;
+
+    if (GST_VIDEO_INFO_FORMAT(a) != GST_VIDEO_INFO_FORMAT(b) ||
+        GST_VIDEO_INFO_WIDTH(a) != GST_VIDEO_INFO_WIDTH(b) ||
+        GST_VIDEO_INFO_HEIGHT(a) != GST_VIDEO_INFO_HEIGHT(b) ||
+        GST_VIDEO_INFO_SIZE(a) != GST_VIDEO_INFO_SIZE(b))
+        return FALSE;
+
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES(a); i++) {
+        if (GST_VIDEO_INFO_PLANE_OFFSET(a, i) !=
+            GST_VIDEO_INFO_PLANE_OFFSET(b, i) ||
+            GST_VIDEO_INFO_PLANE_STRIDE(a, i) !=
+            GST_VIDEO_INFO_PLANE_STRIDE(b, i))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static GstVaapiSurface *
+ensure_user_ptr_surface(GstVaapiUploader *uploader, GstBuffer *buffer,
+    gpointer data, const GstVideoInfo *vip)
+{
+    GstVaapiUploaderPrivate * const priv = uploader->priv;
+    GstVaapiSurface *surface;
+#if GST_CHECK_VERSION(1,0,0)
+    GstMiniObject * const mem =
+        GST_MINI_OBJECT_CAST(gst_buffer_peek_memory(buffer, 0));
+    UserPtrSurface *ups;
+
+    /* Upstream buffer pools recycle the same memory, so the surface
+       only needs to be created once per memory */
+    ups = gst_mini_object_get_qdata(mem, user_ptr_surface_quark());
+    if (ups && ups->data == data && is_same_layout(&ups->info, vip))
+        return gst_vaapi_object_ref(ups->surface);
+#endif
+
+    /* Failures may be transient, e.g. while the driver runs short of
+       memory, so fall back to copies for an increasing number of
+       buffers before trying again */
+    surface = gst_vaapi_surface_new_with_user_ptr(priv->display, data, vip);
+    if (!surface) {
+        priv->user_ptr_backoff = CLAMP(priv->user_ptr_backoff * 2, 1,
+            USER_PTR_MAX_BACKOFF);
+        priv->user_ptr_skip = priv->user_ptr_backoff;
+        GST_INFO("could not create VA user pointer surface, copy the next "
+            "%u buffers", priv->user_ptr_skip);
+        return NULL;
+    }
+    priv->user_ptr_backoff = 0;
+
+#if GST_CHECK_VERSION(1,0,0)
+    ups = g_slice_new(UserPtrSurface);
+    ups->surface = gst_vaapi_object_ref(surface);
+    ups->data = data;
+    ups->info = *vip;
+    gst_mini_object_set_qdata(mem, user_ptr_surface_quark(), ups,
+        (GDestroyNotify)user_ptr_surface_free);
+#endif
+    return surface;
+}
+#endif
+
+/* Wraps the system memory of @src_buffer into a VA surface, without
+   any copy. Returns NULL if the buffer does not meet the alignment
+   constraints, or if the VA driver does not support user pointers, in
+   which case the buffer needs to be copied with process() */
+GstBuffer *
+gst_vaapi_uploader_import_buffer(GstVaapiUploader *uploader,
+    GstBuffer *src_buffer)
+{
+#if USE_VA_USERPTR
+    GstVaapiUploaderPrivate *priv;
+    GstVaapiSurfaceProxy *proxy;
+    GstVaapiSurface *surface;
+    GstBuffer *buffer;
+    GstVideoInfo vi;
+    UserPtrBuffer *upb;
+    gpointer data;
+    gsize size;
+
+    g_return_val_if_fail(GST_VAAPI_IS_UPLOADER(uploader), NULL);
+    g_return_val_if_fail(src_buffer != NULL, NULL);
+
+    priv = uploader->priv;
+    if (!priv->display ||
+        GST_VIDEO_INFO_FORMAT(&priv->image_info) == GST_VIDEO_FORMAT_UNKNOWN)
+        return NULL;
+    if (priv->user_ptr_skip > 0) {
+        priv->user_ptr_skip--;
+        return NULL;
+    }
+
+    upb = g_slice_new(UserPtrBuffer);
+    upb->buffer = gst_buffer_ref(src_buffer);
+#if GST_CHECK_VERSION(1,0,0)
+    /* Mapping several memories would merge them into a copy */
+    if (gst_buffer_n_memory(src_buffer) != 1 ||
+        !gst_buffer_map(src_buffer, &upb->map_info, GST_MAP_READ)) {
+        gst_buffer_unref(upb->buffer);
+        g_slice_free(UserPtrBuffer, upb);
+        return NULL;
+    }
+    data = upb->map_info.data;
+    size = upb->map_info.size;
+#else
+    data = GST_BUFFER_DATA(src_buffer);
+    size = GST_BUFFER_SIZE(src_buffer);
+#endif
+
+    if (!gst_vaapi_user_ptr_get_layout(src_buffer, data, size,
+            &priv->image_info, &vi))
+        goto error;
+
+    surface = ensure_user_ptr_surface(uploader, src_buffer, data, &vi);
+    if (!surface)
+        goto error;
+
+    proxy = gst_vaapi_surface_proxy_new(surface);
+    gst_vaapi_object_unref(surface);
+    if (!proxy)
+        goto error;
+    gst_vaapi_surface_proxy_set_destroy_notify(proxy,
+        (GDestroyNotify)user_ptr_buffer_free, upb);
+
+    buffer = gst_vaapi_video_buffer_new_with_surface_proxy(proxy);
+    gst_vaapi_surface_proxy_unref(proxy);
+    return buffer;
+
+error:
+    user_ptr_buffer_free(upb);
+    return NULL;
+#else
+    return NULL;
+#endif
+}
+
 gboolean
 gst_vaapi_uploader_has_direct_rendering(GstVaapiUploader *uploader)
 {
@@ -100,6 +100,13 @@ gst_vaapi_uploader_process(
     GstBuffer        *out_buffer
 );
 
+G_GNUC_INTERNAL
+GstBuffer *
+gst_vaapi_uploader_import_buffer(
+    GstVaapiUploader *uploader,
+    GstBuffer        *src_buffer
+);
+
 G_GNUC_INTERNAL
 GstCaps *
 gst_vaapi_uploader_get_caps(GstVaapiUploader *uploader);
@@ -0,0 +1,109 @@
+/*
+ *  gstvaapiuserptr.c - VA user pointer surfaces helpers
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapiuserptr
+ * @short_description: VA user pointer surfaces helpers
+ *
+ * System memory buffers can be wrapped into VA surfaces without any
+ * copy, provided they meet the alignment constraints of
+ * gst_vaapi_surface_new_with_user_ptr().
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/vaapi/gstvaapisurface.h>
+#include "gstvaapiuserptr.h"
+
+static guint
+get_plane_height (const GstVideoInfo * vip, guint plane)
+{
+  const GstVideoFormatInfo *const finfo = vip->finfo;
+  guint i;
+
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, i) == plane)
+      return GST_VIDEO_INFO_COMP_HEIGHT (vip, i);
+  }
+  return 0;
+}
+
+/**
+ * gst_vaapi_user_ptr_get_layout:
+ * @buffer: a #GstBuffer
+ * @data: the system memory of @buffer
+ * @size: the size of @data, in bytes
+ * @vip: the negotiated #GstVideoInfo
+ * @out_vip: the location where to store the pixels layout
+ *
+ * Determines the plane offsets and strides of @buffer, from the
+ * #GstVideoMeta if any, or from @vip otherwise, and checks whether
+ * @data meets the alignment constraints of VA user pointer surfaces.
+ * The size of @out_vip is @size.
+ *
+ * Return value: %TRUE if @data can be wrapped into a VA surface
+ */
+gboolean
+gst_vaapi_user_ptr_get_layout (GstBuffer * buffer, gconstpointer data,
+    gsize size, const GstVideoInfo * vip, GstVideoInfo * out_vip)
+{
+  gsize plane_end;
+  guint i;
+
+  g_return_val_if_fail (buffer != NULL, FALSE);
+  g_return_val_if_fail (vip != NULL, FALSE);
+  g_return_val_if_fail (out_vip != NULL, FALSE);
+
+  *out_vip = *vip;
+#if GST_CHECK_VERSION(1,0,0)
+  {
+    GstVideoMeta *const vmeta = gst_buffer_get_video_meta (buffer);
+
+    if (vmeta) {
+      if (vmeta->format != GST_VIDEO_INFO_FORMAT (vip) ||
+          vmeta->width != GST_VIDEO_INFO_WIDTH (vip) ||
+          vmeta->height != GST_VIDEO_INFO_HEIGHT (vip) ||
+          vmeta->n_planes != GST_VIDEO_INFO_N_PLANES (vip))
+        return FALSE;
+      for (i = 0; i < vmeta->n_planes; i++) {
+        GST_VIDEO_INFO_PLANE_OFFSET (out_vip, i) = vmeta->offset[i];
+        GST_VIDEO_INFO_PLANE_STRIDE (out_vip, i) = vmeta->stride[i];
+      }
+    }
+  }
+#endif
+
+  if (GPOINTER_TO_SIZE (data) % GST_VAAPI_SURFACE_USER_PTR_ALIGNMENT)
+    return FALSE;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (out_vip); i++) {
+    const gint stride = GST_VIDEO_INFO_PLANE_STRIDE (out_vip, i);
+
+    if (stride <= 0 || stride % GST_VAAPI_SURFACE_USER_PTR_STRIDE_ALIGNMENT)
+      return FALSE;
+
+    plane_end = GST_VIDEO_INFO_PLANE_OFFSET (out_vip, i) +
+        (gsize) stride * get_plane_height (out_vip, i);
+    if (plane_end > size)
+      return FALSE;
+  }
+  GST_VIDEO_INFO_SIZE (out_vip) = size;
+  return TRUE;
+}
@@ -27,6 +27,9 @@
 #if GST_CHECK_VERSION(1,1,0) && USE_GLX
 #include "gstvaapivideometa_texture.h"
 #endif
+#if USE_DMABUF
+#include "gstvaapidmabuf.h"
+#endif
 
 GST_DEBUG_CATEGORY_STATIC(gst_debug_vaapivideopool);
 #define GST_CAT_DEFAULT gst_debug_vaapivideopool
@@ -45,10 +48,12 @@ struct _GstVaapiVideoBufferPoolPrivate {
     GstVideoInfo        video_info[2];
     guint               video_info_index;
     GstAllocator       *allocator;
+    GstAllocator       *dmabuf_allocator;
     GstVaapiDisplay    *display;
     guint               has_video_meta          : 1;
     guint               has_video_alignment     : 1;
     guint               has_texture_upload_meta : 1;
+    guint               has_dmabuf_memory       : 1;
 };
 
 #define GST_VAAPI_VIDEO_BUFFER_POOL_GET_PRIVATE(obj)    \
@@ -66,6 +71,7 @@ gst_vaapi_video_buffer_pool_finalize(GObject *object)
 
     gst_vaapi_display_replace(&priv->display, NULL);
     g_clear_object(&priv->allocator);
+    g_clear_object(&priv->dmabuf_allocator);
 }
 
 static void
@@ -123,6 +129,9 @@ gst_vaapi_video_buffer_pool_get_options(GstBufferPool *pool)
         GST_BUFFER_POOL_OPTION_VAAPI_VIDEO_META,
         GST_BUFFER_POOL_OPTION_VIDEO_GL_TEXTURE_UPLOAD_META,
         GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT,
+#if USE_DMABUF
+        GST_BUFFER_POOL_OPTION_DMABUF_MEMORY,
+#endif
         NULL,
     };
     return g_options;
@@ -178,6 +187,19 @@ gst_vaapi_video_buffer_pool_set_config(GstBufferPool *pool,
     priv->has_texture_upload_meta = gst_buffer_pool_config_has_option(config,
         GST_BUFFER_POOL_OPTION_VIDEO_GL_TEXTURE_UPLOAD_META);
 
+#if USE_DMABUF
+    /* DMA-BUF memory exposes the raw surface layout, so this is only
+       possible if the surfaces are directly in the negotiated format */
+    priv->has_dmabuf_memory = gst_buffer_pool_config_has_option(config,
+        GST_BUFFER_POOL_OPTION_DMABUF_MEMORY) &&
+        GST_VAAPI_VIDEO_ALLOCATOR_CAST(priv->allocator)->has_direct_rendering;
+    if (priv->has_dmabuf_memory && !priv->dmabuf_allocator) {
+        priv->dmabuf_allocator = gst_dmabuf_allocator_new();
+        if (!priv->dmabuf_allocator)
+            goto error_create_dmabuf_allocator;
+    }
+#endif
+
     return GST_BUFFER_POOL_CLASS(gst_vaapi_video_buffer_pool_parent_class)->
         set_config(pool, config);
 
@@ -202,8 +224,49 @@ error_no_vaapi_video_meta_option:
         GST_ERROR("no GstVaapiVideoMeta option");
         return FALSE;
     }
+#if USE_DMABUF
+error_create_dmabuf_allocator:
+    {
+        GST_ERROR("failed to create GstDmaBufAllocator object");
+        return FALSE;
+    }
+#endif
+}
+
+#if USE_DMABUF
+/* The DMA-BUF memory the buffer was allocated with */
+static GQuark
+dmabuf_memory_quark(void)
+{
+    static GQuark quark = 0;
+
+    if (!quark)
+        quark = g_quark_from_static_string("GstVaapiVideoPoolDmaBufMemory");
+    return quark;
 }
 
+static GstMemory *
+new_dmabuf_memory(GstVaapiVideoBufferPool *pool, GstVaapiVideoMeta *meta)
+{
+    GstVaapiVideoBufferPoolPrivate * const priv = pool->priv;
+    GstVaapiVideoAllocator * const allocator =
+        GST_VAAPI_VIDEO_ALLOCATOR_CAST(priv->allocator);
+    GstVaapiSurfaceProxy *proxy;
+    GstMemory *mem;
+
+    proxy = gst_vaapi_surface_proxy_new_from_pool(
+        GST_VAAPI_SURFACE_POOL(allocator->surface_pool));
+    if (!proxy)
+        return NULL;
+
+    mem = gst_vaapi_dmabuf_memory_new(priv->dmabuf_allocator, proxy);
+    if (mem)
+        gst_vaapi_video_meta_set_surface_proxy(meta, proxy);
+    gst_vaapi_surface_proxy_unref(proxy);
+    return mem;
+}
+#endif
+
 static GstFlowReturn
 gst_vaapi_video_buffer_pool_alloc_buffer(GstBufferPool *pool,
     GstBuffer **out_buffer_ptr, GstBufferPoolAcquireParams *params)
@@ -225,7 +288,20 @@ gst_vaapi_video_buffer_pool_alloc_buffer(GstBufferPool *pool,
     if (!buffer)
         goto error_create_buffer;
 
-    mem = gst_vaapi_video_memory_new(priv->allocator, meta);
+    mem = NULL;
+#if USE_DMABUF
+    if (priv->has_dmabuf_memory) {
+        mem = new_dmabuf_memory(GST_VAAPI_VIDEO_BUFFER_POOL(pool), meta);
+        if (mem)
+            gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(buffer),
+                dmabuf_memory_quark(), gst_memory_ref(mem),
+                (GDestroyNotify)gst_memory_unref);
+        else
+            GST_WARNING("failed to export surface, using VA video memory");
+    }
+#endif
+    if (!mem)
+        mem = gst_vaapi_video_memory_new(priv->allocator, meta);
     if (!mem)
         goto error_create_memory;
     gst_vaapi_video_meta_unref(meta);
@@ -241,8 +317,10 @@ gst_vaapi_video_buffer_pool_alloc_buffer(GstBufferPool *pool,
             GST_VIDEO_INFO_HEIGHT(vip), GST_VIDEO_INFO_N_PLANES(vip),
             &GST_VIDEO_INFO_PLANE_OFFSET(vip, 0),
             &GST_VIDEO_INFO_PLANE_STRIDE(vip, 0));
-        vmeta->map = gst_video_meta_map_vaapi_memory;
-        vmeta->unmap = gst_video_meta_unmap_vaapi_memory;
+        if (mem->allocator == priv->allocator) {
+            vmeta->map = gst_video_meta_map_vaapi_memory;
+            vmeta->unmap = gst_video_meta_unmap_vaapi_memory;
+        }
     }
 
 #if GST_CHECK_VERSION(1,1,0) && USE_GLX
@@ -284,6 +362,20 @@ gst_vaapi_video_buffer_pool_reset_buffer(GstBufferPool *pool, GstBuffer *buffer)
 {
     GstMemory * const mem = gst_buffer_peek_memory(buffer, 0);
 
+#if USE_DMABUF
+    GstMemory * const dmabuf_mem = gst_mini_object_get_qdata(
+        GST_MINI_OBJECT_CAST(buffer), dmabuf_memory_quark());
+
+    /* Restore the exported surface, in case it was replaced */
+    if (dmabuf_mem) {
+        if (mem != dmabuf_mem)
+            gst_buffer_replace_memory(buffer, 0, gst_memory_ref(dmabuf_mem));
+        gst_vaapi_video_meta_set_surface_proxy(
+            gst_buffer_get_vaapi_video_meta(buffer),
+            gst_vaapi_dmabuf_memory_get_surface_proxy(dmabuf_mem));
+    }
+    else
+#endif
     /* Release the underlying surface proxy */
     gst_vaapi_video_memory_reset_surface(GST_VAAPI_VIDEO_MEMORY_CAST(mem));
 
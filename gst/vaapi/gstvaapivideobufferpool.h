@@ -74,6 +74,17 @@ typedef struct _GstVaapiVideoBufferPoolPrivate  GstVaapiVideoBufferPoolPrivate;
     "GstBufferPoolOptionVideoGLTextureUploadMeta"
 #endif
 
+/**
+ * GST_BUFFER_POOL_OPTION_DMABUF_MEMORY:
+ *
+ * An option that can be activated on bufferpool to request buffers
+ * made of DMA-BUF memory exporting the underlying VA surfaces.
+ *
+ * When this option is enabled on the bufferpool,
+ * #GST_BUFFER_POOL_OPTION_VIDEO_META should also be enabled.
+ */
+#define GST_BUFFER_POOL_OPTION_DMABUF_MEMORY "GstBufferPoolOptionDMABUFMemory"
+
 /**
  * GstVaapiVideoBufferPool:
  *
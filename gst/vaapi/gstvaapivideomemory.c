@@ -92,6 +92,72 @@ ensure_image(GstVaapiVideoMemory *mem)
     return TRUE;
 }
 
+/* Ensures the VA image is ready for a CPU access with the supplied map
+   flags. If the surface can be derived into an image with the exposed
+   layout, the pixels are accessed in place. Otherwise, the surface pixels
+   are only downloaded if they are going to be read, and if the image does
+   not already hold them */
+static gboolean
+ensure_image_for_map(GstVaapiVideoMemory *mem, GstMapFlags flags)
+{
+    GstVaapiVideoAllocator * const allocator =
+        GST_VAAPI_VIDEO_ALLOCATOR_CAST(GST_MEMORY_CAST(mem)->allocator);
+    GstVaapiImage *image;
+
+    if (mem->use_direct_rendering || !allocator->has_derived_images)
+        goto get_image;
+    if (mem->use_derived_image)
+        return TRUE;
+
+    image = gst_vaapi_surface_derive_image(mem->surface);
+    if (!image)
+        goto get_image;
+    if (GST_VAAPI_IMAGE_FORMAT(image) !=
+        GST_VIDEO_INFO_FORMAT(mem->image_info)) {
+        gst_vaapi_object_unref(image);
+        goto get_image;
+    }
+
+    gst_vaapi_video_memory_reset_image(mem);
+    mem->image = image;
+    mem->use_derived_image = TRUE;
+    gst_vaapi_video_meta_set_image(mem->meta, mem->image);
+    return TRUE;
+
+get_image:
+    if (!ensure_image(mem))
+        return FALSE;
+    if (mem->use_direct_rendering || mem->image_is_current ||
+        !(flags & GST_MAP_READ))
+        return TRUE;
+    if (!gst_vaapi_surface_get_image(mem->surface, mem->image))
+        return FALSE;
+    mem->image_is_current = TRUE;
+    return TRUE;
+}
+
+/* Records that the image pixels are going to be changed by the CPU, and
+   that they need to be committed to the surface on unmap */
+static inline void
+mark_image_dirty(GstVaapiVideoMemory *mem)
+{
+    if (!mem->use_direct_rendering && !mem->use_derived_image)
+        mem->image_is_dirty = TRUE;
+}
+
+/* Commits the image pixels to the surface, if they were changed */
+static gboolean
+flush_image(GstVaapiVideoMemory *mem)
+{
+    if (!mem->image_is_dirty)
+        return TRUE;
+
+    mem->image_is_dirty = FALSE;
+    mem->image_is_current = gst_vaapi_surface_put_image(mem->surface,
+        mem->image);
+    return mem->image_is_current;
+}
+
 static GstVaapiSurface *
 new_surface(GstVaapiDisplay *display, const GstVideoInfo *vip)
 {
@@ -130,6 +196,8 @@ new_surface_proxy(GstVaapiVideoMemory *mem)
 static gboolean
 ensure_surface(GstVaapiVideoMemory *mem)
 {
+    GstVaapiSurface *surface;
+
     if (!mem->proxy) {
         gst_vaapi_surface_proxy_replace(&mem->proxy,
             gst_vaapi_video_meta_get_surface_proxy(mem->meta));
@@ -141,7 +209,14 @@ ensure_surface(GstVaapiVideoMemory *mem)
             gst_vaapi_video_meta_set_surface_proxy(mem->meta, mem->proxy);
         }
     }
-    mem->surface = GST_VAAPI_SURFACE_PROXY_SURFACE(mem->proxy);
+
+    surface = GST_VAAPI_SURFACE_PROXY_SURFACE(mem->proxy);
+    if (mem->surface != surface) {
+        if (mem->use_derived_image)
+            gst_vaapi_video_memory_reset_image(mem);
+        mem->surface = surface;
+        mem->image_is_current = FALSE;
+    }
     return mem->surface != NULL;
 }
 
@@ -161,26 +236,21 @@ gst_video_meta_map_vaapi_memory(GstVideoMeta *meta, guint plane,
         mem->map_type != GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_PLANAR)
         goto error_incompatible_map;
 
-    /* Map for writing */
+    /* Map for reading and/or writing */
     if (++mem->map_count == 1) {
         if (!ensure_surface(mem))
             goto error_ensure_surface;
-        if (!ensure_image(mem))
-            goto error_ensure_image;
 
-        // Check that we can actually map the surface, or image
-        if ((flags & GST_MAP_READWRITE) == GST_MAP_READWRITE &&
-            !mem->use_direct_rendering)
-            goto error_unsupported_map;
-
-        // Load VA image from surface
-        if ((flags & GST_MAP_READ) && !mem->use_direct_rendering)
-            gst_vaapi_surface_get_image(mem->surface, mem->image);
+        // Load VA image from surface, if needed
+        if (!ensure_image_for_map(mem, flags))
+            goto error_ensure_image;
 
         if (!gst_vaapi_image_map(mem->image))
             goto error_map_image;
         mem->map_type = GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_PLANAR;
     }
+    if (flags & GST_MAP_WRITE)
+        mark_image_dirty(mem);
 
     *data = gst_vaapi_image_get_plane(mem->image, plane);
     *stride = gst_vaapi_image_get_pitch(mem->image, plane);
@@ -193,11 +263,6 @@ error_incompatible_map:
         GST_ERROR("incompatible map type (%d)", mem->map_type);
         return FALSE;
     }
-error_unsupported_map:
-    {
-        GST_ERROR("unsupported map flags (0x%x)", flags);
-        return FALSE;
-    }
 error_ensure_surface:
     {
         const GstVideoInfo * const vip = mem->surface_info;
@@ -243,11 +308,9 @@ gst_video_meta_unmap_vaapi_memory(GstVideoMeta *meta, guint plane,
         if (info->flags & GST_MAP_READWRITE)
             gst_vaapi_image_unmap(mem->image);
 
-        /* Commit VA image to surface */
-        if ((info->flags & GST_MAP_WRITE) && !mem->use_direct_rendering) {
-            if (!gst_vaapi_surface_put_image(mem->surface, mem->image))
-                goto error_upload_image;
-        }
+        /* Commit VA image to surface, if it was written to */
+        if (!flush_image(mem))
+            goto error_upload_image;
     }
     return TRUE;
 
@@ -286,6 +349,9 @@ gst_vaapi_video_memory_new(GstAllocator *base_allocator,
     mem->map_type = 0;
     mem->map_count = 0;
     mem->use_direct_rendering = allocator->has_direct_rendering;
+    mem->use_derived_image = FALSE;
+    mem->image_is_current = FALSE;
+    mem->image_is_dirty = FALSE;
     return GST_MEMORY_CAST(mem);
 }
 
@@ -306,12 +372,16 @@ gst_vaapi_video_memory_reset_image(GstVaapiVideoMemory *mem)
     GstVaapiVideoAllocator * const allocator =
         GST_VAAPI_VIDEO_ALLOCATOR_CAST(GST_MEMORY_CAST(mem)->allocator);
 
-    if (mem->use_direct_rendering)
+    if (mem->use_direct_rendering || mem->use_derived_image) {
         gst_vaapi_object_replace(&mem->image, NULL);
+        mem->use_derived_image = FALSE;
+    }
     else if (mem->image) {
         gst_vaapi_video_pool_put_object(allocator->image_pool, mem->image);
         mem->image = NULL;
     }
+    mem->image_is_current = FALSE;
+    mem->image_is_dirty = FALSE;
 }
 
 void
@@ -337,15 +407,18 @@ gst_vaapi_video_memory_map(GstVaapiVideoMemory *mem, gsize maxsize, guint flags)
             if (!mem->proxy)
                 goto error_no_surface_proxy;
             mem->map_type = GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_SURFACE;
+
+            // The surface could be rendered to from now on
+            mem->image_is_current = FALSE;
             break;
         case GST_MAP_READ:
-            // Only read flag set: return raw pixels
+        case GST_MAP_WRITE:
+        case GST_MAP_READWRITE:
+            // Read and/or write flags set: return raw pixels
             if (!ensure_surface(mem))
                 goto error_no_surface;
-            if (!ensure_image(mem))
+            if (!ensure_image_for_map(mem, flags))
                 goto error_no_image;
-            if (!mem->use_direct_rendering)
-                gst_vaapi_surface_get_image(mem->surface, mem->image);
             if (!gst_vaapi_image_map(mem->image))
                 goto error_map_image;
             mem->map_type = GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_LINEAR;
@@ -364,6 +437,8 @@ gst_vaapi_video_memory_map(GstVaapiVideoMemory *mem, gsize maxsize, guint flags)
     case GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_LINEAR:
         if (!mem->image)
             goto error_no_image;
+        if (flags & GST_MAP_WRITE)
+            mark_image_dirty(mem);
         data = get_image_data(mem->image);
         break;
     default:
@@ -403,6 +478,8 @@ gst_vaapi_video_memory_unmap(GstVaapiVideoMemory *mem)
             break;
         case GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_LINEAR:
             gst_vaapi_image_unmap(mem->image);
+            if (!flush_image(mem))
+                GST_ERROR("failed to upload image");
             break;
         default:
             goto error_incompatible_map;
@@ -581,6 +658,47 @@ gst_video_info_update_from_image(GstVideoInfo *vip, GstVaapiImage *image)
     return TRUE;
 }
 
+/* Checks whether surfaces can be derived into images with the exact same
+   layout as the exposed one, so that they could be mapped in place */
+static gboolean
+has_derived_images(GstVaapiDisplay *display, const GstVideoInfo *surface_info,
+    const GstVideoInfo *image_info)
+{
+    GstVaapiSurface *surface;
+    GstVaapiImage *image = NULL;
+    GstVideoInfo vi;
+    gboolean success = FALSE;
+    guint i;
+
+    surface = new_surface(display, surface_info);
+    if (!surface)
+        return FALSE;
+
+    do {
+        image = gst_vaapi_surface_derive_image(surface);
+        if (!image)
+            break;
+        if (GST_VAAPI_IMAGE_FORMAT(image) != GST_VIDEO_INFO_FORMAT(image_info))
+            break;
+        if (!gst_vaapi_image_map(image))
+            break;
+        success = gst_video_info_update_from_image(&vi, image) &&
+            GST_VIDEO_INFO_SIZE(&vi) <= GST_VIDEO_INFO_SIZE(image_info);
+        for (i = 0; success && i < GST_VIDEO_INFO_N_PLANES(&vi); i++) {
+            if (GST_VIDEO_INFO_PLANE_OFFSET(&vi, i) !=
+                GST_VIDEO_INFO_PLANE_OFFSET(image_info, i) ||
+                GST_VIDEO_INFO_PLANE_STRIDE(&vi, i) !=
+                GST_VIDEO_INFO_PLANE_STRIDE(image_info, i))
+                success = FALSE;
+        }
+        gst_vaapi_image_unmap(image);
+    } while (0);
+    if (image)
+        gst_vaapi_object_unref(image);
+    gst_vaapi_object_unref(surface);
+    return success;
+}
+
 GstAllocator *
 gst_vaapi_video_allocator_new(GstVaapiDisplay *display, const GstVideoInfo *vip)
 {
@@ -650,6 +768,13 @@ gst_vaapi_video_allocator_new(GstVaapiDisplay *display, const GstVideoInfo *vip)
             gst_vaapi_image_unmap(image);
         } while (0);
         gst_vaapi_object_unref(image);
+
+        if (GST_VIDEO_INFO_FORMAT(vip) != GST_VIDEO_FORMAT_ENCODED)
+            allocator->has_derived_images = has_derived_images(display,
+                &allocator->surface_info, &allocator->image_info);
+        GST_INFO("has derived image maps for %s surfaces: %s",
+                 GST_VIDEO_INFO_FORMAT_STRING(&allocator->image_info),
+                 allocator->has_derived_images ? "yes" : "no");
     }
 
     allocator->image_pool = gst_vaapi_image_pool_new(display,
@@ -55,7 +55,8 @@ typedef struct _GstVaapiVideoAllocatorClass     GstVaapiVideoAllocatorClass;
  * @GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_PLANAR: map individual plane with
  *   gst_video_frame_map()
  * @GST_VAAPI_VIDEO_MEMORY_MAP_TYPE_LINEAR: map with gst_buffer_map()
- *   and flags = GST_MAP_READ to return the raw pixels of the whole image
+ *   and flags = GST_MAP_READ and/or GST_MAP_WRITE to return the raw
+ *   pixels of the whole image
  *
  * The set of all #GstVaapiVideoMemory map types.
  */
@@ -84,6 +85,9 @@ struct _GstVaapiVideoMemory {
     guint               map_type;
     gint                map_count;
     gboolean            use_direct_rendering;
+    gboolean            use_derived_image;
+    gboolean            image_is_current;
+    gboolean            image_is_dirty;
 };
 
 G_GNUC_INTERNAL
@@ -139,6 +143,7 @@ struct _GstVaapiVideoAllocator {
     GstVideoInfo        image_info;
     GstVaapiVideoPool  *image_pool;
     gboolean            has_direct_rendering;
+    gboolean            has_derived_images;
 };
 
 /**
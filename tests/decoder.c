@@ -50,6 +50,8 @@ static const CodecDefs g_codec_defs[] = {
     INIT_FUNCS(h264),
     INIT_FUNCS(vc1),
 #undef INIT_FUNCS
+    /* Same JPEG image, submitted as frame-aligned MJPEG */
+    { "mjpeg", jpeg_get_video_info },
     { NULL, }
 };
 
@@ -112,6 +114,9 @@ decoder_new(GstVaapiDisplay *display, const gchar *codec_name)
 #if USE_JPEG_DECODER
     case GST_VAAPI_CODEC_JPEG:
         decoder = gst_vaapi_decoder_jpeg_new(display, caps);
+        if (decoder && strcmp(codec->codec_str, "mjpeg") == 0)
+            gst_vaapi_decoder_jpeg_set_frame_aligned(
+                GST_VAAPI_DECODER_JPEG(decoder), TRUE);
         break;
 #endif
     case GST_VAAPI_CODEC_MPEG2:
@@ -0,0 +1,84 @@
+/*
+ *  stub-display.c - VA display backed by the stub VA driver
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* The display is created without any native display, and libva is
+   redirected to the stub driver built along with the tests. Tests can
+   then intercept the driver vtable through the VA driver context */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include "stub-display.h"
+
+#ifndef VA_DISPLAY_MAGIC
+#define VA_DISPLAY_MAGIC 0x56414430 /* VAD0 */
+#endif
+
+static int
+va_DisplayContextIsValid(VADisplayContextP pDisplayContext)
+{
+    return pDisplayContext->pDriverContext != NULL;
+}
+
+static void
+va_DisplayContextDestroy(VADisplayContextP pDisplayContext)
+{
+    g_free(pDisplayContext->pDriverContext);
+    g_free(pDisplayContext);
+}
+
+static VAStatus
+va_DisplayContextGetDriverName(VADisplayContextP pDisplayContext,
+    char **driver_name)
+{
+    *driver_name = strdup("stub");
+    return VA_STATUS_SUCCESS;
+}
+
+GstVaapiDisplay *
+stub_display_new(void)
+{
+    VADisplayContextP pDisplayContext;
+    VADriverContextP pDriverContext;
+
+    g_setenv("LIBVA_DRIVERS_PATH", STUB_VA_DRIVER_PATH, TRUE);
+    g_setenv("LIBVA_DRIVER_NAME", "stub", TRUE);
+
+    /* The capabilities of the stub driver change along with the tests,
+       so never trust (nor pollute) the user's display caps cache */
+    g_setenv("GST_VAAPI_DISABLE_CAPS_CACHE", "1", TRUE);
+
+    pDriverContext = g_new0(VADriverContext, 1);
+    pDisplayContext = g_new0(VADisplayContext, 1);
+    pDisplayContext->vadpy_magic = VA_DISPLAY_MAGIC;
+    pDisplayContext->pDriverContext = pDriverContext;
+    pDisplayContext->vaIsValid = va_DisplayContextIsValid;
+    pDisplayContext->vaDestroy = va_DisplayContextDestroy;
+    pDisplayContext->vaGetDriverName = va_DisplayContextGetDriverName;
+    pDriverContext->pDriverData = NULL;
+
+    return gst_vaapi_display_new_with_display((VADisplay)pDisplayContext);
+}
+
+VADriverContextP
+stub_display_get_driver_context(VADisplay va_display)
+{
+    return ((VADisplayContextP)va_display)->pDriverContext;
+}
@@ -0,0 +1,35 @@
+/*
+ *  stub-display.h - VA display backed by the stub VA driver
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef STUB_DISPLAY_H
+#define STUB_DISPLAY_H
+
+#include <va/va.h>
+#include <va/va_backend.h>
+#include <gst/vaapi/gstvaapidisplay.h>
+
+GstVaapiDisplay *
+stub_display_new(void);
+
+VADriverContextP
+stub_display_get_driver_context(VADisplay va_display);
+
+#endif /* STUB_DISPLAY_H */
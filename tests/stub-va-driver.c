@@ -0,0 +1,1075 @@
+/*
+ *  stub-va-driver.c - Stub VA driver emulating H.264, JPEG, MPEG-2, VP8
+ *                     and VP9 decoders, an H.264 encoder, and a video
+ *                     processing pipeline
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This VA driver does not decode anything: it only keeps track of the
+   VA objects, and emulates the time a hardware decoder would take.
+   VA contexts take STUB_VA_CONTEXT_TIME microseconds to create, and
+   pictures are decoded one after the other at STUB_VA_DECODE_RATE
+   megapixels per second, asynchronously to vaEndPicture(). Video
+   processing jobs are accounted for by the size of their output region.
+   NV12 images can be created, but never derived from surfaces, and no
+   pixels are actually transferred by vaGetImage() or vaPutImage().
+   H.264 pictures are "encoded" instantly: their coded buffer holds the
+   packed headers submitted along with them, and nothing else */
+
+#include <string.h>
+#include <glib.h>
+#include <gmodule.h>
+#include <va/va.h>
+#include <va/va_backend.h>
+#if VA_CHECK_VERSION(0,33,0)
+#include <va/va_dec_jpeg.h>
+#define STUB_HAS_JPEG 1
+#endif
+#if VA_CHECK_VERSION(0,35,0)
+#include <va/va_dec_vp8.h>
+#define STUB_HAS_VP8 1
+#endif
+#if VA_CHECK_VERSION(0,38,0)
+#include <va/va_dec_vp9.h>
+#define STUB_HAS_VP9 1
+#endif
+#if VA_CHECK_VERSION(0,34,0)
+#include <va/va_vpp.h>
+#include <va/va_backend_vpp.h>
+#define STUB_HAS_VPP 1
+#include <va/va_enc_h264.h>
+#define STUB_HAS_H264_ENCODER 1
+#endif
+
+#define DEFAULT_CONTEXT_TIME    5000    /* us */
+#define DEFAULT_DECODE_RATE     400     /* Mpixels/s */
+
+#define STUB_DRIVER_INIT \
+    G_PASTE(__vaDriverInit_, G_PASTE(VA_MAJOR_VERSION, G_PASTE(_, VA_MINOR_VERSION)))
+
+typedef struct _StubDriver      StubDriver;
+typedef struct _StubConfig      StubConfig;
+typedef struct _StubSurface     StubSurface;
+typedef struct _StubContext     StubContext;
+typedef struct _StubBuffer      StubBuffer;
+
+struct _StubDriver {
+    GHashTable         *configs;
+    GHashTable         *surfaces;
+    GHashTable         *contexts;
+    GHashTable         *buffers;
+    GHashTable         *images;
+    guint               next_id;
+    gint64              context_time;
+    gint64              decode_rate;
+    gint64              idle_time;
+};
+
+struct _StubConfig {
+    VAProfile           profile;
+    VAEntrypoint        entrypoint;
+};
+
+struct _StubSurface {
+    gint64              ready_time;
+};
+
+struct _StubContext {
+    VAProfile           profile;
+    VAEntrypoint        entrypoint;
+    StubSurface        *render_target;
+    GArray             *render_targets;
+    guint               num_pixels;
+    VABufferID          coded_buf;
+    GByteArray         *coded_data;
+};
+
+struct _StubBuffer {
+    VABufferType        type;
+    guchar             *data;
+    guint               size;
+};
+
+#define STUB_DRIVER(ctx) ((StubDriver *)(ctx)->pDriverData)
+
+static const VAProfile stub_profiles[] = {
+    VAProfileH264ConstrainedBaseline,
+    VAProfileH264Main,
+    VAProfileH264High,
+    VAProfileMPEG2Simple,
+    VAProfileMPEG2Main,
+#if STUB_HAS_JPEG
+    VAProfileJPEGBaseline,
+#endif
+#if STUB_HAS_VP8
+    VAProfileVP8Version0_3,
+#endif
+#if STUB_HAS_VP9
+    VAProfileVP9Profile0,
+#endif
+};
+
+/* The H.264 profiles can be decoded and encoded */
+#if STUB_HAS_H264_ENCODER
+static const VAProfile stub_encode_profiles[] = {
+    VAProfileH264ConstrainedBaseline,
+    VAProfileH264Main,
+    VAProfileH264High,
+};
+
+#define STUB_PACKED_HEADERS \
+    (VA_ENC_PACKED_HEADER_SEQUENCE | VA_ENC_PACKED_HEADER_PICTURE | \
+     VA_ENC_PACKED_HEADER_SLICE | VA_ENC_PACKED_HEADER_RAW_DATA)
+#endif
+
+static gboolean
+is_encode_profile(VAProfile profile)
+{
+#if STUB_HAS_H264_ENCODER
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(stub_encode_profiles); i++) {
+        if (stub_encode_profiles[i] == profile)
+            return TRUE;
+    }
+#endif
+    return FALSE;
+}
+
+static gboolean
+is_supported_profile(VAProfile profile)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(stub_profiles); i++) {
+        if (stub_profiles[i] == profile)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean
+is_supported_config(VAProfile profile, VAEntrypoint entrypoint)
+{
+#if STUB_HAS_VPP
+    if (profile == VAProfileNone)
+        return entrypoint == VAEntrypointVideoProc;
+#endif
+    if (entrypoint == VAEntrypointEncSlice)
+        return is_encode_profile(profile);
+    return is_supported_profile(profile) && entrypoint == VAEntrypointVLD;
+}
+
+static gint64
+get_env_value(const gchar *name, gint64 default_value)
+{
+    const gchar * const value = g_getenv(name);
+
+    return value ? g_ascii_strtoll(value, NULL, 10) : default_value;
+}
+
+static void
+stub_buffer_free(StubBuffer *buffer)
+{
+    g_free(buffer->data);
+    g_slice_free(StubBuffer, buffer);
+}
+
+static void
+stub_context_free(StubContext *stub_context)
+{
+    g_byte_array_unref(stub_context->coded_data);
+    g_array_free(stub_context->render_targets, TRUE);
+    g_slice_free(StubContext, stub_context);
+}
+
+static VAStatus
+stub_Terminate(VADriverContextP ctx)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+
+    g_hash_table_unref(driver->configs);
+    g_hash_table_unref(driver->surfaces);
+    g_hash_table_unref(driver->contexts);
+    g_hash_table_unref(driver->buffers);
+    g_hash_table_unref(driver->images);
+    g_slice_free(StubDriver, driver);
+    ctx->pDriverData = NULL;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_QueryConfigProfiles(VADriverContextP ctx, VAProfile *profile_list,
+    int *num_profiles)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(stub_profiles); i++)
+        profile_list[i] = stub_profiles[i];
+    *num_profiles = G_N_ELEMENTS(stub_profiles);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_QueryConfigEntrypoints(VADriverContextP ctx, VAProfile profile,
+    VAEntrypoint *entrypoint_list, int *num_entrypoints)
+{
+#if STUB_HAS_VPP
+    if (profile == VAProfileNone) {
+        entrypoint_list[0] = VAEntrypointVideoProc;
+        *num_entrypoints = 1;
+        return VA_STATUS_SUCCESS;
+    }
+#endif
+    if (!is_supported_profile(profile))
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+
+    entrypoint_list[0] = VAEntrypointVLD;
+    *num_entrypoints = 1;
+    if (is_encode_profile(profile))
+        entrypoint_list[(*num_entrypoints)++] = VAEntrypointEncSlice;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_GetConfigAttributes(VADriverContextP ctx, VAProfile profile,
+    VAEntrypoint entrypoint, VAConfigAttrib *attrib_list, int num_attribs)
+{
+    int i;
+
+    for (i = 0; i < num_attribs; i++) {
+        switch (attrib_list[i].type) {
+        case VAConfigAttribRTFormat:
+            attrib_list[i].value = VA_RT_FORMAT_YUV420;
+            break;
+#if STUB_HAS_H264_ENCODER
+        case VAConfigAttribRateControl:
+            attrib_list[i].value = entrypoint == VAEntrypointEncSlice ?
+                (VA_RC_CQP | VA_RC_CBR | VA_RC_VBR) : VA_ATTRIB_NOT_SUPPORTED;
+            break;
+        case VAConfigAttribEncPackedHeaders:
+            attrib_list[i].value = entrypoint == VAEntrypointEncSlice ?
+                STUB_PACKED_HEADERS : VA_ATTRIB_NOT_SUPPORTED;
+            break;
+#endif
+        default:
+            attrib_list[i].value = VA_ATTRIB_NOT_SUPPORTED;
+            break;
+        }
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_CreateConfig(VADriverContextP ctx, VAProfile profile,
+    VAEntrypoint entrypoint, VAConfigAttrib *attrib_list, int num_attribs,
+    VAConfigID *config_id)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    StubConfig *config;
+
+    if (!is_supported_config(profile, entrypoint))
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+
+    config = g_new(StubConfig, 1);
+    config->profile = profile;
+    config->entrypoint = entrypoint;
+    *config_id = ++driver->next_id;
+    g_hash_table_insert(driver->configs, GUINT_TO_POINTER(*config_id), config);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_DestroyConfig(VADriverContextP ctx, VAConfigID config_id)
+{
+    if (!g_hash_table_remove(STUB_DRIVER(ctx)->configs,
+            GUINT_TO_POINTER(config_id)))
+        return VA_STATUS_ERROR_INVALID_CONFIG;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_QueryConfigAttributes(VADriverContextP ctx, VAConfigID config_id,
+    VAProfile *profile, VAEntrypoint *entrypoint, VAConfigAttrib *attrib_list,
+    int *num_attribs)
+{
+    StubConfig * const config = g_hash_table_lookup(STUB_DRIVER(ctx)->configs,
+        GUINT_TO_POINTER(config_id));
+
+    if (!config)
+        return VA_STATUS_ERROR_INVALID_CONFIG;
+
+    *profile = config->profile;
+    *entrypoint = config->entrypoint;
+    *num_attribs = 0;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_CreateSurfaces(VADriverContextP ctx, int width, int height, int format,
+    int num_surfaces, VASurfaceID *surfaces)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    int i;
+
+    if (format != VA_RT_FORMAT_YUV420)
+        return VA_STATUS_ERROR_UNSUPPORTED_RT_FORMAT;
+
+    for (i = 0; i < num_surfaces; i++) {
+        surfaces[i] = ++driver->next_id;
+        g_hash_table_insert(driver->surfaces, GUINT_TO_POINTER(surfaces[i]),
+            g_new0(StubSurface, 1));
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+#if VA_CHECK_VERSION(0,34,0)
+static VAStatus
+stub_CreateSurfaces2(VADriverContextP ctx, unsigned int format,
+    unsigned int width, unsigned int height, VASurfaceID *surfaces,
+    unsigned int num_surfaces, VASurfaceAttrib *attrib_list,
+    unsigned int num_attribs)
+{
+    if (num_attribs > 0)
+        return VA_STATUS_ERROR_ATTR_NOT_SUPPORTED;
+    return stub_CreateSurfaces(ctx, width, height, format, num_surfaces,
+        surfaces);
+}
+#endif
+
+static VAStatus
+stub_DestroySurfaces(VADriverContextP ctx, VASurfaceID *surface_list,
+    int num_surfaces)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    int i;
+
+    for (i = 0; i < num_surfaces; i++) {
+        if (!g_hash_table_remove(driver->surfaces,
+                GUINT_TO_POINTER(surface_list[i])))
+            return VA_STATUS_ERROR_INVALID_SURFACE;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_CreateContext(VADriverContextP ctx, VAConfigID config_id,
+    int picture_width, int picture_height, int flag,
+    VASurfaceID *render_targets, int num_render_targets, VAContextID *context)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    StubConfig * const config = g_hash_table_lookup(driver->configs,
+        GUINT_TO_POINTER(config_id));
+    StubContext *stub_context;
+
+    if (!config)
+        return VA_STATUS_ERROR_INVALID_CONFIG;
+
+    g_usleep(driver->context_time);
+
+    stub_context = g_slice_new0(StubContext);
+    stub_context->profile = config->profile;
+    stub_context->entrypoint = config->entrypoint;
+    stub_context->coded_buf = VA_INVALID_ID;
+    stub_context->coded_data = g_byte_array_new();
+    stub_context->render_targets = g_array_sized_new(FALSE, FALSE,
+        sizeof(VASurfaceID), num_render_targets);
+    g_array_append_vals(stub_context->render_targets, render_targets,
+        num_render_targets);
+    *context = ++driver->next_id;
+    g_hash_table_insert(driver->contexts, GUINT_TO_POINTER(*context),
+        stub_context);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_DestroyContext(VADriverContextP ctx, VAContextID context)
+{
+    if (!g_hash_table_remove(STUB_DRIVER(ctx)->contexts,
+            GUINT_TO_POINTER(context)))
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_CreateBuffer(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    StubBuffer *buffer;
+
+    buffer = g_slice_new(StubBuffer);
+    buffer->type = type;
+    buffer->size = size * num_elements;
+#if STUB_HAS_H264_ENCODER
+    /* Coded buffers are mapped as a single segment, followed by the
+       coded data */
+    if (type == VAEncCodedBufferType) {
+        VACodedBufferSegment *segment;
+
+        buffer->data = g_malloc0(sizeof(*segment) + buffer->size);
+        segment = (VACodedBufferSegment *)buffer->data;
+        segment->buf = buffer->data + sizeof(*segment);
+    }
+    else
+#endif
+    buffer->data = data ? g_memdup(data, buffer->size) :
+        g_malloc0(buffer->size);
+
+    *buf_id = ++driver->next_id;
+    g_hash_table_insert(driver->buffers, GUINT_TO_POINTER(*buf_id), buffer);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_BufferSetNumElements(VADriverContextP ctx, VABufferID buf_id,
+    unsigned int num_elements)
+{
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_MapBuffer(VADriverContextP ctx, VABufferID buf_id, void **pbuf)
+{
+    StubBuffer * const buffer = g_hash_table_lookup(STUB_DRIVER(ctx)->buffers,
+        GUINT_TO_POINTER(buf_id));
+
+    if (!buffer)
+        return VA_STATUS_ERROR_INVALID_BUFFER;
+    *pbuf = buffer->data;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_UnmapBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_DestroyBuffer(VADriverContextP ctx, VABufferID buffer_id)
+{
+    if (!g_hash_table_remove(STUB_DRIVER(ctx)->buffers,
+            GUINT_TO_POINTER(buffer_id)))
+        return VA_STATUS_ERROR_INVALID_BUFFER;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_BeginPicture(VADriverContextP ctx, VAContextID context,
+    VASurfaceID render_target)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    StubContext * const stub_context = g_hash_table_lookup(driver->contexts,
+        GUINT_TO_POINTER(context));
+
+    if (!stub_context)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    stub_context->render_target = g_hash_table_lookup(driver->surfaces,
+        GUINT_TO_POINTER(render_target));
+    if (!stub_context->render_target)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+    stub_context->num_pixels = 0;
+    stub_context->coded_buf = VA_INVALID_ID;
+    g_byte_array_set_size(stub_context->coded_data, 0);
+    return VA_STATUS_SUCCESS;
+}
+
+/* Records the encode parameters, i.e. where to write the packed headers */
+static void
+record_encode_buffer(StubContext *stub_context, StubBuffer *buffer)
+{
+#if STUB_HAS_H264_ENCODER
+    switch (buffer->type) {
+    case VAEncPictureParameterBufferType: {
+        const VAEncPictureParameterBufferH264 * const pic_param =
+            (VAEncPictureParameterBufferH264 *)buffer->data;
+        stub_context->coded_buf = pic_param->coded_buf;
+        break;
+    }
+    case VAEncPackedHeaderDataBufferType:
+        g_byte_array_append(stub_context->coded_data, buffer->data,
+            buffer->size);
+        break;
+    default:
+        break;
+    }
+#endif
+}
+
+/* Writes the packed headers of the encoded picture to its coded buffer */
+static VAStatus
+write_coded_buffer(StubDriver *driver, StubContext *stub_context)
+{
+#if STUB_HAS_H264_ENCODER
+    VACodedBufferSegment *segment;
+    StubBuffer *buffer;
+
+    if (stub_context->coded_buf == VA_INVALID_ID)
+        return VA_STATUS_SUCCESS;
+
+    buffer = g_hash_table_lookup(driver->buffers,
+        GUINT_TO_POINTER(stub_context->coded_buf));
+    if (!buffer || buffer->type != VAEncCodedBufferType)
+        return VA_STATUS_ERROR_INVALID_BUFFER;
+
+    segment = (VACodedBufferSegment *)buffer->data;
+    segment->size = MIN(stub_context->coded_data->len, buffer->size);
+    memcpy(segment->buf, stub_context->coded_data->data, segment->size);
+#endif
+    return VA_STATUS_SUCCESS;
+}
+
+/* Checks whether the buffer describes the whole picture to process */
+static gboolean
+is_picture_buffer(StubBuffer *buffer)
+{
+#if STUB_HAS_VPP
+    if (buffer->type == VAProcPipelineParameterBufferType)
+        return TRUE;
+#endif
+    return buffer->type == VAPictureParameterBufferType;
+}
+
+static gboolean
+is_render_target(StubContext *stub_context, VASurfaceID surface)
+{
+    guint i;
+
+    for (i = 0; i < stub_context->render_targets->len; i++) {
+        if (g_array_index(stub_context->render_targets, VASurfaceID, i) ==
+            surface)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Checks that the reference frames are render targets of the context,
+   as real drivers only know about those */
+static gboolean
+check_references(StubContext *stub_context, StubBuffer *buffer)
+{
+#if STUB_HAS_VP9
+    if (stub_context->profile == VAProfileVP9Profile0) {
+        const VADecPictureParameterBufferVP9 * const pic_param =
+            (VADecPictureParameterBufferVP9 *)buffer->data;
+        guint i;
+
+        for (i = 0; i < G_N_ELEMENTS(pic_param->reference_frames); i++) {
+            if (pic_param->reference_frames[i] != VA_INVALID_SURFACE &&
+                !is_render_target(stub_context,
+                    pic_param->reference_frames[i]))
+                return FALSE;
+        }
+    }
+#endif
+    return TRUE;
+}
+
+/* Returns the number of pixels of the picture to decode */
+static guint
+get_num_pixels(StubContext *stub_context, StubBuffer *buffer)
+{
+    switch (stub_context->profile) {
+#if STUB_HAS_VPP
+    case VAProfileNone: {
+        const VAProcPipelineParameterBuffer * const pipeline_param =
+            (VAProcPipelineParameterBuffer *)buffer->data;
+        const VARectangle * const rect = pipeline_param->output_region;
+        return rect ? rect->width * rect->height : 0;
+    }
+#endif
+    case VAProfileH264ConstrainedBaseline:
+    case VAProfileH264Main:
+    case VAProfileH264High: {
+        const VAPictureParameterBufferH264 * const pic_param =
+            (VAPictureParameterBufferH264 *)buffer->data;
+        return (pic_param->picture_width_in_mbs_minus1 + 1) *
+            (pic_param->picture_height_in_mbs_minus1 + 1) * 256;
+    }
+    case VAProfileMPEG2Simple:
+    case VAProfileMPEG2Main: {
+        const VAPictureParameterBufferMPEG2 * const pic_param =
+            (VAPictureParameterBufferMPEG2 *)buffer->data;
+        return pic_param->horizontal_size * pic_param->vertical_size;
+    }
+#if STUB_HAS_JPEG
+    case VAProfileJPEGBaseline: {
+        const VAPictureParameterBufferJPEGBaseline * const pic_param =
+            (VAPictureParameterBufferJPEGBaseline *)buffer->data;
+        return pic_param->picture_width * pic_param->picture_height;
+    }
+#endif
+#if STUB_HAS_VP8
+    case VAProfileVP8Version0_3: {
+        const VAPictureParameterBufferVP8 * const pic_param =
+            (VAPictureParameterBufferVP8 *)buffer->data;
+        return pic_param->frame_width * pic_param->frame_height;
+    }
+#endif
+#if STUB_HAS_VP9
+    case VAProfileVP9Profile0: {
+        const VADecPictureParameterBufferVP9 * const pic_param =
+            (VADecPictureParameterBufferVP9 *)buffer->data;
+        return pic_param->frame_width * pic_param->frame_height;
+    }
+#endif
+    default:
+        break;
+    }
+    return 0;
+}
+
+static VAStatus
+stub_RenderPicture(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    StubContext * const stub_context = g_hash_table_lookup(driver->contexts,
+        GUINT_TO_POINTER(context));
+    StubBuffer *buffer;
+    int i;
+
+    if (!stub_context || !stub_context->render_target)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+
+    for (i = 0; i < num_buffers; i++) {
+        buffer = g_hash_table_lookup(driver->buffers,
+            GUINT_TO_POINTER(buffers[i]));
+        if (!buffer)
+            return VA_STATUS_ERROR_INVALID_BUFFER;
+        if (stub_context->entrypoint == VAEntrypointEncSlice)
+            record_encode_buffer(stub_context, buffer);
+        if (!is_picture_buffer(buffer))
+            continue;
+        if (!check_references(stub_context, buffer))
+            return VA_STATUS_ERROR_INVALID_SURFACE;
+        stub_context->num_pixels = get_num_pixels(stub_context, buffer);
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_EndPicture(VADriverContextP ctx, VAContextID context)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    StubContext * const stub_context = g_hash_table_lookup(driver->contexts,
+        GUINT_TO_POINTER(context));
+    gint64 start_time;
+    VAStatus status;
+
+    if (!stub_context || !stub_context->render_target)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+
+    status = write_coded_buffer(driver, stub_context);
+    if (status != VA_STATUS_SUCCESS)
+        return status;
+
+    /* The emulated hardware decodes one picture at a time */
+    start_time = MAX(g_get_monotonic_time(), driver->idle_time);
+    driver->idle_time = start_time +
+        stub_context->num_pixels / driver->decode_rate;
+    stub_context->render_target->ready_time = driver->idle_time;
+    stub_context->render_target = NULL;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_SyncSurface(VADriverContextP ctx, VASurfaceID render_target)
+{
+    StubSurface * const surface = g_hash_table_lookup(
+        STUB_DRIVER(ctx)->surfaces, GUINT_TO_POINTER(render_target));
+    gint64 now;
+
+    if (!surface)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+
+    now = g_get_monotonic_time();
+    if (surface->ready_time > now)
+        g_usleep(surface->ready_time - now);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_QuerySurfaceStatus(VADriverContextP ctx, VASurfaceID render_target,
+    VASurfaceStatus *status)
+{
+    StubSurface * const surface = g_hash_table_lookup(
+        STUB_DRIVER(ctx)->surfaces, GUINT_TO_POINTER(render_target));
+
+    if (!surface)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+
+    *status = surface->ready_time > g_get_monotonic_time() ?
+        VASurfaceRendering : VASurfaceReady;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_PutSurface(VADriverContextP ctx, VASurfaceID surface, void *draw,
+    short srcx, short srcy, unsigned short srcw, unsigned short srch,
+    short destx, short desty, unsigned short destw, unsigned short desth,
+    VARectangle *cliprects, unsigned int number_cliprects, unsigned int flags)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static const VAImageFormat stub_image_format = {
+    VA_FOURCC('N','V','1','2'), VA_LSB_FIRST, 12,
+};
+
+static VAStatus
+stub_QueryImageFormats(VADriverContextP ctx, VAImageFormat *format_list,
+    int *num_formats)
+{
+    format_list[0] = stub_image_format;
+    *num_formats = 1;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_CreateImage(VADriverContextP ctx, VAImageFormat *format, int width,
+    int height, VAImage *image)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    VAStatus status;
+
+    if (format->fourcc != stub_image_format.fourcc)
+        return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+
+    memset(image, 0, sizeof(*image));
+    image->format = stub_image_format;
+    image->width = width;
+    image->height = height;
+    image->num_planes = 2;
+    image->pitches[0] = width;
+    image->pitches[1] = 2 * ((width + 1) / 2);
+    image->offsets[1] = image->pitches[0] * height;
+    image->data_size = image->offsets[1] +
+        image->pitches[1] * ((height + 1) / 2);
+
+    status = stub_CreateBuffer(ctx, VA_INVALID_ID, VAImageBufferType,
+        image->data_size, 1, NULL, &image->buf);
+    if (status != VA_STATUS_SUCCESS)
+        return status;
+
+    image->image_id = ++driver->next_id;
+    g_hash_table_insert(driver->images, GUINT_TO_POINTER(image->image_id),
+        GUINT_TO_POINTER(image->buf));
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_DeriveImage(VADriverContextP ctx, VASurfaceID surface, VAImage *image)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_DestroyImage(VADriverContextP ctx, VAImageID image)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    gpointer buf_id;
+
+    if (!g_hash_table_lookup_extended(driver->images, GUINT_TO_POINTER(image),
+            NULL, &buf_id))
+        return VA_STATUS_ERROR_INVALID_IMAGE;
+
+    g_hash_table_remove(driver->images, GUINT_TO_POINTER(image));
+    return stub_DestroyBuffer(ctx, GPOINTER_TO_UINT(buf_id));
+}
+
+static VAStatus
+stub_SetImagePalette(VADriverContextP ctx, VAImageID image,
+    unsigned char *palette)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+check_image_transfer(VADriverContextP ctx, VASurfaceID surface,
+    VAImageID image)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+
+    if (!g_hash_table_lookup(driver->surfaces, GUINT_TO_POINTER(surface)))
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+    if (!g_hash_table_lookup_extended(driver->images, GUINT_TO_POINTER(image),
+            NULL, NULL))
+        return VA_STATUS_ERROR_INVALID_IMAGE;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_GetImage(VADriverContextP ctx, VASurfaceID surface, int x, int y,
+    unsigned int width, unsigned int height, VAImageID image)
+{
+    return check_image_transfer(ctx, surface, image);
+}
+
+static VAStatus
+stub_PutImage(VADriverContextP ctx, VASurfaceID surface, VAImageID image,
+    int src_x, int src_y, unsigned int src_width, unsigned int src_height,
+    int dest_x, int dest_y, unsigned int dest_width, unsigned int dest_height)
+{
+    return check_image_transfer(ctx, surface, image);
+}
+
+static VAStatus
+stub_QuerySubpictureFormats(VADriverContextP ctx, VAImageFormat *format_list,
+    unsigned int *flags, unsigned int *num_formats)
+{
+    *num_formats = 0;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_CreateSubpicture(VADriverContextP ctx, VAImageID image,
+    VASubpictureID *subpicture)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_DestroySubpicture(VADriverContextP ctx, VASubpictureID subpicture)
+{
+    return VA_STATUS_ERROR_INVALID_SUBPICTURE;
+}
+
+static VAStatus
+stub_SetSubpictureImage(VADriverContextP ctx, VASubpictureID subpicture,
+    VAImageID image)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_SetSubpictureChromakey(VADriverContextP ctx, VASubpictureID subpicture,
+    unsigned int chromakey_min, unsigned int chromakey_max,
+    unsigned int chromakey_mask)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_SetSubpictureGlobalAlpha(VADriverContextP ctx, VASubpictureID subpicture,
+    float global_alpha)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_AssociateSubpicture(VADriverContextP ctx, VASubpictureID subpicture,
+    VASurfaceID *target_surfaces, int num_surfaces,
+    short src_x, short src_y, unsigned short src_width,
+    unsigned short src_height, short dest_x, short dest_y,
+    unsigned short dest_width, unsigned short dest_height, unsigned int flags)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_DeassociateSubpicture(VADriverContextP ctx, VASubpictureID subpicture,
+    VASurfaceID *target_surfaces, int num_surfaces)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_QueryDisplayAttributes(VADriverContextP ctx,
+    VADisplayAttribute *attr_list, int *num_attributes)
+{
+    *num_attributes = 0;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_GetDisplayAttributes(VADriverContextP ctx,
+    VADisplayAttribute *attr_list, int num_attributes)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+stub_SetDisplayAttributes(VADriverContextP ctx,
+    VADisplayAttribute *attr_list, int num_attributes)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+#if STUB_HAS_VPP
+/* The video processing pipeline only supports deinterlacing */
+static const VAProcDeinterlacingType stub_deinterlacing_types[] = {
+    VAProcDeinterlacingBob,
+    VAProcDeinterlacingMotionAdaptive,
+};
+
+#define STUB_VPP_NUM_FORWARD_REFERENCES 2
+
+static VAStatus
+stub_QueryVideoProcFilters(VADriverContextP ctx, VAContextID context,
+    VAProcFilterType *filters, unsigned int *num_filters)
+{
+    if (*num_filters < 1) {
+        *num_filters = 1;
+        return VA_STATUS_ERROR_MAX_NUM_EXCEEDED;
+    }
+    filters[0] = VAProcFilterDeinterlacing;
+    *num_filters = 1;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_QueryVideoProcFilterCaps(VADriverContextP ctx, VAContextID context,
+    VAProcFilterType type, void *filter_caps, unsigned int *num_filter_caps)
+{
+    VAProcFilterCapDeinterlacing * const caps = filter_caps;
+    guint i;
+
+    if (type != VAProcFilterDeinterlacing)
+        return VA_STATUS_ERROR_UNSUPPORTED_FILTER;
+
+    if (*num_filter_caps < G_N_ELEMENTS(stub_deinterlacing_types)) {
+        *num_filter_caps = G_N_ELEMENTS(stub_deinterlacing_types);
+        return VA_STATUS_ERROR_MAX_NUM_EXCEEDED;
+    }
+    for (i = 0; i < G_N_ELEMENTS(stub_deinterlacing_types); i++)
+        caps[i].type = stub_deinterlacing_types[i];
+    *num_filter_caps = G_N_ELEMENTS(stub_deinterlacing_types);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+stub_QueryVideoProcPipelineCaps(VADriverContextP ctx, VAContextID context,
+    VABufferID *filters, unsigned int num_filters,
+    VAProcPipelineCaps *pipeline_caps)
+{
+    StubDriver * const driver = STUB_DRIVER(ctx);
+    const VAProcFilterParameterBufferDeinterlacing *deint;
+    StubBuffer *buffer;
+    guint i;
+
+    memset(pipeline_caps, 0, sizeof(*pipeline_caps));
+    for (i = 0; i < num_filters; i++) {
+        buffer = g_hash_table_lookup(driver->buffers,
+            GUINT_TO_POINTER(filters[i]));
+        if (!buffer)
+            return VA_STATUS_ERROR_INVALID_BUFFER;
+
+        /* Only motion adaptive deinterlacing needs past fields */
+        deint = (VAProcFilterParameterBufferDeinterlacing *)buffer->data;
+        if (deint->type == VAProcFilterDeinterlacing &&
+            deint->algorithm != VAProcDeinterlacingBob)
+            pipeline_caps->num_forward_references =
+                STUB_VPP_NUM_FORWARD_REFERENCES;
+    }
+    return VA_STATUS_SUCCESS;
+}
+#endif
+
+G_MODULE_EXPORT VAStatus
+STUB_DRIVER_INIT(VADriverContextP ctx)
+{
+    struct VADriverVTable * const vtable = ctx->vtable;
+    StubDriver *driver;
+
+    driver = g_slice_new0(StubDriver);
+    driver->configs = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    driver->surfaces = g_hash_table_new_full(NULL, NULL, NULL,
+        (GDestroyNotify)g_free);
+    driver->contexts = g_hash_table_new_full(NULL, NULL, NULL,
+        (GDestroyNotify)stub_context_free);
+    driver->buffers = g_hash_table_new_full(NULL, NULL, NULL,
+        (GDestroyNotify)stub_buffer_free);
+    driver->images = g_hash_table_new(NULL, NULL);
+    driver->context_time = get_env_value("STUB_VA_CONTEXT_TIME",
+        DEFAULT_CONTEXT_TIME);
+    driver->decode_rate = MAX(get_env_value("STUB_VA_DECODE_RATE",
+        DEFAULT_DECODE_RATE), 1);
+    ctx->pDriverData = driver;
+
+    ctx->version_major = VA_MAJOR_VERSION;
+    ctx->version_minor = VA_MINOR_VERSION;
+    ctx->max_profiles = G_N_ELEMENTS(stub_profiles);
+    ctx->max_entrypoints = 2;
+    ctx->max_attributes = 1;
+    ctx->max_image_formats = 1;
+    ctx->max_subpic_formats = 1;
+    ctx->max_display_attributes = 1;
+    ctx->str_vendor = "Stub VA driver";
+
+    vtable->vaTerminate = stub_Terminate;
+    vtable->vaQueryConfigProfiles = stub_QueryConfigProfiles;
+    vtable->vaQueryConfigEntrypoints = stub_QueryConfigEntrypoints;
+    vtable->vaGetConfigAttributes = stub_GetConfigAttributes;
+    vtable->vaCreateConfig = stub_CreateConfig;
+    vtable->vaDestroyConfig = stub_DestroyConfig;
+    vtable->vaQueryConfigAttributes = stub_QueryConfigAttributes;
+    vtable->vaCreateSurfaces = stub_CreateSurfaces;
+#if VA_CHECK_VERSION(0,34,0)
+    vtable->vaCreateSurfaces2 = stub_CreateSurfaces2;
+#endif
+    vtable->vaDestroySurfaces = stub_DestroySurfaces;
+    vtable->vaCreateContext = stub_CreateContext;
+    vtable->vaDestroyContext = stub_DestroyContext;
+    vtable->vaCreateBuffer = stub_CreateBuffer;
+    vtable->vaBufferSetNumElements = stub_BufferSetNumElements;
+    vtable->vaMapBuffer = stub_MapBuffer;
+    vtable->vaUnmapBuffer = stub_UnmapBuffer;
+    vtable->vaDestroyBuffer = stub_DestroyBuffer;
+    vtable->vaBeginPicture = stub_BeginPicture;
+    vtable->vaRenderPicture = stub_RenderPicture;
+    vtable->vaEndPicture = stub_EndPicture;
+    vtable->vaSyncSurface = stub_SyncSurface;
+    vtable->vaQuerySurfaceStatus = stub_QuerySurfaceStatus;
+    vtable->vaPutSurface = stub_PutSurface;
+    vtable->vaQueryImageFormats = stub_QueryImageFormats;
+    vtable->vaCreateImage = stub_CreateImage;
+    vtable->vaDeriveImage = stub_DeriveImage;
+    vtable->vaDestroyImage = stub_DestroyImage;
+    vtable->vaSetImagePalette = stub_SetImagePalette;
+    vtable->vaGetImage = stub_GetImage;
+    vtable->vaPutImage = stub_PutImage;
+    vtable->vaQuerySubpictureFormats = stub_QuerySubpictureFormats;
+    vtable->vaCreateSubpicture = stub_CreateSubpicture;
+    vtable->vaDestroySubpicture = stub_DestroySubpicture;
+    vtable->vaSetSubpictureImage = stub_SetSubpictureImage;
+    vtable->vaSetSubpictureChromakey = stub_SetSubpictureChromakey;
+    vtable->vaSetSubpictureGlobalAlpha = stub_SetSubpictureGlobalAlpha;
+    vtable->vaAssociateSubpicture = stub_AssociateSubpicture;
+    vtable->vaDeassociateSubpicture = stub_DeassociateSubpicture;
+    vtable->vaQueryDisplayAttributes = stub_QueryDisplayAttributes;
+    vtable->vaGetDisplayAttributes = stub_GetDisplayAttributes;
+    vtable->vaSetDisplayAttributes = stub_SetDisplayAttributes;
+
+#if STUB_HAS_VPP
+    if (ctx->vtable_vpp) {
+        struct VADriverVTableVPP * const vtable_vpp = ctx->vtable_vpp;
+
+        vtable_vpp->version = VA_DRIVER_VTABLE_VPP_VERSION;
+        vtable_vpp->vaQueryVideoProcFilters = stub_QueryVideoProcFilters;
+        vtable_vpp->vaQueryVideoProcFilterCaps =
+            stub_QueryVideoProcFilterCaps;
+        vtable_vpp->vaQueryVideoProcPipelineCaps =
+            stub_QueryVideoProcPipelineCaps;
+    }
+#endif
+    return VA_STATUS_SUCCESS;
+}
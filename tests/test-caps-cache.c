@@ -0,0 +1,182 @@
+/*
+ *  test-caps-cache.c - Benchmark VA display startup with capabilities cache
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test measures the time needed to open a VA display and to query
+   all its capabilities, as done by every short-lived process, first with
+   the on-disk capabilities cache disabled, and then with it enabled. It
+   also checks that the cached capabilities match the probed ones */
+
+#include "gst/vaapi/sysdeps.h"
+#include <glib/gstdio.h>
+#include "output.h"
+
+static guint g_num_iterations = 50;
+
+static GOptionEntry g_options[] = {
+    { "iterations", 'n',
+      0,
+      G_OPTION_ARG_INT, &g_num_iterations,
+      "number of displays to open for each run", NULL },
+    { NULL, }
+};
+
+typedef struct {
+    GArray     *decoders;
+    GArray     *encoders;
+    GArray     *image_formats;
+    GArray     *subpicture_formats;
+    gboolean    has_vpp;
+} DisplayCaps;
+
+static void
+display_caps_clear(DisplayCaps *caps)
+{
+    if (caps->decoders)
+        g_array_unref(caps->decoders);
+    if (caps->encoders)
+        g_array_unref(caps->encoders);
+    if (caps->image_formats)
+        g_array_unref(caps->image_formats);
+    if (caps->subpicture_formats)
+        g_array_unref(caps->subpicture_formats);
+    memset(caps, 0, sizeof(*caps));
+}
+
+static gboolean
+array_equal(GArray *a, GArray *b)
+{
+    if (!a || !b)
+        return a == b;
+    return a->len == b->len && memcmp(a->data, b->data,
+        a->len * g_array_get_element_size(a)) == 0;
+}
+
+static gboolean
+display_caps_equal(const DisplayCaps *a, const DisplayCaps *b)
+{
+    return array_equal(a->decoders, b->decoders) &&
+        array_equal(a->encoders, b->encoders) &&
+        array_equal(a->image_formats, b->image_formats) &&
+        array_equal(a->subpicture_formats, b->subpicture_formats) &&
+        a->has_vpp == b->has_vpp;
+}
+
+/* Opens a new VA display and queries all its capabilities */
+static void
+open_display(DisplayCaps *caps)
+{
+    GstVaapiDisplay *display;
+
+    display = video_output_create_display(NULL);
+    if (!display)
+        g_error("could not create VA display");
+
+    caps->decoders = gst_vaapi_display_get_decode_profiles(display);
+    caps->encoders = gst_vaapi_display_get_encode_profiles(display);
+    caps->image_formats = gst_vaapi_display_get_image_formats(display);
+    caps->subpicture_formats =
+        gst_vaapi_display_get_subpicture_formats(display);
+    caps->has_vpp = gst_vaapi_display_has_video_processing(display);
+    gst_vaapi_display_unref(display);
+}
+
+/* Returns the average startup time, in microseconds */
+static gdouble
+run(const gchar *name, DisplayCaps *caps)
+{
+    GTimer *timer;
+    gdouble elapsed;
+    guint i;
+
+    timer = g_timer_new();
+    for (i = 0; i < g_num_iterations; i++) {
+        display_caps_clear(caps);
+        open_display(caps);
+    }
+    elapsed = g_timer_elapsed(timer, NULL) * G_USEC_PER_SEC / g_num_iterations;
+    g_timer_destroy(timer);
+
+    g_print("%s: %.1f us per display\n", name, elapsed);
+    return elapsed;
+}
+
+/* Removes the cache files, and the temporary directories */
+static void
+remove_cache_dir(const gchar *cache_dir)
+{
+    gchar *dirname;
+    const gchar *name;
+    GDir *dir;
+
+    dirname = g_build_filename(cache_dir, "gstreamer-vaapi", NULL);
+    dir = g_dir_open(dirname, 0, NULL);
+    if (dir) {
+        while ((name = g_dir_read_name(dir)) != NULL) {
+            gchar * const filename = g_build_filename(dirname, name, NULL);
+            g_unlink(filename);
+            g_free(filename);
+        }
+        g_dir_close(dir);
+    }
+    g_rmdir(dirname);
+    g_rmdir(cache_dir);
+    g_free(dirname);
+}
+
+int
+main(int argc, char *argv[])
+{
+    DisplayCaps probed_caps = { NULL, }, cached_caps = { NULL, };
+    gdouble probed_time, cached_time;
+    gchar *cache_dir;
+
+    /* Use a private cache directory, before anything queries it */
+    cache_dir = g_dir_make_tmp("test-caps-cache-XXXXXX", NULL);
+    if (!cache_dir)
+        g_error("could not create temporary cache directory");
+    g_setenv("XDG_CACHE_HOME", cache_dir, TRUE);
+
+    if (!video_output_init(&argc, argv, g_options))
+        g_error("failed to initialize video output subsystem");
+    if (g_num_iterations < 1)
+        g_num_iterations = 1;
+
+    g_setenv("GST_VAAPI_DISABLE_CAPS_CACHE", "1", TRUE);
+    probed_time = run("probed", &probed_caps);
+
+    /* The first display populates the cache */
+    g_unsetenv("GST_VAAPI_DISABLE_CAPS_CACHE");
+    open_display(&cached_caps);
+    if (!display_caps_equal(&probed_caps, &cached_caps))
+        g_error("capabilities differ while populating the cache");
+    cached_time = run("cached", &cached_caps);
+    if (!display_caps_equal(&probed_caps, &cached_caps))
+        g_error("cached capabilities differ from probed ones");
+
+    g_print("speedup: %.2fx\n", probed_time / MAX(cached_time, 1.0));
+
+    display_caps_clear(&probed_caps);
+    display_caps_clear(&cached_caps);
+    video_output_exit();
+    remove_cache_dir(cache_dir);
+    g_free(cache_dir);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ *  test-display-cache.c - Test VA display cache lookups
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test does not need any VA display: the cache is filled in with
+   fake display pointers, as if hundreds of DRM and X11/GLX displays were
+   opened, and the lookups are checked after additions and removals */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapidisplaycache.h"
+
+#define NUM_DEVICES 256
+
+#define FAKE_DISPLAY(i)         GUINT_TO_POINTER(0x1000 + (i))
+#define FAKE_VA_DISPLAY(i)      GUINT_TO_POINTER(0x2000 + (i))
+#define FAKE_NATIVE_DISPLAY(i)  GUINT_TO_POINTER(0x3000 + (i))
+
+#define DRM_TYPES   (1U << GST_VAAPI_DISPLAY_TYPE_DRM)
+#define X11_TYPES   (1U << GST_VAAPI_DISPLAY_TYPE_X11)
+#define GLX_TYPES   (1U << GST_VAAPI_DISPLAY_TYPE_GLX)
+
+static gchar *
+device_name(guint i)
+{
+    return g_strdup_printf("/dev/dri/renderD%u", 128 + i);
+}
+
+static void
+add_display(GstVaapiDisplayCache *cache, guint i, GstVaapiDisplayType type,
+    guint native_index, const gchar *name)
+{
+    GstVaapiDisplayInfo info;
+
+    info.display = FAKE_DISPLAY(i);
+    info.display_type = type;
+    info.display_name = (gchar *)name;
+    info.va_display = FAKE_VA_DISPLAY(i);
+    info.native_display = FAKE_NATIVE_DISPLAY(native_index);
+    if (!gst_vaapi_display_cache_add(cache, &info))
+        g_error("failed to add display %u to cache", i);
+}
+
+static void
+check_display(GstVaapiDisplayCache *cache, guint i, gboolean present)
+{
+    const GstVaapiDisplayInfo *info;
+    gchar *name = device_name(i);
+
+    info = gst_vaapi_display_cache_lookup(cache, FAKE_DISPLAY(i));
+    if ((info != NULL) != present)
+        g_error("display %u: lookup failed", i);
+
+    info = gst_vaapi_display_cache_lookup_by_va_display(cache,
+        FAKE_VA_DISPLAY(i));
+    if ((info != NULL) != present ||
+        (info && info->display != FAKE_DISPLAY(i)))
+        g_error("display %u: lookup by VA display failed", i);
+
+    info = gst_vaapi_display_cache_lookup_by_native_display(cache,
+        FAKE_NATIVE_DISPLAY(i), DRM_TYPES);
+    if ((info != NULL) != present ||
+        (info && info->display != FAKE_DISPLAY(i)))
+        g_error("display %u: lookup by native display failed", i);
+
+    info = gst_vaapi_display_cache_lookup_by_name(cache, name, DRM_TYPES);
+    if ((info != NULL) != present ||
+        (info && strcmp(info->display_name, name) != 0))
+        g_error("display %u: lookup by name failed", i);
+    g_free(name);
+}
+
+static void
+check_drm_displays(void)
+{
+    GstVaapiDisplayCache *cache;
+    guint i;
+
+    cache = gst_vaapi_display_cache_new();
+    if (!cache)
+        g_error("could not create display cache");
+
+    for (i = 0; i < NUM_DEVICES; i++) {
+        gchar *name = device_name(i);
+        add_display(cache, i, GST_VAAPI_DISPLAY_TYPE_DRM, i, name);
+        g_free(name);
+    }
+    for (i = 0; i < NUM_DEVICES; i++)
+        check_display(cache, i, TRUE);
+
+    /* Remove every other display */
+    for (i = 0; i < NUM_DEVICES; i += 2)
+        gst_vaapi_display_cache_remove(cache, FAKE_DISPLAY(i));
+    for (i = 0; i < NUM_DEVICES; i++)
+        check_display(cache, i, i % 2 != 0);
+
+    for (i = 1; i < NUM_DEVICES; i += 2)
+        gst_vaapi_display_cache_remove(cache, FAKE_DISPLAY(i));
+    if (!gst_vaapi_display_cache_is_empty(cache))
+        g_error("display cache is not empty after all removals");
+
+    gst_vaapi_display_cache_unref(cache);
+    g_print("DRM displays: %u lookups by key succeeded\n", NUM_DEVICES);
+}
+
+/* X11 and GLX displays share the same native display and name, lookups
+   shall honour the requested display types */
+static void
+check_shared_displays(void)
+{
+    GstVaapiDisplayCache *cache;
+    const GstVaapiDisplayInfo *info;
+
+    cache = gst_vaapi_display_cache_new();
+    if (!cache)
+        g_error("could not create display cache");
+
+    add_display(cache, 0, GST_VAAPI_DISPLAY_TYPE_X11, 0, ":0");
+    add_display(cache, 1, GST_VAAPI_DISPLAY_TYPE_GLX, 0, ":0");
+    add_display(cache, 2, GST_VAAPI_DISPLAY_TYPE_X11, 2, NULL);
+
+    info = gst_vaapi_display_cache_lookup_by_name(cache, ":0", X11_TYPES);
+    if (!info || info->display != FAKE_DISPLAY(0))
+        g_error("X11 display lookup by name failed");
+    info = gst_vaapi_display_cache_lookup_by_name(cache, ":0", GLX_TYPES);
+    if (!info || info->display != FAKE_DISPLAY(1))
+        g_error("GLX display lookup by name failed");
+    info = gst_vaapi_display_cache_lookup_by_name(cache, ":0", DRM_TYPES);
+    if (info)
+        g_error("DRM display lookup by name succeeded");
+    info = gst_vaapi_display_cache_lookup_by_name(cache, NULL,
+        GST_VAAPI_DISPLAY_TYPE_ANY);
+    if (!info || info->display != FAKE_DISPLAY(2))
+        g_error("default display lookup by name failed");
+
+    /* The most recent display comes first */
+    info = gst_vaapi_display_cache_lookup_by_native_display(cache,
+        FAKE_NATIVE_DISPLAY(0), GST_VAAPI_DISPLAY_TYPE_ANY);
+    if (!info || info->display != FAKE_DISPLAY(1))
+        g_error("lookup by shared native display failed");
+
+    gst_vaapi_display_cache_remove(cache, FAKE_DISPLAY(1));
+    info = gst_vaapi_display_cache_lookup_by_native_display(cache,
+        FAKE_NATIVE_DISPLAY(0), GST_VAAPI_DISPLAY_TYPE_ANY);
+    if (!info || info->display != FAKE_DISPLAY(0))
+        g_error("lookup by shared native display failed after removal");
+
+    gst_vaapi_display_cache_unref(cache);
+    g_print("shared displays: lookups by display type succeeded\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+    check_drm_displays();
+    check_shared_displays();
+    return 0;
+}
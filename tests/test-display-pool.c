@@ -0,0 +1,176 @@
+/*
+ *  test-display-pool.c - Test VA display pool device selection
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test does not open any VA display: the pool is filled in with
+   fake render nodes created in a temporary directory, their usage
+   counters are set by hand, and the load-balancing policies are checked
+   against them */
+
+#include "gst/vaapi/sysdeps.h"
+#include <glib/gstdio.h>
+#include "gstvaapidisplaypool.h"
+
+static const gchar *g_device_names[] = {
+    "card0", "renderD130", "controlD64", "renderD128", "renderD129", NULL
+};
+
+static gchar *
+create_fake_devices(void)
+{
+    gchar *dirname, *path;
+    guint i;
+
+    dirname = g_dir_make_tmp("test-display-pool-XXXXXX", NULL);
+    if (!dirname)
+        g_error("could not create temporary device directory");
+
+    for (i = 0; g_device_names[i] != NULL; i++) {
+        path = g_build_filename(dirname, g_device_names[i], NULL);
+        if (!g_file_set_contents(path, "", 0, NULL))
+            g_error("could not create fake device %s", path);
+        g_free(path);
+    }
+    return dirname;
+}
+
+static void
+remove_fake_devices(gchar *dirname)
+{
+    gchar *path;
+    guint i;
+
+    for (i = 0; g_device_names[i] != NULL; i++) {
+        path = g_build_filename(dirname, g_device_names[i], NULL);
+        g_unlink(path);
+        g_free(path);
+    }
+    g_rmdir(dirname);
+    g_free(dirname);
+}
+
+static GstVaapiDisplayPoolDevice *
+get_device(GstVaapiDisplayPool *pool, guint index)
+{
+    return g_ptr_array_index(gst_vaapi_display_pool_get_devices(pool), index);
+}
+
+static void
+set_usage(GstVaapiDisplayPool *pool, guint index, guint num_contexts,
+    guint num_surfaces, guint num_acquired)
+{
+    GstVaapiDisplayPoolDevice * const device = get_device(pool, index);
+
+    device->num_contexts = num_contexts;
+    device->num_surfaces = num_surfaces;
+    device->num_acquired = num_acquired;
+}
+
+static void
+check_selection(GstVaapiDisplayPool *pool, guint expected, const gchar *what)
+{
+    GstVaapiDisplayPoolDevice * const device =
+        gst_vaapi_display_pool_select_device(pool);
+    gchar *basename;
+
+    if (device != get_device(pool, expected))
+        g_error("%s: selected %s, expected %s", what,
+            device ? device->path : "none", get_device(pool, expected)->path);
+
+    basename = g_path_get_basename(device->path);
+    g_print("%s: %s\n", what, basename);
+    g_free(basename);
+}
+
+static guint
+last_device_policy(GPtrArray *devices, gpointer user_data)
+{
+    (*(guint *)user_data)++;
+    return devices->len - 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplayPool *pool;
+    GPtrArray *devices;
+    gchar *dirname, *basename;
+    guint i, num_calls = 0;
+
+    static const gchar *expected_names[] = {
+        "renderD128", "renderD129", "renderD130"
+    };
+
+    gst_init(&argc, &argv);
+
+    dirname = create_fake_devices();
+    pool = gst_vaapi_display_pool_new();
+    if (!pool)
+        g_error("could not create display pool");
+
+    /* Only render nodes are considered, sorted by name */
+    if (gst_vaapi_display_pool_scan(pool, dirname) != 3)
+        g_error("unexpected number of render nodes");
+    devices = gst_vaapi_display_pool_get_devices(pool);
+    for (i = 0; i < devices->len; i++) {
+        basename = g_path_get_basename(get_device(pool, i)->path);
+        if (strcmp(basename, expected_names[i]) != 0)
+            g_error("device %u is %s, expected %s", i, basename,
+                expected_names[i]);
+        g_free(basename);
+    }
+
+    /* Least loaded: contexts first, then surfaces, then hand-outs */
+    set_usage(pool, 0, 2, 10, 0);
+    set_usage(pool, 1, 1, 40, 0);
+    set_usage(pool, 2, 1, 20, 0);
+    check_selection(pool, 2, "fewest contexts and surfaces");
+    set_usage(pool, 2, 1, 40, 3);
+    check_selection(pool, 1, "fewest hand-outs");
+    set_usage(pool, 0, 0, 0, 5);
+    set_usage(pool, 1, 0, 0, 5);
+    set_usage(pool, 2, 0, 0, 5);
+    check_selection(pool, 0, "idle devices");
+
+    /* Round-robin ignores the actual usage */
+    if (!gst_vaapi_display_pool_set_policy_by_name(pool, "round-robin"))
+        g_error("round-robin policy is not available");
+    set_usage(pool, 0, 0, 0, 2);
+    set_usage(pool, 1, 9, 90, 1);
+    set_usage(pool, 2, 0, 0, 2);
+    check_selection(pool, 1, "round-robin");
+
+    if (!gst_vaapi_display_pool_set_policy_by_name(pool, "first"))
+        g_error("first policy is not available");
+    check_selection(pool, 0, "first");
+
+    if (gst_vaapi_display_pool_set_policy_by_name(pool, "random"))
+        g_error("unknown policy was accepted");
+
+    /* Custom policy */
+    gst_vaapi_display_pool_set_policy(pool, last_device_policy, &num_calls);
+    check_selection(pool, 2, "custom");
+    if (num_calls != 1)
+        g_error("custom policy was called %u times", num_calls);
+
+    gst_vaapi_display_pool_free(pool);
+    remove_fake_devices(dirname);
+    return 0;
+}
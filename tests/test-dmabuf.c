@@ -0,0 +1,215 @@
+/*
+ *  test-dmabuf.c - Test DMA-BUF buffer sharing
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test does not open any VA display: fake DMA-BUF handles are
+   backed by anonymous memory files, which is enough to check the
+   handle lifetime rules and the pixels layout negotiation */
+
+#include "gst/vaapi/sysdeps.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <glib/gstdio.h>
+#include <gst/vaapi/gstvaapibufferproxy.h>
+#include "gstvaapidmabuf.h"
+
+#define WIDTH   320
+#define HEIGHT  240
+
+static gint
+create_fake_dmabuf(gsize size)
+{
+    gchar *filename;
+    gint fd = -1;
+
+#ifdef SYS_memfd_create
+    fd = syscall(SYS_memfd_create, "test-dmabuf", 0);
+#endif
+    if (fd < 0) {
+        fd = g_file_open_tmp("test-dmabuf-XXXXXX", &filename, NULL);
+        if (fd < 0)
+            g_error("could not create fake DMA-BUF");
+        g_unlink(filename);
+        g_free(filename);
+    }
+    if (ftruncate(fd, size) < 0)
+        g_error("could not resize fake DMA-BUF");
+    return fd;
+}
+
+static gboolean
+is_valid_fd(gint fd)
+{
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+static void
+destroy_cb(gpointer user_data)
+{
+    (*(guint *)user_data)++;
+}
+
+static void
+test_buffer_proxy(void)
+{
+    GstVaapiBufferProxy *proxy;
+    guint num_destroys = 0;
+    gint fd, handle;
+
+    fd = create_fake_dmabuf(4096);
+    proxy = gst_vaapi_buffer_proxy_new(fd, 4096);
+    if (!proxy)
+        g_error("could not create buffer proxy");
+    gst_vaapi_buffer_proxy_set_destroy_notify(proxy, destroy_cb, &num_destroys);
+
+    /* The proxy owns a duplicate of the caller handle */
+    handle = gst_vaapi_buffer_proxy_get_handle(proxy);
+    if (handle < 0 || handle == fd)
+        g_error("buffer proxy did not duplicate the DMA-BUF handle");
+    if (gst_vaapi_buffer_proxy_get_size(proxy) != 4096)
+        g_error("unexpected buffer proxy size");
+    close(fd);
+    if (!is_valid_fd(handle))
+        g_error("DMA-BUF handle was closed along with the caller handle");
+
+    gst_vaapi_buffer_proxy_ref(proxy);
+    gst_vaapi_buffer_proxy_unref(proxy);
+    if (num_destroys != 0 || !is_valid_fd(handle))
+        g_error("buffer proxy was released too early");
+
+    gst_vaapi_buffer_proxy_unref(proxy);
+    if (num_destroys != 1)
+        g_error("destroy notify was called %u times", num_destroys);
+    if (is_valid_fd(handle))
+        g_error("DMA-BUF handle was not closed");
+    g_print("buffer proxy: ok\n");
+}
+
+static GstBuffer *
+new_dmabuf_buffer(GstAllocator *allocator, gsize size)
+{
+    GstBuffer *buffer;
+    GstMemory *mem;
+
+    mem = gst_dmabuf_allocator_alloc(allocator, create_fake_dmabuf(size), size);
+    if (!mem)
+        g_error("could not allocate DMA-BUF memory");
+    buffer = gst_buffer_new();
+    gst_buffer_append_memory(buffer, mem);
+    return buffer;
+}
+
+static void
+test_layout(GstAllocator *allocator)
+{
+    GstVideoInfo vi, layout;
+    GstBuffer *buffer;
+    GstMemory *mem;
+    gsize offsets[GST_VIDEO_MAX_PLANES] = { 0, };
+    gint strides[GST_VIDEO_MAX_PLANES] = { 0, };
+
+    gst_video_info_set_format(&vi, GST_VIDEO_FORMAT_NV12, WIDTH, HEIGHT);
+
+    /* Tightly packed planes, as described by the caps */
+    buffer = new_dmabuf_buffer(allocator, GST_VIDEO_INFO_SIZE(&vi));
+    if (!gst_vaapi_dmabuf_get_layout(buffer, &vi, &layout))
+        g_error("packed NV12 buffer was rejected");
+    if (GST_VIDEO_INFO_PLANE_OFFSET(&layout, 1) != WIDTH * HEIGHT ||
+        GST_VIDEO_INFO_PLANE_STRIDE(&layout, 1) != WIDTH)
+        g_error("unexpected packed NV12 layout");
+    gst_buffer_unref(buffer);
+
+    /* Padded planes, as described by the video meta */
+    strides[0] = strides[1] = 512;
+    offsets[1] = 512 * 256;
+    buffer = new_dmabuf_buffer(allocator, offsets[1] + 512 * 128);
+    gst_buffer_add_video_meta_full(buffer, 0, GST_VIDEO_FORMAT_NV12,
+        WIDTH, HEIGHT, 2, offsets, strides);
+    if (!gst_vaapi_dmabuf_get_layout(buffer, &vi, &layout))
+        g_error("padded NV12 buffer was rejected");
+    if (GST_VIDEO_INFO_PLANE_OFFSET(&layout, 1) != offsets[1] ||
+        GST_VIDEO_INFO_PLANE_STRIDE(&layout, 0) != 512 ||
+        GST_VIDEO_INFO_SIZE(&layout) != offsets[1] + 512 * 128)
+        g_error("unexpected padded NV12 layout");
+    gst_buffer_unref(buffer);
+
+    /* Planes exceeding the DMA-BUF size */
+    buffer = new_dmabuf_buffer(allocator, GST_VIDEO_INFO_SIZE(&vi) - 1);
+    if (gst_vaapi_dmabuf_get_layout(buffer, &vi, &layout))
+        g_error("undersized buffer was accepted");
+    gst_buffer_unref(buffer);
+
+    /* Planes split across several memories */
+    buffer = new_dmabuf_buffer(allocator, WIDTH * HEIGHT);
+    mem = gst_dmabuf_allocator_alloc(allocator,
+        create_fake_dmabuf(WIDTH * HEIGHT / 2), WIDTH * HEIGHT / 2);
+    gst_buffer_append_memory(buffer, mem);
+    if (gst_vaapi_dmabuf_get_layout(buffer, &vi, &layout))
+        g_error("multi-memory buffer was accepted");
+    gst_buffer_unref(buffer);
+
+    /* System memory */
+    buffer = gst_buffer_new_allocate(NULL, GST_VIDEO_INFO_SIZE(&vi), NULL);
+    if (gst_vaapi_dmabuf_get_layout(buffer, &vi, &layout))
+        g_error("system memory buffer was accepted");
+    gst_buffer_unref(buffer);
+    g_print("layout: ok\n");
+}
+
+static void
+test_query(GstAllocator *allocator)
+{
+    GstCaps *caps;
+    GstQuery *query;
+
+    caps = gst_caps_new_empty_simple("video/x-raw");
+    query = gst_query_new_allocation(caps, TRUE);
+    if (gst_vaapi_dmabuf_query_has_allocator(query))
+        g_error("empty allocation query has a DMA-BUF allocator");
+
+    gst_query_add_allocation_param(query, NULL, NULL);
+    gst_query_add_allocation_param(query, allocator, NULL);
+    if (!gst_vaapi_dmabuf_query_has_allocator(query))
+        g_error("DMA-BUF allocator was not found");
+
+    gst_query_unref(query);
+    gst_caps_unref(caps);
+    g_print("query: ok\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstAllocator *allocator;
+
+    gst_init(&argc, &argv);
+
+    allocator = gst_dmabuf_allocator_new();
+    if (!allocator)
+        g_error("could not create DMA-BUF allocator");
+
+    test_buffer_proxy();
+    test_layout(allocator);
+    test_query(allocator);
+
+    gst_object_unref(allocator);
+    return 0;
+}
@@ -0,0 +1,309 @@
+/*
+ *  test-encode-headers.c - Measure the H.264 headers generation cost
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Measures the CPU cost of the packed headers the H.264 encoder
+   generates for each frame, i.e. SPS, PPS and slice headers. Frames are
+   encoded with the stub VA driver, whose encoder emulation is instant,
+   so the time spent per frame is that of the encoder itself: once with
+   the packed headers the stub driver supports, then once with packed
+   headers disabled. The difference is the headers generation cost. The
+   SPS and PPS shall only be generated for IDR frames */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/vaapi/gstvaapisurfacepool.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include <gst/vaapi/gstvaapiencoder_h264.h>
+#include "gst/vaapi/gstvaapiencoder_priv.h"
+#include "stub-display.h"
+
+#define WIDTH           1920
+#define HEIGHT          1080
+#define KEYFRAME_PERIOD 30
+
+static guint g_num_frames = 1000;
+static guint g_num_slices = 4;
+
+static GOptionEntry g_options[] = {
+    { "frames", 'n',
+      0,
+      G_OPTION_ARG_INT, &g_num_frames,
+      "number of frames to encode", NULL },
+    { "slices", 's',
+      0,
+      G_OPTION_ARG_INT, &g_num_slices,
+      "number of slices per frame", NULL },
+    { NULL, }
+};
+
+/* ------------------------------------------------------------------------- */
+/* --- Packed headers                                                    --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    guint       num_sequences;
+    guint       num_pictures;
+    guint       num_slices;
+    guint64     num_bytes;
+} HeaderStats;
+
+static HeaderStats g_stats;
+static gboolean g_no_packed_headers;
+
+static VAStatus (*g_get_config_attributes)(VADriverContextP ctx,
+    VAProfile profile, VAEntrypoint entrypoint, VAConfigAttrib *attrib_list,
+    int num_attribs);
+static VAStatus (*g_create_buffer)(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id);
+
+/* Hides the packed headers support of the driver, if requested */
+static VAStatus
+track_GetConfigAttributes(VADriverContextP ctx, VAProfile profile,
+    VAEntrypoint entrypoint, VAConfigAttrib *attrib_list, int num_attribs)
+{
+    VAStatus status;
+    int i;
+
+    status = g_get_config_attributes(ctx, profile, entrypoint, attrib_list,
+        num_attribs);
+    if (status != VA_STATUS_SUCCESS || !g_no_packed_headers)
+        return status;
+
+    for (i = 0; i < num_attribs; i++) {
+        if (attrib_list[i].type == VAConfigAttribEncPackedHeaders)
+            attrib_list[i].value = 0;
+    }
+    return status;
+}
+
+/* Counts the packed headers, which are created with their contents */
+static VAStatus
+track_CreateBuffer(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id)
+{
+    const VAEncPackedHeaderParameterBuffer *packed_header_param;
+
+    if (type == VAEncPackedHeaderParameterBufferType && data) {
+        packed_header_param = data;
+        switch (packed_header_param->type) {
+        case VAEncPackedHeaderSequence:
+            g_stats.num_sequences++;
+            break;
+        case VAEncPackedHeaderPicture:
+            g_stats.num_pictures++;
+            break;
+        case VAEncPackedHeaderSlice:
+            g_stats.num_slices++;
+            break;
+        default:
+            break;
+        }
+        g_stats.num_bytes += (packed_header_param->bit_length + 7) / 8;
+    }
+    return g_create_buffer(ctx, context, type, size, num_elements, data,
+        buf_id);
+}
+
+/* Intercepts the packed headers, once the driver is loaded */
+static void
+track_packed_headers(VADisplay va_display)
+{
+    VADriverContextP const ctx = stub_display_get_driver_context(va_display);
+
+    g_get_config_attributes = ctx->vtable->vaGetConfigAttributes;
+    ctx->vtable->vaGetConfigAttributes = track_GetConfigAttributes;
+    g_create_buffer = ctx->vtable->vaCreateBuffer;
+    ctx->vtable->vaCreateBuffer = track_CreateBuffer;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Encoding                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+static GstVaapiEncoder *
+create_encoder(GstVaapiDisplay *display, GstVideoCodecState *state)
+{
+    GstVaapiEncoder *encoder;
+    GValue value = G_VALUE_INIT;
+
+    encoder = gst_vaapi_encoder_h264_new(display);
+    if (!encoder)
+        g_error("could not create H.264 encoder");
+
+    if (gst_vaapi_encoder_set_rate_control(encoder,
+            GST_VAAPI_RATECONTROL_CQP) != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("CQP rate control is not supported");
+    if (gst_vaapi_encoder_set_keyframe_period(encoder, KEYFRAME_PERIOD) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to set keyframe period");
+
+    g_value_init(&value, G_TYPE_UINT);
+    g_value_set_uint(&value, g_num_slices);
+    if (gst_vaapi_encoder_set_property(encoder,
+            GST_VAAPI_ENCODER_H264_PROP_NUM_SLICES, &value) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to set the number of slices");
+
+    if (gst_vaapi_encoder_set_codec_state(encoder, state) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to configure encoder");
+    return encoder;
+}
+
+/* Submits a new frame, and releases the coded buffers available so far */
+static void
+encode_frame(GstVaapiEncoder *encoder, GstVaapiVideoPool *pool, guint n)
+{
+    GstVideoCodecFrame *frame;
+    GstVaapiSurfaceProxy *proxy;
+    GstVaapiCodedBufferProxy *codedbuf_proxy;
+
+    proxy = gst_vaapi_surface_proxy_new_from_pool(
+        GST_VAAPI_SURFACE_POOL(pool));
+    if (!proxy)
+        g_error("failed to allocate source surface");
+
+    frame = g_slice_new0(GstVideoCodecFrame);
+    frame->ref_count = 1;
+    frame->system_frame_number = n;
+    frame->pts = n * GST_SECOND / 30;
+    gst_video_codec_frame_set_user_data(frame, proxy,
+        (GDestroyNotify)gst_vaapi_surface_proxy_unref);
+
+    if (gst_vaapi_encoder_put_frame(encoder, frame) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to encode frame %u", n);
+    gst_video_codec_frame_unref(frame);
+
+    while (gst_vaapi_encoder_get_buffer_with_timeout(encoder,
+               &codedbuf_proxy, 0) == GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        gst_vaapi_coded_buffer_proxy_unref(codedbuf_proxy);
+}
+
+/* Encodes all frames, and returns the time spent per frame (ns) */
+static gdouble
+run_benchmark(GstVaapiDisplay *display, GstVideoCodecState *state,
+    GstVaapiVideoPool *pool, gboolean packed_headers)
+{
+    GstVaapiEncoder *encoder;
+    gint64 start_time, elapsed;
+    guint i;
+
+    g_no_packed_headers = !packed_headers;
+    encoder = create_encoder(display, state);
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    start_time = g_get_monotonic_time();
+    for (i = 0; i < g_num_frames; i++)
+        encode_frame(encoder, pool, i);
+    elapsed = g_get_monotonic_time() - start_time;
+
+    gst_vaapi_encoder_unref(encoder);
+    return elapsed * 1000.0 / g_num_frames;
+}
+
+/* The SPS and PPS are generated for IDR frames only, the slice headers
+   for every slice */
+static void
+check_packed_headers(gboolean packed_headers)
+{
+    const guint num_idr_frames =
+        (g_num_frames + KEYFRAME_PERIOD - 1) / KEYFRAME_PERIOD;
+
+    if (!packed_headers) {
+        if (g_stats.num_bytes > 0)
+            g_error("got %" G_GUINT64_FORMAT " bytes of packed headers, "
+                "expected none", g_stats.num_bytes);
+        return;
+    }
+
+    if (g_stats.num_sequences != num_idr_frames)
+        g_error("got %u packed SPS, expected %u", g_stats.num_sequences,
+            num_idr_frames);
+    if (g_stats.num_pictures != num_idr_frames)
+        g_error("got %u packed PPS, expected %u", g_stats.num_pictures,
+            num_idr_frames);
+    if (g_stats.num_slices != g_num_frames * g_num_slices)
+        g_error("got %u packed slice headers, expected %u",
+            g_stats.num_slices, g_num_frames * g_num_slices);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GOptionContext *options;
+    GstVaapiDisplay *display;
+    GstVaapiVideoPool *pool;
+    GstVideoCodecState state;
+    VADisplay va_display;
+    gdouble headers_time, no_headers_time;
+    guint64 num_bytes;
+
+    options = g_option_context_new(" - H.264 headers generation benchmark");
+    g_option_context_add_main_entries(options, g_options, NULL);
+    if (!g_option_context_parse(options, &argc, &argv, NULL))
+        return 1;
+    g_option_context_free(options);
+
+    if (!g_num_frames || !g_num_slices)
+        g_error("invalid number of frames or slices");
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+    track_packed_headers(va_display);
+
+    memset(&state, 0, sizeof(state));
+    gst_video_info_set_format(&state.info, GST_VIDEO_FORMAT_NV12,
+        WIDTH, HEIGHT);
+    state.info.fps_n = 30;
+    state.info.fps_d = 1;
+
+    pool = gst_vaapi_surface_pool_new(display, &state.info);
+    if (!pool)
+        g_error("could not create source surface pool");
+
+    headers_time = run_benchmark(display, &state, pool, TRUE);
+    check_packed_headers(TRUE);
+    num_bytes = g_stats.num_bytes;
+
+    no_headers_time = run_benchmark(display, &state, pool, FALSE);
+    check_packed_headers(FALSE);
+
+    g_print("encoding cost per frame (%ux%u, %u slices, %u frames)\n",
+        WIDTH, HEIGHT, g_num_slices, g_num_frames);
+    g_print("  with packed headers:    %8.1f ns (%.1f bytes)\n",
+        headers_time, (gdouble)num_bytes / g_num_frames);
+    g_print("  without packed headers: %8.1f ns\n", no_headers_time);
+    g_print("  headers generation:     %8.1f ns\n",
+        headers_time - no_headers_time);
+
+    gst_vaapi_video_pool_unref(pool);
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
@@ -0,0 +1,517 @@
+/*
+ *  test-encode-params.c - Test encoder parameter changes while encoding
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test encodes H.264 frames with the stub VA driver, changes the
+   bitrate, the keyframe period and the framerate on the fly, and checks
+   the parameters submitted to the driver: the new bitrate applies to
+   the next frame, the sequence parameters are only submitted along
+   with IDR frames, and the new keyframe period sets the IDR spacing.
+   Forced key frames shall be IDR frames, and neither the VA context nor
+   the coded buffer pool shall be re-allocated. Changing the number of
+   B-frames while encoding shall be rejected */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <va/va_enc_h264.h>
+#include <gst/vaapi/gstvaapisurfacepool.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include <gst/vaapi/gstvaapiencoder_h264.h>
+#include "gst/vaapi/gstvaapiencoder_priv.h"
+#include "stub-display.h"
+
+#define NUM_FRAMES      10
+#define WIDTH           320
+#define HEIGHT          240
+
+static guint g_bitrate = 2000;
+
+static GOptionEntry g_options[] = {
+    { "bitrate", 'b',
+      0,
+      G_OPTION_ARG_INT, &g_bitrate,
+      "initial bitrate (kbps)", NULL },
+    { NULL, }
+};
+
+/* ------------------------------------------------------------------------- */
+/* --- Submitted parameters                                              --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    gboolean    is_idr;
+    guint       frame_num;
+    gboolean    has_sequence;
+    guint       sequence_bitrate;
+    guint       bitrate;
+} PictureInfo;
+
+static GArray *g_pictures;
+static GHashTable *g_buffer_types;
+static PictureInfo g_picture;
+
+static VAStatus (*g_create_buffer)(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id);
+static VAStatus (*g_destroy_buffer)(VADriverContextP ctx, VABufferID buf_id);
+static VAStatus (*g_begin_picture)(VADriverContextP ctx, VAContextID context,
+    VASurfaceID render_target);
+static VAStatus (*g_render_picture)(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers);
+static VAStatus (*g_end_picture)(VADriverContextP ctx, VAContextID context);
+
+static VAStatus
+track_CreateBuffer(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id)
+{
+    VAStatus status;
+
+    status = g_create_buffer(ctx, context, type, size, num_elements, data,
+        buf_id);
+    if (status == VA_STATUS_SUCCESS)
+        g_hash_table_insert(g_buffer_types, GUINT_TO_POINTER(*buf_id),
+            GINT_TO_POINTER(type));
+    return status;
+}
+
+static VAStatus
+track_DestroyBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    g_hash_table_remove(g_buffer_types, GUINT_TO_POINTER(buf_id));
+    return g_destroy_buffer(ctx, buf_id);
+}
+
+static VAStatus
+track_BeginPicture(VADriverContextP ctx, VAContextID context,
+    VASurfaceID render_target)
+{
+    memset(&g_picture, 0, sizeof(g_picture));
+    return g_begin_picture(ctx, context, render_target);
+}
+
+/* Records the parameters of interest, from the buffer contents */
+static void
+record_buffer(VABufferType type, gconstpointer data)
+{
+    switch (type) {
+    case VAEncSequenceParameterBufferType: {
+        const VAEncSequenceParameterBufferH264 * const seq_param = data;
+        g_picture.has_sequence = TRUE;
+        g_picture.sequence_bitrate = seq_param->bits_per_second;
+        break;
+    }
+    case VAEncPictureParameterBufferType: {
+        const VAEncPictureParameterBufferH264 * const pic_param = data;
+        g_picture.is_idr = pic_param->pic_fields.bits.idr_pic_flag;
+        g_picture.frame_num = pic_param->frame_num;
+        break;
+    }
+    case VAEncMiscParameterBufferType: {
+        const VAEncMiscParameterBuffer * const misc = data;
+        const VAEncMiscParameterRateControl *rate_control;
+        if (misc->type != VAEncMiscParameterTypeRateControl)
+            break;
+        rate_control = (VAEncMiscParameterRateControl *)misc->data;
+        g_picture.bitrate = rate_control->bits_per_second;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static VAStatus
+track_RenderPicture(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers)
+{
+    gpointer type, data;
+    int i;
+
+    for (i = 0; i < num_buffers; i++) {
+        if (!g_hash_table_lookup_extended(g_buffer_types,
+                GUINT_TO_POINTER(buffers[i]), NULL, &type))
+            continue;
+        if (ctx->vtable->vaMapBuffer(ctx, buffers[i], &data) !=
+            VA_STATUS_SUCCESS)
+            g_error("could not map buffer 0x%08x", buffers[i]);
+        record_buffer(GPOINTER_TO_INT(type), data);
+        ctx->vtable->vaUnmapBuffer(ctx, buffers[i]);
+    }
+    return g_render_picture(ctx, context, buffers, num_buffers);
+}
+
+static VAStatus
+track_EndPicture(VADriverContextP ctx, VAContextID context)
+{
+    g_array_append_val(g_pictures, g_picture);
+    return g_end_picture(ctx, context);
+}
+
+/* Intercepts the encode parameters, once the driver is loaded */
+static void
+track_pictures(VADisplay va_display)
+{
+    VADriverContextP const ctx = stub_display_get_driver_context(va_display);
+
+    g_create_buffer = ctx->vtable->vaCreateBuffer;
+    ctx->vtable->vaCreateBuffer = track_CreateBuffer;
+    g_destroy_buffer = ctx->vtable->vaDestroyBuffer;
+    ctx->vtable->vaDestroyBuffer = track_DestroyBuffer;
+    g_begin_picture = ctx->vtable->vaBeginPicture;
+    ctx->vtable->vaBeginPicture = track_BeginPicture;
+    g_render_picture = ctx->vtable->vaRenderPicture;
+    ctx->vtable->vaRenderPicture = track_RenderPicture;
+    g_end_picture = ctx->vtable->vaEndPicture;
+    ctx->vtable->vaEndPicture = track_EndPicture;
+
+    g_pictures = g_array_new(FALSE, TRUE, sizeof(PictureInfo));
+    g_buffer_types = g_hash_table_new(NULL, NULL);
+}
+
+static inline const PictureInfo *
+get_picture(guint n)
+{
+    if (n >= g_pictures->len)
+        g_error("picture %u was not encoded", n);
+    return &g_array_index(g_pictures, PictureInfo, n);
+}
+
+/* Returns the bitrate in bits/sec, as rounded down by the encoder */
+static inline guint
+get_bitrate_bits(guint bitrate)
+{
+    return (bitrate * 1000) & ~63U;
+}
+
+/* Checks the rate control parameters of pictures [start, end[ */
+static void
+check_bitrate(guint start, guint end, guint bitrate)
+{
+    const guint bitrate_bits = get_bitrate_bits(bitrate);
+    guint i;
+
+    for (i = start; i < end; i++) {
+        if (get_picture(i)->bitrate != bitrate_bits)
+            g_error("picture %u was encoded at %u bits/sec, expected %u",
+                i, get_picture(i)->bitrate, bitrate_bits);
+    }
+    g_print("pictures %u to %u encoded at %u bits/sec\n", start, end - 1,
+        bitrate_bits);
+}
+
+/* Checks that IDR pictures within [start, end[ are spaced by period */
+static void
+check_idr_period(guint start, guint end, guint period)
+{
+    const PictureInfo *picture;
+    guint i;
+
+    for (i = start; i < end; i++) {
+        picture = get_picture(i);
+        if (picture->is_idr != ((i - start) % period == 0))
+            g_error("picture %u is %san IDR picture, with a period of %u",
+                i, picture->is_idr ? "" : "not ", period);
+    }
+    g_print("pictures %u to %u encoded with an IDR period of %u\n",
+        start, end - 1, period);
+}
+
+/* Checks the sequence parameters are only submitted with IDR pictures,
+   and that they convey the requested bitrate from picture start on */
+static void
+check_sequences(guint start, guint bitrate)
+{
+    const PictureInfo *picture;
+    gboolean got_sequence = FALSE;
+    guint i;
+
+    for (i = 0; i < g_pictures->len; i++) {
+        picture = get_picture(i);
+        if (picture->is_idr && picture->frame_num != 0)
+            g_error("IDR picture %u has frame_num %u", i, picture->frame_num);
+        if (!picture->has_sequence)
+            continue;
+        if (!picture->is_idr)
+            g_error("sequence parameters submitted with non-IDR picture %u",
+                i);
+        if (i < start)
+            continue;
+        if (picture->sequence_bitrate != get_bitrate_bits(bitrate))
+            g_error("sequence of picture %u has bitrate %u bits/sec", i,
+                picture->sequence_bitrate);
+        got_sequence = TRUE;
+    }
+    if (!got_sequence)
+        g_error("no sequence parameters since picture %u", start);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Encoding                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    GstVaapiContext    *context;
+    VAContextID         va_context;
+    GstVaapiVideoPool  *codedbuf_pool;
+} EncoderResources;
+
+static void
+get_resources(GstVaapiEncoder *encoder, EncoderResources *res)
+{
+    res->context        = encoder->context;
+    res->va_context     = encoder->va_context;
+    res->codedbuf_pool  = encoder->codedbuf_pool;
+}
+
+static void
+check_resources(GstVaapiEncoder *encoder, const EncoderResources *res,
+    const gchar *what)
+{
+    EncoderResources new_res;
+
+    get_resources(encoder, &new_res);
+    if (new_res.context != res->context ||
+        new_res.va_context != res->va_context)
+        g_error("VA context was re-created after %s change", what);
+    if (new_res.codedbuf_pool != res->codedbuf_pool)
+        g_error("coded buffer pool was re-allocated after %s change", what);
+    g_print("%s changed, VA context 0x%08x kept\n", what, res->va_context);
+}
+
+/* Submits a new frame, and releases the coded buffers available so far */
+static GstVaapiEncoderStatus
+encode_frame(GstVaapiEncoder *encoder, GstVaapiVideoPool *pool, guint n,
+    gboolean force_keyframe)
+{
+    GstVideoCodecFrame *frame;
+    GstVaapiSurfaceProxy *proxy;
+    GstVaapiCodedBufferProxy *codedbuf_proxy;
+    GstVaapiEncoderStatus status;
+
+    proxy = gst_vaapi_surface_proxy_new_from_pool(
+        GST_VAAPI_SURFACE_POOL(pool));
+    if (!proxy)
+        g_error("failed to allocate source surface");
+
+    frame = g_slice_new0(GstVideoCodecFrame);
+    frame->ref_count = 1;
+    frame->system_frame_number = n;
+    frame->pts = n * GST_SECOND / 30;
+    if (force_keyframe)
+        GST_VIDEO_CODEC_FRAME_SET_FORCE_KEYFRAME(frame);
+    gst_video_codec_frame_set_user_data(frame, proxy,
+        (GDestroyNotify)gst_vaapi_surface_proxy_unref);
+
+    status = gst_vaapi_encoder_put_frame(encoder, frame);
+    gst_video_codec_frame_unref(frame);
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        return status;
+
+    while (gst_vaapi_encoder_get_buffer_with_timeout(encoder,
+               &codedbuf_proxy, 0) == GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        gst_vaapi_coded_buffer_proxy_unref(codedbuf_proxy);
+    return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
+static void
+encode_frames(GstVaapiEncoder *encoder, GstVaapiVideoPool *pool, guint *n,
+    guint num_frames)
+{
+    guint i;
+
+    for (i = 0; i < num_frames; i++, (*n)++) {
+        if (encode_frame(encoder, pool, *n, FALSE) !=
+            GST_VAAPI_ENCODER_STATUS_SUCCESS)
+            g_error("failed to encode frame %u", *n);
+    }
+}
+
+static GstVaapiEncoder *
+create_encoder(GstVaapiDisplay *display, GstVideoCodecState *state,
+    guint num_bframes)
+{
+    GstVaapiEncoder *encoder;
+    GValue value = G_VALUE_INIT;
+
+    encoder = gst_vaapi_encoder_h264_new(display);
+    if (!encoder)
+        g_error("could not create H.264 encoder");
+
+    if (gst_vaapi_encoder_set_rate_control(encoder,
+            GST_VAAPI_RATECONTROL_CBR) != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("CBR rate control is not supported");
+    if (gst_vaapi_encoder_set_bitrate(encoder, g_bitrate) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to set initial bitrate");
+    if (gst_vaapi_encoder_set_keyframe_period(encoder, 30) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to set initial keyframe period");
+
+    g_value_init(&value, G_TYPE_UINT);
+    g_value_set_uint(&value, num_bframes);
+    if (gst_vaapi_encoder_set_property(encoder,
+            GST_VAAPI_ENCODER_H264_PROP_MAX_BFRAMES, &value) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to set the number of B-frames");
+
+    if (gst_vaapi_encoder_set_codec_state(encoder, state) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to configure encoder");
+    return encoder;
+}
+
+/* Changes of the number of B-frames, or keyframe periods too short for
+   them, are rejected while encoding */
+static void
+check_bframes_changes(GstVaapiDisplay *display, GstVideoCodecState *state,
+    GstVaapiVideoPool *pool)
+{
+    GstVaapiEncoder *encoder;
+    GValue value = G_VALUE_INIT;
+    guint n = 0;
+
+    encoder = create_encoder(display, state, 2);
+    encode_frames(encoder, pool, &n, NUM_FRAMES);
+
+    g_value_init(&value, G_TYPE_UINT);
+    g_value_set_uint(&value, 0);
+    if (gst_vaapi_encoder_set_property(encoder,
+            GST_VAAPI_ENCODER_H264_PROP_MAX_BFRAMES, &value) ==
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("B-frames change was accepted while encoding");
+
+    if (gst_vaapi_encoder_set_keyframe_period(encoder, 2) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to change keyframe period while encoding");
+    if (encode_frame(encoder, pool, n, FALSE) ==
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("keyframe period too short for 2 B-frames was accepted");
+    g_print("B-frames changes rejected\n");
+
+    gst_vaapi_encoder_unref(encoder);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GOptionContext *options;
+    GstVaapiDisplay *display;
+    GstVaapiEncoder *encoder;
+    GstVaapiVideoPool *pool;
+    GstVideoCodecState state;
+    EncoderResources res;
+    VADisplay va_display;
+    guint start, n = 0;
+
+    options = g_option_context_new(" - encoder parameter changes test");
+    g_option_context_add_main_entries(options, g_options, NULL);
+    if (!g_option_context_parse(options, &argc, &argv, NULL))
+        return 1;
+    g_option_context_free(options);
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+    track_pictures(va_display);
+
+    memset(&state, 0, sizeof(state));
+    gst_video_info_set_format(&state.info, GST_VIDEO_FORMAT_NV12,
+        WIDTH, HEIGHT);
+    state.info.fps_n = 30;
+    state.info.fps_d = 1;
+    encoder = create_encoder(display, &state, 0);
+
+    pool = gst_vaapi_surface_pool_new(display, &state.info);
+    if (!pool)
+        g_error("could not create source surface pool");
+
+    encode_frames(encoder, pool, &n, NUM_FRAMES);
+    get_resources(encoder, &res);
+    check_bitrate(0, n, g_bitrate);
+    check_idr_period(0, n, 30);
+    check_sequences(0, g_bitrate);
+
+    /* Bitrate: applies to the next frame, the SPS waits for an IDR */
+    if (gst_vaapi_encoder_set_bitrate(encoder, g_bitrate / 2) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to change bitrate while encoding");
+    start = n;
+    encode_frames(encoder, pool, &n, NUM_FRAMES);
+    if (encoder->params_changed)
+        g_error("bitrate change was not applied");
+    check_bitrate(start, n, g_bitrate / 2);
+    check_idr_period(0, n, 30);
+    check_resources(encoder, &res, "bitrate");
+
+    /* Keyframe period: the current GOP is already longer, so the next
+       frame is an IDR frame, which carries the new SPS */
+    if (gst_vaapi_encoder_set_keyframe_period(encoder, 15) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to change keyframe period while encoding");
+    start = n;
+    encode_frames(encoder, pool, &n, 3 * 15);
+    check_idr_period(start, n, 15);
+    check_sequences(start, g_bitrate / 2);
+    check_resources(encoder, &res, "keyframe period");
+
+    /* Forced key frames are IDR frames, and start a new GOP */
+    encode_frames(encoder, pool, &n, 5);
+    start = n;
+    if (encode_frame(encoder, pool, n++, TRUE) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to encode forced key frame");
+    encode_frames(encoder, pool, &n, 2 * 15);
+    check_idr_period(start, n, 15);
+    if (get_picture(start)->frame_num != 0)
+        g_error("forced key frame %u has frame_num %u", start,
+            get_picture(start)->frame_num);
+    g_print("forced key frame %u encoded as an IDR frame\n", start);
+
+    /* Framerate */
+    state.info.fps_n = 15;
+    if (gst_vaapi_encoder_set_codec_state(encoder, &state) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("failed to change framerate while encoding");
+    encode_frames(encoder, pool, &n, NUM_FRAMES);
+    check_resources(encoder, &res, "framerate");
+
+    /* Resolution changes are still not allowed */
+    state.info.width = WIDTH * 2;
+    if (gst_vaapi_encoder_set_codec_state(encoder, &state) ==
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        g_error("resolution change was accepted while encoding");
+    state.info.width = WIDTH;
+    gst_vaapi_encoder_unref(encoder);
+
+    state.info.fps_n = 30;
+    check_bframes_changes(display, &state, pool);
+
+    gst_vaapi_video_pool_unref(pool);
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    g_hash_table_unref(g_buffer_types);
+    g_array_unref(g_pictures);
+    gst_deinit();
+    return 0;
+}
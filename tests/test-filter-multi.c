@@ -0,0 +1,281 @@
+/*
+ *  test-filter-multi.c - Test video processing into multiple surfaces
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Scales one interlaced source surface into several renditions with
+   the stub VA driver, as the vaapipostproc ladder does. Every rendition
+   shall be produced with the deinterlacing references, and into an
+   output region that matches its own surface size. The references
+   shall not outlive the gst_vaapi_filter_process_multi() call */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/vaapi/gstvaapifilter.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include <va/va_vpp.h>
+#include "stub-display.h"
+
+#define SOURCE_WIDTH            1920
+#define SOURCE_HEIGHT           1080
+#define NUM_REFERENCES          2
+
+typedef struct {
+    guint       width;
+    guint       height;
+} Rendition;
+
+static const Rendition g_renditions[] = {
+    { 1280, 720 },
+    {  640, 360 },
+    {  320, 180 },
+};
+
+#define NUM_RENDITIONS          G_N_ELEMENTS(g_renditions)
+
+/* ------------------------------------------------------------------------- */
+/* --- Pipeline tracking                                                 --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    VASurfaceID render_target;
+    VARectangle output_region;
+    VASurfaceID forward_references[NUM_REFERENCES];
+    guint       num_forward_references;
+} Job;
+
+static GArray *g_jobs;
+static VASurfaceID g_render_target = VA_INVALID_ID;
+static VABufferID g_pipeline_param_id = VA_INVALID_ID;
+
+static VAStatus (*g_begin_picture)(VADriverContextP ctx, VAContextID context,
+    VASurfaceID render_target);
+static VAStatus (*g_create_buffer)(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id);
+static VAStatus (*g_render_picture)(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers);
+
+static VAStatus
+track_BeginPicture(VADriverContextP ctx, VAContextID context,
+    VASurfaceID render_target)
+{
+    g_render_target = render_target;
+    return g_begin_picture(ctx, context, render_target);
+}
+
+static VAStatus
+track_CreateBuffer(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id)
+{
+    VAStatus status;
+
+    status = g_create_buffer(ctx, context, type, size, num_elements, data,
+        buf_id);
+    if (status == VA_STATUS_SUCCESS &&
+        type == VAProcPipelineParameterBufferType)
+        g_pipeline_param_id = *buf_id;
+    return status;
+}
+
+/* Records the pipeline parameters once they are submitted, while the
+   regions and references they point to are still valid */
+static void
+record_job(VADriverContextP ctx, VABufferID buf_id)
+{
+    const VAProcPipelineParameterBuffer *pipeline_param;
+    Job job;
+    void *data;
+    guint i;
+
+    if (ctx->vtable->vaMapBuffer(ctx, buf_id, &data) != VA_STATUS_SUCCESS)
+        g_error("could not map pipeline parameters");
+    pipeline_param = data;
+
+    memset(&job, 0, sizeof(job));
+    job.render_target = g_render_target;
+    if (pipeline_param->output_region)
+        job.output_region = *pipeline_param->output_region;
+    job.num_forward_references = pipeline_param->num_forward_references;
+    if (job.num_forward_references > NUM_REFERENCES)
+        g_error("got %u forward references, expected at most %u",
+            job.num_forward_references, NUM_REFERENCES);
+    for (i = 0; i < job.num_forward_references; i++)
+        job.forward_references[i] = pipeline_param->forward_references[i];
+    g_array_append_val(g_jobs, job);
+    ctx->vtable->vaUnmapBuffer(ctx, buf_id);
+}
+
+static VAStatus
+track_RenderPicture(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers)
+{
+    int i;
+
+    for (i = 0; i < num_buffers; i++) {
+        if (buffers[i] == g_pipeline_param_id)
+            record_job(ctx, buffers[i]);
+    }
+    return g_render_picture(ctx, context, buffers, num_buffers);
+}
+
+/* Intercepts video processing jobs, once the driver is loaded */
+static void
+track_jobs(VADisplay va_display)
+{
+    VADriverContextP const ctx = stub_display_get_driver_context(va_display);
+
+    g_begin_picture = ctx->vtable->vaBeginPicture;
+    ctx->vtable->vaBeginPicture = track_BeginPicture;
+    g_create_buffer = ctx->vtable->vaCreateBuffer;
+    ctx->vtable->vaCreateBuffer = track_CreateBuffer;
+    g_render_picture = ctx->vtable->vaRenderPicture;
+    ctx->vtable->vaRenderPicture = track_RenderPicture;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Tests                                                             --- */
+/* ------------------------------------------------------------------------- */
+
+static GstVaapiSurface *
+create_surface(GstVaapiDisplay *display, guint width, guint height)
+{
+    GstVaapiSurface *surface;
+
+    surface = gst_vaapi_surface_new(display, GST_VAAPI_CHROMA_TYPE_YUV420,
+        width, height);
+    if (!surface)
+        g_error("could not create %ux%u surface", width, height);
+    return surface;
+}
+
+static void
+check_job(const Job *job, GstVaapiSurface *surface,
+    GstVaapiSurface **refs, guint num_refs)
+{
+    guint i;
+
+    if (job->render_target != gst_vaapi_object_get_id(
+            GST_VAAPI_OBJECT(surface)))
+        g_error("job was not rendered into the expected surface");
+
+    if (job->output_region.x != 0 || job->output_region.y != 0 ||
+        job->output_region.width != gst_vaapi_surface_get_width(surface) ||
+        job->output_region.height != gst_vaapi_surface_get_height(surface))
+        g_error("got %ux%u output region, expected %ux%u",
+            job->output_region.width, job->output_region.height,
+            gst_vaapi_surface_get_width(surface),
+            gst_vaapi_surface_get_height(surface));
+
+    if (job->num_forward_references != num_refs)
+        g_error("got %u forward references, expected %u",
+            job->num_forward_references, num_refs);
+    for (i = 0; i < num_refs; i++) {
+        if (job->forward_references[i] != gst_vaapi_object_get_id(
+                GST_VAAPI_OBJECT(refs[i])))
+            g_error("forward reference %u does not match", i);
+    }
+}
+
+static void
+check_process_multi(GstVaapiFilter *filter, GstVaapiSurface *src_surface,
+    GstVaapiSurface **dst_surfaces, GstVaapiSurface **refs)
+{
+    GstVaapiFilterStatus status;
+    guint i;
+
+    if (!gst_vaapi_filter_set_deinterlacing(filter,
+            GST_VAAPI_DEINTERLACE_METHOD_MOTION_ADAPTIVE,
+            GST_VAAPI_DEINTERLACE_FLAG_TFF))
+        g_error("could not enable motion adaptive deinterlacing");
+    if (!gst_vaapi_filter_set_deinterlacing_references(filter,
+            refs, NUM_REFERENCES, NULL, 0))
+        g_error("could not set deinterlacing references");
+
+    g_array_set_size(g_jobs, 0);
+    status = gst_vaapi_filter_process_multi(filter, src_surface,
+        dst_surfaces, NUM_RENDITIONS, GST_VAAPI_PICTURE_STRUCTURE_TOP_FIELD);
+    if (status != GST_VAAPI_FILTER_STATUS_SUCCESS)
+        g_error("could not process renditions (status %d)", status);
+
+    g_print("process multi: %u jobs\n", g_jobs->len);
+    if (g_jobs->len != NUM_RENDITIONS)
+        g_error("got %u jobs, expected %u", g_jobs->len,
+            (guint)NUM_RENDITIONS);
+    for (i = 0; i < NUM_RENDITIONS; i++)
+        check_job(&g_array_index(g_jobs, Job, i), dst_surfaces[i],
+            refs, NUM_REFERENCES);
+
+    /* References are not sticky, even across multiple destinations */
+    g_array_set_size(g_jobs, 0);
+    status = gst_vaapi_filter_process(filter, src_surface, dst_surfaces[0],
+        GST_VAAPI_PICTURE_STRUCTURE_BOTTOM_FIELD);
+    if (status != GST_VAAPI_FILTER_STATUS_SUCCESS)
+        g_error("could not process second field (status %d)", status);
+    if (g_jobs->len != 1)
+        g_error("got %u jobs, expected 1", g_jobs->len);
+    check_job(&g_array_index(g_jobs, Job, 0), dst_surfaces[0], NULL, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplay *display;
+    GstVaapiFilter *filter;
+    GstVaapiSurface *src_surface;
+    GstVaapiSurface *dst_surfaces[NUM_RENDITIONS];
+    GstVaapiSurface *refs[NUM_REFERENCES];
+    VADisplay va_display;
+    guint i;
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+    track_jobs(va_display);
+
+    filter = gst_vaapi_filter_new(display);
+    if (!filter)
+        g_error("could not create video processing filter");
+
+    src_surface = create_surface(display, SOURCE_WIDTH, SOURCE_HEIGHT);
+    for (i = 0; i < NUM_REFERENCES; i++)
+        refs[i] = create_surface(display, SOURCE_WIDTH, SOURCE_HEIGHT);
+    for (i = 0; i < NUM_RENDITIONS; i++)
+        dst_surfaces[i] = create_surface(display, g_renditions[i].width,
+            g_renditions[i].height);
+
+    g_jobs = g_array_new(FALSE, FALSE, sizeof(Job));
+    check_process_multi(filter, src_surface, dst_surfaces, refs);
+    g_array_unref(g_jobs);
+
+    for (i = 0; i < NUM_RENDITIONS; i++)
+        gst_vaapi_object_unref(dst_surfaces[i]);
+    for (i = 0; i < NUM_REFERENCES; i++)
+        gst_vaapi_object_unref(refs[i]);
+    gst_vaapi_object_unref(src_surface);
+    gst_vaapi_filter_unref(filter);
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
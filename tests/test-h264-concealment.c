@@ -0,0 +1,401 @@
+/*
+ *  test-h264-concealment.c - Test H.264 error concealment
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Decodes a synthetic H.264 stream with the stub VA driver, after it
+   was damaged the way a lossy transport would: one slice header is
+   truncated, some pictures miss slices, and the stream itself is cut
+   off in the middle of the last picture. With error concealment
+   enabled, every picture shall still be output, the damaged ones and
+   those predicted from them being marked as corrupted until the next
+   IDR picture. With error concealment disabled, and the broken slices
+   left out, no picture shall be marked as such */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/base/gstbitwriter.h>
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapidecoder_h264.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include "stub-display.h"
+
+#define PICTURE_WIDTH           320
+#define PICTURE_HEIGHT          240
+#define MB_WIDTH                (PICTURE_WIDTH / 16)
+#define NUM_SLICES              (PICTURE_HEIGHT / 16)
+#define MB_DATA_SIZE            32
+
+#define NAL_SLICE               1
+#define NAL_SLICE_IDR           5
+#define NAL_SPS                 7
+#define NAL_PPS                 8
+#define NAL_STREAM_END          11
+
+#define SLICE_TYPE_P            5
+#define SLICE_TYPE_I            7
+
+typedef struct {
+    gboolean    is_idr;
+    guint       first_missing;  /* first slice dropped from the stream */
+    guint       num_missing;    /* number of slices dropped */
+    gint        broken_slice;   /* slice with a truncated header, or -1 */
+    gboolean    is_corrupted;   /* expected output flag */
+} PictureTest;
+
+static const PictureTest g_pictures[] = {
+    { TRUE,   0,  0, -1, FALSE },
+    { FALSE,  0,  0, -1, FALSE },
+    { FALSE,  0,  0,  5, TRUE  },  /* broken slice */
+    { FALSE,  0,  0, -1, TRUE  },  /* corrupted reference */
+    { FALSE,  0,  3, -1, TRUE  },  /* missing leading slices */
+    { TRUE,   0,  0, -1, FALSE },
+    { FALSE,  0,  0, -1, FALSE },
+    { FALSE,  5, NUM_SLICES - 5, 4, TRUE },     /* truncated stream */
+};
+
+#define NUM_PICTURES            G_N_ELEMENTS(g_pictures)
+#define NUM_CORRUPTED_PICTURES  4
+#define NUM_RECOVERIES          1
+#define MAX_RECOVERY_PICTURES   3
+
+/* ------------------------------------------------------------------------- */
+/* --- Synthetic stream                                                  --- */
+/* ------------------------------------------------------------------------- */
+
+static void
+put_bits(GstBitWriter *bw, guint32 value, guint nbits)
+{
+    if (!gst_bit_writer_put_bits_uint32(bw, value, nbits))
+        g_error("could not write %u bits", nbits);
+}
+
+/* Writes an unsigned Exp-Golomb code, ue(v) */
+static void
+put_ue(GstBitWriter *bw, guint32 value)
+{
+    const guint nbits = g_bit_storage(value + 1);
+
+    put_bits(bw, 0, nbits - 1);
+    put_bits(bw, value + 1, nbits);
+}
+
+/* Writes a signed Exp-Golomb code, se(v) */
+static void
+put_se(GstBitWriter *bw, gint32 value)
+{
+    put_ue(bw, value > 0 ? 2 * value - 1 : -2 * value);
+}
+
+static void
+put_trailing_bits(GstBitWriter *bw)
+{
+    put_bits(bw, 1, 1);                         /* rbsp_stop_one_bit */
+    gst_bit_writer_align_bytes(bw, 0);
+}
+
+/* Appends the NAL unit held in bw to the byte stream, with its start
+   code and emulation prevention bytes, and releases bw */
+static void
+append_nal_unit(GByteArray *stream, GstBitWriter *bw)
+{
+    static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+    static const guint8 emulation_prevention_byte = 0x03;
+    const guint8 * const data = GST_BIT_WRITER_DATA(bw);
+    const guint size = GST_BIT_WRITER_BIT_SIZE(bw) / 8;
+    guint i, num_zeros = 0;
+
+    g_byte_array_append(stream, start_code, sizeof(start_code));
+    for (i = 0; i < size; i++) {
+        if (num_zeros == 2 && data[i] <= 0x03) {
+            g_byte_array_append(stream, &emulation_prevention_byte, 1);
+            num_zeros = 0;
+        }
+        g_byte_array_append(stream, &data[i], 1);
+        num_zeros = data[i] ? 0 : num_zeros + 1;
+    }
+    gst_bit_writer_clear(bw, TRUE);
+}
+
+/* Starts a new NAL unit in bw */
+static void
+put_nal_header(GstBitWriter *bw, guint nal_ref_idc, guint nal_unit_type)
+{
+    gst_bit_writer_init(bw, 256 * 8);
+    put_bits(bw, 0, 1);                         /* forbidden_zero_bit */
+    put_bits(bw, nal_ref_idc, 2);
+    put_bits(bw, nal_unit_type, 5);
+}
+
+/* Writes the SPS and PPS of a Main profile stream, with a single
+   reference frame, and the picture order derived from frame_num */
+static void
+write_parameter_sets(GByteArray *stream)
+{
+    GstBitWriter bw;
+
+    /* seq_parameter_set_rbsp() */
+    put_nal_header(&bw, 3, NAL_SPS);
+    put_bits(&bw, 77, 8);                       /* profile_idc (Main) */
+    put_bits(&bw, 0, 8);                        /* constraint_set_flags */
+    put_bits(&bw, 30, 8);                       /* level_idc (3.0) */
+    put_ue(&bw, 0);                             /* seq_parameter_set_id */
+    put_ue(&bw, 0);                             /* log2_max_frame_num_minus4 */
+    put_ue(&bw, 2);                             /* pic_order_cnt_type */
+    put_ue(&bw, 1);                             /* max_num_ref_frames */
+    put_bits(&bw, 0, 1);                        /* gaps_in_frame_num_allowed */
+    put_ue(&bw, MB_WIDTH - 1);                  /* pic_width_in_mbs_minus1 */
+    put_ue(&bw, NUM_SLICES - 1);                /* pic_height_in_map_units_minus1 */
+    put_bits(&bw, 1, 1);                        /* frame_mbs_only_flag */
+    put_bits(&bw, 1, 1);                        /* direct_8x8_inference_flag */
+    put_bits(&bw, 0, 1);                        /* frame_cropping_flag */
+    put_bits(&bw, 0, 1);                        /* vui_parameters_present_flag */
+    put_trailing_bits(&bw);
+    append_nal_unit(stream, &bw);
+
+    /* pic_parameter_set_rbsp() */
+    put_nal_header(&bw, 3, NAL_PPS);
+    put_ue(&bw, 0);                             /* pic_parameter_set_id */
+    put_ue(&bw, 0);                             /* seq_parameter_set_id */
+    put_bits(&bw, 0, 1);                        /* entropy_coding_mode_flag */
+    put_bits(&bw, 0, 1);                        /* bottom_field_pic_order_in_frame_present */
+    put_ue(&bw, 0);                             /* num_slice_groups_minus1 */
+    put_ue(&bw, 0);                             /* num_ref_idx_l0_default_active_minus1 */
+    put_ue(&bw, 0);                             /* num_ref_idx_l1_default_active_minus1 */
+    put_bits(&bw, 0, 1);                        /* weighted_pred_flag */
+    put_bits(&bw, 0, 2);                        /* weighted_bipred_idc */
+    put_se(&bw, 0);                             /* pic_init_qp_minus26 */
+    put_se(&bw, 0);                             /* pic_init_qs_minus26 */
+    put_se(&bw, 0);                             /* chroma_qp_index_offset */
+    put_bits(&bw, 0, 1);                        /* deblocking_filter_control_present */
+    put_bits(&bw, 0, 1);                        /* constrained_intra_pred_flag */
+    put_bits(&bw, 0, 1);                        /* redundant_pic_cnt_present */
+    put_trailing_bits(&bw);
+    append_nal_unit(stream, &bw);
+}
+
+/* Writes a picture, one slice per macroblock row, without the slices
+   that were lost. A broken slice header stops right after the PPS id.
+   The macroblock data is filled in with a pattern that cannot emulate
+   start codes, since it is not looked at by the stub driver */
+static void
+write_picture(GByteArray *stream, guint frame_num, guint idr_pic_id,
+    const PictureTest *test, gboolean with_broken_slice)
+{
+    GstBitWriter bw;
+    guint i, j;
+
+    for (i = 0; i < NUM_SLICES; i++) {
+        if (i >= test->first_missing &&
+            i < test->first_missing + test->num_missing)
+            continue;
+
+        if ((gint)i == test->broken_slice && !with_broken_slice)
+            continue;
+
+        /* slice_header() */
+        put_nal_header(&bw, 3, test->is_idr ? NAL_SLICE_IDR : NAL_SLICE);
+        put_ue(&bw, i * MB_WIDTH);              /* first_mb_in_slice */
+        put_ue(&bw, test->is_idr ? SLICE_TYPE_I : SLICE_TYPE_P);
+        put_ue(&bw, 0);                         /* pic_parameter_set_id */
+        if ((gint)i == test->broken_slice) {
+            put_trailing_bits(&bw);
+            append_nal_unit(stream, &bw);
+            continue;
+        }
+        put_bits(&bw, frame_num, 4);
+        if (test->is_idr)
+            put_ue(&bw, idr_pic_id);
+        else {
+            put_bits(&bw, 0, 1);                /* num_ref_idx_active_override */
+            put_bits(&bw, 0, 1);                /* ref_pic_list_modification_flag_l0 */
+        }
+
+        /* dec_ref_pic_marking() */
+        if (test->is_idr) {
+            put_bits(&bw, 0, 1);                /* no_output_of_prior_pics */
+            put_bits(&bw, 0, 1);                /* long_term_reference_flag */
+        }
+        else
+            put_bits(&bw, 0, 1);                /* adaptive_ref_pic_marking */
+        put_se(&bw, 0);                         /* slice_qp_delta */
+
+        /* slice_data() */
+        for (j = 0; j < MB_DATA_SIZE; j++)
+            put_bits(&bw, 0xaa, 8);
+        put_trailing_bits(&bw);
+        append_nal_unit(stream, &bw);
+    }
+}
+
+/* Creates the damaged stream. The broken slices are optionally left
+   out, since the parser error they raise is only recovered from in
+   error concealment mode */
+static guint8 *
+create_stream(gboolean with_broken_slices, gsize *size_ptr)
+{
+    GByteArray *stream;
+    GstBitWriter bw;
+    guint i, frame_num = 0, idr_pic_id = 0;
+
+    stream = g_byte_array_new();
+    write_parameter_sets(stream);
+    for (i = 0; i < NUM_PICTURES; i++) {
+        if (g_pictures[i].is_idr) {
+            frame_num = 0;
+            idr_pic_id++;
+        }
+        write_picture(stream, frame_num, idr_pic_id, &g_pictures[i],
+            with_broken_slices);
+        frame_num = (frame_num + 1) % 16;
+    }
+
+    /* end_of_stream_rbsp() */
+    put_nal_header(&bw, 0, NAL_STREAM_END);
+    append_nal_unit(stream, &bw);
+
+    *size_ptr = stream->len;
+    return g_byte_array_free(stream, FALSE);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Decoding                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+/* Decodes the stream and returns the corrupted flag of each output
+   picture, as a string of 'C' (corrupted) and '.' (clean) characters */
+static gchar *
+decode_stream(GstVaapiDisplay *display, gboolean error_concealment,
+    const guint8 *data, gsize size, GstVaapiDecoderErrorStats *stats)
+{
+    GstVaapiDecoder *decoder;
+    GstVaapiDecoderStatus status;
+    GstVaapiSurfaceProxy *proxy;
+    GstBuffer *buffer;
+    GstCaps *caps;
+    GString *str;
+
+    caps = gst_caps_new_simple("video/x-h264",
+        "stream-format", G_TYPE_STRING, "byte-stream",
+        NULL);
+    decoder = gst_vaapi_decoder_h264_new(display, caps);
+    gst_caps_unref(caps);
+    if (!decoder)
+        g_error("could not create H.264 decoder");
+    gst_vaapi_decoder_set_error_concealment(decoder, error_concealment);
+
+    buffer = gst_buffer_new_allocate(NULL, size, NULL);
+    gst_buffer_fill(buffer, 0, data, size);
+    if (!gst_vaapi_decoder_put_buffer(decoder, buffer))
+        g_error("could not submit stream");
+    gst_buffer_unref(buffer);
+    if (!gst_vaapi_decoder_put_buffer(decoder, NULL))
+        g_error("could not submit end-of-stream");
+
+    str = g_string_new(NULL);
+    while ((status = gst_vaapi_decoder_get_surface(decoder, &proxy)) ==
+           GST_VAAPI_DECODER_STATUS_SUCCESS) {
+        const guint flags = gst_vaapi_surface_proxy_get_flags(proxy);
+        g_string_append_c(str,
+            (flags & GST_VAAPI_SURFACE_PROXY_FLAG_CORRUPTED) ? 'C' : '.');
+        gst_vaapi_surface_proxy_unref(proxy);
+    }
+    if (status != GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA &&
+        status != GST_VAAPI_DECODER_STATUS_END_OF_STREAM)
+        g_error("could not decode stream (status %d)", status);
+
+    gst_vaapi_decoder_get_error_stats(decoder, stats);
+    gst_vaapi_decoder_unref(decoder);
+    return g_string_free(str, FALSE);
+}
+
+static void
+check_error_concealment(GstVaapiDisplay *display)
+{
+    GstVaapiDecoderErrorStats stats;
+    gchar *flags, expected[NUM_PICTURES + 1];
+    guint8 *data;
+    gsize size;
+    guint i;
+
+    data = create_stream(TRUE, &size);
+    flags = decode_stream(display, TRUE, data, size, &stats);
+    g_free(data);
+
+    /* All pictures are output, the damaged ones included */
+    for (i = 0; i < NUM_PICTURES; i++)
+        expected[i] = g_pictures[i].is_corrupted ? 'C' : '.';
+    expected[i] = '\0';
+
+    g_print("error concealment: \"%s\", %u corrupted pictures, "
+        "%u recoveries (max %u pictures)\n", flags,
+        stats.num_corrupted_frames, stats.num_recoveries,
+        stats.max_recovery_frames);
+    if (strcmp(flags, expected) != 0)
+        g_error("got \"%s\", expected \"%s\"", flags, expected);
+    g_assert(stats.num_corrupted_frames == NUM_CORRUPTED_PICTURES);
+    g_assert(stats.num_recoveries == NUM_RECOVERIES);
+    g_assert(stats.max_recovery_frames == MAX_RECOVERY_PICTURES);
+    g_free(flags);
+}
+
+static void
+check_no_error_concealment(GstVaapiDisplay *display)
+{
+    GstVaapiDecoderErrorStats stats;
+    gchar *flags;
+    guint8 *data;
+    gsize size;
+
+    data = create_stream(FALSE, &size);
+    flags = decode_stream(display, FALSE, data, size, &stats);
+    g_free(data);
+
+    g_print("no error concealment: \"%s\"\n", flags);
+    if (strlen(flags) != NUM_PICTURES)
+        g_error("got %u pictures, expected %u", (guint)strlen(flags),
+            (guint)NUM_PICTURES);
+    if (strchr(flags, 'C'))
+        g_error("no picture shall be marked as corrupted");
+    g_assert(stats.num_corrupted_frames == 0);
+    g_assert(stats.num_recoveries == 0);
+    g_free(flags);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplay *display;
+    VADisplay va_display;
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+
+    check_error_concealment(display);
+    check_no_error_concealment(display);
+
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ *  test-h264-headers.c - Test H.264 packed headers generation
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test only exercises the CPU side of the H.264 encoder, i.e. no
+   VA display is needed: it checks the Exp-Golomb writer used for the
+   packed headers against the reference (bit-by-bit) implementation */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapiutils_h264_priv.h"
+
+/* Reference ue(v) writer, i.e. counts bits one at a time */
+static gboolean
+ref_write_ue(GstBitWriter *bs, guint32 value)
+{
+    guint32 size_in_bits = 0;
+    guint32 tmp_value = ++value;
+
+    while (tmp_value) {
+        ++size_in_bits;
+        tmp_value >>= 1;
+    }
+    if (size_in_bits > 1 &&
+        !gst_bit_writer_put_bits_uint32(bs, 0, size_in_bits - 1))
+        return FALSE;
+    if (!gst_bit_writer_put_bits_uint32(bs, value, size_in_bits))
+        return FALSE;
+    return TRUE;
+}
+
+/* Reference se(v) writer */
+static gboolean
+ref_write_se(GstBitWriter *bs, gint32 value)
+{
+    guint32 new_val;
+
+    if (value <= 0)
+        new_val = -(value << 1);
+    else
+        new_val = (value << 1) - 1;
+    return ref_write_ue(bs, new_val);
+}
+
+static gboolean
+check_same_bits(GstBitWriter *bs1, GstBitWriter *bs2)
+{
+    if (GST_BIT_WRITER_BIT_SIZE(bs1) != GST_BIT_WRITER_BIT_SIZE(bs2))
+        return FALSE;
+    return memcmp(GST_BIT_WRITER_DATA(bs1), GST_BIT_WRITER_DATA(bs2),
+        (GST_BIT_WRITER_BIT_SIZE(bs1) + 7) / 8) == 0;
+}
+
+static void
+check_exp_golomb(void)
+{
+    static const guint32 large_values[] = {
+        0xffffu, 0x10000u, 0x1fffeu, 0xffffffu, 0x1000000u,
+        0x7fffffffu, 0xfffffffeu
+    };
+    GstBitWriter bs1, bs2;
+    guint32 i;
+
+    for (i = 0; i < (1U << 18); i++) {
+        gst_bit_writer_init(&bs1, 128);
+        gst_bit_writer_init(&bs2, 128);
+
+        /* Misalign the writer so that codewords straddle bytes */
+        if (i % 8) {
+            gst_bit_writer_put_bits_uint32(&bs1, 1, i % 8);
+            gst_bit_writer_put_bits_uint32(&bs2, 1, i % 8);
+        }
+
+        if (!ref_write_ue(&bs1, i) ||
+            !gst_vaapi_utils_h264_write_ue(&bs2, i))
+            g_error("failed to write ue(v) for %u", i);
+        if (!ref_write_se(&bs1, (gint32)i - (1 << 17)) ||
+            !gst_vaapi_utils_h264_write_se(&bs2, (gint32)i - (1 << 17)))
+            g_error("failed to write se(v) for %d", (gint32)i - (1 << 17));
+        if (!check_same_bits(&bs1, &bs2))
+            g_error("mismatch for Exp-Golomb code of value %u", i);
+
+        gst_bit_writer_clear(&bs1, TRUE);
+        gst_bit_writer_clear(&bs2, TRUE);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(large_values); i++) {
+        gst_bit_writer_init(&bs1, 128);
+        gst_bit_writer_init(&bs2, 128);
+
+        if (!ref_write_ue(&bs1, large_values[i]) ||
+            !gst_vaapi_utils_h264_write_ue(&bs2, large_values[i]))
+            g_error("failed to write ue(v) for %u", large_values[i]);
+        if (!check_same_bits(&bs1, &bs2))
+            g_error("mismatch for Exp-Golomb code of value %u",
+                    large_values[i]);
+
+        gst_bit_writer_clear(&bs1, TRUE);
+        gst_bit_writer_clear(&bs2, TRUE);
+    }
+    g_print("Exp-Golomb writer matches the reference implementation\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+    check_exp_golomb();
+    return 0;
+}
@@ -0,0 +1,269 @@
+/*
+ *  test-h265-rps.c - Test H.265 reference picture set derivation
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test only exercises the CPU side of the H.265 decoder, i.e. no
+   VA display is needed: it checks the picture order count computation,
+   the reference picture set derivation and the reference picture lists
+   initialization, along with the tiles and scaling lists helpers */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapiutils_h265_priv.h"
+
+typedef struct {
+    guint       poc_lsb;
+    gboolean    reset_msb;
+    gboolean    update_prev;
+    gint32      expected;
+} PocTest;
+
+/* log2_max_pic_order_cnt_lsb = 4, i.e. MaxPicOrderCntLsb = 16 */
+static const PocTest g_poc_tests[] = {
+    {  0, TRUE,  TRUE,   0 },   /* IDR */
+    {  8, FALSE, TRUE,   8 },
+    {  4, FALSE, FALSE,  4 },   /* sub-layer non-reference picture */
+    {  0, FALSE, TRUE,  16 },   /* pic_order_cnt_lsb wraps around */
+    { 12, FALSE, FALSE, 12 },
+    {  8, FALSE, TRUE,  24 },
+    {  2, FALSE, TRUE,  18 },
+    { 14, FALSE, TRUE,  14 },   /* going backwards across the wrap */
+    {  6, TRUE,  TRUE,   6 },   /* CRA with NoRaslOutputFlag = 1 */
+    {  9, FALSE, TRUE,   9 },
+};
+
+static void
+check_poc(void)
+{
+    GstVaapiH265PocState state;
+    guint i;
+    gint32 poc;
+
+    gst_vaapi_utils_h265_poc_init(&state);
+    for (i = 0; i < G_N_ELEMENTS(g_poc_tests); i++) {
+        const PocTest * const t = &g_poc_tests[i];
+
+        poc = gst_vaapi_utils_h265_compute_poc(&state, 4, t->poc_lsb,
+            t->reset_msb, t->update_prev);
+        if (poc != t->expected)
+            g_error("picture %u: got POC %d, expected %d", i, poc,
+                t->expected);
+    }
+    g_print("POC: %u pictures checked\n", i);
+}
+
+static void
+check_poc_list(const gchar *name, const gint32 *pocs, guint num_pocs,
+    const gint32 *expected, guint num_expected)
+{
+    guint i;
+
+    if (num_pocs != num_expected)
+        g_error("%s: got %u pictures, expected %u", name, num_pocs,
+            num_expected);
+    for (i = 0; i < num_pocs; i++) {
+        if (pocs[i] != expected[i])
+            g_error("%s[%u]: got POC %d, expected %d", name, i, pocs[i],
+                expected[i]);
+    }
+}
+
+static void
+check_rps(void)
+{
+    static const gint32 st_curr_before[] = { 39, 37 };
+    static const gint32 st_curr_after[] = { 42 };
+    static const gint32 st_foll[] = { 35, 44 };
+    static const gint32 lt_curr[] = { 16, 18 };
+    static const gint32 lt_foll[] = { 4 };
+    GstVaapiH265ShortTermRps st_rps;
+    GstVaapiH265LongTermRef lt_refs[3];
+    GstVaapiH265RefPicSet rps;
+
+    memset(&st_rps, 0, sizeof(st_rps));
+    st_rps.num_negative_pics = 3;
+    st_rps.delta_poc_s0[0] = -1;
+    st_rps.used_by_curr_pic_s0[0] = 1;
+    st_rps.delta_poc_s0[1] = -3;
+    st_rps.used_by_curr_pic_s0[1] = 1;
+    st_rps.delta_poc_s0[2] = -5;
+    st_rps.num_positive_pics = 2;
+    st_rps.delta_poc_s1[0] = 2;
+    st_rps.used_by_curr_pic_s1[0] = 1;
+    st_rps.delta_poc_s1[1] = 4;
+
+    /* One long-term picture from the SPS candidates, and two from the
+       slice header: DeltaPocMsbCycleLt restarts with the latter ones */
+    memset(lt_refs, 0, sizeof(lt_refs));
+    lt_refs[0].poc_lsb_lt = 0;
+    lt_refs[0].used_by_curr_pic_lt = 1;
+    lt_refs[0].delta_poc_msb_present_flag = 1;
+    lt_refs[0].delta_poc_msb_cycle_lt = 1;
+    lt_refs[1].poc_lsb_lt = 4;
+    lt_refs[1].delta_poc_msb_present_flag = 0;
+    lt_refs[2].poc_lsb_lt = 2;
+    lt_refs[2].used_by_curr_pic_lt = 1;
+    lt_refs[2].delta_poc_msb_present_flag = 1;
+    lt_refs[2].delta_poc_msb_cycle_lt = 1;
+
+    gst_vaapi_utils_h265_derive_rps(&rps, 40, 4, &st_rps, lt_refs, 1, 2);
+
+    check_poc_list("PocStCurrBefore", rps.poc_st_curr_before,
+        rps.num_st_curr_before, st_curr_before, G_N_ELEMENTS(st_curr_before));
+    check_poc_list("PocStCurrAfter", rps.poc_st_curr_after,
+        rps.num_st_curr_after, st_curr_after, G_N_ELEMENTS(st_curr_after));
+    check_poc_list("PocStFoll", rps.poc_st_foll, rps.num_st_foll,
+        st_foll, G_N_ELEMENTS(st_foll));
+    check_poc_list("PocLtCurr", rps.poc_lt_curr, rps.num_lt_curr,
+        lt_curr, G_N_ELEMENTS(lt_curr));
+    check_poc_list("PocLtFoll", rps.poc_lt_foll, rps.num_lt_foll,
+        lt_foll, G_N_ELEMENTS(lt_foll));
+    if (!rps.curr_delta_poc_msb_present_flag[0] ||
+        !rps.curr_delta_poc_msb_present_flag[1] ||
+        rps.foll_delta_poc_msb_present_flag[0])
+        g_error("invalid delta_poc_msb_present_flag values");
+    g_print("RPS: short-term and long-term pictures checked\n");
+}
+
+typedef struct {
+    const gchar    *name;
+    gboolean        is_list1;
+    guint           num_active;
+    const guint8   *list_entry;
+    const gchar    *expected;
+} RefPicListTest;
+
+static const guint8 g_list_entry_l1[] = { 3, 0 };
+
+/* RPS with two StCurrBefore, one StCurrAfter and two LtCurr pictures,
+   i.e. indices 0-1, 2 and 3-4 */
+static const RefPicListTest g_ref_pic_list_tests[] = {
+    { "L0",                 FALSE, 3, NULL, "0 1 2" },
+    { "L0 (repeated)",      FALSE, 7, NULL, "0 1 2 3 4 0 1" },
+    { "L1",                 TRUE,  4, NULL, "2 0 1 3" },
+    { "L1 (modified)",      TRUE,  2, g_list_entry_l1, "3 2" },
+};
+
+static void
+check_ref_pic_list(const GstVaapiH265RefPicSet *rps,
+    const RefPicListTest *test)
+{
+    guint8 ref_list[GST_VAAPI_H265_MAX_RPS_PICS];
+    GString *str;
+    guint i, n;
+
+    n = gst_vaapi_utils_h265_init_ref_pic_list(ref_list, test->num_active,
+        rps, test->is_list1, test->list_entry);
+    if (n != test->num_active)
+        g_error("%s: got %u entries, expected %u", test->name, n,
+            test->num_active);
+
+    str = g_string_new(NULL);
+    for (i = 0; i < n; i++)
+        g_string_append_printf(str, "%s%u", i > 0 ? " " : "", ref_list[i]);
+    if (strcmp(str->str, test->expected) != 0)
+        g_error("%s: got \"%s\", expected \"%s\"", test->name, str->str,
+            test->expected);
+    g_print("%s: %s\n", test->name, str->str);
+    g_string_free(str, TRUE);
+}
+
+static void
+check_ref_pic_lists(void)
+{
+    GstVaapiH265RefPicSet rps;
+    guint8 ref_list[GST_VAAPI_H265_MAX_RPS_PICS];
+    guint i;
+
+    memset(&rps, 0, sizeof(rps));
+    if (gst_vaapi_utils_h265_init_ref_pic_list(ref_list, 2, &rps, FALSE,
+            NULL) != 0)
+        g_error("an empty RPS shall yield an empty list");
+
+    rps.num_st_curr_before = 2;
+    rps.num_st_curr_after = 1;
+    rps.num_lt_curr = 2;
+    for (i = 0; i < G_N_ELEMENTS(g_ref_pic_list_tests); i++)
+        check_ref_pic_list(&rps, &g_ref_pic_list_tests[i]);
+}
+
+static void
+check_tiles(void)
+{
+    static const guint16 expected[] = { 7, 8, 7, 8 };
+    guint16 sizes[G_N_ELEMENTS(expected)];
+    guint i;
+
+    gst_vaapi_utils_h265_get_uniform_tile_sizes(sizes, G_N_ELEMENTS(sizes),
+        30);
+    for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+        if (sizes[i] != expected[i])
+            g_error("tile %u: got %u CTBs, expected %u", i, sizes[i],
+                expected[i]);
+    }
+
+    if (gst_vaapi_utils_h265_get_max_entry_points(FALSE, FALSE, 1, 1, 17) != 0)
+        g_error("no entry points are allowed without tiles or WPP");
+    if (gst_vaapi_utils_h265_get_max_entry_points(FALSE, TRUE, 1, 1, 17) != 16)
+        g_error("invalid number of entry points for WPP");
+    if (gst_vaapi_utils_h265_get_max_entry_points(TRUE, FALSE, 4, 3, 17) != 11)
+        g_error("invalid number of entry points for tiles");
+    if (gst_vaapi_utils_h265_get_max_entry_points(TRUE, TRUE, 4, 3, 17) != 67)
+        g_error("invalid number of entry points for tiles and WPP");
+    g_print("tiles: uniform spacing and entry points checked\n");
+}
+
+static void
+check_scaling_lists(void)
+{
+    static const guint8 expected_4x4[16] = {
+        0, 2, 5, 9, 1, 4, 8, 12, 3, 7, 11, 14, 6, 10, 13, 15
+    };
+    guint8 in[64], out[64];
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(in); i++)
+        in[i] = i;
+
+    gst_vaapi_utils_h265_scaling_list_4x4_to_raster(out, in);
+    for (i = 0; i < G_N_ELEMENTS(expected_4x4); i++) {
+        if (out[i] != expected_4x4[i])
+            g_error("4x4 scaling list[%u]: got %u, expected %u", i, out[i],
+                expected_4x4[i]);
+    }
+
+    /* (x, y) = (7, 0) is the last position of the 8th anti-diagonal, and
+       (0, 7) the first one */
+    gst_vaapi_utils_h265_scaling_list_8x8_to_raster(out, in);
+    if (out[0] != 0 || out[1] != 2 || out[8] != 1 || out[7] != 35 ||
+        out[56] != 28 || out[63] != 63)
+        g_error("invalid 8x8 scaling list conversion");
+    g_print("scaling lists: up-right diagonal scans checked\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+    check_poc();
+    check_rps();
+    check_ref_pic_lists();
+    check_tiles();
+    check_scaling_lists();
+    return 0;
+}
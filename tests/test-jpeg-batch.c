@@ -0,0 +1,266 @@
+/*
+ *  test-jpeg-batch.c - Benchmark batched JPEG decoding
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Compares the throughput of one decoder per image, as a thumbnail
+   service would naively do, with the batched JPEG decoder. Images
+   of typical photo sizes are decoded by the stub VA driver, which
+   emulates the VA context creation and decode costs */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapidecoder_jpeg.h>
+#include <gst/vaapi/gstvaapidecoder_jpeg_batch.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include "stub-display.h"
+
+static gint g_num_images = 200;
+static gint g_batch_size = 16;
+static gint g_seed = 1;
+
+static GOptionEntry g_options[] = {
+    { "images", 'n',
+      0,
+      G_OPTION_ARG_INT, &g_num_images,
+      "number of images to decode", NULL },
+    { "batch-size", 'b',
+      0,
+      G_OPTION_ARG_INT, &g_batch_size,
+      "number of images submitted at once", NULL },
+    { "seed", 's',
+      0,
+      G_OPTION_ARG_INT, &g_seed,
+      "seed for the images sizes", NULL },
+    { NULL, }
+};
+
+static const struct {
+    guint width;
+    guint height;
+} g_image_sizes[] = {
+    { 4000, 3000 },
+    { 3000, 4000 },
+    { 3264, 2448 },
+    { 2592, 1944 },
+    { 1920, 1080 },
+    { 1600, 1200 },
+    { 1280,  720 },
+    {  640,  480 },
+};
+
+/* ------------------------------------------------------------------------- */
+/* --- Synthetic images                                                  --- */
+/* ------------------------------------------------------------------------- */
+
+/* Baseline 4:2:0 image relying on the default quantization and
+   Huffman tables. The entropy coded data is not meaningful */
+static GstBuffer *
+create_image(guint width, guint height)
+{
+    static const guint8 sof[] = {
+        0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x00, 0x00, 0x00, 0x03,
+        0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01
+    };
+    static const guint8 sos[] = {
+        0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11,
+        0x00, 0x3f, 0x00
+    };
+    const guint entropy_size = 256;
+    GstBuffer *buffer;
+    GstMapInfo map;
+    guint8 *p;
+
+    buffer = gst_buffer_new_allocate(NULL,
+        2 + sizeof(sof) + sizeof(sos) + entropy_size + 2, NULL);
+    if (!buffer || !gst_buffer_map(buffer, &map, GST_MAP_WRITE))
+        g_error("could not allocate image");
+
+    p = map.data;
+    *p++ = 0xff; *p++ = 0xd8;                   /* SOI */
+    memcpy(p, sof, sizeof(sof));
+    p[5] = height >> 8; p[6] = height & 0xff;
+    p[7] = width >> 8;  p[8] = width & 0xff;
+    p += sizeof(sof);
+    memcpy(p, sos, sizeof(sos));
+    p += sizeof(sos);
+    memset(p, 0, entropy_size);
+    p += entropy_size;
+    *p++ = 0xff; *p++ = 0xd9;                   /* EOI */
+
+    gst_buffer_unmap(buffer, &map);
+    return buffer;
+}
+
+static GstBuffer **
+create_images(guint num_images)
+{
+    GstBuffer **images;
+    GRand *rand;
+    guint i, n;
+
+    rand = g_rand_new_with_seed(g_seed);
+    images = g_new(GstBuffer *, num_images);
+    for (i = 0; i < num_images; i++) {
+        n = g_rand_int_range(rand, 0, G_N_ELEMENTS(g_image_sizes));
+        images[i] = create_image(g_image_sizes[n].width,
+            g_image_sizes[n].height);
+    }
+    g_rand_free(rand);
+    return images;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Benchmarks                                                        --- */
+/* ------------------------------------------------------------------------- */
+
+static gint64
+decode_one_by_one(GstVaapiDisplay *display, GstBuffer **images,
+    guint num_images)
+{
+    GstVaapiDecoder *decoder;
+    GstVaapiSurfaceProxy *proxy;
+    GstVaapiDecoderStatus status;
+    GstCaps *caps;
+    GstMapInfo map;
+    gint64 start_time;
+    guint i, width, height;
+
+    start_time = g_get_monotonic_time();
+    for (i = 0; i < num_images; i++) {
+        /* Dimensions from the SOF segment written by create_image() */
+        if (!gst_buffer_map(images[i], &map, GST_MAP_READ))
+            g_error("could not map image %u", i);
+        height = GST_READ_UINT16_BE(map.data + 7);
+        width = GST_READ_UINT16_BE(map.data + 9);
+        gst_buffer_unmap(images[i], &map);
+
+        caps = gst_caps_new_simple("image/jpeg",
+            "width", G_TYPE_INT, width,
+            "height", G_TYPE_INT, height, NULL);
+        decoder = gst_vaapi_decoder_jpeg_new(display, caps);
+        gst_caps_unref(caps);
+        if (!decoder)
+            g_error("could not create JPEG decoder");
+        gst_vaapi_decoder_jpeg_set_frame_aligned(
+            GST_VAAPI_DECODER_JPEG(decoder), TRUE);
+
+        if (!gst_vaapi_decoder_put_buffer(decoder, images[i]))
+            g_error("could not submit image %u", i);
+        status = gst_vaapi_decoder_get_surface(decoder, &proxy);
+        if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+            g_error("could not decode image %u (status %d)", i, status);
+        if (!gst_vaapi_surface_sync(gst_vaapi_surface_proxy_get_surface(proxy)))
+            g_error("could not sync image %u", i);
+
+        gst_vaapi_surface_proxy_unref(proxy);
+        gst_vaapi_decoder_unref(decoder);
+    }
+    return g_get_monotonic_time() - start_time;
+}
+
+static gint64
+decode_batched(GstVaapiDisplay *display, GstBuffer **images,
+    guint num_images)
+{
+    GstVaapiDecoderJpegBatch *batch;
+    GstVaapiSurfaceProxy *proxy;
+    GstVaapiDecoderStatus status;
+    gint64 start_time;
+    guint i, num_submitted = 0, num_decoded = 0, index;
+
+    start_time = g_get_monotonic_time();
+    batch = gst_vaapi_decoder_jpeg_batch_new(display, g_batch_size);
+    if (!batch)
+        g_error("could not create JPEG batch decoder");
+
+    while (num_decoded < num_images) {
+        num_submitted += gst_vaapi_decoder_jpeg_batch_submit(batch,
+            images + num_submitted, num_images - num_submitted);
+
+        /* Collect half of the batch, so that the next submission
+           overlaps with the decoding of the remaining images */
+        i = MAX(gst_vaapi_decoder_jpeg_batch_get_pending(batch) / 2, 1);
+        if (num_submitted == num_images)
+            i = gst_vaapi_decoder_jpeg_batch_get_pending(batch);
+        for (; i > 0; i--) {
+            status = gst_vaapi_decoder_jpeg_batch_get_surface(batch, &proxy,
+                &index);
+            if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+                g_error("could not decode image %u (status %d)", index, status);
+            gst_vaapi_surface_proxy_unref(proxy);
+            num_decoded++;
+        }
+    }
+    gst_vaapi_decoder_jpeg_batch_unref(batch);
+    return g_get_monotonic_time() - start_time;
+}
+
+static void
+print_result(const gchar *name, gint64 elapsed, guint num_images)
+{
+    g_print("%s: %u images in %" G_GINT64_FORMAT " us, %.1f images/s\n",
+        name, num_images, elapsed,
+        elapsed > 0 ? num_images * (gdouble)G_USEC_PER_SEC / elapsed : 0.0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GOptionContext *options;
+    GstVaapiDisplay *display;
+    VADisplay va_display;
+    GstBuffer **images;
+    gint64 elapsed_one, elapsed_batch;
+    guint i;
+
+    options = g_option_context_new(" - batched JPEG decoding benchmark");
+    g_option_context_add_main_entries(options, g_options, NULL);
+    if (!g_option_context_parse(options, &argc, &argv, NULL))
+        return 1;
+    g_option_context_free(options);
+    if (g_num_images <= 0 || g_batch_size <= 0)
+        g_error("invalid number of images or batch size");
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+
+    images = create_images(g_num_images);
+
+    elapsed_one = decode_one_by_one(display, images, g_num_images);
+    print_result("one decoder per image", elapsed_one, g_num_images);
+    elapsed_batch = decode_batched(display, images, g_num_images);
+    print_result("batched decoder", elapsed_batch, g_num_images);
+    if (elapsed_batch > 0)
+        g_print("speedup: %.2fx\n", (gdouble)elapsed_one / elapsed_batch);
+
+    for (i = 0; i < g_num_images; i++)
+        gst_buffer_unref(images[i]);
+    g_free(images);
+
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ *  test-jpeg-headers.c - Test JPEG encoder headers generation
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test only exercises the CPU side of the JPEG encoder, i.e. no
+   VA display is needed: it checks the quantization tables derived from
+   the quality factor, and parses back the headers written for each of
+   the supported image formats */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapiutils_jpeg_priv.h"
+
+/* ITU-T T.81, Annex K.1 and K.2, in natural order */
+static const guint8 g_annex_k_tables[2][64] = {
+    { 16,  11,  10,  16,  24,  40,  51,  61,
+      12,  12,  14,  19,  26,  58,  60,  55,
+      14,  13,  16,  24,  40,  57,  69,  56,
+      14,  17,  22,  29,  51,  87,  80,  62,
+      18,  22,  37,  56,  68, 109, 103,  77,
+      24,  35,  55,  64,  81, 104, 113,  92,
+      49,  64,  78,  87, 103, 121, 120, 101,
+      72,  92,  95,  98, 112, 100, 103,  99 },
+    { 17,  18,  24,  47,  99,  99,  99,  99,
+      18,  21,  26,  66,  99,  99,  99,  99,
+      24,  26,  56,  99,  99,  99,  99,  99,
+      47,  66,  99,  99,  99,  99,  99,  99,
+      99,  99,  99,  99,  99,  99,  99,  99,
+      99,  99,  99,  99,  99,  99,  99,  99,
+      99,  99,  99,  99,  99,  99,  99,  99,
+      99,  99,  99,  99,  99,  99,  99,  99 }
+};
+
+static guint8 g_zigzag_to_natural[64];
+
+/* Builds the zig-zag scan order by walking the anti-diagonals */
+static void
+init_zigzag(void)
+{
+    guint i = 0, s, k, row, row_min, row_max;
+
+    for (s = 0; s < 15; s++) {
+        row_min = s > 7 ? s - 7 : 0;
+        row_max = MIN(s, 7);
+        for (k = 0; k <= row_max - row_min; k++) {
+            /* Odd diagonals go down-left, even ones go up-right */
+            row = (s & 1) ? row_min + k : row_max - k;
+            g_zigzag_to_natural[i++] = row * 8 + (s - row);
+        }
+    }
+    g_assert(i == 64);
+}
+
+static guint
+ref_scale(guint value, guint quality)
+{
+    guint scale;
+
+    quality = CLAMP(quality, 1, 100);
+    scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+    value = (value * scale + 50) / 100;
+    return CLAMP(value, 1, 255);
+}
+
+static void
+check_quant_tables(void)
+{
+    static const guint qualities[] = { 0, 1, 10, 25, 50, 75, 90, 100, 200 };
+    guint8 table[64], prev_table[64];
+    guint i, j, k;
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < G_N_ELEMENTS(qualities); j++) {
+            gst_vaapi_utils_jpeg_get_quant_table(i, qualities[j], table);
+            for (k = 0; k < 64; k++) {
+                const guint value =
+                    g_annex_k_tables[i][g_zigzag_to_natural[k]];
+                if (table[k] != ref_scale(value, qualities[j]))
+                    g_error("table %u, quality %u: got %u at %u, expected %u",
+                        i, qualities[j], table[k], k,
+                        ref_scale(value, qualities[j]));
+            }
+        }
+
+        /* Quality 50 is Annex K, quality 100 is the identity */
+        gst_vaapi_utils_jpeg_get_quant_table(i, 50, table);
+        for (k = 0; k < 64; k++)
+            g_assert(table[k] == g_annex_k_tables[i][g_zigzag_to_natural[k]]);
+        gst_vaapi_utils_jpeg_get_quant_table(i, 100, table);
+        for (k = 0; k < 64; k++)
+            g_assert(table[k] == 1);
+
+        /* Higher quality never means coarser quantization */
+        gst_vaapi_utils_jpeg_get_quant_table(i, 1, prev_table);
+        for (j = 2; j <= 100; j++) {
+            gst_vaapi_utils_jpeg_get_quant_table(i, j, table);
+            for (k = 0; k < 64; k++)
+                g_assert(table[k] <= prev_table[k]);
+            memcpy(prev_table, table, sizeof(table));
+        }
+    }
+}
+
+static void
+check_huffman_tables(void)
+{
+    const GstVaapiJpegHuffmanTable *table;
+    guint i, j, k, num_values;
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            table = gst_vaapi_utils_jpeg_get_huffman_table(i, j);
+            g_assert(table != NULL);
+            for (k = 0, num_values = 0; k < 16; k++)
+                num_values += table->huf_bits[k];
+            g_assert(num_values == table->num_values);
+            g_assert(num_values == (i == 0 ? 12 : 162));
+        }
+    }
+}
+
+/* Walks through the marker segments and checks them against the
+   frame info the headers were generated from */
+static void
+check_headers(const guint8 *data, guint size,
+    const GstVaapiJpegFrameInfo *info)
+{
+    static const guint8 expected_markers[] = {
+        0xe0, 0xdb, 0xc0, 0xc4, 0xda
+    };
+    const guint num_tables = info->num_components > 1 ? 2 : 1;
+    guint i, j, ofs, length, num_values;
+    const guint8 *seg;
+
+    g_assert(size >= 4 && data[0] == 0xff && data[1] == 0xd8);
+    ofs = 2;
+
+    for (i = 0; i < G_N_ELEMENTS(expected_markers); i++) {
+        g_assert(ofs + 4 <= size);
+        g_assert(data[ofs] == 0xff && data[ofs + 1] == expected_markers[i]);
+        length = GST_READ_UINT16_BE(data + ofs + 2);
+        g_assert(ofs + 2 + length <= size);
+        seg = data + ofs + 4;
+
+        switch (expected_markers[i]) {
+        case 0xe0:                      /* APP0 */
+            g_assert(length == 16 && memcmp(seg, "JFIF", 5) == 0);
+            break;
+        case 0xdb:                      /* DQT */
+            g_assert(length == 2 + num_tables * 65);
+            for (j = 0; j < num_tables; j++) {
+                g_assert(seg[j * 65] == j);
+                g_assert(memcmp(seg + j * 65 + 1, info->quant_tables[j],
+                    64) == 0);
+            }
+            break;
+        case 0xc0:                      /* SOF0 */
+            g_assert(length == 8 + 3 * info->num_components);
+            g_assert(seg[0] == 8);
+            g_assert(GST_READ_UINT16_BE(seg + 1) == info->height);
+            g_assert(GST_READ_UINT16_BE(seg + 3) == info->width);
+            g_assert(seg[5] == info->num_components);
+            for (j = 0; j < info->num_components; j++) {
+                const GstVaapiJpegComponent * const comp =
+                    &info->components[j];
+                g_assert(seg[6 + j * 3] == comp->id);
+                g_assert(seg[7 + j * 3] ==
+                    ((comp->h_sampling << 4) | comp->v_sampling));
+                g_assert(seg[8 + j * 3] == comp->quant_table);
+            }
+            break;
+        case 0xc4:                      /* DHT */
+            for (j = 0, seg = data + ofs + 4; j < 2 * num_tables; j++) {
+                const guint table_class = j % 2, table_id = j / 2;
+                guint k;
+
+                g_assert(seg[0] == ((table_class << 4) | table_id));
+                for (k = 0, num_values = 0; k < 16; k++)
+                    num_values += seg[1 + k];
+                g_assert(num_values == (table_class == 0 ? 12 : 162));
+                seg += 17 + num_values;
+            }
+            g_assert(seg == data + ofs + 2 + length);
+            break;
+        case 0xda:                      /* SOS */
+            g_assert(length == 6 + 2 * info->num_components);
+            g_assert(seg[0] == info->num_components);
+            for (j = 0; j < info->num_components; j++) {
+                const GstVaapiJpegComponent * const comp =
+                    &info->components[j];
+                g_assert(seg[1 + j * 2] == comp->id);
+                g_assert(seg[2 + j * 2] ==
+                    ((comp->dc_table << 4) | comp->ac_table));
+            }
+            seg += 1 + 2 * info->num_components;
+            g_assert(seg[0] == 0 && seg[1] == 63 && seg[2] == 0);
+            break;
+        }
+        ofs += 2 + length;
+    }
+
+    /* The entropy coded data is generated by the hardware */
+    g_assert(ofs == size);
+}
+
+static void
+check_frame(guint width, guint height, GstVaapiChromaType chroma_type,
+    guint quality, guint num_components, guint h_sampling, guint v_sampling)
+{
+    GstVaapiJpegFrameInfo info;
+    GstBitWriter bs;
+    guint8 table[64];
+
+    if (!gst_vaapi_utils_jpeg_frame_info_init(&info, width, height,
+            chroma_type, quality))
+        g_error("could not initialize %ux%u frame info", width, height);
+
+    g_assert(info.num_components == num_components);
+    g_assert(info.components[0].h_sampling == h_sampling);
+    g_assert(info.components[0].v_sampling == v_sampling);
+    gst_vaapi_utils_jpeg_get_quant_table(0, quality, table);
+    g_assert(memcmp(info.quant_tables[0], table, 64) == 0);
+
+    gst_bit_writer_init(&bs, 1024 * 8);
+    if (!gst_vaapi_utils_jpeg_write_headers(&bs, &info))
+        g_error("could not write %ux%u headers", width, height);
+    g_assert(GST_BIT_WRITER_BIT_SIZE(&bs) % 8 == 0);
+    check_headers(GST_BIT_WRITER_DATA(&bs), GST_BIT_WRITER_BIT_SIZE(&bs) / 8,
+        &info);
+    gst_bit_writer_clear(&bs, TRUE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiJpegFrameInfo info;
+
+    init_zigzag();
+
+    check_quant_tables();
+    check_huffman_tables();
+
+    check_frame(1920, 1080, GST_VAAPI_CHROMA_TYPE_YUV420, 50, 3, 2, 2);
+    check_frame(  17,   13, GST_VAAPI_CHROMA_TYPE_YUV422, 90, 3, 2, 1);
+    check_frame(4000, 3000, GST_VAAPI_CHROMA_TYPE_YUV444, 100, 3, 1, 1);
+    check_frame(  64,   64, GST_VAAPI_CHROMA_TYPE_YUV400, 1, 1, 1, 1);
+    check_frame(65535, 1, GST_VAAPI_CHROMA_TYPE_YUV420, 75, 3, 2, 2);
+
+    /* Unsupported configurations */
+    g_assert(!gst_vaapi_utils_jpeg_frame_info_init(&info, 0, 16,
+                 GST_VAAPI_CHROMA_TYPE_YUV420, 50));
+    g_assert(!gst_vaapi_utils_jpeg_frame_info_init(&info, 65536, 16,
+                 GST_VAAPI_CHROMA_TYPE_YUV420, 50));
+    g_assert(!gst_vaapi_utils_jpeg_frame_info_init(&info, 16, 16,
+                 GST_VAAPI_CHROMA_TYPE_YUV411, 50));
+
+    g_print("JPEG headers generation: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ *  test-memory-budget.c - Test the video memory budget of VA displays
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Allocates surfaces from two pools of the stub VA display, and checks
+   the memory accounting of the display. Idle surfaces of the least
+   recently used pool shall be released first, whenever the budget is
+   exceeded or idle memory is trimmed explicitly, while surfaces in use
+   shall never be released */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapisurfacepool.h>
+#include "stub-display.h"
+
+/* Estimated size of 4:2:0 surfaces */
+#define SMALL_WIDTH     320
+#define SMALL_HEIGHT    240
+#define SMALL_SIZE      (SMALL_WIDTH * SMALL_HEIGHT * 3 / 2)
+#define LARGE_WIDTH     640
+#define LARGE_HEIGHT    480
+#define LARGE_SIZE      (LARGE_WIDTH * LARGE_HEIGHT * 3 / 2)
+
+#define NUM_SMALL       4
+#define NUM_LARGE       2
+
+static GstVaapiDisplay *g_display;
+static GstVaapiDisplayMemoryStats g_base_stats;
+
+static GstVaapiVideoPool *
+create_pool(GstVideoFormat format, guint width, guint height)
+{
+    GstVaapiVideoPool *pool;
+    GstVideoInfo vi;
+
+    gst_video_info_init(&vi);
+    gst_video_info_set_format(&vi, format, width, height);
+    pool = gst_vaapi_surface_pool_new(g_display, &vi);
+    if (!pool)
+        g_error("could not create %ux%u surface pool", width, height);
+    return pool;
+}
+
+static void
+get_surfaces(GstVaapiVideoPool *pool, gpointer *surfaces, guint n)
+{
+    guint i;
+
+    for (i = 0; i < n; i++) {
+        surfaces[i] = gst_vaapi_video_pool_get_object(pool);
+        if (!surfaces[i])
+            g_error("could not allocate surface %u", i);
+    }
+}
+
+/* Waits for the monotonic clock to tick, so that the pool used next
+   gets a later usage time, whatever the clock resolution */
+static void
+wait_for_clock_tick(void)
+{
+    const gint64 last_time = g_get_monotonic_time();
+
+    while (g_get_monotonic_time() <= last_time)
+        g_thread_yield();
+}
+
+static void
+put_surfaces(GstVaapiVideoPool *pool, gpointer *surfaces, guint n)
+{
+    guint i;
+
+    for (i = 0; i < n; i++)
+        gst_vaapi_video_pool_put_object(pool, surfaces[i]);
+
+    /* The pool usage time was sampled before this point */
+    wait_for_clock_tick();
+}
+
+/* Checks the statistics, relative to the ones of the bare display */
+static void
+check_stats(const gchar *what, guint64 used_bytes, guint64 idle_bytes,
+    guint64 trimmed_bytes, guint num_trims)
+{
+    GstVaapiDisplayMemoryStats stats;
+
+    gst_vaapi_display_get_memory_stats(g_display, &stats);
+    stats.used_bytes -= g_base_stats.used_bytes;
+    stats.idle_bytes -= g_base_stats.idle_bytes;
+    stats.trimmed_bytes -= g_base_stats.trimmed_bytes;
+    stats.num_trims -= g_base_stats.num_trims;
+
+    g_print("%s: used %" G_GUINT64_FORMAT ", idle %" G_GUINT64_FORMAT
+        ", trimmed %" G_GUINT64_FORMAT " bytes in %u trims\n", what,
+        stats.used_bytes, stats.idle_bytes, stats.trimmed_bytes,
+        stats.num_trims);
+
+    if (stats.used_bytes != used_bytes)
+        g_error("%s: got %" G_GUINT64_FORMAT " used bytes, expected %"
+            G_GUINT64_FORMAT, what, stats.used_bytes, used_bytes);
+    if (stats.idle_bytes != idle_bytes)
+        g_error("%s: got %" G_GUINT64_FORMAT " idle bytes, expected %"
+            G_GUINT64_FORMAT, what, stats.idle_bytes, idle_bytes);
+    if (stats.trimmed_bytes != trimmed_bytes)
+        g_error("%s: got %" G_GUINT64_FORMAT " trimmed bytes, expected %"
+            G_GUINT64_FORMAT, what, stats.trimmed_bytes, trimmed_bytes);
+    if (stats.num_trims != num_trims)
+        g_error("%s: got %u trims, expected %u", what, stats.num_trims,
+            num_trims);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiVideoPool *small_pool, *large_pool;
+    gpointer small_surfaces[NUM_SMALL], large_surfaces[NUM_LARGE];
+    GstVaapiDisplayMemoryStats stats;
+    guint64 budget, bytes;
+
+    gst_init(&argc, &argv);
+
+    /* The budget is not bounded by default */
+    g_unsetenv("GST_VAAPI_MEMORY_BUDGET");
+    g_display = stub_display_new();
+    if (!g_display)
+        g_error("could not create stub VA display");
+    gst_vaapi_display_get_memory_stats(g_display, &g_base_stats);
+    if (g_base_stats.budget != 0)
+        g_error("unexpected default memory budget");
+
+    /* Accounting */
+    small_pool = create_pool(GST_VIDEO_FORMAT_I420, SMALL_WIDTH, SMALL_HEIGHT);
+    large_pool = create_pool(GST_VIDEO_FORMAT_NV12, LARGE_WIDTH, LARGE_HEIGHT);
+    gst_vaapi_display_get_memory_stats(g_display, &stats);
+    if (stats.num_pools != g_base_stats.num_pools + 2)
+        g_error("got %u video pools, expected %u", stats.num_pools,
+            g_base_stats.num_pools + 2);
+
+    get_surfaces(small_pool, small_surfaces, NUM_SMALL);
+    get_surfaces(large_pool, large_surfaces, NUM_LARGE);
+    check_stats("allocate", NUM_SMALL * SMALL_SIZE + NUM_LARGE * LARGE_SIZE,
+        0, 0, 0);
+
+    /* The small pool is the least recently used one */
+    put_surfaces(small_pool, &small_surfaces[1], NUM_SMALL - 1);
+    put_surfaces(large_pool, &large_surfaces[1], NUM_LARGE - 1);
+    check_stats("release", SMALL_SIZE + LARGE_SIZE,
+        (NUM_SMALL - 1) * SMALL_SIZE + (NUM_LARGE - 1) * LARGE_SIZE, 0, 0);
+
+    /* Explicit trim, idle surfaces of the small pool go first */
+    gst_vaapi_display_get_memory_stats(g_display, &stats);
+    bytes = gst_vaapi_display_trim_memory(g_display,
+        stats.used_bytes + stats.idle_bytes + stats.cached_bytes - SMALL_SIZE);
+    if (bytes != SMALL_SIZE)
+        g_error("trimmed %" G_GUINT64_FORMAT " bytes, expected %u", bytes,
+            SMALL_SIZE);
+    check_stats("trim", SMALL_SIZE + LARGE_SIZE,
+        (NUM_SMALL - 2) * SMALL_SIZE + (NUM_LARGE - 1) * LARGE_SIZE,
+        SMALL_SIZE, 1);
+
+    /* Over budget, idle surfaces are released, but not the used ones */
+    budget = g_base_stats.used_bytes + g_base_stats.idle_bytes +
+        g_base_stats.cached_bytes + SMALL_SIZE + LARGE_SIZE;
+    gst_vaapi_display_set_memory_budget(g_display, budget);
+    if (gst_vaapi_display_get_memory_budget(g_display) != budget)
+        g_error("memory budget was not set");
+    check_stats("budget", SMALL_SIZE + LARGE_SIZE, 0,
+        (NUM_SMALL - 1) * SMALL_SIZE + (NUM_LARGE - 1) * LARGE_SIZE, 2);
+
+    /* The budget is a soft limit: allocations still succeed */
+    get_surfaces(small_pool, &small_surfaces[1], 1);
+    check_stats("exceed", 2 * SMALL_SIZE + LARGE_SIZE, 0,
+        (NUM_SMALL - 1) * SMALL_SIZE + (NUM_LARGE - 1) * LARGE_SIZE, 2);
+
+    /* Releasing all idle memory leaves the used surfaces alone */
+    put_surfaces(small_pool, &small_surfaces[1], 1);
+    gst_vaapi_display_set_memory_budget(g_display, 0);
+    bytes = gst_vaapi_display_trim_memory(g_display, 0);
+    if (bytes != SMALL_SIZE)
+        g_error("trimmed %" G_GUINT64_FORMAT " bytes, expected %u", bytes,
+            SMALL_SIZE);
+    check_stats("trim all", SMALL_SIZE + LARGE_SIZE, 0,
+        NUM_SMALL * SMALL_SIZE + (NUM_LARGE - 1) * LARGE_SIZE, 3);
+
+    gst_vaapi_display_get_memory_stats(g_display, &stats);
+    if (stats.budget != 0)
+        g_error("memory budget was not reset");
+
+    put_surfaces(small_pool, small_surfaces, 1);
+    put_surfaces(large_pool, large_surfaces, 1);
+    gst_vaapi_video_pool_unref(small_pool);
+    gst_vaapi_video_pool_unref(large_pool);
+    gst_vaapi_display_get_memory_stats(g_display, &stats);
+    if (stats.num_pools != g_base_stats.num_pools)
+        g_error("video pools were not unregistered");
+
+    gst_vaapi_display_unref(g_display);
+    gst_deinit();
+    return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ *  test-mpeg2-concealment.c - Test MPEG-2 error concealment
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Decodes a synthetic MPEG-2 stream with the stub VA driver, after it
+   was damaged the way a transport stream glitch would: the leading I
+   picture is lost, some pictures miss slices, and one slice header is
+   truncated. With error concealment enabled, every picture shall still
+   be output, the damaged ones being marked as corrupted until the next
+   clean I picture, and none shall be predicted from its own surface.
+   With error concealment disabled, no picture shall be marked as such */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/base/gstbitwriter.h>
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapidecoder_mpeg2.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include "stub-display.h"
+
+#define PICTURE_WIDTH           720
+#define PICTURE_HEIGHT          576
+#define NUM_SLICES              ((PICTURE_HEIGHT + 15) / 16)
+#define MB_DATA_SIZE            32
+
+#define PICTURE_TYPE_I          1
+#define PICTURE_TYPE_P          2
+
+typedef struct {
+    guint       type;           /* picture_coding_type */
+    guint       first_missing;  /* first slice dropped from the stream */
+    guint       num_missing;    /* number of slices dropped */
+    gint        broken_slice;   /* slice with a truncated header, or -1 */
+    gboolean    is_corrupted;   /* expected output flag */
+} PictureTest;
+
+/* The I picture preceding the first P picture was lost */
+static const PictureTest g_pictures[] = {
+    { PICTURE_TYPE_P,  0,  0, -1, TRUE  },  /* missing reference */
+    { PICTURE_TYPE_P,  0,  0, -1, TRUE  },  /* corrupted reference */
+    { PICTURE_TYPE_I, 10, 10, -1, TRUE  },  /* missing slices */
+    { PICTURE_TYPE_I,  0,  0, 20, TRUE  },  /* broken slice */
+    { PICTURE_TYPE_I,  0,  0, -1, FALSE },
+    { PICTURE_TYPE_P,  0,  0, -1, FALSE },
+    { PICTURE_TYPE_I, 30,  6, -1, TRUE  },  /* missing trailing slices */
+    { PICTURE_TYPE_I,  0,  0, -1, FALSE },
+};
+
+#define NUM_PICTURES            G_N_ELEMENTS(g_pictures)
+#define NUM_CORRUPTED_PICTURES  5
+#define NUM_CONCEALED_REFS      1
+#define NUM_RECOVERIES          2
+#define MAX_RECOVERY_PICTURES   4
+
+/* ------------------------------------------------------------------------- */
+/* --- Synthetic stream                                                  --- */
+/* ------------------------------------------------------------------------- */
+
+static void
+put_bits(GstBitWriter *bw, guint32 value, guint nbits)
+{
+    if (!gst_bit_writer_put_bits_uint32(bw, value, nbits))
+        g_error("could not write %u bits", nbits);
+}
+
+static void
+put_start_code(GstBitWriter *bw, guint8 code)
+{
+    gst_bit_writer_align_bytes(bw, 0);
+    put_bits(bw, 0x000001, 24);
+    put_bits(bw, code, 8);
+}
+
+static void
+write_sequence_headers(GstBitWriter *bw)
+{
+    /* sequence_header() */
+    put_start_code(bw, 0xb3);
+    put_bits(bw, PICTURE_WIDTH, 12);
+    put_bits(bw, PICTURE_HEIGHT, 12);
+    put_bits(bw, 2, 4);                         /* aspect_ratio (4:3) */
+    put_bits(bw, 3, 4);                         /* frame_rate_code (25) */
+    put_bits(bw, 20000, 18);                    /* bit_rate_value */
+    put_bits(bw, 1, 1);                         /* marker_bit */
+    put_bits(bw, 112, 10);                      /* vbv_buffer_size_value */
+    put_bits(bw, 0, 1);                         /* constrained_parameters */
+    put_bits(bw, 0, 1);                         /* load_intra_quantiser_matrix */
+    put_bits(bw, 0, 1);                         /* load_non_intra_quantiser_matrix */
+
+    /* sequence_extension(), Main profile @ Main level */
+    put_start_code(bw, 0xb5);
+    put_bits(bw, 1, 4);
+    put_bits(bw, 0x48, 8);                      /* profile_and_level */
+    put_bits(bw, 1, 1);                         /* progressive_sequence */
+    put_bits(bw, 1, 2);                         /* chroma_format (4:2:0) */
+    put_bits(bw, 0, 2);                         /* horizontal_size_extension */
+    put_bits(bw, 0, 2);                         /* vertical_size_extension */
+    put_bits(bw, 0, 12);                        /* bit_rate_extension */
+    put_bits(bw, 1, 1);                         /* marker_bit */
+    put_bits(bw, 0, 8);                         /* vbv_buffer_size_extension */
+    put_bits(bw, 1, 1);                         /* low_delay */
+    put_bits(bw, 0, 2);                         /* frame_rate_extension_n */
+    put_bits(bw, 0, 5);                         /* frame_rate_extension_d */
+
+    /* group_of_pictures_header() */
+    put_start_code(bw, 0xb8);
+    put_bits(bw, 1 << 12, 25);                  /* time_code, marker_bit */
+    put_bits(bw, 0, 1);                         /* closed_gop */
+    put_bits(bw, 1, 1);                         /* broken_link */
+}
+
+/* Writes a frame picture, without the slices that were lost. The
+   macroblock data is filled in with a pattern that cannot emulate start
+   codes, since it is not looked at by the stub driver */
+static void
+write_picture(GstBitWriter *bw, guint temporal_reference,
+    const PictureTest *test)
+{
+    guint i, j;
+
+    /* picture_header() */
+    put_start_code(bw, 0x00);
+    put_bits(bw, temporal_reference, 10);
+    put_bits(bw, test->type, 3);                /* picture_coding_type */
+    put_bits(bw, 0xffff, 16);                   /* vbv_delay */
+    if (test->type == PICTURE_TYPE_P) {
+        put_bits(bw, 0, 1);                     /* full_pel_forward_vector */
+        put_bits(bw, 7, 3);                     /* forward_f_code */
+    }
+    put_bits(bw, 0, 1);                         /* extra_bit_picture */
+
+    /* picture_coding_extension() */
+    put_start_code(bw, 0xb5);
+    put_bits(bw, 8, 4);
+    put_bits(bw, test->type == PICTURE_TYPE_P ? 0x11ff : 0xffff, 16);
+    put_bits(bw, 0, 2);                         /* intra_dc_precision */
+    put_bits(bw, 3, 2);                         /* picture_structure (frame) */
+    put_bits(bw, 0, 1);                         /* top_field_first */
+    put_bits(bw, 1, 1);                         /* frame_pred_frame_dct */
+    put_bits(bw, 0, 1);                         /* concealment_motion_vectors */
+    put_bits(bw, 0, 1);                         /* q_scale_type */
+    put_bits(bw, 0, 1);                         /* intra_vlc_format */
+    put_bits(bw, 0, 1);                         /* alternate_scan */
+    put_bits(bw, 0, 1);                         /* repeat_first_field */
+    put_bits(bw, 1, 1);                         /* chroma_420_type */
+    put_bits(bw, 1, 1);                         /* progressive_frame */
+    put_bits(bw, 0, 1);                         /* composite_display_flag */
+
+    /* slice(), one per macroblock row */
+    for (i = 0; i < NUM_SLICES; i++) {
+        if (i >= test->first_missing &&
+            i < test->first_missing + test->num_missing)
+            continue;
+
+        put_start_code(bw, i + 1);
+        if ((gint)i == test->broken_slice)
+            continue;
+        put_bits(bw, 1 + i % 31, 5);            /* quantiser_scale_code */
+        put_bits(bw, 0, 1);                     /* extra_bit_slice */
+        put_bits(bw, 1, 1);                     /* macroblock_address_increment */
+        for (j = 0; j < MB_DATA_SIZE; j++)
+            put_bits(bw, 0xaa, 8);
+    }
+}
+
+/* Creates the damaged stream. The picture with a broken slice is
+   optionally left out, since the parser error it raises is only
+   recovered from in error concealment mode */
+static guint8 *
+create_stream(gboolean with_broken_slice, gsize *size_ptr,
+    guint *num_pictures_ptr)
+{
+    GstBitWriter bw;
+    guint8 *data;
+    guint i, num_pictures = 0;
+
+    gst_bit_writer_init(&bw, NUM_PICTURES * NUM_SLICES * 64 * 8);
+    write_sequence_headers(&bw);
+    for (i = 0; i < NUM_PICTURES; i++) {
+        if (g_pictures[i].broken_slice >= 0 && !with_broken_slice)
+            continue;
+        write_picture(&bw, num_pictures++, &g_pictures[i]);
+    }
+    put_start_code(&bw, 0xb7);                  /* sequence_end_code */
+
+    *size_ptr = GST_BIT_WRITER_BIT_SIZE(&bw) / 8;
+    *num_pictures_ptr = num_pictures;
+    data = g_memdup(GST_BIT_WRITER_DATA(&bw), *size_ptr);
+    gst_bit_writer_clear(&bw, TRUE);
+    return data;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Reference tracking                                                --- */
+/* ------------------------------------------------------------------------- */
+
+/* Pictures shall never be predicted from their own surface, i.e. a lost
+   reference picture is not substituted with the picture being decoded */
+typedef struct {
+    VASurfaceID render_target;
+    VABufferID  pic_param_id;
+    guint       num_pictures;
+    guint       num_self_refs;
+} ReferenceStats;
+
+static ReferenceStats g_refs;
+
+static VAStatus (*g_begin_picture)(VADriverContextP ctx, VAContextID context,
+    VASurfaceID render_target);
+static VAStatus (*g_create_buffer)(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id);
+static VAStatus (*g_render_picture)(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers);
+
+static VAStatus
+track_BeginPicture(VADriverContextP ctx, VAContextID context,
+    VASurfaceID render_target)
+{
+    g_refs.render_target = render_target;
+    return g_begin_picture(ctx, context, render_target);
+}
+
+static VAStatus
+track_CreateBuffer(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id)
+{
+    VAStatus status;
+
+    status = g_create_buffer(ctx, context, type, size, num_elements, data,
+        buf_id);
+    if (status == VA_STATUS_SUCCESS && type == VAPictureParameterBufferType)
+        g_refs.pic_param_id = *buf_id;
+    return status;
+}
+
+/* Checks the picture parameters once they are filled in, i.e. when they
+   are submitted, since they are created uninitialized and mapped */
+static void
+check_pic_param(VADriverContextP ctx, VABufferID buf_id)
+{
+    const VAPictureParameterBufferMPEG2 *pic_param;
+    void *data;
+
+    if (ctx->vtable->vaMapBuffer(ctx, buf_id, &data) != VA_STATUS_SUCCESS)
+        g_error("could not map picture parameters");
+    pic_param = data;
+    if (pic_param->forward_reference_picture == g_refs.render_target ||
+        pic_param->backward_reference_picture == g_refs.render_target)
+        g_refs.num_self_refs++;
+    g_refs.num_pictures++;
+    ctx->vtable->vaUnmapBuffer(ctx, buf_id);
+}
+
+static VAStatus
+track_RenderPicture(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers)
+{
+    int i;
+
+    for (i = 0; i < num_buffers; i++) {
+        if (buffers[i] == g_refs.pic_param_id)
+            check_pic_param(ctx, buffers[i]);
+    }
+    return g_render_picture(ctx, context, buffers, num_buffers);
+}
+
+/* Intercepts pictures submission, once the driver is loaded */
+static void
+track_references(VADisplay va_display)
+{
+    VADriverContextP const ctx = stub_display_get_driver_context(va_display);
+
+    g_begin_picture = ctx->vtable->vaBeginPicture;
+    ctx->vtable->vaBeginPicture = track_BeginPicture;
+    g_create_buffer = ctx->vtable->vaCreateBuffer;
+    ctx->vtable->vaCreateBuffer = track_CreateBuffer;
+    g_render_picture = ctx->vtable->vaRenderPicture;
+    ctx->vtable->vaRenderPicture = track_RenderPicture;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Decoding                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+/* Decodes the stream and returns the corrupted flag of each output
+   picture, as a string of 'C' (corrupted) and '.' (clean) characters */
+static gchar *
+decode_stream(GstVaapiDisplay *display, gboolean error_concealment,
+    const guint8 *data, gsize size, GstVaapiDecoderErrorStats *stats)
+{
+    GstVaapiDecoder *decoder;
+    GstVaapiDecoderStatus status;
+    GstVaapiSurfaceProxy *proxy;
+    GstBuffer *buffer;
+    GstCaps *caps;
+    GString *str;
+
+    caps = gst_caps_new_simple("video/mpeg",
+        "mpegversion", G_TYPE_INT, 2,
+        "systemstream", G_TYPE_BOOLEAN, FALSE,
+        NULL);
+    decoder = gst_vaapi_decoder_mpeg2_new(display, caps);
+    gst_caps_unref(caps);
+    if (!decoder)
+        g_error("could not create MPEG-2 decoder");
+    gst_vaapi_decoder_set_error_concealment(decoder, error_concealment);
+
+    buffer = gst_buffer_new_allocate(NULL, size, NULL);
+    gst_buffer_fill(buffer, 0, data, size);
+    if (!gst_vaapi_decoder_put_buffer(decoder, buffer))
+        g_error("could not submit stream");
+    gst_buffer_unref(buffer);
+    if (!gst_vaapi_decoder_put_buffer(decoder, NULL))
+        g_error("could not submit end-of-stream");
+
+    str = g_string_new(NULL);
+    while ((status = gst_vaapi_decoder_get_surface(decoder, &proxy)) ==
+           GST_VAAPI_DECODER_STATUS_SUCCESS) {
+        const guint flags = gst_vaapi_surface_proxy_get_flags(proxy);
+        g_string_append_c(str,
+            (flags & GST_VAAPI_SURFACE_PROXY_FLAG_CORRUPTED) ? 'C' : '.');
+        gst_vaapi_surface_proxy_unref(proxy);
+    }
+    if (status != GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA &&
+        status != GST_VAAPI_DECODER_STATUS_END_OF_STREAM)
+        g_error("could not decode stream (status %d)", status);
+
+    gst_vaapi_decoder_get_error_stats(decoder, stats);
+    gst_vaapi_decoder_unref(decoder);
+    return g_string_free(str, FALSE);
+}
+
+static void
+check_error_concealment(GstVaapiDisplay *display)
+{
+    GstVaapiDecoderErrorStats stats;
+    gchar *flags, expected[NUM_PICTURES + 1];
+    guint8 *data;
+    gsize size;
+    guint i, num_pictures;
+
+    memset(&g_refs, 0, sizeof(g_refs));
+    data = create_stream(TRUE, &size, &num_pictures);
+    flags = decode_stream(display, TRUE, data, size, &stats);
+    g_free(data);
+
+    /* All pictures are output, the damaged ones included */
+    for (i = 0; i < num_pictures; i++)
+        expected[i] = g_pictures[i].is_corrupted ? 'C' : '.';
+    expected[i] = '\0';
+
+    g_print("error concealment: \"%s\", %u corrupted pictures, "
+        "%u concealed references, %u recoveries (max %u pictures)\n",
+        flags, stats.num_corrupted_frames, stats.num_concealed_refs,
+        stats.num_recoveries, stats.max_recovery_frames);
+    if (strcmp(flags, expected) != 0)
+        g_error("got \"%s\", expected \"%s\"", flags, expected);
+    g_assert(stats.num_corrupted_frames == NUM_CORRUPTED_PICTURES);
+    g_assert(stats.num_concealed_refs == NUM_CONCEALED_REFS);
+    g_assert(stats.num_recoveries == NUM_RECOVERIES);
+    g_assert(stats.max_recovery_frames == MAX_RECOVERY_PICTURES);
+    g_assert(g_refs.num_pictures > 0);
+    if (g_refs.num_self_refs > 0)
+        g_error("%u pictures were predicted from themselves",
+            g_refs.num_self_refs);
+    g_free(flags);
+}
+
+static void
+check_no_error_concealment(GstVaapiDisplay *display)
+{
+    GstVaapiDecoderErrorStats stats;
+    gchar *flags;
+    guint8 *data;
+    gsize size;
+    guint num_pictures;
+
+    data = create_stream(FALSE, &size, &num_pictures);
+    flags = decode_stream(display, FALSE, data, size, &stats);
+    g_free(data);
+
+    g_print("no error concealment: \"%s\"\n", flags);
+    if (strlen(flags) != num_pictures)
+        g_error("got %u pictures, expected %u", (guint)strlen(flags),
+            num_pictures);
+    if (strchr(flags, 'C'))
+        g_error("no picture shall be marked as corrupted");
+    g_assert(stats.num_corrupted_frames == 0);
+    g_assert(stats.num_concealed_refs == 0);
+    g_assert(stats.num_recoveries == 0);
+    g_free(flags);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplay *display;
+    VADisplay va_display;
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+    track_references(va_display);
+
+    check_error_concealment(display);
+    check_no_error_concealment(display);
+
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ *  test-mpeg2-gop.c - Test MPEG-2 encoder GOP structure
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test only exercises the CPU side of the MPEG-2 encoder, i.e. no
+   VA display is needed: it checks the picture types, coding order and
+   temporal references determined for frames submitted in display order.
+   Each output frame is described as <type><display index>:<temporal ref> */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapiutils_mpeg2_priv.h"
+
+typedef struct {
+    const gchar *name;
+    guint        gop_size;
+    guint        num_bframes;
+    gboolean     closed_gop;
+    guint        num_frames;
+    gint         keyframe;      /* forced key frame, or -1 */
+    const gchar *expected;
+} GopTest;
+
+static const GopTest g_gop_tests[] = {
+    { "closed GOP", 12, 2, TRUE, 14, -1,
+      "I0:0 P3:3 B1:1 B2:2 P6:6 B4:4 B5:5 P9:9 B7:7 B8:8 P11:11 B10:10 "
+      "I12:0 P13:1" },
+    { "open GOP", 12, 2, FALSE, 14, -1,
+      "I0:0 P3:3 B1:1 B2:2 P6:6 B4:4 B5:5 P9:9 B7:7 B8:8 I12:2 B10:0 "
+      "B11:1 P13:3" },
+    { "forced key frame", 0, 2, TRUE, 8, 5,
+      "I0:0 P3:3 B1:1 B2:2 P4:4 I5:0 P7:2 B6:1" },
+    { "no B-frames", 4, 0, TRUE, 6, -1,
+      "I0:0 P1:1 P2:2 P3:3 I4:0 P5:1" },
+    { "many B-frames", 0, 5, TRUE, 8, -1,
+      "I0:0 P6:6 B1:1 B2:2 B3:3 B4:4 B5:5 P7:7" },
+};
+
+static guint g_num_destroyed;
+
+static void
+destroy_frame(gpointer data)
+{
+    g_num_destroyed++;
+}
+
+static gchar
+picture_type_char(GstMpegVideoPictureType type)
+{
+    switch (type) {
+    case GST_MPEG_VIDEO_PICTURE_TYPE_I: return 'I';
+    case GST_MPEG_VIDEO_PICTURE_TYPE_P: return 'P';
+    case GST_MPEG_VIDEO_PICTURE_TYPE_B: return 'B';
+    default: break;
+    }
+    return '?';
+}
+
+/* Retrieves all frames available for encoding, and appends them to str */
+static void
+pop_frames(GstVaapiMPEG2Gop *gop, GString *str, guint *num_frames_ptr)
+{
+    GstVaapiMPEG2GopFrame frame;
+
+    while (gst_vaapi_utils_mpeg2_gop_pop(gop, &frame)) {
+        if (GPOINTER_TO_UINT(frame.data) != frame.display_index + 1)
+            g_error("frame %u has mismatched user data", frame.display_index);
+        if (frame.type == GST_MPEG_VIDEO_PICTURE_TYPE_I &&
+            frame.closed_gop != (frame.temporal_reference == 0))
+            g_error("I-frame %u has invalid closed_gop flag",
+                frame.display_index);
+        g_string_append_printf(str, "%s%c%u:%u", str->len > 0 ? " " : "",
+            picture_type_char(frame.type), frame.display_index,
+            frame.temporal_reference);
+        (*num_frames_ptr)++;
+    }
+}
+
+static void
+check_gop(const GopTest *test)
+{
+    GstVaapiMPEG2Gop gop;
+    GString *str;
+    guint i, num_frames = 0;
+
+    gst_vaapi_utils_mpeg2_gop_init(&gop);
+    gop.gop_size = test->gop_size;
+    gop.num_bframes = test->num_bframes;
+    gop.closed_gop = test->closed_gop;
+
+    str = g_string_new(NULL);
+    for (i = 0; i < test->num_frames; i++) {
+        gst_vaapi_utils_mpeg2_gop_push(&gop, GUINT_TO_POINTER(i + 1),
+            (gint)i == test->keyframe);
+        pop_frames(&gop, str, &num_frames);
+    }
+    gst_vaapi_utils_mpeg2_gop_drain(&gop);
+    pop_frames(&gop, str, &num_frames);
+
+    if (num_frames != test->num_frames)
+        g_error("%s: %u frames were output, expected %u", test->name,
+            num_frames, test->num_frames);
+    if (strcmp(str->str, test->expected) != 0)
+        g_error("%s: got \"%s\", expected \"%s\"", test->name, str->str,
+            test->expected);
+    g_print("%s: %s\n", test->name, str->str);
+
+    gst_vaapi_utils_mpeg2_gop_clear(&gop, destroy_frame);
+    g_string_free(str, TRUE);
+}
+
+/* Checks that flushing drops pending frames, and restarts a new GOP */
+static void
+check_gop_clear(void)
+{
+    GstVaapiMPEG2Gop gop;
+    GstVaapiMPEG2GopFrame frame;
+    guint i;
+
+    gst_vaapi_utils_mpeg2_gop_init(&gop);
+    gop.gop_size = 12;
+    gop.num_bframes = 2;
+
+    for (i = 0; i < 3; i++)
+        gst_vaapi_utils_mpeg2_gop_push(&gop, GUINT_TO_POINTER(i + 1), FALSE);
+
+    g_num_destroyed = 0;
+    gst_vaapi_utils_mpeg2_gop_clear(&gop, destroy_frame);
+    if (g_num_destroyed != 3)
+        g_error("%u frames were released on clear, expected 3",
+            g_num_destroyed);
+
+    gst_vaapi_utils_mpeg2_gop_push(&gop, GUINT_TO_POINTER(4), FALSE);
+    if (!gst_vaapi_utils_mpeg2_gop_pop(&gop, &frame) ||
+        frame.type != GST_MPEG_VIDEO_PICTURE_TYPE_I ||
+        frame.temporal_reference != 0)
+        g_error("no new GOP was started after clear");
+    gst_vaapi_utils_mpeg2_gop_clear(&gop, NULL);
+    g_print("clear: pending frames released, new GOP started\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(g_gop_tests); i++)
+        check_gop(&g_gop_tests[i]);
+    check_gop_clear();
+    return 0;
+}
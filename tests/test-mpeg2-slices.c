@@ -0,0 +1,350 @@
+/*
+ *  test-mpeg2-slices.c - Test MPEG-2 slice buffers submission
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Decodes a synthetic 1080 lines MPEG-2 stream, i.e. with 68 slices per
+   picture, with the stub VA driver. The VA buffers created by the decoder
+   and the vaRenderPicture() calls are intercepted in the driver vtable,
+   so as to check that all the slices of a picture are submitted as one
+   slice parameter buffer and one slice data buffer, and that the slice
+   parameters describe the layout of the slice data */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/base/gstbitwriter.h>
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapidecoder_mpeg2.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include "stub-display.h"
+
+#define PICTURE_WIDTH           1920
+#define PICTURE_HEIGHT          1080
+#define NUM_SLICES              ((PICTURE_HEIGHT + 15) / 16)
+#define NUM_PICTURES            4
+#define MB_DATA_SIZE            48
+
+/* ------------------------------------------------------------------------- */
+/* --- Synthetic stream                                                  --- */
+/* ------------------------------------------------------------------------- */
+
+static void
+put_bits(GstBitWriter *bw, guint32 value, guint nbits)
+{
+    if (!gst_bit_writer_put_bits_uint32(bw, value, nbits))
+        g_error("could not write %u bits", nbits);
+}
+
+static void
+put_start_code(GstBitWriter *bw, guint8 code)
+{
+    gst_bit_writer_align_bytes(bw, 0);
+    put_bits(bw, 0x000001, 24);
+    put_bits(bw, code, 8);
+}
+
+static void
+write_sequence_headers(GstBitWriter *bw)
+{
+    /* sequence_header() */
+    put_start_code(bw, 0xb3);
+    put_bits(bw, PICTURE_WIDTH, 12);
+    put_bits(bw, PICTURE_HEIGHT, 12);
+    put_bits(bw, 3, 4);                         /* aspect_ratio (16:9) */
+    put_bits(bw, 4, 4);                         /* frame_rate_code (30000/1001) */
+    put_bits(bw, 20000, 18);                    /* bit_rate_value */
+    put_bits(bw, 1, 1);                         /* marker_bit */
+    put_bits(bw, 112, 10);                      /* vbv_buffer_size_value */
+    put_bits(bw, 0, 1);                         /* constrained_parameters */
+    put_bits(bw, 0, 1);                         /* load_intra_quantiser_matrix */
+    put_bits(bw, 0, 1);                         /* load_non_intra_quantiser_matrix */
+
+    /* sequence_extension(), Main profile @ High level */
+    put_start_code(bw, 0xb5);
+    put_bits(bw, 1, 4);
+    put_bits(bw, 0x44, 8);                      /* profile_and_level */
+    put_bits(bw, 1, 1);                         /* progressive_sequence */
+    put_bits(bw, 1, 2);                         /* chroma_format (4:2:0) */
+    put_bits(bw, 0, 2);                         /* horizontal_size_extension */
+    put_bits(bw, 0, 2);                         /* vertical_size_extension */
+    put_bits(bw, 0, 12);                        /* bit_rate_extension */
+    put_bits(bw, 1, 1);                         /* marker_bit */
+    put_bits(bw, 0, 8);                         /* vbv_buffer_size_extension */
+    put_bits(bw, 0, 1);                         /* low_delay */
+    put_bits(bw, 0, 2);                         /* frame_rate_extension_n */
+    put_bits(bw, 0, 5);                         /* frame_rate_extension_d */
+
+    /* group_of_pictures_header() */
+    put_start_code(bw, 0xb8);
+    put_bits(bw, 1 << 12, 25);                  /* time_code, marker_bit */
+    put_bits(bw, 1, 1);                         /* closed_gop */
+    put_bits(bw, 0, 1);                         /* broken_link */
+}
+
+/* Writes an intra coded frame picture. The macroblock data is filled in
+   with a pattern that cannot emulate start codes, since it is not looked
+   at by the stub driver */
+static void
+write_picture(GstBitWriter *bw, guint temporal_reference)
+{
+    guint i, j;
+
+    /* picture_header() */
+    put_start_code(bw, 0x00);
+    put_bits(bw, temporal_reference, 10);
+    put_bits(bw, 1, 3);                         /* picture_coding_type (I) */
+    put_bits(bw, 0xffff, 16);                   /* vbv_delay */
+    put_bits(bw, 0, 1);                         /* extra_bit_picture */
+
+    /* picture_coding_extension() */
+    put_start_code(bw, 0xb5);
+    put_bits(bw, 8, 4);
+    put_bits(bw, 0xffff, 16);                   /* f_code[][] */
+    put_bits(bw, 0, 2);                         /* intra_dc_precision */
+    put_bits(bw, 3, 2);                         /* picture_structure (frame) */
+    put_bits(bw, 0, 1);                         /* top_field_first */
+    put_bits(bw, 1, 1);                         /* frame_pred_frame_dct */
+    put_bits(bw, 0, 1);                         /* concealment_motion_vectors */
+    put_bits(bw, 0, 1);                         /* q_scale_type */
+    put_bits(bw, 0, 1);                         /* intra_vlc_format */
+    put_bits(bw, 0, 1);                         /* alternate_scan */
+    put_bits(bw, 0, 1);                         /* repeat_first_field */
+    put_bits(bw, 1, 1);                         /* chroma_420_type */
+    put_bits(bw, 1, 1);                         /* progressive_frame */
+    put_bits(bw, 0, 1);                         /* composite_display_flag */
+
+    /* slice(), one per macroblock row. Slices get different sizes so
+       that wrong data offsets would be noticed */
+    for (i = 0; i < NUM_SLICES; i++) {
+        put_start_code(bw, i + 1);
+        put_bits(bw, 1 + i % 31, 5);            /* quantiser_scale_code */
+        put_bits(bw, 0, 1);                     /* extra_bit_slice */
+        put_bits(bw, 1, 1);                     /* macroblock_address_increment */
+        for (j = 0; j < MB_DATA_SIZE + i % 7; j++)
+            put_bits(bw, 0xaa, 8);
+    }
+}
+
+static guint8 *
+create_stream(gsize *size_ptr)
+{
+    GstBitWriter bw;
+    guint8 *data;
+    guint i;
+
+    gst_bit_writer_init(&bw, NUM_PICTURES * NUM_SLICES * 64 * 8);
+    write_sequence_headers(&bw);
+    for (i = 0; i < NUM_PICTURES; i++)
+        write_picture(&bw, i);
+    put_start_code(&bw, 0xb7);                  /* sequence_end_code */
+
+    *size_ptr = GST_BIT_WRITER_BIT_SIZE(&bw) / 8;
+    data = g_memdup(GST_BIT_WRITER_DATA(&bw), *size_ptr);
+    gst_bit_writer_clear(&bw, TRUE);
+    return data;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- VA buffers tracking                                               --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    guint       num_render_calls;
+    guint       num_slice_param_buffers;
+    guint       num_slice_data_buffers;
+    guint       num_slice_params;
+    guint       last_slice_data_size;
+    VABufferID  last_slice_param_id;
+} BufferStats;
+
+static BufferStats g_stats;
+
+static VAStatus (*g_create_buffer)(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id);
+static VAStatus (*g_render_picture)(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers);
+
+static VAStatus
+track_CreateBuffer(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id)
+{
+    VAStatus status;
+
+    status = g_create_buffer(ctx, context, type, size, num_elements, data,
+        buf_id);
+    if (status != VA_STATUS_SUCCESS)
+        return status;
+
+    switch (type) {
+    case VASliceParameterBufferType:
+        g_assert(size == sizeof(VASliceParameterBufferMPEG2));
+        g_stats.num_slice_param_buffers++;
+        g_stats.num_slice_params += num_elements;
+        g_stats.last_slice_param_id = *buf_id;
+        break;
+    case VASliceDataBufferType:
+        g_assert(num_elements == 1);
+        g_stats.num_slice_data_buffers++;
+        g_stats.last_slice_data_size = size;
+        break;
+    default:
+        break;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+/* Checks the slice parameters once they are filled in, i.e. when they
+   are submitted, since they are created uninitialized and mapped */
+static void
+check_slice_params(VADriverContextP ctx, VABufferID buf_id)
+{
+    const VASliceParameterBufferMPEG2 *slice_param;
+    void *data;
+    guint i, offset = 0;
+
+    if (ctx->vtable->vaMapBuffer(ctx, buf_id, &data) != VA_STATUS_SUCCESS)
+        g_error("could not map slice parameter buffer");
+
+    slice_param = data;
+    for (i = 0; i < NUM_SLICES; i++, slice_param++) {
+        g_assert(slice_param->slice_vertical_position == i);
+        g_assert(slice_param->slice_horizontal_position == 0);
+        g_assert(slice_param->quantiser_scale_code == 1 + i % 31);
+        g_assert(slice_param->slice_data_flag == VA_SLICE_DATA_FLAG_ALL);
+        g_assert(slice_param->slice_data_offset == offset);
+        g_assert(slice_param->macroblock_offset == 32 + 6);
+        offset += slice_param->slice_data_size;
+    }
+    g_assert(offset == g_stats.last_slice_data_size);
+    ctx->vtable->vaUnmapBuffer(ctx, buf_id);
+}
+
+static VAStatus
+track_RenderPicture(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers)
+{
+    int i;
+
+    for (i = 0; i < num_buffers; i++) {
+        if (buffers[i] == g_stats.last_slice_param_id)
+            check_slice_params(ctx, buffers[i]);
+    }
+    g_stats.num_render_calls++;
+    return g_render_picture(ctx, context, buffers, num_buffers);
+}
+
+/* Intercepts buffers creation and submission, once the driver is loaded */
+static void
+track_buffers(VADisplay va_display)
+{
+    VADriverContextP const ctx = stub_display_get_driver_context(va_display);
+
+    g_create_buffer = ctx->vtable->vaCreateBuffer;
+    ctx->vtable->vaCreateBuffer = track_CreateBuffer;
+    g_render_picture = ctx->vtable->vaRenderPicture;
+    ctx->vtable->vaRenderPicture = track_RenderPicture;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Decoding                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+static guint
+decode_stream(GstVaapiDisplay *display, const guint8 *data, gsize size)
+{
+    GstVaapiDecoder *decoder;
+    GstVaapiDecoderStatus status;
+    GstVaapiSurfaceProxy *proxy;
+    GstBuffer *buffer;
+    GstCaps *caps;
+    guint num_outputs = 0;
+
+    caps = gst_caps_new_simple("video/mpeg",
+        "mpegversion", G_TYPE_INT, 2,
+        "systemstream", G_TYPE_BOOLEAN, FALSE,
+        NULL);
+    decoder = gst_vaapi_decoder_mpeg2_new(display, caps);
+    gst_caps_unref(caps);
+    if (!decoder)
+        g_error("could not create MPEG-2 decoder");
+
+    buffer = gst_buffer_new_allocate(NULL, size, NULL);
+    gst_buffer_fill(buffer, 0, data, size);
+    if (!gst_vaapi_decoder_put_buffer(decoder, buffer))
+        g_error("could not submit stream");
+    gst_buffer_unref(buffer);
+    if (!gst_vaapi_decoder_put_buffer(decoder, NULL))
+        g_error("could not submit end-of-stream");
+
+    while ((status = gst_vaapi_decoder_get_surface(decoder, &proxy)) ==
+           GST_VAAPI_DECODER_STATUS_SUCCESS) {
+        gst_vaapi_surface_proxy_unref(proxy);
+        num_outputs++;
+    }
+    if (status != GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA &&
+        status != GST_VAAPI_DECODER_STATUS_END_OF_STREAM)
+        g_error("could not decode stream (status %d)", status);
+
+    gst_vaapi_decoder_unref(decoder);
+    return num_outputs;
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplay *display;
+    VADisplay va_display;
+    guint8 *data;
+    gsize size;
+    guint num_outputs;
+
+    gst_init(&argc, &argv);
+
+    data = create_stream(&size);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+    track_buffers(va_display);
+
+    num_outputs = decode_stream(display, data, size);
+    g_print("decoded %u pictures: %u vaRenderPicture() calls, "
+        "%u slice parameter buffers (%u slices), %u slice data buffers\n",
+        num_outputs, g_stats.num_render_calls,
+        g_stats.num_slice_param_buffers, g_stats.num_slice_params,
+        g_stats.num_slice_data_buffers);
+
+    if (num_outputs != NUM_PICTURES)
+        g_error("got %u pictures, expected %u", num_outputs, NUM_PICTURES);
+    g_assert(g_stats.num_slice_params == NUM_PICTURES * NUM_SLICES);
+    g_assert(g_stats.num_slice_param_buffers == NUM_PICTURES);
+    g_assert(g_stats.num_slice_data_buffers == NUM_PICTURES);
+
+    /* Picture parameters, quantization matrices and slices */
+    g_assert(g_stats.num_render_calls <= NUM_PICTURES * 3);
+
+    g_free(data);
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ *  test-subpicture-cache.c - Test sharing of identical subpictures
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test does not open any VA display: the cache only manipulates
+   the reference count of subpictures, so fake subpictures are plain
+   mini objects that remove themselves from the cache when destroyed,
+   as real subpictures do */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include "gst/vaapi/gstvaapisubpicturecache.h"
+
+#define WIDTH   64
+#define HEIGHT  16
+#define STRIDE  (WIDTH * 4)
+
+static GstVaapiSubpictureCache *g_cache;
+static guint g_num_destroyed;
+
+static void
+fake_subpicture_finalize(GstVaapiMiniObject *object)
+{
+    gst_vaapi_subpicture_cache_remove(g_cache, GST_VAAPI_SUBPICTURE(object));
+    g_num_destroyed++;
+}
+
+static GstVaapiSubpicture *
+fake_subpicture_new(void)
+{
+    static const GstVaapiMiniObjectClass FakeSubpictureClass = {
+        .size = sizeof(GstVaapiMiniObject),
+        .finalize = (GDestroyNotify)fake_subpicture_finalize
+    };
+
+    return GST_VAAPI_SUBPICTURE(
+        gst_vaapi_mini_object_new0(&FakeSubpictureClass));
+}
+
+static void
+fill_pixels(guint8 *pixels, guint stride, guint seed)
+{
+    guint x, y;
+
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < STRIDE; x++)
+            pixels[y * stride + x] = (x * 7 + y * 13 + seed) & 0xff;
+    }
+}
+
+static GstVaapiSubpicture *
+upload(const guint8 *pixels, guint stride, guint flags)
+{
+    GstVaapiSubpicture *subpicture;
+    guint32 hash;
+
+    subpicture = gst_vaapi_subpicture_cache_lookup(g_cache, pixels,
+        WIDTH, HEIGHT, stride, flags, &hash);
+    if (subpicture)
+        g_error("unexpected cache hit");
+
+    subpicture = fake_subpicture_new();
+    if (!gst_vaapi_subpicture_cache_add(g_cache, subpicture, hash, pixels,
+            WIDTH, HEIGHT, stride, flags))
+        g_error("could not add subpicture to the cache");
+    return subpicture;
+}
+
+static GstVaapiSubpicture *
+lookup(const guint8 *pixels, guint stride, guint flags)
+{
+    return gst_vaapi_subpicture_cache_lookup(g_cache, pixels,
+        WIDTH, HEIGHT, stride, flags, NULL);
+}
+
+static inline gint
+get_ref_count(GstVaapiSubpicture *subpicture)
+{
+    return GST_VAAPI_MINI_OBJECT(subpicture)->ref_count;
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiSubpicture *subpicture, *other;
+    guint8 *pixels, *padded;
+    guint y, num_hits, num_misses;
+    guint64 uploaded_bytes, saved_bytes;
+
+    gst_init(&argc, &argv);
+
+    g_cache = gst_vaapi_subpicture_cache_new();
+    if (!g_cache)
+        g_error("could not create subpicture cache");
+
+    pixels = g_malloc(STRIDE * HEIGHT);
+    padded = g_malloc(2 * STRIDE * HEIGHT);
+    fill_pixels(pixels, STRIDE, 0);
+    for (y = 0; y < HEIGHT; y++)
+        memcpy(padded + y * 2 * STRIDE, pixels + y * STRIDE, STRIDE);
+
+    /* Same pixels, whatever the stride: the subpicture is shared */
+    subpicture = upload(pixels, STRIDE, 0);
+    other = lookup(padded, 2 * STRIDE, 0);
+    if (other != subpicture || get_ref_count(subpicture) != 2)
+        g_error("identical pixels did not share the subpicture");
+    gst_vaapi_mini_object_unref(GST_VAAPI_MINI_OBJECT(other));
+    g_print("shared: ok\n");
+
+    /* Different flags or pixels need another upload */
+    if (lookup(pixels, STRIDE, GST_VAAPI_SUBPICTURE_FLAG_PREMULTIPLIED_ALPHA))
+        g_error("subpicture was shared with different flags");
+    pixels[STRIDE * HEIGHT - 1] ^= 0xff;
+    if (lookup(pixels, STRIDE, 0))
+        g_error("subpicture was shared with different pixels");
+    other = upload(pixels, STRIDE, 0);
+    if (gst_vaapi_subpicture_cache_get_size(g_cache) != 2)
+        g_error("unexpected number of cached subpictures");
+    gst_vaapi_mini_object_unref(GST_VAAPI_MINI_OBJECT(other));
+    if (g_num_destroyed != 1 ||
+        gst_vaapi_subpicture_cache_get_size(g_cache) != 1)
+        g_error("destroyed subpicture was not removed from the cache");
+    g_print("mismatch: ok\n");
+
+    /* A subpicture being destroyed is not handed out */
+    g_atomic_int_set(&GST_VAAPI_MINI_OBJECT(subpicture)->ref_count, 0);
+    if (lookup(padded, 2 * STRIDE, 0))
+        g_error("subpicture being destroyed was handed out");
+    g_atomic_int_set(&GST_VAAPI_MINI_OBJECT(subpicture)->ref_count, 1);
+    gst_vaapi_mini_object_unref(GST_VAAPI_MINI_OBJECT(subpicture));
+    if (gst_vaapi_subpicture_cache_get_size(g_cache) != 0)
+        g_error("subpicture cache is not empty");
+    if (lookup(padded, 2 * STRIDE, 0))
+        g_error("released subpicture was handed out");
+    g_print("release: ok\n");
+
+    gst_vaapi_subpicture_cache_get_stats(g_cache, &num_hits, &num_misses,
+        &uploaded_bytes, &saved_bytes);
+    g_print("hits %u, misses %u, uploaded %" G_GUINT64_FORMAT " bytes, "
+        "saved %" G_GUINT64_FORMAT " bytes\n", num_hits, num_misses,
+        uploaded_bytes, saved_bytes);
+    if (num_hits != 1 || num_misses != 6 ||
+        uploaded_bytes != 2 * STRIDE * HEIGHT ||
+        saved_bytes != STRIDE * HEIGHT)
+        g_error("unexpected subpicture cache statistics");
+
+    gst_vaapi_subpicture_cache_unref(g_cache);
+    g_free(padded);
+    g_free(pixels);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ *  test-surface-cache.c - Test VA surface cache
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test does not open any VA display: the cache only deals with
+   VA surface ids, so fake ids are stored and the destroy function
+   records the surfaces that got evicted */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapicompat.h"
+#include "gst/vaapi/gstvaapisurfacecache.h"
+
+#define YUV420 GST_VAAPI_CHROMA_TYPE_YUV420
+
+/* Room for two 1080p and two 720p NV12 surfaces */
+#define CACHE_BYTES ((1920 * 1080 + 1280 * 720) * 2 * 3 / 2)
+
+static void
+destroy_surface_cb(GstVaapiID surface_id, gpointer user_data)
+{
+    g_array_append_val((GArray *)user_data, surface_id);
+}
+
+static void
+put_surface(GstVaapiSurfaceCache *cache, GstVaapiID surface_id,
+    guint width, guint height)
+{
+    if (!gst_vaapi_surface_cache_put(cache, surface_id, YUV420, width, height))
+        g_error("surface %u was not cached", (guint)surface_id);
+}
+
+static void
+check_get(GstVaapiSurfaceCache *cache, guint width, guint height,
+    GstVaapiID expected)
+{
+    const GstVaapiID surface_id =
+        gst_vaapi_surface_cache_get(cache, YUV420, width, height);
+
+    if (surface_id != expected)
+        g_error("%ux%u: got surface %d, expected %d", width, height,
+            (gint)surface_id, (gint)expected);
+}
+
+static void
+check_destroyed(GArray *destroyed, const GstVaapiID *expected, guint n)
+{
+    guint i;
+
+    if (destroyed->len != n)
+        g_error("%u surfaces destroyed, expected %u", destroyed->len, n);
+    for (i = 0; i < n; i++) {
+        if (g_array_index(destroyed, GstVaapiID, i) != expected[i])
+            g_error("unexpected destroyed surface %u",
+                (guint)g_array_index(destroyed, GstVaapiID, i));
+    }
+    g_array_set_size(destroyed, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiSurfaceCache *cache;
+    GArray *destroyed;
+
+    static const GstVaapiID evicted_720p[] = { 10, 11 };
+    static const GstVaapiID evicted_all[] = { 20, 21, 1 };
+    static const GstVaapiID trimmed[] = { 40, 41 };
+
+    gst_init(&argc, &argv);
+
+    destroyed = g_array_new(FALSE, FALSE, sizeof(GstVaapiID));
+
+    /* Zero-sized caches never take ownership */
+    cache = gst_vaapi_surface_cache_new(0, destroy_surface_cb, destroyed);
+    if (!cache)
+        g_error("could not create surface cache");
+    if (gst_vaapi_surface_cache_put(cache, 1, YUV420, 1920, 1080))
+        g_error("disabled surface cache accepted a surface");
+    gst_vaapi_surface_cache_unref(cache);
+
+    cache = gst_vaapi_surface_cache_new(CACHE_BYTES, destroy_surface_cb,
+        destroyed);
+    if (!cache)
+        g_error("could not create surface cache");
+
+    /* Surfaces larger than the whole cache are never cached */
+    if (gst_vaapi_surface_cache_put(cache, 1, YUV420, 3840, 2160))
+        g_error("surface cache accepted an oversized surface");
+    check_destroyed(destroyed, NULL, 0);
+
+    /* Surfaces only match the exact chroma type and resolution */
+    put_surface(cache, 1, 1920, 1080);
+    check_get(cache, 1280, 720, VA_INVALID_SURFACE);
+    if (gst_vaapi_surface_cache_get(cache, GST_VAAPI_CHROMA_TYPE_YUV422,
+            1920, 1080) != VA_INVALID_SURFACE)
+        g_error("surface matched another chroma type");
+    check_get(cache, 1920, 1080, 1);
+    check_get(cache, 1920, 1080, VA_INVALID_SURFACE);
+    g_print("lookup: ok\n");
+
+    /* ABR switch: 1080p surfaces stay around while 720p is decoded,
+       and the most recently released surface is handed out first */
+    put_surface(cache, 1, 1920, 1080);
+    put_surface(cache, 2, 1920, 1080);
+    put_surface(cache, 10, 1280, 720);
+    put_surface(cache, 11, 1280, 720);
+    if (gst_vaapi_surface_cache_get_size(cache) != 4)
+        g_error("unexpected cache size %u",
+            gst_vaapi_surface_cache_get_size(cache));
+    if (gst_vaapi_surface_cache_get_bytes(cache) != CACHE_BYTES)
+        g_error("unexpected cache size %" G_GSIZE_FORMAT " bytes",
+            gst_vaapi_surface_cache_get_bytes(cache));
+    check_get(cache, 1920, 1080, 2);
+    put_surface(cache, 2, 1920, 1080);
+    check_destroyed(destroyed, NULL, 0);
+    g_print("reuse: ok\n");
+
+    /* Eviction hits the least recently used resolution first, until
+       the new surfaces fit in */
+    put_surface(cache, 20, 720, 1280);
+    put_surface(cache, 21, 720, 1280);
+    check_destroyed(destroyed, evicted_720p, G_N_ELEMENTS(evicted_720p));
+    check_get(cache, 1280, 720, VA_INVALID_SURFACE);
+    check_get(cache, 1920, 1080, 2);
+    g_print("eviction: ok\n");
+
+    gst_vaapi_surface_cache_clear(cache);
+    check_destroyed(destroyed, evicted_all, G_N_ELEMENTS(evicted_all));
+    if (gst_vaapi_surface_cache_get_size(cache) != 0)
+        g_error("surface cache is not empty");
+
+    /* Trimming releases whole surfaces, least recently used first */
+    put_surface(cache, 40, 320, 240);
+    put_surface(cache, 41, 320, 240);
+    put_surface(cache, 42, 640, 480);
+    if (gst_vaapi_surface_cache_get_bytes(cache) != (320 * 240 * 2 +
+            640 * 480) * 3 / 2)
+        g_error("unexpected cache size %" G_GSIZE_FORMAT " bytes",
+            gst_vaapi_surface_cache_get_bytes(cache));
+    if (gst_vaapi_surface_cache_trim(cache, 320 * 240 * 2) != 320 * 240 * 3)
+        g_error("unexpected number of trimmed bytes");
+    check_destroyed(destroyed, trimmed, G_N_ELEMENTS(trimmed));
+    check_get(cache, 640, 480, 42);
+    g_print("trim: ok\n");
+
+    /* Remaining surfaces are destroyed along with the cache */
+    put_surface(cache, 30, 320, 240);
+    gst_vaapi_surface_cache_unref(cache);
+    if (destroyed->len != 1)
+        g_error("cached surfaces were leaked");
+    g_print("clear: ok\n");
+
+    g_array_free(destroyed, TRUE);
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ *  test-ttff.c - Benchmark time to first frame
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Measures the time from decoder creation to the first decoded
+   surface. The first iteration allocates all VA surfaces, the next
+   ones reuse the surfaces released to the display surface cache by
+   the previous decoder, as happens on adaptive streaming switches */
+
+#include "gst/vaapi/sysdeps.h"
+#include "decoder.h"
+#include "output.h"
+
+static gchar *g_codec_str;
+static gint g_num_iterations = 10;
+static gboolean g_no_cache;
+
+static GOptionEntry g_options[] = {
+    { "codec", 'c',
+      0,
+      G_OPTION_ARG_STRING, &g_codec_str,
+      "codec to test", NULL },
+    { "iterations", 'n',
+      0,
+      G_OPTION_ARG_INT, &g_num_iterations,
+      "number of decoders to create", NULL },
+    { "no-cache", 0,
+      0,
+      G_OPTION_ARG_NONE, &g_no_cache,
+      "disable the surface cache", NULL },
+    { NULL, }
+};
+
+static gint64
+decode_first_frame(GstVaapiDisplay *display)
+{
+    GstVaapiDecoder *decoder;
+    GstVaapiSurfaceProxy *proxy;
+    gint64 start_time, elapsed;
+
+    start_time = g_get_monotonic_time();
+
+    decoder = decoder_new(display, g_codec_str);
+    if (!decoder)
+        g_error("could not create decoder");
+    gst_vaapi_decoder_prepare(decoder);
+
+    if (!decoder_put_buffers(decoder))
+        g_error("could not fill decoder with sample data");
+    proxy = decoder_get_surface(decoder);
+    if (!proxy)
+        g_error("could not get decoded surface");
+
+    elapsed = g_get_monotonic_time() - start_time;
+
+    gst_vaapi_surface_proxy_unref(proxy);
+    gst_vaapi_decoder_unref(decoder);
+    return elapsed;
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplay *display;
+    GstVaapiDisplayMemoryStats stats;
+    gint64 elapsed, cold_time = 0, warm_time = 0;
+    guint num_surfaces;
+    gint i;
+
+    if (!video_output_init(&argc, argv, g_options))
+        g_error("failed to initialize video output subsystem");
+
+    if (g_no_cache)
+        g_setenv("GST_VAAPI_SURFACE_CACHE_SIZE", "0", TRUE);
+
+    display = video_output_create_display(NULL);
+    if (!display)
+        g_error("could not create VA display");
+
+    for (i = 0; i < g_num_iterations; i++) {
+        elapsed = decode_first_frame(display);
+        gst_vaapi_display_get_usage(display, NULL, &num_surfaces);
+        g_print("iteration %d: %" G_GINT64_FORMAT " us, %u surfaces\n",
+            i, elapsed, num_surfaces);
+        if (i == 0)
+            cold_time = elapsed;
+        else
+            warm_time += elapsed;
+    }
+
+    g_print("time to first frame: cold %" G_GINT64_FORMAT " us",
+        cold_time);
+    if (g_num_iterations > 1)
+        g_print(", warm %" G_GINT64_FORMAT " us (average)",
+            warm_time / (g_num_iterations - 1));
+    g_print("\n");
+
+    gst_vaapi_display_get_memory_stats(display, &stats);
+    g_print("video memory: %" G_GUINT64_FORMAT " KiB cached, %"
+        G_GUINT64_FORMAT " KiB idle in %u pools\n", stats.cached_bytes >> 10,
+        stats.idle_bytes >> 10, stats.num_pools);
+
+    gst_vaapi_display_unref(display);
+    g_free(g_codec_str);
+    video_output_exit();
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ *  test-user-ptr.c - Test VA user pointer surfaces layout
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test does not open any VA display: it only checks which system
+   memory buffers meet the alignment constraints of VA user pointer
+   surfaces, and the pixels layout determined for them */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/vaapi/gstvaapisurface.h>
+#include "gstvaapiuserptr.h"
+
+#define PAGE_SIZE       GST_VAAPI_SURFACE_USER_PTR_ALIGNMENT
+#define STRIDE_ALIGN    GST_VAAPI_SURFACE_USER_PTR_STRIDE_ALIGNMENT
+
+/* Page aligned system memory, with some room past the pixels */
+typedef struct {
+    guint8     *memory;
+    guint8     *data;
+    gsize       size;
+} Pixels;
+
+static void
+pixels_init(Pixels *pixels, gsize size)
+{
+    pixels->memory = g_malloc(size + 2 * PAGE_SIZE);
+    pixels->data = GSIZE_TO_POINTER(
+        GST_ROUND_UP_N(GPOINTER_TO_SIZE(pixels->memory), PAGE_SIZE));
+    pixels->size = size;
+}
+
+static void
+pixels_clear(Pixels *pixels)
+{
+    g_free(pixels->memory);
+}
+
+static void
+check_layout(GstBuffer *buffer, gconstpointer data, gsize size,
+    const GstVideoInfo *vip, gboolean expected, const gchar *what)
+{
+    GstVideoInfo vi;
+    gboolean success;
+
+    success = gst_vaapi_user_ptr_get_layout(buffer, data, size, vip, &vi);
+    g_print("%s: %s\n", what, success ? "wrapped" : "copied");
+    if (success != expected)
+        g_error("%s: %s, expected %s", what,
+            success ? "wrapped" : "copied", expected ? "wrapped" : "copied");
+    if (success && GST_VIDEO_INFO_SIZE(&vi) != size)
+        g_error("%s: got %" G_GSIZE_FORMAT " bytes, expected %"
+            G_GSIZE_FORMAT, what, GST_VIDEO_INFO_SIZE(&vi), size);
+}
+
+/* Buffers laid out from the caps alone */
+static void
+test_default_layout(void)
+{
+    GstVideoInfo vi;
+    GstBuffer *buffer;
+    Pixels pixels;
+
+    /* 1280 and 640 byte strides are multiples of 128 */
+    gst_video_info_set_format(&vi, GST_VIDEO_FORMAT_I420, 1280, 720);
+    pixels_init(&pixels, GST_VIDEO_INFO_SIZE(&vi));
+    buffer = gst_buffer_new();
+
+    check_layout(buffer, pixels.data, pixels.size, &vi, TRUE, "aligned");
+    check_layout(buffer, pixels.data + 64, pixels.size, &vi, FALSE,
+        "misaligned address");
+    check_layout(buffer, pixels.data, pixels.size - 1, &vi, FALSE,
+        "truncated");
+    check_layout(buffer, pixels.data, pixels.size + PAGE_SIZE, &vi, TRUE,
+        "padded");
+
+    /* 320 byte luma strides are not */
+    gst_video_info_set_format(&vi, GST_VIDEO_FORMAT_I420, 320, 240);
+    check_layout(buffer, pixels.data, pixels.size, &vi, FALSE,
+        "misaligned stride");
+
+    gst_buffer_unref(buffer);
+    pixels_clear(&pixels);
+}
+
+#if GST_CHECK_VERSION(1,0,0)
+/* Buffers with padded strides, described by a GstVideoMeta */
+static void
+test_video_meta_layout(void)
+{
+    GstVideoInfo vi, out_vi;
+    GstBuffer *buffer;
+    gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
+    gint stride[GST_VIDEO_MAX_PLANES] = { 0, };
+    Pixels pixels;
+    guint i;
+
+    gst_video_info_set_format(&vi, GST_VIDEO_FORMAT_NV12, 320, 240);
+    stride[0] = GST_ROUND_UP_N(320, STRIDE_ALIGN);
+    stride[1] = GST_ROUND_UP_N(320, STRIDE_ALIGN);
+    offset[1] = stride[0] * 240;
+    pixels_init(&pixels, offset[1] + stride[1] * 120);
+
+    buffer = gst_buffer_new();
+    gst_buffer_add_video_meta_full(buffer, GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_FORMAT_NV12, 320, 240, 2, offset, stride);
+    check_layout(buffer, pixels.data, pixels.size, &vi, TRUE, "video meta");
+
+    if (!gst_vaapi_user_ptr_get_layout(buffer, pixels.data, pixels.size,
+            &vi, &out_vi))
+        g_error("could not get video meta layout");
+    for (i = 0; i < 2; i++) {
+        if (GST_VIDEO_INFO_PLANE_OFFSET(&out_vi, i) != offset[i] ||
+            GST_VIDEO_INFO_PLANE_STRIDE(&out_vi, i) != stride[i])
+            g_error("plane %u layout does not match the video meta", i);
+    }
+    check_layout(buffer, pixels.data, pixels.size - 1, &vi, FALSE,
+        "truncated video meta");
+    gst_buffer_unref(buffer);
+
+    /* The video meta shall describe the negotiated format */
+    buffer = gst_buffer_new();
+    gst_buffer_add_video_meta_full(buffer, GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_FORMAT_NV21, 320, 240, 2, offset, stride);
+    check_layout(buffer, pixels.data, pixels.size, &vi, FALSE,
+        "video meta format mismatch");
+    gst_buffer_unref(buffer);
+
+    pixels_clear(&pixels);
+}
+#endif
+
+int
+main(int argc, char *argv[])
+{
+    gst_init(&argc, &argv);
+
+    test_default_layout();
+#if GST_CHECK_VERSION(1,0,0)
+    test_video_meta_layout();
+#endif
+
+    gst_deinit();
+    return 0;
+}
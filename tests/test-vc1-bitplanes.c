@@ -0,0 +1,190 @@
+/*
+ *  test-vc1-bitplanes.c - Test VC-1 bitplanes packing
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test only exercises the CPU side of the VC-1 decoder, i.e. no
+   VA display is needed: it checks the bitplanes packer against the
+   reference (one macroblock at a time) implementation, for random
+   picture sizes and sets of bitplanes, and measures the cost of the
+   packing per picture */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapiutils_vc1_priv.h"
+
+#define DEFAULT_NUM_PICTURES    20000
+#define DEFAULT_NUM_CHECKS      10000
+
+static guint g_num_pictures = DEFAULT_NUM_PICTURES;
+static guint g_num_checks = DEFAULT_NUM_CHECKS;
+
+/* Keeps the packed data live across benchmark iterations */
+static volatile guint g_checksum;
+
+static GOptionEntry g_options[] = {
+    { "pictures", 'n',
+      0,
+      G_OPTION_ARG_INT, &g_num_pictures,
+      "number of pictures to pack bitplanes for", NULL },
+    { "checks", 'c',
+      0,
+      G_OPTION_ARG_INT, &g_num_checks,
+      "number of random pictures to check", NULL },
+    { NULL, }
+};
+
+typedef void (*PackBitplanesFunc)(guint8 *dst, const guint8 *bitplanes[3],
+    guint mb_width, guint mb_height, guint mb_stride);
+
+/* Reference packer, i.e. one read-modify-write per macroblock */
+static void
+ref_pack_bitplanes(guint8 *dst, const guint8 *bitplanes[3],
+    guint mb_width, guint mb_height, guint mb_stride)
+{
+    guint x, y, n = 0;
+
+    for (y = 0; y < mb_height; y++) {
+        for (x = 0; x < mb_width; x++, n++) {
+            const guint src_index = y * mb_stride + x;
+            guint8 v = 0;
+
+            if (bitplanes[0])
+                v |= bitplanes[0][src_index];
+            if (bitplanes[1])
+                v |= bitplanes[1][src_index] << 1;
+            if (bitplanes[2])
+                v |= bitplanes[2][src_index] << 2;
+            dst[n / 2] = (dst[n / 2] << 4) | v;
+        }
+    }
+    if (n & 1) /* move last nibble to the high order */
+        dst[n / 2] <<= 4;
+}
+
+static guint8 *
+create_bitplane(GRand *rand, guint size)
+{
+    guint8 * const bitplane = g_malloc(size);
+    guint i;
+
+    for (i = 0; i < size; i++)
+        bitplane[i] = g_rand_int(rand) & 1;
+    return bitplane;
+}
+
+static void
+check_pack_bitplanes(void)
+{
+    guint8 *planes[3], *ref_data, *data;
+    const guint8 *bitplanes[3];
+    guint i, j, mb_width, mb_height, mb_stride, size;
+    GRand *rand;
+
+    rand = g_rand_new_with_seed(1);
+    for (i = 0; i < g_num_checks; i++) {
+        mb_width = g_rand_int_range(rand, 1, 130);
+        mb_height = g_rand_int_range(rand, 1, 70);
+        mb_stride = mb_width + g_rand_int_range(rand, 0, 4);
+
+        /* Each bitplane is present with a 3/4 probability, so that all
+           combinations are covered */
+        for (j = 0; j < 3; j++) {
+            planes[j] = create_bitplane(rand, mb_stride * mb_height);
+            bitplanes[j] = g_rand_int_range(rand, 0, 4) ? planes[j] : NULL;
+        }
+
+        size = (mb_width * mb_height + 1) / 2;
+        ref_data = g_malloc(size);
+        data = g_malloc(size);
+        memset(ref_data, 0xaa, size);
+        memset(data, 0x55, size);
+
+        ref_pack_bitplanes(ref_data, bitplanes, mb_width, mb_height,
+            mb_stride);
+        gst_vaapi_utils_vc1_pack_bitplanes(data, bitplanes, mb_width,
+            mb_height, mb_stride);
+        if (memcmp(ref_data, data, size) != 0)
+            g_error("mismatch for %ux%u macroblocks (stride %u, planes %c%c%c)",
+                mb_width, mb_height, mb_stride,
+                bitplanes[0] ? '0' : '-', bitplanes[1] ? '1' : '-',
+                bitplanes[2] ? '2' : '-');
+
+        g_free(ref_data);
+        g_free(data);
+        for (j = 0; j < 3; j++)
+            g_free(planes[j]);
+    }
+    g_rand_free(rand);
+}
+
+/* Packs the three bitplanes of a 1080i field, i.e. 120x34 macroblocks,
+   and returns the elapsed time per picture, in ns */
+static gdouble
+run_benchmark(PackBitplanesFunc pack_bitplanes)
+{
+    const guint mb_width = 120, mb_height = 34;
+    guint8 *planes[3], *data;
+    const guint8 *bitplanes[3];
+    gint64 start_time, elapsed;
+    guint i;
+    GRand *rand;
+
+    rand = g_rand_new_with_seed(1);
+    for (i = 0; i < 3; i++)
+        bitplanes[i] = planes[i] = create_bitplane(rand, mb_width * mb_height);
+    g_rand_free(rand);
+    data = g_malloc((mb_width * mb_height + 1) / 2);
+
+    start_time = g_get_monotonic_time();
+    for (i = 0; i < g_num_pictures; i++) {
+        pack_bitplanes(data, bitplanes, mb_width, mb_height, mb_width);
+        g_checksum += data[i % ((mb_width * mb_height + 1) / 2)];
+    }
+    elapsed = g_get_monotonic_time() - start_time;
+
+    g_free(data);
+    for (i = 0; i < 3; i++)
+        g_free(planes[i]);
+    return elapsed * 1000.0 / g_num_pictures;
+}
+
+int
+main(int argc, char *argv[])
+{
+    GOptionContext *options;
+    gdouble ref_time, new_time;
+
+    options = g_option_context_new(" - test VC-1 bitplanes packing");
+    g_option_context_add_main_entries(options, g_options, NULL);
+    g_option_context_parse(options, &argc, &argv, NULL);
+    g_option_context_free(options);
+
+    if (!g_num_pictures)
+        g_error("invalid number of pictures");
+
+    check_pack_bitplanes();
+
+    ref_time = run_benchmark(ref_pack_bitplanes);
+    new_time = run_benchmark(gst_vaapi_utils_vc1_pack_bitplanes);
+
+    g_print("bitplanes packing cost per 1080i field (3 planes)\n");
+    g_print("  reference packer: %8.1f ns\n", ref_time);
+    g_print("  row packer:       %8.1f ns\n", new_time);
+    return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ *  test-video-memory.c - Test CPU maps of VA video memory
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Maps VA video memory of the stub VA display, whose surfaces cannot be
+   derived into images, and counts the image transfers. A write map shall
+   not download the surface, and shall be uploaded exactly once on unmap.
+   Reading the pixels back shall neither download nor upload anything,
+   until the surface is mapped for rendering */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/video/gstvideometa.h>
+#include "gstvaapivideomemory.h"
+#include "stub-display.h"
+
+#define WIDTH           320
+#define HEIGHT          240
+#define PATTERN         0x5a
+
+static guint g_num_get_images;
+static guint g_num_put_images;
+
+static VAStatus (*g_get_image)(VADriverContextP ctx, VASurfaceID surface,
+    int x, int y, unsigned int width, unsigned int height, VAImageID image);
+static VAStatus (*g_put_image)(VADriverContextP ctx, VASurfaceID surface,
+    VAImageID image, int src_x, int src_y, unsigned int src_width,
+    unsigned int src_height, int dest_x, int dest_y, unsigned int dest_width,
+    unsigned int dest_height);
+
+static VAStatus
+track_GetImage(VADriverContextP ctx, VASurfaceID surface, int x, int y,
+    unsigned int width, unsigned int height, VAImageID image)
+{
+    g_num_get_images++;
+    return g_get_image(ctx, surface, x, y, width, height, image);
+}
+
+static VAStatus
+track_PutImage(VADriverContextP ctx, VASurfaceID surface, VAImageID image,
+    int src_x, int src_y, unsigned int src_width, unsigned int src_height,
+    int dest_x, int dest_y, unsigned int dest_width, unsigned int dest_height)
+{
+    g_num_put_images++;
+    return g_put_image(ctx, surface, image, src_x, src_y, src_width,
+        src_height, dest_x, dest_y, dest_width, dest_height);
+}
+
+/* Intercepts image transfers, once the driver is loaded */
+static void
+track_transfers(VADisplay va_display)
+{
+    VADriverContextP const ctx = stub_display_get_driver_context(va_display);
+
+    g_get_image = ctx->vtable->vaGetImage;
+    ctx->vtable->vaGetImage = track_GetImage;
+    g_put_image = ctx->vtable->vaPutImage;
+    ctx->vtable->vaPutImage = track_PutImage;
+}
+
+/* Checks the transfers since the last check */
+static void
+check_transfers(const gchar *what, guint num_get_images, guint num_put_images)
+{
+    g_print("%s: %u downloads, %u uploads\n", what, g_num_get_images,
+        g_num_put_images);
+
+    if (g_num_get_images != num_get_images)
+        g_error("%s: got %u vaGetImage() calls, expected %u", what,
+            g_num_get_images, num_get_images);
+    if (g_num_put_images != num_put_images)
+        g_error("%s: got %u vaPutImage() calls, expected %u", what,
+            g_num_put_images, num_put_images);
+    g_num_get_images = 0;
+    g_num_put_images = 0;
+}
+
+/* Allocates a buffer the way the VA video buffer pool does */
+static GstBuffer *
+create_buffer(GstVaapiDisplay *display, GstAllocator *allocator)
+{
+    const GstVideoInfo * const vip =
+        &GST_VAAPI_VIDEO_ALLOCATOR_CAST(allocator)->image_info;
+    GstVaapiVideoMeta *meta;
+    GstVideoMeta *vmeta;
+    GstMemory *mem;
+    GstBuffer *buffer;
+
+    meta = gst_vaapi_video_meta_new(display);
+    if (!meta)
+        g_error("could not create VA video meta");
+    mem = gst_vaapi_video_memory_new(allocator, meta);
+    if (!mem)
+        g_error("could not create VA video memory");
+    gst_vaapi_video_meta_unref(meta);
+
+    buffer = gst_buffer_new();
+    gst_buffer_append_memory(buffer, mem);
+
+    vmeta = gst_buffer_add_video_meta_full(buffer, 0,
+        GST_VIDEO_INFO_FORMAT(vip), GST_VIDEO_INFO_WIDTH(vip),
+        GST_VIDEO_INFO_HEIGHT(vip), GST_VIDEO_INFO_N_PLANES(vip),
+        &GST_VIDEO_INFO_PLANE_OFFSET(vip, 0),
+        &GST_VIDEO_INFO_PLANE_STRIDE(vip, 0));
+    vmeta->map = gst_video_meta_map_vaapi_memory;
+    vmeta->unmap = gst_video_meta_unmap_vaapi_memory;
+    return buffer;
+}
+
+static void
+check_pattern(const gchar *what, const guint8 *data)
+{
+    if (data[0] != PATTERN)
+        g_error("%s: got 0x%02x, expected 0x%02x", what, data[0], PATTERN);
+}
+
+static void
+check_maps(GstBuffer *buffer, const GstVideoInfo *vip)
+{
+    GstVideoFrame frame;
+    GstMapInfo map_info;
+
+    /* Write map, nothing is downloaded, and pixels are uploaded once */
+    if (!gst_video_frame_map(&frame, vip, buffer, GST_MAP_WRITE))
+        g_error("could not map frame for writing");
+    check_transfers("map write", 0, 0);
+    memset(GST_VIDEO_FRAME_PLANE_DATA(&frame, 0), PATTERN,
+        GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0) *
+        GST_VIDEO_FRAME_HEIGHT(&frame));
+    gst_video_frame_unmap(&frame);
+    check_transfers("unmap write", 0, 1);
+
+    /* Read map, the image already holds the surface pixels */
+    if (!gst_video_frame_map(&frame, vip, buffer, GST_MAP_READ))
+        g_error("could not map frame for reading");
+    check_pattern("map read", GST_VIDEO_FRAME_PLANE_DATA(&frame, 0));
+    gst_video_frame_unmap(&frame);
+    check_transfers("map read", 0, 0);
+
+    if (!gst_buffer_map(buffer, &map_info, GST_MAP_READ))
+        g_error("could not map buffer for reading");
+    check_pattern("linear map read", map_info.data);
+    gst_buffer_unmap(buffer, &map_info);
+    check_transfers("linear map read", 0, 0);
+
+    /* Surface map, the surface could be rendered to, so pixels are
+       downloaded again on the next read map */
+    if (!gst_buffer_map(buffer, &map_info, 0))
+        g_error("could not map buffer surface");
+    gst_buffer_unmap(buffer, &map_info);
+    check_transfers("map surface", 0, 0);
+
+    if (!gst_video_frame_map(&frame, vip, buffer, GST_MAP_READ))
+        g_error("could not map frame for reading");
+    gst_video_frame_unmap(&frame);
+    check_transfers("map read after render", 1, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplay *display;
+    GstAllocator *allocator;
+    GstBuffer *buffer;
+    GstVideoInfo vi;
+    VADisplay va_display;
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+
+    gst_video_info_init(&vi);
+    gst_video_info_set_format(&vi, GST_VIDEO_FORMAT_NV12, WIDTH, HEIGHT);
+    allocator = gst_vaapi_video_allocator_new(display, &vi);
+    if (!allocator)
+        g_error("could not create VA video allocator");
+    if (GST_VAAPI_VIDEO_ALLOCATOR_CAST(allocator)->has_direct_rendering ||
+        GST_VAAPI_VIDEO_ALLOCATOR_CAST(allocator)->has_derived_images)
+        g_error("stub surfaces were unexpectedly derived into images");
+
+    track_transfers(va_display);
+    buffer = create_buffer(display, allocator);
+    check_maps(buffer, &GST_VAAPI_VIDEO_ALLOCATOR_CAST(allocator)->image_info);
+    gst_buffer_unref(buffer);
+
+    gst_object_unref(allocator);
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
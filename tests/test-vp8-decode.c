@@ -0,0 +1,501 @@
+/*
+ *  test-vp8-decode.c - Test VP8 probability table submission
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Generates a synthetic VP8 stream with a boolean encoder, where only
+   some inter frames update the coefficient probabilities, and some of
+   them without saving the updates into the entropy context. The stream
+   is decoded with the stub VA driver, and the probability table
+   submitted for each frame is checked against what was written. VA
+   buffers are consumed by vaRenderPicture(), so the decoder shall
+   create a new probability buffer for each frame, and release it once
+   the frame was submitted */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/codecparsers/gstvp8parser.h>
+#include <gst/codecparsers/vp8utils.h>
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapidecoder_vp8.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include <va/va_dec_vp8.h>
+#include "stub-display.h"
+
+#define NUM_FRAMES              90
+#define KEY_INTERVAL            30
+#define FRAME_WIDTH             320
+#define FRAME_HEIGHT            240
+#define DCT_PARTITION_SIZE      256
+
+/* Boolean entropy encoder, as described in RFC 6386, section 7.3 */
+typedef struct {
+    guint8     *data;
+    guint8     *out;
+    guint32     range;
+    guint32     bottom;
+    gint        bit_count;
+} BoolEncoder;
+
+static void
+bool_encoder_init(BoolEncoder *e, guint8 *data)
+{
+    e->data = data;
+    e->out = data;
+    e->range = 255;
+    e->bottom = 0;
+    e->bit_count = 24;
+}
+
+static void
+add_one_to_output(guint8 *q)
+{
+    while (*--q == 255)
+        *q = 0;
+    ++*q;
+}
+
+static void
+write_bool(BoolEncoder *e, guint prob, gboolean value)
+{
+    const guint32 split = 1 + (((e->range - 1) * prob) >> 8);
+
+    if (value) {
+        e->bottom += split;
+        e->range -= split;
+    }
+    else
+        e->range = split;
+
+    while (e->range < 128) {
+        e->range <<= 1;
+        if (e->bottom & (1U << 31))
+            add_one_to_output(e->out);
+        e->bottom <<= 1;
+        if (!--e->bit_count) {
+            *e->out++ = e->bottom >> 24;
+            e->bottom &= (1 << 24) - 1;
+            e->bit_count = 8;
+        }
+    }
+}
+
+static void
+write_literal(BoolEncoder *e, guint value, guint bits)
+{
+    while (bits-- > 0)
+        write_bool(e, 128, (value >> bits) & 1);
+}
+
+/* Flushes the encoder and returns the number of bytes written */
+static guint
+bool_encoder_flush(BoolEncoder *e)
+{
+    gint c = e->bit_count;
+    guint32 v = e->bottom;
+
+    if (v & (1U << (32 - c)))
+        add_one_to_output(e->out);
+    v <<= c & 7;
+    c >>= 3;
+    while (--c >= 0)
+        v <<= 8;
+    c = 4;
+    while (--c >= 0) {
+        *e->out++ = v >> 24;
+        v <<= 8;
+    }
+    return e->out - e->data;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Synthetic stream                                                  --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    guint8     *data;
+    guint       size;
+    gboolean    key_frame;
+    gboolean    refresh_entropy_probs;
+    guint       num_token_updates;
+    GstVp8TokenProbs token_probs;       /* expected probabilities */
+} Frame;
+
+static GstVp8TokenProbs g_token_update_probs;
+static GstVp8MvProbs g_mv_update_probs;
+
+/* Writes the first partition of a frame, with num_token_updates random
+   coefficient probability updates applied to probs */
+static guint
+write_first_partition(BoolEncoder *e, GRand *rand, Frame *frame,
+    GstVp8TokenProbs *probs)
+{
+    guint i, j, k, l, n;
+    guint8 update_mask[4 * 8 * 3 * 11];
+
+    memset(update_mask, 0, sizeof(update_mask));
+    for (n = 0; n < frame->num_token_updates; n++)
+        update_mask[g_rand_int_range(rand, 0, sizeof(update_mask))] = 1;
+
+    if (frame->key_frame) {
+        write_literal(e, 0, 1);         /* color_space */
+        write_literal(e, 0, 1);         /* clamping_type */
+    }
+    write_literal(e, 0, 1);             /* segmentation_enabled */
+    write_literal(e, 0, 1);             /* filter_type */
+    write_literal(e, 32, 6);            /* loop_filter_level */
+    write_literal(e, 0, 3);             /* sharpness_level */
+    write_literal(e, 0, 1);             /* loop_filter_adj_enable */
+    write_literal(e, 0, 2);             /* log2_nbr_of_dct_partitions */
+
+    write_literal(e, 64, 7);            /* y_ac_qi */
+    for (i = 0; i < 5; i++)
+        write_literal(e, 0, 1);         /* no delta_q update */
+
+    if (!frame->key_frame) {
+        write_literal(e, 0, 1);         /* refresh_golden_frame */
+        write_literal(e, 0, 1);         /* refresh_alternate_frame */
+        write_literal(e, 0, 2);         /* copy_buffer_to_golden */
+        write_literal(e, 0, 2);         /* copy_buffer_to_alternate */
+        write_literal(e, 0, 1);         /* sign_bias_golden */
+        write_literal(e, 0, 1);         /* sign_bias_alternate */
+        write_literal(e, frame->refresh_entropy_probs, 1);
+        write_literal(e, 1, 1);         /* refresh_last */
+    }
+    else
+        write_literal(e, frame->refresh_entropy_probs, 1);
+
+    for (i = 0, n = 0; i < 4; i++) {
+        for (j = 0; j < 8; j++) {
+            for (k = 0; k < 3; k++) {
+                for (l = 0; l < 11; l++, n++) {
+                    const guint update_prob =
+                        g_token_update_probs.prob[i][j][k][l];
+                    guint8 prob;
+
+                    write_bool(e, update_prob, update_mask[n]);
+                    if (!update_mask[n])
+                        continue;
+
+                    /* Make sure an update actually changes something */
+                    prob = g_rand_int_range(rand, 1, 256);
+                    if (prob == probs->prob[i][j][k][l])
+                        prob = prob == 255 ? 1 : prob + 1;
+                    probs->prob[i][j][k][l] = prob;
+                    write_literal(e, prob, 8);
+                }
+            }
+        }
+    }
+
+    write_literal(e, 1, 1);             /* mb_no_skip_coeff */
+    write_literal(e, 200, 8);           /* prob_skip_false */
+
+    if (!frame->key_frame) {
+        write_literal(e, 64, 8);        /* prob_intra */
+        write_literal(e, 128, 8);       /* prob_last */
+        write_literal(e, 128, 8);       /* prob_gf */
+        write_literal(e, 0, 1);         /* intra_16x16_prob_update_flag */
+        write_literal(e, 0, 1);         /* intra_chroma_prob_update_flag */
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < G_N_ELEMENTS(g_mv_update_probs.prob[i]); j++)
+                write_bool(e, g_mv_update_probs.prob[i][j], FALSE);
+        }
+    }
+
+    /* Some (fake) macroblock data, so that the header is followed by
+       something, as in actual streams */
+    for (i = 0; i < 64; i++)
+        write_literal(e, g_rand_int(rand) & 0xff, 8);
+    return bool_encoder_flush(e);
+}
+
+/* Creates a frame from the entropy context, which is updated the way
+   the decoder shall do it */
+static void
+create_frame(Frame *frame, GRand *rand, gboolean key_frame,
+    GstVp8TokenProbs *entropy_probs)
+{
+    const guint header_size = key_frame ? 10 : 3;
+    guint8 first_partition[8192];
+    guint first_part_size;
+    guint32 frame_tag;
+    BoolEncoder e;
+    guint8 *p;
+
+    frame->key_frame = key_frame;
+    frame->refresh_entropy_probs = TRUE;
+
+    /* Key frames usually refresh a lot of coefficient probabilities,
+       while only a few inter frames update some of them, and even fewer
+       only use the updates for themselves */
+    if (key_frame) {
+        gst_vp8_token_probs_init_defaults(entropy_probs);
+        frame->num_token_updates = g_rand_int_range(rand, 32, 128);
+    }
+    else if (g_rand_int_range(rand, 0, 4) == 0) {
+        frame->num_token_updates = g_rand_int_range(rand, 1, 16);
+        frame->refresh_entropy_probs = g_rand_int_range(rand, 0, 3) != 0;
+    }
+    else
+        frame->num_token_updates = 0;
+
+    frame->token_probs = *entropy_probs;
+    bool_encoder_init(&e, first_partition);
+    first_part_size = write_first_partition(&e, rand, frame,
+        &frame->token_probs);
+    if (frame->refresh_entropy_probs)
+        *entropy_probs = frame->token_probs;
+
+    frame->size = header_size + first_part_size + DCT_PARTITION_SIZE;
+    frame->data = p = g_malloc(frame->size);
+
+    frame_tag = (key_frame ? 0 : 1) |   /* version 0 */
+        (1 << 4) |                      /* show_frame */
+        (first_part_size << 5);
+    *p++ = frame_tag;
+    *p++ = frame_tag >> 8;
+    *p++ = frame_tag >> 16;
+    if (key_frame) {
+        *p++ = 0x9d;
+        *p++ = 0x01;
+        *p++ = 0x2a;
+        *p++ = FRAME_WIDTH & 0xff;
+        *p++ = FRAME_WIDTH >> 8;
+        *p++ = FRAME_HEIGHT & 0xff;
+        *p++ = FRAME_HEIGHT >> 8;
+    }
+    memcpy(p, first_partition, first_part_size);
+    p += first_part_size;
+    memset(p, 0, DCT_PARTITION_SIZE);
+}
+
+static Frame *
+create_sequence(guint num_frames)
+{
+    GstVp8TokenProbs entropy_probs;
+    Frame *frames;
+    GRand *rand;
+    guint i;
+
+    gst_vp8_token_update_probs_init(&g_token_update_probs);
+    gst_vp8_mv_update_probs_init(&g_mv_update_probs);
+
+    frames = g_new(Frame, num_frames);
+    rand = g_rand_new_with_seed(1);
+    for (i = 0; i < num_frames; i++)
+        create_frame(&frames[i], rand, i % KEY_INTERVAL == 0,
+            &entropy_probs);
+    g_rand_free(rand);
+    return frames;
+}
+
+static void
+destroy_sequence(Frame *frames, guint num_frames)
+{
+    guint i;
+
+    for (i = 0; i < num_frames; i++)
+        g_free(frames[i].data);
+    g_free(frames);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Probability buffer tracking                                       --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    guint       num_buffers;    /* VA probability buffers created */
+    GHashTable *live_buffers;   /* VA probability buffers not destroyed */
+    GArray     *submissions;    /* submitted VAProbabilityDataBufferVP8 */
+} ProbStats;
+
+static ProbStats g_stats;
+
+static VAStatus (*g_create_buffer)(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id);
+static VAStatus (*g_destroy_buffer)(VADriverContextP ctx, VABufferID buf_id);
+static VAStatus (*g_render_picture)(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers);
+
+static VAStatus
+track_CreateBuffer(VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID *buf_id)
+{
+    VAStatus status;
+
+    status = g_create_buffer(ctx, context, type, size, num_elements, data,
+        buf_id);
+    if (status == VA_STATUS_SUCCESS && type == VAProbabilityBufferType) {
+        g_hash_table_insert(g_stats.live_buffers, GUINT_TO_POINTER(*buf_id),
+            NULL);
+        g_stats.num_buffers++;
+    }
+    return status;
+}
+
+static VAStatus
+track_DestroyBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    g_hash_table_remove(g_stats.live_buffers, GUINT_TO_POINTER(buf_id));
+    return g_destroy_buffer(ctx, buf_id);
+}
+
+static VAStatus
+track_RenderPicture(VADriverContextP ctx, VAContextID context,
+    VABufferID *buffers, int num_buffers)
+{
+    void *data;
+    int i;
+
+    for (i = 0; i < num_buffers; i++) {
+        if (!g_hash_table_lookup_extended(g_stats.live_buffers,
+                GUINT_TO_POINTER(buffers[i]), NULL, NULL))
+            continue;
+        if (ctx->vtable->vaMapBuffer(ctx, buffers[i], &data) !=
+            VA_STATUS_SUCCESS)
+            g_error("could not map probability table");
+        g_array_append_vals(g_stats.submissions, data, 1);
+        ctx->vtable->vaUnmapBuffer(ctx, buffers[i]);
+    }
+    return g_render_picture(ctx, context, buffers, num_buffers);
+}
+
+/* Intercepts probability buffers, once the driver is loaded */
+static void
+track_prob_buffers(VADisplay va_display)
+{
+    VADriverContextP const ctx = stub_display_get_driver_context(va_display);
+
+    g_create_buffer = ctx->vtable->vaCreateBuffer;
+    ctx->vtable->vaCreateBuffer = track_CreateBuffer;
+    g_destroy_buffer = ctx->vtable->vaDestroyBuffer;
+    ctx->vtable->vaDestroyBuffer = track_DestroyBuffer;
+    g_render_picture = ctx->vtable->vaRenderPicture;
+    ctx->vtable->vaRenderPicture = track_RenderPicture;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Tests                                                             --- */
+/* ------------------------------------------------------------------------- */
+
+static void
+decode_sequence(GstVaapiDisplay *display, const Frame *frames,
+    guint num_frames)
+{
+    GstVaapiDecoder *decoder;
+    GstVaapiDecoderStatus status;
+    GstVaapiSurfaceProxy *proxy;
+    GstBuffer *buffer;
+    GstCaps *caps;
+    guint i, num_outputs = 0;
+
+    caps = gst_caps_new_simple("video/x-vp8",
+        "width", G_TYPE_INT, FRAME_WIDTH,
+        "height", G_TYPE_INT, FRAME_HEIGHT, NULL);
+    decoder = gst_vaapi_decoder_vp8_new(display, caps);
+    gst_caps_unref(caps);
+    if (!decoder)
+        g_error("could not create VP8 decoder");
+
+    for (i = 0; i < num_frames; i++) {
+        buffer = gst_buffer_new_allocate(NULL, frames[i].size, NULL);
+        gst_buffer_fill(buffer, 0, frames[i].data, frames[i].size);
+        GST_BUFFER_PTS(buffer) = i * GST_SECOND / 30;
+        if (!gst_vaapi_decoder_put_buffer(decoder, buffer))
+            g_error("could not submit frame %u", i);
+        gst_buffer_unref(buffer);
+
+        while ((status = gst_vaapi_decoder_get_surface(decoder, &proxy)) ==
+               GST_VAAPI_DECODER_STATUS_SUCCESS) {
+            gst_vaapi_surface_proxy_unref(proxy);
+            num_outputs++;
+        }
+        if (status != GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA)
+            g_error("could not decode frame %u (status %d)", i, status);
+    }
+    gst_vaapi_decoder_unref(decoder);
+
+    if (num_outputs != num_frames)
+        g_error("got %u frames, expected %u", num_outputs, num_frames);
+}
+
+static void
+check_prob_buffers(GstVaapiDisplay *display)
+{
+    Frame *frames;
+    guint i;
+
+    frames = create_sequence(NUM_FRAMES);
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.live_buffers = g_hash_table_new(NULL, NULL);
+    g_stats.submissions = g_array_new(FALSE, FALSE,
+        sizeof(VAProbabilityDataBufferVP8));
+    decode_sequence(display, frames, NUM_FRAMES);
+
+    g_print("%u probability buffers for %u frames\n", g_stats.num_buffers,
+        NUM_FRAMES);
+
+    if (g_stats.submissions->len != NUM_FRAMES)
+        g_error("got %u probability tables, expected %u",
+            g_stats.submissions->len, NUM_FRAMES);
+    for (i = 0; i < NUM_FRAMES; i++) {
+        const VAProbabilityDataBufferVP8 * const prob_param =
+            &g_array_index(g_stats.submissions, VAProbabilityDataBufferVP8, i);
+        if (memcmp(prob_param->dct_coeff_probs, frames[i].token_probs.prob,
+                sizeof(frames[i].token_probs.prob)) != 0)
+            g_error("coefficient probabilities mismatch for frame %u", i);
+    }
+
+    if (g_stats.num_buffers != NUM_FRAMES)
+        g_error("got %u probability buffers, expected %u",
+            g_stats.num_buffers, NUM_FRAMES);
+    if (g_hash_table_size(g_stats.live_buffers) > 0)
+        g_error("%u probability buffers were not released",
+            g_hash_table_size(g_stats.live_buffers));
+
+    g_hash_table_unref(g_stats.live_buffers);
+    g_array_unref(g_stats.submissions);
+    destroy_sequence(frames, NUM_FRAMES);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GstVaapiDisplay *display;
+    VADisplay va_display;
+
+    gst_init(&argc, &argv);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+    track_prob_buffers(va_display);
+
+    check_prob_buffers(display);
+
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}
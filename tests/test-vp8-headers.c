@@ -0,0 +1,416 @@
+/*
+ *  test-vp8-headers.c - Test VP8 frame headers parsing
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This test only exercises the CPU side of the VP8 decoder, i.e. no
+   VA display is needed: it generates synthetic VP8 frame headers with
+   a boolean encoder, checks the parsed headers and coefficient
+   probabilities against what was written, and measures the cost of
+   parsing the headers per frame. It also reports how many frames
+   actually changed the coefficient probabilities, i.e. how many times
+   the decoder has to refill its VA probability data */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/codecparsers/gstvp8parser.h>
+#include <gst/codecparsers/vp8utils.h>
+
+#define DEFAULT_NUM_FRAMES      100000
+#define DEFAULT_KEY_INTERVAL    60
+#define SEQUENCE_LENGTH         240
+#define FRAME_WIDTH             1920
+#define FRAME_HEIGHT            1080
+#define DCT_PARTITION_SIZE      256
+
+static guint g_num_frames = DEFAULT_NUM_FRAMES;
+static guint g_key_interval = DEFAULT_KEY_INTERVAL;
+
+/* Keeps the parsed headers live across benchmark iterations */
+static volatile guint g_checksum;
+
+static GOptionEntry g_options[] = {
+    { "frames", 'n',
+      0,
+      G_OPTION_ARG_INT, &g_num_frames,
+      "number of frame headers to parse", NULL },
+    { "key-interval", 'k',
+      0,
+      G_OPTION_ARG_INT, &g_key_interval,
+      "number of frames between key frames", NULL },
+    { NULL, }
+};
+
+/* Boolean entropy encoder, as described in RFC 6386, section 7.3 */
+typedef struct {
+    guint8     *data;
+    guint8     *out;
+    guint32     range;
+    guint32     bottom;
+    gint        bit_count;
+} BoolEncoder;
+
+static void
+bool_encoder_init(BoolEncoder *e, guint8 *data)
+{
+    e->data = data;
+    e->out = data;
+    e->range = 255;
+    e->bottom = 0;
+    e->bit_count = 24;
+}
+
+static void
+add_one_to_output(guint8 *q)
+{
+    while (*--q == 255)
+        *q = 0;
+    ++*q;
+}
+
+static void
+write_bool(BoolEncoder *e, guint prob, gboolean value)
+{
+    const guint32 split = 1 + (((e->range - 1) * prob) >> 8);
+
+    if (value) {
+        e->bottom += split;
+        e->range -= split;
+    }
+    else
+        e->range = split;
+
+    while (e->range < 128) {
+        e->range <<= 1;
+        if (e->bottom & (1U << 31))
+            add_one_to_output(e->out);
+        e->bottom <<= 1;
+        if (!--e->bit_count) {
+            *e->out++ = e->bottom >> 24;
+            e->bottom &= (1 << 24) - 1;
+            e->bit_count = 8;
+        }
+    }
+}
+
+static void
+write_literal(BoolEncoder *e, guint value, guint bits)
+{
+    while (bits-- > 0)
+        write_bool(e, 128, (value >> bits) & 1);
+}
+
+/* Flushes the encoder and returns the number of bytes written */
+static guint
+bool_encoder_flush(BoolEncoder *e)
+{
+    gint c = e->bit_count;
+    guint32 v = e->bottom;
+
+    if (v & (1U << (32 - c)))
+        add_one_to_output(e->out);
+    v <<= c & 7;
+    c >>= 3;
+    while (--c >= 0)
+        v <<= 8;
+    c = 4;
+    while (--c >= 0) {
+        *e->out++ = v >> 24;
+        v <<= 8;
+    }
+    return e->out - e->data;
+}
+
+typedef struct {
+    guint8     *data;
+    guint       size;
+    gboolean    key_frame;
+    guint       y_ac_qi;
+    guint       first_part_size;
+    guint       num_token_updates;
+    GstVp8TokenProbs token_probs;       /* expected probabilities */
+} Frame;
+
+static GstVp8TokenProbs g_token_update_probs;
+static GstVp8MvProbs g_mv_update_probs;
+
+/* Writes the first partition of a frame, with num_token_updates random
+   coefficient probability updates, and tracks the resulting
+   probabilities in probs */
+static guint
+write_first_partition(BoolEncoder *e, GRand *rand, Frame *frame,
+    GstVp8TokenProbs *probs)
+{
+    guint i, j, k, l, n, num_updates = 0;
+    guint8 update_mask[4 * 8 * 3 * 11];
+
+    memset(update_mask, 0, sizeof(update_mask));
+    for (n = 0; n < frame->num_token_updates; n++)
+        update_mask[g_rand_int_range(rand, 0, sizeof(update_mask))] = 1;
+
+    if (frame->key_frame) {
+        write_literal(e, 0, 1);         /* color_space */
+        write_literal(e, 0, 1);         /* clamping_type */
+    }
+    write_literal(e, 0, 1);             /* segmentation_enabled */
+    write_literal(e, 0, 1);             /* filter_type */
+    write_literal(e, 32, 6);            /* loop_filter_level */
+    write_literal(e, 0, 3);             /* sharpness_level */
+    write_literal(e, 0, 1);             /* loop_filter_adj_enable */
+    write_literal(e, 0, 2);             /* log2_nbr_of_dct_partitions */
+
+    write_literal(e, frame->y_ac_qi, 7);
+    for (i = 0; i < 5; i++)
+        write_literal(e, 0, 1);         /* no delta_q update */
+
+    if (!frame->key_frame) {
+        write_literal(e, 0, 1);         /* refresh_golden_frame */
+        write_literal(e, 0, 1);         /* refresh_alternate_frame */
+        write_literal(e, 0, 2);         /* copy_buffer_to_golden */
+        write_literal(e, 0, 2);         /* copy_buffer_to_alternate */
+        write_literal(e, 0, 1);         /* sign_bias_golden */
+        write_literal(e, 0, 1);         /* sign_bias_alternate */
+        write_literal(e, 1, 1);         /* refresh_entropy_probs */
+        write_literal(e, 1, 1);         /* refresh_last */
+    }
+    else
+        write_literal(e, 1, 1);         /* refresh_entropy_probs */
+
+    for (i = 0, n = 0; i < 4; i++) {
+        for (j = 0; j < 8; j++) {
+            for (k = 0; k < 3; k++) {
+                for (l = 0; l < 11; l++, n++) {
+                    const guint update_prob =
+                        g_token_update_probs.prob[i][j][k][l];
+                    guint8 prob;
+
+                    write_bool(e, update_prob, update_mask[n]);
+                    if (!update_mask[n])
+                        continue;
+
+                    /* Make sure an update actually changes something */
+                    prob = g_rand_int_range(rand, 1, 256);
+                    if (prob == probs->prob[i][j][k][l])
+                        prob = prob == 255 ? 1 : prob + 1;
+                    probs->prob[i][j][k][l] = prob;
+                    write_literal(e, prob, 8);
+                    num_updates++;
+                }
+            }
+        }
+    }
+
+    write_literal(e, 1, 1);             /* mb_no_skip_coeff */
+    write_literal(e, 200, 8);           /* prob_skip_false */
+
+    if (!frame->key_frame) {
+        write_literal(e, 64, 8);        /* prob_intra */
+        write_literal(e, 128, 8);       /* prob_last */
+        write_literal(e, 128, 8);       /* prob_gf */
+        write_literal(e, 0, 1);         /* intra_16x16_prob_update_flag */
+        write_literal(e, 0, 1);         /* intra_chroma_prob_update_flag */
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < G_N_ELEMENTS(g_mv_update_probs.prob[i]); j++)
+                write_bool(e, g_mv_update_probs.prob[i][j], FALSE);
+        }
+    }
+
+    /* Some (fake) macroblock data, so that the header is followed by
+       something, as in actual streams */
+    for (i = 0; i < 64; i++)
+        write_literal(e, g_rand_int(rand) & 0xff, 8);
+    return bool_encoder_flush(e);
+}
+
+static void
+create_frame(Frame *frame, GRand *rand, gboolean key_frame,
+    GstVp8TokenProbs *probs)
+{
+    const guint header_size = key_frame ? 10 : 3;
+    guint8 first_partition[8192];
+    guint32 frame_tag;
+    BoolEncoder e;
+    guint8 *p;
+
+    frame->key_frame = key_frame;
+    frame->y_ac_qi = g_rand_int_range(rand, 0, 128);
+
+    /* Key frames usually refresh a lot of coefficient probabilities,
+       while only a few inter frames update some of them */
+    if (key_frame) {
+        gst_vp8_token_probs_init_defaults(probs);
+        frame->num_token_updates = g_rand_int_range(rand, 32, 128);
+    }
+    else if (g_rand_int_range(rand, 0, 8) == 0)
+        frame->num_token_updates = g_rand_int_range(rand, 1, 16);
+    else
+        frame->num_token_updates = 0;
+
+    bool_encoder_init(&e, first_partition);
+    frame->first_part_size = write_first_partition(&e, rand, frame, probs);
+    frame->token_probs = *probs;
+
+    frame->size = header_size + frame->first_part_size + DCT_PARTITION_SIZE;
+    frame->data = p = g_malloc(frame->size);
+
+    frame_tag = (key_frame ? 0 : 1) |   /* version 0 */
+        (1 << 4) |                      /* show_frame */
+        (frame->first_part_size << 5);
+    *p++ = frame_tag;
+    *p++ = frame_tag >> 8;
+    *p++ = frame_tag >> 16;
+    if (key_frame) {
+        *p++ = 0x9d;
+        *p++ = 0x01;
+        *p++ = 0x2a;
+        *p++ = FRAME_WIDTH & 0xff;
+        *p++ = FRAME_WIDTH >> 8;
+        *p++ = FRAME_HEIGHT & 0xff;
+        *p++ = FRAME_HEIGHT >> 8;
+    }
+    memcpy(p, first_partition, frame->first_part_size);
+    p += frame->first_part_size;
+    memset(p, 0, DCT_PARTITION_SIZE);
+}
+
+static Frame *
+create_sequence(guint num_frames)
+{
+    GstVp8TokenProbs probs;
+    Frame *frames;
+    GRand *rand;
+    guint i;
+
+    gst_vp8_token_update_probs_init(&g_token_update_probs);
+    gst_vp8_mv_update_probs_init(&g_mv_update_probs);
+
+    frames = g_new(Frame, num_frames);
+    rand = g_rand_new_with_seed(1);
+    for (i = 0; i < num_frames; i++)
+        create_frame(&frames[i], rand, i % g_key_interval == 0, &probs);
+    g_rand_free(rand);
+    return frames;
+}
+
+static void
+destroy_sequence(Frame *frames, guint num_frames)
+{
+    guint i;
+
+    for (i = 0; i < num_frames; i++)
+        g_free(frames[i].data);
+    g_free(frames);
+}
+
+/* Parses the whole sequence once, checks the headers against what was
+   written, and returns the number of frames that changed the
+   coefficient probabilities */
+static guint
+check_sequence(const Frame *frames, guint num_frames)
+{
+    GstVp8Parser parser;
+    GstVp8FrameHdr frame_hdr;
+    GstVp8ParserResult result;
+    guint8 last_probs[sizeof(frame_hdr.token_probs.prob)];
+    guint i, num_changes = 0;
+
+    gst_vp8_parser_init(&parser);
+    for (i = 0; i < num_frames; i++) {
+        const Frame * const frame = &frames[i];
+
+        memset(&frame_hdr, 0, sizeof(frame_hdr));
+        result = gst_vp8_parser_parse_frame_header(&parser, &frame_hdr,
+            frame->data, frame->size);
+        if (result != GST_VP8_PARSER_OK)
+            g_error("failed to parse frame %u header", i);
+
+        g_assert(frame_hdr.key_frame == frame->key_frame);
+        g_assert(frame_hdr.first_part_size == frame->first_part_size);
+        g_assert(frame_hdr.quant_indices.y_ac_qi == frame->y_ac_qi);
+        if (frame->key_frame) {
+            g_assert(frame_hdr.width == FRAME_WIDTH);
+            g_assert(frame_hdr.height == FRAME_HEIGHT);
+        }
+        if (memcmp(frame_hdr.token_probs.prob, frame->token_probs.prob,
+                sizeof(frame_hdr.token_probs.prob)) != 0)
+            g_error("coefficient probabilities mismatch for frame %u", i);
+
+        /* Same check as the decoder does before refilling its
+           VAProbabilityDataBufferVP8 */
+        if (i == 0 || memcmp(last_probs, frame_hdr.token_probs.prob,
+                sizeof(last_probs)) != 0)
+            num_changes++;
+        memcpy(last_probs, frame_hdr.token_probs.prob, sizeof(last_probs));
+    }
+    return num_changes;
+}
+
+/* Parses g_num_frames headers from the sequence, and returns the elapsed
+   time per frame, in ns */
+static gdouble
+run_benchmark(const Frame *frames, guint num_frames)
+{
+    GstVp8Parser parser;
+    GstVp8FrameHdr frame_hdr;
+    gint64 start_time, elapsed;
+    guint i;
+
+    gst_vp8_parser_init(&parser);
+    start_time = g_get_monotonic_time();
+    for (i = 0; i < g_num_frames; i++) {
+        const Frame * const frame = &frames[i % num_frames];
+
+        memset(&frame_hdr, 0, sizeof(frame_hdr));
+        gst_vp8_parser_parse_frame_header(&parser, &frame_hdr,
+            frame->data, frame->size);
+        g_checksum += frame_hdr.header_size;
+    }
+    elapsed = g_get_monotonic_time() - start_time;
+    return elapsed * 1000.0 / g_num_frames;
+}
+
+int
+main(int argc, char *argv[])
+{
+    GOptionContext *options;
+    Frame *frames;
+    guint num_changes;
+    gdouble parse_time;
+
+    options = g_option_context_new(" - test VP8 frame headers parsing");
+    g_option_context_add_main_entries(options, g_options, NULL);
+    g_option_context_parse(options, &argc, &argv, NULL);
+    g_option_context_free(options);
+
+    if (!g_num_frames)
+        g_error("invalid number of frames");
+    if (!g_key_interval)
+        g_error("invalid key frame interval");
+
+    frames = create_sequence(SEQUENCE_LENGTH);
+    num_changes = check_sequence(frames, SEQUENCE_LENGTH);
+    parse_time = run_benchmark(frames, SEQUENCE_LENGTH);
+    destroy_sequence(frames, SEQUENCE_LENGTH);
+
+    g_print("frame header parsing cost per frame (key interval %u)\n",
+        g_key_interval);
+    g_print("  parser:                %8.1f ns\n", parse_time);
+    g_print("coefficient probabilities changed in %u of %u frames\n",
+        num_changes, SEQUENCE_LENGTH);
+    return 0;
+}
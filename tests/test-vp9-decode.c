@@ -0,0 +1,607 @@
+/*
+ *  test-vp9-decode.c - Test VP9 superframes and reference frames handling
+ *
+ *  Copyright (C) 2014 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Splits an IVF stream into frames, parses their uncompressed headers
+   and tracks the sizes of the 8 reference frame slots, then decodes the
+   stream with the stub VA driver and checks which packets output a
+   frame, and at which size. Without an IVF file on the command line, a
+   synthetic stream is generated that covers superframes with hidden
+   frames, show_existing_frame, intra-only frames, resolution changes
+   with scaled references, segmentation and loop filter deltas. The stub
+   VA driver rejects references that are not render targets of the VA
+   context, e.g. once the surfaces were reallocated for a larger size */
+
+#include "gst/vaapi/sysdeps.h"
+#include <string.h>
+#include <gst/base/gstbitwriter.h>
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapidecoder_vp9.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include "gst/vaapi/gstvaapiutils_vp9_priv.h"
+#include "stub-display.h"
+
+#define IVF_FILE_HEADER_SIZE    32
+#define IVF_FRAME_HEADER_SIZE   12
+#define COMPRESSED_HEADER_SIZE  16
+#define TILE_DATA_SIZE          64
+
+static gchar *g_input_file;
+
+static GOptionEntry g_options[] = {
+    { "input", 'i',
+      0,
+      G_OPTION_ARG_FILENAME, &g_input_file,
+      "IVF file to check instead of the synthetic stream", NULL },
+    { NULL, }
+};
+
+/* Expected result of one packet, i.e. one IVF frame */
+typedef struct {
+    gboolean    shown;
+    guint       width;
+    guint       height;
+} PacketInfo;
+
+typedef struct {
+    const guint8       *data;
+    guint               size;
+} Packet;
+
+/* ------------------------------------------------------------------------- */
+/* --- Synthetic stream                                                  --- */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    gboolean    show_existing_frame;
+    guint       frame_to_show;
+    gboolean    key_frame;
+    gboolean    intra_only;
+    gboolean    show_frame;
+    guint       refresh_frame_flags;
+    guint       ref_frame_idx[3];
+    gint        size_from_ref;          /* -1: explicit frame size */
+    guint       width;
+    guint       height;
+    gboolean    segmentation;
+    gboolean    lf_deltas;
+    gboolean    superframe_end;         /* last frame of the packet */
+} TestFrame;
+
+static const TestFrame g_test_frames[] = {
+    /* key frame */
+    { FALSE, 0, TRUE,  FALSE, TRUE,  0xff, {0, 0, 0}, -1, 352, 288,
+      FALSE, FALSE, TRUE },
+    /* inter frame, loop filter deltas */
+    { FALSE, 0, FALSE, FALSE, TRUE,  0x01, {0, 1, 2},  0, 352, 288,
+      FALSE, TRUE,  TRUE },
+    /* superframe: hidden alternate reference frame, then inter frame */
+    { FALSE, 0, FALSE, FALSE, FALSE, 0x04, {0, 1, 2},  0, 352, 288,
+      TRUE,  FALSE, FALSE },
+    { FALSE, 0, FALSE, FALSE, TRUE,  0x01, {0, 1, 2},  2, 352, 288,
+      TRUE,  FALSE, TRUE },
+    /* show the alternate reference frame */
+    { TRUE,  2, FALSE, FALSE, FALSE, 0x00, {0, 0, 0}, -1,   0,   0,
+      FALSE, FALSE, TRUE },
+    /* lone hidden intra-only frame of a smaller size, then shown */
+    { FALSE, 0, FALSE, TRUE,  FALSE, 0x08, {0, 0, 0}, -1, 176, 144,
+      FALSE, FALSE, TRUE },
+    { TRUE,  3, FALSE, FALSE, FALSE, 0x00, {0, 0, 0}, -1,   0,   0,
+      FALSE, FALSE, TRUE },
+    /* inter frame at the smaller size, i.e. with scaled references */
+    { FALSE, 0, FALSE, FALSE, TRUE,  0x01, {3, 1, 2}, -1, 176, 144,
+      FALSE, FALSE, TRUE },
+    /* back to the original size of the golden frame */
+    { FALSE, 0, FALSE, FALSE, TRUE,  0x02, {0, 1, 2},  1, 352, 288,
+      FALSE, TRUE,  TRUE },
+    /* key frame at a larger size, i.e. the surfaces are reallocated */
+    { FALSE, 0, TRUE,  FALSE, TRUE,  0xff, {0, 0, 0}, -1, 704, 576,
+      TRUE,  FALSE, TRUE },
+    { FALSE, 0, FALSE, FALSE, TRUE,  0x01, {0, 1, 2},  0, 704, 576,
+      FALSE, FALSE, TRUE },
+    /* inter frames at a larger size, i.e. the surfaces are reallocated
+       while the smaller references are still in use */
+    { FALSE, 0, FALSE, FALSE, TRUE,  0x01, {0, 1, 2}, -1, 1408, 1152,
+      FALSE, FALSE, TRUE },
+    { FALSE, 0, FALSE, FALSE, TRUE,  0x02, {0, 1, 2},  0, 1408, 1152,
+      FALSE, FALSE, TRUE },
+};
+
+static void
+put_bits(GstBitWriter *bw, guint32 value, guint nbits)
+{
+    if (!gst_bit_writer_put_bits_uint32(bw, value, nbits))
+        g_error("could not write %u bits", nbits);
+}
+
+static void
+put_le(GstBitWriter *bw, guint32 value, guint nbytes)
+{
+    guint i;
+
+    for (i = 0; i < nbytes; i++)
+        put_bits(bw, (value >> (i * 8)) & 0xff, 8);
+}
+
+static void
+put_signed_bits(GstBitWriter *bw, gint value, guint nbits)
+{
+    put_bits(bw, ABS(value), nbits);
+    put_bits(bw, value < 0, 1);
+}
+
+/* Writes the uncompressed header, in the order of the VP9 bitstream
+   specification (6.2), followed by dummy compressed header and tile
+   data, which are not looked at by the stub driver */
+static void
+write_frame(GstBitWriter *bw, const TestFrame *frame)
+{
+    guint i, sb64_cols, max_log2;
+
+    put_bits(bw, 2, 2);                         /* frame_marker */
+    put_bits(bw, 0, 2);                         /* profile 0 */
+    put_bits(bw, frame->show_existing_frame, 1);
+    if (frame->show_existing_frame) {
+        put_bits(bw, frame->frame_to_show, 3);
+        gst_bit_writer_align_bytes(bw, 0);
+        return;
+    }
+
+    put_bits(bw, !frame->key_frame, 1);         /* frame_type */
+    put_bits(bw, frame->show_frame, 1);
+    put_bits(bw, 0, 1);                         /* error_resilient_mode */
+
+    if (frame->key_frame) {
+        put_bits(bw, 0x498342, 24);             /* frame_sync_code */
+        put_bits(bw, 2, 3);                     /* color_space (BT.709) */
+        put_bits(bw, 0, 1);                     /* color_range */
+        put_bits(bw, frame->width - 1, 16);
+        put_bits(bw, frame->height - 1, 16);
+        put_bits(bw, 0, 1);                     /* render_size */
+    } else {
+        if (!frame->show_frame)
+            put_bits(bw, frame->intra_only, 1);
+        put_bits(bw, 0, 2);                     /* reset_frame_context */
+        if (frame->intra_only) {
+            put_bits(bw, 0x498342, 24);
+            put_bits(bw, frame->refresh_frame_flags, 8);
+            put_bits(bw, frame->width - 1, 16);
+            put_bits(bw, frame->height - 1, 16);
+            put_bits(bw, 0, 1);
+        } else {
+            put_bits(bw, frame->refresh_frame_flags, 8);
+            for (i = 0; i < 3; i++) {
+                put_bits(bw, frame->ref_frame_idx[i], 3);
+                put_bits(bw, i == 2, 1);        /* sign_bias */
+            }
+            for (i = 0; i < 3; i++) {
+                put_bits(bw, frame->size_from_ref == (gint)i, 1);
+                if (frame->size_from_ref == (gint)i)
+                    break;
+            }
+            if (frame->size_from_ref < 0) {
+                put_bits(bw, frame->width - 1, 16);
+                put_bits(bw, frame->height - 1, 16);
+            }
+            put_bits(bw, 0, 1);
+            put_bits(bw, 1, 1);                 /* allow_high_precision_mv */
+            put_bits(bw, 0, 1);                 /* is_filter_switchable */
+            put_bits(bw, 2, 2);                 /* EIGHTTAP_SHARP */
+        }
+    }
+
+    put_bits(bw, 1, 1);                         /* refresh_frame_context */
+    put_bits(bw, 1, 1);                         /* frame_parallel */
+    put_bits(bw, 0, 2);                         /* frame_context_idx */
+
+    /* loop_filter_params */
+    put_bits(bw, 36, 6);
+    put_bits(bw, 2, 3);
+    put_bits(bw, 1, 1);                         /* delta_enabled */
+    put_bits(bw, frame->lf_deltas, 1);
+    if (frame->lf_deltas) {
+        put_bits(bw, 0, 1);                     /* INTRA_FRAME */
+        put_bits(bw, 1, 1);                     /* LAST_FRAME */
+        put_signed_bits(bw, -2, 6);
+        put_bits(bw, 0, 1);
+        put_bits(bw, 0, 1);
+        put_bits(bw, 0, 1);                     /* mode_deltas[0] */
+        put_bits(bw, 1, 1);
+        put_signed_bits(bw, 3, 6);
+    }
+
+    /* quantization_params */
+    put_bits(bw, 60, 8);
+    put_bits(bw, 1, 1);
+    put_signed_bits(bw, -3, 4);                 /* delta_q_y_dc */
+    put_bits(bw, 0, 1);
+    put_bits(bw, 0, 1);
+
+    /* segmentation_params, ALT_Q deltas for all segments */
+    put_bits(bw, frame->segmentation, 1);
+    if (frame->segmentation) {
+        put_bits(bw, 1, 1);                     /* update_map */
+        for (i = 0; i < GST_VAAPI_VP9_SEG_TREE_PROBS; i++) {
+            put_bits(bw, 1, 1);
+            put_bits(bw, 128 + i, 8);
+        }
+        put_bits(bw, 0, 1);                     /* temporal_update */
+        put_bits(bw, 1, 1);                     /* update_data */
+        put_bits(bw, 0, 1);                     /* abs_or_delta_update */
+        for (i = 0; i < GST_VAAPI_VP9_MAX_SEGMENTS; i++) {
+            put_bits(bw, 1, 1);
+            put_signed_bits(bw, -4 * (gint)i, 8);
+            put_bits(bw, 0, 1);
+            put_bits(bw, 0, 1);
+            put_bits(bw, 0, 1);
+        }
+    }
+
+    /* tile_info, with the minimum number of tile columns */
+    sb64_cols = (frame->width + 63) / 64;
+    for (max_log2 = 1; (sb64_cols >> max_log2) >= 4; max_log2++)
+        ;
+    if (max_log2 > 1)
+        put_bits(bw, 0, 1);                     /* increment_tile_cols_log2 */
+    put_bits(bw, 0, 1);                         /* tile_rows_log2 */
+
+    put_bits(bw, COMPRESSED_HEADER_SIZE, 16);
+    gst_bit_writer_align_bytes(bw, 0);
+
+    for (i = 0; i < COMPRESSED_HEADER_SIZE + TILE_DATA_SIZE; i++)
+        put_bits(bw, 0, 8);
+}
+
+/* Appends the superframe index of the frames written since
+   frame_offsets[0] */
+static void
+write_superframe_index(GstBitWriter *bw, const guint *frame_offsets,
+    guint num_frames)
+{
+    const guint end_offset = GST_BIT_WRITER_BIT_SIZE(bw) / 8;
+    const guint8 marker = 0xc0 | (3 << 3) | (num_frames - 1);
+    guint i, size;
+
+    put_bits(bw, marker, 8);
+    for (i = 0; i < num_frames; i++) {
+        size = (i + 1 < num_frames ? frame_offsets[i + 1] : end_offset) -
+            frame_offsets[i];
+        put_le(bw, size, 4);
+    }
+    put_bits(bw, marker, 8);
+}
+
+/* Generates an IVF stream of the test frames, one packet per superframe */
+static guint8 *
+create_ivf_stream(gsize *size_ptr)
+{
+    GstBitWriter bw;
+    guint frame_offsets[GST_VAAPI_VP9_MAX_SUPERFRAME_FRAMES];
+    guint i, num_frames = 0, num_packets = 0, packet_offset = 0, size;
+    guint8 *data;
+
+    for (i = 0; i < G_N_ELEMENTS(g_test_frames); i++)
+        num_packets += g_test_frames[i].superframe_end;
+
+    gst_bit_writer_init(&bw, 64 * 1024 * 8);
+    put_le(&bw, GST_MAKE_FOURCC('D','K','I','F'), 4);
+    put_le(&bw, 0, 2);                          /* version */
+    put_le(&bw, IVF_FILE_HEADER_SIZE, 2);
+    put_le(&bw, GST_MAKE_FOURCC('V','P','9','0'), 4);
+    put_le(&bw, 352, 2);
+    put_le(&bw, 288, 2);
+    put_le(&bw, 30, 4);                         /* framerate */
+    put_le(&bw, 1, 4);
+    put_le(&bw, num_packets, 4);
+    put_le(&bw, 0, 4);
+
+    for (i = 0; i < G_N_ELEMENTS(g_test_frames); i++) {
+        const TestFrame * const frame = &g_test_frames[i];
+
+        if (num_frames == 0) {
+            packet_offset = GST_BIT_WRITER_BIT_SIZE(&bw) / 8;
+            put_le(&bw, 0, 4);                  /* patched below */
+            put_le(&bw, i, 4);                  /* pts */
+            put_le(&bw, 0, 4);
+        }
+        frame_offsets[num_frames++] = GST_BIT_WRITER_BIT_SIZE(&bw) / 8;
+        write_frame(&bw, frame);
+        if (!frame->superframe_end)
+            continue;
+
+        if (num_frames > 1)
+            write_superframe_index(&bw, frame_offsets, num_frames);
+        size = GST_BIT_WRITER_BIT_SIZE(&bw) / 8 - packet_offset -
+            IVF_FRAME_HEADER_SIZE;
+        GST_WRITE_UINT32_LE(GST_BIT_WRITER_DATA(&bw) + packet_offset, size);
+        num_frames = 0;
+    }
+
+    *size_ptr = GST_BIT_WRITER_BIT_SIZE(&bw) / 8;
+    data = g_memdup(GST_BIT_WRITER_DATA(&bw), *size_ptr);
+    gst_bit_writer_clear(&bw, TRUE);
+    return data;
+}
+
+static GArray *
+parse_ivf_stream(const guint8 *data, gsize size)
+{
+    GArray *packets;
+    Packet packet;
+    gsize offset;
+
+    if (size < IVF_FILE_HEADER_SIZE || memcmp(data, "DKIF", 4) != 0)
+        g_error("not an IVF file");
+    if (memcmp(data + 8, "VP90", 4) != 0)
+        g_error("not a VP9 stream");
+
+    packets = g_array_new(FALSE, FALSE, sizeof(Packet));
+    offset = GST_READ_UINT16_LE(data + 6);
+    while (offset + IVF_FRAME_HEADER_SIZE <= size) {
+        packet.size = GST_READ_UINT32_LE(data + offset);
+        packet.data = data + offset + IVF_FRAME_HEADER_SIZE;
+        offset += IVF_FRAME_HEADER_SIZE + packet.size;
+        if (offset > size)
+            g_error("truncated IVF frame %u", packets->len);
+        g_array_append_val(packets, packet);
+    }
+    return packets;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Headers checks                                                    --- */
+/* ------------------------------------------------------------------------- */
+
+static void
+check_test_frame(const GstVaapiVp9FrameHdr *frame_hdr, const TestFrame *frame)
+{
+    guint8 levels[4][2];
+
+    g_assert(frame_hdr->show_existing_frame == frame->show_existing_frame);
+    if (frame->show_existing_frame) {
+        g_assert(frame_hdr->frame_to_show == frame->frame_to_show);
+        return;
+    }
+
+    g_assert(frame_hdr->frame_type == (frame->key_frame ?
+            GST_VAAPI_VP9_KEY_FRAME : GST_VAAPI_VP9_NON_KEY_FRAME));
+    g_assert(frame_hdr->intra_only == frame->intra_only);
+    g_assert(frame_hdr->show_frame == frame->show_frame);
+    g_assert(frame_hdr->refresh_frame_flags == frame->refresh_frame_flags);
+    g_assert(frame_hdr->width == frame->width);
+    g_assert(frame_hdr->height == frame->height);
+    g_assert(frame_hdr->compressed_header_size == COMPRESSED_HEADER_SIZE);
+    g_assert(frame_hdr->base_q_idx == 60 && frame_hdr->delta_q_y_dc == -3);
+    g_assert(frame_hdr->loop_filter.filter_level == 36);
+    g_assert(frame_hdr->loop_filter.sharpness_level == 2);
+    if (!frame->key_frame && !frame->intra_only) {
+        g_assert(frame_hdr->interp_filter ==
+            GST_VAAPI_VP9_INTERP_EIGHTTAP_SHARP);
+        g_assert(frame_hdr->ref_frame_sign_bias[2] == 1);
+    }
+
+    /* Loop filter deltas persist until the next key frame. With a
+       filter level of 36, deltas are doubled */
+    gst_vaapi_utils_vp9_get_filter_levels(frame_hdr, 0, levels);
+    g_assert(levels[GST_VAAPI_VP9_INTRA_FRAME][0] == 36 + 2);
+    g_assert(levels[GST_VAAPI_VP9_GOLDEN_FRAME][0] == 36 - 2);
+    if (frame_hdr->loop_filter.ref_deltas[GST_VAAPI_VP9_LAST_FRAME] == -2) {
+        g_assert(levels[GST_VAAPI_VP9_LAST_FRAME][0] == 36 - 4);
+        g_assert(levels[GST_VAAPI_VP9_LAST_FRAME][1] == 36 - 4 + 6);
+    }
+
+    g_assert(frame_hdr->segmentation.enabled == frame->segmentation);
+    if (frame->segmentation) {
+        g_assert(frame_hdr->segmentation.tree_probs[6] == 128 + 6);
+        g_assert(gst_vaapi_utils_vp9_get_qindex(frame_hdr, 5) == 60 - 20);
+    } else
+        g_assert(gst_vaapi_utils_vp9_get_qindex(frame_hdr, 5) == 60);
+}
+
+/* Parses all the packets, and returns which of them show a frame */
+static PacketInfo *
+check_headers(GArray *packets, gboolean synthetic)
+{
+    GstVaapiVp9Parser parser;
+    GstVaapiVp9FrameHdr frame_hdr;
+    PacketInfo *infos;
+    guint frame_sizes[GST_VAAPI_VP9_MAX_SUPERFRAME_FRAMES];
+    guint ref_width[GST_VAAPI_VP9_REF_FRAMES] = { 0, };
+    guint ref_height[GST_VAAPI_VP9_REF_FRAMES] = { 0, };
+    guint i, j, k, num_frames, index_size, offset, test_frame = 0;
+    guint num_superframes = 0, num_hidden = 0, num_existing = 0;
+
+    gst_vaapi_utils_vp9_parser_init(&parser);
+    infos = g_new0(PacketInfo, packets->len);
+    for (i = 0; i < packets->len; i++) {
+        const Packet * const packet = &g_array_index(packets, Packet, i);
+
+        num_frames = gst_vaapi_utils_vp9_parse_superframe_index(packet->data,
+            packet->size, frame_sizes, &index_size);
+        if (num_frames > 0)
+            num_superframes++;
+        else {
+            frame_sizes[0] = packet->size;
+            num_frames = 1;
+        }
+
+        for (j = 0, offset = 0; j < num_frames; j++) {
+            if (!gst_vaapi_utils_vp9_parse_frame_header(&parser, &frame_hdr,
+                    packet->data + offset, frame_sizes[j]))
+                g_error("could not parse frame %u of packet %u", j, i);
+            offset += frame_sizes[j];
+
+            if (synthetic) {
+                g_assert(test_frame < G_N_ELEMENTS(g_test_frames));
+                check_test_frame(&frame_hdr, &g_test_frames[test_frame]);
+                g_assert(g_test_frames[test_frame++].superframe_end ==
+                    (j == num_frames - 1));
+            }
+
+            if (frame_hdr.show_existing_frame) {
+                k = frame_hdr.frame_to_show;
+                g_assert(ref_width[k] > 0);
+                infos[i].shown = TRUE;
+                infos[i].width = ref_width[k];
+                infos[i].height = ref_height[k];
+                num_existing++;
+                continue;
+            }
+
+            for (k = 0; k < GST_VAAPI_VP9_REF_FRAMES; k++) {
+                if (frame_hdr.refresh_frame_flags & (1 << k)) {
+                    ref_width[k] = frame_hdr.width;
+                    ref_height[k] = frame_hdr.height;
+                }
+                g_assert(parser.ref_width[k] == ref_width[k]);
+                g_assert(parser.ref_height[k] == ref_height[k]);
+            }
+
+            if (frame_hdr.show_frame) {
+                infos[i].shown = TRUE;
+                infos[i].width = frame_hdr.width;
+                infos[i].height = frame_hdr.height;
+            } else
+                num_hidden++;
+        }
+    }
+    if (synthetic)
+        g_assert(test_frame == G_N_ELEMENTS(g_test_frames));
+
+    g_print("%u packets, %u superframes, %u hidden frames, "
+        "%u shown existing frames\n", packets->len, num_superframes,
+        num_hidden, num_existing);
+    return infos;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Decoding                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+static void
+get_output_size(GstVaapiSurfaceProxy *proxy, guint *width_ptr,
+    guint *height_ptr)
+{
+    const GstVaapiRectangle * const crop_rect =
+        gst_vaapi_surface_proxy_get_crop_rect(proxy);
+
+    if (crop_rect) {
+        *width_ptr = crop_rect->width;
+        *height_ptr = crop_rect->height;
+    }
+    else
+        gst_vaapi_surface_get_size(gst_vaapi_surface_proxy_get_surface(proxy),
+            width_ptr, height_ptr);
+}
+
+static void
+check_decode(GstVaapiDisplay *display, GArray *packets,
+    const PacketInfo *infos)
+{
+    GstVaapiDecoder *decoder;
+    GstVaapiDecoderStatus status;
+    GstVaapiSurfaceProxy *proxy;
+    GstBuffer *buffer;
+    GstCaps *caps;
+    guint i, num_outputs, width, height;
+
+    caps = gst_caps_new_empty_simple("video/x-vp9");
+    decoder = gst_vaapi_decoder_vp9_new(display, caps);
+    gst_caps_unref(caps);
+    if (!decoder)
+        g_error("could not create VP9 decoder");
+
+    for (i = 0; i < packets->len; i++) {
+        const Packet * const packet = &g_array_index(packets, Packet, i);
+
+        buffer = gst_buffer_new_allocate(NULL, packet->size, NULL);
+        gst_buffer_fill(buffer, 0, packet->data, packet->size);
+        GST_BUFFER_PTS(buffer) = i * GST_SECOND / 30;
+        if (!gst_vaapi_decoder_put_buffer(decoder, buffer))
+            g_error("could not submit packet %u", i);
+        gst_buffer_unref(buffer);
+
+        num_outputs = 0;
+        while ((status = gst_vaapi_decoder_get_surface(decoder, &proxy)) ==
+               GST_VAAPI_DECODER_STATUS_SUCCESS) {
+            get_output_size(proxy, &width, &height);
+            if (width != infos[i].width || height != infos[i].height)
+                g_error("packet %u: got %ux%u frame, expected %ux%u", i,
+                    width, height, infos[i].width, infos[i].height);
+            gst_vaapi_surface_proxy_unref(proxy);
+            num_outputs++;
+        }
+        if (status != GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA)
+            g_error("could not decode packet %u (status %d)", i, status);
+        if (num_outputs != (infos[i].shown ? 1 : 0))
+            g_error("packet %u: got %u frames, expected %u", i, num_outputs,
+                infos[i].shown ? 1 : 0);
+    }
+    gst_vaapi_decoder_unref(decoder);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GOptionContext *options;
+    GstVaapiDisplay *display;
+    VADisplay va_display;
+    GArray *packets;
+    PacketInfo *infos;
+    guint8 *data;
+    gsize size;
+    GError *error = NULL;
+
+    options = g_option_context_new(" - VP9 decoder test");
+    g_option_context_add_main_entries(options, g_options, NULL);
+    if (!g_option_context_parse(options, &argc, &argv, NULL))
+        return 1;
+    g_option_context_free(options);
+
+    gst_init(&argc, &argv);
+
+    if (g_input_file) {
+        if (!g_file_get_contents(g_input_file, (gchar **)&data, &size, &error))
+            g_error("could not read %s: %s", g_input_file, error->message);
+    }
+    else
+        data = create_ivf_stream(&size);
+
+    packets = parse_ivf_stream(data, size);
+    infos = check_headers(packets, g_input_file == NULL);
+
+    display = stub_display_new();
+    if (!display)
+        g_error("could not create stub VA display");
+    va_display = gst_vaapi_display_get_display(display);
+
+    check_decode(display, packets, infos);
+    g_print("decoded %u packets\n", packets->len);
+
+    g_free(infos);
+    g_array_free(packets, TRUE);
+    g_free(data);
+    g_free(g_input_file);
+
+    gst_vaapi_display_unref(display);
+    vaTerminate(va_display);
+    gst_deinit();
+    return 0;
+}